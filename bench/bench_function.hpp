@@ -0,0 +1,133 @@
+//===- bench_function.hpp ---------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the parsed function shared by the benchmarks
+//  which need memory regions and program states.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/analysis_manager.hpp"
+#include "dfa/location_manager.hpp"
+#include "dfa/program_state.hpp"
+#include "dfa/region/region.hpp"
+#include "dfa/stack_frame.hpp"
+#include "tooling/context.hpp"
+#include "tooling/options.hpp"
+
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/Decl.h>
+#include <clang/AST/Stmt.h>
+#include <clang/Frontend/ASTUnit.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/Support/Casting.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace knight::bench {
+
+/// \brief A function `void bench()` with the given number of local
+/// variables, parsed with the managers needed to create their regions
+/// and the program states over them.
+class BenchFunction {
+  private:
+    std::unique_ptr< clang::ASTUnit > m_ast;
+    KnightTUContext m_ctx;
+    std::unique_ptr< dfa::AnalysisManager > m_analysis_mgr;
+    dfa::LocationManager m_location_mgr;
+    const dfa::StackFrame* m_frame = nullptr;
+    std::vector< const clang::VarDecl* > m_vars;
+    std::vector< dfa::MemRegionRef > m_regions;
+
+  public:
+    explicit BenchFunction(unsigned num_vars)
+        : m_ast(clang::tooling::buildASTFromCode(make_source(num_vars))),
+          m_ctx(std::make_shared< KnightOptionsDefaultProvider >()) {
+        m_ctx.set_current_ast_context(&m_ast->getASTContext());
+        m_analysis_mgr = std::make_unique< dfa::AnalysisManager >(m_ctx);
+
+        const auto* function = find_function();
+        m_frame = m_location_mgr.create_top_frame(function);
+        for (const auto* stmt :
+             llvm::cast< clang::CompoundStmt >(function->getBody())->body()) {
+            const auto* decl_stmt = llvm::dyn_cast< clang::DeclStmt >(stmt);
+            if (decl_stmt == nullptr) {
+                continue;
+            }
+            for (const auto* decl : decl_stmt->decls()) {
+                if (const auto* var = llvm::dyn_cast< clang::VarDecl >(decl)) {
+                    m_vars.push_back(var);
+                }
+            }
+        }
+        for (const auto* var : m_vars) {
+            m_regions.push_back(get_region_manager().get_region(var, m_frame));
+        }
+    }
+
+  public:
+    [[nodiscard]] const std::vector< const clang::VarDecl* >& get_vars()
+        const {
+        return m_vars;
+    }
+
+    [[nodiscard]] const std::vector< dfa::MemRegionRef >& get_regions()
+        const {
+        return m_regions;
+    }
+
+    [[nodiscard]] const dfa::StackFrame* get_frame() const { return m_frame; }
+
+    [[nodiscard]] dfa::RegionManager& get_region_manager() const {
+        return m_analysis_mgr->get_region_manager();
+    }
+
+    [[nodiscard]] dfa::ProgramStateManager& get_state_manager() const {
+        return m_analysis_mgr->get_state_manager();
+    }
+
+    /// \brief Get the function with the given number of variables, parsed
+    /// once per benchmark binary.
+    [[nodiscard]] static const BenchFunction& get(unsigned num_vars) {
+        static std::map< unsigned, std::unique_ptr< BenchFunction > >
+            functions;
+        auto& function = functions[num_vars];
+        if (function == nullptr) {
+            function = std::make_unique< BenchFunction >(num_vars);
+        }
+        return *function;
+    }
+
+  private:
+    [[nodiscard]] static std::string make_source(unsigned num_vars) {
+        std::string source = "void bench() {\n";
+        for (unsigned i = 0U; i < num_vars; ++i) {
+            source += "  int v" + std::to_string(i) + " = 0;\n";
+        }
+        source += "}\n";
+        return source;
+    }
+
+    [[nodiscard]] const clang::FunctionDecl* find_function() const {
+        for (const auto* decl :
+             m_ast->getASTContext().getTranslationUnitDecl()->decls()) {
+            const auto* function = llvm::dyn_cast< clang::FunctionDecl >(decl);
+            if (function != nullptr && function->hasBody()) {
+                return function;
+            }
+        }
+        knight_unreachable("no bench function"); // NOLINT
+    }
+}; // class BenchFunction
+
+} // namespace knight::bench
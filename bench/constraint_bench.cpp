@@ -0,0 +1,283 @@
+//===- constraint_bench.cpp -------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file benchmarks the normalization of the linear constraint
+//  systems and the zone closure, checked against the brute-force
+//  enumeration of the solutions of random systems.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/constraint/linear.hpp"
+#include "dfa/domain/numerical/zone_dom.hpp"
+#include "dfa/var_index.hpp"
+#include "util/znum.hpp"
+
+#include <benchmark/benchmark.h>
+#include <llvm/ADT/STLExtras.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace knight::dfa {
+
+namespace {
+
+using BenchLinearExpr = LinearExpr< ZNum, DenseVar >;
+using BenchLinearConstraint = LinearConstraint< ZNum, DenseVar >;
+using BenchLinearConstraintSystem = LinearConstraintSystem< ZNum, DenseVar >;
+
+/// \brief The solutions are enumerated over the points of
+/// `[-BoxBound, BoxBound]^NumVars`.
+/// @{
+constexpr unsigned NumVars = 3U;
+constexpr int64_t BoxBound = 4;
+using Point = std::array< int64_t, NumVars >;
+/// @}
+
+constexpr unsigned NumForms = 3U;
+constexpr unsigned NumSystems = 64U;
+
+/// \brief A constraint `expr op 0` as generated, before it is put in
+/// canonical form.
+struct RawConstraint {
+    BenchLinearExpr expr;
+    LinearConstraintKind kind;
+}; // struct RawConstraint
+
+/// \brief Make random constraints over a few parallel forms, i.e., the
+/// constraints `k * u + c op 0` of the same linear forms `u`, which are
+/// the ones normalize() reduces.
+///
+/// The zone constraints are the inequalities over the unit differences.
+std::vector< RawConstraint > make_constraints(std::mt19937& rng,
+                                              unsigned num_csts,
+                                              bool is_zone) {
+    constexpr std::array< int, 4 > Scales = {-1, 1, -2, 2};
+    std::uniform_int_distribution< int > factor_dist(-2, 2);
+    std::uniform_int_distribution< int > constant_dist(-6, 6);
+    std::uniform_int_distribution< std::size_t > scale_dist(0U,
+                                                            is_zone ? 1U
+                                                                    : 3U);
+    std::uniform_int_distribution< std::size_t > form_dist(0U,
+                                                           NumForms - 1U);
+    std::uniform_int_distribution< std::size_t > kind_dist(0U, 2U);
+    std::uniform_int_distribution< DenseVarID > var_dist(0U, NumVars - 1U);
+
+    std::vector< BenchLinearExpr > forms;
+    while (forms.size() < NumForms) {
+        BenchLinearExpr form;
+        if (is_zone) {
+            const DenseVarID x = var_dist(rng);
+            const DenseVarID y = var_dist(rng);
+            form.plus(x);
+            if (x != y) {
+                form.plus(ZNum(-1), y);
+            }
+        } else {
+            for (DenseVarID var = 0U; var < NumVars; ++var) {
+                const int factor = factor_dist(rng);
+                if (factor != 0) {
+                    form.plus(ZNum(factor), var);
+                }
+            }
+        }
+        if (!form.is_constant()) {
+            forms.push_back(std::move(form));
+        }
+    }
+
+    constexpr std::array< LinearConstraintKind, 3 > Kinds =
+        {LinearConstraintKind::LCK_Equality,
+         LinearConstraintKind::LCK_Disequation,
+         LinearConstraintKind::LCK_Inequality};
+    std::vector< RawConstraint > csts;
+    csts.reserve(num_csts);
+    for (unsigned i = 0U; i < num_csts; ++i) {
+        auto expr = forms[form_dist(rng)];
+        expr *= ZNum(Scales[scale_dist(rng)]);
+        expr += ZNum(constant_dist(rng));
+        csts.push_back({std::move(expr),
+                        is_zone ? LinearConstraintKind::LCK_Inequality
+                                : Kinds[kind_dist(rng)]});
+    }
+    return csts;
+}
+
+BenchLinearConstraintSystem make_system(
+    const std::vector< RawConstraint >& raw_csts) {
+    BenchLinearConstraintSystem csts;
+    for (const auto& [expr, kind] : raw_csts) {
+        csts.add_linear_constraint(BenchLinearConstraint(expr, kind));
+    }
+    return csts;
+}
+
+bool satisfies(const BenchLinearExpr& expr,
+               LinearConstraintKind kind,
+               const Point& point) {
+    ZNum value = expr.get_constant_term();
+    for (const auto& [var, factor] : expr.get_variable_terms()) {
+        value += factor * ZNum(point[var]);
+    }
+    switch (kind) {
+        case LinearConstraintKind::LCK_Equality:
+            return value == 0;
+        case LinearConstraintKind::LCK_Disequation:
+            return value != 0;
+        case LinearConstraintKind::LCK_Inequality:
+            return value <= 0;
+    }
+    return false;
+}
+
+bool satisfies(const std::vector< RawConstraint >& csts, const Point& point) {
+    return llvm::all_of(csts, [&point](const RawConstraint& cst) {
+        return satisfies(cst.expr, cst.kind, point);
+    });
+}
+
+bool satisfies(const BenchLinearConstraintSystem& csts, const Point& point) {
+    return llvm::all_of(csts, [&point](const BenchLinearConstraint& cst) {
+        return satisfies(cst.get_linear_expression(),
+                         cst.get_constraint_kind(),
+                         point);
+    });
+}
+
+/// \brief Call `fn(point)` on each point of the box, until it returns
+/// false.
+///
+/// \return false if `fn` did.
+template < typename Fn >
+bool for_each_point(Fn&& fn) {
+    Point point;
+    point.fill(-BoxBound);
+    while (true) {
+        if (!fn(point)) {
+            return false;
+        }
+        unsigned var = 0U;
+        while (var < NumVars && point[var] == BoxBound) {
+            point[var] = -BoxBound;
+            ++var;
+        }
+        if (var == NumVars) {
+            return true;
+        }
+        ++point[var];
+    }
+}
+
+/// \brief Whether the zone contains the point, by the bounds of its
+/// variables.
+bool contains(const ZoneDom& zone, const Point& point) {
+    if (zone.is_bottom()) {
+        return false;
+    }
+    for (DenseVarID var = 0U; var < NumVars; ++var) {
+        const auto itv = zone.get_interval(var);
+        if ((itv.lb && ZNum(point[var]) < *itv.lb) ||
+            (itv.ub && *itv.ub < ZNum(point[var]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void bm_constraint_system_normalize(benchmark::State& state) {
+    const auto num_csts = static_cast< unsigned >(state.range(0));
+    std::mt19937 rng(num_csts);
+    std::vector< BenchLinearConstraintSystem > systems;
+    std::size_t num_csts_before = 0U;
+    std::size_t num_csts_after = 0U;
+    for (unsigned i = 0U; i < NumSystems; ++i) {
+        const auto raw_csts =
+            make_constraints(rng, num_csts, /*is_zone=*/false);
+        auto csts = make_system(raw_csts);
+        auto normalized_csts = csts;
+        normalized_csts.normalize();
+        // The canonical forms and the normalized system keep the integer
+        // solutions of the constraints.
+        const bool has_same_solutions =
+            for_each_point([&](const Point& point) {
+                const bool is_solution = satisfies(raw_csts, point);
+                return satisfies(csts, point) == is_solution &&
+                       satisfies(normalized_csts, point) == is_solution;
+            });
+        if (!has_same_solutions) {
+            state.SkipWithError("normalize() changed the solutions");
+            return;
+        }
+        num_csts_before += csts.size();
+        num_csts_after += normalized_csts.size();
+        systems.push_back(std::move(csts));
+    }
+
+    for (auto _ : state) {
+        for (const auto& csts : systems) {
+            auto normalized_csts = csts;
+            normalized_csts.normalize();
+            benchmark::DoNotOptimize(normalized_csts);
+        }
+    }
+    state.counters["removed"] =
+        1.0 - static_cast< double >(num_csts_after) /
+                  static_cast< double >(num_csts_before);
+    state.SetComplexityN(state.range(0));
+}
+
+void bm_zone_add_constraints(benchmark::State& state) {
+    const auto num_csts = static_cast< unsigned >(state.range(0));
+    std::mt19937 rng(num_csts);
+    std::vector< BenchLinearConstraintSystem > systems;
+    for (unsigned i = 0U; i < NumSystems; ++i) {
+        auto csts =
+            make_system(make_constraints(rng, num_csts, /*is_zone=*/true));
+        // The closed zone over-approximates the solutions, hence keeps
+        // each of them within the bounds of its variables.
+        ZoneDom zone;
+        zone.merge_with_linear_constraint_system(csts);
+        const bool is_sound = for_each_point([&](const Point& point) {
+            return !satisfies(csts, point) || contains(zone, point);
+        });
+        if (!is_sound) {
+            state.SkipWithError("the zone lost a solution");
+            return;
+        }
+        systems.push_back(std::move(csts));
+    }
+
+    for (auto _ : state) {
+        for (const auto& csts : systems) {
+            ZoneDom zone;
+            zone.merge_with_linear_constraint_system(csts);
+            benchmark::DoNotOptimize(zone);
+        }
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+} // anonymous namespace
+
+// NOLINTBEGIN
+BENCHMARK(bm_constraint_system_normalize)
+    ->RangeMultiplier(2)
+    ->Range(4, 64)
+    ->Complexity(benchmark::oN);
+BENCHMARK(bm_zone_add_constraints)
+    ->RangeMultiplier(2)
+    ->Range(4, 64)
+    ->Complexity(benchmark::oN);
+// NOLINTEND
+
+} // namespace knight::dfa
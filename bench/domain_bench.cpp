@@ -0,0 +1,248 @@
+//===- domain_bench.cpp -----------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file benchmarks the lattice operations of the abstract domains.
+//
+//===------------------------------------------------------------------===//
+
+#include "bench_function.hpp"
+#include "dfa/domain/demo_dom.hpp"
+#include "dfa/domain/map/separate_numerical_domain.hpp"
+#include "dfa/domain/numerical/interval_env.hpp"
+#include "dfa/domain/numerical/packed_dom.hpp"
+#include "dfa/domain/numerical/zone_dom.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+namespace knight::dfa {
+
+namespace {
+
+/// \brief A numerical variable identified by its index.
+struct BenchVar {
+    using Ref = unsigned;
+}; // struct BenchVar
+
+using BenchNumericalDom = SeparateNumericalDom< int64_t,
+                                                BenchVar,
+                                                DemoItvDom,
+                                                DomainKind::DemoMapDom >;
+
+/// \brief The domains over hash tables, to compare with the flat maps.
+/// @{
+using HashMapDomain =
+    MapDom< MemRegionRef,
+            DemoItvDom,
+            DomainKind::DemoMapDom,
+            std::unordered_map< MemRegionRef, DemoItvDom > >;
+using HashNumericalDom =
+    SeparateNumericalDom< int64_t,
+                          BenchVar,
+                          DemoItvDom,
+                          DomainKind::DemoMapDom,
+                          std::unordered_map< unsigned, DemoItvDom > >;
+/// @}
+
+/// \brief The i-th interval of the left operands, the right operands
+/// grow it so that joins and widenings change every entry.
+DemoItvDom make_lhs_itv(unsigned i) {
+    return {-static_cast< int >(i), static_cast< int >(i)};
+}
+DemoItvDom make_rhs_itv(unsigned i) {
+    return {-static_cast< int >(i) - 1, static_cast< int >(i) + 1};
+}
+
+/// \brief Make two map domains over the same `size` regions.
+template < typename Dom >
+std::pair< Dom, Dom > make_map_doms(unsigned size) {
+    const auto& regions = bench::BenchFunction::get(size).get_regions();
+    typename Dom::Map lhs;
+    typename Dom::Map rhs;
+    for (unsigned i = 0U; i < size; ++i) {
+        lhs.emplace(regions[i], make_lhs_itv(i));
+        rhs.emplace(regions[i], make_rhs_itv(i));
+    }
+    return {Dom(false, std::move(lhs)), Dom(false, std::move(rhs))};
+}
+
+/// \brief Make two numerical domains over the same `size` variables.
+template < typename Dom >
+std::pair< Dom, Dom > make_numerical_doms(unsigned size) {
+    typename Dom::Map lhs;
+    typename Dom::Map rhs;
+    for (unsigned i = 0U; i < size; ++i) {
+        lhs.emplace(i, make_lhs_itv(i));
+        rhs.emplace(i, make_rhs_itv(i));
+    }
+    return {Dom(false, false, std::move(lhs)),
+            Dom(false, false, std::move(rhs))};
+}
+
+/// \brief Make two interval environments over the same `size` variables.
+template < typename Dom >
+std::pair< Dom, Dom > make_env_doms(unsigned size) {
+    Dom lhs;
+    Dom rhs;
+    for (unsigned i = 0U; i < size; ++i) {
+        const auto bound = static_cast< int64_t >(i);
+        lhs.set_bounds(i, -bound, bound);
+        rhs.set_bounds(i, -bound - 1, bound + 1);
+    }
+    return {std::move(lhs), std::move(rhs)};
+}
+
+/// \brief Make two relational values over `size` variables related by
+/// pairs, which only differ on the first pair.
+template < typename Dom >
+std::pair< Dom, Dom > make_pair_doms(unsigned size) {
+    using LinearExpr = typename Dom::LinearExpr;
+    using LinearConstraint = typename Dom::LinearConstraint;
+    auto add_difference = [](Dom& dom, unsigned x, unsigned y, int64_t k) {
+        LinearExpr expr{ZNum(-k)};
+        expr.plus(ZNum(1), y);
+        expr.plus(ZNum(-1), x);
+        dom.add_linear_constraint(
+            LinearConstraint(std::move(expr),
+                             LinearConstraintKind::LCK_Inequality));
+    };
+    Dom lhs;
+    for (unsigned i = 0U; i + 1U < size; i += 2U) {
+        lhs.transfer_assign_constant(i, ZNum(i));
+        add_difference(lhs, i, i + 1U, static_cast< int64_t >(i));
+    }
+    Dom rhs = lhs;
+    add_difference(lhs, 0U, 1U, -1);
+    return {std::move(lhs), std::move(rhs)};
+}
+
+void bm_itv_join(benchmark::State& state) {
+    const auto lhs = make_lhs_itv(1U);
+    const auto rhs = make_rhs_itv(1U);
+    for (auto _ : state) {
+        auto val = lhs;
+        val.join_with(rhs);
+        benchmark::DoNotOptimize(val);
+    }
+}
+
+void bm_itv_widen(benchmark::State& state) {
+    const auto lhs = make_lhs_itv(1U);
+    const auto rhs = make_rhs_itv(1U);
+    for (auto _ : state) {
+        auto val = lhs;
+        val.widen_with(rhs);
+        benchmark::DoNotOptimize(val);
+    }
+}
+
+void bm_itv_leq(benchmark::State& state) {
+    const auto lhs = make_lhs_itv(1U);
+    const auto rhs = make_rhs_itv(1U);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs.leq(rhs));
+    }
+}
+
+template < typename Dom, auto MakeDoms >
+void bm_table_join(benchmark::State& state) {
+    const auto [lhs, rhs] = MakeDoms(static_cast< unsigned >(state.range(0)));
+    for (auto _ : state) {
+        Dom val = lhs;
+        val.join_with(rhs);
+        benchmark::DoNotOptimize(val);
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+template < typename Dom, auto MakeDoms >
+void bm_table_widen(benchmark::State& state) {
+    const auto [lhs, rhs] = MakeDoms(static_cast< unsigned >(state.range(0)));
+    for (auto _ : state) {
+        Dom val = lhs;
+        val.widen_with(rhs);
+        benchmark::DoNotOptimize(val);
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+template < typename Dom, auto MakeDoms >
+void bm_table_leq(benchmark::State& state) {
+    const auto [lhs, rhs] = MakeDoms(static_cast< unsigned >(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs.leq(rhs));
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+template < typename Dom, auto MakeDoms >
+void bm_table_clone(benchmark::State& state) {
+    const auto [lhs, rhs] = MakeDoms(static_cast< unsigned >(state.range(0)));
+    for (auto _ : state) {
+        const SharedVal val(lhs.clone());
+        benchmark::DoNotOptimize(val.get());
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+} // anonymous namespace
+
+BENCHMARK(bm_itv_join);
+BENCHMARK(bm_itv_widen);
+BENCHMARK(bm_itv_leq);
+
+// NOLINTBEGIN
+#define TABLE_BENCHMARK(BM, DOM, MAKE_DOMS)       \
+    BENCHMARK_TEMPLATE(BM, DOM, MAKE_DOMS< DOM >) \
+        ->RangeMultiplier(4)                      \
+        ->Range(8, 512)                           \
+        ->Complexity(benchmark::oN)
+
+TABLE_BENCHMARK(bm_table_join, DemoMapDomain, make_map_doms);
+TABLE_BENCHMARK(bm_table_widen, DemoMapDomain, make_map_doms);
+TABLE_BENCHMARK(bm_table_leq, DemoMapDomain, make_map_doms);
+TABLE_BENCHMARK(bm_table_clone, DemoMapDomain, make_map_doms);
+
+TABLE_BENCHMARK(bm_table_join, HashMapDomain, make_map_doms);
+TABLE_BENCHMARK(bm_table_widen, HashMapDomain, make_map_doms);
+TABLE_BENCHMARK(bm_table_leq, HashMapDomain, make_map_doms);
+TABLE_BENCHMARK(bm_table_clone, HashMapDomain, make_map_doms);
+
+TABLE_BENCHMARK(bm_table_join, BenchNumericalDom, make_numerical_doms);
+TABLE_BENCHMARK(bm_table_widen, BenchNumericalDom, make_numerical_doms);
+TABLE_BENCHMARK(bm_table_leq, BenchNumericalDom, make_numerical_doms);
+TABLE_BENCHMARK(bm_table_clone, BenchNumericalDom, make_numerical_doms);
+
+TABLE_BENCHMARK(bm_table_join, HashNumericalDom, make_numerical_doms);
+TABLE_BENCHMARK(bm_table_widen, HashNumericalDom, make_numerical_doms);
+TABLE_BENCHMARK(bm_table_leq, HashNumericalDom, make_numerical_doms);
+TABLE_BENCHMARK(bm_table_clone, HashNumericalDom, make_numerical_doms);
+
+TABLE_BENCHMARK(bm_table_join, IntervalEnvDom, make_env_doms);
+TABLE_BENCHMARK(bm_table_widen, IntervalEnvDom, make_env_doms);
+TABLE_BENCHMARK(bm_table_leq, IntervalEnvDom, make_env_doms);
+TABLE_BENCHMARK(bm_table_clone, IntervalEnvDom, make_env_doms);
+
+TABLE_BENCHMARK(bm_table_join, ZoneDom, make_pair_doms);
+TABLE_BENCHMARK(bm_table_widen, ZoneDom, make_pair_doms);
+TABLE_BENCHMARK(bm_table_leq, ZoneDom, make_pair_doms);
+TABLE_BENCHMARK(bm_table_clone, ZoneDom, make_pair_doms);
+
+TABLE_BENCHMARK(bm_table_join, PackedZoneDom, make_pair_doms);
+TABLE_BENCHMARK(bm_table_widen, PackedZoneDom, make_pair_doms);
+TABLE_BENCHMARK(bm_table_leq, PackedZoneDom, make_pair_doms);
+TABLE_BENCHMARK(bm_table_clone, PackedZoneDom, make_pair_doms);
+
+#undef TABLE_BENCHMARK
+// NOLINTEND
+
+} // namespace knight::dfa
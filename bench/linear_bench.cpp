@@ -0,0 +1,129 @@
+//===- linear_bench.cpp -----------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file benchmarks the linear expression arithmetic.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/constraint/linear.hpp"
+#include "util/znum.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+namespace knight::dfa {
+
+namespace {
+
+/// \brief A variable identified by its index.
+struct BenchVar {
+    using Ref = unsigned;
+}; // struct BenchVar
+
+template < typename Num >
+using BenchLinearExpr = LinearExpr< Num, BenchVar >;
+
+/// \brief Make `offset + sum(k * v_k)` over the given variables.
+template < typename Num >
+BenchLinearExpr< Num > make_expr(unsigned num_vars, unsigned offset) {
+    BenchLinearExpr< Num > expr(Num(static_cast< int64_t >(offset)));
+    for (unsigned i = 0U; i < num_vars; ++i) {
+        expr.plus(Num(static_cast< int64_t >(i + 1U)), offset + i);
+    }
+    return expr;
+}
+
+template < typename Num >
+void bm_linear_expr_build(benchmark::State& state) {
+    const auto num_vars = static_cast< unsigned >(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(make_expr< Num >(num_vars, 0U));
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+template < typename Num >
+void bm_linear_expr_add(benchmark::State& state) {
+    const auto num_vars = static_cast< unsigned >(state.range(0));
+    // Half of the variables are shared by both sides.
+    const auto lhs = make_expr< Num >(num_vars, 0U);
+    const auto rhs = make_expr< Num >(num_vars, num_vars / 2U);
+    for (auto _ : state) {
+        auto expr = lhs;
+        expr += rhs;
+        benchmark::DoNotOptimize(expr);
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+template < typename Num >
+void bm_linear_expr_sub_cancel(benchmark::State& state) {
+    const auto num_vars = static_cast< unsigned >(state.range(0));
+    const auto lhs = make_expr< Num >(num_vars, 0U);
+    for (auto _ : state) {
+        auto expr = lhs;
+        expr -= lhs;
+        benchmark::DoNotOptimize(expr.is_constant());
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+template < typename Num >
+void bm_linear_expr_scale(benchmark::State& state) {
+    const auto num_vars = static_cast< unsigned >(state.range(0));
+    const auto lhs = make_expr< Num >(num_vars, 0U);
+    for (auto _ : state) {
+        auto expr = lhs;
+        expr *= Num(3);
+        benchmark::DoNotOptimize(expr);
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+template < typename Num >
+void bm_linear_expr_factor_of(benchmark::State& state) {
+    const auto num_vars = static_cast< unsigned >(state.range(0));
+    const auto expr = make_expr< Num >(num_vars, 0U);
+    unsigned var = 0U;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(expr.get_factor_of(var));
+        var = (var + 1U) % num_vars;
+    }
+}
+
+} // anonymous namespace
+
+// NOLINTBEGIN
+#define LINEAR_BENCHMARK(BM, NUM) \
+    BENCHMARK_TEMPLATE(BM, NUM)   \
+        ->RangeMultiplier(4)      \
+        ->Range(2, 128)           \
+        ->Complexity(benchmark::oN)
+
+LINEAR_BENCHMARK(bm_linear_expr_build, int64_t);
+LINEAR_BENCHMARK(bm_linear_expr_add, int64_t);
+LINEAR_BENCHMARK(bm_linear_expr_sub_cancel, int64_t);
+LINEAR_BENCHMARK(bm_linear_expr_scale, int64_t);
+BENCHMARK_TEMPLATE(bm_linear_expr_factor_of, int64_t)
+    ->RangeMultiplier(4)
+    ->Range(2, 128);
+
+LINEAR_BENCHMARK(bm_linear_expr_build, ZNum);
+LINEAR_BENCHMARK(bm_linear_expr_add, ZNum);
+LINEAR_BENCHMARK(bm_linear_expr_sub_cancel, ZNum);
+LINEAR_BENCHMARK(bm_linear_expr_scale, ZNum);
+BENCHMARK_TEMPLATE(bm_linear_expr_factor_of, ZNum)
+    ->RangeMultiplier(4)
+    ->Range(2, 128);
+
+#undef LINEAR_BENCHMARK
+// NOLINTEND
+
+} // namespace knight::dfa
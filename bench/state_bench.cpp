@@ -0,0 +1,149 @@
+//===- state_bench.cpp ------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file benchmarks the program state operations and the region
+//  lookups.
+//
+//===------------------------------------------------------------------===//
+
+#include "bench_function.hpp"
+#include "dfa/domain/demo_dom.hpp"
+#include "dfa/domain/map/separate_numerical_domain.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+namespace knight::dfa {
+
+namespace {
+
+/// \brief A numerical variable identified by its index.
+struct BenchVar {
+    using Ref = unsigned;
+}; // struct BenchVar
+
+/// \brief A third domain, so that the states hold up to three values.
+using BenchNumericalDom = SeparateNumericalDom< int64_t,
+                                                BenchVar,
+                                                DemoItvDom,
+                                                DomainKind::DemoItvDom2 >;
+
+constexpr unsigned MaxNumDomains = 3U;
+
+/// \brief Make a state with `num_doms` domains, whose tables have `size`
+/// entries. The grown state is larger than the other one on each entry.
+ProgramStateRef make_state(const bench::BenchFunction& function,
+                           unsigned num_doms,
+                           unsigned size,
+                           bool grown) {
+    const int delta = grown ? 1 : 0;
+    auto state = function.get_state_manager().get_default_state();
+    state = state->set< DemoItvDom >(
+        make_shared_val< DemoItvDom >(-delta, static_cast< int >(size)));
+    if (num_doms >= 2U) {
+        DemoMapDomain::Map table;
+        for (unsigned i = 0U; i < size; ++i) {
+            table.emplace(function.get_regions()[i],
+                          DemoItvDom(-static_cast< int >(i) - delta,
+                                     static_cast< int >(i) + delta));
+        }
+        state = state->set< DemoMapDomain >(
+            make_shared_val< DemoMapDomain >(false, std::move(table)));
+    }
+    if (num_doms >= MaxNumDomains) {
+        BenchNumericalDom::Map table;
+        for (unsigned i = 0U; i < size; ++i) {
+            table.emplace(i,
+                          DemoItvDom(-static_cast< int >(i) - delta,
+                                     static_cast< int >(i) + delta));
+        }
+        state = state->set< BenchNumericalDom >(
+            make_shared_val< BenchNumericalDom >(false,
+                                                 false,
+                                                 std::move(table)));
+    }
+    return state;
+}
+
+void bm_state_set(benchmark::State& state) {
+    const auto num_doms = static_cast< unsigned >(state.range(0));
+    const auto size = static_cast< unsigned >(state.range(1));
+    const auto& function = bench::BenchFunction::get(size);
+    const auto base = make_state(function, num_doms, size, false);
+    int bound = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(base->set< DemoItvDom >(
+            make_shared_val< DemoItvDom >(0, ++bound)));
+    }
+}
+
+void bm_state_join(benchmark::State& state) {
+    const auto num_doms = static_cast< unsigned >(state.range(0));
+    const auto size = static_cast< unsigned >(state.range(1));
+    const auto& function = bench::BenchFunction::get(size);
+    const auto lhs = make_state(function, num_doms, size, false);
+    const auto rhs = make_state(function, num_doms, size, true);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs->join(rhs));
+    }
+}
+
+void bm_state_widen(benchmark::State& state) {
+    const auto num_doms = static_cast< unsigned >(state.range(0));
+    const auto size = static_cast< unsigned >(state.range(1));
+    const auto& function = bench::BenchFunction::get(size);
+    const auto lhs = make_state(function, num_doms, size, false);
+    const auto rhs = make_state(function, num_doms, size, true);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs->widen(rhs));
+    }
+}
+
+void bm_state_leq(benchmark::State& state) {
+    const auto num_doms = static_cast< unsigned >(state.range(0));
+    const auto size = static_cast< unsigned >(state.range(1));
+    const auto& function = bench::BenchFunction::get(size);
+    const auto lhs = make_state(function, num_doms, size, false);
+    const auto rhs = make_state(function, num_doms, size, true);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs->leq(*rhs));
+    }
+}
+
+void bm_region_lookup(benchmark::State& state) {
+    const auto size = static_cast< unsigned >(state.range(0));
+    const auto& function = bench::BenchFunction::get(size);
+    auto& region_mgr = function.get_region_manager();
+    const auto& vars = function.get_vars();
+    unsigned idx = 0U;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            region_mgr.get_region(vars[idx], function.get_frame()));
+        idx = (idx + 1U) % size;
+    }
+}
+
+void state_args(benchmark::internal::Benchmark* bm) {
+    for (unsigned num_doms = 1U; num_doms <= MaxNumDomains; ++num_doms) {
+        for (int size = 8; size <= 512; size *= 4) { // NOLINT
+            bm->Args({num_doms, size});
+        }
+    }
+}
+
+} // anonymous namespace
+
+BENCHMARK(bm_state_set)->Apply(state_args);
+BENCHMARK(bm_state_join)->Apply(state_args);
+BENCHMARK(bm_state_widen)->Apply(state_args);
+BENCHMARK(bm_state_leq)->Apply(state_args);
+BENCHMARK(bm_region_lookup)->RangeMultiplier(4)->Range(8, 512);
+
+} // namespace knight::dfa
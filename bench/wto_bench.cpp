@@ -0,0 +1,111 @@
+//===- wto_bench.cpp --------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file benchmarks the weak topological order construction on
+//  synthetic control flow graphs.
+//
+//===------------------------------------------------------------------===//
+
+#include "support/graph.hpp"
+#include "util/wto.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+namespace knight {
+
+namespace {
+
+/// \brief Blocks per inner loop of the synthetic graphs.
+constexpr unsigned InnerLoopSize = 8U;
+/// \brief Inner loops per outer loop of the synthetic graphs.
+constexpr unsigned OuterLoopSize = 8U;
+
+struct SyntheticNode {
+    unsigned id;
+    std::vector< const SyntheticNode* > succs;
+    std::vector< const SyntheticNode* > preds;
+}; // struct SyntheticNode
+
+/// \brief A chain of outer loops, each one nesting a chain of inner loops
+/// whose bodies branch into a diamond.
+class SyntheticGraph {
+  public:
+    using GraphRef = const SyntheticGraph*;
+    using NodeRef = const SyntheticNode*;
+    using SuccNodeIterator = std::vector< NodeRef >::const_iterator;
+    using PredNodeIterator = std::vector< NodeRef >::const_iterator;
+
+  private:
+    std::vector< std::unique_ptr< SyntheticNode > > m_nodes;
+
+  public:
+    explicit SyntheticGraph(unsigned num_nodes) {
+        m_nodes.reserve(num_nodes);
+        for (unsigned i = 0U; i < num_nodes; ++i) {
+            m_nodes.push_back(
+                std::make_unique< SyntheticNode >(SyntheticNode{i, {}, {}}));
+        }
+        for (unsigned i = 0U; i + 1U < num_nodes; ++i) {
+            add_edge(i, i + 1U);
+            // Diamond in the middle of each inner loop.
+            if (i % InnerLoopSize == 2U && i + 2U < num_nodes) {
+                add_edge(i, i + 2U);
+            }
+            if (i % InnerLoopSize == InnerLoopSize - 1U) {
+                add_edge(i, i + 1U - InnerLoopSize);
+            }
+            if (i % (InnerLoopSize * OuterLoopSize) ==
+                InnerLoopSize * OuterLoopSize - 1U) {
+                add_edge(i, i + 1U - InnerLoopSize * OuterLoopSize);
+            }
+        }
+    }
+
+  private:
+    void add_edge(unsigned src, unsigned dst) {
+        m_nodes[src]->succs.push_back(m_nodes[dst].get());
+        m_nodes[dst]->preds.push_back(m_nodes[src].get());
+    }
+
+  public:
+    static NodeRef entry(GraphRef graph) { return graph->m_nodes[0].get(); }
+    static SuccNodeIterator succ_begin(NodeRef node) {
+        return node->succs.begin();
+    }
+    static SuccNodeIterator succ_end(NodeRef node) { return node->succs.end(); }
+    static PredNodeIterator pred_begin(NodeRef node) {
+        return node->preds.begin();
+    }
+    static PredNodeIterator pred_end(NodeRef node) { return node->preds.end(); }
+    static unsigned index(NodeRef node) { return node->id; }
+    static unsigned num_nodes(GraphRef graph) {
+        return static_cast< unsigned >(graph->m_nodes.size());
+    }
+}; // class SyntheticGraph
+
+void bm_wto_build(benchmark::State& state) {
+    const SyntheticGraph graph(static_cast< unsigned >(state.range(0)));
+    for (auto _ : state) {
+        const Wto< SyntheticGraph, GraphTrait< SyntheticGraph > > wto(&graph);
+        benchmark::DoNotOptimize(&wto);
+    }
+    state.SetComplexityN(state.range(0));
+}
+
+} // anonymous namespace
+
+BENCHMARK(bm_wto_build)
+    ->RangeMultiplier(8)
+    ->Range(64, 1 << 18)
+    ->Complexity(benchmark::oN);
+
+} // namespace knight
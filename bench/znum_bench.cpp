@@ -0,0 +1,107 @@
+//===- znum_bench.cpp -------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file benchmarks the arbitrary precision integers against the
+//  machine integers.
+//
+//===------------------------------------------------------------------===//
+
+#include "util/znum.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace knight {
+
+namespace {
+
+constexpr unsigned NumOperands = 1024U;
+constexpr int64_t SmallRange = 1 << 20;
+
+/// \brief Make random operands, small enough to never overflow when they
+/// are combined pairwise, so that only the fast path is taken.
+template < typename Num >
+std::vector< Num > make_small_operands() {
+    std::mt19937_64 rng(NumOperands);
+    std::uniform_int_distribution< int64_t > dist(-SmallRange, SmallRange);
+    std::vector< Num > operands;
+    operands.reserve(NumOperands);
+    for (unsigned i = 0U; i < NumOperands; ++i) {
+        operands.emplace_back(dist(rng));
+    }
+    return operands;
+}
+
+template < typename Num >
+void bm_num_add(benchmark::State& state) {
+    const auto operands = make_small_operands< Num >();
+    for (auto _ : state) {
+        for (unsigned i = 1U; i < NumOperands; ++i) {
+            benchmark::DoNotOptimize(operands[i - 1U] + operands[i]);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * (NumOperands - 1U));
+}
+
+template < typename Num >
+void bm_num_mul(benchmark::State& state) {
+    const auto operands = make_small_operands< Num >();
+    for (auto _ : state) {
+        for (unsigned i = 1U; i < NumOperands; ++i) {
+            benchmark::DoNotOptimize(operands[i - 1U] * operands[i]);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * (NumOperands - 1U));
+}
+
+template < typename Num >
+void bm_num_compare(benchmark::State& state) {
+    const auto operands = make_small_operands< Num >();
+    for (auto _ : state) {
+        for (unsigned i = 1U; i < NumOperands; ++i) {
+            benchmark::DoNotOptimize(operands[i - 1U] < operands[i]);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * (NumOperands - 1U));
+}
+
+/// \brief The slow path, adding two numbers overflowing 64 bits.
+void bm_znum_add_big(benchmark::State& state) {
+    const ZNum lhs = ZNum(std::numeric_limits< int64_t >::max()) * 4;
+    const ZNum rhs = ZNum(std::numeric_limits< int64_t >::min()) * 2;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs + rhs);
+    }
+}
+
+/// \brief The overflow from the fast path to the slow path.
+void bm_znum_add_overflow(benchmark::State& state) {
+    const ZNum lhs = std::numeric_limits< int64_t >::max();
+    const ZNum rhs = 1;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lhs + rhs);
+    }
+}
+
+} // anonymous namespace
+
+BENCHMARK_TEMPLATE(bm_num_add, int64_t);
+BENCHMARK_TEMPLATE(bm_num_add, ZNum);
+BENCHMARK_TEMPLATE(bm_num_mul, int64_t);
+BENCHMARK_TEMPLATE(bm_num_mul, ZNum);
+BENCHMARK_TEMPLATE(bm_num_compare, int64_t);
+BENCHMARK_TEMPLATE(bm_num_compare, ZNum);
+BENCHMARK(bm_znum_add_big);
+BENCHMARK(bm_znum_add_overflow);
+
+} // namespace knight
@@ -22,6 +22,7 @@ if(NOT LINK_CLANG_DYLIB AND NOT ${CLANG_LIBS})
     clangAST
     clangASTMatchers
     clangBasic
+    clangCrossTU
     clangDriver
     clangFrontend
     clangRewrite
@@ -15,6 +15,9 @@
 
 #include <llvm/ADT/StringRef.h>
 
+#include <algorithm>
+#include <cstddef>
+
 #ifdef ANALYSIS_DEF
 #    undef ANALYSIS_DEF
 #endif
@@ -29,6 +32,15 @@ enum class AnalysisKind {
 #include "analyses.def"
 }; // enum class AnalysisKind
 
+/// \brief The number of the analysis IDs, which are dense from 0 and
+/// index the bitsets of the analyses.
+constexpr std::size_t NumAnalysisIDs = std::max< std::size_t >({
+    1U,
+#undef ANALYSIS_DEF
+#define ANALYSIS_DEF(KIND, NAME, ID, DESC) static_cast< std::size_t >(ID) + 1U,
+#include "analyses.def"
+});
+
 inline llvm::StringRef get_analysis_name(AnalysisKind kind) {
     switch (kind) {
 #undef ANALYSIS_DEF
@@ -34,7 +34,7 @@ class AnalysisBase;
 ///        (more callbacks accpeted...) > {
 ///
 ///    /// \brief delegate to the Analysis constructor
-///    MyAnalysisImpl(KnightContext& ctx, (more args...))
+///    MyAnalysisImpl(KnightTUContext& ctx, (more args...))
 ///         : Analysis(ctx) {
 ///       // ...
 ///    }
@@ -64,7 +64,7 @@ class AnalysisBase;
 ///
 ///    /// \brief register your analysis to manager here.
 ///    static UniqueAnalysisRef register_analysis(AnalysisManager& mgr,
-///                                             KnightContext& ctx) {
+///                                             KnightTUContext& ctx) {
 ///        return mgr.register_analysis< MyAnalysisImpl >(ctx, (more ctor
 ///        args...));
 ///    }
@@ -76,7 +76,7 @@ class AnalysisBase {
     AnalysisKind kind;
 
   public:
-    AnalysisBase(KnightContext& ctx, AnalysisKind k);
+    AnalysisBase(KnightTUContext& ctx, AnalysisKind k);
     virtual ~AnalysisBase() = default;
     virtual bool is_language_supported(
         const clang::LangOptions& lang_opts) const {
@@ -96,31 +96,78 @@ class AnalysisBase {
     clang::DiagnosticBuilder diagnose(
         clang::DiagnosticIDs::Level diag_level = clang::DiagnosticIDs::Warning);
 
-    KnightContext& get_knight_context() { return m_ctx; }
+    KnightTUContext& get_knight_context() { return m_ctx; }
 
   private:
-    KnightContext& m_ctx;
+    KnightTUContext& m_ctx;
 }; // class AnalysisBase
 
+namespace internal {
+
+/// \brief Run the stmt callback of the analysis directly, if the callback
+/// visits stmts.
+template < typename Impl, typename CB >
+void dispatch_stmt_callback(const Impl* analysis,
+                            StmtRef S,
+                            VisitStmtKind kind,
+                            AnalysisContext& C) {
+    if constexpr (requires {
+                      CB::template dispatch_stmt< Impl >(analysis, S, kind, C);
+                  }) {
+        CB::template dispatch_stmt< Impl >(analysis, S, kind, C);
+    }
+}
+
+} // namespace internal
+
 template < typename Impl, typename ANALYSIS1, typename... ANALYSES >
 class Analysis : public ANALYSIS1, public ANALYSES..., public AnalysisBase {
   public:
-    Analysis(KnightContext& ctx) : AnalysisBase(ctx, Impl::get_kind()) {}
+    Analysis(KnightTUContext& ctx) : AnalysisBase(ctx, Impl::get_kind()) {}
 
     static void register_callback(Impl* analysis, AnalysisManager& mgr) {
         ANALYSIS1::register_callback(analysis, mgr);
         Analysis< Impl, ANALYSES... >::register_callback(analysis, mgr);
     }
+
+    /// \brief Run the stmt callbacks without the type-erased dispatch,
+    /// used by the static analysis pipeline.
+    static void dispatch_stmt(const Impl* analysis,
+                              internal::StmtRef S,
+                              internal::VisitStmtKind kind,
+                              AnalysisContext& C) {
+        internal::dispatch_stmt_callback< Impl, ANALYSIS1 >(analysis,
+                                                            S,
+                                                            kind,
+                                                            C);
+        (internal::dispatch_stmt_callback< Impl, ANALYSES >(analysis,
+                                                            S,
+                                                            kind,
+                                                            C),
+         ...);
+    }
 };
 
 template < typename Impl, typename ANALYSIS1 >
 class Analysis< Impl, ANALYSIS1 > : public ANALYSIS1, public AnalysisBase {
   public:
-    Analysis(KnightContext& ctx) : AnalysisBase(ctx, Impl::get_kind()) {}
+    Analysis(KnightTUContext& ctx) : AnalysisBase(ctx, Impl::get_kind()) {}
 
     static void register_callback(Impl* analysis, AnalysisManager& mgr) {
         ANALYSIS1::register_callback(analysis, mgr);
     }
+
+    /// \brief Run the stmt callbacks without the type-erased dispatch,
+    /// used by the static analysis pipeline.
+    static void dispatch_stmt(const Impl* analysis,
+                              internal::StmtRef S,
+                              internal::VisitStmtKind kind,
+                              AnalysisContext& C) {
+        internal::dispatch_stmt_callback< Impl, ANALYSIS1 >(analysis,
+                                                            S,
+                                                            kind,
+                                                            C);
+    }
 };
 
 //=------------------- Callback Registration -------------------=//
@@ -185,6 +232,15 @@ class PreStmt {
                               internal::VisitStmtKind::Pre);
     }
 
+    template < typename ANALYSIS >
+    static void dispatch_stmt(const ANALYSIS* analysis,
+                              internal::StmtRef S,
+                              internal::VisitStmtKind kind,
+                              AnalysisContext& C) {
+        if (kind == internal::VisitStmtKind::Pre && isa< STMT >(S)) {
+            analysis->pre_analyze_stmt(cast< STMT >(S), C);
+        }
+    }
 }; // class PreStmt
 
 template < clang_stmt STMT >
@@ -211,6 +267,16 @@ class EvalStmt {
                               is_interesting_stmt,
                               internal::VisitStmtKind::Eval);
     }
+
+    template < typename ANALYSIS >
+    static void dispatch_stmt(const ANALYSIS* analysis,
+                              internal::StmtRef S,
+                              internal::VisitStmtKind kind,
+                              AnalysisContext& C) {
+        if (kind == internal::VisitStmtKind::Eval && isa< STMT >(S)) {
+            analysis->analyze_stmt(cast< STMT >(S), C);
+        }
+    }
 }; // class EvalStmt
 
 template < clang_stmt STMT >
@@ -237,6 +303,16 @@ class PostStmt {
                               is_interesting_stmt,
                               internal::VisitStmtKind::Post);
     }
+
+    template < typename ANALYSIS >
+    static void dispatch_stmt(const ANALYSIS* analysis,
+                              internal::StmtRef S,
+                              internal::VisitStmtKind kind,
+                              AnalysisContext& C) {
+        if (kind == internal::VisitStmtKind::Post && isa< STMT >(S)) {
+            analysis->post_analyze_stmt(cast< STMT >(S), C);
+        }
+    }
 }; // class PostStmt
 
 } // namespace analyze
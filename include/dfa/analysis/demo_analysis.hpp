@@ -15,6 +15,7 @@
 
 #include "dfa/analysis/analysis_base.hpp"
 #include "dfa/analysis_context.hpp"
+#include "dfa/ast_lock.hpp"
 #include "dfa/domain/demo_dom.hpp"
 #include "dfa/region/region.hpp"
 #include "tooling/context.hpp"
@@ -31,7 +32,7 @@ class DemoAnalysis : public Analysis< DemoAnalysis,
                                       analyze::PreStmt< clang::ReturnStmt >,
                                       analyze::PreStmt< clang::DeclStmt > > {
   public:
-    explicit DemoAnalysis(KnightContext& ctx) : Analysis(ctx) {}
+    explicit DemoAnalysis(KnightTUContext& ctx) : Analysis(ctx) {}
 
     [[nodiscard]] static AnalysisKind get_kind() {
         return AnalysisKind::DemoAnalysis;
@@ -75,8 +76,12 @@ class DemoAnalysis : public Analysis< DemoAnalysis,
             }
 
             clang::Expr::EvalResult eval_int_res;
-            bool can_eval_int =
-                init_expr->EvaluateAsInt(eval_int_res, ctx.get_ast_context());
+            bool can_eval_int = false;
+            {
+                ASTLock lock(ctx.get_ast_context());
+                can_eval_int = init_expr->EvaluateAsInt(eval_int_res,
+                                                        ctx.get_ast_context());
+            }
             if (!can_eval_int) {
                 continue;
             }
@@ -139,7 +144,7 @@ class DemoAnalysis : public Analysis< DemoAnalysis,
     }
 
     static UniqueAnalysisRef register_analysis(AnalysisManager& mgr,
-                                               KnightContext& ctx) {
+                                               KnightTUContext& ctx) {
         return mgr.register_analysis< DemoAnalysis >(ctx);
     }
 
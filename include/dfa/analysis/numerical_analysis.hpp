@@ -0,0 +1,295 @@
+//===- numerical_analysis.hpp -----------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the numerical analysis of the integer variables.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/analysis/analysis_base.hpp"
+#include "dfa/analysis_context.hpp"
+#include "dfa/domain/numerical/product_dom.hpp"
+#include "dfa/engine/condition_refiner.hpp"
+#include "dfa/region/region.hpp"
+#include "tooling/context.hpp"
+
+#include <clang/AST/Decl.h>
+#include <clang/AST/DeclCXX.h>
+#include <clang/AST/Expr.h>
+#include <clang/AST/ExprCXX.h>
+#include <clang/AST/Stmt.h>
+
+#include <optional>
+
+namespace knight::dfa {
+
+/// \brief Whether the call is to a `knight_` debug builtin, which only
+/// inspects the state of the analysis and changes no variable.
+[[nodiscard]] inline bool is_knight_builtin(const clang::CallExpr* call) {
+    const auto* callee =
+        llvm::dyn_cast_or_null< clang::FunctionDecl >(call->getCalleeDecl());
+    return callee != nullptr && callee->getIdentifier() != nullptr &&
+           !callee->hasBody() && callee->getName().starts_with("knight_");
+}
+
+/// \brief Tracks the integer variables in the numerical product, which
+/// the branch conditions refine.
+///
+/// The direct writes of the non-volatile integer variables assign their
+/// linear values, or forget them. The variables may only be written
+/// otherwise through the memory or by the code that runs on the calls,
+/// the constructions and the allocations, which set the product to top
+/// since their targets are unknown.
+class NumericalAnalysis
+    : public Analysis< NumericalAnalysis,
+                       analyze::PostStmt< clang::DeclStmt >,
+                       analyze::PostStmt< clang::BinaryOperator >,
+                       analyze::PostStmt< clang::UnaryOperator >,
+                       analyze::PostStmt< clang::CallExpr >,
+                       analyze::PostStmt< clang::CXXConstructExpr >,
+                       analyze::PostStmt< clang::CXXNewExpr >,
+                       analyze::PostStmt< clang::CXXDeleteExpr > > {
+  public:
+    using LinearExpr = ConditionRefiner::LinearExpr;
+
+  public:
+    explicit NumericalAnalysis(KnightTUContext& ctx) : Analysis(ctx) {}
+
+    [[nodiscard]] static AnalysisKind get_kind() {
+        return AnalysisKind::NumericalAnalysis;
+    }
+
+    // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
+    void post_analyze_stmt(const clang::DeclStmt* decl_stmt,
+                           AnalysisContext& ctx) const {
+        for (const auto* decl : decl_stmt->decls()) {
+            const auto* var = llvm::dyn_cast< clang::VarDecl >(decl);
+            // The static locals are only initialized once.
+            if (var == nullptr || !var->hasLocalStorage() ||
+                !var->getType()->isIntegerType()) {
+                continue;
+            }
+            assign(var, var->getInit(), ctx);
+        }
+    }
+
+    // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
+    void post_analyze_stmt(const clang::BinaryOperator* binary_op,
+                           AnalysisContext& ctx) const {
+        if (!binary_op->isAssignmentOp()) {
+            return;
+        }
+        const auto* var = get_written_var(binary_op->getLHS(), ctx);
+        if (var == nullptr) {
+            return;
+        }
+        switch (binary_op->getOpcode()) {
+            case clang::BO_Assign:
+                assign(var, binary_op->getRHS(), ctx);
+                return;
+            case clang::BO_AddAssign:
+            case clang::BO_SubAssign:
+                break;
+            default:
+                assign_linear_expr(var, std::nullopt, ctx);
+                return;
+        }
+        // `x += e` converts `x + e` back to the type of `x`, which
+        // wraps around if `x + e` is computed in a wider type.
+        const auto* compound_op =
+            llvm::cast< clang::CompoundAssignOperator >(binary_op);
+        auto expr = std::optional< LinearExpr >{};
+        if (is_exact_arithmetic(var, ctx) &&
+            ctx.get_ast_context()
+                .hasSameUnqualifiedType(compound_op
+                                            ->getComputationResultType(),
+                                        var->getType())) {
+            expr = make_refiner(ctx).linearize(binary_op->getRHS());
+        }
+        if (expr && binary_op->getOpcode() == clang::BO_SubAssign) {
+            *expr = -std::move(*expr);
+        }
+        if (expr) {
+            *expr += LinearExpr(get_var_id(var, ctx));
+        }
+        assign_linear_expr(var, std::move(expr), ctx);
+    }
+
+    // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
+    void post_analyze_stmt(const clang::UnaryOperator* unary_op,
+                           AnalysisContext& ctx) const {
+        if (!unary_op->isIncrementDecrementOp()) {
+            return;
+        }
+        const auto* var = get_written_var(unary_op->getSubExpr(), ctx);
+        if (var == nullptr) {
+            return;
+        }
+        auto expr = std::optional< LinearExpr >{};
+        if (is_exact_arithmetic(var, ctx)) {
+            expr = LinearExpr(get_var_id(var, ctx));
+            *expr += ZNum(unary_op->isIncrementOp() ? 1 : -1);
+        }
+        assign_linear_expr(var, std::move(expr), ctx);
+    }
+
+    // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
+    void post_analyze_stmt(const clang::CallExpr* call,
+                           AnalysisContext& ctx) const {
+        if (!is_knight_builtin(call)) {
+            set_to_top(ctx);
+        }
+    }
+
+    /// \brief The constructor may write the variables bound to its
+    /// reference or pointer arguments, or any escaped one.
+    // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
+    void post_analyze_stmt(const clang::CXXConstructExpr* construct,
+                           AnalysisContext& ctx) const {
+        if (!construct->getConstructor()->isTrivial()) {
+            set_to_top(ctx);
+        }
+    }
+
+    /// \brief The allocation function and the initializer may write any
+    /// escaped variable.
+    // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
+    void post_analyze_stmt([[maybe_unused]] const clang::CXXNewExpr* new_expr,
+                           AnalysisContext& ctx) const {
+        set_to_top(ctx);
+    }
+
+    /// \brief The destructor and the deallocation function may write any
+    /// escaped variable.
+    // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
+    void post_analyze_stmt(
+        [[maybe_unused]] const clang::CXXDeleteExpr* delete_expr,
+        AnalysisContext& ctx) const {
+        set_to_top(ctx);
+    }
+
+    static void add_dependencies(AnalysisManager& mgr) {
+        mgr.add_domain_dependency< NumericalAnalysis, NumericalProductDom >();
+    }
+
+    static UniqueAnalysisRef register_analysis(AnalysisManager& mgr,
+                                               KnightTUContext& ctx) {
+        return mgr.register_analysis< NumericalAnalysis >(ctx);
+    }
+
+  private:
+    [[nodiscard]] static ConditionRefiner make_refiner(
+        const AnalysisContext& ctx) {
+        return {ctx.get_region_manager(),
+                ctx.get_state()->get_state_manager().get_var_index(),
+                ctx.get_current_stack_frame()};
+    }
+
+    [[nodiscard]] static DenseVarID get_var_id(const clang::VarDecl* var,
+                                               const AnalysisContext& ctx) {
+        const auto* region =
+            ctx.get_region_manager().get_region(var,
+                                                ctx.get_current_stack_frame());
+        return ctx.get_state()->get_state_manager().get_var_index().get_id(
+            region);
+    }
+
+    /// \brief Whether the arithmetic of the variable does not wrap around,
+    /// i.e., it is signed and not promoted to a wider type.
+    [[nodiscard]] static bool is_exact_arithmetic(
+        const clang::VarDecl* var, const AnalysisContext& ctx) {
+        const auto type = var->getType();
+        return type->isSignedIntegerOrEnumerationType() &&
+               !ctx.get_ast_context().isPromotableIntegerType(type);
+    }
+
+    /// \brief Get the tracked variable written by the lvalue directly.
+    ///
+    /// The objects of the other variables, e.g., the arrays and the
+    /// structs, cannot overlap the tracked variables, hence their
+    /// elements and fields are written without changing the product.
+    /// The writes through the memory set the product to top.
+    ///
+    /// \return null if the write does not change a tracked variable.
+    [[nodiscard]] static const clang::VarDecl* get_written_var(
+        const clang::Expr* lvalue, AnalysisContext& ctx) {
+        const auto* expr = lvalue->IgnoreParens();
+        while (true) {
+            if (const auto* member = llvm::dyn_cast< clang::MemberExpr >(expr);
+                member != nullptr && !member->isArrow()) {
+                expr = member->getBase()->IgnoreParens();
+                continue;
+            }
+            const auto* subscript =
+                llvm::dyn_cast< clang::ArraySubscriptExpr >(expr);
+            if (subscript != nullptr &&
+                subscript->getBase()->IgnoreParenImpCasts()->getType()
+                    ->isArrayType()) {
+                expr = subscript->getBase()->IgnoreParenImpCasts();
+                continue;
+            }
+            break;
+        }
+        const auto* decl_ref = llvm::dyn_cast< clang::DeclRefExpr >(expr);
+        const auto* var = decl_ref == nullptr
+                              ? nullptr
+                              : llvm::dyn_cast< clang::VarDecl >(
+                                    decl_ref->getDecl());
+        if (var == nullptr || var->getType()->isReferenceType()) {
+            set_to_top(ctx);
+            return nullptr;
+        }
+        if (expr != lvalue->IgnoreParens() ||
+            !var->getType()->isIntegerType()) {
+            return nullptr;
+        }
+        return var;
+    }
+
+    /// \brief Assign the value of the initializer to the variable, or
+    /// forget it if the value is not linear.
+    static void assign(const clang::VarDecl* var,
+                       const clang::Expr* init,
+                       AnalysisContext& ctx) {
+        auto expr = std::optional< LinearExpr >{};
+        if (init != nullptr && var->getType()->isIntegerType()) {
+            expr = make_refiner(ctx).linearize(init);
+        }
+        assign_linear_expr(var, std::move(expr), ctx);
+    }
+
+    static void assign_linear_expr(const clang::VarDecl* var,
+                                   std::optional< LinearExpr > expr,
+                                   AnalysisContext& ctx) {
+        auto state = ctx.get_state();
+        if (state->is_bottom() || var->getType().isVolatileQualified()) {
+            return;
+        }
+        auto product = state->get_clone< NumericalProductDom >();
+        const DenseVarID id = get_var_id(var, ctx);
+        if (expr) {
+            product->transfer_assign_linear_expr(id, *expr);
+        } else {
+            product->forget(id);
+        }
+        ctx.set_state(state->set< NumericalProductDom >(product));
+    }
+
+    static void set_to_top(AnalysisContext& ctx) {
+        auto state = ctx.get_state();
+        if (state->is_bottom()) {
+            return;
+        }
+        ctx.set_state(state->set< NumericalProductDom >(
+            NumericalProductDom::default_val()));
+    }
+}; // class NumericalAnalysis
+
+} // namespace knight::dfa
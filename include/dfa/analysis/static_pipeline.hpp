@@ -0,0 +1,105 @@
+//===- static_pipeline.hpp --------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the pipeline of the statically dispatched analyses.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/analysis/analyses.hpp"
+#include "dfa/analysis/demo_analysis.hpp"
+#include "dfa/analysis/numerical_analysis.hpp"
+#include "dfa/analysis/symbol_resolver.hpp"
+#include "dfa/analysis_manager.hpp"
+
+#include <array>
+#include <tuple>
+#include <type_traits>
+
+namespace knight::dfa {
+
+namespace internal {
+
+template < typename T >
+struct TypeTag {
+    using type = T;
+}; // struct TypeTag
+
+/// \brief The tags of the analyses in the `STATIC_ANALYSIS_DEF` entries
+/// of analyses.def, in their order.
+inline constexpr auto StaticAnalysisTags = std::tuple_cat(
+#undef ANALYSIS_DEF
+#undef STATIC_ANALYSIS_DEF
+#define STATIC_ANALYSIS_DEF(KIND) std::tuple< TypeTag< KIND > >{},
+#include "analyses.def"
+    std::tuple<>{});
+
+template < typename Tags >
+class StaticAnalysisPipelineImpl;
+
+template < typename... Analyses >
+class StaticAnalysisPipelineImpl< std::tuple< TypeTag< Analyses >... > > {
+  private:
+    /// \brief The bound analyses, null if not required.
+    std::tuple< const Analyses*... > m_analyses{};
+
+  public:
+    [[nodiscard]] static bool contains(AnalysisID id) {
+        return ((id == get_analysis_id(Analyses::get_kind())) || ...);
+    }
+
+    /// \brief Get the IDs of the analyses in their dispatch order.
+    [[nodiscard]] static std::array< AnalysisID, sizeof...(Analyses) >
+    get_ids() {
+        return {get_analysis_id(Analyses::get_kind())...};
+    }
+
+    /// \brief Bind the analyses given by `get_analysis(id)`, which returns
+    /// null for the ones not to run.
+    template < typename GetAnalysisFn >
+    void bind(GetAnalysisFn&& get_analysis) {
+        ((std::get< const Analyses* >(m_analyses) =
+              static_cast< const Analyses* >(
+                  get_analysis(get_analysis_id(Analyses::get_kind())))),
+         ...);
+    }
+
+    /// \brief Run the stmt callbacks of the bound analyses, which the
+    /// compiler can inline as no call goes through a function pointer.
+    void run_stmt(StmtRef stmt,
+                  VisitStmtKind visit_kind,
+                  AnalysisContext& analysis_ctx) const {
+        (run_stmt_of< Analyses >(stmt, visit_kind, analysis_ctx), ...);
+    }
+
+  private:
+    template < typename ANALYSIS >
+    void run_stmt_of(StmtRef stmt,
+                     VisitStmtKind visit_kind,
+                     AnalysisContext& analysis_ctx) const {
+        const auto* analysis = std::get< const ANALYSIS* >(m_analyses);
+        if (analysis != nullptr) {
+            ANALYSIS::dispatch_stmt(analysis, stmt, visit_kind, analysis_ctx);
+        }
+    }
+}; // class StaticAnalysisPipelineImpl
+
+} // namespace internal
+
+/// \brief The stmt dispatch of the analyses known at compile time.
+///
+/// The analyses of the other modules, e.g. the plugins registered to
+/// `KnightModuleRegistry`, keep the dynamic dispatch and run after them.
+class StaticAnalysisPipeline
+    : public internal::StaticAnalysisPipelineImpl<
+          std::remove_cvref_t< decltype(internal::StaticAnalysisTags) > > {
+}; // class StaticAnalysisPipeline
+
+} // namespace knight::dfa
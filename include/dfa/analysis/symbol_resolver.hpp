@@ -35,7 +35,7 @@ class SymbolResolver
     mutable AnalysisContext* m_ctx{};
 
   public:
-    explicit SymbolResolver(KnightContext& ctx) : Analysis(ctx) {
+    explicit SymbolResolver(KnightTUContext& ctx) : Analysis(ctx) {
         llvm::outs() << "SymbolResolver constructor\n";
     }
 
@@ -96,7 +96,7 @@ class SymbolResolver
     }
 
     static UniqueAnalysisRef register_analysis(AnalysisManager& mgr,
-                                               KnightContext& ctx) {
+                                               KnightTUContext& ctx) {
         mgr.set_analysis_priviledged< SymbolResolver >();
         return mgr.register_analysis< SymbolResolver >(ctx);
     }
@@ -20,7 +20,7 @@
 
 namespace knight {
 
-class KnightContext;
+class KnightTUContext;
 
 namespace dfa {
 
@@ -29,16 +29,17 @@ class RegionManager;
 
 class AnalysisContext {
   private:
-    KnightContext& m_ctx;
+    KnightTUContext& m_ctx;
     const StackFrame* m_frame{nullptr};
     ProgramStateRef m_state{nullptr};
     RegionManager& m_region_manager;
 
   public:
-    explicit AnalysisContext(KnightContext& ctx, RegionManager& region_manager);
+    explicit AnalysisContext(KnightTUContext& ctx,
+                             RegionManager& region_manager);
 
     [[nodiscard]] RegionManager& get_region_manager() const;
-    [[nodiscard]] KnightContext& get_knight_context() const { return m_ctx; }
+    [[nodiscard]] KnightTUContext& get_knight_context() const { return m_ctx; }
     [[nodiscard]] clang::ASTContext& get_ast_context() const;
     [[nodiscard]] clang::SourceManager& get_source_manager() const;
     [[nodiscard]] const clang::Decl* get_current_decl() const;
@@ -17,13 +17,16 @@
 #include "dfa/domain/dom_base.hpp"
 #include "dfa/proc_cfg.hpp"
 #include "dfa/region/region.hpp"
+#include "dfa/symbol_manager.hpp"
 #include "tooling/context.hpp"
 #include "util/assert.hpp"
+#include "util/id_set.hpp"
 
 #include <llvm/Support/raw_ostream.h>
 
+#include <array>
 #include <memory>
-#include <unordered_set>
+#include <unordered_map>
 
 namespace knight::dfa {
 
@@ -34,7 +37,8 @@ using UniqueAnalysisRef = std::unique_ptr< AnalysisBase >;
 using AnalysisRef = AnalysisBase*;
 using AnalysisRefs = std::vector< AnalysisRef >;
 
-using AnalysisIDSet = std::unordered_set< AnalysisID >;
+using AnalysisIDSet = IDSet< AnalysisID, NumAnalysisIDs >;
+using DomIDSet = IDSet< DomID, NumDomIDs >;
 using AnalysisNameRef = llvm::StringRef;
 
 template < typename T >
@@ -76,6 +80,15 @@ using AnalyzeEndFunctionCallBack =
 using AnalyzeStmtCallBack = AnalysisCallBack< void(StmtRef, AnalysisContext&) >;
 using MatchStmtCallBack = bool (*)(StmtRef S);
 enum class VisitStmtKind { Pre, Eval, Post };
+constexpr unsigned NumVisitStmtKinds = 3U;
+constexpr unsigned NumStmtClasses = clang::Stmt::lastStmtConstant + 1U;
+
+/// \brief Get the index of the given stmt class and visit kind in the
+/// stmt dispatch tables.
+[[nodiscard]] inline unsigned get_stmt_dispatch_index(
+    clang::Stmt::StmtClass stmt_class, unsigned visit_kind) {
+    return visit_kind * NumStmtClasses + static_cast< unsigned >(stmt_class);
+}
 
 constexpr unsigned AlignedSize = 64;
 
@@ -89,6 +102,7 @@ __attribute__((packed)); // struct StmtAnalysisInfo
 } // namespace internal
 
 class ProgramStateManager;
+class StaticAnalysisPipeline;
 
 /// \brief The analysis manager which holds all the registered analyses.
 ///
@@ -96,13 +110,13 @@ class AnalysisManager {
     friend class CheckerManager;
 
   private:
-    KnightContext& m_ctx;
+    KnightTUContext& m_ctx;
 
     /// \brief analyses
     AnalysisIDSet m_analyses; // all analyses
     std::vector< AnalysisID >
         m_analysis_full_order; // subject to analysis dependencies
-    std::unordered_map< AnalysisID, AnalysisIDSet >
+    std::array< AnalysisIDSet, NumAnalysisIDs >
         m_analysis_dependencies;          // all analysis dependencies
     AnalysisIDSet m_priviledged_analysis; // priviledged analysis
 
@@ -112,16 +126,16 @@ class AnalysisManager {
     // shall be equivalent with enabled analyses key set.
 
     std::unique_ptr< dfa::RegionManager > m_region_mgr;
+    std::unique_ptr< dfa::SymbolManager > m_sym_mgr;
     std::unique_ptr< dfa::ProgramStateManager > m_state_mgr;
 
     /// \brief registered domains
-    std::unordered_map< DomID, AnalysisID > m_domains;
+    std::array< AnalysisID, NumDomIDs > m_domains{};
     using DomainDefaultValFn = std::function< SharedVal() >;
     using DomainBottomValFn = std::function< SharedVal() >;
-    std::unordered_map< DomID, DomainDefaultValFn > m_domain_default_fn;
-    std::unordered_map< DomID, DomainBottomValFn > m_domain_bottom_fn;
-    std::unordered_map< AnalysisID, std::unordered_set< DomID > >
-        m_analysis_domains;
+    std::array< DomainDefaultValFn, NumDomIDs > m_domain_default_fn;
+    std::array< DomainBottomValFn, NumDomIDs > m_domain_bottom_fn;
+    std::array< DomIDSet, NumAnalysisIDs > m_analysis_domains;
 
     /// \brief visit begin function callbacks
     std::vector< internal::AnalyzeBeginFunctionCallBack >
@@ -131,9 +145,34 @@ class AnalysisManager {
     /// \brief visit statement callbacks
     std::vector< internal::StmtAnalysisInfo > m_stmt_analyses;
 
+    /// \brief Required stmt callbacks in the full analysis order, indexed
+    /// by stmt class and visit kind.
+    ///
+    /// The match callbacks only test the stmt class, so an entry is filled
+    /// on the first stmt of its class and reused for all the others.
+    struct StmtDispatchEntry {
+        bool computed = false;
+        /// \brief Whether a statically dispatched analysis matches.
+        bool has_static = false;
+        std::vector< internal::AnalyzeStmtCallBack > callbacks;
+    }; // struct StmtDispatchEntry
+    mutable std::vector< StmtDispatchEntry > m_stmt_dispatch;
+
+    /// \brief The statically dispatched analyses, set only when built with
+    /// `KNIGHT_STATIC_ANALYSES`.
+    std::unique_ptr< StaticAnalysisPipeline > m_static_pipeline;
+
   public:
-    explicit AnalysisManager(KnightContext& ctx);
-    ~AnalysisManager() = default;
+    explicit AnalysisManager(KnightTUContext& ctx);
+
+    /// \brief Create an analysis manager whose regions and states are
+    /// allocated from the given allocator instead of the context one, and
+    /// whose regions and symbols are interned into the shared interner if
+    /// any.
+    AnalysisManager(KnightTUContext& ctx,
+                    llvm::BumpPtrAllocator& allocator,
+                    SharedInterner* interner = nullptr);
+    ~AnalysisManager();
 
   public:
     /// \brief specialized analysis management
@@ -141,7 +180,7 @@ class AnalysisManager {
     /// Dependencies shall be handled before the registration.
     /// @{
     template < typename ANALYSIS, typename... AT >
-    [[nodiscard]] UniqueAnalysisRef register_analysis(KnightContext& ctx,
+    [[nodiscard]] UniqueAnalysisRef register_analysis(KnightTUContext& ctx,
                                                       AT&&... Args) {
         AnalysisID id = get_analysis_id(ANALYSIS::get_kind());
         if (m_analyses.contains(id)) {
@@ -188,8 +227,7 @@ class AnalysisManager {
         m_domain_bottom_fn[dom_id] = Dom::bottom_val;
         m_analysis_domains[analysis_id].insert(dom_id);
     }
-    [[nodiscard]] std::unordered_set< DomID > get_registered_domains_in(
-        AnalysisID id) const;
+    [[nodiscard]] DomIDSet get_registered_domains_in(AnalysisID id) const;
     [[nodiscard]] std::optional< DomainDefaultValFn > get_domain_default_val_fn(
         DomID id) const;
     [[nodiscard]] std::optional< DomainBottomValFn > get_domain_bottom_val_fn(
@@ -220,6 +258,29 @@ class AnalysisManager {
         return m_stmt_analyses;
     }
 
+    /// \brief Get the required callbacks for the given stmt and visit kind,
+    /// in the full analysis order.
+    [[nodiscard]] const std::vector< internal::AnalyzeStmtCallBack >&
+    get_stmt_callbacks(internal::StmtRef stmt,
+                       internal::VisitStmtKind visit_kind) const;
+
+    /// \brief Check if any required analysis matches the given stmt.
+    [[nodiscard]] bool has_analyses_for_stmt(internal::StmtRef stmt) const;
+
+    /// \brief Check if any required analysis visits the begin or the end
+    /// of the functions.
+    [[nodiscard]] bool has_function_analyses() const;
+
+    /// \brief Get the options of the CFGs consumed by the required
+    /// analyses.
+    [[nodiscard]] ProcCFG::BuildOptions get_cfg_build_options() const {
+        // The lifetime ends only remove the variables from the states.
+        ProcCFG::BuildOptions opts;
+        opts.add_lifetime = !m_required_analyses.empty();
+        opts.add_def_use = m_ctx.get_current_options().sparse_analysis;
+        return opts;
+    }
+
     [[nodiscard]] const AnalysisIDSet& get_required_analyses() const {
         return m_required_analyses;
     }
@@ -227,8 +288,11 @@ class AnalysisManager {
     [[nodiscard]] dfa::RegionManager& get_region_manager() const {
         return *m_region_mgr;
     }
+    [[nodiscard]] dfa::SymbolManager& get_symbol_manager() const {
+        return *m_sym_mgr;
+    }
     [[nodiscard]] dfa::ProgramStateManager& get_state_manager() const;
-    [[nodiscard]] KnightContext& get_context() const { return m_ctx; }
+    [[nodiscard]] KnightTUContext& get_context() const { return m_ctx; }
 
     void compute_all_required_analyses_by_dependencies();
     void compute_full_order_analyses_after_registry();
@@ -248,6 +312,17 @@ class AnalysisManager {
     void run_analyses_for_end_function(AnalysisContext& analysis_ctx,
                                        ProcCFG::NodeRef node);
 
+  private:
+    [[nodiscard]] const StmtDispatchEntry& get_stmt_dispatch(
+        internal::StmtRef stmt, internal::VisitStmtKind visit_kind) const;
+
+    /// \brief Check if the analysis runs in the static pipeline instead of
+    /// the stmt callbacks.
+    [[nodiscard]] bool is_statically_dispatched(AnalysisID id) const;
+
+    /// \brief Create the static pipeline if running its analyses first
+    /// keeps the order between the dependent analyses.
+    void setup_static_pipeline();
 }; // class AnalysisManager
 
 } // namespace knight::dfa
@@ -0,0 +1,60 @@
+//===- ast_lock.hpp ---------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the lock of the AST queries made by the function
+//  workers of a translation unit.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <clang/AST/ASTContext.h>
+#include <llvm/ADT/DenseMapInfo.h>
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+
+namespace knight::dfa {
+
+/// \brief Lock the AST context of a translation unit for a query which
+/// fills its lazy caches.
+///
+/// The function workers share the AST context and the source manager of
+/// their translation unit, which fill their caches without locking, e.g.,
+/// the type infos, the record layouts, the ODR hashes, the file IDs of the
+/// locations and the decls deserialized from a preamble. The constant
+/// evaluation and the CFG builder use these caches too. Such queries of the
+/// workers are serialized by the lock of their context, taken around the
+/// query only, so that it is never nested.
+///
+/// The lock of a context is one of a fixed set of mutexes selected by the
+/// address of the context, so that the translation units analyzed in
+/// parallel rarely share one.
+class ASTLock {
+  private:
+    static constexpr std::size_t NumMutexes = 64U;
+
+    std::lock_guard< std::mutex > m_lock;
+
+  public:
+    explicit ASTLock(const clang::ASTContext& ast_ctx)
+        : m_lock(get_mutex(ast_ctx)) {}
+
+  private:
+    [[nodiscard]] static std::mutex& get_mutex(
+        const clang::ASTContext& ast_ctx) {
+        static std::array< std::mutex, NumMutexes > mutexes;
+        return mutexes[llvm::DenseMapInfo< const void* >::getHashValue(
+                           &ast_ctx) %
+                       NumMutexes];
+    }
+}; // class ASTLock
+
+} // namespace knight::dfa
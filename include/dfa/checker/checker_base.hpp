@@ -30,7 +30,7 @@ namespace knight::dfa {
 ///        (more callbacks accpeted...) > {
 ///
 ///    /// \brief delegate to the Checker constructor
-///    MyCheckerImpl(KnightContext& ctx, (more args...))
+///    MyCheckerImpl(KnightTUContext& ctx, (more args...))
 ///         : Checker(ctx) {
 ///       // ...
 ///    }
@@ -60,7 +60,7 @@ namespace knight::dfa {
 ///
 ///    /// \brief register your checker to manager here.
 ///    static UniqueCheckerRef register_checker(CheckerManager& mgr,
-///                                             KnightContext& ctx) {
+///                                             KnightTUContext& ctx) {
 ///        return mgr.register_checker< MyCheckerImpl >(ctx, (more ctor
 ///        args...));
 ///    }
@@ -72,7 +72,7 @@ class CheckerBase {
     CheckerKind kind;
 
   public:
-    CheckerBase(KnightContext& ctx, CheckerKind k);
+    CheckerBase(KnightTUContext& ctx, CheckerKind k);
     virtual ~CheckerBase() = default;
     virtual bool is_language_supported(
         const clang::LangOptions& lang_opts) const {
@@ -92,16 +92,16 @@ class CheckerBase {
     clang::DiagnosticBuilder diagnose(clang::DiagnosticIDs::Level diag_level =
                                           clang::DiagnosticIDs::Warning) const;
 
-    [[nodiscard]] KnightContext& get_knight_context() { return m_ctx; }
+    [[nodiscard]] KnightTUContext& get_knight_context() { return m_ctx; }
 
   private:
-    KnightContext& m_ctx;
+    KnightTUContext& m_ctx;
 }; // class CheckerBase
 
 template < typename Impl, typename CHECKER1, typename... CHECKERS >
 class Checker : public CHECKER1, public CHECKERS..., public CheckerBase {
   public:
-    Checker(KnightContext& ctx) : CheckerBase(ctx, Impl::get_kind()) {}
+    Checker(KnightTUContext& ctx) : CheckerBase(ctx, Impl::get_kind()) {}
 
     static void register_callback(Impl* checker, CheckerManager& mgr) {
         CHECKER1::register_callback(checker, mgr);
@@ -112,7 +112,7 @@ class Checker : public CHECKER1, public CHECKERS..., public CheckerBase {
 template < typename Impl, typename CHECKER1 >
 class Checker< Impl, CHECKER1 > : public CHECKER1, public CheckerBase {
   public:
-    Checker(KnightContext& ctx) : CheckerBase(ctx, Impl::get_kind()) {}
+    Checker(KnightTUContext& ctx) : CheckerBase(ctx, Impl::get_kind()) {}
 
     static void register_callback(Impl* checker, CheckerManager& mgr) {
         CHECKER1::register_callback(checker, mgr);
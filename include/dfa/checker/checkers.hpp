@@ -15,6 +15,9 @@
 
 #include <llvm/ADT/StringRef.h>
 
+#include <algorithm>
+#include <cstddef>
+
 #ifdef CHECKER_DEF
 #    undef CHECKER_DEF
 #endif
@@ -29,6 +32,15 @@ enum class CheckerKind {
 #include "checkers.def"
 }; // enum class CheckerKind
 
+/// \brief The number of the checker IDs, which are dense from 0 and
+/// index the bitsets of the checkers.
+constexpr std::size_t NumCheckerIDs = std::max< std::size_t >({
+    1U,
+#undef CHECKER_DEF
+#define CHECKER_DEF(KIND, NAME, ID, DESC) static_cast< std::size_t >(ID) + 1U,
+#include "checkers.def"
+});
+
 inline llvm::StringRef get_checker_name(CheckerKind kind) {
     switch (kind) {
 #undef CHECKER_DEF
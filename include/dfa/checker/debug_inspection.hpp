@@ -0,0 +1,105 @@
+//===- debug_inspection.hpp -------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the checker of the debug builtins, which reports
+//  the invariants of the analysis for the testcases.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/analysis/numerical_analysis.hpp"
+#include "dfa/checker/checker_base.hpp"
+#include "dfa/checker_context.hpp"
+#include "dfa/checker_manager.hpp"
+#include "dfa/domain/numerical/product_dom.hpp"
+#include "dfa/engine/condition_refiner.hpp"
+#include "tooling/context.hpp"
+
+#include <clang/AST/Expr.h>
+
+namespace knight::dfa {
+
+/// \brief Reports the invariants inspected by the debug builtins:
+///
+/// - `knight_eval(cond)` reports `TRUE` if the condition always holds,
+///   `FALSE` if it never does, and `UNKNOWN` otherwise.
+/// - `knight_reachable()` reports `REACHABLE`, and nothing where the
+///   analysis proves it unreachable.
+class DebugInspection
+    : public Checker< DebugInspection, check::PreStmt< clang::CallExpr > > {
+  public:
+    explicit DebugInspection(KnightTUContext& ctx) : Checker(ctx) {}
+
+    [[nodiscard]] static CheckerKind get_kind() {
+        return CheckerKind::DebugInspection;
+    }
+
+    void pre_check_stmt(const clang::CallExpr* call,
+                        CheckerContext& ctx) const {
+        if (!is_knight_builtin(call) || ctx.get_state()->is_bottom()) {
+            return;
+        }
+        const auto name = call->getDirectCallee()->getName();
+        if (name == "knight_reachable") {
+            diagnose(call->getBeginLoc(), "REACHABLE");
+            return;
+        }
+        if (name != "knight_eval" || call->getNumArgs() != 1U) {
+            return;
+        }
+
+        const auto& state = ctx.get_state();
+        const ConditionRefiner refiner(state->get_region_manager(),
+                                       state->get_state_manager()
+                                           .get_var_index(),
+                                       ctx.get_current_stack_frame());
+        const auto* cond = call->getArg(0U);
+        const bool may_be_true = may_hold(*state, refiner, cond, true);
+        const bool may_be_false = may_hold(*state, refiner, cond, false);
+        if (may_be_true && may_be_false) {
+            diagnose(call->getBeginLoc(), "UNKNOWN");
+        } else if (may_be_true) {
+            diagnose(call->getBeginLoc(), "TRUE");
+        } else if (may_be_false) {
+            diagnose(call->getBeginLoc(), "FALSE");
+        }
+    }
+
+  private:
+    /// \brief Whether the condition may evaluate to `is_true` in the
+    /// numerical product of the state.
+    [[nodiscard]] static bool may_hold(const ProgramState& state,
+                                       const ConditionRefiner& refiner,
+                                       const clang::Expr* cond,
+                                       bool is_true) {
+        auto csts = refiner.translate(cond, is_true);
+        if (!csts || csts->is_empty()) {
+            return true;
+        }
+        if (csts->is_false()) {
+            return false;
+        }
+        auto product = state.get_clone< NumericalProductDom >();
+        product->merge_with_linear_constraint_system(*csts);
+        return !product->is_bottom();
+    }
+
+  public:
+    static void add_dependencies(CheckerManager& mgr) {
+        mgr.add_checker_dependency< DebugInspection, NumericalAnalysis >();
+    }
+
+    static UniqueCheckerRef register_checker(CheckerManager& mgr,
+                                             KnightTUContext& ctx) {
+        return mgr.register_checker< DebugInspection >(ctx);
+    }
+}; // class DebugInspection
+
+} // namespace knight::dfa
@@ -25,7 +25,7 @@ namespace knight::dfa {
 
 class DemoChecker : public Checker< DemoChecker, check::BeginFunction > {
   public:
-    DemoChecker(KnightContext& C) : Checker(C) {}
+    DemoChecker(KnightTUContext& C) : Checker(C) {}
 
     [[nodiscard]] static CheckerKind get_kind() {
         return CheckerKind::DemoChecker;
@@ -54,7 +54,7 @@ class DemoChecker : public Checker< DemoChecker, check::BeginFunction > {
     }
 
     static UniqueCheckerRef register_checker(CheckerManager& mgr,
-                                             KnightContext& ctx) {
+                                             KnightTUContext& ctx) {
         return mgr.register_checker< DemoChecker >(ctx);
     }
 }; // class DemoChecker
@@ -20,7 +20,7 @@
 
 namespace knight {
 
-class KnightContext;
+class KnightTUContext;
 
 namespace dfa {
 
@@ -28,20 +28,26 @@ class StackFrame;
 
 class CheckerContext {
   private:
-    KnightContext& m_ctx;
+    KnightTUContext& m_ctx;
     const StackFrame* m_frame{};
     ProgramStateRef m_state{};
+    bool m_degraded = false;
 
   public:
-    explicit CheckerContext(KnightContext& ctx) : m_ctx(ctx) {}
+    explicit CheckerContext(KnightTUContext& ctx) : m_ctx(ctx) {}
 
-    [[nodiscard]] KnightContext& get_knight_context() const { return m_ctx; }
+    [[nodiscard]] KnightTUContext& get_knight_context() const { return m_ctx; }
     [[nodiscard]] clang::ASTContext& get_ast_context() const;
     [[nodiscard]] clang::SourceManager& get_source_manager() const;
     [[nodiscard]] ProgramStateRef get_state() const { return m_state; }
     [[nodiscard]] const clang::Decl* get_current_decl() const;
     [[nodiscard]] const StackFrame* get_current_stack_frame() const;
 
+    /// \brief Check if the states are degraded, since the analysis of the
+    /// function exceeded its deadline.
+    [[nodiscard]] bool is_degraded() const { return m_degraded; }
+    void set_degraded(bool degraded) { m_degraded = degraded; }
+
     void set_current_state(ProgramStateRef state) {
         m_state = std::move(state);
     }
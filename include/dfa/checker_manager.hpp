@@ -18,9 +18,9 @@
 #include "dfa/checker_context.hpp"
 #include "dfa/proc_cfg.hpp"
 #include "tooling/context.hpp"
+#include "util/id_set.hpp"
 
 #include <memory>
-#include <unordered_set>
 
 namespace knight::dfa {
 
@@ -30,7 +30,7 @@ using UniqueCheckerRef = std::unique_ptr< CheckerBase >;
 using CheckerRef = CheckerBase*;
 using CheckerRefs = std::vector< CheckerRef >;
 
-using CheckerIDSet = std::unordered_set< CheckerID >;
+using CheckerIDSet = IDSet< CheckerID, NumCheckerIDs >;
 using CheckerNameRef = llvm::StringRef;
 
 template < typename T >
@@ -70,6 +70,7 @@ using CheckEndFunctionCallBack =
 using CheckStmtCallBack = CheckerCallBack< void(StmtRef, CheckerContext&) >;
 using MatchStmtCallBack = bool (*)(StmtRef S);
 enum class CheckStmtKind { Pre, Post };
+constexpr unsigned NumCheckStmtKinds = 2U;
 constexpr unsigned StmtCheckerInfoAlign = 64;
 struct StmtCheckerInfo {
     CheckStmtCallBack anz_cb;
@@ -85,7 +86,7 @@ __attribute__((packed)); // struct StmtCheckerInfo
 class CheckerManager {
   private:
     /// \brief knight context
-    KnightContext& m_ctx;
+    KnightTUContext& m_ctx;
 
     /// \brief analysis manager
     AnalysisManager& m_analysis_mgr;
@@ -103,8 +104,16 @@ class CheckerManager {
     /// \brief visit statement callbacks
     std::vector< internal::StmtCheckerInfo > m_stmt_checks;
 
+    /// \brief Required stmt callbacks indexed by stmt class and check kind,
+    /// filled on the first stmt of each class.
+    struct StmtDispatchEntry {
+        bool computed = false;
+        std::vector< internal::CheckStmtCallBack > callbacks;
+    }; // struct StmtDispatchEntry
+    mutable std::vector< StmtDispatchEntry > m_stmt_dispatch;
+
   public:
-    CheckerManager(KnightContext& ctx, AnalysisManager& analysis_mgr)
+    CheckerManager(KnightTUContext& ctx, AnalysisManager& analysis_mgr)
         : m_ctx(ctx), m_analysis_mgr(analysis_mgr) {}
 
   public:
@@ -114,7 +123,7 @@ class CheckerManager {
     /// Dependencies shall be handled before the registration.
     /// @{
     template < typename CHECKER, typename... AT >
-    UniqueCheckerRef register_checker(KnightContext& ctx, AT&&... Args) {
+    UniqueCheckerRef register_checker(KnightTUContext& ctx, AT&&... Args) {
         CheckerID id = get_checker_id(CHECKER::get_kind());
         if (m_checkers.contains(id)) {
             llvm::errs() << get_checker_name_by_id(id)
@@ -167,6 +176,22 @@ class CheckerManager {
         return m_stmt_checks;
     }
 
+    /// \brief Get the required callbacks for the given stmt and check kind.
+    [[nodiscard]] const std::vector< internal::CheckStmtCallBack >&
+    get_stmt_callbacks(internal::StmtRef stmt,
+                       internal::CheckStmtKind check_kind) const;
+
+    /// \brief Check if any required checker matches the given stmt.
+    [[nodiscard]] bool has_checkers_for_stmt(
+        internal::StmtRef stmt, internal::CheckStmtKind check_kind) const;
+
+    /// \brief Check if any required checker checks the begin or the end
+    /// of the functions.
+    [[nodiscard]] bool has_function_checkers() const;
+
+    /// \brief Check if any required checker checks some stmts.
+    [[nodiscard]] bool has_stmt_checkers() const;
+
     void run_checkers_for_stmt(CheckerContext& checker_ctx,
                                internal::StmtRef stmt,
                                internal::CheckStmtKind check_kind);
@@ -13,37 +13,60 @@
 
 #pragma once
 
+#include <llvm/ADT/Hashing.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/Support/raw_ostream.h>
 
 #include "support/dumpable.hpp"
 #include "util/assert.hpp"
 
+#include <functional>
 #include <optional>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace knight::dfa {
 
+/// \brief Get the greatest common divisor of the absolute values.
+template < typename Num >
+[[nodiscard]] inline Num gcd_of(Num lhs, Num rhs) {
+    while (rhs != 0) {
+        lhs = lhs % rhs;
+        std::swap(lhs, rhs);
+    }
+    return lhs < 0 ? -lhs : lhs;
+}
+
+/// \brief A linear expression `c + k_1 * x_1 + ... + k_n * x_n`.
+///
+/// The terms are kept sorted by variable without zero factors, so that
+/// each expression has a unique representation. They are stored inline
+/// up to four terms, which covers most expressions, and the additions
+/// merge the sorted terms in a single pass.
 template < typename Num, typename Var >
 class LinearExpr {
   public:
     using VarRef = Var::Ref;
     using VarSet = std::unordered_set< VarRef >;
-    using Map = std::unordered_map< VarRef, Num >;
+    using Term = std::pair< VarRef, Num >;
+    using Terms = llvm::SmallVector< Term, 4 >;
 
   private:
-    Map m_terms;
-    Num m_constant;
+    Terms m_terms;
+    Num m_constant = 0;
 
   public:
     LinearExpr() = default;
     explicit LinearExpr(Num n) : m_constant(std::move(n)) {}
-    explicit LinearExpr(VarRef var) { this->m_terms.emplace(var, Num(1)); }
+    explicit LinearExpr(VarRef var) { this->m_terms.emplace_back(var, 1); }
 
     /// \brief k * var
-    LinearExpr(Num k, Var var) {
+    LinearExpr(Num k, VarRef var) {
         if (k != 0) {
-            this->m_terms.emplace(var, std::move(k));
+            this->m_terms.emplace_back(var, std::move(k));
         }
     }
 
@@ -53,10 +76,6 @@ class LinearExpr {
     LinearExpr& operator=(LinearExpr&&) = default;
     ~LinearExpr() = default;
 
-  private:
-    LinearExpr(Map terms, Num constant)
-        : m_terms(std::move(terms)), m_constant(std::move(constant)) {}
-
   public:
     /// \brief Plus constant
     void plus(const Num& n) { this->m_constant += n; }
@@ -65,31 +84,30 @@ class LinearExpr {
     void plus(VarRef var) { this->plus(1, var); }
 
     /// \brief Plus k * var
-    void plus(const Num& factor, Var var) {
-        auto it = this->m_terms.find(var);
-        if (it != this->m_terms.end()) {
-            Num r = it->second + factor;
-            if (r == 0) {
-                this->m_terms.erase(it);
-            } else {
-                it->second = r;
-            }
-        } else {
-            if (factor != 0) {
-                this->m_terms.emplace(var, factor);
-            }
+    void plus(const Num& factor, VarRef var) {
+        if (factor == 0) {
+            return;
+        }
+        auto it = this->find(var);
+        if (it == this->m_terms.end() || it->first != var) {
+            this->m_terms.insert(it, Term(var, factor));
+            return;
+        }
+        it->second += factor;
+        if (it->second == 0) {
+            this->m_terms.erase(it);
         }
     }
 
     void set_to_constant(Num cst) {
-        Map().swap(this->m_terms);
-        this->m_constant = cst;
+        this->m_terms.clear();
+        this->m_constant = std::move(cst);
     }
 
     void set_to_zero() { set_to_constant(0); }
 
-    [[nodiscard]] Map& get_terms() { return this->m_terms; }
-    [[nodiscard]] const Map& get_variable_terms() const {
+    /// \brief Get the terms, sorted by variable.
+    [[nodiscard]] const Terms& get_variable_terms() const {
         return this->m_terms;
     }
     [[nodiscard]] std::size_t num_variable_terms() const {
@@ -106,12 +124,24 @@ class LinearExpr {
     }
 
     [[nodiscard]] Num get_factor_of(VarRef var) const {
-        auto it = this->m_terms.find(var);
-        if (it != this->m_terms.end()) {
+        auto it = this->find(var);
+        if (it != this->m_terms.end() && it->first == var) {
             return it->second;
-        } else {
-            return Num(0);
         }
+        return Num(0);
+    }
+
+    /// \brief Get the greatest common divisor of the factors, which is
+    /// zero for a constant expression.
+    [[nodiscard]] Num get_factors_gcd() const {
+        Num gcd = 0;
+        for (const auto& [_, factor] : this->m_terms) {
+            gcd = gcd_of(std::move(gcd), factor);
+            if (gcd == 1) {
+                break;
+            }
+        }
+        return gcd;
     }
 
     void operator+=(const Num& n) { this->m_constant += n; }
@@ -119,10 +149,8 @@ class LinearExpr {
 
     /// \brief Plus a linear expression
     void operator+=(const LinearExpr& expr) {
-        for (const auto& [var, factor] : expr) {
-            this->plus(factor, var);
-        }
-        this->m_constant += expr.constant();
+        this->merge_terms(expr.m_terms, /*negate=*/false);
+        this->m_constant += expr.m_constant;
     }
 
     /// \brief Substract a num
@@ -133,27 +161,43 @@ class LinearExpr {
 
     /// \brief Substract a linear expression
     void operator-=(const LinearExpr& expr) {
-        for (const auto& term : expr) {
-            this->plus(-term.second, term.first);
-        }
-        this->m_constant -= expr.constant();
+        this->merge_terms(expr.m_terms, /*negate=*/true);
+        this->m_constant -= expr.m_constant;
     }
 
     /// \brief Unary minus
-    [[nodiscard]] LinearExpr operator-() const {
+    [[nodiscard]] LinearExpr operator-() const& {
         LinearExpr r(*this);
-        r *= -1;
+        r.negate();
         return r;
     }
+    [[nodiscard]] LinearExpr operator-() && {
+        this->negate();
+        return std::move(*this);
+    }
+
+    void negate() {
+        for (auto& [_, factor] : this->m_terms) {
+            factor = -factor;
+        }
+        this->m_constant = -this->m_constant;
+    }
+
+    /// \brief Divide the factors, which shall be multiples of the divisor.
+    void divide_factors(const Num& divisor) {
+        for (auto& [_, factor] : this->m_terms) {
+            knight_assert(factor % divisor == 0);
+            factor = factor / divisor;
+        }
+    }
 
     /// \brief Multiply by a constant
     void operator*=(const Num& n) {
         if (n == 0) {
-            this->m_terms.clear();
-            this->m_constant = 0;
+            this->set_to_zero();
         } else {
-            for (auto& term : this->m_terms) {
-                term.second *= n;
+            for (auto& [_, factor] : this->m_terms) {
+                factor *= n;
             }
             this->m_constant *= n;
         }
@@ -191,6 +235,22 @@ class LinearExpr {
         return vars;
     }
 
+    /// \brief Whether the expressions are the same, which is not
+    /// `operator==` that builds an equality constraint.
+    [[nodiscard]] bool equals(const LinearExpr& other) const {
+        return this->m_constant == other.m_constant &&
+               this->m_terms == other.m_terms;
+    }
+
+    [[nodiscard]] friend llvm::hash_code hash_value(const LinearExpr& expr) {
+        using llvm::hash_value;
+        llvm::hash_code hash = hash_value(expr.m_constant);
+        for (const auto& [var, factor] : expr.m_terms) {
+            hash = llvm::hash_combine(hash, var, hash_value(factor));
+        }
+        return hash;
+    }
+
     void dump(llvm::raw_ostream& os) const {
         bool is_first = true;
         for (auto& [var, factor] : this->m_terms) {
@@ -212,6 +272,52 @@ class LinearExpr {
             os << this->m_constant;
         }
     }
+
+  private:
+    [[nodiscard]] typename Terms::iterator find(VarRef var) {
+        return llvm::lower_bound(this->m_terms, var, compare_var);
+    }
+    [[nodiscard]] typename Terms::const_iterator find(VarRef var) const {
+        return llvm::lower_bound(this->m_terms, var, compare_var);
+    }
+
+    [[nodiscard]] static bool compare_var(const Term& term, VarRef var) {
+        return std::less< VarRef >()(term.first, var);
+    }
+
+    /// \brief Add or substract the sorted terms.
+    void merge_terms(const Terms& terms, bool negate) {
+        if (terms.empty()) {
+            return;
+        }
+        if (terms.size() == 1U) {
+            const auto& [var, factor] = terms.front();
+            this->plus(negate ? -factor : factor, var);
+            return;
+        }
+        Terms merged;
+        merged.reserve(this->m_terms.size() + terms.size());
+        auto it = this->m_terms.begin();
+        auto other_it = terms.begin();
+        while (it != this->m_terms.end() || other_it != terms.end()) {
+            if (other_it == terms.end() ||
+                (it != this->m_terms.end() &&
+                 std::less< VarRef >()(it->first, other_it->first))) {
+                merged.push_back(std::move(*it++));
+                continue;
+            }
+            Num factor = negate ? -other_it->second : other_it->second;
+            if (it != this->m_terms.end() && it->first == other_it->first) {
+                factor += it->second;
+                ++it;
+            }
+            if (factor != 0) {
+                merged.emplace_back(other_it->first, std::move(factor));
+            }
+            ++other_it;
+        }
+        this->m_terms.swap(merged);
+    }
 }; // class LinearExpr
 
 template < typename Num, typename Var >
@@ -299,6 +405,13 @@ template < typename Num, typename Var >
     return x;
 }
 
+template < typename Num, typename Var >
+[[nodiscard]] inline LinearExpr< Num, Var > operator+(
+    const LinearExpr< Num, Var >& x, LinearExpr< Num, Var >&& y) {
+    y += x;
+    return std::move(y);
+}
+
 template < typename Num, typename Var >
 [[nodiscard]] inline LinearExpr< Num, Var > operator-(typename Var::Ref var,
                                                       const Num& n) {
@@ -360,6 +473,14 @@ template < typename Num, typename Var >
     return x;
 }
 
+template < typename Num, typename Var >
+[[nodiscard]] inline LinearExpr< Num, Var > operator-(
+    const LinearExpr< Num, Var >& x, LinearExpr< Num, Var >&& y) {
+    y.negate();
+    y += x;
+    return std::move(y);
+}
+
 /// @}
 
 /// \brief Linear constraint linearconstraintkind
@@ -375,7 +496,7 @@ class LinearConstraint {
     using enum LinearConstraintKind;
     using VarRef = Var::Ref;
     using VarSet = std::unordered_set< VarRef >;
-    using LinearExpr = knight::dfa::LinearExpr< Var, Num >;
+    using LinearExpr = knight::dfa::LinearExpr< Num, Var >;
 
   private:
     LinearExpr m_linear_expr;
@@ -383,7 +504,9 @@ class LinearConstraint {
 
   public:
     LinearConstraint(LinearExpr expr, LinearConstraintKind linearconstraintkind)
-        : m_linear_expr(std::move(expr)), m_kind(linearconstraintkind) {}
+        : m_linear_expr(std::move(expr)), m_kind(linearconstraintkind) {
+        this->normalize();
+    }
 
     LinearConstraint() = delete;
 
@@ -411,13 +534,13 @@ class LinearConstraint {
 
         switch (this->m_kind) {
             case LCK_Equality: {
-                return this->m_linear_expr.constant() == 0;
+                return this->m_linear_expr.get_constant_term() == 0;
             }
             case LCK_Disequation: {
-                return this->m_linear_expr.constant() != 0;
+                return this->m_linear_expr.get_constant_term() != 0;
             }
             case LCK_Inequality: {
-                return this->m_linear_expr.constant() <= 0;
+                return this->m_linear_expr.get_constant_term() <= 0;
             }
             default:
                 break;
@@ -434,15 +557,15 @@ class LinearConstraint {
         switch (this->m_kind) {
             case LCK_Equality: {
                 // x == 0
-                return this->m_linear_expr.constant() != 0;
+                return this->m_linear_expr.get_constant_term() != 0;
             }
             case LCK_Disequation: {
                 // x != 0
-                return this->m_linear_expr.constant() == 0;
+                return this->m_linear_expr.get_constant_term() == 0;
             }
             case LCK_Inequality: {
                 // x <= 0
-                return this->m_linear_expr.constant() > 0;
+                return this->m_linear_expr.get_constant_term() > 0;
             }
             default:
                 break;
@@ -468,7 +591,7 @@ class LinearConstraint {
         return this->m_kind;
     }
     [[nodiscard]] Num get_constant_term() const {
-        return -this->m_linear_expr.constant();
+        return -this->m_linear_expr.get_constant_term();
     }
     [[nodiscard]] std::size_t num_variable_terms() const {
         return this->m_linear_expr.num_variable_terms();
@@ -481,6 +604,19 @@ class LinearConstraint {
         return this->m_linear_expr.get_var_set();
     }
 
+    /// \brief Whether the constraints are the same, which is cheap since
+    /// the constraints are in canonical form.
+    [[nodiscard]] bool equals(const LinearConstraint& other) const {
+        return this->m_kind == other.m_kind &&
+               this->m_linear_expr.equals(other.m_linear_expr);
+    }
+
+    [[nodiscard]] friend llvm::hash_code hash_value(
+        const LinearConstraint& cst) {
+        return llvm::hash_combine(static_cast< int >(cst.m_kind),
+                                  hash_value(cst.m_linear_expr));
+    }
+
     void dump(llvm::raw_ostream& os) const {
         if (this->is_contradiction()) {
             os << "false";
@@ -514,6 +650,41 @@ class LinearConstraint {
         }
         os << cst;
     }
+
+  private:
+    /// \brief Put the constraint in canonical form over the integers.
+    ///
+    /// The factors are divided by their greatest common divisor, rounding
+    /// the constant of an inequality to the tighter bound, and the first
+    /// factor of an equation or a disequation is made positive.
+    void normalize() {
+        const Num gcd = this->m_linear_expr.get_factors_gcd();
+        if (gcd == 0) {
+            return;
+        }
+        if (gcd != 1) {
+            Num cst = this->m_linear_expr.get_constant_term();
+            const bool is_multiple = cst % gcd == 0;
+            if (!is_multiple && this->m_kind != LCK_Inequality) {
+                // The equation has no integer solution.
+                *this = this->m_kind == LCK_Equality ? contradiction()
+                                                     : tautology();
+                return;
+            }
+            this->m_linear_expr -= cst;
+            this->m_linear_expr.divide_factors(gcd);
+            // k * x + c <= 0 is x + ceil(c / k) <= 0.
+            Num quotient = cst / gcd;
+            if (!is_multiple && cst > 0) {
+                quotient += 1;
+            }
+            this->m_linear_expr += quotient;
+        }
+        if (this->m_kind != LCK_Inequality &&
+            this->m_linear_expr.get_variable_terms().front().second < 0) {
+            this->m_linear_expr.negate();
+        }
+    }
 }; // class LinearConstraint
 
 template < typename Num, typename Var >
@@ -535,7 +706,7 @@ template < typename Num, typename Var >
     typename Var::Ref x, const Num& n) {
     return LinearConstraint< Num,
                              Var >(std::move(x) - n,
-                                   LinearConstraint< Num, Var >::Inequality);
+                                   LinearConstraintKind::LCK_Inequality);
 }
 
 template < typename Num, typename Var >
@@ -543,7 +714,7 @@ template < typename Num, typename Var >
     typename Var::Ref x, typename Var::Ref y) {
     return LinearConstraint< Num,
                              Var >(std::move(x) - std::move(y),
-                                   LinearConstraint< Num, Var >::Inequality);
+                                   LinearConstraintKind::LCK_Inequality);
 }
 
 template < typename Num, typename Var >
@@ -551,7 +722,7 @@ template < typename Num, typename Var >
     typename Var::Ref x, LinearExpr< Num, Var > y) {
     return LinearConstraint< Num,
                              Var >(std::move(x) - std::move(y),
-                                   LinearConstraint< Num, Var >::Inequality);
+                                   LinearConstraintKind::LCK_Inequality);
 }
 
 template < typename Num, typename Var >
@@ -559,7 +730,7 @@ template < typename Num, typename Var >
     LinearExpr< Num, Var > x, const LinearExpr< Num, Var >& y) {
     return LinearConstraint< Num,
                              Var >(std::move(x) - y,
-                                   LinearConstraint< Num, Var >::Inequality);
+                                   LinearConstraintKind::LCK_Inequality);
 }
 
 template < typename Num, typename Var >
@@ -567,7 +738,7 @@ template < typename Num, typename Var >
     LinearExpr< Num, Var > linear_expr, const Num& n) {
     return LinearConstraint< Num,
                              Var >(n - std::move(linear_expr),
-                                   LinearConstraint< Num, Var >::Inequality);
+                                   LinearConstraintKind::LCK_Inequality);
 }
 
 template < typename Num, typename Var >
@@ -575,7 +746,7 @@ template < typename Num, typename Var >
     LinearExpr< Num, Var > linear_expr, typename Var::Ref x) {
     return LinearConstraint< Num,
                              Var >(std::move(x) - std::move(linear_expr),
-                                   LinearConstraint< Num, Var >::Inequality);
+                                   LinearConstraintKind::LCK_Inequality);
 }
 
 template < typename Num, typename Var >
@@ -583,7 +754,7 @@ template < typename Num, typename Var >
     typename Var::Ref x, const Num& n) {
     return LinearConstraint< Num,
                              Var >(n - std::move(x),
-                                   LinearConstraint< Num, Var >::Inequality);
+                                   LinearConstraintKind::LCK_Inequality);
 }
 
 template < typename Num, typename Var >
@@ -591,7 +762,7 @@ template < typename Num, typename Var >
     typename Var::Ref x, typename Var::Ref y) {
     return LinearConstraint< Num,
                              Var >(std::move(y) - std::move(x),
-                                   LinearConstraint< Num, Var >::Inequality);
+                                   LinearConstraintKind::LCK_Inequality);
 }
 
 template < typename Num, typename Var >
@@ -599,7 +770,7 @@ template < typename Num, typename Var >
     typename Var::Ref x, LinearExpr< Num, Var > linear_expr) {
     return LinearConstraint< Num,
                              Var >(std::move(linear_expr) - std::move(x),
-                                   LinearConstraint< Num, Var >::Inequality);
+                                   LinearConstraintKind::LCK_Inequality);
 }
 
 template < typename Num, typename Var >
@@ -607,49 +778,49 @@ template < typename Num, typename Var >
     const LinearExpr< Num, Var >& x, LinearExpr< Num, Var > y) {
     return LinearConstraint< Num,
                              Var >(std::move(y) - x,
-                                   LinearConstraint< Num, Var >::Inequality);
+                                   LinearConstraintKind::LCK_Inequality);
 }
 
 template < typename Num, typename Var >
 [[nodiscard]] inline LinearConstraint< Num, Var > operator==(
     LinearExpr< Num, Var > linear_expr, const Num& n) {
     return LinearConstraint< Num, Var >(std::move(linear_expr) - n,
-                                        LinearConstraint< Num, Var >::Equality);
+                                        LinearConstraintKind::LCK_Equality);
 }
 
 template < typename Num, typename Var >
 [[nodiscard]] inline LinearConstraint< Num, Var > operator==(
     LinearExpr< Num, Var > linear_expr, typename Var::Ref x) {
     return LinearConstraint< Num, Var >(std::move(linear_expr) - std::move(x),
-                                        LinearConstraint< Num, Var >::Equality);
+                                        LinearConstraintKind::LCK_Equality);
 }
 
 template < typename Num, typename Var >
 [[nodiscard]] inline LinearConstraint< Num, Var > operator==(
     typename Var::Ref x, const Num& n) {
     return LinearConstraint< Num, Var >(std::move(x) - n,
-                                        LinearConstraint< Num, Var >::Equality);
+                                        LinearConstraintKind::LCK_Equality);
 }
 
 template < typename Num, typename Var >
 [[nodiscard]] inline LinearConstraint< Num, Var > operator==(
     typename Var::Ref x, typename Var::Ref y) {
     return LinearConstraint< Num, Var >(std::move(x) - std::move(y),
-                                        LinearConstraint< Num, Var >::Equality);
+                                        LinearConstraintKind::LCK_Equality);
 }
 
 template < typename Num, typename Var >
 [[nodiscard]] inline LinearConstraint< Num, Var > operator==(
     typename Var::Ref x, LinearExpr< Num, Var > linear_expr) {
     return LinearConstraint< Num, Var >(std::move(linear_expr) - std::move(x),
-                                        LinearConstraint< Num, Var >::Equality);
+                                        LinearConstraintKind::LCK_Equality);
 }
 
 template < typename Num, typename Var >
 [[nodiscard]] inline LinearConstraint< Num, Var > operator==(
     LinearExpr< Num, Var > x, const LinearExpr< Num, Var >& y) {
     return LinearConstraint< Num, Var >(std::move(x) - y,
-                                        LinearConstraint< Num, Var >::Equality);
+                                        LinearConstraintKind::LCK_Equality);
 }
 
 template < typename Num, typename Var >
@@ -657,7 +828,7 @@ template < typename Num, typename Var >
     LinearExpr< Num, Var > linear_expr, const Num& n) {
     return LinearConstraint< Num,
                              Var >(std::move(linear_expr) - n,
-                                   LinearConstraint< Num, Var >::Disequation);
+                                   LinearConstraintKind::LCK_Disequation);
 }
 
 template < typename Num, typename Var >
@@ -665,7 +836,7 @@ template < typename Num, typename Var >
     LinearExpr< Num, Var > linear_expr, typename Var::Ref x) {
     return LinearConstraint< Num,
                              Var >(std::move(linear_expr) - std::move(x),
-                                   LinearConstraint< Num, Var >::Disequation);
+                                   LinearConstraintKind::LCK_Disequation);
 }
 
 template < typename Num, typename Var >
@@ -673,7 +844,7 @@ template < typename Num, typename Var >
     typename Var::Ref x, const Num& n) {
     return LinearConstraint< Num,
                              Var >(std::move(x) - n,
-                                   LinearConstraint< Num, Var >::Disequation);
+                                   LinearConstraintKind::LCK_Disequation);
 }
 
 template < typename Num, typename Var >
@@ -681,7 +852,7 @@ template < typename Num, typename Var >
     typename Var::Ref x, typename Var::Ref y) {
     return LinearConstraint< Num,
                              Var >(std::move(x) - std::move(y),
-                                   LinearConstraint< Num, Var >::Disequation);
+                                   LinearConstraintKind::LCK_Disequation);
 }
 
 template < typename Num, typename Var >
@@ -689,7 +860,7 @@ template < typename Num, typename Var >
     typename Var::Ref x, LinearExpr< Num, Var > linear_expr) {
     return LinearConstraint< Num,
                              Var >(std::move(linear_expr) - std::move(x),
-                                   LinearConstraint< Num, Var >::Disequation);
+                                   LinearConstraintKind::LCK_Disequation);
 }
 
 template < typename Num, typename Var >
@@ -697,7 +868,7 @@ template < typename Num, typename Var >
     LinearExpr< Num, Var > x, const LinearExpr< Num, Var >& y) {
     return LinearConstraint< Num,
                              Var >(std::move(x) - y,
-                                   LinearConstraint< Num, Var >::Disequation);
+                                   LinearConstraintKind::LCK_Disequation);
 }
 
 template < typename Num, typename Var >
@@ -732,22 +903,149 @@ class LinearConstraintSystem {
         return this->m_linear_csts.size();
     }
 
+    [[nodiscard]] bool contains(const LinearConstraint& cst) const {
+        return llvm::any_of(this->m_linear_csts,
+                            [&cst](const LinearConstraint& other) {
+                                return other.equals(cst);
+                            });
+    }
+
+    /// \brief Whether the system is the single contradiction, which any
+    /// contradicting constraint reduces it to.
+    [[nodiscard]] bool is_false() const {
+        return this->m_linear_csts.size() == 1U &&
+               this->m_linear_csts.front().is_contradiction();
+    }
+
+    /// \brief Add the constraint, unless it is a tautology or already in
+    /// the system.
     void add_linear_constraint(LinearConstraint cst) {
+        if (this->is_false() || cst.is_tautology() || this->contains(cst)) {
+            return;
+        }
+        if (cst.is_contradiction()) {
+            this->set_to_false();
+            return;
+        }
         this->m_linear_csts.emplace_back(std::move(cst));
     }
 
+    /// \brief Remove the redundant constraints.
+    ///
+    /// The constraints over the same linear form `u`, taken with a
+    /// positive first factor, are replaced by the bounds they imply on
+    /// `u`: the tightest lower and upper bounds, or the equality if they
+    /// meet, and the disequations within the bounds. The system becomes
+    /// false if the bounds of a form contradict.
+    void normalize() {
+        if (this->is_false()) {
+            return;
+        }
+
+        struct FormBounds {
+            LinearExpr< Num, Var > form;
+            std::optional< Num > lb;
+            std::optional< Num > ub;
+            llvm::SmallVector< Num, 1 > diseqs;
+        }; // struct FormBounds
+
+        std::vector< FormBounds > forms;
+        std::unordered_map< std::size_t, llvm::SmallVector< std::size_t, 1 > >
+            form_indices;
+        auto get_form_bounds =
+            [&](LinearExpr< Num, Var > form) -> FormBounds& {
+            auto& indices = form_indices[hash_value(form)];
+            for (std::size_t index : indices) {
+                if (forms[index].form.equals(form)) {
+                    return forms[index];
+                }
+            }
+            indices.push_back(forms.size());
+            return forms.emplace_back(FormBounds{std::move(form)});
+        };
+
+        for (const LinearConstraint& cst : this->m_linear_csts) {
+            if (cst.is_contradiction()) {
+                this->set_to_false();
+                return;
+            }
+            if (cst.is_tautology()) {
+                continue;
+            }
+            // `k * u + c op 0` is `u op' -c / k` for k = 1 or -1.
+            auto form = cst.get_linear_expression();
+            Num constant = form.get_constant_term();
+            form -= constant;
+            const bool is_negated =
+                form.get_variable_terms().front().second < 0;
+            if (is_negated) {
+                form.negate();
+            } else {
+                constant = -constant;
+            }
+            auto& bounds = get_form_bounds(std::move(form));
+            const bool is_lower = cst.is_equality() ||
+                                  (cst.is_Inequality() && is_negated);
+            const bool is_upper = cst.is_equality() ||
+                                  (cst.is_Inequality() && !is_negated);
+            if (is_lower && (!bounds.lb || *bounds.lb < constant)) {
+                bounds.lb = constant;
+            }
+            if (is_upper && (!bounds.ub || constant < *bounds.ub)) {
+                bounds.ub = constant;
+            }
+            if (cst.is_disequation()) {
+                bounds.diseqs.push_back(std::move(constant));
+            }
+        }
+
+        LinearConstraints csts;
+        csts.reserve(forms.size());
+        for (auto& [form, lb, ub, diseqs] : forms) {
+            if (lb && ub && *ub < *lb) {
+                this->set_to_false();
+                return;
+            }
+            const bool is_equal = lb && ub && *lb == *ub;
+            if (is_equal) {
+                if (llvm::is_contained(diseqs, *lb)) {
+                    this->set_to_false();
+                    return;
+                }
+                csts.emplace_back(form - *lb, LinearConstraint::LCK_Equality);
+                continue;
+            }
+            if (lb) {
+                csts.emplace_back(*lb - form, LinearConstraint::LCK_Inequality);
+            }
+            if (ub) {
+                csts.emplace_back(form - *ub, LinearConstraint::LCK_Inequality);
+            }
+            llvm::sort(diseqs);
+            diseqs.erase(std::unique(diseqs.begin(), diseqs.end()),
+                         diseqs.end());
+            for (const Num& diseq : diseqs) {
+                if ((!lb || *lb <= diseq) && (!ub || diseq <= *ub)) {
+                    csts.emplace_back(form - diseq,
+                                      LinearConstraint::LCK_Disequation);
+                }
+            }
+        }
+        this->m_linear_csts.swap(csts);
+    }
+
     void merge_linear_constraint_system(const LinearConstraintSystem& csts) {
         this->m_linear_csts.reserve(this->m_linear_csts.size() + csts.size());
-        this->m_linear_csts.insert(this->m_linear_csts.end(),
-                                   csts.begin(),
-                                   csts.end());
+        for (const LinearConstraint& cst : csts) {
+            this->add_linear_constraint(cst);
+        }
     }
 
     void merge_linear_constraint_system(LinearConstraintSystem&& csts) {
         this->m_linear_csts.reserve(this->m_linear_csts.size() + csts.size());
-        this->m_linear_csts.insert(this->m_linear_csts.end(),
-                                   std::make_move_iterator(csts.begin()),
-                                   std::make_move_iterator(csts.end()));
+        for (LinearConstraint& cst : csts.m_linear_csts) {
+            this->add_linear_constraint(std::move(cst));
+        }
     }
 
     [[nodiscard]] const LinearConstraints& get_linear_constraints() const {
@@ -757,10 +1055,14 @@ class LinearConstraintSystem {
         return m_linear_csts;
     }
 
+    [[nodiscard]] auto begin() const { return m_linear_csts.begin(); }
+    [[nodiscard]] auto end() const { return m_linear_csts.end(); }
+
     [[nodiscard]] VarSet get_var_set() const {
         VarSet vars;
         for (const LinearConstraint& cst : this->m_linear_csts) {
-            for (const auto& term : cst) {
+            for (const auto& term :
+                 cst.get_linear_expression().get_variable_terms()) {
                 vars.insert(term.first);
             }
         }
@@ -781,6 +1083,11 @@ class LinearConstraintSystem {
         os << "}";
     }
 
+    /// \brief Set the system to the single contradiction.
+    void set_to_false() {
+        this->m_linear_csts.clear();
+        this->m_linear_csts.push_back(LinearConstraint::contradiction());
+    }
 }; // end class LinearConstraintSystem
 
 } // namespace knight::dfa
\ No newline at end of file
@@ -0,0 +1,109 @@
+//===- def_use.hpp ----------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the def-use chains of the local variables over
+//  the ProcCFG, which drive the sparse analysis.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/liveness.hpp"
+#include "dfa/proc_cfg.hpp"
+
+#include <clang/Analysis/Analyses/Dominators.h>
+#include <llvm/ADT/BitVector.h>
+
+#include <memory>
+#include <vector>
+
+namespace knight::dfa {
+
+/// \brief The def-use chains of the local variables tracked by the
+/// liveness, in a SSA-like form over the blocks of a function.
+///
+/// A block defines a variable if it declares or writes it, and uses it if
+/// it reads it before any definition in the block. The phis are placed at
+/// the iterated dominance frontiers of the definitions where the variable
+/// is live, so that each use is reached by the definition or the phi of
+/// its nearest dominator.
+///
+/// The blocks which only evaluate pure expressions consumed in the block
+/// itself define nothing and change no binding, hence are transparent:
+/// the abstract values flow through them unchanged, and the sparse
+/// analysis skips their transfers.
+class DefUseChains {
+  public:
+    using NodeRef = ProcCFG::NodeRef;
+    using VarDeclRef = ProcCFG::VarDeclRef;
+
+  private:
+    const LiveVariables& m_live_vars;
+    std::unique_ptr< clang::CFGDomTree > m_dom_tree;
+
+    /// \brief The tracked variables by their indices.
+    std::vector< VarDeclRef > m_vars;
+
+    /// \brief The variables defined, used and merged by a phi in each
+    /// node, indexed by the block ID and the variable index.
+    /// @{
+    std::vector< llvm::BitVector > m_defs;
+    std::vector< llvm::BitVector > m_uses;
+    std::vector< llvm::BitVector > m_phis;
+    /// @}
+
+    /// \brief The transparent nodes, indexed by the block ID.
+    llvm::BitVector m_transparent;
+
+  public:
+    DefUseChains(const ProcCFG& cfg, const LiveVariables& live_vars);
+    ~DefUseChains();
+
+  public:
+    [[nodiscard]] bool defines(NodeRef node, VarDeclRef var) const {
+        return test(m_defs, node, var);
+    }
+
+    [[nodiscard]] bool uses(NodeRef node, VarDeclRef var) const {
+        return test(m_uses, node, var);
+    }
+
+    [[nodiscard]] bool has_phi(NodeRef node, VarDeclRef var) const {
+        return test(m_phis, node, var);
+    }
+
+    /// \brief Get the node of the definition or the phi which reaches the
+    /// entry of the node, or null if the variable is not tracked or not
+    /// defined on the path from the function entry.
+    [[nodiscard]] NodeRef get_reaching_def(VarDeclRef var,
+                                           NodeRef node) const;
+
+    /// \brief Whether the transfer of the node may be skipped.
+    [[nodiscard]] bool is_transparent(NodeRef node) const {
+        return m_transparent.test(ProcCFG::index(node));
+    }
+
+  private:
+    [[nodiscard]] bool test(const std::vector< llvm::BitVector >& sets,
+                            NodeRef node,
+                            VarDeclRef var) const {
+        auto index = m_live_vars.get_var_index(var);
+        return index.has_value() && sets[ProcCFG::index(node)].test(*index);
+    }
+
+    /// \brief Collect the defined and used variables of the node, and
+    /// return whether it only evaluates pure expressions.
+    [[nodiscard]] bool collect_defs_and_uses(NodeRef node);
+
+    /// \brief Place the phis of the variables at the iterated dominance
+    /// frontiers of their definitions, pruned by the liveness.
+    void place_phis(const ProcCFG& cfg);
+}; // class DefUseChains
+
+} // namespace knight::dfa
@@ -46,11 +46,11 @@ class DemoItvDom : public AbsDom< DemoItvDom > {
 
   public:
     [[nodiscard]] static SharedVal default_val() {
-        return std::make_shared< DemoItvDom >();
+        return make_shared_val< DemoItvDom >();
     }
 
     [[nodiscard]] static SharedVal bottom_val() {
-        return std::make_shared< DemoItvDom >(Bottom{});
+        return make_shared_val< DemoItvDom >(Bottom{});
     }
 
     [[nodiscard]] AbsDomBase* clone() const override {
@@ -66,6 +66,10 @@ class DemoItvDom : public AbsDom< DemoItvDom > {
         }
     }
 
+    [[nodiscard]] bool is_normalized() const override {
+        return is_bottom() || m_lb <= m_ub;
+    }
+
     [[nodiscard]] bool is_bottom() const override { return m_is_bottom; }
 
     [[nodiscard]] bool is_top() const override {
@@ -101,6 +105,22 @@ class DemoItvDom : public AbsDom< DemoItvDom > {
         m_ub = other.m_ub > m_ub ? INT_MAX : m_ub;
     }
 
+    void widen_with_thresholds(const DemoItvDom& other,
+                               const Thresholds& thresholds) {
+        if (is_bottom()) {
+            *this = other;
+            return;
+        }
+        if (other.m_lb < m_lb) {
+            auto lb = thresholds.get_lower(other.m_lb);
+            m_lb = lb && *lb >= INT_MIN ? static_cast< int >(*lb) : INT_MIN;
+        }
+        if (other.m_ub > m_ub) {
+            auto ub = thresholds.get_upper(other.m_ub);
+            m_ub = ub && *ub <= INT_MAX ? static_cast< int >(*ub) : INT_MAX;
+        }
+    }
+
     void meet_with(const DemoItvDom& other) {
         if (is_bottom() || other.is_bottom()) {
             return;
@@ -123,6 +143,14 @@ class DemoItvDom : public AbsDom< DemoItvDom > {
         return m_lb == other.m_lb && m_ub == other.m_ub;
     }
 
+    void Profile(llvm::FoldingSetNodeID& id) const { // NOLINT
+        id.AddBoolean(m_is_bottom);
+        if (!m_is_bottom) {
+            id.AddInteger(m_lb);
+            id.AddInteger(m_ub);
+        }
+    }
+
     void dump(llvm::raw_ostream& os) const override {
         if (is_bottom()) {
             os << "_|_";
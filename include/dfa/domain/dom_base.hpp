@@ -13,35 +13,81 @@
 
 #pragma once
 
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/Support/raw_ostream.h>
 
 #include "dfa/domain/domains.hpp"
+#include "dfa/var_index.hpp"
 #include "support/dom.hpp"
+#include "util/assert.hpp"
 
+#include <array>
+#include <cstdint>
 #include <memory>
 #include <unordered_set>
 
+#ifdef KNIGHT_ATOMIC_DOM_REF_CNT
+#    include <atomic>
+#endif
+
 namespace knight::dfa {
 
-class AbsDomBase;
+struct AbsDomBase;
 
 using DomIDs = std::unordered_set< DomID >;
 using AbsValRef = AbsDomBase*;
 using AbsValConstRef = const AbsDomBase*;
-using SharedVal = std::shared_ptr< AbsDomBase >;
+using SharedVal = llvm::IntrusiveRefCntPtr< AbsDomBase >;
+
+/// \brief Reference count of abstract values.
+///
+/// Abstract values are only shared by the states of one analysis worker,
+/// hence the count is not atomic unless `KNIGHT_ATOMIC_DOM_REF_CNT` is set.
+#ifdef KNIGHT_ATOMIC_DOM_REF_CNT
+using DomRefCnt = std::atomic< unsigned >;
+#else
+using DomRefCnt = unsigned;
+#endif
 
 /// \brief Base for all abstract domains
 ///
 /// Abstract domain should be thread-safe on copy and `const` methods
 struct AbsDomBase {
+  private:
+    /// \brief Intrusive reference count for `SharedVal`, never copied.
+    mutable DomRefCnt m_ref_cnt{0U};
+
+  public:
     DomainKind kind;
 
     /// \brief Create the `Top` abstract value
     explicit AbsDomBase(DomainKind k) : kind(k) {}
 
+    AbsDomBase(const AbsDomBase& other) : kind(other.kind) {}
+    AbsDomBase& operator=(const AbsDomBase& other) {
+        kind = other.kind;
+        return *this;
+    }
+
     virtual ~AbsDomBase() = default;
 
+    /// \brief Retain and release the abstract value for `SharedVal`.
+    /// @{
+    void Retain() const { ++m_ref_cnt; } // NOLINT
+    void Release() const {               // NOLINT
+        knight_assert(m_ref_cnt > 0U);
+        if (--m_ref_cnt == 0U) {
+            delete this;
+        }
+    }
+    /// @}
+
+    /// \brief Whether the value is held by more than one `SharedVal`.
+    [[nodiscard]] bool is_shared() const { return m_ref_cnt > 1U; }
+
     /// \brief Clone the abstract value
     [[nodiscard]] virtual AbsDomBase* clone() const = 0;
 
@@ -53,6 +99,12 @@ struct AbsDomBase {
     /// Default impl is do nothing.
     virtual void normalize() {}
 
+    /// \brief Check if the abstract value is normalized, so that the
+    /// states skip `normalize()` on it.
+    ///
+    /// Default impl is always normalized, as `normalize()` does nothing.
+    [[nodiscard]] virtual bool is_normalized() const { return true; }
+
     /// \brief Check if the abstract value is bottom
     [[nodiscard]] virtual bool is_bottom() const = 0;
 
@@ -76,11 +128,30 @@ struct AbsDomBase {
         this->join_with(other);
     }
 
+    /// \brief Join with all the other abstract values at once, as at the
+    /// merge points of many predecessors.
+    ///
+    /// Default impl joins them one by one.
+    virtual void join_all(llvm::ArrayRef< const AbsDomBase* > others) {
+        for (const auto* other : others) {
+            this->join_with(*other);
+        }
+    }
+
     /// \brief Widen with another abstract value
     ///
     /// default impl is equivalent to `join_with`
     virtual void widen_with(const AbsDomBase& other) { this->join_with(other); }
 
+    /// \brief Widen with another abstract value, stopping at thresholds
+    ///
+    /// default impl is equivalent to `widen_with`
+    virtual void widen_with_thresholds(
+        const AbsDomBase& other,
+        [[maybe_unused]] const Thresholds& thresholds) {
+        this->widen_with(other);
+    }
+
     /// \brief Meet with another abstract value
     ///
     /// default impl is do nothing
@@ -93,6 +164,12 @@ struct AbsDomBase {
         this->meet_with(other);
     }
 
+    /// \brief Forget the numerical variables, which are dead
+    ///
+    /// default impl is do nothing
+    virtual void forget_vars(
+        [[maybe_unused]] llvm::ArrayRef< DenseVarID > vars) {}
+
     /// \brief Check the inclusion relation
     [[nodiscard]] virtual bool leq(const AbsDomBase& other) const = 0;
 
@@ -111,6 +188,16 @@ struct AbsDomBase {
         return !this->equals(other);
     }
 
+    /// \brief Profile the abstract value structurally for hash-consing,
+    /// so that equal values can share one allocation.
+    ///
+    /// default impl does not support hash-consing.
+    /// \return true if the value is profiled.
+    [[nodiscard]] virtual bool profile(
+        [[maybe_unused]] llvm::FoldingSetNodeID& id) const {
+        return false;
+    }
+
     /// \brief dump abstract value for debugging
     ///
     /// default impl is dump nothing
@@ -118,6 +205,83 @@ struct AbsDomBase {
 
 } __attribute__((aligned(4))) __attribute__((packed)); // class AbsDomBase
 
+namespace internal {
+
+/// \brief Free-list pool of the abstract values of one domain.
+///
+/// Freed values are kept in a thread-local free list and reused by the
+/// next allocation of the same domain, so that cloning a value in the
+/// state operators rarely hits the heap.
+template < typename Derived >
+class DomValPool {
+  private:
+    struct FreeNode {
+        FreeNode* next;
+    }; // struct FreeNode
+
+    struct FreeList {
+        FreeNode* head = nullptr;
+
+        FreeList() = default;
+        FreeList(const FreeList&) = delete;
+        FreeList& operator=(const FreeList&) = delete;
+        ~FreeList() {
+            while (head != nullptr) {
+                auto* next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+    }; // struct FreeList
+
+    static FreeList& get_free_list() {
+        static thread_local FreeList free_list;
+        return free_list;
+    }
+
+  public:
+    [[nodiscard]] static void* allocate(std::size_t size) {
+        auto& free_list = get_free_list();
+        if (size != sizeof(Derived) || free_list.head == nullptr) {
+            return ::operator new(size);
+        }
+        auto* node = free_list.head;
+        free_list.head = node->next;
+        return node;
+    }
+
+    static void deallocate(void* ptr, std::size_t size) {
+        if (size != sizeof(Derived)) {
+            ::operator delete(ptr);
+            return;
+        }
+        auto& free_list = get_free_list();
+        auto* node = static_cast< FreeNode* >(ptr);
+        node->next = free_list.head;
+        free_list.head = node;
+    }
+}; // class DomValPool
+
+} // namespace internal
+
+/// \brief Live bytes of the abstract values by domain ID, counted by the
+/// thread which allocated or freed them.
+///
+/// The abstract values are shallowly counted, without the memory held by
+/// their members.
+using DomValBytes = std::array< int64_t, NumDomIDs >;
+
+[[nodiscard]] inline DomValBytes& get_thread_dom_val_bytes() {
+    static thread_local DomValBytes bytes{};
+    return bytes;
+}
+
+/// \brief Create a shared abstract value of the given domain.
+template < typename Domain, typename... Args >
+[[nodiscard]] SharedVal make_shared_val(Args&&... args) {
+    return SharedVal(new Domain(std::forward< Args >(args)...));
+}
+
 /// \brief Base wrapper class for all domains
 ///
 /// `Derived` domain *requires* the following methods:
@@ -134,19 +298,36 @@ struct AbsDomBase {
 /// - `leq(const Derived& other) const`
 ///
 /// `Derived` domain may also implement the following *optional* methods:
-/// - `normalize()`
+/// - `normalize()`, with `is_normalized() const` telling if it is needed
 /// - `join_with_at_loop_head(const Derived& other)`
 /// - `join_consecutive_iter_with(const Derived& other)`
+/// - `join_all(llvm::ArrayRef< const Derived* > others)`
 /// - `widen_with(const Derived& other)`
+/// - `widen_with_thresholds(const Derived& other, const Thresholds&)`
 /// - `meet_with(const Derived& other)`
 /// - `narrow_with(const Derived& other)`
 /// - `equals(const Derived& other) const`
+/// - `Profile(llvm::FoldingSetNodeID& id) const` for hash-consing
 /// - `dump(llvm::Derived& os) const`
 template < typename Derived >
 class AbsDom : public AbsDomBase {
   public:
     AbsDom< Derived >() : AbsDomBase(Derived::get_kind()) {}
 
+    /// \brief Abstract values are allocated from the pool of the domain.
+    /// @{
+    [[nodiscard]] static void* operator new(std::size_t size) {
+        get_thread_dom_val_bytes()[get_domain_id(Derived::get_kind())] +=
+            static_cast< int64_t >(size);
+        return internal::DomValPool< Derived >::allocate(size);
+    }
+    static void operator delete(void* ptr, std::size_t size) {
+        get_thread_dom_val_bytes()[get_domain_id(Derived::get_kind())] -=
+            static_cast< int64_t >(size);
+        internal::DomValPool< Derived >::deallocate(ptr, size);
+    }
+    /// @}
+
     void join_with(const AbsDomBase& other) override {
         static_assert(does_derived_dom_can_join_with< Derived >::value,
                       "derived domain needs to implement `join_with` method");
@@ -174,6 +355,20 @@ class AbsDom : public AbsDomBase {
         }
     }
 
+    void join_all(llvm::ArrayRef< const AbsDomBase* > others) override {
+        if constexpr (does_derived_dom_can_join_all< Derived >::value) {
+            llvm::SmallVector< const Derived*, 8 > derived_others;
+            derived_others.reserve(others.size());
+            for (const auto* other : others) {
+                derived_others.push_back(static_cast< const Derived* >(other));
+            }
+            static_cast< Derived* >(this)->join_all(
+                llvm::ArrayRef< const Derived* >(derived_others));
+        } else {
+            AbsDomBase::join_all(others);
+        }
+    }
+
     void widen_with(const AbsDomBase& other) override {
         if constexpr (does_derived_dom_can_widen_with< Derived >::value) {
             static_cast< Derived* >(this)->widen_with(
@@ -183,6 +378,18 @@ class AbsDom : public AbsDomBase {
         }
     }
 
+    void widen_with_thresholds(const AbsDomBase& other,
+                               const Thresholds& thresholds) override {
+        if constexpr (does_derived_dom_can_widen_with_thresholds<
+                          Derived >::value) {
+            static_cast< Derived* >(this)->widen_with_thresholds(
+                static_cast< const Derived& >(other),
+                thresholds);
+        } else {
+            AbsDom::widen_with(other);
+        }
+    }
+
     void meet_with(const AbsDomBase& other) override {
         if constexpr (does_derived_dom_can_meet_with< Derived >::value) {
             static_cast< Derived* >(this)->meet_with(
@@ -217,6 +424,16 @@ class AbsDom : public AbsDomBase {
         }
     }
 
+    [[nodiscard]] bool profile(llvm::FoldingSetNodeID& id) const override {
+        if constexpr (does_derived_dom_can_profile< Derived >::value) {
+            id.AddInteger(static_cast< unsigned >(Derived::get_kind()));
+            static_cast< const Derived& >(*this).Profile(id);
+            return true;
+        } else {
+            return AbsDomBase::profile(id);
+        }
+    }
+
 }; // class AbsDom
 
 template < typename DerivedDom >
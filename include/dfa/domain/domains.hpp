@@ -15,6 +15,9 @@
 
 #include <llvm/ADT/StringRef.h>
 
+#include <algorithm>
+#include <cstddef>
+
 #ifdef DOMAIN_DEF
 #    undef DOMAIN_DEF
 #endif
@@ -29,6 +32,15 @@ enum class DomainKind {
 #include "domains.def"
 }; // enum class DomainKind
 
+/// \brief The number of the domain IDs, which are dense from 0 and
+/// index the bitsets of the domains.
+constexpr std::size_t NumDomIDs = std::max< std::size_t >({
+    1U,
+#undef DOMAIN_DEF
+#define DOMAIN_DEF(KIND, NAME, ID, DESC) static_cast< std::size_t >(ID) + 1U,
+#include "domains.def"
+});
+
 inline llvm::StringRef get_domain_name(DomainKind kind) {
     switch (kind) {
 #undef DOMAIN_DEF
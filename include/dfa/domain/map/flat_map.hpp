@@ -0,0 +1,266 @@
+//===- flat_map.hpp ---------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the flat map backing the tables of the map
+//  domains, and the table merges used by their lattice operations.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace knight::dfa {
+
+/// \brief A map stored as a vector of entries sorted by key.
+///
+/// Lookups are binary searches, copies are a single allocation, and the
+/// lattice operations merge two tables in one pass over contiguous
+/// memory instead of hashing every key.
+template < typename Key, typename Value, typename Compare = std::less< Key > >
+class FlatMap {
+  public:
+    // NOLINTBEGIN(readability-identifier-naming)
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair< Key, Value >;
+    using Entries = std::vector< value_type >;
+    using iterator = typename Entries::iterator;
+    using const_iterator = typename Entries::const_iterator;
+    // NOLINTEND(readability-identifier-naming)
+
+  private:
+    Entries m_entries;
+
+  public:
+    FlatMap() = default;
+
+  public:
+    [[nodiscard]] iterator begin() { return m_entries.begin(); }
+    [[nodiscard]] iterator end() { return m_entries.end(); }
+    [[nodiscard]] const_iterator begin() const { return m_entries.begin(); }
+    [[nodiscard]] const_iterator end() const { return m_entries.end(); }
+
+    [[nodiscard]] std::size_t size() const { return m_entries.size(); }
+    [[nodiscard]] bool empty() const { return m_entries.empty(); }
+
+    void reserve(std::size_t size) { m_entries.reserve(size); }
+    void swap(FlatMap& other) noexcept { m_entries.swap(other.m_entries); }
+
+    [[nodiscard]] iterator find(const Key& key) {
+        auto it = lower_bound(key);
+        return it != end() && !Compare()(key, it->first) ? it : end();
+    }
+
+    [[nodiscard]] const_iterator find(const Key& key) const {
+        auto it = lower_bound(key);
+        return it != end() && !Compare()(key, it->first) ? it : end();
+    }
+
+    template < typename... Args >
+    std::pair< iterator, bool > emplace(const Key& key, Args&&... args) {
+        auto it = lower_bound(key);
+        if (it != end() && !Compare()(key, it->first)) {
+            return {it, false};
+        }
+        return {m_entries.emplace(it,
+                                  std::piecewise_construct,
+                                  std::forward_as_tuple(key),
+                                  std::forward_as_tuple(
+                                      std::forward< Args >(args)...)),
+                true};
+    }
+
+    template < typename V >
+    std::pair< iterator, bool > insert_or_assign(const Key& key, V&& value) {
+        auto it = lower_bound(key);
+        if (it != end() && !Compare()(key, it->first)) {
+            it->second = std::forward< V >(value);
+            return {it, false};
+        }
+        return {m_entries.emplace(it, key, std::forward< V >(value)), true};
+    }
+
+    Value& operator[](const Key& key) { return emplace(key).first->second; }
+
+    std::size_t erase(const Key& key) {
+        auto it = find(key);
+        if (it == end()) {
+            return 0U;
+        }
+        m_entries.erase(it);
+        return 1U;
+    }
+
+    /// \brief Merge the other table into this one: the values of the
+    /// common keys are combined by `combine(value, other_value)`, and the
+    /// entries only in the other table are copied.
+    template < typename Combine >
+    void union_with(const FlatMap& other, Combine combine) {
+        auto it = m_entries.begin();
+        auto other_it = other.m_entries.begin();
+
+        // Combine in place as long as the other keys are in this table,
+        // which is the common case of the fixpoint iterations.
+        for (; other_it != other.m_entries.end(); ++it, ++other_it) {
+            while (it != m_entries.end() &&
+                   Compare()(it->first, other_it->first)) {
+                ++it;
+            }
+            if (it == m_entries.end() ||
+                Compare()(other_it->first, it->first)) {
+                break;
+            }
+            combine(it->second, other_it->second);
+        }
+        if (other_it == other.m_entries.end()) {
+            return;
+        }
+
+        Entries merged;
+        merged.reserve(m_entries.size() +
+                       static_cast< std::size_t >(
+                           std::distance(other_it, other.m_entries.end())));
+        std::move(m_entries.begin(), it, std::back_inserter(merged));
+        while (it != m_entries.end() && other_it != other.m_entries.end()) {
+            if (Compare()(it->first, other_it->first)) {
+                merged.push_back(std::move(*it++));
+            } else if (Compare()(other_it->first, it->first)) {
+                merged.push_back(*other_it++);
+            } else {
+                combine(it->second, other_it->second);
+                merged.push_back(std::move(*it++));
+                ++other_it;
+            }
+        }
+        std::move(it, m_entries.end(), std::back_inserter(merged));
+        std::copy(other_it, other.m_entries.end(), std::back_inserter(merged));
+        m_entries.swap(merged);
+    }
+
+    /// \brief Whether every key of this table is in the other one, with
+    /// `pred(value, other_value)` holding on their values.
+    template < typename Pred >
+    [[nodiscard]] bool includes(const FlatMap& other, Pred pred) const {
+        if (m_entries.size() > other.m_entries.size()) {
+            return false;
+        }
+        auto other_it = other.m_entries.begin();
+        for (const auto& [key, value] : m_entries) {
+            while (other_it != other.m_entries.end() &&
+                   Compare()(other_it->first, key)) {
+                ++other_it;
+            }
+            if (other_it == other.m_entries.end() ||
+                Compare()(key, other_it->first) ||
+                !pred(value, other_it->second)) {
+                return false;
+            }
+            ++other_it;
+        }
+        return true;
+    }
+
+    /// \brief Call `fn(key, value)` on each entry in key order.
+    template < typename Fn >
+    void for_each_sorted(Fn fn) const {
+        for (const auto& [key, value] : m_entries) {
+            fn(key, value);
+        }
+    }
+
+  private:
+    [[nodiscard]] iterator lower_bound(const Key& key) {
+        return llvm::lower_bound(m_entries, key, compare_key);
+    }
+
+    [[nodiscard]] const_iterator lower_bound(const Key& key) const {
+        return llvm::lower_bound(m_entries, key, compare_key);
+    }
+
+    static bool compare_key(const value_type& entry, const Key& key) {
+        return Compare()(entry.first, key);
+    }
+}; // class FlatMap
+
+/// \brief The table merges of the map domains, on any associative table.
+///
+/// The flat map merges in one pass, the other tables fall back to a
+/// lookup per key.
+/// @{
+template < typename Table, typename Combine >
+void table_union_with(Table& table, const Table& other, Combine combine) {
+    for (const auto& [key, value] : other) {
+        auto it = table.find(key);
+        if (it == table.end()) {
+            table.emplace(key, value);
+        } else {
+            combine(it->second, value);
+        }
+    }
+}
+
+template < typename K, typename V, typename C, typename Combine >
+void table_union_with(FlatMap< K, V, C >& table,
+                      const FlatMap< K, V, C >& other,
+                      Combine combine) {
+    table.union_with(other, std::move(combine));
+}
+
+template < typename Table, typename Pred >
+[[nodiscard]] bool table_includes(const Table& table,
+                                  const Table& other,
+                                  Pred pred) {
+    if (table.size() > other.size()) {
+        return false;
+    }
+    return llvm::all_of(table, [&](const auto& entry) {
+        auto it = other.find(entry.first);
+        return it != other.end() && pred(entry.second, it->second);
+    });
+}
+
+template < typename K, typename V, typename C, typename Pred >
+[[nodiscard]] bool table_includes(const FlatMap< K, V, C >& table,
+                                  const FlatMap< K, V, C >& other,
+                                  Pred pred) {
+    return table.includes(other, std::move(pred));
+}
+
+template < typename Table, typename Fn >
+void table_for_each_sorted(const Table& table, Fn fn) {
+    llvm::SmallVector< const typename Table::value_type* > entries;
+    entries.reserve(table.size());
+    for (const auto& entry : table) {
+        entries.push_back(&entry);
+    }
+    llvm::sort(entries, [](const auto* lhs, const auto* rhs) {
+        return std::less< typename Table::key_type >()(lhs->first,
+                                                       rhs->first);
+    });
+    for (const auto* entry : entries) {
+        fn(entry->first, entry->second);
+    }
+}
+
+template < typename K, typename V, typename C, typename Fn >
+void table_for_each_sorted(const FlatMap< K, V, C >& table, Fn fn) {
+    table.for_each_sorted(std::move(fn));
+}
+/// @}
+
+} // namespace knight::dfa
@@ -15,14 +15,26 @@
 
 #include "dfa/domain/dom_base.hpp"
 #include "dfa/domain/domains.hpp"
+#include "dfa/domain/map/flat_map.hpp"
 #include "support/dumpable.hpp"
 
+#include <llvm/ADT/STLExtras.h>
+
 namespace knight::dfa {
 
-template < typename Key, derived_dom SeparateValue, DomainKind domain_kind >
-class MapDom : public AbsDom< MapDom< Key, SeparateValue, domain_kind > > {
+/// \brief A map from keys to values of a separate domain, where missing
+/// keys are mapped to the default value.
+///
+/// The table is a flat map by default. Any associative table with the
+/// interface of `std::unordered_map` can be used instead.
+template < typename Key,
+           derived_dom SeparateValue,
+           DomainKind domain_kind,
+           typename Table = FlatMap< Key, SeparateValue > >
+class MapDom
+    : public AbsDom< MapDom< Key, SeparateValue, domain_kind, Table > > {
   public:
-    using Map = std::unordered_map< Key, SeparateValue >;
+    using Map = Table;
 
   private:
     Map m_table;
@@ -101,15 +113,11 @@ class MapDom : public AbsDom< MapDom< Key, SeparateValue, domain_kind > > {
   public:
     static DomainKind get_kind() { return domain_kind; }
 
-    static SharedVal default_val() { return std::make_shared< MapDom >(false); }
-    static SharedVal bottom_val() { return std::make_shared< MapDom >(true); }
+    static SharedVal default_val() { return make_shared_val< MapDom >(false); }
+    static SharedVal bottom_val() { return make_shared_val< MapDom >(true); }
 
     [[nodiscard]] AbsDomBase* clone() const override {
-        Map table;
-        for (auto& [key, value] : m_table) {
-            table[key] = *(static_cast< SeparateValue* >(value.clone()));
-        }
-        return new MapDom(m_is_bottom, table);
+        return new MapDom(m_is_bottom, m_table);
     }
 
     void normalize() override {
@@ -118,6 +126,12 @@ class MapDom : public AbsDom< MapDom< Key, SeparateValue, domain_kind > > {
         }
     }
 
+    [[nodiscard]] bool is_normalized() const override {
+        return llvm::all_of(m_table, [](const auto& entry) {
+            return entry.second.is_normalized();
+        });
+    }
+
     [[nodiscard]] bool is_bottom() const override { return m_is_bottom; }
 
     [[nodiscard]] bool is_top() const override {
@@ -142,14 +156,11 @@ class MapDom : public AbsDom< MapDom< Key, SeparateValue, domain_kind > > {
             *this = other;
             return;
         }
-        for (auto& [key, value] : other.m_table) {
-            auto it = m_table.find(key);
-            if (it == m_table.end()) {
-                m_table[key] = value;
-            } else {
-                it->second.join_with(value);
-            }
-        }
+        table_union_with(m_table,
+                         other.m_table,
+                         [](SeparateValue& lhs, const SeparateValue& rhs) {
+                             lhs.join_with(rhs);
+                         });
     }
 
     void join_with_at_loop_head(const MapDom& other) {
@@ -160,14 +171,11 @@ class MapDom : public AbsDom< MapDom< Key, SeparateValue, domain_kind > > {
             *this = other;
             return;
         }
-        for (auto& [key, value] : other.m_table) {
-            auto it = m_table.find(key);
-            if (it == m_table.end()) {
-                m_table[key] = value;
-            } else {
-                it->second.join_with_at_loop_head(value);
-            }
-        }
+        table_union_with(m_table,
+                         other.m_table,
+                         [](SeparateValue& lhs, const SeparateValue& rhs) {
+                             lhs.join_with_at_loop_head(rhs);
+                         });
     }
 
     void join_consecutive_iter_with(const MapDom& other) {
@@ -178,14 +186,11 @@ class MapDom : public AbsDom< MapDom< Key, SeparateValue, domain_kind > > {
             *this = other;
             return;
         }
-        for (auto& [key, value] : other.m_table) {
-            auto it = m_table.find(key);
-            if (it == m_table.end()) {
-                m_table[key] = value;
-            } else {
-                it->second.join_consecutive_iter_with(value);
-            }
-        }
+        table_union_with(m_table,
+                         other.m_table,
+                         [](SeparateValue& lhs, const SeparateValue& rhs) {
+                             lhs.join_consecutive_iter_with(rhs);
+                         });
     }
 
     void widen_with(const MapDom& other) {
@@ -196,14 +201,27 @@ class MapDom : public AbsDom< MapDom< Key, SeparateValue, domain_kind > > {
             *this = other;
             return;
         }
-        for (auto& [key, value] : other.m_table) {
-            auto it = m_table.find(key);
-            if (it == m_table.end()) {
-                m_table[key] = value;
-            } else {
-                it->second.widen_with(value);
-            }
+        table_union_with(m_table,
+                         other.m_table,
+                         [](SeparateValue& lhs, const SeparateValue& rhs) {
+                             lhs.widen_with(rhs);
+                         });
+    }
+
+    void widen_with_thresholds(const MapDom& other,
+                               const Thresholds& thresholds) {
+        if (other.is_bottom()) {
+            return;
         }
+        if (this->is_bottom()) {
+            *this = other;
+            return;
+        }
+        table_union_with(m_table,
+                         other.m_table,
+                         [&](SeparateValue& lhs, const SeparateValue& rhs) {
+                             lhs.widen_with_thresholds(rhs, thresholds);
+                         });
     }
 
     void meet_with(const MapDom& other) {
@@ -214,17 +232,15 @@ class MapDom : public AbsDom< MapDom< Key, SeparateValue, domain_kind > > {
             *this = other;
             return;
         }
-        for (auto& [key, value] : other.m_table) {
-            auto it = m_table.find(key);
-            if (it == m_table.end()) {
-                m_table[key] = value;
-            } else {
-                it->second.meet_with(value);
-                if (it->second.is_bottom()) {
-                    this->set_to_bottom();
-                    return;
-                }
-            }
+        bool has_bottom = false;
+        table_union_with(m_table,
+                         other.m_table,
+                         [&](SeparateValue& lhs, const SeparateValue& rhs) {
+                             lhs.meet_with(rhs);
+                             has_bottom = has_bottom || lhs.is_bottom();
+                         });
+        if (has_bottom) {
+            this->set_to_bottom();
         }
     }
 
@@ -236,17 +252,15 @@ class MapDom : public AbsDom< MapDom< Key, SeparateValue, domain_kind > > {
             *this = other;
             return;
         }
-        for (auto& [key, value] : other.m_table) {
-            auto it = m_table.find(key);
-            if (it == m_table.end()) {
-                m_table[key] = value;
-            } else {
-                it->second.narrow_with(value);
-                if (it->second.is_bottom()) {
-                    this->set_to_bottom();
-                    return;
-                }
-            }
+        bool has_bottom = false;
+        table_union_with(m_table,
+                         other.m_table,
+                         [&](SeparateValue& lhs, const SeparateValue& rhs) {
+                             lhs.narrow_with(rhs);
+                             has_bottom = has_bottom || lhs.is_bottom();
+                         });
+        if (has_bottom) {
+            this->set_to_bottom();
         }
     }
 
@@ -257,19 +271,12 @@ class MapDom : public AbsDom< MapDom< Key, SeparateValue, domain_kind > > {
         if (other.is_bottom()) {
             return false;
         }
-        if (this->m_table.size() > other.m_table.size()) {
-            return false;
-        }
-        for (auto& [key, value] : this->m_table) {
-            auto it = other.m_table.find(key);
-            if (it == other.m_table.end()) {
-                return false;
-            }
-            if (!value.leq(it->second)) {
-                return false;
-            }
-        }
-        return true;
+        return table_includes(m_table,
+                              other.m_table,
+                              [](const SeparateValue& lhs,
+                                 const SeparateValue& rhs) {
+                                  return lhs.leq(rhs);
+                              });
     }
 
     [[nodiscard]] bool equals(const MapDom& other) const {
@@ -279,19 +286,27 @@ class MapDom : public AbsDom< MapDom< Key, SeparateValue, domain_kind > > {
         if (other.is_bottom()) {
             return false;
         }
-        if (this->m_table.size() != other.m_table.size()) {
-            return false;
-        }
-        for (auto& [key, value] : this->m_table) {
-            auto it = other.m_table.find(key);
-            if (it == other.m_table.end()) {
-                return false;
-            }
-            if (!value.equals(it->second)) {
-                return false;
-            }
-        }
-        return true;
+        return m_table.size() == other.m_table.size() &&
+               table_includes(m_table,
+                              other.m_table,
+                              [](const SeparateValue& lhs,
+                                 const SeparateValue& rhs) {
+                                  return lhs.equals(rhs);
+                              });
+    }
+
+    /// \brief Profile the table in key order, so that equal tables have
+    /// the same profile whatever their insertion order.
+    void Profile(llvm::FoldingSetNodeID& id) const // NOLINT
+        requires does_derived_dom_can_profile< SeparateValue >::value
+    {
+        id.AddBoolean(m_is_bottom);
+        table_for_each_sorted(m_table,
+                              [&id](const Key& key,
+                                    const SeparateValue& value) {
+                                  id.Add(key);
+                                  value.Profile(id);
+                              });
     }
 
     void dump(llvm::raw_ostream& os) const override {
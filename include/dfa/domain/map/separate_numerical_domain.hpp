@@ -16,19 +16,30 @@
 #include "dfa/constraint/linear.hpp"
 #include "dfa/domain/dom_base.hpp"
 #include "dfa/domain/domains.hpp"
+#include "dfa/domain/map/flat_map.hpp"
+
+#include <llvm/ADT/STLExtras.h>
 
 namespace knight::dfa {
 
+/// \brief A non-relational numerical domain mapping each variable to a
+/// separate numerical value, stored in a flat map by default.
 template < typename Num,
            typename Var,
            derived_dom SeparateNumericalValue,
-           DomainKind DomKind >
+           DomainKind DomKind,
+           typename Table =
+               FlatMap< typename Var::Ref, SeparateNumericalValue > >
 class SeparateNumericalDom
-    : public AbsDom<
-          SeparateNumericalDom< Num, Var, SeparateNumericalValue, DomKind > > {
+    : public AbsDom< SeparateNumericalDom< Num,
+                                           Var,
+                                           SeparateNumericalValue,
+                                           DomKind,
+                                           Table > > {
   public:
     using VarRef = Var::Ref;
-    using Map = std::unordered_map< VarRef, SeparateNumericalValue >;
+    using Value = SeparateNumericalValue;
+    using Map = Table;
     using LinearExpr = LinearExpr< Num, Var >;
 
   private:
@@ -52,7 +63,7 @@ class SeparateNumericalDom
     }
 
     static SeparateNumericalDom bottom() {
-        return SeparateNumericalDom(false, true);
+        return SeparateNumericalDom(true, false);
     }
 
     const Map& get_table() const { return m_table; }
@@ -119,19 +130,14 @@ class SeparateNumericalDom
     static DomainKind get_kind() { return DomKind; }
 
     static SharedVal default_val() {
-        return std::make_shared< SeparateNumericalDom >(true, false);
+        return make_shared_val< SeparateNumericalDom >(false, true);
     }
     static SharedVal bottom_val() {
-        return std::make_shared< SeparateNumericalDom >(false, true);
+        return make_shared_val< SeparateNumericalDom >(true, false);
     }
 
-    [[nodiscard]] SeparateNumericalValue* clone() const override {
-        Map table;
-        for (auto& [key, value] : m_table) {
-            table[key] =
-                *(static_cast< SeparateNumericalValue* >(value.clone().get()));
-        }
-        return new SeparateNumericalDom(m_is_bottom, m_is_top, table);
+    [[nodiscard]] AbsDomBase* clone() const override {
+        return new SeparateNumericalDom(m_is_bottom, m_is_top, m_table);
     }
 
     void normalize() override {
@@ -140,6 +146,12 @@ class SeparateNumericalDom
         }
     }
 
+    [[nodiscard]] bool is_normalized() const override {
+        return llvm::all_of(m_table, [](const auto& entry) {
+            return entry.second.is_normalized();
+        });
+    }
+
     [[nodiscard]] bool is_bottom() const override {
         return m_is_bottom && !m_is_top;
     }
@@ -161,75 +173,79 @@ class SeparateNumericalDom
     }
 
     void join_with(const SeparateNumericalDom& other) {
-        if (other.is_bottom()) {
+        if (other.is_bottom() || this->is_top()) {
             return;
         }
         if (other.is_top()) {
             this->set_to_top();
             return;
         }
-        for (auto& [key, value] : other.m_table) {
-            auto it = m_table.find(key);
-            if (it == m_table.end()) {
-                m_table[key] = value;
-            } else {
-                it->second.join_with(value);
-            }
+        if (this->is_bottom()) {
+            *this = other;
+            return;
         }
+        table_union_with(m_table,
+                         other.m_table,
+                         [](Value& lhs, const Value& rhs) {
+                             lhs.join_with(rhs);
+                         });
     }
 
     void join_with_at_loop_head(const SeparateNumericalDom& other) {
-        if (other.is_bottom()) {
+        if (other.is_bottom() || this->is_top()) {
             return;
         }
         if (other.is_top()) {
             this->set_to_top();
             return;
         }
-        for (auto& [key, value] : other.m_table) {
-            auto it = m_table.find(key);
-            if (it == m_table.end()) {
-                m_table[key] = value;
-            } else {
-                it->second.join_with_at_loop_head(value);
-            }
+        if (this->is_bottom()) {
+            *this = other;
+            return;
         }
+        table_union_with(m_table,
+                         other.m_table,
+                         [](Value& lhs, const Value& rhs) {
+                             lhs.join_with_at_loop_head(rhs);
+                         });
     }
 
     void join_consecutive_iter_with(const SeparateNumericalDom& other) {
-        if (other.is_bottom()) {
+        if (other.is_bottom() || this->is_top()) {
             return;
         }
         if (other.is_top()) {
             this->set_to_top();
             return;
         }
-        for (auto& [key, value] : other.m_table) {
-            auto it = m_table.find(key);
-            if (it == m_table.end()) {
-                m_table[key] = value;
-            } else {
-                it->second.join_consecutive_iter_with(value);
-            }
+        if (this->is_bottom()) {
+            *this = other;
+            return;
         }
+        table_union_with(m_table,
+                         other.m_table,
+                         [](Value& lhs, const Value& rhs) {
+                             lhs.join_consecutive_iter_with(rhs);
+                         });
     }
 
     void widen_with(const SeparateNumericalDom& other) {
-        if (other.is_bottom()) {
+        if (other.is_bottom() || this->is_top()) {
             return;
         }
         if (other.is_top()) {
             this->set_to_top();
             return;
         }
-        for (auto& [key, value] : other.m_table) {
-            auto it = m_table.find(key);
-            if (it == m_table.end()) {
-                m_table[key] = value;
-            } else {
-                it->second.widen_with(value);
-            }
+        if (this->is_bottom()) {
+            *this = other;
+            return;
         }
+        table_union_with(m_table,
+                         other.m_table,
+                         [](Value& lhs, const Value& rhs) {
+                             lhs.widen_with(rhs);
+                         });
     }
 
     void meet_with(const SeparateNumericalDom& other) {
@@ -240,17 +256,15 @@ class SeparateNumericalDom
             *this = other;
             return;
         }
-        for (auto& [key, value] : other.m_table) {
-            auto it = m_table.find(key);
-            if (it == m_table.end()) {
-                m_table[key] = value;
-            } else {
-                it->second.meet_with(value);
-                if (it->second.is_bottom()) {
-                    this->set_to_bottom();
-                    return;
-                }
-            }
+        bool has_bottom = false;
+        table_union_with(m_table,
+                         other.m_table,
+                         [&](Value& lhs, const Value& rhs) {
+                             lhs.meet_with(rhs);
+                             has_bottom = has_bottom || lhs.is_bottom();
+                         });
+        if (has_bottom) {
+            this->set_to_bottom();
         }
     }
 
@@ -262,17 +276,15 @@ class SeparateNumericalDom
             *this = other;
             return;
         }
-        for (auto& [key, value] : other.m_table) {
-            auto it = m_table.find(key);
-            if (it == m_table.end()) {
-                m_table[key] = value;
-            } else {
-                it->second.narrow_with(value);
-                if (it->second.is_bottom()) {
-                    this->set_to_bottom();
-                    return;
-                }
-            }
+        bool has_bottom = false;
+        table_union_with(m_table,
+                         other.m_table,
+                         [&](Value& lhs, const Value& rhs) {
+                             lhs.narrow_with(rhs);
+                             has_bottom = has_bottom || lhs.is_bottom();
+                         });
+        if (has_bottom) {
+            this->set_to_bottom();
         }
     }
 
@@ -283,19 +295,11 @@ class SeparateNumericalDom
         if (other.is_bottom() || this->is_top()) {
             return false;
         }
-        if (this->m_table.size() > other.m_table.size()) {
-            return false;
-        }
-        for (auto& [key, value] : this->m_table) {
-            auto it = other.m_table.find(key);
-            if (it == other.m_table.end()) {
-                return false;
-            }
-            if (!value.leq(it->second)) {
-                return false;
-            }
-        }
-        return true;
+        return table_includes(m_table,
+                              other.m_table,
+                              [](const Value& lhs, const Value& rhs) {
+                                  return lhs.leq(rhs);
+                              });
     }
 
     bool equals(const SeparateNumericalDom& other) const {
@@ -311,19 +315,12 @@ class SeparateNumericalDom
         if (other.is_top()) {
             return false;
         }
-        if (this->m_table.size() != other.m_table.size()) {
-            return false;
-        }
-        for (auto& [key, value] : this->m_table) {
-            auto it = other.m_table.find(key);
-            if (it == other.m_table.end()) {
-                return false;
-            }
-            if (!value.equals(it->second)) {
-                return false;
-            }
-        }
-        return true;
+        return m_table.size() == other.m_table.size() &&
+               table_includes(m_table,
+                              other.m_table,
+                              [](const Value& lhs, const Value& rhs) {
+                                  return lhs.equals(rhs);
+                              });
     }
 
     void dump(llvm::raw_ostream& os) const override {
@@ -356,15 +353,28 @@ class SeparateNumericalDom
         if (this->is_bottom()) {
             *this = other;
         } else {
-            for (auto& [key, sep_num_value] : other.m_table) {
-                auto it = m_table.find(key);
-                if (it == m_table.end()) {
-                    m_table[key] = sep_num_value;
-                } else {
-                    it->second.widening_threshold(sep_num_value, threshold);
-                }
-            }
+            table_union_with(m_table,
+                             other.m_table,
+                             [&](Value& lhs, const Value& rhs) {
+                                 lhs.widening_threshold(rhs, threshold);
+                             });
+        }
+    }
+
+    void widen_with_thresholds(const SeparateNumericalDom& other,
+                               const Thresholds& thresholds) {
+        if (other.is_bottom() || this->is_top()) {
+            return;
         }
+        if (this->is_bottom()) {
+            *this = other;
+            return;
+        }
+        table_union_with(m_table,
+                         other.m_table,
+                         [&](Value& lhs, const Value& rhs) {
+                             lhs.widen_with_thresholds(rhs, thresholds);
+                         });
     }
 
     void narrow_with_threshold(const SeparateNumericalDom& other,
@@ -376,17 +386,15 @@ class SeparateNumericalDom
             *this = other;
             return;
         }
-        for (auto& [key, value] : other.m_table) {
-            auto it = m_table.find(key);
-            if (it == m_table.end()) {
-                m_table[key] = value;
-            } else {
-                it->second.narrow_with_threshold(value, threshold);
-                if (it->second.is_bottom()) {
-                    this->set_to_bottom();
-                    return;
-                }
-            }
+        bool has_bottom = false;
+        table_union_with(m_table,
+                         other.m_table,
+                         [&](Value& lhs, const Value& rhs) {
+                             lhs.narrow_with_threshold(rhs, threshold);
+                             has_bottom = has_bottom || lhs.is_bottom();
+                         });
+        if (has_bottom) {
+            this->set_to_bottom();
         }
     }
 
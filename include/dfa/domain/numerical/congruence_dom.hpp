@@ -0,0 +1,276 @@
+//===- congruence_dom.hpp ---------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the congruence environment domain.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/domain/dom_base.hpp"
+#include "dfa/domain/domains.hpp"
+#include "dfa/domain/numerical/numerical_base.hpp"
+#include "dfa/var_index.hpp"
+#include "util/znum.hpp"
+
+#include <llvm/ADT/FoldingSet.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <optional>
+#include <vector>
+
+namespace knight::dfa {
+
+/// \brief The integers `a * k + b` for all the integers k, written
+/// `aZ + b`.
+///
+/// The modulus `a` is non-negative. A zero modulus stands for the
+/// constant `b`, and otherwise `0 <= b < a`, so that each congruence has
+/// a unique representation. The top congruence is `1Z + 0`.
+class Congruence {
+  private:
+    ZNum m_mod{1};
+    ZNum m_rem{0};
+
+  public:
+    Congruence() = default;
+    Congruence(ZNum mod, ZNum rem);
+
+    [[nodiscard]] static Congruence top() { return {}; }
+
+    [[nodiscard]] static Congruence constant(ZNum n) {
+        return {ZNum(0), std::move(n)};
+    }
+
+    [[nodiscard]] const ZNum& get_modulus() const { return m_mod; }
+    [[nodiscard]] const ZNum& get_remainder() const { return m_rem; }
+
+    [[nodiscard]] bool is_top() const { return m_mod == 1; }
+
+    [[nodiscard]] std::optional< ZNum > get_constant() const {
+        if (m_mod == 0) {
+            return m_rem;
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]] bool contains(const ZNum& n) const;
+
+    /// \brief The lattice operations, where the meet is none if the
+    /// congruences are disjoint.
+    /// @{
+    [[nodiscard]] Congruence join(const Congruence& other) const;
+    [[nodiscard]] std::optional< Congruence > meet(
+        const Congruence& other) const;
+    [[nodiscard]] bool leq(const Congruence& other) const;
+    /// @}
+
+    /// \brief The arithmetic over the congruences, where the division
+    /// rounds toward zero and the remainder has the sign of the dividend,
+    /// as in C.
+    /// @{
+    [[nodiscard]] Congruence operator-() const;
+    [[nodiscard]] Congruence operator+(const Congruence& other) const;
+    [[nodiscard]] Congruence operator-(const Congruence& other) const;
+    [[nodiscard]] Congruence operator*(const Congruence& other) const;
+    [[nodiscard]] Congruence scale(const ZNum& k) const;
+    [[nodiscard]] Congruence div(const ZNum& k) const;
+    [[nodiscard]] Congruence rem(const ZNum& k) const;
+    /// @}
+
+    [[nodiscard]] friend bool operator==(const Congruence& lhs,
+                                         const Congruence& rhs) {
+        return lhs.m_mod == rhs.m_mod && lhs.m_rem == rhs.m_rem;
+    }
+
+    void Profile(llvm::FoldingSetNodeID& id) const { // NOLINT
+        m_mod.Profile(id);
+        m_rem.Profile(id);
+    }
+
+    void dump(llvm::raw_ostream& os) const;
+}; // class Congruence
+
+/// \brief A non-relational environment from the dense variable IDs to
+/// the congruences, which keeps the alignments and the strides that the
+/// intervals lose.
+///
+/// The congruences are stored in an array indexed by the IDs, where the
+/// variables past the array are top, and the array never ends with a top
+/// congruence. Each operation is constant time per variable, and the
+/// lattice has no infinite ascending chain, so that the widening is the
+/// join.
+class CongruenceEnvDom
+    : public NumericalDom< CongruenceEnvDom, ZNum, DenseVar > {
+  private:
+    std::vector< Congruence > m_congs;
+    bool m_is_bottom = false;
+
+  public:
+    explicit CongruenceEnvDom(bool is_bottom = false)
+        : m_is_bottom(is_bottom) {}
+
+    CongruenceEnvDom(const CongruenceEnvDom&) = default;
+    CongruenceEnvDom(CongruenceEnvDom&&) = default;
+    CongruenceEnvDom& operator=(const CongruenceEnvDom&) = default;
+    CongruenceEnvDom& operator=(CongruenceEnvDom&&) = default;
+    ~CongruenceEnvDom() override = default;
+
+  public:
+    [[nodiscard]] static CongruenceEnvDom top() { return CongruenceEnvDom(); }
+
+    [[nodiscard]] static CongruenceEnvDom bottom() {
+        return CongruenceEnvDom(true);
+    }
+
+    /// \brief Get the number of the stored variables, the others being
+    /// top.
+    [[nodiscard]] std::size_t get_size() const { return m_congs.size(); }
+
+    /// \brief Get the congruence of the variable, which is top if the
+    /// environment is bottom.
+    [[nodiscard]] Congruence get_congruence(DenseVarID id) const {
+        if (m_is_bottom || id >= m_congs.size()) {
+            return Congruence::top();
+        }
+        return m_congs[id];
+    }
+
+    void set_congruence(DenseVarID id, Congruence cong);
+
+    /// \brief Meet the congruence of the variable with `cong`.
+    void meet_congruence(DenseVarID id, const Congruence& cong);
+
+    void forget(DenseVarID id) override {
+        if (m_is_bottom || id >= m_congs.size()) {
+            return;
+        }
+        m_congs[id] = Congruence::top();
+        this->trim();
+    }
+
+  public:
+    [[nodiscard]] static DomainKind get_kind() {
+        return DomainKind::CongruenceEnvDom;
+    }
+
+    [[nodiscard]] static SharedVal default_val() {
+        return make_shared_val< CongruenceEnvDom >();
+    }
+
+    [[nodiscard]] static SharedVal bottom_val() {
+        return make_shared_val< CongruenceEnvDom >(true);
+    }
+
+    [[nodiscard]] AbsDomBase* clone() const override {
+        return new CongruenceEnvDom(*this);
+    }
+
+    [[nodiscard]] bool is_bottom() const override { return m_is_bottom; }
+
+    [[nodiscard]] bool is_top() const override {
+        return !m_is_bottom && m_congs.empty();
+    }
+
+    void set_to_bottom() override {
+        m_is_bottom = true;
+        std::vector< Congruence >().swap(m_congs);
+    }
+
+    void set_to_top() override {
+        m_is_bottom = false;
+        std::vector< Congruence >().swap(m_congs);
+    }
+
+    void join_with(const CongruenceEnvDom& other);
+
+    void widen_with(const CongruenceEnvDom& other) { this->join_with(other); }
+
+    void widen_with_thresholds(const CongruenceEnvDom& other,
+                               const Thresholds& /*thresholds*/) {
+        this->join_with(other);
+    }
+
+    void widen_with_threshold(const CongruenceEnvDom& other,
+                              const ZNum& /*threshold*/) {
+        this->join_with(other);
+    }
+
+    void meet_with(const CongruenceEnvDom& other);
+
+    /// \brief Only the top congruences are refined, as the meet has
+    /// infinite descending chains.
+    void narrow_with(const CongruenceEnvDom& other);
+
+    void narrow_with_threshold(const CongruenceEnvDom& other,
+                               const ZNum& /*threshold*/) {
+        this->narrow_with(other);
+    }
+
+    [[nodiscard]] bool leq(const CongruenceEnvDom& other) const;
+
+    [[nodiscard]] bool equals(const CongruenceEnvDom& other) const {
+        return m_is_bottom == other.m_is_bottom && m_congs == other.m_congs;
+    }
+
+    void Profile(llvm::FoldingSetNodeID& id) const { // NOLINT
+        id.AddBoolean(m_is_bottom);
+        id.AddInteger(m_congs.size());
+        for (const auto& cong : m_congs) {
+            cong.Profile(id);
+        }
+    }
+
+    void dump(llvm::raw_ostream& os) const override;
+
+  public:
+    void transfer_assign_constant(VarRef x, const ZNum& n) override;
+    void transfer_assign_variable(VarRef x, VarRef y) override;
+    void transfer_assign_linear_expr(VarRef x,
+                                     const LinearExpr& expr) override;
+
+    void apply(clang::UnaryOperatorKind op, VarRef x, VarRef y) override;
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               VarRef y,
+               VarRef z) override;
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               VarRef y,
+               const ZNum& z) override;
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               const ZNum& y,
+               VarRef z) override;
+
+    void add_linear_constraint(const LinearConstraint& cst) override;
+    void merge_with_linear_constraint_system(
+        const LinearConstraintSystem& csts) override;
+
+  private:
+    [[nodiscard]] Congruence eval_congruence(const LinearExpr& expr) const;
+
+    /// \brief Add the constraint `expr == 0`.
+    void add_equality(const LinearExpr& expr);
+
+    /// \brief Apply `x = y op z` on the congruences of the operands.
+    void apply_congruences(clang::BinaryOperatorKind op,
+                           VarRef x,
+                           const Congruence& y,
+                           const Congruence& z);
+
+    /// \brief Drop the top congruences at the end of the array.
+    void trim() {
+        while (!m_congs.empty() && m_congs.back().is_top()) {
+            m_congs.pop_back();
+        }
+    }
+}; // class CongruenceEnvDom
+
+} // namespace knight::dfa
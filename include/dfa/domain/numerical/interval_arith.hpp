@@ -0,0 +1,134 @@
+//===- interval_arith.hpp ---------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the arithmetic of the unbounded intervals.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "util/znum.hpp"
+
+#include <algorithm>
+#include <array>
+#include <optional>
+
+namespace knight::dfa {
+
+/// \brief An interval, unbounded on a side without a value.
+struct ZInterval {
+    std::optional< ZNum > lb;
+    std::optional< ZNum > ub;
+}; // struct ZInterval
+
+namespace itv {
+
+/// \brief The interval arithmetic, where a missing bound is infinite.
+/// @{
+[[nodiscard]] inline ZInterval neg(const ZInterval& itv) {
+    ZInterval res;
+    if (itv.ub) {
+        res.lb = -*itv.ub;
+    }
+    if (itv.lb) {
+        res.ub = -*itv.lb;
+    }
+    return res;
+}
+
+[[nodiscard]] inline ZInterval add(const ZInterval& lhs,
+                                   const ZInterval& rhs) {
+    ZInterval res;
+    if (lhs.lb && rhs.lb) {
+        res.lb = *lhs.lb + *rhs.lb;
+    }
+    if (lhs.ub && rhs.ub) {
+        res.ub = *lhs.ub + *rhs.ub;
+    }
+    return res;
+}
+
+[[nodiscard]] inline ZInterval scale(const ZInterval& itv, const ZNum& k) {
+    if (k == 0) {
+        return {ZNum(0), ZNum(0)};
+    }
+    ZInterval res;
+    if (itv.lb) {
+        (k > 0 ? res.lb : res.ub) = *itv.lb * k;
+    }
+    if (itv.ub) {
+        (k > 0 ? res.ub : res.lb) = *itv.ub * k;
+    }
+    return res;
+}
+
+[[nodiscard]] inline ZInterval mul(const ZInterval& lhs,
+                                   const ZInterval& rhs) {
+    if (lhs.lb && lhs.lb == lhs.ub) {
+        return scale(rhs, *lhs.lb);
+    }
+    if (rhs.lb && rhs.lb == rhs.ub) {
+        return scale(lhs, *rhs.lb);
+    }
+    if (!lhs.lb || !lhs.ub || !rhs.lb || !rhs.ub) {
+        return {};
+    }
+    const std::array< ZNum, 4U > products{*lhs.lb * *rhs.lb,
+                                          *lhs.lb * *rhs.ub,
+                                          *lhs.ub * *rhs.lb,
+                                          *lhs.ub * *rhs.ub};
+    const auto [min, max] =
+        std::minmax_element(products.begin(), products.end());
+    return {*min, *max};
+}
+
+/// \brief The division rounding toward zero by a non-zero constant,
+/// which is monotonic in the dividend.
+[[nodiscard]] inline ZInterval div(const ZInterval& itv, const ZNum& k) {
+    ZInterval res;
+    if (itv.lb) {
+        (k > 0 ? res.lb : res.ub) = *itv.lb / k;
+    }
+    if (itv.ub) {
+        (k > 0 ? res.ub : res.lb) = *itv.ub / k;
+    }
+    return res;
+}
+
+[[nodiscard]] inline std::optional< ZNum > get_singleton(
+    const ZInterval& itv) {
+    if (itv.lb && itv.lb == itv.ub) {
+        return itv.lb;
+    }
+    return std::nullopt;
+}
+/// @}
+
+/// \brief The divisions rounding toward the infinities.
+/// @{
+[[nodiscard]] inline ZNum floor_div(const ZNum& lhs, const ZNum& rhs) {
+    ZNum quotient = lhs / rhs;
+    if (lhs % rhs != 0 && ((lhs < 0) != (rhs < 0))) {
+        quotient -= 1;
+    }
+    return quotient;
+}
+
+[[nodiscard]] inline ZNum ceil_div(const ZNum& lhs, const ZNum& rhs) {
+    ZNum quotient = lhs / rhs;
+    if (lhs % rhs != 0 && ((lhs < 0) == (rhs < 0))) {
+        quotient += 1;
+    }
+    return quotient;
+}
+/// @}
+
+} // namespace itv
+
+} // namespace knight::dfa
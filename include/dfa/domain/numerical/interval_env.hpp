@@ -0,0 +1,414 @@
+//===- interval_env.hpp -----------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the interval environment domain.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/domain/dom_base.hpp"
+#include "dfa/domain/domains.hpp"
+#include "dfa/domain/numerical/interval_arith.hpp"
+#include "dfa/domain/numerical/interval_kernels.hpp"
+#include "dfa/domain/numerical/numerical_base.hpp"
+#include "dfa/var_index.hpp"
+#include "util/znum.hpp"
+
+#include <llvm/ADT/FoldingSet.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace knight::dfa {
+
+/// \brief A non-relational environment from the dense variable IDs to
+/// 64-bit intervals.
+///
+/// The lower and the upper bounds are stored in two arrays indexed by the
+/// IDs, so that the lattice operations run as vectorized kernels over
+/// contiguous memory. The variables past the arrays are unbounded, and
+/// the arrays never end with an unbounded variable, so that each value
+/// has a unique representation.
+///
+/// The numerical transfers evaluate the assigned expressions by the
+/// interval arithmetic, and propagate the constraints to the bounds of
+/// each of their variables once.
+class IntervalEnvDom : public NumericalDom< IntervalEnvDom, ZNum, DenseVar > {
+  public:
+    using Bound = ItvBound;
+    using Bounds = std::pair< Bound, Bound >;
+
+  private:
+    std::vector< Bound > m_lbs;
+    std::vector< Bound > m_ubs;
+    bool m_is_bottom = false;
+
+  public:
+    explicit IntervalEnvDom(bool is_bottom = false) : m_is_bottom(is_bottom) {}
+
+    IntervalEnvDom(const IntervalEnvDom&) = default;
+    IntervalEnvDom(IntervalEnvDom&&) = default;
+    IntervalEnvDom& operator=(const IntervalEnvDom&) = default;
+    IntervalEnvDom& operator=(IntervalEnvDom&&) = default;
+    ~IntervalEnvDom() override = default;
+
+  public:
+    [[nodiscard]] static IntervalEnvDom top() { return IntervalEnvDom(); }
+
+    [[nodiscard]] static IntervalEnvDom bottom() {
+        return IntervalEnvDom(true);
+    }
+
+    /// \brief Get the number of the stored variables, the others being
+    /// unbounded.
+    [[nodiscard]] std::size_t get_size() const { return m_lbs.size(); }
+
+    /// \brief Get the bounds of the variable, which are empty if the
+    /// environment is bottom.
+    [[nodiscard]] Bounds get_bounds(DenseVarID id) const {
+        if (m_is_bottom) {
+            return {ItvPlusInf, ItvMinusInf};
+        }
+        if (id >= m_lbs.size()) {
+            return {ItvMinusInf, ItvPlusInf};
+        }
+        return {m_lbs[id], m_ubs[id]};
+    }
+
+    void set_bounds(DenseVarID id, Bound lb, Bound ub) {
+        if (m_is_bottom) {
+            return;
+        }
+        if (lb > ub) {
+            this->set_to_bottom();
+            return;
+        }
+        if (id >= m_lbs.size()) {
+            if (is_unbounded(lb, ub)) {
+                return;
+            }
+            m_lbs.resize(id + 1U, ItvMinusInf);
+            m_ubs.resize(id + 1U, ItvPlusInf);
+        }
+        m_lbs[id] = lb;
+        m_ubs[id] = ub;
+        this->trim();
+    }
+
+    void meet_bounds(DenseVarID id, Bound lb, Bound ub) {
+        auto [old_lb, old_ub] = this->get_bounds(id);
+        this->set_bounds(id, std::max(lb, old_lb), std::min(ub, old_ub));
+    }
+
+    /// \brief Get the bounds of the variable as an interval.
+    [[nodiscard]] ZInterval get_interval(DenseVarID id) const;
+
+    /// \brief Set the bounds of the variable to the interval, relaxing
+    /// the bounds out of the 64-bit range.
+    void set_interval(DenseVarID id, const ZInterval& itv);
+
+    /// \brief Meet the bounds of the variable with the interval.
+    void meet_interval(DenseVarID id, const ZInterval& itv);
+
+    void forget(DenseVarID id) override {
+        if (m_is_bottom || id >= m_lbs.size()) {
+            return;
+        }
+        m_lbs[id] = ItvMinusInf;
+        m_ubs[id] = ItvPlusInf;
+        this->trim();
+    }
+
+  public:
+    [[nodiscard]] static DomainKind get_kind() {
+        return DomainKind::IntervalEnvDom;
+    }
+
+    [[nodiscard]] static SharedVal default_val() {
+        return make_shared_val< IntervalEnvDom >();
+    }
+
+    [[nodiscard]] static SharedVal bottom_val() {
+        return make_shared_val< IntervalEnvDom >(true);
+    }
+
+    [[nodiscard]] AbsDomBase* clone() const override {
+        return new IntervalEnvDom(*this);
+    }
+
+    [[nodiscard]] bool is_bottom() const override { return m_is_bottom; }
+
+    [[nodiscard]] bool is_top() const override {
+        return !m_is_bottom && m_lbs.empty();
+    }
+
+    void set_to_bottom() override {
+        m_is_bottom = true;
+        this->clear();
+    }
+
+    void set_to_top() override {
+        m_is_bottom = false;
+        this->clear();
+    }
+
+    void join_with(const IntervalEnvDom& other) {
+        if (other.m_is_bottom) {
+            return;
+        }
+        if (m_is_bottom) {
+            *this = other;
+            return;
+        }
+        // The variables unbounded in the other environment stay unbounded.
+        this->truncate(other.m_lbs.size());
+        join_itv_bounds(this->get_bounds_ref(), other.get_bounds_ref());
+        this->trim();
+    }
+
+    void widen_with(const IntervalEnvDom& other) {
+        if (other.m_is_bottom) {
+            return;
+        }
+        if (m_is_bottom) {
+            *this = other;
+            return;
+        }
+        this->truncate(other.m_lbs.size());
+        widen_itv_bounds(this->get_bounds_ref(), other.get_bounds_ref());
+        this->trim();
+    }
+
+    void widen_with_thresholds(const IntervalEnvDom& other,
+                               const Thresholds& thresholds) {
+        if (other.m_is_bottom) {
+            return;
+        }
+        if (m_is_bottom) {
+            *this = other;
+            return;
+        }
+        this->truncate(other.m_lbs.size());
+        for (std::size_t i = 0U; i < m_lbs.size(); ++i) {
+            if (other.m_lbs[i] < m_lbs[i]) {
+                m_lbs[i] = thresholds.get_lower(other.m_lbs[i])
+                               .value_or(ItvMinusInf);
+            }
+            if (other.m_ubs[i] > m_ubs[i]) {
+                m_ubs[i] = thresholds.get_upper(other.m_ubs[i])
+                               .value_or(ItvPlusInf);
+            }
+        }
+        this->trim();
+    }
+
+    void meet_with(const IntervalEnvDom& other) {
+        if (m_is_bottom) {
+            return;
+        }
+        if (other.m_is_bottom) {
+            this->set_to_bottom();
+            return;
+        }
+        // The variables unbounded in this environment take the other
+        // bounds, the common ones are intersected.
+        const std::size_t common = std::min(m_lbs.size(), other.m_lbs.size());
+        const auto offset = static_cast< std::ptrdiff_t >(common);
+        m_lbs.insert(m_lbs.end(),
+                     other.m_lbs.begin() + offset,
+                     other.m_lbs.end());
+        m_ubs.insert(m_ubs.end(),
+                     other.m_ubs.begin() + offset,
+                     other.m_ubs.end());
+        if (meet_itv_bounds({m_lbs.data(), m_ubs.data(), common},
+                            other.get_bounds_ref())) {
+            this->set_to_bottom();
+        }
+    }
+
+    void narrow_with(const IntervalEnvDom& other) {
+        if (m_is_bottom) {
+            return;
+        }
+        if (other.m_is_bottom) {
+            this->set_to_bottom();
+            return;
+        }
+        // Only the infinite bounds are refined.
+        if (m_lbs.size() < other.m_lbs.size()) {
+            m_lbs.resize(other.m_lbs.size(), ItvMinusInf);
+            m_ubs.resize(other.m_ubs.size(), ItvPlusInf);
+        }
+        for (std::size_t i = 0U; i < other.m_lbs.size(); ++i) {
+            if (m_lbs[i] == ItvMinusInf) {
+                m_lbs[i] = other.m_lbs[i];
+            }
+            if (m_ubs[i] == ItvPlusInf) {
+                m_ubs[i] = other.m_ubs[i];
+            }
+            if (m_lbs[i] > m_ubs[i]) {
+                this->set_to_bottom();
+                return;
+            }
+        }
+    }
+
+    void widen_with_threshold(const IntervalEnvDom& other,
+                              const ZNum& threshold);
+
+    void narrow_with_threshold(const IntervalEnvDom& other,
+                               const ZNum& /*threshold*/) {
+        this->narrow_with(other);
+    }
+
+    [[nodiscard]] bool leq(const IntervalEnvDom& other) const {
+        if (m_is_bottom) {
+            return true;
+        }
+        if (other.m_is_bottom) {
+            return false;
+        }
+        // The last variable bounded in the other environment is unbounded
+        // in this one.
+        if (m_lbs.size() < other.m_lbs.size()) {
+            return false;
+        }
+        return leq_itv_bounds({m_lbs.data(), m_ubs.data(), other.m_lbs.size()},
+                              other.get_bounds_ref());
+    }
+
+    [[nodiscard]] bool equals(const IntervalEnvDom& other) const {
+        return m_is_bottom == other.m_is_bottom && m_lbs == other.m_lbs &&
+               m_ubs == other.m_ubs;
+    }
+
+    void Profile(llvm::FoldingSetNodeID& id) const { // NOLINT
+        id.AddBoolean(m_is_bottom);
+        id.AddInteger(m_lbs.size());
+        for (std::size_t i = 0U; i < m_lbs.size(); ++i) {
+            id.AddInteger(m_lbs[i]);
+            id.AddInteger(m_ubs[i]);
+        }
+    }
+
+    void dump(llvm::raw_ostream& os) const override {
+        if (m_is_bottom) {
+            os << "_|_";
+            return;
+        }
+        os << "{";
+        bool first = true;
+        for (std::size_t i = 0U; i < m_lbs.size(); ++i) {
+            if (is_unbounded(m_lbs[i], m_ubs[i])) {
+                continue;
+            }
+            if (!first) {
+                os << ", ";
+            }
+            os << "v" << i << ": ";
+            dump_bounds(os, m_lbs[i], m_ubs[i]);
+            first = false;
+        }
+        os << "}";
+    }
+
+    static void dump_bounds(llvm::raw_ostream& os, Bound lb, Bound ub) {
+        if (lb == ub) {
+            os << lb;
+            return;
+        }
+        os << "[";
+        if (lb == ItvMinusInf) {
+            os << "-oo";
+        } else {
+            os << lb;
+        }
+        os << ", ";
+        if (ub == ItvPlusInf) {
+            os << "+oo";
+        } else {
+            os << ub;
+        }
+        os << "]";
+    }
+
+  public:
+    void transfer_assign_constant(VarRef x, const ZNum& n) override;
+    void transfer_assign_variable(VarRef x, VarRef y) override;
+    void transfer_assign_linear_expr(VarRef x,
+                                     const LinearExpr& expr) override;
+
+    void apply(clang::UnaryOperatorKind op, VarRef x, VarRef y) override;
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               VarRef y,
+               VarRef z) override;
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               VarRef y,
+               const ZNum& z) override;
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               const ZNum& y,
+               VarRef z) override;
+
+    void add_linear_constraint(const LinearConstraint& cst) override;
+    void merge_with_linear_constraint_system(
+        const LinearConstraintSystem& csts) override;
+
+  private:
+    [[nodiscard]] ZInterval eval_interval(const LinearExpr& expr) const;
+
+    /// \brief Add the constraint `expr <= 0`.
+    void add_inequality(const LinearExpr& expr);
+
+    /// \brief Apply `x = y op z` on the intervals of the operands.
+    void apply_intervals(clang::BinaryOperatorKind op,
+                         VarRef x,
+                         const ZInterval& y,
+                         const ZInterval& z);
+
+    [[nodiscard]] static bool is_unbounded(Bound lb, Bound ub) {
+        return lb == ItvMinusInf && ub == ItvPlusInf;
+    }
+
+    [[nodiscard]] ItvBounds get_bounds_ref() {
+        return {m_lbs.data(), m_ubs.data(), m_lbs.size()};
+    }
+
+    [[nodiscard]] ConstItvBounds get_bounds_ref() const {
+        return {m_lbs.data(), m_ubs.data(), m_lbs.size()};
+    }
+
+    void clear() {
+        std::vector< Bound >().swap(m_lbs);
+        std::vector< Bound >().swap(m_ubs);
+    }
+
+    void truncate(std::size_t size) {
+        if (m_lbs.size() > size) {
+            m_lbs.resize(size);
+            m_ubs.resize(size);
+        }
+    }
+
+    /// \brief Drop the unbounded variables at the end of the arrays.
+    void trim() {
+        std::size_t size = m_lbs.size();
+        while (size > 0U && is_unbounded(m_lbs[size - 1U], m_ubs[size - 1U])) {
+            --size;
+        }
+        this->truncate(size);
+    }
+}; // class IntervalEnvDom
+
+} // namespace knight::dfa
@@ -0,0 +1,71 @@
+//===- interval_kernels.hpp -------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the vectorized kernels over the bound arrays of
+//  the interval environments.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace knight::dfa {
+
+/// \brief A bound of an interval, where the extreme values stand for the
+/// infinities so that min and max need no special case for them.
+/// @{
+using ItvBound = int64_t;
+constexpr ItvBound ItvMinusInf = std::numeric_limits< ItvBound >::min();
+constexpr ItvBound ItvPlusInf = std::numeric_limits< ItvBound >::max();
+/// @}
+
+/// \brief The lower and upper bound arrays of `size` intervals.
+/// @{
+struct ItvBounds {
+    ItvBound* lbs;
+    ItvBound* ubs;
+    std::size_t size;
+}; // struct ItvBounds
+
+struct ConstItvBounds {
+    const ItvBound* lbs;
+    const ItvBound* ubs;
+    std::size_t size;
+}; // struct ConstItvBounds
+/// @}
+
+/// \brief The kernels combine the first `bounds.size` intervals with the
+/// ones of `other`, which must have at least as many.
+/// @{
+
+/// \brief lb = min(lb, other_lb), ub = max(ub, other_ub)
+void join_itv_bounds(ItvBounds bounds, ConstItvBounds other);
+
+/// \brief lb = max(lb, other_lb), ub = min(ub, other_ub)
+///
+/// \return true if some interval became empty.
+[[nodiscard]] bool meet_itv_bounds(ItvBounds bounds, ConstItvBounds other);
+
+/// \brief Move the bounds growing in `other` to the infinities.
+void widen_itv_bounds(ItvBounds bounds, ConstItvBounds other);
+
+/// \brief Whether each interval is included in the one of `other`.
+[[nodiscard]] bool leq_itv_bounds(ConstItvBounds bounds,
+                                  ConstItvBounds other);
+/// @}
+
+/// \brief Get the instruction set the kernels are compiled for.
+[[nodiscard]] llvm::StringRef get_itv_kernels_isa();
+
+} // namespace knight::dfa
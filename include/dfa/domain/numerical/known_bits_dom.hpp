@@ -0,0 +1,291 @@
+//===- known_bits_dom.hpp ---------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the known bits environment domain.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/domain/dom_base.hpp"
+#include "dfa/domain/domains.hpp"
+#include "dfa/domain/numerical/numerical_base.hpp"
+#include "dfa/var_index.hpp"
+#include "util/znum.hpp"
+
+#include <llvm/ADT/FoldingSet.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace knight::dfa {
+
+/// \brief The bits known to be zero and the ones known to be one among
+/// the low 64 bits of the two's complement of an integer.
+///
+/// The low bits of the sums, the products, the left shifts and the
+/// bitwise operations only depend on the low bits of their operands, so
+/// that the unbounded integers are soundly tracked by their low bits.
+struct KnownBits {
+    uint64_t zeros = 0U;
+    uint64_t ones = 0U;
+
+    /// \brief Get the bits of the low 64 bits of the number.
+    [[nodiscard]] static KnownBits constant(const ZNum& n);
+
+    [[nodiscard]] static KnownBits constant(uint64_t bits) {
+        return {~bits, bits};
+    }
+
+    [[nodiscard]] uint64_t get_known() const { return zeros | ones; }
+
+    [[nodiscard]] bool is_top() const { return this->get_known() == 0U; }
+
+    [[nodiscard]] bool is_constant() const {
+        return this->get_known() == ~uint64_t(0);
+    }
+
+    /// \brief Whether a bit is known both ways, i.e., no value has them.
+    [[nodiscard]] bool has_conflict() const { return (zeros & ones) != 0U; }
+
+    /// \brief Get the number of the low bits which are all known.
+    [[nodiscard]] unsigned get_known_low_bits() const;
+
+    [[nodiscard]] KnownBits join(const KnownBits& other) const {
+        return {zeros & other.zeros, ones & other.ones};
+    }
+
+    /// \brief The meet, which has a conflict if the bits are disjoint.
+    [[nodiscard]] KnownBits meet(const KnownBits& other) const {
+        return {zeros | other.zeros, ones | other.ones};
+    }
+
+    [[nodiscard]] bool leq(const KnownBits& other) const {
+        return (other.zeros & ~zeros) == 0U && (other.ones & ~ones) == 0U;
+    }
+
+    /// \brief The transfers over the known bits.
+    /// @{
+    [[nodiscard]] KnownBits operator~() const { return {ones, zeros}; }
+    [[nodiscard]] KnownBits operator-() const;
+    [[nodiscard]] KnownBits operator+(const KnownBits& other) const;
+    [[nodiscard]] KnownBits operator-(const KnownBits& other) const;
+    [[nodiscard]] KnownBits operator*(const KnownBits& other) const;
+
+    [[nodiscard]] KnownBits operator&(const KnownBits& other) const {
+        return {zeros | other.zeros, ones & other.ones};
+    }
+
+    [[nodiscard]] KnownBits operator|(const KnownBits& other) const {
+        return {zeros & other.zeros, ones | other.ones};
+    }
+
+    [[nodiscard]] KnownBits operator^(const KnownBits& other) const {
+        return {(zeros & other.zeros) | (ones & other.ones),
+                (zeros & other.ones) | (ones & other.zeros)};
+    }
+
+    [[nodiscard]] KnownBits shl(unsigned k) const;
+
+    /// \brief The arithmetic right shift, where the high bits are unknown.
+    [[nodiscard]] KnownBits shr(unsigned k) const;
+
+    /// \brief The remainder of the division by a non-zero constant.
+    [[nodiscard]] KnownBits rem(const ZNum& k) const;
+    /// @}
+
+    [[nodiscard]] friend bool operator==(const KnownBits& lhs,
+                                         const KnownBits& rhs) {
+        return lhs.zeros == rhs.zeros && lhs.ones == rhs.ones;
+    }
+
+    void dump(llvm::raw_ostream& os) const;
+}; // struct KnownBits
+
+/// \brief A non-relational environment from the dense variable IDs to
+/// their known bits, which keeps the flags and the masks that the
+/// intervals lose.
+///
+/// The bits are stored in an array indexed by the IDs, where the
+/// variables past the array are top, and the array never ends with a top
+/// value. Each operation is constant time per variable, and the lattice
+/// has a finite height, so that the widening is the join.
+class KnownBitsEnvDom
+    : public NumericalDom< KnownBitsEnvDom, ZNum, DenseVar > {
+  private:
+    std::vector< KnownBits > m_bits;
+    bool m_is_bottom = false;
+
+  public:
+    explicit KnownBitsEnvDom(bool is_bottom = false)
+        : m_is_bottom(is_bottom) {}
+
+    KnownBitsEnvDom(const KnownBitsEnvDom&) = default;
+    KnownBitsEnvDom(KnownBitsEnvDom&&) = default;
+    KnownBitsEnvDom& operator=(const KnownBitsEnvDom&) = default;
+    KnownBitsEnvDom& operator=(KnownBitsEnvDom&&) = default;
+    ~KnownBitsEnvDom() override = default;
+
+  public:
+    [[nodiscard]] static KnownBitsEnvDom top() { return KnownBitsEnvDom(); }
+
+    [[nodiscard]] static KnownBitsEnvDom bottom() {
+        return KnownBitsEnvDom(true);
+    }
+
+    /// \brief Get the number of the stored variables, the others being
+    /// top.
+    [[nodiscard]] std::size_t get_size() const { return m_bits.size(); }
+
+    /// \brief Get the bits of the variable, which are top if the
+    /// environment is bottom.
+    [[nodiscard]] KnownBits get_bits(DenseVarID id) const {
+        if (m_is_bottom || id >= m_bits.size()) {
+            return {};
+        }
+        return m_bits[id];
+    }
+
+    void set_bits(DenseVarID id, KnownBits bits);
+
+    /// \brief Meet the bits of the variable with `bits`.
+    void meet_bits(DenseVarID id, const KnownBits& bits) {
+        this->set_bits(id, this->get_bits(id).meet(bits));
+    }
+
+    void forget(DenseVarID id) override {
+        if (m_is_bottom || id >= m_bits.size()) {
+            return;
+        }
+        m_bits[id] = {};
+        this->trim();
+    }
+
+  public:
+    [[nodiscard]] static DomainKind get_kind() {
+        return DomainKind::KnownBitsEnvDom;
+    }
+
+    [[nodiscard]] static SharedVal default_val() {
+        return make_shared_val< KnownBitsEnvDom >();
+    }
+
+    [[nodiscard]] static SharedVal bottom_val() {
+        return make_shared_val< KnownBitsEnvDom >(true);
+    }
+
+    [[nodiscard]] AbsDomBase* clone() const override {
+        return new KnownBitsEnvDom(*this);
+    }
+
+    [[nodiscard]] bool is_bottom() const override { return m_is_bottom; }
+
+    [[nodiscard]] bool is_top() const override {
+        return !m_is_bottom && m_bits.empty();
+    }
+
+    void set_to_bottom() override {
+        m_is_bottom = true;
+        std::vector< KnownBits >().swap(m_bits);
+    }
+
+    void set_to_top() override {
+        m_is_bottom = false;
+        std::vector< KnownBits >().swap(m_bits);
+    }
+
+    void join_with(const KnownBitsEnvDom& other);
+
+    void widen_with(const KnownBitsEnvDom& other) { this->join_with(other); }
+
+    void widen_with_thresholds(const KnownBitsEnvDom& other,
+                               const Thresholds& /*thresholds*/) {
+        this->join_with(other);
+    }
+
+    void widen_with_threshold(const KnownBitsEnvDom& other,
+                              const ZNum& /*threshold*/) {
+        this->join_with(other);
+    }
+
+    void meet_with(const KnownBitsEnvDom& other);
+
+    void narrow_with(const KnownBitsEnvDom& other) { this->meet_with(other); }
+
+    void narrow_with_threshold(const KnownBitsEnvDom& other,
+                               const ZNum& /*threshold*/) {
+        this->meet_with(other);
+    }
+
+    [[nodiscard]] bool leq(const KnownBitsEnvDom& other) const;
+
+    [[nodiscard]] bool equals(const KnownBitsEnvDom& other) const {
+        return m_is_bottom == other.m_is_bottom && m_bits == other.m_bits;
+    }
+
+    void Profile(llvm::FoldingSetNodeID& id) const { // NOLINT
+        id.AddBoolean(m_is_bottom);
+        id.AddInteger(m_bits.size());
+        for (const auto& bits : m_bits) {
+            id.AddInteger(bits.zeros);
+            id.AddInteger(bits.ones);
+        }
+    }
+
+    void dump(llvm::raw_ostream& os) const override;
+
+  public:
+    void transfer_assign_constant(VarRef x, const ZNum& n) override;
+    void transfer_assign_variable(VarRef x, VarRef y) override;
+    void transfer_assign_linear_expr(VarRef x,
+                                     const LinearExpr& expr) override;
+
+    void apply(clang::UnaryOperatorKind op, VarRef x, VarRef y) override;
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               VarRef y,
+               VarRef z) override;
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               VarRef y,
+               const ZNum& z) override;
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               const ZNum& y,
+               VarRef z) override;
+
+    void add_linear_constraint(const LinearConstraint& cst) override;
+    void merge_with_linear_constraint_system(
+        const LinearConstraintSystem& csts) override;
+
+  private:
+    [[nodiscard]] KnownBits eval_bits(const LinearExpr& expr) const;
+
+    /// \brief Add the constraint `expr == 0`.
+    void add_equality(const LinearExpr& expr);
+
+    /// \brief Apply `x = y op z` on the bits of the operands, where `k`
+    /// is the right operand if it is a constant.
+    void apply_bits(clang::BinaryOperatorKind op,
+                    VarRef x,
+                    const KnownBits& y,
+                    const KnownBits& z,
+                    const std::optional< ZNum >& k);
+
+    /// \brief Drop the top values at the end of the array.
+    void trim() {
+        while (!m_bits.empty() && m_bits.back().is_top()) {
+            m_bits.pop_back();
+        }
+    }
+}; // class KnownBitsEnvDom
+
+} // namespace knight::dfa
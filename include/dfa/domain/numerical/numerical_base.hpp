@@ -18,6 +18,8 @@
 
 #include <clang/AST/OperationKinds.h>
 
+#include <type_traits>
+
 namespace knight::dfa {
 
 /// Base for all numerical domains. (Linear for currently);
@@ -89,6 +91,16 @@ class NumericalDom : public AbsDom< Derived > {
     /// \brief Forget a numerical variable
     virtual void forget(VarRef x) = 0;
 
+    /// \brief Forget the dead variables, when the domain is over the dense
+    /// variable IDs.
+    void forget_vars(llvm::ArrayRef< DenseVarID > vars) override {
+        if constexpr (std::is_same_v< VarRef, DenseVarID >) {
+            for (DenseVarID x : vars) {
+                this->forget(x);
+            }
+        }
+    }
+
 }; // class NumericalDom
 
 } // namespace knight::dfa
\ No newline at end of file
@@ -0,0 +1,651 @@
+//===- packed_dom.hpp -------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the packing of the relational numerical domains.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/domain/dom_base.hpp"
+#include "dfa/domain/domains.hpp"
+#include "dfa/domain/map/flat_map.hpp"
+#include "dfa/domain/numerical/numerical_base.hpp"
+#include "dfa/domain/numerical/zone_dom.hpp"
+#include "dfa/var_index.hpp"
+#include "util/znum.hpp"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace knight::dfa {
+
+/// \brief A union-find over the dense variable IDs.
+class VarUnionFind {
+  private:
+    llvm::DenseMap< DenseVarID, DenseVarID > m_parents;
+
+  public:
+    [[nodiscard]] DenseVarID find(DenseVarID var) {
+        auto it = m_parents.try_emplace(var, var).first;
+        while (it->second != var) {
+            // Path halving.
+            auto parent_it = m_parents.find(it->second);
+            it->second = parent_it->second;
+            var = it->second;
+            it = m_parents.find(var);
+        }
+        return var;
+    }
+
+    void unite(DenseVarID lhs, DenseVarID rhs) {
+        lhs = this->find(lhs);
+        rhs = this->find(rhs);
+        if (lhs != rhs) {
+            m_parents[std::max(lhs, rhs)] = std::min(lhs, rhs);
+        }
+    }
+}; // class VarUnionFind
+
+/// \brief A relational numerical domain partitioning the variables into
+/// independent packs, each one a small value of the `Pack` domain.
+///
+/// Two variables are in the same pack once a constraint or an assignment
+/// relates them, so that the cost of the relational operations depends on
+/// the size of the packs instead of the number of variables. The packs
+/// are reference counted and copied on write: copying a value shares all
+/// of its packs, and the lattice operations keep the packs shared by both
+/// sides without touching them.
+///
+/// The `Pack` domain shall be a numerical domain over the dense variables,
+/// giving its constrained variables in increasing order by `get_vars()`.
+/// The variables out of the packs are unbounded.
+template < typename Num, derived_dom Pack, DomainKind DomKind >
+class PackedNumericalDom
+    : public NumericalDom< PackedNumericalDom< Num, Pack, DomKind >,
+                           Num,
+                           DenseVar > {
+  public:
+    using Base = NumericalDom< PackedNumericalDom, Num, DenseVar >;
+    using VarRef = typename Base::VarRef;
+    using LinearExpr = typename Base::LinearExpr;
+    using LinearConstraint = typename Base::LinearConstraint;
+    using LinearConstraintSystem = typename Base::LinearConstraintSystem;
+    using PackRef = llvm::IntrusiveRefCntPtr< Pack >;
+
+    /// \brief The packs keyed by their least variable.
+    using Packs = FlatMap< DenseVarID, PackRef >;
+
+  private:
+    /// \brief The packs of both values over a class of the variables
+    /// related in either value.
+    struct Group {
+        llvm::SmallVector< PackRef, 2 > packs;
+        llvm::SmallVector< PackRef, 2 > other_packs;
+    }; // struct Group
+
+  private:
+    Packs m_packs;
+
+    /// \brief The key of the pack of each packed variable.
+    FlatMap< DenseVarID, DenseVarID > m_pack_keys;
+
+    bool m_is_bottom = false;
+
+  public:
+    explicit PackedNumericalDom(bool is_bottom = false)
+        : m_is_bottom(is_bottom) {}
+
+    PackedNumericalDom(const PackedNumericalDom&) = default;
+    PackedNumericalDom(PackedNumericalDom&&) = default;
+    PackedNumericalDom& operator=(const PackedNumericalDom&) = default;
+    PackedNumericalDom& operator=(PackedNumericalDom&&) = default;
+    ~PackedNumericalDom() override = default;
+
+  public:
+    [[nodiscard]] static PackedNumericalDom top() {
+        return PackedNumericalDom();
+    }
+
+    [[nodiscard]] static PackedNumericalDom bottom() {
+        return PackedNumericalDom(true);
+    }
+
+    /// \brief Get the pack of the variable, or null if it is unbounded.
+    [[nodiscard]] const Pack* get_pack(VarRef x) const {
+        auto it = m_pack_keys.find(x);
+        if (it == m_pack_keys.end()) {
+            return nullptr;
+        }
+        return m_packs.find(it->second)->second.get();
+    }
+
+    [[nodiscard]] const Packs& get_packs() const { return m_packs; }
+
+  public:
+    [[nodiscard]] static DomainKind get_kind() { return DomKind; }
+
+    [[nodiscard]] static SharedVal default_val() {
+        return make_shared_val< PackedNumericalDom >();
+    }
+
+    [[nodiscard]] static SharedVal bottom_val() {
+        return make_shared_val< PackedNumericalDom >(true);
+    }
+
+    [[nodiscard]] AbsDomBase* clone() const override {
+        return new PackedNumericalDom(*this);
+    }
+
+    void normalize() override {
+        for (auto& [_, pack] : m_packs) {
+            if (pack->is_normalized()) {
+                continue;
+            }
+            get_unique(pack).normalize();
+            if (pack->is_bottom()) {
+                this->set_to_bottom();
+                return;
+            }
+        }
+    }
+
+    [[nodiscard]] bool is_normalized() const override {
+        return m_is_bottom ||
+               llvm::all_of(m_packs, [](const auto& entry) {
+                   return entry.second->is_normalized();
+               });
+    }
+
+    [[nodiscard]] bool is_bottom() const override { return m_is_bottom; }
+
+    [[nodiscard]] bool is_top() const override {
+        return !m_is_bottom && m_packs.empty();
+    }
+
+    void set_to_bottom() override {
+        m_is_bottom = true;
+        this->clear();
+    }
+
+    void set_to_top() override {
+        m_is_bottom = false;
+        this->clear();
+    }
+
+    void join_with(const PackedNumericalDom& other) {
+        if (other.m_is_bottom) {
+            return;
+        }
+        if (m_is_bottom) {
+            *this = other;
+            return;
+        }
+        this->combine_groups(other,
+                             /*keep_unpaired=*/false,
+                             [](Pack& pack, const Pack& other_pack) {
+                                 pack.join_with(other_pack);
+                             });
+    }
+
+    void widen_with(const PackedNumericalDom& other) {
+        if (other.m_is_bottom) {
+            return;
+        }
+        if (m_is_bottom) {
+            *this = other;
+            return;
+        }
+        this->combine_groups(other,
+                             /*keep_unpaired=*/false,
+                             [](Pack& pack, const Pack& other_pack) {
+                                 pack.widen_with(other_pack);
+                             });
+    }
+
+    void widen_with_thresholds(const PackedNumericalDom& other,
+                               const Thresholds& thresholds) {
+        if (other.m_is_bottom) {
+            return;
+        }
+        if (m_is_bottom) {
+            *this = other;
+            return;
+        }
+        this->combine_groups(other,
+                             /*keep_unpaired=*/false,
+                             [&](Pack& pack, const Pack& other_pack) {
+                                 pack.widen_with_thresholds(other_pack,
+                                                            thresholds);
+                             });
+    }
+
+    void widen_with_threshold(const PackedNumericalDom& other,
+                              const Num& threshold) {
+        if (other.m_is_bottom) {
+            return;
+        }
+        if (m_is_bottom) {
+            *this = other;
+            return;
+        }
+        this->combine_groups(other,
+                             /*keep_unpaired=*/false,
+                             [&](Pack& pack, const Pack& other_pack) {
+                                 pack.widen_with_threshold(other_pack,
+                                                           threshold);
+                             });
+    }
+
+    void meet_with(const PackedNumericalDom& other) {
+        if (m_is_bottom) {
+            return;
+        }
+        if (other.m_is_bottom) {
+            this->set_to_bottom();
+            return;
+        }
+        this->combine_groups(other,
+                             /*keep_unpaired=*/true,
+                             [](Pack& pack, const Pack& other_pack) {
+                                 pack.meet_with(other_pack);
+                             });
+    }
+
+    void narrow_with(const PackedNumericalDom& other) {
+        if (m_is_bottom) {
+            return;
+        }
+        if (other.m_is_bottom) {
+            this->set_to_bottom();
+            return;
+        }
+        this->combine_groups(other,
+                             /*keep_unpaired=*/true,
+                             [](Pack& pack, const Pack& other_pack) {
+                                 pack.narrow_with(other_pack);
+                             });
+    }
+
+    void narrow_with_threshold(const PackedNumericalDom& other,
+                               const Num& threshold) {
+        if (m_is_bottom) {
+            return;
+        }
+        if (other.m_is_bottom) {
+            this->set_to_bottom();
+            return;
+        }
+        this->combine_groups(other,
+                             /*keep_unpaired=*/true,
+                             [&](Pack& pack, const Pack& other_pack) {
+                                 pack.narrow_with_threshold(other_pack,
+                                                            threshold);
+                             });
+    }
+
+    [[nodiscard]] bool leq(const PackedNumericalDom& other) const {
+        if (m_is_bottom) {
+            return true;
+        }
+        if (other.m_is_bottom) {
+            return false;
+        }
+        for (auto& group : this->get_groups(other)) {
+            if (group.other_packs.empty()) {
+                continue;
+            }
+            if (group.packs.empty()) {
+                return false;
+            }
+            if (is_same_pack(group)) {
+                continue;
+            }
+            if (!meet_packs(group.packs)->leq(*meet_packs(group.other_packs))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool equals(const PackedNumericalDom& other) const {
+        return this->leq(other) && other.leq(*this);
+    }
+
+    void Profile(llvm::FoldingSetNodeID& id) const { // NOLINT
+        id.AddBoolean(m_is_bottom);
+        for (const auto& [key, pack] : m_packs) {
+            id.AddInteger(key);
+            pack->Profile(id);
+        }
+    }
+
+    void dump(llvm::raw_ostream& os) const override {
+        if (m_is_bottom) {
+            os << "_|_";
+            return;
+        }
+        os << "{";
+        bool first = true;
+        for (const auto& [_, pack] : m_packs) {
+            if (!first) {
+                os << ", ";
+            }
+            pack->dump(os);
+            first = false;
+        }
+        os << "}";
+    }
+
+  public:
+    void transfer_assign_constant(VarRef x, const Num& n) override {
+        this->assign(x, {}, [&](Pack& pack) {
+            pack.transfer_assign_constant(x, n);
+        });
+    }
+
+    void transfer_assign_variable(VarRef x, VarRef y) override {
+        this->assign(x, {y}, [&](Pack& pack) {
+            pack.transfer_assign_variable(x, y);
+        });
+    }
+
+    void transfer_assign_linear_expr(VarRef x,
+                                     const LinearExpr& expr) override {
+        this->assign(x, get_expr_vars(expr), [&](Pack& pack) {
+            pack.transfer_assign_linear_expr(x, expr);
+        });
+    }
+
+    void apply(clang::UnaryOperatorKind op, VarRef x, VarRef y) override {
+        this->assign(x, {y}, [&](Pack& pack) { pack.apply(op, x, y); });
+    }
+
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               VarRef y,
+               VarRef z) override {
+        this->assign(x, {y, z}, [&](Pack& pack) { pack.apply(op, x, y, z); });
+    }
+
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               VarRef y,
+               const Num& z) override {
+        this->assign(x, {y}, [&](Pack& pack) { pack.apply(op, x, y, z); });
+    }
+
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               const Num& y,
+               VarRef z) override {
+        this->assign(x, {z}, [&](Pack& pack) { pack.apply(op, x, y, z); });
+    }
+
+    void add_linear_constraint(const LinearConstraint& cst) override {
+        this->update(get_expr_vars(cst.get_linear_expression()),
+                     [&](Pack& pack) { pack.add_linear_constraint(cst); });
+    }
+
+    void merge_with_linear_constraint_system(
+        const LinearConstraintSystem& csts) override {
+        LinearConstraintSystem normalized_csts(csts);
+        normalized_csts.normalize();
+        if (normalized_csts.is_false()) {
+            this->set_to_bottom();
+            return;
+        }
+        for (const auto& cst : normalized_csts) {
+            this->add_linear_constraint(cst);
+            if (m_is_bottom) {
+                return;
+            }
+        }
+    }
+
+    void forget(VarRef x) override {
+        if (m_pack_keys.find(x) == m_pack_keys.end()) {
+            return;
+        }
+        this->update({x}, [&](Pack& pack) { pack.forget(x); });
+    }
+
+  private:
+    void clear() {
+        Packs().swap(m_packs);
+        FlatMap< DenseVarID, DenseVarID >().swap(m_pack_keys);
+    }
+
+    [[nodiscard]] static llvm::SmallVector< VarRef, 4 > get_expr_vars(
+        const LinearExpr& expr) {
+        llvm::SmallVector< VarRef, 4 > vars;
+        for (const auto& [var, _] : expr.get_variable_terms()) {
+            vars.push_back(var);
+        }
+        return vars;
+    }
+
+    /// \brief Get the pack for a mutation, copying it if it is shared.
+    static Pack& get_unique(PackRef& pack) {
+        if (pack->is_shared()) {
+            pack = PackRef(static_cast< Pack* >(pack->clone()));
+        }
+        return *pack;
+    }
+
+    /// \brief Get the product of packs over disjoint variables.
+    [[nodiscard]] static PackRef meet_packs(llvm::ArrayRef< PackRef > packs) {
+        if (packs.size() == 1U) {
+            return packs.front();
+        }
+        // Meet the smaller packs into a copy of the largest one.
+        const auto* largest =
+            std::max_element(packs.begin(),
+                             packs.end(),
+                             [](const PackRef& lhs, const PackRef& rhs) {
+                                 return lhs->get_vars().size() <
+                                        rhs->get_vars().size();
+                             });
+        PackRef product(static_cast< Pack* >((*largest)->clone()));
+        for (const auto& pack : packs) {
+            if (&pack != largest) {
+                product->meet_with(*pack);
+            }
+        }
+        return product;
+    }
+
+    [[nodiscard]] static bool is_same_pack(const Group& group) {
+        return group.packs.size() == 1U && group.other_packs.size() == 1U &&
+               group.packs.front() == group.other_packs.front();
+    }
+
+    /// \brief Get the groups of the packs of both values, where the packs
+    /// of a group are over the classes of the variables related in either
+    /// value.
+    [[nodiscard]] std::vector< Group > get_groups(
+        const PackedNumericalDom& other) const {
+        std::vector< Group > groups;
+
+        // Both values have the same partition in the common case of the
+        // fixpoint iterations, which pairs the packs one to one.
+        if (m_packs.size() == other.m_packs.size() &&
+            llvm::all_of(llvm::zip(m_packs, other.m_packs), [](auto entries) {
+                const auto& [entry, other_entry] = entries;
+                return entry.first == other_entry.first &&
+                       (entry.second == other_entry.second ||
+                        entry.second->get_vars() ==
+                            other_entry.second->get_vars());
+            })) {
+            groups.reserve(m_packs.size());
+            for (const auto& [entry, other_entry] :
+                 llvm::zip(m_packs, other.m_packs)) {
+                groups.push_back({{entry.second}, {other_entry.second}});
+            }
+            return groups;
+        }
+
+        VarUnionFind classes;
+        auto unite = [&classes](const Packs& packs) {
+            for (const auto& [key, pack] : packs) {
+                for (DenseVarID var : pack->get_vars()) {
+                    classes.unite(key, var);
+                }
+            }
+        };
+        unite(m_packs);
+        unite(other.m_packs);
+
+        llvm::DenseMap< DenseVarID, std::size_t > group_indices;
+        auto collect = [&](const Packs& packs, bool is_other) {
+            for (const auto& [key, pack] : packs) {
+                auto [it, inserted] =
+                    group_indices.try_emplace(classes.find(key),
+                                              groups.size());
+                if (inserted) {
+                    groups.emplace_back();
+                }
+                auto& group = groups[it->second];
+                (is_other ? group.other_packs : group.packs).push_back(pack);
+            }
+        };
+        collect(m_packs, /*is_other=*/false);
+        collect(other.m_packs, /*is_other=*/true);
+        return groups;
+    }
+
+    /// \brief Combine the packs of each group by `combine(pack,
+    /// other_pack)`, where the groups with packs on a single side are kept
+    /// if `keep_unpaired` is set, and dropped otherwise.
+    template < typename Combine >
+    void combine_groups(const PackedNumericalDom& other,
+                        bool keep_unpaired,
+                        Combine combine) {
+        auto groups = this->get_groups(other);
+        // Release the packs of this value so that only the groups own
+        // them, and they can be mutated without copy.
+        this->clear();
+
+        std::vector< PackRef > packs;
+        packs.reserve(groups.size());
+        for (auto& group : groups) {
+            if (group.packs.empty() || group.other_packs.empty()) {
+                if (keep_unpaired) {
+                    llvm::append_range(packs, group.packs);
+                    llvm::append_range(packs, group.other_packs);
+                }
+                continue;
+            }
+            // The operations are idempotent.
+            if (is_same_pack(group)) {
+                packs.push_back(std::move(group.packs.front()));
+                continue;
+            }
+            PackRef pack = meet_packs(group.packs);
+            group.packs.clear();
+            combine(get_unique(pack), *meet_packs(group.other_packs));
+            if (pack->is_bottom()) {
+                this->set_to_bottom();
+                return;
+            }
+            if (!pack->is_top()) {
+                packs.push_back(std::move(pack));
+            }
+        }
+
+        llvm::sort(packs, [](const PackRef& lhs, const PackRef& rhs) {
+            return lhs->get_vars().front() < rhs->get_vars().front();
+        });
+        m_packs.reserve(packs.size());
+        for (auto& pack : packs) {
+            const DenseVarID key = pack->get_vars().front();
+            for (DenseVarID var : pack->get_vars()) {
+                m_pack_keys.emplace(var, key);
+            }
+            m_packs.emplace(key, std::move(pack));
+        }
+    }
+
+    /// \brief Apply `fn` to the pack of the variables, merging their packs.
+    template < typename Fn >
+    void update(llvm::ArrayRef< VarRef > vars, Fn fn) {
+        if (m_is_bottom) {
+            return;
+        }
+        llvm::SmallVector< DenseVarID, 4 > keys;
+        for (VarRef var : vars) {
+            auto it = m_pack_keys.find(var);
+            if (it != m_pack_keys.end() &&
+                !llvm::is_contained(keys, it->second)) {
+                keys.push_back(it->second);
+            }
+        }
+
+        llvm::SmallVector< PackRef, 4 > packs;
+        llvm::SmallVector< DenseVarID, 8 > old_vars;
+        for (DenseVarID key : keys) {
+            auto& pack = m_packs.find(key)->second;
+            llvm::append_range(old_vars, pack->get_vars());
+            packs.push_back(std::move(pack));
+        }
+        PackRef pack = packs.empty() ? PackRef(new Pack()) : meet_packs(packs);
+        packs.clear();
+
+        fn(get_unique(pack));
+        if (pack->is_bottom()) {
+            this->set_to_bottom();
+            return;
+        }
+
+        const auto& new_vars = pack->get_vars();
+        const DenseVarID new_key = new_vars.empty() ? 0U : new_vars.front();
+        for (DenseVarID key : keys) {
+            if (key != new_key || new_vars.empty()) {
+                m_packs.erase(key);
+            }
+        }
+        for (DenseVarID var : old_vars) {
+            if (!std::binary_search(new_vars.begin(), new_vars.end(), var)) {
+                m_pack_keys.erase(var);
+            }
+        }
+        if (new_vars.empty()) {
+            return;
+        }
+        for (DenseVarID var : new_vars) {
+            m_pack_keys.insert_or_assign(var, new_key);
+        }
+        m_packs.insert_or_assign(new_key, std::move(pack));
+    }
+
+    /// \brief Apply the assignment `fn` of `x` from the variables, where
+    /// `x` leaves its pack unless it is assigned from itself.
+    template < typename Fn >
+    void assign(VarRef x, llvm::ArrayRef< VarRef > vars, Fn fn) {
+        if (!llvm::is_contained(vars, x)) {
+            this->forget(x);
+        }
+        llvm::SmallVector< VarRef, 4 > assigned_vars(vars.begin(), vars.end());
+        assigned_vars.push_back(x);
+        this->update(assigned_vars, std::move(fn));
+    }
+}; // class PackedNumericalDom
+
+using PackedZoneDom =
+    PackedNumericalDom< ZNum, ZoneDom, DomainKind::PackedZoneDom >;
+
+} // namespace knight::dfa
@@ -0,0 +1,599 @@
+//===- product_dom.hpp ------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the reduced product of the numerical domains.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/domain/dom_base.hpp"
+#include "dfa/domain/domains.hpp"
+#include "dfa/domain/numerical/congruence_dom.hpp"
+#include "dfa/domain/numerical/interval_env.hpp"
+#include "dfa/domain/numerical/known_bits_dom.hpp"
+#include "dfa/domain/numerical/numerical_base.hpp"
+#include "dfa/domain/numerical/packed_dom.hpp"
+#include "dfa/var_index.hpp"
+#include "util/assert.hpp"
+#include "util/znum.hpp"
+
+#include <llvm/ADT/FoldingSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace knight::dfa {
+
+/// \brief The reduction of the `Dom` component of a product by its
+/// `Other` component, applied by the products once specialized with
+/// `static void reduce(Dom&, const Other&)`.
+template < typename Dom, typename Other >
+struct DomReduction; // struct DomReduction
+
+template < typename Dom, typename Other >
+concept reducible_dom_by = requires(Dom& dom, const Other& other) {
+    DomReduction< Dom, Other >::reduce(dom, other);
+};
+
+/// \brief Tighten the intervals by the ones implied by the zones.
+template <>
+struct DomReduction< IntervalEnvDom, PackedZoneDom > {
+    static void reduce(IntervalEnvDom& itvs, const PackedZoneDom& zones) {
+        for (const auto& [_, pack] : zones.get_packs()) {
+            for (DenseVarID var : pack->get_vars()) {
+                itvs.meet_interval(var, pack->get_interval(var));
+                if (itvs.is_bottom()) {
+                    return;
+                }
+            }
+        }
+    }
+}; // struct DomReduction< IntervalEnvDom, PackedZoneDom >
+
+/// \brief Tighten the bounds to the nearest values of the congruences.
+template <>
+struct DomReduction< IntervalEnvDom, CongruenceEnvDom > {
+    static void reduce(IntervalEnvDom& itvs, const CongruenceEnvDom& congs);
+}; // struct DomReduction< IntervalEnvDom, CongruenceEnvDom >
+
+/// \brief Set the congruences of the singleton intervals.
+template <>
+struct DomReduction< CongruenceEnvDom, IntervalEnvDom > {
+    static void reduce(CongruenceEnvDom& congs, const IntervalEnvDom& itvs);
+}; // struct DomReduction< CongruenceEnvDom, IntervalEnvDom >
+
+/// \brief Set the congruences modulo 2^n of the n known low bits.
+template <>
+struct DomReduction< CongruenceEnvDom, KnownBitsEnvDom > {
+    static void reduce(CongruenceEnvDom& congs, const KnownBitsEnvDom& bits);
+}; // struct DomReduction< CongruenceEnvDom, KnownBitsEnvDom >
+
+/// \brief Set the high bits that the bounds fix by their signs, and all
+/// the bits of the singleton intervals.
+template <>
+struct DomReduction< KnownBitsEnvDom, IntervalEnvDom > {
+    static void reduce(KnownBitsEnvDom& bits, const IntervalEnvDom& itvs);
+}; // struct DomReduction< KnownBitsEnvDom, IntervalEnvDom >
+
+/// \brief Set the low bits below the trailing zeros of the moduli.
+template <>
+struct DomReduction< KnownBitsEnvDom, CongruenceEnvDom > {
+    static void reduce(KnownBitsEnvDom& bits, const CongruenceEnvDom& congs);
+}; // struct DomReduction< KnownBitsEnvDom, CongruenceEnvDom >
+
+/// \brief The components of a product selected at run time, as the mask
+/// of their positions.
+using ProductComponents = uint32_t;
+
+/// \brief The reduced product of numerical domains over the dense
+/// variables, whose components are stored inline in the value.
+///
+/// The components to run are selected at run time, the others staying
+/// top and skipped by all the operations, so that a cheap selection does
+/// not pay for the precise components. The constraints and the meets are
+/// followed by the reduction of the components by each other, for the
+/// pairs which specialize `DomReduction`, and the product is bottom once
+/// a component is.
+///
+/// The components of the values created by `default_val()` and
+/// `bottom_val()` are the default ones of the run, which all the values
+/// combined together shall share.
+template < DomainKind DomKind, derived_dom... Doms >
+class ReducedProductDom
+    : public NumericalDom< ReducedProductDom< DomKind, Doms... >,
+                           ZNum,
+                           DenseVar > {
+  public:
+    using Base = NumericalDom< ReducedProductDom, ZNum, DenseVar >;
+    using VarRef = typename Base::VarRef;
+    using LinearExpr = typename Base::LinearExpr;
+    using LinearConstraint = typename Base::LinearConstraint;
+    using LinearConstraintSystem = typename Base::LinearConstraintSystem;
+    using Components = std::tuple< Doms... >;
+
+    static constexpr std::size_t NumComponents = sizeof...(Doms);
+    static_assert(NumComponents > 0U && NumComponents <= 32U,
+                  "a product has 1 to 32 components");
+    static constexpr ProductComponents AllComponents =
+        static_cast< ProductComponents >((uint64_t(1) << NumComponents) -
+                                         1U);
+
+  private:
+    Components m_doms;
+    ProductComponents m_components;
+    bool m_is_bottom = false;
+
+  public:
+    explicit ReducedProductDom(bool is_bottom = false)
+        : m_components(get_default_components()) {
+        if (is_bottom) {
+            this->set_to_bottom();
+        }
+    }
+
+    ReducedProductDom(const ReducedProductDom&) = default;
+    ReducedProductDom(ReducedProductDom&&) = default;
+    ReducedProductDom& operator=(const ReducedProductDom&) = default;
+    ReducedProductDom& operator=(ReducedProductDom&&) = default;
+    ~ReducedProductDom() override = default;
+
+  public:
+    /// \brief The components of the values created from now on.
+    /// @{
+    static void set_default_components(ProductComponents components) {
+        get_default_components_ref().store(components & AllComponents,
+                                           std::memory_order_relaxed);
+    }
+    [[nodiscard]] static ProductComponents get_default_components() {
+        return get_default_components_ref().load(std::memory_order_relaxed);
+    }
+    /// @}
+
+    /// \brief Parse the comma separated domain names of the components,
+    /// all of them if there is none.
+    ///
+    /// \return none if a name is not a component, which is given back in
+    /// `unknown`.
+    [[nodiscard]] static std::optional< ProductComponents > parse_components(
+        llvm::StringRef names, llvm::StringRef& unknown) {
+        llvm::SmallVector< llvm::StringRef, 4 > parts;
+        names.split(parts, ',', -1, /*KeepEmpty=*/false);
+        ProductComponents components = 0U;
+        for (llvm::StringRef part : parts) {
+            part = part.trim();
+            if (part.empty()) {
+                continue;
+            }
+            std::size_t index = 0U;
+            const bool found = ((get_domain_name(Doms::get_kind()) == part ||
+                                 (++index, false)) ||
+                                ...);
+            if (!found) {
+                unknown = part;
+                return std::nullopt;
+            }
+            components |= ProductComponents(1U) << index;
+        }
+        return components == 0U ? AllComponents : components;
+    }
+
+    /// \brief Get the position of the component.
+    template < typename Dom >
+    [[nodiscard]] static constexpr std::size_t get_index() {
+        std::size_t index = 0U;
+        (void)((std::is_same_v< Dom, Doms > || (++index, false)) || ...);
+        return index;
+    }
+
+    [[nodiscard]] ProductComponents get_components() const {
+        return m_components;
+    }
+
+    [[nodiscard]] bool is_enabled(std::size_t index) const {
+        return (m_components >> index & 1U) != 0U;
+    }
+
+    /// \brief Check if the component is selected, i.e., not always top.
+    template < typename Dom >
+    [[nodiscard]] bool has() const {
+        return this->is_enabled(get_index< Dom >());
+    }
+
+    template < typename Dom >
+    [[nodiscard]] const Dom& get() const {
+        return std::get< Dom >(m_doms);
+    }
+
+  public:
+    [[nodiscard]] static DomainKind get_kind() { return DomKind; }
+
+    [[nodiscard]] static SharedVal default_val() {
+        return make_shared_val< ReducedProductDom >();
+    }
+
+    [[nodiscard]] static SharedVal bottom_val() {
+        return make_shared_val< ReducedProductDom >(true);
+    }
+
+    [[nodiscard]] AbsDomBase* clone() const override {
+        return new ReducedProductDom(*this);
+    }
+
+    void normalize() override {
+        this->for_each([](auto& dom) {
+            if (!dom.is_normalized()) {
+                dom.normalize();
+            }
+        });
+        this->update_bottom();
+    }
+
+    [[nodiscard]] bool is_normalized() const override {
+        return m_is_bottom ||
+               this->all_of([](const auto& dom) {
+                   return dom.is_normalized();
+               });
+    }
+
+    [[nodiscard]] bool is_bottom() const override { return m_is_bottom; }
+
+    [[nodiscard]] bool is_top() const override {
+        return !m_is_bottom &&
+               this->all_of([](const auto& dom) { return dom.is_top(); });
+    }
+
+    void set_to_bottom() override {
+        m_is_bottom = true;
+        this->for_each([](auto& dom) { dom.set_to_bottom(); });
+    }
+
+    void set_to_top() override {
+        m_is_bottom = false;
+        this->for_each([](auto& dom) { dom.set_to_top(); });
+    }
+
+    void join_with(const ReducedProductDom& other) {
+        if (other.m_is_bottom) {
+            return;
+        }
+        if (m_is_bottom) {
+            *this = other;
+            return;
+        }
+        this->for_each_with(other, [](auto& dom, const auto& other_dom) {
+            dom.join_with(other_dom);
+        });
+    }
+
+    void widen_with(const ReducedProductDom& other) {
+        if (other.m_is_bottom) {
+            return;
+        }
+        if (m_is_bottom) {
+            *this = other;
+            return;
+        }
+        this->for_each_with(other, [](auto& dom, const auto& other_dom) {
+            dom.widen_with(other_dom);
+        });
+    }
+
+    void widen_with_thresholds(const ReducedProductDom& other,
+                               const Thresholds& thresholds) {
+        if (other.m_is_bottom) {
+            return;
+        }
+        if (m_is_bottom) {
+            *this = other;
+            return;
+        }
+        this->for_each_with(other, [&](auto& dom, const auto& other_dom) {
+            dom.widen_with_thresholds(other_dom, thresholds);
+        });
+    }
+
+    void widen_with_threshold(const ReducedProductDom& other,
+                              const ZNum& threshold) {
+        if (other.m_is_bottom) {
+            return;
+        }
+        if (m_is_bottom) {
+            *this = other;
+            return;
+        }
+        this->for_each_with(other, [&](auto& dom, const auto& other_dom) {
+            dom.widen_with_threshold(other_dom, threshold);
+        });
+    }
+
+    void meet_with(const ReducedProductDom& other) {
+        if (m_is_bottom) {
+            return;
+        }
+        if (other.m_is_bottom) {
+            this->set_to_bottom();
+            return;
+        }
+        this->for_each_with(other, [](auto& dom, const auto& other_dom) {
+            dom.meet_with(other_dom);
+        });
+        this->reduce();
+    }
+
+    void narrow_with(const ReducedProductDom& other) {
+        if (m_is_bottom) {
+            return;
+        }
+        if (other.m_is_bottom) {
+            this->set_to_bottom();
+            return;
+        }
+        this->for_each_with(other, [](auto& dom, const auto& other_dom) {
+            dom.narrow_with(other_dom);
+        });
+        this->reduce();
+    }
+
+    void narrow_with_threshold(const ReducedProductDom& other,
+                               const ZNum& threshold) {
+        if (m_is_bottom) {
+            return;
+        }
+        if (other.m_is_bottom) {
+            this->set_to_bottom();
+            return;
+        }
+        this->for_each_with(other, [&](auto& dom, const auto& other_dom) {
+            dom.narrow_with_threshold(other_dom, threshold);
+        });
+        this->reduce();
+    }
+
+    [[nodiscard]] bool leq(const ReducedProductDom& other) const {
+        if (m_is_bottom) {
+            return true;
+        }
+        if (other.m_is_bottom) {
+            return false;
+        }
+        return this->all_of_with(other,
+                                 [](const auto& dom, const auto& other_dom) {
+                                     return dom.leq(other_dom);
+                                 });
+    }
+
+    [[nodiscard]] bool equals(const ReducedProductDom& other) const {
+        if (m_is_bottom || other.m_is_bottom) {
+            return m_is_bottom == other.m_is_bottom;
+        }
+        return this->all_of_with(other,
+                                 [](const auto& dom, const auto& other_dom) {
+                                     return dom.equals(other_dom);
+                                 });
+    }
+
+    void Profile(llvm::FoldingSetNodeID& id) const { // NOLINT
+        id.AddBoolean(m_is_bottom);
+        id.AddInteger(m_components);
+        this->for_each([&id](const auto& dom) { dom.Profile(id); });
+    }
+
+    void dump(llvm::raw_ostream& os) const override {
+        if (m_is_bottom) {
+            os << "_|_";
+            return;
+        }
+        os << "(";
+        bool first = true;
+        this->for_each([&](const auto& dom) {
+            if (!first) {
+                os << " x ";
+            }
+            dom.dump(os);
+            first = false;
+        });
+        os << ")";
+    }
+
+  public:
+    void transfer_assign_constant(VarRef x, const ZNum& n) override {
+        this->for_each(
+            [&](auto& dom) { dom.transfer_assign_constant(x, n); });
+        this->update_bottom();
+    }
+
+    void transfer_assign_variable(VarRef x, VarRef y) override {
+        this->for_each(
+            [&](auto& dom) { dom.transfer_assign_variable(x, y); });
+        this->update_bottom();
+    }
+
+    void transfer_assign_linear_expr(VarRef x,
+                                     const LinearExpr& expr) override {
+        this->for_each(
+            [&](auto& dom) { dom.transfer_assign_linear_expr(x, expr); });
+        this->update_bottom();
+    }
+
+    void apply(clang::UnaryOperatorKind op, VarRef x, VarRef y) override {
+        this->for_each([&](auto& dom) { dom.apply(op, x, y); });
+        this->update_bottom();
+    }
+
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               VarRef y,
+               VarRef z) override {
+        this->for_each([&](auto& dom) { dom.apply(op, x, y, z); });
+        this->update_bottom();
+    }
+
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               VarRef y,
+               const ZNum& z) override {
+        this->for_each([&](auto& dom) { dom.apply(op, x, y, z); });
+        this->update_bottom();
+    }
+
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               const ZNum& y,
+               VarRef z) override {
+        this->for_each([&](auto& dom) { dom.apply(op, x, y, z); });
+        this->update_bottom();
+    }
+
+    void add_linear_constraint(const LinearConstraint& cst) override {
+        if (m_is_bottom) {
+            return;
+        }
+        this->for_each([&](auto& dom) { dom.add_linear_constraint(cst); });
+        this->reduce();
+    }
+
+    void merge_with_linear_constraint_system(
+        const LinearConstraintSystem& csts) override {
+        if (m_is_bottom) {
+            return;
+        }
+        this->for_each([&](auto& dom) {
+            dom.merge_with_linear_constraint_system(csts);
+        });
+        this->reduce();
+    }
+
+    void forget(VarRef x) override {
+        this->for_each([x](auto& dom) { dom.forget(x); });
+    }
+
+    void forget_vars(llvm::ArrayRef< DenseVarID > vars) override {
+        this->for_each([vars](auto& dom) { dom.forget_vars(vars); });
+    }
+
+  private:
+    [[nodiscard]] static std::atomic< ProductComponents >&
+    get_default_components_ref() {
+        static std::atomic< ProductComponents > components{AllComponents};
+        return components;
+    }
+
+    /// \brief Apply `fn` to each selected component.
+    /// @{
+    template < typename Fn >
+    void for_each(Fn&& fn) {
+        [&]< std::size_t... Is >(std::index_sequence< Is... >) {
+            ((this->is_enabled(Is) ? (void)fn(std::get< Is >(m_doms))
+                                   : (void)0),
+             ...);
+        }(std::index_sequence_for< Doms... >{});
+    }
+
+    template < typename Fn >
+    void for_each(Fn&& fn) const {
+        [&]< std::size_t... Is >(std::index_sequence< Is... >) {
+            ((this->is_enabled(Is) ? (void)fn(std::get< Is >(m_doms))
+                                   : (void)0),
+             ...);
+        }(std::index_sequence_for< Doms... >{});
+    }
+    /// @}
+
+    /// \brief Apply `fn` to each selected component and to the one of the
+    /// other value.
+    template < typename Fn >
+    void for_each_with(const ReducedProductDom& other, Fn&& fn) {
+        knight_assert_msg(m_components == other.m_components,
+                          "the products shall share their components");
+        [&]< std::size_t... Is >(std::index_sequence< Is... >) {
+            ((this->is_enabled(Is) ? (void)fn(std::get< Is >(m_doms),
+                                              std::get< Is >(other.m_doms))
+                                   : (void)0),
+             ...);
+        }(std::index_sequence_for< Doms... >{});
+    }
+
+    template < typename Pred >
+    [[nodiscard]] bool all_of(Pred&& pred) const {
+        return [&]< std::size_t... Is >(std::index_sequence< Is... >) {
+            return ((!this->is_enabled(Is) || pred(std::get< Is >(m_doms))) &&
+                    ...);
+        }(std::index_sequence_for< Doms... >{});
+    }
+
+    template < typename Pred >
+    [[nodiscard]] bool all_of_with(const ReducedProductDom& other,
+                                   Pred&& pred) const {
+        knight_assert_msg(m_components == other.m_components,
+                          "the products shall share their components");
+        return [&]< std::size_t... Is >(std::index_sequence< Is... >) {
+            return ((!this->is_enabled(Is) ||
+                     pred(std::get< Is >(m_doms),
+                          std::get< Is >(other.m_doms))) &&
+                    ...);
+        }(std::index_sequence_for< Doms... >{});
+    }
+
+    /// \brief Set the product to bottom once a component is.
+    void update_bottom() {
+        if (!m_is_bottom &&
+            !this->all_of([](const auto& dom) { return !dom.is_bottom(); })) {
+            this->set_to_bottom();
+        }
+    }
+
+    /// \brief Reduce the component `I` by the component `J`.
+    template < std::size_t I, std::size_t J >
+    void reduce_pair() {
+        using Dom = std::tuple_element_t< I, Components >;
+        using Other = std::tuple_element_t< J, Components >;
+        if constexpr (I != J && reducible_dom_by< Dom, Other >) {
+            if (this->is_enabled(I) && this->is_enabled(J)) {
+                DomReduction< Dom, Other >::reduce(std::get< I >(m_doms),
+                                                   std::get< J >(m_doms));
+            }
+        }
+    }
+
+    template < std::size_t I, std::size_t... Js >
+    void reduce_component(std::index_sequence< Js... > /*others*/) {
+        (this->reduce_pair< I, Js >(), ...);
+    }
+
+    /// \brief Reduce the components by each other, once in their order.
+    void reduce() {
+        this->update_bottom();
+        if (m_is_bottom) {
+            return;
+        }
+        [this]< std::size_t... Is >(std::index_sequence< Is... >) {
+            (this->reduce_component< Is >(std::index_sequence_for< Doms... >{}),
+             ...);
+        }(std::index_sequence_for< Doms... >{});
+        this->update_bottom();
+    }
+}; // class ReducedProductDom
+
+/// \brief The numerical product of the intervals, the packed zones, the
+/// congruences and the known bits.
+using NumericalProductDom = ReducedProductDom< DomainKind::NumericalProductDom,
+                                               IntervalEnvDom,
+                                               PackedZoneDom,
+                                               CongruenceEnvDom,
+                                               KnownBitsEnvDom >;
+
+} // namespace knight::dfa
@@ -0,0 +1,213 @@
+//===- zone_dom.hpp ---------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the zone domain.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/domain/domains.hpp"
+#include "dfa/domain/numerical/interval_arith.hpp"
+#include "dfa/domain/numerical/numerical_base.hpp"
+#include "dfa/var_index.hpp"
+#include "util/znum.hpp"
+
+#include <llvm/ADT/FoldingSet.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace knight::dfa {
+
+/// \brief The relational domain of the constraints `y - x <= c` and
+/// `x <= c`, over the dense variable IDs.
+///
+/// The constraints are stored in a difference bound matrix (DBM) over
+/// the variables it constrains, the others being unbounded. The matrix is
+/// dense and row-major, where the entry (i, j) bounds `v_j - v_i` and the
+/// index 0 stands for the constant zero. It is kept closed, i.e. each
+/// entry is the tightest bound implied by the others: a new constraint
+/// closes it incrementally in O(n^2), and only the meet and the
+/// narrowing need a full closure in O(n^3).
+///
+/// The finite bounds are kept within `(-Inf, Inf)`. The bounds out of
+/// that range are relaxed, which is sound, so that the sums of the
+/// closure never overflow and vectorize.
+class ZoneDom : public NumericalDom< ZoneDom, ZNum, DenseVar > {
+  public:
+    using Bound = int64_t;
+
+    /// \brief The bound of the unconstrained differences.
+    static constexpr Bound Inf = Bound(1) << 62;
+
+    /// \brief An interval, unbounded on a side without a value.
+    using Interval = ZInterval;
+
+  private:
+    /// \brief The variables of the matrix in increasing order, where the
+    /// variable at position i has the index i + 1.
+    std::vector< DenseVarID > m_vars;
+
+    /// \brief The row-major matrix of the bounds.
+    std::vector< Bound > m_dbm{0};
+
+    bool m_is_bottom = false;
+
+    /// \brief Whether the matrix is closed, which is only false after a
+    /// widening, so that the widened iterates keep their infinite bounds.
+    bool m_is_closed = true;
+
+  public:
+    explicit ZoneDom(bool is_bottom = false) : m_is_bottom(is_bottom) {}
+
+    ZoneDom(const ZoneDom&) = default;
+    ZoneDom(ZoneDom&&) = default;
+    ZoneDom& operator=(const ZoneDom&) = default;
+    ZoneDom& operator=(ZoneDom&&) = default;
+    ~ZoneDom() override = default;
+
+  public:
+    [[nodiscard]] static ZoneDom top() { return ZoneDom(); }
+    [[nodiscard]] static ZoneDom bottom() { return ZoneDom(true); }
+
+    /// \brief Get the interval of the variable.
+    [[nodiscard]] Interval get_interval(VarRef x) const;
+
+    /// \brief Get the upper bound of `y - x`, if any.
+    [[nodiscard]] std::optional< ZNum > get_difference_bound(VarRef x,
+                                                             VarRef y) const;
+
+    /// \brief Get the variables constrained by the matrix.
+    [[nodiscard]] const std::vector< DenseVarID >& get_vars() const {
+        return m_vars;
+    }
+
+  public:
+    [[nodiscard]] static DomainKind get_kind() { return DomainKind::ZoneDom; }
+
+    [[nodiscard]] static SharedVal default_val() {
+        return make_shared_val< ZoneDom >();
+    }
+
+    [[nodiscard]] static SharedVal bottom_val() {
+        return make_shared_val< ZoneDom >(true);
+    }
+
+    [[nodiscard]] AbsDomBase* clone() const override {
+        return new ZoneDom(*this);
+    }
+
+    void normalize() override { this->close(); }
+
+    [[nodiscard]] bool is_normalized() const override {
+        return m_is_closed || m_is_bottom;
+    }
+
+    [[nodiscard]] bool is_bottom() const override { return m_is_bottom; }
+
+    [[nodiscard]] bool is_top() const override {
+        return !m_is_bottom && m_vars.empty();
+    }
+
+    void set_to_bottom() override;
+    void set_to_top() override;
+
+    void join_with(const ZoneDom& other);
+    void widen_with(const ZoneDom& other);
+    void widen_with_thresholds(const ZoneDom& other,
+                               const Thresholds& thresholds);
+    void widen_with_threshold(const ZoneDom& other, const ZNum& threshold);
+    void meet_with(const ZoneDom& other);
+    void narrow_with(const ZoneDom& other);
+    void narrow_with_threshold(const ZoneDom& other, const ZNum& threshold);
+    [[nodiscard]] bool leq(const ZoneDom& other) const;
+    [[nodiscard]] bool equals(const ZoneDom& other) const;
+
+    void Profile(llvm::FoldingSetNodeID& id) const; // NOLINT
+    void dump(llvm::raw_ostream& os) const override;
+
+  public:
+    void transfer_assign_constant(VarRef x, const ZNum& n) override;
+    void transfer_assign_variable(VarRef x, VarRef y) override;
+    void transfer_assign_linear_expr(VarRef x,
+                                     const LinearExpr& expr) override;
+
+    void apply(clang::UnaryOperatorKind op, VarRef x, VarRef y) override;
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               VarRef y,
+               VarRef z) override;
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               VarRef y,
+               const ZNum& z) override;
+    void apply(clang::BinaryOperatorKind op,
+               VarRef x,
+               const ZNum& y,
+               VarRef z) override;
+
+    void add_linear_constraint(const LinearConstraint& cst) override;
+    void merge_with_linear_constraint_system(
+        const LinearConstraintSystem& csts) override;
+
+    void forget(VarRef x) override;
+
+  private:
+    [[nodiscard]] std::size_t get_dim() const { return m_vars.size() + 1U; }
+
+    [[nodiscard]] Bound& at(std::size_t i, std::size_t j) {
+        return m_dbm[(i * get_dim()) + j];
+    }
+    [[nodiscard]] Bound at(std::size_t i, std::size_t j) const {
+        return m_dbm[(i * get_dim()) + j];
+    }
+
+    /// \brief Get the index of the variable, if it is in the matrix.
+    [[nodiscard]] std::optional< std::size_t > find_index(VarRef x) const;
+
+    /// \brief Get the index of the variable, adding it unconstrained.
+    [[nodiscard]] std::size_t get_or_add_index(VarRef x);
+
+    void remove_index(std::size_t index);
+
+    /// \brief Add `v_j - v_i <= c` and close the matrix incrementally.
+    void add_difference(std::size_t i, std::size_t j, Bound c);
+
+    /// \brief Add the bounds of the interval to the variable.
+    void add_interval(VarRef x, const Interval& itv);
+
+    /// \brief Assign `x = y + k`, preserving the relations of `y`.
+    void assign_shifted(VarRef x, VarRef y, const ZNum& k);
+
+    /// \brief Assign `x` to the interval, forgetting its relations.
+    void assign_interval(VarRef x, const Interval& itv);
+
+    [[nodiscard]] Interval eval_interval(const LinearExpr& expr) const;
+
+    /// \brief Add the constraint `expr <= 0`.
+    void add_inequality(const LinearExpr& expr);
+
+    /// \brief Close the matrix with the Floyd-Warshall algorithm.
+    void close();
+
+    /// \brief Combine the bounds of the common variables, forgetting
+    /// the variables of a single matrix.
+    template < typename Combine >
+    void combine_on_common(const ZoneDom& other, Combine combine);
+
+    /// \brief Combine the bounds over the variables of both matrices,
+    /// the variables of a single matrix being unbounded in the other.
+    template < typename Combine >
+    void combine_on_union(const ZoneDom& other, Combine combine);
+}; // class ZoneDom
+
+} // namespace knight::dfa
@@ -0,0 +1,70 @@
+//===- thresholds.hpp -------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the widening thresholds of a loop.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <llvm/ADT/STLExtras.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace knight::dfa {
+
+/// \brief Sorted set of integer constants a widening can stop at.
+///
+/// Widening a bound moves it to the closest threshold beyond the new
+/// bound instead of straight to infinity.
+class Thresholds {
+  public:
+    using Num = int64_t;
+
+  private:
+    std::vector< Num > m_nums;
+
+  public:
+    Thresholds() = default;
+
+  public:
+    [[nodiscard]] bool empty() const { return m_nums.empty(); }
+    [[nodiscard]] std::size_t size() const { return m_nums.size(); }
+
+    /// \brief Add a threshold
+    void add(Num num) {
+        auto it = llvm::lower_bound(m_nums, num);
+        if (it == m_nums.end() || *it != num) {
+            m_nums.insert(it, num);
+        }
+    }
+
+    /// \brief Get the smallest threshold greater or equal to the number
+    [[nodiscard]] std::optional< Num > get_upper(Num num) const {
+        auto it = llvm::lower_bound(m_nums, num);
+        if (it == m_nums.end()) {
+            return std::nullopt;
+        }
+        return *it;
+    }
+
+    /// \brief Get the greatest threshold less or equal to the number
+    [[nodiscard]] std::optional< Num > get_lower(Num num) const {
+        auto it = llvm::upper_bound(m_nums, num);
+        if (it == m_nums.begin()) {
+            return std::nullopt;
+        }
+        return *std::prev(it);
+    }
+
+}; // class Thresholds
+
+} // namespace knight::dfa
@@ -0,0 +1,69 @@
+//===- analysis_task.hpp ----------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the coroutine of a suspendable analysis task.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+namespace knight::dfa {
+
+/// \brief The coroutine of a suspendable analysis task.
+///
+/// The task is created suspended, and only runs when resumed by its
+/// scheduler, on any of its workers. It stays suspended at its end until
+/// it is destroyed along with the task.
+class AnalysisTask {
+  public:
+    struct promise_type { // NOLINT(readability-identifier-naming)
+        AnalysisTask get_return_object() {
+            return AnalysisTask(Handle::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    }; // struct promise_type
+
+    using Handle = std::coroutine_handle< promise_type >;
+
+  private:
+    Handle m_handle;
+
+  public:
+    AnalysisTask(const AnalysisTask&) = delete;
+    AnalysisTask& operator=(const AnalysisTask&) = delete;
+    AnalysisTask(AnalysisTask&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr)) {}
+    AnalysisTask& operator=(AnalysisTask&& other) noexcept {
+        std::swap(m_handle, other.m_handle);
+        return *this;
+    }
+    ~AnalysisTask() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+  public:
+    /// \brief Run the task until its next suspension or its end.
+    void resume() const { m_handle.resume(); }
+
+    [[nodiscard]] bool is_done() const { return m_handle.done(); }
+
+  private:
+    explicit AnalysisTask(Handle handle) : m_handle(handle) {}
+}; // class AnalysisTask
+
+} // namespace knight::dfa
@@ -13,16 +13,25 @@
 
 #pragma once
 
+#include "dfa/analysis_context.hpp"
 #include "dfa/analysis_manager.hpp"
+#include "dfa/checker_manager.hpp"
+#include "dfa/engine/deadline.hpp"
 #include "dfa/proc_cfg.hpp"
 #include "dfa/program_state.hpp"
 #include "dfa/stack_frame.hpp"
+#include "dfa/summary.hpp"
 
 #include <clang/AST/DeclCXX.h>
 #include <clang/AST/ExprCXX.h>
 
+#include <utility>
+#include <vector>
+
 namespace knight::dfa {
 
+class CallInliner;
+
 class BlockExecutionEngine {
   public:
     using GraphRef = typename ProcCFG::GraphRef;
@@ -31,7 +40,9 @@ class BlockExecutionEngine {
     using StmtRef = ProcCFG::StmtRef;
     using DeclRef = ProcCFG::DeclRef;
     using VarDeclRef = ProcCFG::VarDeclRef;
-    using StmtResultCache = std::unordered_map< StmtRef, ProgramStateRef >;
+    /// \brief The states of the recorded stmts, in the order of the
+    /// elements of the node.
+    using StmtStates = std::vector< std::pair< StmtRef, ProgramStateRef > >;
 
   private:
     GraphRef m_cfg;
@@ -39,27 +50,77 @@ class BlockExecutionEngine {
     AnalysisManager& m_analysis_manager;
 
     ProgramStateRef m_state;
-    StmtResultCache& m_stmt_pre;
-    StmtResultCache& m_stmt_post;
     const StackFrame* m_frame;
 
+    /// \brief The context of the analyses, reset to the state of each
+    /// stmt of the node.
+    AnalysisContext m_analysis_ctx;
+
+    /// \brief Caches of the stmt states, only recorded for the stmts
+    /// matched by the checkers, or for all the stmts without a checker
+    /// manager.
+    /// @{
+    StmtStates* m_stmt_pre = nullptr;
+    StmtStates* m_stmt_post = nullptr;
+    const CheckerManager* m_checker_manager = nullptr;
+    /// @}
+
+    /// \brief Deadline of the function, if any.
+    FunctionDeadline* m_deadline = nullptr;
+
+    /// \brief Summaries of the callees, if interprocedural.
+    const SummaryTable* m_summaries = nullptr;
+
+    /// \brief Inliner of the calls, if inlining.
+    CallInliner* m_inliner = nullptr;
+
   public:
     BlockExecutionEngine(GraphRef cfg,
                          NodeRef node,
                          AnalysisManager& analysis_manager,
                          ProgramStateRef in_state,
-                         StmtResultCache& stmt_pre,
-                         StmtResultCache& stmt_post,
                          const StackFrame* frame)
         : m_cfg(cfg),
           m_node(node),
           m_analysis_manager(analysis_manager),
           m_state(std::move(in_state)),
-          m_stmt_pre(stmt_pre),
-          m_stmt_post(stmt_post),
-          m_frame(frame) {}
+          m_frame(frame),
+          m_analysis_ctx(analysis_manager.get_context(),
+                         analysis_manager.get_region_manager()) {
+        m_analysis_ctx.set_current_stack_frame(frame);
+    }
 
   public:
+    /// \brief Record the pre and post states of the stmts which are
+    /// matched by some checker of the given manager.
+    void record_stmt_states(StmtStates& stmt_pre,
+                            StmtStates& stmt_post,
+                            const CheckerManager& checker_manager) {
+        m_stmt_pre = &stmt_pre;
+        m_stmt_post = &stmt_post;
+        m_checker_manager = &checker_manager;
+    }
+
+    /// \brief Record the pre and post states of all the stmts, in the same
+    /// order.
+    void record_all_stmt_states(StmtStates& stmt_pre, StmtStates& stmt_post) {
+        m_stmt_pre = &stmt_pre;
+        m_stmt_post = &stmt_post;
+        m_checker_manager = nullptr;
+    }
+
+    /// \brief Stop the execution at top once the deadline is expired.
+    void set_deadline(FunctionDeadline* deadline) { m_deadline = deadline; }
+
+    /// \brief Apply the summaries of the callees at the call sites.
+    void set_summaries(const SummaryTable* summaries) {
+        m_summaries = summaries;
+    }
+
+    /// \brief Inline the calls with the given inliner, before falling
+    /// back to the summaries.
+    void set_inliner(CallInliner* inliner) { m_inliner = inliner; }
+
     /// \brief General transformer for all nodes.
     void exec();
 
@@ -80,18 +141,37 @@ class BlockExecutionEngine {
     void exec_scope_begin(StmtRef trigger_stmt, VarDeclRef var_decl);
 
     /// \brief Transfer endding of a scope implicitly generated by
-    /// the compiler after the last Stmt in a CompoundStmt's body
-    void exec_scope_end(StmtRef trigger_stmt, VarDeclRef var_decl);
-
-    /// \brief Transfer C++ new allocator call
-    void exec_new_allocator_call(const clang::CXXNewExpr* expr);
-
-    /// \brief Transfer the point where the lifetime of an automatic object ends
-    void exec_lifetime_ends(StmtRef trigger_stmt, VarDeclRef var_decl);
+    /// the compiler after the last Stmt in a CompoundStmt's body,
+    /// removing the bindings of the variable.
+    ProgramStateRef exec_scope_end(StmtRef trigger_stmt,
+                                   VarDeclRef var_decl,
+                                   const ProgramStateRef& state);
+
+    /// \brief Transfer C++ new allocator call, allocating the object of
+    /// the new expression.
+    ProgramStateRef exec_new_allocator_call(const clang::CXXNewExpr* expr,
+                                            const ProgramStateRef& state);
+
+    /// \brief Allocate an object on the heap at the allocation site,
+    /// folding its former most recent object into the summary.
+    ProgramStateRef exec_heap_allocation(const clang::Expr* alloc_expr,
+                                         const ProgramStateRef& state);
+
+    /// \brief Transfer the point where the lifetime of an automatic object
+    /// ends, removing the bindings of the variable.
+    ProgramStateRef exec_lifetime_ends(StmtRef trigger_stmt,
+                                       VarDeclRef var_decl,
+                                       const ProgramStateRef& state);
 
     /// \brief Transfer the stmt
     ProgramStateRef exec_cfg_stmt(StmtRef stmt, const ProgramStateRef& state);
 
+    /// \brief Transfer the call at the given index of the node, by
+    /// inlining the callee or applying its summary, if any.
+    ProgramStateRef exec_call(StmtRef stmt,
+                              unsigned stmt_idx,
+                              const ProgramStateRef& state);
+
 }; // class BlockExecutionEngine
 
 } // namespace knight::dfa
\ No newline at end of file
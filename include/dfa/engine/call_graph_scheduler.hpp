@@ -0,0 +1,140 @@
+//===- call_graph_scheduler.hpp ---------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the bottom-up scheduler of the functions over the
+//  call graph of a translation unit.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/engine/analysis_task.hpp"
+#include "dfa/stack_frame.hpp"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/STLFunctionalExtras.h>
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace knight::dfa {
+
+/// \brief Schedules the top frames of a translation unit bottom-up over
+/// the strongly connected components of its call graph.
+///
+/// Each frame is analyzed by a coroutine task, which suspends at the
+/// calls of its callees whose summaries are not known yet, and is resumed
+/// by the worker completing them. A task waits for the last frame of the
+/// SCC of each callee in another SCC, and for the previous frame of its
+/// own SCC, so that the functions of a recursive SCC are analyzed in
+/// order, the summaries of the ones not analyzed yet being unknown. The
+/// summaries seen by a function do not depend on the scheduling, while
+/// the idle workers take any ready task instead of waiting for a whole
+/// SCC.
+///
+/// Given the predicted costs of the frames, the ready task heading the
+/// costliest chain of callers is resumed first, so that the longest chain
+/// does not start last.
+class CallGraphScheduler {
+  public:
+    using SCCIndex = std::size_t;
+    using FrameIndex = std::size_t;
+    using AnalyzeFn = llvm::function_ref< void(FrameIndex) >;
+
+  private:
+    /// \brief Suspends the task of the waiter until the callee is
+    /// completed.
+    struct CalleeAwaiter {
+        CallGraphScheduler& scheduler;
+        FrameIndex waiter;
+        FrameIndex callee;
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+        [[nodiscard]] bool await_suspend(std::coroutine_handle<> /*handle*/);
+        void await_resume() const noexcept {}
+    }; // struct CalleeAwaiter
+
+  private:
+    /// \brief The indices of the frames of each SCC, callees first.
+    std::vector< std::vector< FrameIndex > > m_sccs;
+
+    /// \brief The SCCs calling each SCC.
+    std::vector< std::vector< SCCIndex > > m_callers;
+
+    /// \brief The predicted cost of each SCC and of its costliest chain
+    /// of callers.
+    std::vector< uint64_t > m_priorities;
+
+    /// \brief The SCC of each frame.
+    std::vector< SCCIndex > m_frame_sccs;
+
+    /// \brief The frames awaited by the task of each frame, by the order
+    /// of its calls.
+    std::vector< std::vector< FrameIndex > > m_awaited;
+
+    std::vector< AnalysisTask > m_tasks;
+
+    std::mutex m_mutex;
+    std::condition_variable m_ready_cv;
+    /// \brief The ready tasks, as a heap by their priorities.
+    std::vector< FrameIndex > m_ready;
+    /// \brief The tasks waiting for each frame.
+    std::vector< std::vector< FrameIndex > > m_waiters;
+    std::vector< bool > m_is_completed;
+    std::size_t m_num_scheduled = 0U;
+    std::size_t m_num_completed = 0U;
+
+  public:
+    /// \brief Build the call graph of the given top frames, with their
+    /// predicted costs if any.
+    explicit CallGraphScheduler(llvm::ArrayRef< const StackFrame* > frames,
+                                llvm::ArrayRef< uint64_t > costs = {});
+
+  public:
+    [[nodiscard]] std::size_t get_num_sccs() const { return m_sccs.size(); }
+
+    /// \brief Get the indices of the frames of the SCC.
+    [[nodiscard]] llvm::ArrayRef< FrameIndex > get_scc(SCCIndex scc) const {
+        return m_sccs[scc];
+    }
+
+    /// \brief Resume the ready tasks on the calling worker, which analyzes
+    /// their frames with the given function, until all of them are
+    /// completed.
+    void run_worker(AnalyzeFn analyze);
+
+  private:
+    /// \brief Create the task of the frame, waiting for the summaries of
+    /// its callees before analyzing it.
+    AnalysisTask create_task(FrameIndex idx);
+
+    /// \brief Wait for a ready task, or none once all of them are
+    /// completed.
+    [[nodiscard]] std::optional< FrameIndex > take_ready();
+
+    /// \brief Register the waiter of the frame, unless it is completed.
+    ///
+    /// \return false if the frame is completed.
+    [[nodiscard]] bool add_waiter(FrameIndex waiter, FrameIndex callee);
+
+    /// \brief Mark the frame as completed, readying its waiters.
+    void complete(FrameIndex idx);
+
+    /// \brief Order the ready tasks by their priorities, then bottom-up.
+    [[nodiscard]] bool is_less_urgent(FrameIndex lhs, FrameIndex rhs) const;
+
+    /// \brief Push the ready task to the heap, with the lock held.
+    void push_ready(FrameIndex idx);
+}; // class CallGraphScheduler
+
+} // namespace knight::dfa
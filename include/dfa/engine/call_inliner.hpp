@@ -0,0 +1,120 @@
+//===- call_inliner.hpp -----------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the context-sensitive inliner of the calls.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/analysis_manager.hpp"
+#include "dfa/checker_manager.hpp"
+#include "dfa/engine/deadline.hpp"
+#include "dfa/proc_cfg.hpp"
+#include "dfa/program_state.hpp"
+#include "dfa/stack_frame.hpp"
+#include "dfa/summary.hpp"
+#include "tooling/context.hpp"
+
+#include <llvm/ADT/DenseMap.h>
+
+#include <deque>
+#include <optional>
+#include <utility>
+
+namespace knight::dfa {
+
+/// \brief Inlines the calls of a function up to a bounded call string.
+///
+/// A callee is analyzed in the stack frame of its call site, in the arena
+/// of the top function, from the entry state abstracted by removing the
+/// sexprs of the stmts of the caller. The states being hash-consed, the
+/// exit states are memoized on the callee and the entry state pointer,
+/// and the calls with the same input reuse the exit state without
+/// computing the fixpoint of the callee again.
+class CallInliner {
+  public:
+    using NodeRef = ProcCFG::NodeRef;
+    using StmtRef = ProcCFG::StmtRef;
+    using CacheKey = std::pair< ProcCFG::DeclRef, const ProgramState* >;
+
+  private:
+    /// \brief The memoized result of a callee on an entry state.
+    struct CacheEntry {
+        /// \brief Holds the entry state, so that the key is not reused by
+        /// another state.
+        ProgramStateRef entry;
+        ProgramStateRef exit;
+        const StackFrame* frame;
+    }; // struct CacheEntry
+
+  private:
+    KnightTUContext& m_ctx;
+    AnalysisManager& m_analysis_mgr;
+    CheckerManager& m_checker_mgr;
+    ProgramStateManager& m_state_mgr;
+    SummaryTable* m_summaries = nullptr;
+
+    unsigned m_max_depth;
+    unsigned m_max_cache_size;
+
+    /// \brief The memoized exit states, evicted in insertion order.
+    /// @{
+    llvm::DenseMap< CacheKey, CacheEntry > m_cache;
+    std::deque< CacheKey > m_cache_order;
+    /// @}
+
+  public:
+    CallInliner(KnightTUContext& ctx,
+                AnalysisManager& analysis_mgr,
+                CheckerManager& checker_mgr,
+                ProgramStateManager& state_mgr,
+                unsigned max_depth,
+                unsigned max_cache_size)
+        : m_ctx(ctx),
+          m_analysis_mgr(analysis_mgr),
+          m_checker_mgr(checker_mgr),
+          m_state_mgr(state_mgr),
+          m_max_depth(max_depth),
+          m_max_cache_size(max_cache_size) {}
+    CallInliner(const CallInliner&) = delete;
+    CallInliner& operator=(const CallInliner&) = delete;
+
+  public:
+    /// \brief Apply the summaries of the callees which are not inlined.
+    void set_summaries(SummaryTable* summaries) {
+        m_summaries = summaries;
+    }
+
+    /// \brief Inline the call at the given stmt of the node.
+    ///
+    /// \return the state after the call, or none if the callee is not
+    /// inlined, e.g. because it has no body, is recursive or the call
+    /// string is too long.
+    [[nodiscard]] std::optional< ProgramStateRef > inline_call(
+        const StackFrame* frame,
+        NodeRef node,
+        StmtRef call,
+        unsigned stmt_idx,
+        const ProgramStateRef& state,
+        FunctionDeadline* deadline);
+
+    /// \brief Release the memoized states.
+    void clear();
+
+  private:
+    /// \brief Check if the call string of the frame may be extended by a
+    /// call to the callee.
+    [[nodiscard]] bool is_inlinable(const StackFrame* frame,
+                                    ProcCFG::DeclRef callee) const;
+
+    void insert(CacheKey key, CacheEntry entry);
+}; // class CallInliner
+
+} // namespace knight::dfa
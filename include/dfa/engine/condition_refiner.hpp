@@ -0,0 +1,80 @@
+//===- condition_refiner.hpp ------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the refinement of the program states by the
+//  branch conditions.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/constraint/linear.hpp"
+#include "dfa/program_state.hpp"
+#include "dfa/region/region.hpp"
+#include "dfa/stack_frame.hpp"
+#include "dfa/var_index.hpp"
+#include "util/znum.hpp"
+
+#include <clang/AST/Expr.h>
+
+#include <optional>
+
+namespace knight::dfa {
+
+/// \brief Refines the program states of the branch edges by the
+/// conditions of the branches.
+///
+/// A condition is translated to the linear constraints over the dense
+/// variables of the integer variables, which the numerical domains of
+/// the state are met with. The conditions which are not linear leave the
+/// state unchanged, and the ones that cannot hold give bottom.
+class ConditionRefiner {
+  public:
+    using LinearExpr = LinearExpr< ZNum, DenseVar >;
+    using LinearConstraint = LinearConstraint< ZNum, DenseVar >;
+    using LinearConstraintSystem = LinearConstraintSystem< ZNum, DenseVar >;
+
+  private:
+    RegionManager& m_region_mgr;
+    VarIndex& m_var_index;
+    const StackFrame* m_frame;
+
+  public:
+    ConditionRefiner(RegionManager& region_mgr,
+                     VarIndex& var_index,
+                     const StackFrame* frame)
+        : m_region_mgr(region_mgr), m_var_index(var_index), m_frame(frame) {}
+
+  public:
+    /// \brief Refine the state by the condition evaluated to `is_true`.
+    ///
+    /// \return the bottom state if the condition cannot hold.
+    [[nodiscard]] ProgramStateRef refine(ProgramStateRef state,
+                                         const clang::Expr* cond,
+                                         bool is_true) const;
+
+    /// \brief Translate the condition evaluated to `is_true`.
+    ///
+    /// \return none if the condition is not linear.
+    [[nodiscard]] std::optional< LinearConstraintSystem > translate(
+        const clang::Expr* cond, bool is_true) const;
+
+    /// \brief Linearize the signed integer expression, without overflow
+    /// which is undefined.
+    ///
+    /// \return none if the expression is not linear.
+    [[nodiscard]] std::optional< LinearExpr > linearize(
+        const clang::Expr* expr) const;
+
+  private:
+    [[nodiscard]] std::optional< LinearConstraint > translate_comparison(
+        const clang::BinaryOperator* binary_op, bool is_true) const;
+}; // class ConditionRefiner
+
+} // namespace knight::dfa
@@ -0,0 +1,59 @@
+//===- constant_branches.hpp ------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the pre-pass folding the constant branch
+//  conditions of a CFG.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/proc_cfg.hpp"
+
+#include <llvm/ADT/DenseSet.h>
+
+#include <cstddef>
+#include <utility>
+
+namespace knight::dfa {
+
+/// \brief The branch edges of a CFG which cannot be taken, as the
+/// conditions of their branches fold to constants.
+///
+/// Beyond the conditions already pruned by clang when building the CFG,
+/// the conditions may read the local integer variables which are only
+/// read after their constant initializers, e.g. `bool enabled =
+/// kFeatureFlag;`. The folding needs neither the domains nor the states,
+/// and the blocks only reached by these edges are never transferred by
+/// the fixpoint.
+class InfeasibleEdges {
+  public:
+    using NodeRef = ProcCFG::NodeRef;
+
+  private:
+    /// \brief The IDs of the source and destination blocks of the edges.
+    llvm::DenseSet< std::pair< unsigned, unsigned > > m_edges;
+
+  public:
+    /// \brief Fold the branch conditions of the CFG of the function.
+    [[nodiscard]] static InfeasibleEdges compute(ProcCFG::FunctionRef function,
+                                                 const ProcCFG& cfg);
+
+  public:
+    [[nodiscard]] bool contains(NodeRef src, NodeRef dst) const {
+        return m_edges.contains({src->getBlockID(), dst->getBlockID()});
+    }
+
+    [[nodiscard]] bool empty() const { return m_edges.empty(); }
+    [[nodiscard]] std::size_t size() const { return m_edges.size(); }
+
+    void clear() { m_edges.clear(); }
+}; // class InfeasibleEdges
+
+} // namespace knight::dfa
@@ -0,0 +1,68 @@
+//===- cost_model.hpp -------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the cost model of analyzing a function.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/engine/deadline.hpp"
+#include "dfa/stack_frame.hpp"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <string>
+
+namespace knight::dfa {
+
+/// \brief The estimated cost of analyzing a function, before analyzing
+/// it.
+///
+/// The cost is counted in steps of the deadline: each stmt of a block is
+/// transferred once outside of the loops, and a few times per nesting
+/// loop until it stabilizes.
+struct FunctionCost {
+    /// \brief The growth of the transfers per nesting loop.
+    static constexpr uint64_t LoopFactor = 4U;
+    /// \brief The nesting depth above which the loops add no growth.
+    static constexpr unsigned MaxLoopDepth = 8U;
+    /// \brief The ratio of an outlier to the median cost.
+    static constexpr uint64_t OutlierFactor = 16U;
+    /// \brief The cost below which a function is never an outlier.
+    static constexpr uint64_t MinOutlierCost = 4096U;
+
+    unsigned num_blocks = 0U;
+    unsigned num_stmts = 0U;
+    unsigned max_loop_depth = 0U;
+    uint64_t predicted = 0U;
+}; // struct FunctionCost
+
+/// \brief Estimate the cost from the CFG of the frame and its cached WTO.
+[[nodiscard]] FunctionCost estimate_function_cost(const StackFrame* frame);
+
+/// \brief Get the predicted cost above which a function is an outlier
+/// among the given ones, i.e. far above their median, so that it alone
+/// decides the latency of its translation unit.
+[[nodiscard]] uint64_t get_outlier_cost(llvm::ArrayRef< FunctionCost > costs);
+
+/// \brief Record the predicted cost of a function and its actual cost.
+///
+/// Records are collected across all the threads and translation units.
+void record_function_cost(std::string name,
+                          const FunctionCost& cost,
+                          FunctionDeadline::Milliseconds elapsed);
+
+/// \brief Print the predicted against the actual costs of the recorded
+/// functions, slowest first. Print nothing if there are none.
+void print_function_costs(llvm::raw_ostream& os);
+
+} // namespace knight::dfa
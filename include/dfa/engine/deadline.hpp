@@ -0,0 +1,123 @@
+//===- deadline.hpp ---------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the analysis deadline of a function.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <llvm/Support/raw_ostream.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+
+namespace knight::dfa {
+
+/// \brief The wall-clock time, step and memory budget of analyzing a
+/// function.
+///
+/// A step is the transfer of a stmt or of a WTO component. The memory is
+/// sampled by the probe along with the clock. Once the deadline expires
+/// it stays expired, and the fixpoint iterator jumps the remaining
+/// components to top.
+class FunctionDeadline {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::milliseconds;
+
+    /// \brief Get the bytes held by the analysis of the function.
+    using MemoryProbe = std::function< std::size_t() >;
+
+  private:
+    /// \brief Number of steps between two reads of the clock.
+    static constexpr uint64_t ClockCheckInterval = 64U;
+
+    Clock::time_point m_start;
+    Milliseconds m_time_limit;
+    uint64_t m_step_limit;
+    std::size_t m_memory_limit;
+    MemoryProbe m_memory_probe;
+    uint64_t m_steps = 0U;
+    bool m_expired = false;
+    bool m_memory_exceeded = false;
+
+  public:
+    /// \brief Start the deadline, 0 for no time, step or memory limit.
+    FunctionDeadline(unsigned time_limit_ms,
+                     uint64_t step_limit,
+                     std::size_t memory_limit = 0U)
+        : m_start(Clock::now()),
+          m_time_limit(time_limit_ms),
+          m_step_limit(step_limit),
+          m_memory_limit(memory_limit) {}
+
+  public:
+    /// \brief Sample the memory by the probe, also without memory limit.
+    void set_memory_probe(MemoryProbe probe) {
+        m_memory_probe = std::move(probe);
+    }
+
+    [[nodiscard]] bool is_enabled() const {
+        return m_time_limit.count() != 0 || m_step_limit != 0U ||
+               m_memory_probe != nullptr;
+    }
+    [[nodiscard]] bool is_expired() const { return m_expired; }
+    [[nodiscard]] bool is_memory_exceeded() const {
+        return m_memory_exceeded;
+    }
+    [[nodiscard]] uint64_t get_steps() const { return m_steps; }
+
+    [[nodiscard]] Milliseconds get_elapsed() const {
+        return std::chrono::duration_cast< Milliseconds >(Clock::now() -
+                                                          m_start);
+    }
+
+    /// \brief Count one step.
+    ///
+    /// \return true if the deadline is expired.
+    bool step() {
+        if (m_expired) {
+            return true;
+        }
+        ++m_steps;
+        if (m_step_limit != 0U && m_steps > m_step_limit) {
+            m_expired = true;
+        } else if (m_steps % ClockCheckInterval == 0U) {
+            if (m_time_limit.count() != 0 && get_elapsed() > m_time_limit) {
+                m_expired = true;
+            } else if (m_memory_probe != nullptr) {
+                const std::size_t bytes = m_memory_probe();
+                m_memory_exceeded = m_memory_limit != 0U &&
+                                    bytes > m_memory_limit;
+                m_expired = m_memory_exceeded;
+            }
+        }
+        return m_expired;
+    }
+
+}; // class FunctionDeadline
+
+/// \brief Record a function whose analysis exceeded its deadline, or its
+/// memory limit if `memory_exceeded`.
+///
+/// Records are collected across all the threads and translation units.
+void record_timed_out_function(std::string name,
+                               FunctionDeadline::Milliseconds elapsed,
+                               bool memory_exceeded = false);
+
+/// \brief Print the functions which exceeded their deadline, slowest
+/// first. Print nothing if there are none.
+void print_timed_out_functions(llvm::raw_ostream& os);
+
+} // namespace knight::dfa
@@ -15,16 +15,94 @@
 #pragma once
 
 #include "dfa/checker_manager.hpp"
+#include "dfa/checker_context.hpp"
+#include "dfa/engine/block_engine.hpp"
+#include "dfa/engine/call_inliner.hpp"
+#include "dfa/engine/constant_branches.hpp"
+#include "dfa/domain/thresholds.hpp"
+#include "dfa/engine/deadline.hpp"
 #include "dfa/engine/wto_iterator.hpp"
 #include "dfa/proc_cfg.hpp"
+#include "dfa/profiler.hpp"
 #include "dfa/program_state.hpp"
 #include "dfa/stack_frame.hpp"
+#include "dfa/summary.hpp"
 #include "support/graph.hpp"
+#include "tooling/options.hpp"
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/Allocator.h>
+
+#include <array>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
 
 namespace knight::dfa {
 
+namespace impl {
+
+/// \brief The arena holding the program states of one function, and the
+/// domain values owned by their state manager.
+///
+/// It is the first base of the fixpoint iterator, so that it is created
+/// before and destroyed after all the invariants of the iterator. The
+/// inlined callees use the arena of their top function.
+class FunctionArena {
+  protected:
+    llvm::BumpPtrAllocator m_arena;
+    std::optional< ProgramStateManager > m_own_state_mgr;
+    ProgramStateManager& m_state_mgr;
+
+  protected:
+    explicit FunctionArena(AnalysisManager& analysis_mgr)
+        : m_own_state_mgr(std::in_place,
+                          analysis_mgr,
+                          analysis_mgr.get_region_manager(),
+                          m_arena),
+          m_state_mgr(*m_own_state_mgr) {}
+
+    explicit FunctionArena(ProgramStateManager& state_mgr)
+        : m_state_mgr(state_mgr) {}
+}; // class FunctionArena
+
+} // namespace impl
+
+/// \brief The memory held by the analysis of a function.
+struct FunctionMemoryUsage {
+    /// \brief Bytes of the arena of the states and of their maps.
+    std::size_t state_arena_bytes = 0U;
+
+    /// \brief Number of the uniqued states and of the freed ones kept for
+    /// reuse.
+    /// @{
+    std::size_t live_states = 0U;
+    std::size_t free_states = 0U;
+    /// @}
+
+    /// \brief Bytes of the recorded states of the checked stmts.
+    std::size_t stmt_state_bytes = 0U;
+
+    /// \brief Bytes of the abstract values allocated by the function, by
+    /// domain ID.
+    std::array< std::size_t, NumDomIDs > dom_val_bytes{};
+
+    /// \brief Number of the regions created by the function, by kind.
+    std::array< std::size_t, NumRegionKinds > regions{};
+
+    /// \brief Get the bytes of the arena, the abstract values and the
+    /// stmt states.
+    [[nodiscard]] std::size_t get_total_bytes() const;
+
+    /// \brief Keep the maximum of each component.
+    void merge_peak(const FunctionMemoryUsage& other);
+}; // struct FunctionMemoryUsage
+
 class IntraProceduralFixpointIterator final
-    : public WtoBasedFixPointIterator< ProcCFG, GraphTrait< ProcCFG > > {
+    : private impl::FunctionArena,
+      public WtoBasedFixPointIterator< ProcCFG, GraphTrait< ProcCFG > > {
   private:
     using GraphTrait = GraphTrait< ProcCFG >;
     using FixPointIterator = WtoBasedFixPointIterator< ProcCFG, GraphTrait >;
@@ -32,46 +110,273 @@ class IntraProceduralFixpointIterator final
     using FunctionRef = ProcCFG::FunctionRef;
     using NodeRef = typename FixPointIterator::NodeRef;
     using StmtRef = ProcCFG::StmtRef;
-    using StmtResultCache = std::unordered_map< StmtRef, ProgramStateRef >;
+    using StmtStates = BlockExecutionEngine::StmtStates;
+    using LoopThresholds = std::unordered_map< NodeRef, Thresholds >;
+    using TransferCacheKey = std::pair< unsigned, const ProgramState* >;
+
+    /// \brief The memoized post state of a block on a pre state.
+    struct TransferCacheEntry {
+        /// \brief Holds the pre state, so that the key is not reused by
+        /// another state.
+        ProgramStateRef pre;
+        ProgramStateRef post;
+        std::list< TransferCacheKey >::iterator order_it;
+    }; // struct TransferCacheEntry
 
   private:
-    KnightContext& m_ctx;
+    KnightTUContext& m_ctx;
     CheckerManager& m_checker_mgr;
     AnalysisManager& m_analysis_mgr;
-    ProgramStateManager& m_state_mgr;
     const StackFrame* m_frame;
 
-    StmtResultCache m_stmt_pre;
-    StmtResultCache m_stmt_post;
+    /// \brief States of the checked stmts in the last replayed node.
+    /// @{
+    StmtStates m_stmt_pre;
+    StmtStates m_stmt_post;
+    NodeRef m_replayed_node = nullptr;
+    /// @}
+
+    /// \brief Widening thresholds of each loop head, harvested from the
+    /// integer literals of the loop.
+    LoopThresholds m_loop_thresholds;
+
+    /// \brief Branch edges cut by their constant conditions, folded before
+    /// the fixpoint.
+    InfeasibleEdges m_infeasible_edges;
+
+    /// \brief The memoized post states of the blocks by their IDs and
+    /// pre states, and their keys from the most recently used one.
+    /// @{
+    unsigned m_max_transfer_cache_size = 0U;
+    llvm::DenseMap< TransferCacheKey, TransferCacheEntry > m_transfer_cache;
+    std::list< TransferCacheKey > m_transfer_cache_order;
+    /// @}
+
+    /// \brief Def-use chains of the function, whose transparent blocks
+    /// are not transferred, if running the sparse analysis.
+    const DefUseChains* m_def_use = nullptr;
+
+    /// \brief Time and step budget of the function, started by `run()`.
+    /// @{
+    FunctionDeadline m_deadline{0U, 0U};
+    unsigned m_time_limit = 0U;
+    /// @}
+
+    /// \brief Inliner of the calls, owned by the top function and shared
+    /// by its inlined callees, if inlining.
+    /// @{
+    std::unique_ptr< CallInliner > m_own_inliner;
+    CallInliner* m_inliner = nullptr;
+    /// @}
+
+    /// \brief Whether the function is inlined in a caller, whose deadline
+    /// it shares and whose checkers it leaves out.
+    /// @{
+    bool m_is_inlined = false;
+    FunctionDeadline* m_caller_deadline = nullptr;
+    /// @}
+
+    /// \brief Summaries applied at the call sites and completed with the
+    /// summary of the function, if interprocedural.
+    SummaryTable* m_summaries = nullptr;
+
+    /// \brief Summary of the function, computed by `run()`.
+    FunctionSummary m_summary;
+
+    /// \brief Convergence of a loop head, collected when profiling.
+    struct LoopHeadStats {
+        unsigned increasing = 0U;
+        unsigned decreasing = 0U;
+        /// \brief Time spent in the cycle, its nested cycles included.
+        Profiler::Clock::duration elapsed{};
+    }; // struct LoopHeadStats
+
+    /// \brief Convergence of each loop head, and the times when the
+    /// entered cycles started, when profiling.
+    /// @{
+    std::unordered_map< NodeRef, LoopHeadStats > m_head_stats;
+    std::vector< Profiler::Clock::time_point > m_cycle_starts;
+    /// @}
+
+    /// \brief Trace partitions of the partitioned nodes, when profiling.
+    std::vector< std::pair< NodeRef, unsigned > > m_partition_stats;
+
+    /// \brief Whether an iteration span is open in each entered cycle,
+    /// when tracing.
+    std::vector< bool > m_cycle_iteration_spans;
+
+    /// \brief Peak bytes of the arena during the fixpoint.
+    std::size_t m_peak_arena_bytes = 0U;
+
+    /// \brief Peak memory of the function, sampled along with the deadline
+    /// once profiling or limited.
+    FunctionMemoryUsage m_peak_memory;
+
+    /// \brief The live bytes of the abstract values and the region counts
+    /// when the function starts, as they are shared by the functions of
+    /// the worker.
+    /// @{
+    DomValBytes m_dom_val_bytes_at_start{};
+    std::array< std::size_t, NumRegionKinds > m_regions_at_start{};
+    /// @}
 
   public:
-    IntraProceduralFixpointIterator(knight::KnightContext& ctx,
+    IntraProceduralFixpointIterator(knight::KnightTUContext& ctx,
                                     AnalysisManager& analysis_mgr,
                                     CheckerManager& checker_mgr,
-                                    ProgramStateManager& state_mgr,
                                     const StackFrame* frame);
 
+    /// \brief Create the iterator of a callee inlined in the arena of its
+    /// top function.
+    IntraProceduralFixpointIterator(knight::KnightTUContext& ctx,
+                                    AnalysisManager& analysis_mgr,
+                                    CheckerManager& checker_mgr,
+                                    const StackFrame* frame,
+                                    ProgramStateManager& state_mgr,
+                                    CallInliner& inliner);
+
     /// \brief transfer function for a graph node.
     ///
+    /// The states being hash-consed, the post states are memoized on the
+    /// block and the pre state pointer, so that a block transferred again
+    /// from the same pre state, e.g., in a converged part of a loop, is
+    /// not executed again.
+    ///
     /// \return the out program state after transfering to the given node.
     [[nodiscard]] ProgramStateRef transfer_node(
         NodeRef node, ProgramStateRef pre_state) override;
 
     /// \brief transfer function for a graph edge.
     ///
+    /// The state of a branch edge is refined by the branch condition, and
+    /// is bottom if the condition cannot hold on the edge.
+    ///
     /// \return the out program state after transfering to the given edge,
     ///         to the in state of the destination node.
     [[nodiscard]] ProgramStateRef transfer_edge(
         NodeRef src, NodeRef dst, ProgramStateRef src_post_state) override;
 
+    /// \brief Widen at loop heads up to the loop thresholds.
+    [[nodiscard]] ProgramStateRef merge_at_head_when_increasing(
+        NodeRef head,
+        unsigned iter_cnt,
+        const ProgramStateRef& state_before,
+        const ProgramStateRef& state_after) override;
+
+    /// \brief Trace the cycles and their iterations, and count the
+    /// iterations of each loop head when profiling.
+    /// @{
+    void notify_enter_cycle(NodeRef head) override;
+    void notify_each_cycle_iteration(NodeRef head,
+                                     unsigned iter_cnt,
+                                     IterationKind kind) override;
+    void notify_exit_cycle(NodeRef head) override;
+    /// @}
+
+    /// \brief Count the nodes transferred with several trace partitions.
+    void notify_trace_partitions(NodeRef node,
+                                 unsigned num_partitions) override;
+
     /// \brief check the precondition of a node.
     void check_pre(NodeRef, const ProgramStateRef&) override;
 
     /// \brief check the postcondition of a node.
     void check_post(NodeRef, const ProgramStateRef&) override;
 
+    /// \brief Apply the summaries of the callees, and record the summary
+    /// of the function once it is analyzed.
+    void set_summaries(SummaryTable* summaries);
+
+    /// \brief Set the time limit in milliseconds of the function, which
+    /// overrides the configured one.
+    void set_time_limit(unsigned time_limit_ms) {
+        m_time_limit = time_limit_ms;
+    }
+
     void run();
 
+    /// \brief Compute the fixpoint of an inlined callee from the entry
+    /// state, without running the checkers.
+    ///
+    /// \return the exit state of the callee.
+    [[nodiscard]] ProgramStateRef run_inlined(ProgramStateRef entry_state,
+                                              FunctionDeadline* deadline);
+
+    /// \brief Get the summary of the function computed by the last run.
+    [[nodiscard]] const FunctionSummary& get_summary() const {
+        return m_summary;
+    }
+
+    /// \brief Get the peak bytes allocated by the function arena.
+    [[nodiscard]] std::size_t get_peak_arena_bytes() const {
+        return m_peak_arena_bytes;
+    }
+
+    /// \brief Get the peak memory sampled by the last run, if profiling or
+    /// limited.
+    [[nodiscard]] const FunctionMemoryUsage& get_peak_memory() const {
+        return m_peak_memory;
+    }
+
+  private:
+    /// \brief Set up the fixpoint iterations from the options.
+    void apply_options(const KnightOptions& opts);
+
+    /// \brief Select the fixpoint strategy from the options and the size
+    /// of the CFG.
+    [[nodiscard]] static FixpointStrategy select_strategy(
+        const KnightOptions& opts, const ProcCFG* cfg);
+
+    /// \brief Collect the integer literals of each loop as the widening
+    /// thresholds of its head.
+    void collect_loop_thresholds();
+
+    /// \brief Fold the constant branch conditions, if enabled.
+    void collect_infeasible_edges();
+
+    /// \brief Get the deadline of the stmts, if any.
+    [[nodiscard]] FunctionDeadline* get_active_deadline();
+
+    /// \brief Create the checker context of a node, whose state is set
+    /// for each stmt.
+    [[nodiscard]] CheckerContext make_checker_context() const;
+
+    /// \brief Check if the cycles are traced, which requires them to be
+    /// visited in nested order.
+    [[nodiscard]] bool is_cycle_traced() const;
+
+    /// \brief Check if any stmt of the node is matched by some checker.
+    [[nodiscard]] bool is_node_checked(NodeRef node) const;
+
+    /// \brief Replay the transfer of the node from its pre state to
+    /// record the states of the checked stmts.
+    void replay_node(NodeRef node, const ProgramStateRef& pre_state);
+
+    /// \brief Export the states of the blocks, and of all their stmts if
+    /// asked, replaying the blocks from their pre states.
+    void export_invariants();
+
+    /// \brief Start sampling the memory of the function by its deadline.
+    void start_memory_sampling();
+
+    /// \brief Sample the memory of the function into its peak.
+    ///
+    /// \return the bytes held by the function.
+    std::size_t sample_memory();
+
+    /// \brief Record the peak memory of the function into the profile.
+    void record_memory_profile(const std::string& function_name) const;
+
+    /// \brief Release all the program states of the function, so that the
+    /// arena is freed in one go when the iterator is destroyed.
+    void release_states();
+
+    /// \brief Memoize the post state of a block, evicting the least
+    /// recently used one if the cache is full.
+    void insert_transfer(TransferCacheKey key,
+                         ProgramStateRef pre_state,
+                         ProgramStateRef post_state);
+
 }; // class IntraProceduralFixpointIterator
 
 } // namespace knight::dfa
\ No newline at end of file
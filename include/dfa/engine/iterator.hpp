@@ -16,16 +16,106 @@
 #include "dfa/program_state.hpp"
 #include "support/graph.hpp"
 
+#include <llvm/ADT/STLExtras.h>
+
+#include <unordered_map>
+#include <vector>
+
 namespace knight::dfa {
 
 enum class IterationKind { Increasing, Decreasing };
 
+/// \brief How the fixpoint is computed over the weak topological order.
+///
+/// - `Wto`: recursive iteration strategy, re-visiting whole cycles.
+/// - `Worklist`: worklist ordered by WTO position, only re-visiting the
+///   nodes whose predecessors changed.
+enum class FixpointStrategy { Wto, Worklist };
+
+/// \brief Iteration policy at the loop heads of a function.
+struct LoopIterationPolicy {
+    /// \brief Number of increasing iterations joining before widening.
+    unsigned widening_delay = 1U;
+
+    /// \brief Maximum number of decreasing iterations at a loop head.
+    unsigned max_narrowing_iterations = 8U;
+
+    /// \brief Maximum number of loop iterations of the function, 0 for
+    /// unlimited. Once exhausted, the loop heads fall back to top and
+    /// narrowing stops.
+    unsigned max_iterations = 10000U;
+
+    /// \brief Maximum number of the trace partitions of a node out of the
+    /// cycles, 1 for no partitioning. The partitions are all merged when
+    /// entering a cycle.
+    unsigned max_trace_partitions = 1U;
+}; // struct LoopIterationPolicy
+
+/// \brief Program states of the graph nodes, bottom by default.
+template < typename GraphTrait >
+class InvariantMap {
+  public:
+    using GraphRef = GraphTrait::GraphRef;
+    using NodeRef = GraphTrait::NodeRef;
+
+  private:
+    std::unordered_map< NodeRef, ProgramStateRef > m_states;
+    ProgramStateRef m_bottom;
+
+  public:
+    InvariantMap([[maybe_unused]] GraphRef graph, ProgramStateRef bottom)
+        : m_bottom(std::move(bottom)) {}
+
+  public:
+    [[nodiscard]] const ProgramStateRef& get(NodeRef node) const {
+        auto it = m_states.find(node);
+        return it == m_states.end() ? m_bottom : it->second;
+    }
+
+    void set(NodeRef node, ProgramStateRef state) {
+        m_states[node] = std::move(state);
+    }
+
+    void clear() {
+        std::unordered_map< NodeRef, ProgramStateRef >().swap(m_states);
+    }
+}; // class InvariantMap
+
+/// \brief Program states of the nodes of an indexed graph, as a flat
+/// vector indexed by the dense node indices.
+template < indexed_graph_trait GraphTrait >
+class InvariantMap< GraphTrait > {
+  public:
+    using GraphRef = GraphTrait::GraphRef;
+    using NodeRef = GraphTrait::NodeRef;
+
+  private:
+    std::vector< ProgramStateRef > m_states;
+    ProgramStateRef m_bottom;
+
+  public:
+    InvariantMap(GraphRef graph, ProgramStateRef bottom)
+        : m_states(GraphTrait::num_nodes(graph), bottom),
+          m_bottom(std::move(bottom)) {}
+
+  public:
+    [[nodiscard]] const ProgramStateRef& get(NodeRef node) const {
+        return m_states[GraphTrait::index(node)];
+    }
+
+    void set(NodeRef node, ProgramStateRef state) {
+        m_states[GraphTrait::index(node)] = std::move(state);
+    }
+
+    void clear() { llvm::fill(m_states, m_bottom); }
+}; // class InvariantMap
+
 template < graph G, typename GraphTrait = GraphTrait< G > >
 class FixPointIterator {
   public:
     using GraphRef = GraphTrait::GraphRef;
     using NodeRef = GraphTrait::NodeRef;
-    using InvariantMap = std::unordered_map< NodeRef, ProgramStateRef >;
+    using InvariantMapT = InvariantMap< GraphTrait >;
 
   public:
     FixPointIterator() = default;
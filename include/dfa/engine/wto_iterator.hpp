@@ -13,12 +13,25 @@
 
 #pragma once
 
+#include "dfa/engine/deadline.hpp"
 #include "dfa/engine/iterator.hpp"
 #include "dfa/program_state.hpp"
 #include "dfa/stack_frame.hpp"
 #include "support/graph.hpp"
+#include "util/assert.hpp"
 #include "util/wto.hpp"
 
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
 namespace knight::dfa {
 
 namespace impl {
@@ -26,6 +39,8 @@ namespace impl {
 template < graph G, typename GraphTrait >
 class WtoIterator;
 template < graph G, typename GraphTrait >
+class WorklistIterator;
+template < graph G, typename GraphTrait >
 class WtoChecker;
 
 } // namespace impl
@@ -33,29 +48,84 @@ class WtoChecker;
 template < graph CFG, typename GraphTrait = GraphTrait< CFG > >
 class WtoBasedFixPointIterator : public FixPointIterator< CFG, GraphTrait > {
     friend class impl::WtoIterator< CFG, GraphTrait >;
+    friend class impl::WorklistIterator< CFG, GraphTrait >;
 
   public:
     using Base = FixPointIterator< CFG, GraphTrait >;
     using GraphRef = typename Base::GraphRef;
     using NodeRef = typename Base::NodeRef;
-    using InvariantMap = typename Base::InvariantMap;
+    using InvariantMapT = typename Base::InvariantMapT;
     using Wto = Wto< CFG, GraphTrait >;
     using WtoIterator = impl::WtoIterator< CFG, GraphTrait >;
+    using WorklistIterator = impl::WorklistIterator< CFG, GraphTrait >;
     using WtoChecker = impl::WtoChecker< CFG, GraphTrait >;
 
+    /// \brief Maximum number of the recent branch decisions of a trace
+    /// partition.
+    static constexpr std::size_t MaxTraceDecisions = 8U;
+
+    /// \brief A branch decision, as the branch node and the position of
+    /// the taken successor.
+    using TraceDecision = std::pair< NodeRef, unsigned >;
+
+    /// \brief The recent branch decisions of a trace, most recent first.
+    using TraceKey = llvm::SmallVector< TraceDecision, MaxTraceDecisions >;
+
+    /// \brief The state of the traces sharing their recent decisions.
+    struct TracePartition {
+        TraceKey key;
+        ProgramStateRef state;
+    }; // struct TracePartition
+
+    using TracePartitions = llvm::SmallVector< TracePartition, 4 >;
+
   private:
     GraphRef m_cfg;
-    Wto m_wto;
-    InvariantMap m_pre;
-    InvariantMap m_post;
+    const Wto* m_wto;
+    InvariantMapT m_pre;
+    InvariantMapT m_post;
     bool m_converged{};
+    FixpointStrategy m_strategy = FixpointStrategy::Wto;
+
+    /// \brief Loop iteration policy, and its per-head widening delays.
+    /// @{
+    LoopIterationPolicy m_policy;
+    std::unordered_map< NodeRef, unsigned > m_widening_delays;
+    /// @}
+
+    /// \brief Loop iterations of the current run, and the loop heads
+    /// which hit the narrowing cap or the iteration budget.
+    /// @{
+    unsigned m_num_iterations = 0U;
+    std::unordered_set< NodeRef > m_over_budget_heads;
+    /// @}
+
+    /// \brief Transfers of the current run skipped on bottom states.
+    unsigned m_num_skipped_nodes = 0U;
+
+    /// \brief Visits of the nested cycles of the current run which reused
+    /// the invariants of their previous visit.
+    unsigned m_num_reused_cycles = 0U;
+
+    /// \brief Trace partitions of the post states of the nodes out of the
+    /// cycles, and the merges of the partitions over the budget in the
+    /// current run.
+    /// @{
+    std::unordered_map< NodeRef, TracePartitions > m_post_partitions;
+    unsigned m_num_partition_merges = 0U;
+    /// @}
+
+    /// \brief Deadline of the run, if any.
+    FunctionDeadline* m_deadline = nullptr;
 
     ProgramStateRef m_bottom;
 
   public:
     WtoBasedFixPointIterator(const StackFrame* frame, ProgramStateRef bottom)
         : m_cfg(frame->get_cfg()),
-          m_wto(frame->get_cfg()),
+          m_wto(frame->get_wto()),
+          m_pre(m_cfg, bottom),
+          m_post(m_cfg, bottom),
           m_bottom(std::move(bottom)) {}
     WtoBasedFixPointIterator(const WtoBasedFixPointIterator&) = delete;
     WtoBasedFixPointIterator& operator=(const WtoBasedFixPointIterator&) =
@@ -67,8 +137,66 @@ class WtoBasedFixPointIterator : public FixPointIterator< CFG, GraphTrait > {
   public:
     [[nodiscard]] bool is_converged() const override { return m_converged; }
     [[nodiscard]] GraphRef get_cfg() const override { return m_cfg; }
-    [[nodiscard]] const Wto& get_wto() const { return m_wto; }
+    [[nodiscard]] const Wto& get_wto() const { return *m_wto; }
     [[nodiscard]] const ProgramStateRef& get_bottom() const { return m_bottom; }
+    [[nodiscard]] FixpointStrategy get_strategy() const { return m_strategy; }
+
+    /// \brief Select the strategy used by the next run.
+    void set_strategy(FixpointStrategy strategy) { m_strategy = strategy; }
+
+    [[nodiscard]] const LoopIterationPolicy& get_policy() const {
+        return m_policy;
+    }
+    void set_policy(LoopIterationPolicy policy) { m_policy = policy; }
+
+    /// \brief Get the widening delay of a loop head.
+    [[nodiscard]] unsigned get_widening_delay(NodeRef head) const {
+        auto it = m_widening_delays.find(head);
+        return it == m_widening_delays.end() ? m_policy.widening_delay
+                                             : it->second;
+    }
+
+    /// \brief Override the widening delay of a loop head.
+    void set_widening_delay(NodeRef head, unsigned delay) {
+        m_widening_delays[head] = delay;
+    }
+
+    /// \brief Set the deadline checked while computing the fixpoint.
+    void set_deadline(FunctionDeadline* deadline) { m_deadline = deadline; }
+
+    /// \brief Check if the fixpoint was cut by the deadline.
+    [[nodiscard]] bool is_deadline_expired() const {
+        return m_deadline != nullptr && m_deadline->is_expired();
+    }
+
+    /// \brief Get the number of loop iterations of the last run.
+    [[nodiscard]] unsigned get_num_iterations() const {
+        return m_num_iterations;
+    }
+
+    /// \brief Get the number of loop heads of the last run which hit the
+    /// narrowing cap or the iteration budget.
+    [[nodiscard]] unsigned get_num_loops_over_budget() const {
+        return static_cast< unsigned >(m_over_budget_heads.size());
+    }
+
+    /// \brief Get the number of node transfers of the last run skipped
+    /// since their pre states were bottom.
+    [[nodiscard]] unsigned get_num_skipped_nodes() const {
+        return m_num_skipped_nodes;
+    }
+
+    /// \brief Get the number of visits of the nested cycles of the last
+    /// run which reused the invariants of their previous visit.
+    [[nodiscard]] unsigned get_num_reused_cycles() const {
+        return m_num_reused_cycles;
+    }
+
+    /// \brief Get the number of merges of the trace partitions of the
+    /// last run over the budget.
+    [[nodiscard]] unsigned get_num_partition_merges() const {
+        return m_num_partition_merges;
+    }
 
   public:
     [[nodiscard]] ProgramStateRef get_pre(NodeRef node) const override {
@@ -86,11 +214,11 @@ class WtoBasedFixPointIterator : public FixPointIterator< CFG, GraphTrait > {
     /// \param state_before State before the iteration
     /// \param state_after State after the iteration
     [[nodiscard]] virtual ProgramStateRef merge_at_head_when_increasing(
-        [[maybe_unused]] NodeRef head,
+        NodeRef head,
         unsigned iter_cnt,
         const ProgramStateRef& state_before,
         const ProgramStateRef& state_after) {
-        if (iter_cnt < 2) {
+        if (iter_cnt <= this->get_widening_delay(head)) {
             return state_before->join_consecutive_iter(state_after);
         }
         return state_before->widen(state_after);
@@ -150,32 +278,360 @@ class WtoBasedFixPointIterator : public FixPointIterator< CFG, GraphTrait > {
     /// \brief Notify the end of the handling a cycle
     virtual void notify_exit_cycle([[maybe_unused]] NodeRef head) {}
 
+    /// \brief Notify the number of trace partitions a node out of the
+    /// cycles is transferred with, once merged within the budget
+    virtual void notify_trace_partitions(
+        [[maybe_unused]] NodeRef node,
+        [[maybe_unused]] unsigned num_partitions) {}
+
     void run(ProgramStateRef init_state) override {
         this->clear();
-        this->set_pre(GraphTrait::entry(this->m_cfg), std::move(init_state));
 
         // Compute the fixpoint
-        WtoIterator iterator(*this);
-        this->m_wto.accept(iterator);
+        if (this->m_strategy == FixpointStrategy::Worklist) {
+            WorklistIterator iterator(*this);
+            iterator.run(std::move(init_state));
+        } else {
+            this->set_pre(GraphTrait::entry(this->m_cfg),
+                          std::move(init_state));
+            WtoIterator iterator(*this);
+            this->m_wto->accept(iterator);
+        }
         this->m_converged = true;
+    }
 
+    /// \brief Check the invariants of the converged fixpoint.
+    ///
+    /// The checkers only read the invariants, so the checking phase is
+    /// run apart from the computation, and skipped if nothing is checked.
+    void check() {
+        knight_assert_msg(this->m_converged,
+                          "the fixpoint shall converge before the check");
         WtoChecker checker(*this);
-        this->m_wto.accept(checker);
+        this->m_wto->accept(checker);
     }
 
     /// \brief Clear the current fixpoint
     void clear() override {
         this->m_converged = false;
-        InvariantMap().swap(this->m_pre);
-        InvariantMap().swap(this->m_post);
+        this->m_num_iterations = 0U;
+        this->m_num_skipped_nodes = 0U;
+        this->m_num_reused_cycles = 0U;
+        this->m_num_partition_merges = 0U;
+        std::unordered_map< NodeRef, TracePartitions >().swap(
+            this->m_post_partitions);
+        std::unordered_set< NodeRef >().swap(this->m_over_budget_heads);
+        this->m_pre.clear();
+        this->m_post.clear();
     }
 
   private:
-    void set(InvariantMap& inv_map,
+    /// \brief Count one step of the deadline.
+    ///
+    /// \return true if the deadline is expired.
+    bool step_deadline() { return m_deadline != nullptr && m_deadline->step(); }
+
+    /// \brief Join the state with the one of the edge, skipping the edge
+    /// from an unreachable predecessor.
+    [[nodiscard]] ProgramStateRef join_edge(const ProgramStateRef& state,
+                                            NodeRef pred,
+                                            NodeRef node) {
+        const ProgramStateRef& pred_post = get_post(pred);
+        if (pred_post->is_bottom()) {
+            return state;
+        }
+        return state->join(transfer_edge(pred, node, pred_post));
+    }
+
+    /// \brief Join the state with the ones of the edges from the
+    /// predecessors accepted by the filter, in a single n-ary join.
+    template < typename Filter >
+    [[nodiscard]] ProgramStateRef join_edges(const ProgramStateRef& state,
+                                             NodeRef node,
+                                             Filter&& is_joined) {
+        llvm::SmallVector< ProgramStateRef, 8 > states{state};
+        for (auto it = GraphTrait::pred_begin(node),
+                  end = GraphTrait::pred_end(node);
+             it != end;
+             ++it) {
+            NodeRef pred = *it;
+            if (pred == nullptr || !is_joined(pred)) {
+                continue;
+            }
+            const ProgramStateRef& pred_post = get_post(pred);
+            if (!pred_post->is_bottom()) {
+                states.push_back(transfer_edge(pred, node, pred_post));
+            }
+        }
+        if (states.size() == 1U) {
+            return state;
+        }
+        return state->get_state_manager().join_all(states);
+    }
+
+    /// \brief Transfer the node, unless it is unreachable, i.e., its pre
+    /// state is bottom which the node cannot leave.
+    [[nodiscard]] ProgramStateRef transfer_reachable_node(
+        NodeRef node, ProgramStateRef pre_state) {
+        if (pre_state->is_bottom()) {
+            ++m_num_skipped_nodes;
+            return pre_state;
+        }
+        return transfer_node(node, std::move(pre_state));
+    }
+
+    /// \brief Transfer a node out of the cycles, keeping apart the traces
+    /// of its predecessors by their recent branch decisions.
+    ///
+    /// Each partition is transferred on its own, and the pre and post
+    /// states of the node are the joins of its partitions, which the
+    /// checkers and the cycles read. The traces are thus only merged when
+    /// entering a cycle, or when over the budget.
+    void transfer_partitions(NodeRef node) {
+        TracePartitions pres;
+        add_partition(pres, TraceKey(), get_pre(node));
+        for (auto it = GraphTrait::pred_begin(node),
+                  end = GraphTrait::pred_end(node);
+             it != end;
+             ++it) {
+            NodeRef pred = *it;
+            if (pred == nullptr) {
+                continue;
+            }
+            auto partitions_it = m_post_partitions.find(pred);
+            if (partitions_it == m_post_partitions.end()) {
+                const ProgramStateRef& pred_post = get_post(pred);
+                if (!pred_post->is_bottom()) {
+                    add_partition(pres,
+                                  extend_key(TraceKey(), pred, node),
+                                  transfer_edge(pred, node, pred_post));
+                }
+                continue;
+            }
+            for (const auto& partition : partitions_it->second) {
+                add_partition(pres,
+                              extend_key(partition.key, pred, node),
+                              transfer_edge(pred, node, partition.state));
+            }
+        }
+        merge_partitions(pres);
+        if (pres.empty()) {
+            set_to_bottom(node);
+            return;
+        }
+        notify_trace_partitions(node, static_cast< unsigned >(pres.size()));
+
+        TracePartitions posts;
+        for (const auto& partition : pres) {
+            ProgramStateRef post =
+                transfer_node(node, partition.state)->normalize();
+            if (!post->is_bottom()) {
+                posts.push_back(TracePartition{partition.key, std::move(post)});
+            }
+        }
+        set_pre(node, join_partitions(pres));
+        set_post(node, join_partitions(posts));
+        if (!posts.empty()) {
+            m_post_partitions.emplace(node, std::move(posts));
+        }
+    }
+
+    /// \brief Get the key of a trace taking the edge, which records a
+    /// decision if the predecessor branches.
+    [[nodiscard]] static TraceKey extend_key(const TraceKey& key,
+                                             NodeRef pred,
+                                             NodeRef node) {
+        unsigned position = 0U;
+        unsigned num_succs = 0U;
+        bool found = false;
+        for (auto it = GraphTrait::succ_begin(pred),
+                  end = GraphTrait::succ_end(pred);
+             it != end;
+             ++it) {
+            NodeRef succ = *it;
+            if (succ == nullptr) {
+                continue;
+            }
+            if (!found && succ == node) {
+                position = num_succs;
+                found = true;
+            }
+            ++num_succs;
+        }
+        if (num_succs < 2U) {
+            return key;
+        }
+        TraceKey extended{TraceDecision{pred, position}};
+        extended.append(key.begin(),
+                        key.begin() +
+                            std::min(key.size(), MaxTraceDecisions - 1U));
+        return extended;
+    }
+
+    /// \brief Get the number of the recent decisions shared by the keys.
+    [[nodiscard]] static std::size_t get_common_length(const TraceKey& lhs,
+                                                       const TraceKey& rhs) {
+        auto [lhs_it, rhs_it] =
+            std::mismatch(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+        return static_cast< std::size_t >(lhs_it - lhs.begin());
+    }
+
+    /// \brief Add the state of a trace to its partition, skipping the
+    /// unreachable ones.
+    static void add_partition(TracePartitions& partitions,
+                              TraceKey key,
+                              const ProgramStateRef& state) {
+        if (state->is_bottom()) {
+            return;
+        }
+        auto it = llvm::find_if(partitions, [&key](const auto& partition) {
+            return partition.key == key;
+        });
+        if (it == partitions.end()) {
+            partitions.push_back(
+                TracePartition{std::move(key), state->normalize()});
+            return;
+        }
+        it->state = it->state->join(state)->normalize();
+    }
+
+    /// \brief Merge the partitions over the budget.
+    ///
+    /// The partitions subsumed by another one are merged first, as their
+    /// join loses nothing. Then the pairs sharing the most recent
+    /// decisions are merged, as their traces only differ by the oldest
+    /// ones, and the merged partition keeps the shared decisions.
+    void merge_partitions(TracePartitions& partitions) {
+        const std::size_t budget =
+            std::max(m_policy.max_trace_partitions, 1U);
+        for (std::size_t idx = 0U;
+             idx < partitions.size() && partitions.size() > budget;) {
+            const auto& subsumed = partitions[idx];
+            auto subsumer =
+                std::find_if(partitions.begin(),
+                             partitions.end(),
+                             [&subsumed](const auto& partition) {
+                                 return &partition != &subsumed &&
+                                        subsumed.state->leq(*partition.state);
+                             });
+            if (subsumer == partitions.end()) {
+                ++idx;
+                continue;
+            }
+            subsumer->key.truncate(
+                get_common_length(subsumer->key, subsumed.key));
+            partitions.erase(partitions.begin() + idx);
+            ++m_num_partition_merges;
+        }
+        while (partitions.size() > budget) {
+            std::size_t best_lhs = 0U;
+            std::size_t best_rhs = 1U;
+            std::size_t best_length = 0U;
+            for (std::size_t lhs = 0U; lhs < partitions.size(); ++lhs) {
+                for (std::size_t rhs = lhs + 1U; rhs < partitions.size();
+                     ++rhs) {
+                    auto length = get_common_length(partitions[lhs].key,
+                                                    partitions[rhs].key);
+                    if (length > best_length) {
+                        best_lhs = lhs;
+                        best_rhs = rhs;
+                        best_length = length;
+                    }
+                }
+            }
+            auto& merged = partitions[best_lhs];
+            merged.key.truncate(best_length);
+            merged.state =
+                merged.state->join(partitions[best_rhs].state)->normalize();
+            partitions.erase(partitions.begin() + best_rhs);
+            ++m_num_partition_merges;
+        }
+    }
+
+    /// \brief Join the states of the partitions, bottom if none.
+    [[nodiscard]] ProgramStateRef join_partitions(
+        const TracePartitions& partitions) const {
+        if (partitions.empty()) {
+            return m_bottom;
+        }
+        if (partitions.size() == 1U) {
+            return partitions.front().state;
+        }
+        llvm::SmallVector< ProgramStateRef, 8 > states;
+        for (const auto& partition : partitions) {
+            states.push_back(partition.state);
+        }
+        return states.front()->get_state_manager().join_all(states);
+    }
+
+    /// \brief Set the node to bottom, as it is unreachable.
+    void set_to_bottom(NodeRef node) {
+        set_pre(node, m_bottom);
+        set_post(node, m_bottom);
+        ++m_num_skipped_nodes;
+    }
+
+    /// \brief Jump the node to top, once the deadline is expired.
+    void jump_to_top(NodeRef node) {
+        ProgramStateRef top = m_bottom->set_to_top();
+        set_pre(node, top);
+        set_post(node, std::move(top));
+    }
+
+    /// \brief Consume one loop iteration of the budget.
+    ///
+    /// \return false if the budget is exhausted.
+    bool consume_iteration(NodeRef head) {
+        if (m_policy.max_iterations != 0U &&
+            m_num_iterations >= m_policy.max_iterations) {
+            m_over_budget_heads.insert(head);
+            return false;
+        }
+        ++m_num_iterations;
+        return true;
+    }
+
+    /// \brief Merge at a loop head in the increasing iterations, falling
+    /// back to top once the iteration budget is exhausted.
+    [[nodiscard]] ProgramStateRef merge_increasing(
+        NodeRef head,
+        unsigned iter_cnt,
+        const ProgramStateRef& state_before,
+        const ProgramStateRef& state_after) {
+        if (is_deadline_expired() || !consume_iteration(head)) {
+            return state_before->set_to_top();
+        }
+        return merge_at_head_when_increasing(head,
+                                             iter_cnt,
+                                             state_before,
+                                             state_after);
+    }
+
+    /// \brief Check if the decreasing iterations stop at a loop head,
+    /// either at the fixpoint, the narrowing cap or the iteration budget.
+    [[nodiscard]] bool is_decreasing_done(NodeRef head,
+                                          unsigned iter_cnt,
+                                          const ProgramStateRef& state_before,
+                                          const ProgramStateRef& state_after) {
+        if (is_deadline_expired() ||
+            is_decreasing_fixpoint_reached(head,
+                                           iter_cnt,
+                                           state_before,
+                                           state_after)) {
+            return true;
+        }
+        if (iter_cnt >= m_policy.max_narrowing_iterations) {
+            m_over_budget_heads.insert(head);
+            return true;
+        }
+        return !consume_iteration(head);
+    }
+
+    void set(InvariantMapT& inv_map,
              const NodeRef& node,
              ProgramStateRef state) {
         state = state->normalize();
-        inv_map[node] = std::move(state);
+        inv_map.set(node, std::move(state));
     }
 
     void set_pre(NodeRef node, ProgramStateRef state) {
@@ -186,10 +642,9 @@ class WtoBasedFixPointIterator : public FixPointIterator< CFG, GraphTrait > {
         set(m_post, node, std::move(state));
     }
 
-    [[nodiscard]] const ProgramStateRef& get(const InvariantMap& inv_map,
+    [[nodiscard]] const ProgramStateRef& get(const InvariantMapT& inv_map,
                                              const NodeRef& node) const {
-        auto it = inv_map.find(node);
-        return it == inv_map.end() ? m_bottom : it->second;
+        return inv_map.get(node);
     }
 
 }; // class WtoBasedFixPointIterator
@@ -215,6 +670,43 @@ class WtoIterator final : public WtoComponentVisitor< G, GraphTrait > {
     /// \brief Graph entry point
     NodeRef m_entry;
 
+    /// \brief Nodes of the cycle checked by `is_unreachable()`.
+    std::vector< NodeRef > m_cycle_nodes;
+
+    /// \brief The entering states of the cycles whose last visit
+    /// converged, by their heads.
+    ///
+    /// The states are hash-consed, so that a nested cycle entered with
+    /// the same state in a later iteration of an outer cycle would
+    /// compute the same invariants again, which are kept instead.
+    std::unordered_map< NodeRef, ProgramStateRef > m_cycle_inputs;
+
+    /// \brief Whether the nodes of the cycles other than the heads have
+    /// predecessors out of the cycles, by their heads.
+    std::unordered_map< NodeRef, bool > m_side_entered_cycles;
+
+    /// \brief Collects the nodes of a cycle, the nested ones included.
+    class CycleNodeCollector final
+        : public WtoComponentVisitor< G, GraphTrait > {
+      private:
+        std::vector< NodeRef >& m_nodes;
+
+      public:
+        explicit CycleNodeCollector(std::vector< NodeRef >& nodes)
+            : m_nodes(nodes) {}
+
+        void visit(const WtoVertex& vertex) override {
+            m_nodes.push_back(vertex.get_node());
+        }
+
+        void visit(const WtoCycle& cycle) override {
+            m_nodes.push_back(cycle.get_head());
+            for (const auto* component : cycle.components()) {
+                component->accept(*this);
+            }
+        }
+    }; // class CycleNodeCollector
+
   public:
     explicit WtoIterator(WtoFPIterator& fp_iter)
         : m_fp_iterator(fp_iter),
@@ -227,58 +719,79 @@ class WtoIterator final : public WtoComponentVisitor< G, GraphTrait > {
     /// and apply node transfer function on pre to update the post-state.
     void visit(const WtoVertex& vertex) override {
         auto node = vertex.get_node();
-        ProgramStateRef state_pre = this->m_fp_iterator.get_pre(node);
-
-        for (auto it = GraphTrait::pred_begin(node),
-                  end = GraphTrait::pred_end(node);
-             it != end;
-             ++it) {
-            auto pred = *it;
-            state_pre = state_pre->join(
-                this->m_fp_iterator.transfer_edge(pred,
-                                                  node,
-                                                  this->m_fp_iterator.get_post(
-                                                      pred)));
+        if (this->m_fp_iterator.step_deadline()) {
+            this->m_fp_iterator.jump_to_top(node);
+            return;
         }
+        if (this->m_fp_iterator.get_policy().max_trace_partitions > 1U &&
+            this->m_fp_iterator.get_wto().get_nesting(node).empty()) {
+            this->m_fp_iterator.transfer_partitions(node);
+            return;
+        }
+        ProgramStateRef state_pre =
+            this->m_fp_iterator.join_edges(this->m_fp_iterator.get_pre(node),
+                                           node,
+                                           [](NodeRef) { return true; });
         this->m_fp_iterator.set_pre(node, state_pre);
-        this->m_fp_iterator
-            .set_post(node,
-                      this->m_fp_iterator.transfer_node(node,
-                                                        std::move(state_pre)));
+        this->m_fp_iterator.set_post(node,
+                                     this->m_fp_iterator
+                                         .transfer_reachable_node(
+                                             node, std::move(state_pre)));
     }
 
     void visit(const WtoCycle& cycle) override {
         auto head = cycle.get_head();
-        ProgramStateRef state_pre = this->m_fp_iterator.get_bottom();
         auto& wto = this->m_fp_iterator.get_wto();
         const auto& nesting = wto.get_nesting(head);
 
         this->m_fp_iterator.notify_enter_cycle(head);
 
-        for (auto it = GraphTrait::pred_begin(head),
-                  end = GraphTrait::pred_end(head);
-             it != end;
-             ++it) {
-            auto pred = *it;
-            if (wto.get_nesting(pred) <= nesting) {
-                state_pre = state_pre->join(
-                    this->m_fp_iterator
-                        .transfer_edge(pred,
-                                       head,
-                                       this->m_fp_iterator.get_post(pred)));
+        ProgramStateRef state_pre =
+            this->m_fp_iterator.join_edges(this->m_fp_iterator.get_bottom(),
+                                           head,
+                                           [&](NodeRef pred) {
+                                               return wto.get_nesting(pred) <=
+                                                      nesting;
+                                           });
+
+        // The nodes of the cycle stay bottom if no edge enters the cycle.
+        if (state_pre->is_bottom() && this->is_unreachable(cycle)) {
+            for (auto node : this->m_cycle_nodes) {
+                this->m_fp_iterator.set_to_bottom(node);
+                // The invariants of the nested cycles are reset as well.
+                this->m_cycle_inputs.erase(node);
             }
+            this->m_fp_iterator.notify_exit_cycle(head);
+            return;
+        }
+
+        // The invariants of the last visit still hold for the same input.
+        state_pre = state_pre->normalize();
+        if (this->is_reusable(cycle, state_pre)) {
+            ++this->m_fp_iterator.m_num_reused_cycles;
+            this->m_fp_iterator.notify_exit_cycle(head);
+            return;
         }
+        ProgramStateRef input = state_pre;
 
         // Compute the fixpoint
         IterationKind kind = IterationKind::Increasing;
         for (unsigned iter_cnt = 1;; ++iter_cnt) {
+            if (this->m_fp_iterator.step_deadline()) {
+                this->m_fp_iterator.jump_to_top(head);
+                for (const auto* component : cycle.components()) {
+                    component->accept(*this);
+                }
+                break;
+            }
             this->m_fp_iterator.notify_each_cycle_iteration(head,
                                                             iter_cnt,
                                                             kind);
             this->m_fp_iterator.set_pre(head, state_pre);
-            this->m_fp_iterator
-                .set_post(head,
-                          this->m_fp_iterator.transfer_node(head, state_pre));
+            this->m_fp_iterator.set_post(head,
+                                         this->m_fp_iterator
+                                             .transfer_reachable_node(
+                                                 head, state_pre));
 
             for (auto* component : cycle.components()) {
                 component->accept(*this);
@@ -293,16 +806,16 @@ class WtoIterator final : public WtoComponentVisitor< G, GraphTrait > {
                       end = GraphTrait::pred_end(head);
                  it != end;
                  ++it) {
-                auto pred = *it;
-                ProgramStateRef head_in =
-                    this->m_fp_iterator
-                        .transfer_edge(pred,
-                                       head,
-                                       this->m_fp_iterator.get_post(pred));
+                NodeRef pred = *it;
+                if (pred == nullptr) {
+                    continue;
+                }
                 if (wto.get_nesting(pred) <= nesting) {
-                    new_state_front = new_state_front->join(std::move(head_in));
+                    new_state_front = this->m_fp_iterator.join_edge(
+                        new_state_front, pred, head);
                 } else {
-                    new_state_back = new_state_back->join(std::move(head_in));
+                    new_state_back = this->m_fp_iterator.join_edge(
+                        new_state_back, pred, head);
                 }
             }
 
@@ -311,11 +824,10 @@ class WtoIterator final : public WtoComponentVisitor< G, GraphTrait > {
             new_state_front = new_state_front->normalize();
             if (kind == IterationKind::Increasing) {
                 ProgramStateRef increased =
-                    this->m_fp_iterator
-                        .merge_at_head_when_increasing(head,
-                                                       iter_cnt,
-                                                       state_pre,
-                                                       new_state_front);
+                    this->m_fp_iterator.merge_increasing(head,
+                                                         iter_cnt,
+                                                         state_pre,
+                                                         new_state_front);
                 increased = increased->normalize();
                 if (this->m_fp_iterator
                         .is_increasing_fixpoint_reached(head,
@@ -338,11 +850,10 @@ class WtoIterator final : public WtoComponentVisitor< G, GraphTrait > {
                                                              state_pre,
                                                              new_state_front);
                 refined = refined->normalize();
-                if (this->m_fp_iterator
-                        .is_decreasing_fixpoint_reached(head,
-                                                        iter_cnt,
-                                                        state_pre,
-                                                        refined)) {
+                if (this->m_fp_iterator.is_decreasing_done(head,
+                                                           iter_cnt,
+                                                           state_pre,
+                                                           refined)) {
                     // Decreasing fixpoint is reached
                     this->m_fp_iterator.set_pre(head, std::move(refined));
                     break;
@@ -351,10 +862,305 @@ class WtoIterator final : public WtoComponentVisitor< G, GraphTrait > {
             }
         }
 
+        if (this->m_fp_iterator.is_deadline_expired()) {
+            this->m_cycle_inputs.erase(head);
+        } else {
+            this->m_cycle_inputs[head] = std::move(input);
+        }
         this->m_fp_iterator.notify_exit_cycle(head);
     }
 
+  private:
+    /// \brief Check if the cycle converged in its last visit from the
+    /// same entering state, so that its invariants can be kept.
+    ///
+    /// Only the cycles entered through their heads are reused, since the
+    /// other entering edges are not part of the recorded state.
+    [[nodiscard]] bool is_reusable(const WtoCycle& cycle,
+                                   const ProgramStateRef& state_pre) {
+        auto head = cycle.get_head();
+        auto it = this->m_cycle_inputs.find(head);
+        if (it == this->m_cycle_inputs.end() || it->second != state_pre) {
+            return false;
+        }
+        auto [side_it, inserted] =
+            this->m_side_entered_cycles.try_emplace(head, false);
+        if (inserted) {
+            side_it->second = this->has_side_entries(cycle);
+        }
+        return !side_it->second;
+    }
+
+    /// \brief Check if a node of the cycle other than the head has a
+    /// predecessor out of the cycle.
+    [[nodiscard]] bool has_side_entries(const WtoCycle& cycle) const {
+        auto head = cycle.get_head();
+        const auto& wto = this->m_fp_iterator.get_wto();
+        std::vector< NodeRef > nodes;
+        CycleNodeCollector collector(nodes);
+        cycle.accept(collector);
+        for (auto node : nodes) {
+            if (node == head) {
+                continue;
+            }
+            for (auto it = GraphTrait::pred_begin(node),
+                      end = GraphTrait::pred_end(node);
+                 it != end;
+                 ++it) {
+                NodeRef pred = *it;
+                if (pred != nullptr && pred != head &&
+                    !llvm::is_contained(wto.get_nesting(pred), head)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /// \brief Check if no edge from a reachable node enters the cycle.
+    ///
+    /// Besides the head, the nodes of an irreducible cycle may have
+    /// predecessors out of the cycle, which are checked as well. The
+    /// nodes of the cycle are collected to `m_cycle_nodes`.
+    [[nodiscard]] bool is_unreachable(const WtoCycle& cycle) {
+        auto head = cycle.get_head();
+        if (head == this->m_entry) {
+            return false;
+        }
+        const auto& wto = this->m_fp_iterator.get_wto();
+        this->m_cycle_nodes.clear();
+        CycleNodeCollector collector(this->m_cycle_nodes);
+        cycle.accept(collector);
+        for (auto node : this->m_cycle_nodes) {
+            for (auto it = GraphTrait::pred_begin(node),
+                      end = GraphTrait::pred_end(node);
+                 it != end;
+                 ++it) {
+                NodeRef pred = *it;
+                if (pred == nullptr || pred == head ||
+                    llvm::is_contained(wto.get_nesting(pred), head)) {
+                    continue;
+                }
+                if (!this->m_fp_iterator.get_post(pred)->is_bottom()) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
 }; // class WtoIterator
+
+/// \brief Worklist fixpoint iteration over the WTO.
+///
+/// Nodes are numbered by their position in the WTO and popped from the
+/// worklist in that order. A node is only re-visited when the post state
+/// of one of its predecessors changed, and a node whose post state does
+/// not change does not propagate to its successors. Cycle heads are the
+/// widening points in the increasing iterations, and the narrowing points
+/// in the decreasing iterations seeded from all the heads.
+template < graph G, typename GraphTrait >
+class WorklistIterator final : public WtoComponentVisitor< G, GraphTrait > {
+  public:
+    using WtoFPIterator = WtoBasedFixPointIterator< G, GraphTrait >;
+    using GraphRef = typename WtoFPIterator::GraphRef;
+    using NodeRef = typename WtoFPIterator::NodeRef;
+
+    using WtoVertex = WtoVertex< G, GraphTrait >;
+    using WtoCycle = WtoCycle< G, GraphTrait >;
+
+  private:
+    /// \brief Fixpoint iterator
+    WtoFPIterator& m_fp_iterator;
+
+    /// \brief Graph entry point
+    NodeRef m_entry;
+
+    /// \brief Nodes by WTO position, and their positions.
+    /// @{
+    std::vector< NodeRef > m_nodes;
+    std::unordered_map< NodeRef, unsigned > m_positions;
+    /// @}
+
+    /// \brief Iteration counts of the cycle heads.
+    std::unordered_map< NodeRef, unsigned > m_head_iter_cnts;
+
+    /// \brief Nodes visited at least once.
+    std::unordered_set< NodeRef > m_visited;
+
+    /// \brief Positions of the nodes to visit.
+    std::set< unsigned > m_worklist;
+
+  public:
+    explicit WorklistIterator(WtoFPIterator& fp_iter)
+        : m_fp_iterator(fp_iter),
+          m_entry(GraphTrait::entry(fp_iter.get_cfg())) {
+        this->m_fp_iterator.get_wto().accept(*this);
+    }
+
+  public:
+    /// \brief Number the vertex in the WTO order.
+    void visit(const WtoVertex& vertex) override {
+        this->add_node(vertex.get_node());
+    }
+
+    /// \brief Number the cycle head and then the cycle components.
+    void visit(const WtoCycle& cycle) override {
+        auto head = cycle.get_head();
+        this->add_node(head);
+        this->m_head_iter_cnts.emplace(head, 0U);
+        for (auto* component : cycle.components()) {
+            component->accept(*this);
+        }
+    }
+
+    void run(ProgramStateRef init_state) {
+        this->push(this->m_entry);
+        this->iterate(IterationKind::Increasing, init_state);
+        if (this->m_fp_iterator.is_deadline_expired()) {
+            return;
+        }
+
+        for (auto& [head, iter_cnt] : this->m_head_iter_cnts) {
+            iter_cnt = 0U;
+            this->push(head);
+        }
+        this->iterate(IterationKind::Decreasing, init_state);
+    }
+
+  private:
+    void add_node(NodeRef node) {
+        this->m_positions.emplace(node, this->m_nodes.size());
+        this->m_nodes.push_back(node);
+    }
+
+    void push(NodeRef node) {
+        auto it = this->m_positions.find(node);
+        if (it != this->m_positions.end()) {
+            this->m_worklist.insert(it->second);
+        }
+    }
+
+    [[nodiscard]] ProgramStateRef join_preds(
+        NodeRef node, const ProgramStateRef& init_state) {
+        ProgramStateRef state = node == this->m_entry
+                                    ? init_state
+                                    : this->m_fp_iterator.get_bottom();
+        state = this->m_fp_iterator.join_edges(state, node, [](NodeRef) {
+            return true;
+        });
+        return state->normalize();
+    }
+
+    /// \brief Merge the joined in state of a visited cycle head with its
+    /// previous pre state.
+    ///
+    /// \return the new pre state, or null if the head is stable.
+    [[nodiscard]] ProgramStateRef merge_at_head(NodeRef head,
+                                                IterationKind kind,
+                                                ProgramStateRef state_pre,
+                                                ProgramStateRef joined) {
+        auto iter_cnt = ++this->m_head_iter_cnts[head];
+        this->m_fp_iterator.notify_each_cycle_iteration(head, iter_cnt, kind);
+        if (kind == IterationKind::Increasing) {
+            ProgramStateRef increased =
+                this->m_fp_iterator
+                    .merge_increasing(head, iter_cnt, state_pre, joined)
+                    ->normalize();
+            if (this->m_fp_iterator.is_increasing_fixpoint_reached(head,
+                                                                   iter_cnt,
+                                                                   state_pre,
+                                                                   increased)) {
+                return nullptr;
+            }
+            return increased;
+        }
+
+        ProgramStateRef refined =
+            this->m_fp_iterator
+                .narrow_at_loop_head_when_decreasing(head,
+                                                     iter_cnt,
+                                                     state_pre,
+                                                     joined)
+                ->normalize();
+        if (this->m_fp_iterator.is_decreasing_done(head,
+                                                   iter_cnt,
+                                                   state_pre,
+                                                   refined)) {
+            return nullptr;
+        }
+        return refined;
+    }
+
+    /// \brief Jump all the nodes to top, once the deadline is expired.
+    ///
+    /// Unlike the recursive strategy, no node is known to be stable
+    /// before the end of the iterations.
+    void jump_to_top() {
+        this->m_worklist.clear();
+        for (auto node : this->m_nodes) {
+            this->m_fp_iterator.jump_to_top(node);
+        }
+    }
+
+    void iterate(IterationKind kind, const ProgramStateRef& init_state) {
+        while (!this->m_worklist.empty()) {
+            if (this->m_fp_iterator.step_deadline()) {
+                this->jump_to_top();
+                return;
+            }
+            auto node = this->m_nodes[*this->m_worklist.begin()];
+            this->m_worklist.erase(this->m_worklist.begin());
+
+            bool visited = this->m_visited.contains(node);
+            ProgramStateRef state_pre = this->join_preds(node, init_state);
+            if (visited) {
+                ProgramStateRef old_pre = this->m_fp_iterator.get_pre(node);
+                if (this->m_head_iter_cnts.contains(node)) {
+                    state_pre = this->merge_at_head(node,
+                                                    kind,
+                                                    std::move(old_pre),
+                                                    std::move(state_pre));
+                    if (!state_pre) {
+                        continue;
+                    }
+                } else if (state_pre == old_pre) {
+                    continue;
+                }
+            }
+
+            ProgramStateRef old_post = this->m_fp_iterator.get_post(node);
+            this->m_fp_iterator.set_pre(node, std::move(state_pre));
+            this->m_fp_iterator
+                .set_post(node,
+                          this->m_fp_iterator
+                              .transfer_reachable_node(node,
+                                                       this->m_fp_iterator
+                                                           .get_pre(node)));
+            this->m_visited.insert(node);
+            if (visited && this->m_fp_iterator.get_post(node) == old_post) {
+                continue;
+            }
+            // The successors gain nothing from a node first found
+            // unreachable.
+            if (!visited && this->m_fp_iterator.get_post(node)->is_bottom()) {
+                continue;
+            }
+
+            for (auto it = GraphTrait::succ_begin(node),
+                      end = GraphTrait::succ_end(node);
+                 it != end;
+                 ++it) {
+                NodeRef succ = *it;
+                if (succ != nullptr) {
+                    this->push(succ);
+                }
+            }
+        }
+    }
+
+}; // class WorklistIterator
+
 template < graph G, typename GraphTrait >
 class WtoChecker final : public WtoComponentVisitor< G, GraphTrait > {
   public:
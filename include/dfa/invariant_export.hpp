@@ -0,0 +1,69 @@
+//===- invariant_export.hpp -------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the opt-in export of the computed invariants.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/proc_cfg.hpp"
+#include "dfa/program_state.hpp"
+
+#include <clang/AST/DeclBase.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <atomic>
+#include <vector>
+
+namespace knight::dfa {
+
+/// \brief The states of a block, or of a stmt of the block.
+struct InvariantSite {
+    ProcCFG::NodeRef block;
+    ProcCFG::StmtRef stmt = nullptr;
+    ProgramStateRef pre;
+    ProgramStateRef post;
+}; // struct InvariantSite
+
+/// \brief The process-wide export of the invariants, disabled by default.
+///
+/// The analyzed functions record the states of their blocks, and of their
+/// stmts if asked, which are written at exit as an invariant file, see
+/// `InvariantFile`. The states are identified by their dumped texts, as
+/// the hash-consed states do not outlive their function.
+class InvariantExporter {
+  private:
+    static inline std::atomic< bool > s_enabled{false};
+    static inline std::atomic< bool > s_with_stmts{false};
+
+  public:
+    static void enable(bool with_stmts) {
+        s_with_stmts.store(with_stmts, std::memory_order_relaxed);
+        s_enabled.store(true, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] static bool is_enabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] static bool is_with_stmts() {
+        return s_with_stmts.load(std::memory_order_relaxed);
+    }
+
+    /// \brief Record the states of the sites of the analyzed function.
+    static void record_function(const clang::Decl* function,
+                                const std::vector< InvariantSite >& sites);
+
+    /// \brief Write the recorded invariants to the given file.
+    ///
+    /// \return false if the file cannot be written.
+    static bool write(llvm::StringRef path);
+}; // class InvariantExporter
+
+} // namespace knight::dfa
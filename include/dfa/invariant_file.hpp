@@ -0,0 +1,146 @@
+//===- invariant_file.hpp ---------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the layout and the reader of the exported
+//  invariant files.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace knight::dfa {
+
+/// \brief The layout of an invariant file, all in little endian:
+///
+/// - the header, of the magic, the version, the counts of the states,
+///   the names and the points, and a padding;
+/// - the offsets of the states then of the names in the blob, as
+///   `u64`s, one more than their counts;
+/// - the columns of the points, as `u32`s, one column after the other;
+/// - the blob of the texts of the states and of the names.
+///
+/// The names, i.e. the files and the functions, are sorted, and so are
+/// the points by their file, line and column, so that they are looked up
+/// by binary search in the mapped file.
+namespace invariant_file {
+
+constexpr uint32_t Magic = 0x564e494bU; // "KINV"
+constexpr uint32_t Version = 1U;
+constexpr std::size_t HeaderSize = 24U;
+
+} // namespace invariant_file
+
+enum class InvariantColumn : unsigned {
+    /// \brief The name of the file of the point, empty if unknown.
+    File,
+    Line,
+    Column,
+    /// \brief The name of the function of the point.
+    Function,
+    /// \brief The kind of the point, see `InvariantPointKind`.
+    Kind,
+    Block,
+    /// \brief The states before and after the point.
+    /// @{
+    Pre,
+    Post,
+    /// @}
+}; // enum class InvariantColumn
+
+constexpr unsigned NumInvariantColumns = 8U;
+
+enum class InvariantPointKind : uint32_t {
+    /// \brief The states at the entry and the exit of a block, located at
+    /// its first stmt.
+    Block,
+    /// \brief The states before and after a stmt of a block.
+    Stmt,
+}; // enum class InvariantPointKind
+
+/// \brief A point of an invariant file, whose strings are views of the
+/// mapped file.
+struct InvariantPoint {
+    llvm::StringRef file;
+    unsigned line = 0U;
+    unsigned column = 0U;
+    llvm::StringRef function;
+    InvariantPointKind kind = InvariantPointKind::Block;
+    unsigned block_id = 0U;
+    uint32_t pre_state = 0U;
+    uint32_t post_state = 0U;
+}; // struct InvariantPoint
+
+/// \brief An invariant file mapped in memory, read in place.
+class InvariantFile {
+  private:
+    std::unique_ptr< llvm::MemoryBuffer > m_buffer;
+    uint32_t m_state_cnt = 0U;
+    uint32_t m_name_cnt = 0U;
+    uint32_t m_point_cnt = 0U;
+    const char* m_state_offsets = nullptr;
+    const char* m_name_offsets = nullptr;
+    const char* m_columns = nullptr;
+    llvm::StringRef m_blob;
+
+  public:
+    /// \brief Map and validate the invariant file.
+    ///
+    /// \return none if the file cannot be read or is malformed.
+    [[nodiscard]] static std::optional< InvariantFile > open(
+        llvm::StringRef path);
+
+  public:
+    [[nodiscard]] uint32_t get_num_states() const { return m_state_cnt; }
+    [[nodiscard]] uint32_t get_num_points() const { return m_point_cnt; }
+
+    /// \brief Get the text of the state, as dumped by the program state.
+    [[nodiscard]] llvm::StringRef get_state(uint32_t state_id) const;
+
+    [[nodiscard]] InvariantPoint get_point(uint32_t point_idx) const;
+
+    /// \brief Find the invariant holding at the source location, i.e. the
+    /// first point of the closest location at or before it in the file.
+    ///
+    /// \return the index of the point, or none if the file has no point
+    /// up to the location.
+    [[nodiscard]] std::optional< uint32_t > find_point(llvm::StringRef file,
+                                                       unsigned line,
+                                                       unsigned column) const;
+
+    /// \brief Find the point of the block of the function.
+    [[nodiscard]] std::optional< uint32_t > find_block(
+        llvm::StringRef function, unsigned block_id) const;
+
+  private:
+    explicit InvariantFile(std::unique_ptr< llvm::MemoryBuffer > buffer)
+        : m_buffer(std::move(buffer)) {}
+
+    /// \brief Check the layout and the values of the columns.
+    [[nodiscard]] bool validate();
+
+    [[nodiscard]] uint32_t get_value(InvariantColumn column,
+                                     uint32_t point_idx) const;
+
+    [[nodiscard]] llvm::StringRef get_name(uint32_t name_id) const;
+
+    /// \brief Find the ID of the name by binary search.
+    [[nodiscard]] std::optional< uint32_t > find_name(
+        llvm::StringRef name) const;
+}; // class InvariantFile
+
+} // namespace knight::dfa
@@ -0,0 +1,102 @@
+//===- liveness.hpp ---------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the live variable analysis over the ProcCFG.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/proc_cfg.hpp"
+
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
+
+#include <optional>
+#include <vector>
+
+namespace knight::dfa {
+
+class LiveVariables;
+
+/// \brief The direct access of a local variable by a stmt.
+struct VarAccess {
+    const clang::VarDecl* var = nullptr;
+    bool is_read = false;
+    bool is_written = false;
+}; // struct VarAccess
+
+/// \brief Get the local variable read or written directly by the stmt,
+/// which is none if the stmt accesses no local variable by its name.
+[[nodiscard]] VarAccess get_var_access(const clang::Stmt* stmt);
+
+/// \brief The set of the live local variables at a program point.
+///
+/// The variables not tracked by the liveness are always live.
+class LiveSet {
+  private:
+    const LiveVariables* m_live_vars;
+    const llvm::BitVector* m_live;
+
+  public:
+    LiveSet(const LiveVariables& live_vars, const llvm::BitVector& live)
+        : m_live_vars(&live_vars), m_live(&live) {}
+
+    [[nodiscard]] bool is_live(ProcCFG::VarDeclRef var) const;
+}; // class LiveSet
+
+/// \brief The live local variables of a function, computed by a backward
+/// dataflow over its CFG.
+///
+/// A local variable is live at a point if some path from the point reads
+/// it before writing it. Only the local variables which are read and
+/// written directly are tracked: the variables of which the address is
+/// taken, or which are captured or bound to a reference, may be accessed
+/// through memory and are kept live.
+class LiveVariables {
+    friend class LiveSet;
+
+  public:
+    using NodeRef = ProcCFG::NodeRef;
+    using VarDeclRef = ProcCFG::VarDeclRef;
+
+  private:
+    /// \brief The dense indices of the tracked variables.
+    llvm::DenseMap< VarDeclRef, unsigned > m_var_indices;
+
+    /// \brief The live variables at the entry of each node, indexed by
+    /// the block ID.
+    std::vector< llvm::BitVector > m_live_in;
+
+  public:
+    explicit LiveVariables(const ProcCFG& cfg);
+
+  public:
+    /// \brief Get the live variables at the entry of the node.
+    [[nodiscard]] LiveSet get_live_in(NodeRef node) const {
+        return {*this, m_live_in[ProcCFG::index(node)]};
+    }
+
+    /// \brief Get the number of the tracked variables.
+    [[nodiscard]] unsigned get_num_tracked_vars() const {
+        return m_var_indices.size();
+    }
+
+    /// \brief Get the dense index of the variable, if it is tracked.
+    [[nodiscard]] std::optional< unsigned > get_var_index(
+        VarDeclRef var) const;
+
+  private:
+    void collect_tracked_vars(const clang::CFG& cfg);
+
+    /// \brief Transfer the live variables backward through the node.
+    void transfer(NodeRef node, llvm::BitVector& live) const;
+}; // class LiveVariables
+
+} // namespace knight::dfa
@@ -13,30 +13,88 @@
 
 #pragma once
 
+#include "dfa/def_use.hpp"
+#include "dfa/liveness.hpp"
 #include "dfa/location_context.hpp"
 #include "dfa/stack_frame.hpp"
+#include "util/concurrent_folding_set.hpp"
+
+#include <mutex>
+#include <shared_mutex>
 
 namespace knight::dfa {
 
+/// \brief The CFG of a function, and its weak topological order, live
+/// variables and def-use chains computed once for all the analyses of the
+/// function.
+struct ProcCFGInfo {
+    ProcCFG::GraphUniqueRef cfg;
+    std::unique_ptr< ProcWto > wto;
+    std::unique_ptr< LiveVariables > live_vars;
+    /// \brief Only built for the sparse analysis.
+    std::unique_ptr< DefUseChains > def_use;
+}; // struct ProcCFGInfo
+
+/// \brief Creates the stack frames and location contexts of a
+/// translation unit, and the CFGs of their functions.
+///
+/// The frames of the inlined callees are created by the workers of the
+/// function scheduler, hence the CFGs are guarded by a mutex, and the
+/// frames and location contexts are interned into sharded sets.
 class LocationManager {
   private:
-    std::unordered_map< const clang::Decl*, ProcCFG::GraphUniqueRef >
-        m_decl_to_cfg;
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map< const clang::Decl*, ProcCFGInfo > m_decl_to_cfg;
+
+    ConcurrentFoldingSet< StackFrame > m_stack_frames;
+    ConcurrentFoldingSet< LocationContext > m_location_contexts;
 
-    llvm::BumpPtrAllocator m_allocator;
-    llvm::FoldingSet< StackFrame > m_stack_frames;
-    llvm::FoldingSet< LocationContext > m_location_contexts;
+    ProcCFG::BuildOptions m_cfg_build_opts;
 
   public:
     LocationManager() = default;
 
   public:
+    /// \brief Set the options of the CFGs built after the call.
+    void set_cfg_build_options(ProcCFG::BuildOptions opts) {
+        const std::unique_lock lock(m_mutex);
+        m_cfg_build_opts = opts;
+    }
+
     ProcCFG::GraphRef get_cfg(const clang::Decl* decl) const {
+        const std::shared_lock lock(m_mutex);
+        auto it = m_decl_to_cfg.find(decl);
+        if (it == m_decl_to_cfg.end()) {
+            return nullptr;
+        }
+        return it->second.cfg.get();
+    }
+
+    const ProcWto* get_wto(const clang::Decl* decl) const {
+        const std::shared_lock lock(m_mutex);
+        auto it = m_decl_to_cfg.find(decl);
+        if (it == m_decl_to_cfg.end()) {
+            return nullptr;
+        }
+        return it->second.wto.get();
+    }
+
+    const LiveVariables* get_live_variables(const clang::Decl* decl) const {
+        const std::shared_lock lock(m_mutex);
+        auto it = m_decl_to_cfg.find(decl);
+        if (it == m_decl_to_cfg.end()) {
+            return nullptr;
+        }
+        return it->second.live_vars.get();
+    }
+
+    const DefUseChains* get_def_use_chains(const clang::Decl* decl) const {
+        const std::shared_lock lock(m_mutex);
         auto it = m_decl_to_cfg.find(decl);
         if (it == m_decl_to_cfg.end()) {
             return nullptr;
         }
-        return it->second.get();
+        return it->second.def_use.get();
     }
 
     const StackFrame* create_top_frame(ProcCFG::DeclRef decl);
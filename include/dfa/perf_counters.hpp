@@ -0,0 +1,71 @@
+//===- perf_counters.hpp ----------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the hardware performance counters of the
+//  profiler.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace knight::dfa {
+
+enum class PerfCounter {
+    Cycles,
+    Instructions,
+    L1DMisses,
+    LLCMisses,
+    BranchMisses,
+}; // enum class PerfCounter
+
+constexpr unsigned NumPerfCounters = 5U;
+
+[[nodiscard]] llvm::StringRef get_perf_counter_name(PerfCounter counter);
+
+using PerfCounterValues = std::array< uint64_t, NumPerfCounters >;
+
+/// \brief The process-wide hardware performance counters, disabled by
+/// default.
+///
+/// Each thread opens its own group of counters at its first read, which
+/// only counts the user space of the thread, so that the spans of the
+/// profiler are measured by the deltas of their reads. The counters which
+/// cannot be opened, e.g., in a virtual machine, stay at zero.
+class PerfCounters {
+  private:
+    static inline std::atomic< bool > s_enabled{false};
+    /// \brief The counters opened on the enabling thread, by bit.
+    static inline std::atomic< unsigned > s_available{0U};
+
+  public:
+    /// \brief Enable the counters, if any can be opened.
+    ///
+    /// \return false if the counters are unsupported or not permitted.
+    static bool enable();
+
+    [[nodiscard]] static bool is_enabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] static bool is_available(PerfCounter counter) {
+        return (s_available.load(std::memory_order_relaxed) &
+                (1U << static_cast< unsigned >(counter))) != 0U;
+    }
+
+    /// \brief Read the counters of the current thread.
+    static void read(PerfCounterValues& values);
+}; // class PerfCounters
+
+} // namespace knight::dfa
@@ -50,13 +50,26 @@ class ProcCFG {
     llvm::BitVector m_reachable_block;
 
   public:
+    /// \brief The optional elements of the built CFG, only added when
+    /// they are consumed.
+    struct BuildOptions {
+        /// \brief Add the lifetime ends of the automatic variables, which
+        /// remove them from the states.
+        bool add_lifetime = true;
+        /// \brief Build the def-use chains of the local variables along
+        /// with the CFG, which are consumed by the sparse analysis.
+        bool add_def_use = false;
+    }; // struct BuildOptions
+
     /// \brief build a procedural CFG from a clang function declaration.
-    static GraphUniqueRef build(const clang::Decl* function);
+    static GraphUniqueRef build(const clang::Decl* function,
+                                BuildOptions opts = {});
 
     /// \brief build a procedural CFG from a clang declaration and its body.
     static GraphUniqueRef build(FunctionRef function,
                                 clang::Stmt* build_scope,
-                                clang::ASTContext& ctx);
+                                clang::ASTContext& ctx,
+                                BuildOptions opts = {});
 
   public:
     /// \brief get the entry node of the CFG.
@@ -77,6 +90,27 @@ class ProcCFG {
     static SuccNodeIterator succ_end(NodeRef node) { return node->succ_end(); }
     /// }@
 
+    /// \brief dense node indices, which are the block ids.
+    /// @{
+    static unsigned index(NodeRef node) { return node->getBlockID(); }
+    static unsigned num_nodes(GraphRef cfg) { return cfg->get_num_blocks(); }
+    /// @}
+
+    /// \brief get the underlying clang CFG.
+    [[nodiscard]] const clang::CFG& get_clang_cfg() const { return *m_cfg; }
+
+    /// \brief get the number of blocks of the CFG.
+    [[nodiscard]] unsigned get_num_blocks() const {
+        return m_cfg->getNumBlockIDs();
+    }
+
+    /// \brief get the block of the stmt, or null if the stmt is not an
+    /// element of the CFG.
+    [[nodiscard]] NodeRef get_block_of(StmtRef stmt) const {
+        auto it = m_stmt_to_block.find(stmt);
+        return it == m_stmt_to_block.end() ? nullptr : it->second;
+    }
+
     /// \brief dump the procedural CFG for debugging.
     void dump(llvm::raw_ostream& os, bool show_colors = false) const;
     void view() const;
@@ -0,0 +1,138 @@
+//===- profiler.hpp ---------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the opt-in profiler of the DFA engine phases.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/perf_counters.hpp"
+
+#include <clang/AST/DeclBase.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace knight::dfa {
+
+enum class ProfileCategory {
+    CfgBuild,
+    WtoBuild,
+    Function,
+    Analysis,
+    Checker,
+    StateOp,
+    LoopHead,
+    Pipeline,
+    Memory,
+    TracePartition,
+    Phase,
+}; // enum class ProfileCategory
+
+constexpr unsigned NumProfileCategories = 11U;
+
+[[nodiscard]] llvm::StringRef get_profile_category_name(
+    ProfileCategory category);
+
+/// \brief Accumulated time and hits of a profiled name.
+struct ProfileRecord {
+    uint64_t count = 0U;
+    uint64_t nanoseconds = 0U;
+    /// \brief Accumulated hardware counters, if enabled.
+    PerfCounterValues counters{};
+}; // struct ProfileRecord
+
+/// \brief The process-wide profiler, disabled by default.
+///
+/// Each thread records into its own tables, which are merged only when
+/// reporting, so that the profiled callbacks never contend on a lock.
+class Profiler {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+  private:
+    static inline std::atomic< bool > s_enabled{false};
+
+  public:
+    static void set_enabled(bool enabled) {
+        s_enabled.store(enabled, std::memory_order_relaxed);
+    }
+    [[nodiscard]] static bool is_enabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    /// \brief Record `count` hits of the name taking `elapsed` in total,
+    /// and the given hardware counters, if any.
+    static void record(ProfileCategory category,
+                       llvm::StringRef name,
+                       uint64_t count,
+                       Clock::duration elapsed,
+                       const PerfCounterValues* counters = nullptr);
+
+    /// \brief Print the records of each category, slowest first.
+    static void print_report(llvm::raw_ostream& os);
+
+    /// \brief Write all the records as JSON.
+    static void write_json(llvm::raw_ostream& os);
+}; // class Profiler
+
+/// \brief Record the time of a scope into the profiler, if enabled, and
+/// its hardware counters, if enabled as well.
+///
+/// The name shall outlive the scope.
+class ProfileScope {
+  private:
+    ProfileCategory m_category;
+    llvm::StringRef m_name;
+    std::optional< Profiler::Clock::time_point > m_start;
+    std::optional< PerfCounterValues > m_start_counters;
+
+  public:
+    ProfileScope(ProfileCategory category, llvm::StringRef name)
+        : m_category(category), m_name(name) {
+        if (Profiler::is_enabled()) {
+            if (PerfCounters::is_enabled()) {
+                PerfCounters::read(m_start_counters.emplace());
+            }
+            m_start = Profiler::Clock::now();
+        }
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+    ProfileScope(ProfileScope&&) = delete;
+    ProfileScope& operator=(ProfileScope&&) = delete;
+
+    ~ProfileScope() {
+        if (!m_start) {
+            return;
+        }
+        auto elapsed = Profiler::Clock::now() - *m_start;
+        if (!m_start_counters) {
+            Profiler::record(m_category, m_name, 1U, elapsed);
+            return;
+        }
+        PerfCounterValues counters;
+        PerfCounters::read(counters);
+        for (unsigned i = 0U; i < NumPerfCounters; ++i) {
+            counters[i] -= (*m_start_counters)[i];
+        }
+        Profiler::record(m_category, m_name, 1U, elapsed, &counters);
+    }
+}; // class ProfileScope
+
+/// \brief Get the name of a decl in the profile, qualified if named.
+[[nodiscard]] std::string get_decl_profile_name(const clang::Decl* decl);
+
+} // namespace knight::dfa
@@ -16,15 +16,26 @@
 #include "dfa/analysis_manager.hpp"
 #include "dfa/domain/dom_base.hpp"
 #include "dfa/domain/domains.hpp"
+#include "dfa/liveness.hpp"
 #include "dfa/proc_cfg.hpp"
 #include "dfa/region/region.hpp"
 #include "dfa/symbol.hpp"
+#include "dfa/var_index.hpp"
 
+#include <array>
+#include <functional>
 #include <optional>
+#include <type_traits>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/FoldingSet.h>
 #include <llvm/ADT/ImmutableMap.h>
 #include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/ADT/STLFunctionalExtras.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/Support/raw_ostream.h>
 
 namespace knight::dfa {
@@ -54,17 +65,90 @@ struct IntrusiveRefCntPtrInfo< const knight::dfa::ProgramState > {
 namespace knight::dfa {
 
 using ProgramStateRef = llvm::IntrusiveRefCntPtr< const ProgramState >;
-using DomValMap = llvm::DenseMap< DomID, SharedVal >;
-using RegionSExprMap = llvm::DenseMap< MemRegionRef, SExprRef >;
-using StmtSExprMap = llvm::DenseMap< ProcCFG::StmtRef, SExprRef >;
+
+/// \brief The maps of program state are persistent AVL trees sharing their
+/// structure, so that an update only copies the path to the updated entry.
+/// Trees are canonicalized by their factories, hence two maps with the
+/// same entries have the same root.
+///
+/// The factories recycle the tree nodes without destroying their values,
+/// so that the domain values are not owned by the maps but by the state
+/// manager of the function, see `ProgramStateManager::adopt_dom_val`.
+/// @{
+using DomValMap = llvm::ImmutableMap< DomID, AbsValConstRef >;
+using RegionSExprMap = llvm::ImmutableMap< MemRegionRef, SExprRef >;
+using StmtSExprMap = llvm::ImmutableMap< ProcCFG::StmtRef, SExprRef >;
+/// @}
 
 namespace internal {
 
-ProgramStateRef get_persistent_state_with_copy_and_dom_val_map(
-    ProgramStateManager& manager, const ProgramState& state, DomValMap dom_val);
+/// \brief Visit the entries which differ between two canonical maps, in
+/// key order, as `fn(key, lhs_val, rhs_val)` with null for the value
+/// missing in one map.
+///
+/// The subtrees shared by the maps are skipped as in
+/// `ImutAVLTree::isEqual`, so that the walk is proportional to the paths
+/// to the changed entries rather than to the size of the maps.
+template < typename Map, typename Fn >
+void diff_immutable_maps(const Map& lhs, const Map& rhs, Fn&& fn) {
+    using TreeTy = typename Map::TreeTy;
+    using Iterator = typename TreeTy::iterator;
+    const TreeTy* lhs_root = lhs.getRootWithoutRetain();
+    const TreeTy* rhs_root = rhs.getRootWithoutRetain();
+    if (lhs_root == rhs_root) {
+        return;
+    }
+
+    Iterator lhs_it = lhs_root != nullptr ? lhs_root->begin() : Iterator();
+    Iterator rhs_it = rhs_root != nullptr ? rhs_root->begin() : Iterator();
+    const Iterator end;
+    while (lhs_it != end && rhs_it != end) {
+        if (&*lhs_it == &*rhs_it) {
+            lhs_it.skipSubTree();
+            rhs_it.skipSubTree();
+            continue;
+        }
+        const auto& [lhs_key, lhs_val] = lhs_it->getValue();
+        const auto& [rhs_key, rhs_val] = rhs_it->getValue();
+        using Key = std::remove_cvref_t< decltype(lhs_key) >;
+        if (std::less< Key >()(lhs_key, rhs_key)) {
+            fn(lhs_key, &lhs_val, nullptr);
+            ++lhs_it;
+        } else if (std::less< Key >()(rhs_key, lhs_key)) {
+            fn(rhs_key, nullptr, &rhs_val);
+            ++rhs_it;
+        } else {
+            if (lhs_val != rhs_val) {
+                fn(lhs_key, &lhs_val, &rhs_val);
+            }
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    for (; lhs_it != end; ++lhs_it) {
+        const auto& [lhs_key, lhs_val] = lhs_it->getValue();
+        fn(lhs_key, &lhs_val, nullptr);
+    }
+    for (; rhs_it != end; ++rhs_it) {
+        const auto& [rhs_key, rhs_val] = rhs_it->getValue();
+        fn(rhs_key, nullptr, &rhs_val);
+    }
+}
 
 } // namespace internal
 
+/// \brief The keys of the entries added, removed or bound to another
+/// value from a state to another.
+struct ProgramStateDiff {
+    llvm::SmallVector< DomID, 4 > dom_ids;
+    llvm::SmallVector< MemRegionRef, 8 > regions;
+    llvm::SmallVector< ProcCFG::StmtRef, 8 > stmts;
+
+    [[nodiscard]] bool empty() const {
+        return dom_ids.empty() && regions.empty() && stmts.empty();
+    }
+}; // struct ProgramStateDiff
+
 // TODO(ProgramState): fix ProgramState to be immutable!!
 class ProgramState : public llvm::FoldingSetNode {
     friend class ProgramStateManager;
@@ -91,6 +175,13 @@ class ProgramState : public llvm::FoldingSetNode {
     /// \brief region manager.
     RegionManager* m_region_mgr;
 
+    /// \brief Whether a domain value is bottom, and whether all of them
+    /// are top, computed once the state is made persistent.
+    /// @{
+    bool m_is_bottom = false;
+    bool m_is_top = false;
+    /// @}
+
   public:
     ProgramState(ProgramStateManager* state_mgr,
                  RegionManager* region_mgr,
@@ -129,6 +220,53 @@ class ProgramState : public llvm::FoldingSetNode {
     std::optional< SExprRef > get_region_sexpr(MemRegionRef region) const;
     std::optional< SExprRef > get_stmt_sexpr(ProcCFG::StmtRef stmt) const;
 
+  public:
+    /// \brief Remove the bindings of the local variables of the frame which
+    /// are not live, and forget their numerical variables and the symbols
+    /// no longer reachable from the bindings.
+    [[nodiscard]] ProgramStateRef remove_dead(const LiveSet& live,
+                                              const StackFrame* frame) const;
+
+    /// \brief Remove the bindings of the local variable of the frame whose
+    /// lifetime ends.
+    [[nodiscard]] ProgramStateRef remove_dead_var(
+        ProcCFG::VarDeclRef var, const StackFrame* frame) const;
+
+    /// \brief Remove the bindings of all the local variables of the
+    /// frame, once the call of the frame returns.
+    [[nodiscard]] ProgramStateRef remove_frame(const StackFrame* frame) const;
+
+    /// \brief Fold the most recent object of a heap allocation site into
+    /// its summary, before the site allocates a new one.
+    ///
+    /// The bindings of the summary are kept where they agree with the
+    /// ones of the recent object, and the numerical variables of both are
+    /// forgotten, as are the bindings of the recent object.
+    [[nodiscard]] ProgramStateRef fold_heap_alloc(
+        const HeapAllocRegion* recent) const;
+
+    /// \brief Remove the sexprs of the stmts, which are only meaningful in
+    /// the function evaluating them.
+    [[nodiscard]] ProgramStateRef remove_stmt_sexprs() const;
+
+    /// \brief Replace the sexprs of the stmts by the ones of the other
+    /// state.
+    [[nodiscard]] ProgramStateRef copy_stmt_sexprs(
+        const ProgramState& other) const;
+
+  private:
+    /// \brief Compute the bottom and top flags from the domain values.
+    void compute_flags();
+
+    [[nodiscard]] ProgramStateRef remove_dead_if(
+        const StackFrame* frame,
+        llvm::function_ref< bool(ProcCFG::VarDeclRef) > is_dead) const;
+
+    /// \brief Remove the bindings and forget the numerical variables of
+    /// the regions matching the predicate, and the unreachable symbols.
+    [[nodiscard]] ProgramStateRef remove_regions_if(
+        llvm::function_ref< bool(MemRegionRef) > is_removed) const;
+
   public:
     /// \brief Check if the given domain kind exists in the program state.
     ///
@@ -141,12 +279,11 @@ class ProgramState : public llvm::FoldingSetNode {
     /// \brief Get the abstract cal with the given domain.
     template < typename Domain >
     [[nodiscard]] std::optional< const Domain* > get_ref() const {
-        auto it = m_dom_val.find(get_domain_id(Domain::get_kind()));
-        if (it == m_dom_val.end()) {
+        const auto* val = m_dom_val.lookup(get_domain_id(Domain::get_kind()));
+        if (val == nullptr) {
             return std::nullopt;
         }
-        return std::make_optional(
-            static_cast< const Domain* >(it->second.get()));
+        return std::make_optional(static_cast< const Domain* >(*val));
     }
 
     /// \brief Get the cloned abstract value with the given domain.
@@ -155,43 +292,43 @@ class ProgramState : public llvm::FoldingSetNode {
     /// and managed by the caller, or nullptr if the domain does not
     /// exist in the state.
     template < typename Domain >
-    [[nodiscard]] std::shared_ptr< Domain > get_clone() const {
-        auto it = m_dom_val.find(get_domain_id(Domain::get_kind()));
-        if (it == m_dom_val.end()) {
-            return std::static_pointer_cast< Domain >(Domain::default_val());
+    [[nodiscard]] llvm::IntrusiveRefCntPtr< Domain > get_clone() const {
+        const auto* val = m_dom_val.lookup(get_domain_id(Domain::get_kind()));
+        if (val == nullptr) {
+            return llvm::IntrusiveRefCntPtr< Domain >(
+                static_cast< Domain* >(Domain::default_val().get()));
         }
-        std::shared_ptr< AbsDomBase > base_ptr(it->second->clone());
-        return std::static_pointer_cast< Domain >(base_ptr);
+        return llvm::IntrusiveRefCntPtr< Domain >(
+            static_cast< Domain* >((*val)->clone()));
     }
 
     /// \brief Remove the given domain from the program state.
     template < typename Domain >
     [[nodiscard]] ProgramStateRef remove() const {
-        auto id = get_domain_id(Domain::get_kind());
-        auto dom_val = m_dom_val;
-        dom_val.erase(id);
-        return internal::
-            get_persistent_state_with_copy_and_dom_val_map(get_state_manager(),
-                                                           *this,
-                                                           std::move(dom_val));
+        return remove_dom_val(get_domain_id(Domain::get_kind()));
     }
 
     /// \brief Set the given domain to the given abstract val.
     template < typename Domain >
     [[nodiscard]] ProgramStateRef set(SharedVal val) const {
-        auto dom_val = m_dom_val;
-        dom_val[get_domain_id(Domain::get_kind())] = std::move(val);
-        return internal::
-            get_persistent_state_with_copy_and_dom_val_map(get_state_manager(),
-                                                           *this,
-                                                           std::move(dom_val));
+        return set_dom_val(get_domain_id(Domain::get_kind()), std::move(val));
     }
 
+    /// \brief Set or remove the abstract val of the given domain id.
+    /// @{
+    [[nodiscard]] ProgramStateRef set_dom_val(DomID id, SharedVal val) const;
+    [[nodiscard]] ProgramStateRef remove_dom_val(DomID id) const;
+    /// @}
+
   public:
+    /// \brief Normalize the domain values which report they are not.
+    ///
+    /// The values are shared, so the denormalized ones are normalized on
+    /// copies, and the state itself is returned if all are normalized.
     [[nodiscard]] ProgramStateRef normalize() const;
 
-    [[nodiscard]] bool is_bottom() const;
-    [[nodiscard]] bool is_top() const;
+    [[nodiscard]] bool is_bottom() const { return m_is_bottom; }
+    [[nodiscard]] bool is_top() const { return m_is_top; }
     [[nodiscard]] ProgramStateRef set_to_bottom() const;
     [[nodiscard]] ProgramStateRef set_to_top() const;
 
@@ -202,12 +339,30 @@ class ProgramState : public llvm::FoldingSetNode {
         const ProgramStateRef& other) const;
 
     [[nodiscard]] ProgramStateRef widen(const ProgramStateRef& other) const;
+    [[nodiscard]] ProgramStateRef widen_with_thresholds(
+        const ProgramStateRef& other, const Thresholds& thresholds) const;
     [[nodiscard]] ProgramStateRef meet(const ProgramStateRef& other) const;
     [[nodiscard]] ProgramStateRef narrow(const ProgramStateRef& other) const;
 
     [[nodiscard]] bool leq(const ProgramState& other) const;
     [[nodiscard]] bool equals(const ProgramState& other) const;
 
+    /// \brief Get the entries changed from this state to the other.
+    ///
+    /// The maps share their unchanged subtrees, so the diff takes time
+    /// proportional to the changes, not to the size of the states.
+    [[nodiscard]] ProgramStateDiff diff(const ProgramState& other) const;
+
+    /// \brief Visit the domain values changed from this state to the
+    /// other, as `fn(id, val, other_val)` with null for a missing value,
+    /// without allocating.
+    template < typename Fn >
+    void diff_dom_vals(const ProgramState& other, Fn&& fn) const {
+        internal::diff_immutable_maps(m_dom_val,
+                                      other.m_dom_val,
+                                      std::forward< Fn >(fn));
+    }
+
     [[nodiscard]] bool operator==(const ProgramState& other) const {
         return equals(other);
     }
@@ -221,20 +376,13 @@ class ProgramState : public llvm::FoldingSetNode {
     /// \brief Profile the contents of a ProgramState object for use in a
     ///  FoldingSet.  Two ProgramState objects are considered equal if they
     ///  have the same domain value ptrs.
+    ///
+    /// The maps are canonical, so profiling their roots is enough.
     static void Profile(llvm::FoldingSetNodeID& id, // NOLINT
                         const ProgramState* s) {
-        for (const auto& [dom_id, val] : s->m_dom_val) {
-            id.AddInteger(dom_id);
-            id.AddPointer(val.get());
-        }
-        for (const auto& [region, sexpr] : s->m_region_sexpr) {
-            id.AddPointer(region);
-            id.AddPointer(sexpr);
-        }
-        for (const auto& [stmt, sexpr] : s->m_stmt_sexpr) {
-            id.AddPointer(stmt);
-            id.AddPointer(sexpr);
-        }
+        s->m_dom_val.Profile(id);
+        s->m_region_sexpr.Profile(id);
+        s->m_stmt_sexpr.Profile(id);
     }
 
     /// \brief Used to profile the contents of this object for inclusion
@@ -245,6 +393,25 @@ class ProgramState : public llvm::FoldingSetNode {
     }
 }; // class ProgramState
 
+/// \brief Hash-consed abstract value, uniqued by its structural profile.
+///
+/// The value is owned by the state manager.
+class InternedDomVal : public llvm::FoldingSetNode {
+    friend class ProgramStateManager;
+
+  private:
+    AbsValConstRef m_val;
+
+  public:
+    explicit InternedDomVal(AbsValConstRef val) : m_val(val) {}
+
+    [[nodiscard]] AbsValConstRef get_val() const { return m_val; }
+
+    void Profile(llvm::FoldingSetNodeID& id) const { // NOLINT
+        [[maybe_unused]] bool profiled = m_val->profile(id);
+    }
+}; // class InternedDomVal
+
 class ProgramStateManager {
     friend class ProgramState;
 
@@ -270,25 +437,97 @@ class ProgramStateManager {
     /// \brief A vector of ProgramStates that we can reuse.
     std::vector< ProgramState* > m_free_states;
 
+    /// \brief Hash-consed abstract values of the domains supporting it.
+    llvm::FoldingSet< InternedDomVal > m_interned_vals;
+
+    /// \brief The abstract values held by the maps of the states, which are
+    /// freed with the manager, i.e., at the end of the function.
+    std::vector< SharedVal > m_owned_vals;
+
+    /// \brief The default and bottom values of each domain, created once.
+    /// @{
+    std::array< AbsValConstRef, NumDomIDs > m_default_vals{};
+    std::array< AbsValConstRef, NumDomIDs > m_bottom_vals{};
+    /// @}
+
+    /// \brief Factories of the canonical maps held by states.
+    /// @{
+    DomValMap::Factory m_dom_val_factory;
+    RegionSExprMap::Factory m_region_sexpr_factory;
+    StmtSExprMap::Factory m_stmt_sexpr_factory;
+    /// @}
+
+    /// \brief The dense numbering of the numerical variables.
+    VarIndex m_var_index;
+
   public:
     ProgramStateManager(AnalysisManager& analysis_mgr,
                         RegionManager& region_mgr,
                         llvm::BumpPtrAllocator& alloc)
         : m_analysis_mgr(analysis_mgr),
           m_region_mgr(region_mgr),
-          m_alloc(alloc) {}
+          m_alloc(alloc),
+          m_dom_val_factory(alloc),
+          m_region_sexpr_factory(alloc),
+          m_stmt_sexpr_factory(alloc) {}
+    ProgramStateManager(const ProgramStateManager&) = delete;
+    ProgramStateManager& operator=(const ProgramStateManager&) = delete;
+    ~ProgramStateManager() = default;
 
   public:
     [[nodiscard]] const DomIDs& dom_ids() const { return m_ids; }
 
     llvm::BumpPtrAllocator& get_allocator() { return m_alloc; }
 
+    [[nodiscard]] DomValMap::Factory& get_dom_val_factory() {
+        return m_dom_val_factory;
+    }
+    [[nodiscard]] RegionSExprMap::Factory& get_region_sexpr_factory() {
+        return m_region_sexpr_factory;
+    }
+    [[nodiscard]] StmtSExprMap::Factory& get_stmt_sexpr_factory() {
+        return m_stmt_sexpr_factory;
+    }
+
+    [[nodiscard]] VarIndex& get_var_index() { return m_var_index; }
+
+    /// \brief Get the bytes allocated by the allocator of the states.
+    [[nodiscard]] std::size_t get_allocated_bytes() const {
+        return m_alloc.getTotalMemory();
+    }
+
+    /// \brief Get the number of the uniqued states and of the freed ones
+    /// kept for reuse.
+    /// @{
+    [[nodiscard]] std::size_t get_num_live_states() const {
+        return m_state_set.size();
+    }
+    [[nodiscard]] std::size_t get_num_free_states() const {
+        return m_free_states.size();
+    }
+    /// @}
+
   public:
     ProgramStateRef get_default_state();
     ProgramStateRef get_bottom_state();
 
     ProgramStateRef get_persistent_state(ProgramState& State);
 
+    /// \brief Join all the states at once, domain by domain, so that only
+    /// the result is made persistent.
+    ///
+    /// The result is the one of joining the states one by one from the
+    /// first, whose bindings are kept.
+    [[nodiscard]] ProgramStateRef join_all(
+        llvm::ArrayRef< ProgramStateRef > states);
+
+    /// \brief Take the ownership of an abstract value to be stored in the
+    /// maps of the states, which shall not modify it afterward.
+    ///
+    /// \return the unique value structurally equal to the given one, or
+    /// the value itself if its domain is not hash-consed.
+    [[nodiscard]] AbsValConstRef adopt_dom_val(SharedVal val);
+
     ProgramStateRef get_persistent_state_with_ref_and_dom_val_map(
         ProgramState& state, DomValMap dom_val);
     ProgramStateRef get_persistent_state_with_copy_and_dom_val_map(
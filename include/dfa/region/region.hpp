@@ -17,18 +17,29 @@
 #include <clang/AST/Decl.h>
 #include <clang/AST/DeclCXX.h>
 #include <clang/AST/Expr.h>
+#include <clang/AST/ExprCXX.h>
 #include <clang/AST/Type.h>
 
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/FoldingSet.h>
 #include <llvm/ADT/PointerIntPair.h>
+#include <llvm/ADT/STLFunctionalExtras.h>
 #include <llvm/Support/raw_ostream.h>
 
 #include "dfa/region/regions.hpp"
 #include "dfa/stack_frame.hpp"
 
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
 namespace knight::dfa {
 
 class RegionManager;
+class SharedInterner;
 class MemRegion;
 class MemSpaceRegion;
 
@@ -77,6 +88,9 @@ class StackSpaceRegion : public MemSpaceRegion {
 
   public:
     ~StackSpaceRegion() override = default;
+
+    [[nodiscard]] const StackFrame* get_frame() const { return m_frame; }
+
     virtual void Profile(llvm::FoldingSetNodeID& id) const override { // NOLINT
         MemSpaceRegion::Profile(id);
         id.AddPointer(m_frame);
@@ -549,18 +563,26 @@ class StringLitRegion : public TypedRegion {
     }
 }; // class StringLitRegion
 
+/// \brief The element of an array at a constant index, or the smashed
+/// element standing for all the elements of the array, which is weakly
+/// updated as a summary.
 class ElementRegion : public TypedRegion {
     friend class RegionManager;
 
   private:
     clang::QualType m_element_type;
     // TODO(sym): add symbolic index value?
+    std::optional< uint64_t > m_index;
+
   private:
-    ElementRegion(const clang::QualType& element_type, MemRegionRef base_region)
+    ElementRegion(const clang::QualType& element_type,
+                  MemRegionRef base_region,
+                  std::optional< uint64_t > index)
         : TypedRegion(RegionKind::ElemRegion,
                       base_region->get_memory_space(),
                       base_region),
-          m_element_type(element_type) {
+          m_element_type(element_type),
+          m_index(index) {
         knight_assert_msg(!element_type.isNull(), "invalid element type");
     }
 
@@ -575,23 +597,40 @@ class ElementRegion : public TypedRegion {
         return m_element_type;
     }
 
+    /// \brief Get the index of the element, or none for a smashed one.
+    [[nodiscard]] std::optional< uint64_t > get_index() const {
+        return m_index;
+    }
+
+    [[nodiscard]] bool is_smashed() const { return !m_index.has_value(); }
+
     static void profile(llvm::FoldingSetNodeID& id,
                         const clang::QualType& element_type,
-                        MemRegionRef base_region) {
+                        MemRegionRef base_region,
+                        std::optional< uint64_t > index) {
         TypedRegion::profile(id,
                              RegionKind::ElemRegion,
                              base_region->get_memory_space(),
                              base_region);
         id.Add(element_type);
-        // TODO(idx): add idx profile
+        id.AddBoolean(index.has_value());
+        if (index) {
+            id.AddInteger(*index);
+        }
     }
 
     void Profile(llvm::FoldingSetNodeID& id) const override { // NOLINT
-        profile(id, m_element_type, m_parent);
+        profile(id, m_element_type, m_parent, m_index);
     }
 
     void dump(llvm::raw_ostream& os) const override {
-        os << "element of type " << m_element_type.getAsString() << " of ";
+        os << "element ";
+        if (m_index) {
+            os << *m_index << " ";
+        } else {
+            os << "* ";
+        }
+        os << "of type " << m_element_type.getAsString() << " of ";
         m_parent->dump(os);
     }
 
@@ -605,6 +644,108 @@ class ElementRegion : public TypedRegion {
 
 }; // class ElementRegion
 
+/// \brief The objects allocated on the heap by an allocation site, i.e.,
+/// a `new` expression or a call to an allocation function, in a calling
+/// context limited to the innermost call sites.
+///
+/// With the recency abstraction, a site has the region of its most
+/// recent allocation, which is strongly updated, and the summary of the
+/// former ones, which is weakly updated. Otherwise, the summary is the
+/// only region of the site, so that a loop allocating the objects only
+/// creates a bounded number of regions.
+class HeapAllocRegion : public TypedRegion {
+    friend class RegionManager;
+
+  private:
+    const clang::Expr* m_alloc_expr;
+    /// \brief The frame of the first allocation in the calling context.
+    const StackFrame* m_frame;
+    unsigned m_context_depth;
+    bool m_is_summary;
+
+  private:
+    HeapAllocRegion(const clang::Expr* alloc_expr,
+                    const StackFrame* frame,
+                    unsigned context_depth,
+                    bool is_summary,
+                    const HeapSpaceRegion* space)
+        : TypedRegion(RegionKind::HeapAllocRegion, space, nullptr),
+          m_alloc_expr(alloc_expr),
+          m_frame(frame),
+          m_context_depth(context_depth),
+          m_is_summary(is_summary) {
+        knight_assert_msg(alloc_expr != nullptr, "invalid allocation site");
+    }
+
+  public:
+    ~HeapAllocRegion() override = default;
+
+    [[gnu::returns_nonnull, nodiscard]] const clang::Expr* get_alloc_expr()
+        const {
+        return m_alloc_expr;
+    }
+
+    [[nodiscard]] const StackFrame* get_frame() const { return m_frame; }
+
+    [[nodiscard]] bool is_summary() const { return m_is_summary; }
+
+    /// \brief The allocated type of a `new` expression, and the bytes of
+    /// the allocation functions.
+    [[nodiscard]] clang::QualType get_value_type() const override {
+        if (const auto* new_expr =
+                llvm::dyn_cast< clang::CXXNewExpr >(m_alloc_expr)) {
+            return new_expr->getAllocatedType();
+        }
+        return get_ast_ctx().CharTy;
+    }
+
+    /// \brief Profile the allocation site with the call sites of the
+    /// `context_depth` innermost frames, so that the deeper contexts
+    /// share the regions.
+    static void profile(llvm::FoldingSetNodeID& id,
+                        const clang::Expr* alloc_expr,
+                        const StackFrame* frame,
+                        unsigned context_depth,
+                        bool is_summary,
+                        MemSpaceRegionRef space) {
+        TypedRegion::profile(id, RegionKind::HeapAllocRegion, space, nullptr);
+        id.AddPointer(alloc_expr);
+        id.AddBoolean(is_summary);
+        for (unsigned depth = 0U;
+             depth < context_depth && frame != nullptr &&
+             !frame->is_top_frame();
+             ++depth, frame = frame->get_parent()) {
+            id.AddPointer(frame->get_callsite_expr());
+        }
+    }
+
+    void Profile(llvm::FoldingSetNodeID& id) const override { // NOLINT
+        profile(id,
+                m_alloc_expr,
+                m_frame,
+                m_context_depth,
+                m_is_summary,
+                m_space);
+    }
+
+    void dump(llvm::raw_ostream& os) const override {
+        os << (m_is_summary ? "summary of heap objects" : "heap object")
+           << " allocated by ";
+        m_alloc_expr->printPretty(os,
+                                  nullptr,
+                                  get_ast_ctx().getPrintingPolicy());
+    }
+
+    [[nodiscard]] static bool classof(MemRegionRef R) {
+        return R->get_kind() == RegionKind::HeapAllocRegion;
+    }
+
+    [[nodiscard]] static bool classof(const TypedRegion* R) {
+        return R->get_kind() == RegionKind::HeapAllocRegion;
+    }
+
+}; // class HeapAllocRegion
+
 class DeclRegion : public TypedRegion {
   protected:
     DeclRegion(RegionKind kind, MemSpaceRegionRef space, MemRegionRef parent)
@@ -882,13 +1023,36 @@ class SymbolicRegion : public MemRegion {
 
 }; // class SymbolicRegion
 
+/// \brief The layout of a field of a record, in bits.
+struct FieldLayout {
+    const clang::FieldDecl* field_decl;
+    uint64_t offset;
+    uint64_t size;
+}; // struct FieldLayout
+
+/// \brief The layout of a record, with the fields in declaration order,
+/// i.e., indexed by the field indices.
+struct RecordLayout {
+    std::vector< FieldLayout > fields;
+    uint64_t size = 0U;
+}; // struct RecordLayout
+
 class RegionManager {
+  private:
+    using VarRegionCache =
+        llvm::DenseMap< const clang::VarDecl*, const MemRegion* >;
+    using FieldRegionsKey = std::pair< MemRegionRef, const clang::RecordDecl* >;
+
   private:
     clang::ASTContext& m_ast_ctx;
 
     llvm::BumpPtrAllocator& m_allocator;
     llvm::FoldingSet< MemRegion > m_region_set;
 
+    /// \brief The interner shared with the other workers, if any, in
+    /// place of the region set.
+    SharedInterner* m_interner;
+
     const CodeSpaceRegion* m_code_space_region{};
     const GlobalInternalSpaceRegion* m_global_internal_space_region{};
     const GlobalExternalSpaceRegion* m_global_external_space_region{};
@@ -901,9 +1065,47 @@ class RegionManager {
     std::unordered_map< const StackFrame*, const StackArgSpaceRegion* >
         m_stack_arg_space_regions;
 
+    /// \brief The regions of the variables of each frame, so that the
+    /// repeated lookups of a variable skip the profiling.
+    std::unordered_map< const StackFrame*, VarRegionCache >
+        m_frame_var_regions;
+
+    /// \brief The cache of the last looked up frame, the lookups of a
+    /// function being mostly from the same frame.
+    /// @{
+    const StackFrame* m_last_frame = nullptr;
+    VarRegionCache* m_last_var_regions = nullptr;
+    /// @}
+
+    /// \brief The number of the created regions of each kind.
+    std::array< std::size_t, NumRegionKinds > m_region_counts{};
+
+    /// \brief The heap abstraction, i.e., the number of the call sites
+    /// distinguishing the allocations of a site, and whether the most
+    /// recent allocation is kept apart from the summary.
+    /// @{
+    unsigned m_heap_context_depth = 1U;
+    bool m_heap_recency = true;
+    /// @}
+
+    /// \brief The layouts of the records, queried once per record.
+    std::unordered_map< const clang::RecordDecl*, RecordLayout >
+        m_record_layouts;
+
+    /// \brief The field regions of each super region, in the order of the
+    /// fields of its record, allocated once by the bump allocator.
+    llvm::DenseMap< FieldRegionsKey, llvm::ArrayRef< const FieldRegion* > >
+        m_field_regions;
+
+    /// \brief The number of elements above which the elements of an
+    /// array are collapsed into a single smashed element.
+    unsigned m_max_array_elements = 64U;
+
   public:
-    RegionManager(clang::ASTContext& ast_ctx, llvm::BumpPtrAllocator& allocator)
-        : m_ast_ctx(ast_ctx), m_allocator(allocator) {}
+    RegionManager(clang::ASTContext& ast_ctx,
+                  llvm::BumpPtrAllocator& allocator,
+                  SharedInterner* interner = nullptr)
+        : m_ast_ctx(ast_ctx), m_allocator(allocator), m_interner(interner) {}
 
   public:
     [[nodiscard]] clang::ASTContext& get_ast_ctx() const { return m_ast_ctx; }
@@ -911,6 +1113,29 @@ class RegionManager {
         return m_allocator;
     }
 
+    /// \brief Get the number of the created regions, indexed by kind.
+    [[nodiscard]] const std::array< std::size_t, NumRegionKinds >&
+    get_region_counts() const {
+        return m_region_counts;
+    }
+
+    void set_heap_abstraction(unsigned context_depth, bool recency) {
+        m_heap_context_depth = context_depth;
+        m_heap_recency = recency;
+    }
+
+    [[nodiscard]] bool is_heap_recency_enabled() const {
+        return m_heap_recency;
+    }
+
+    void set_max_array_elements(unsigned max_array_elements) {
+        m_max_array_elements = max_array_elements;
+    }
+
+    /// \brief Get the layout of the record, which is empty for the
+    /// records without a valid definition.
+    const RecordLayout& get_record_layout(const clang::RecordDecl* record);
+
     /// \brief Get a memory space region
     const StackLocalSpaceRegion* get_stack_local_space_region(
         const StackFrame* frame);
@@ -936,8 +1161,14 @@ class RegionManager {
         const clang::Expr* src_expr,
         const StackFrame* frame,
         MemRegionRef parent = nullptr);
-    const ElementRegion* get_element_region(clang::QualType element_type,
-                                            MemRegionRef base_region);
+
+    /// \brief Get the element of the base region at the index, which is
+    /// the smashed element if the index is unknown or the array has more
+    /// elements than the limit.
+    const ElementRegion* get_element_region(
+        clang::QualType element_type,
+        MemRegionRef base_region,
+        std::optional< uint64_t > index = std::nullopt);
     const VarRegion* get_var_region(const clang::VarDecl* var_decl,
                                     MemSpaceRegionRef space,
                                     MemRegionRef parent);
@@ -945,6 +1176,38 @@ class RegionManager {
                                         MemSpaceRegionRef space,
                                         MemRegionRef parent);
 
+    /// \brief Get the region of the field within the super region, from
+    /// the cached field regions of the super region.
+    const FieldRegion* get_field_region(const clang::FieldDecl* field_decl,
+                                        MemRegionRef super_region);
+
+    /// \brief Get the regions of all the fields of the record within the
+    /// super region, indexed by the field indices.
+    llvm::ArrayRef< const FieldRegion* > get_field_regions(
+        const clang::RecordDecl* record, MemRegionRef super_region);
+    const HeapAllocRegion* get_heap_alloc_region(const clang::Expr* alloc_expr,
+                                                 const StackFrame* frame,
+                                                 bool is_summary);
+
+    /// \brief Get the region of the object allocated by the expression,
+    /// which is the most recent one with the recency abstraction, and the
+    /// summary otherwise.
+    const HeapAllocRegion* get_allocated_region(const clang::Expr* alloc_expr,
+                                                const StackFrame* frame) {
+        return get_heap_alloc_region(alloc_expr, frame, !m_heap_recency);
+    }
+
+    /// \brief Get the summary of the allocation site of the region.
+    const HeapAllocRegion* get_summary_region(const HeapAllocRegion* region) {
+        return get_heap_alloc_region(region->get_alloc_expr(),
+                                     region->get_frame(),
+                                     /*is_summary=*/true);
+    }
+
+    /// \brief Check if the region is within a summary of heap objects or
+    /// a smashed element, whose updates are weak.
+    [[nodiscard]] static bool is_summarized(MemRegionRef region);
+
     const ArgumentRegion* get_top_level_stack_argument_region(
         const StackFrame* frame, const clang::ParmVarDecl* param_decl) {
         return get_argument_region(frame,
@@ -968,13 +1231,28 @@ class RegionManager {
                                 const StackFrame* frame);
 
   private:
+    const MemRegion* create_region(const clang::VarDecl* var_decl,
+                                   const StackFrame* frame);
+
+    /// \brief Get the space cached in `region`, creating it if absent, or
+    /// getting it by `get` from the shared interner.
     template < typename Space, typename... Args >
-    const Space* get_persistent_space(Space*& region, Args&&... args) {
-        if (region == nullptr) {
-            region = new (m_allocator) // NOLINT
-                Space(*this, std::forward< Args >(args)...);
+    const Space* get_persistent_space(
+        const Space*& region,
+        const Space* (RegionManager::*get)(Args...),
+        Args... args) {
+        if (region != nullptr) {
+            return region;
+        }
+        if (m_interner != nullptr) {
+            region = llvm::cast< Space >(
+                get_shared_space([&](RegionManager& manager) {
+                    return static_cast< MemSpaceRegionRef >(
+                        (manager.*get)(args...));
+                }));
+        } else {
+            region = new (m_allocator) Space(*this, args...); // NOLINT
         }
-
         return region;
     }
 
@@ -983,17 +1261,34 @@ class RegionManager {
         llvm::FoldingSetNodeID id;
         Region::profile(id, std::forward< Args >(args)...);
 
+        auto create = [&](llvm::BumpPtrAllocator& allocator) {
+            auto* region = new (allocator) // NOLINT
+                Region(std::forward< Args >(args)...);
+            ++m_region_counts[static_cast< unsigned >(region->get_kind())];
+            return region;
+        };
+        if (m_interner != nullptr) {
+            return cast< Region >(get_shared_region(id, create));
+        }
+
         void* insert_pos; // NOLINT
         auto* region = cast_or_null< Region >(
             m_region_set.FindNodeOrInsertPos(id, insert_pos));
         if (region == nullptr) {
-            region = new (m_allocator) // NOLINT
-                Region(std::forward< Args >(args)...);
+            region = create(m_allocator);
             m_region_set.InsertNode(region, insert_pos);
         }
         return region;
     }
 
+    /// \brief Get the space or the region from the shared interner.
+    /// @{
+    MemSpaceRegionRef get_shared_space(
+        llvm::function_ref< MemSpaceRegionRef(RegionManager&) > get);
+    MemRegion* get_shared_region(
+        const llvm::FoldingSetNodeID& id,
+        llvm::function_ref< MemRegion*(llvm::BumpPtrAllocator&) > create);
+    /// @}
 }; // class RegionManager
 
 } // namespace knight::dfa
@@ -17,6 +17,8 @@
 
 #include <llvm/ADT/StringRef.h>
 
+#include <cstddef>
+
 #ifdef REGION_DEF
 #    undef REGION_DEF
 #endif
@@ -29,6 +31,13 @@ enum class RegionKind : unsigned {
 #include "regions.def"
 }; // enum class RegionKind
 
+/// \brief The number of the region kinds, including `None`.
+constexpr std::size_t NumRegionKinds = 1U
+#undef REGION_DEF
+#define REGION_DEF(KIND, DESC, PARENT) +1U // NOLINT
+#include "regions.def"
+    ;
+
 inline llvm::StringRef get_region_kind_name(RegionKind kind) {
     switch (kind) {
 #undef REGION_DEF
@@ -0,0 +1,86 @@
+//===- shared_interner.hpp --------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the interner of the regions and the symbols shared
+//  by the workers of a translation unit.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/region/region.hpp"
+#include "dfa/symbol.hpp"
+#include "util/concurrent_folding_set.hpp"
+
+#include <clang/AST/ASTContext.h>
+#include <llvm/ADT/STLFunctionalExtras.h>
+#include <llvm/Support/Allocator.h>
+
+#include <atomic>
+#include <mutex>
+
+namespace knight::dfa {
+
+/// \brief The regions, memory spaces and symbols of a translation unit,
+/// interned once for all the workers of the function scheduler.
+///
+/// The region and symbol managers of the workers intern into it, so that
+/// the same region or symbol is the same node in every worker, and the
+/// pointer equality of `MemRegionRef`s and `SExprRef`s holds across the
+/// threads, e.g. in the summaries of the callees analyzed by another
+/// worker. The nodes live as long as the interner.
+class SharedInterner {
+  private:
+    ConcurrentFoldingSet< MemRegion > m_region_set;
+    ConcurrentFoldingSet< SymExpr > m_sym_expr_set;
+
+    /// \brief The ID of the next symbol leaf of all the workers.
+    ///
+    /// The IDs are taken in the order the workers create the leaves, hence
+    /// they depend on the thread interleaving and only name the symbols in
+    /// the dumps. The leaves are uniqued by their profile, not by their
+    /// ID, so that the results do not depend on it.
+    std::atomic< SymID > m_next_sym_id{0U};
+
+    /// \brief The memory spaces are few and created once by the manager
+    /// of the interner, under the lock.
+    /// @{
+    std::mutex m_space_mutex;
+    llvm::BumpPtrAllocator m_space_allocator;
+    RegionManager m_space_manager;
+    /// @}
+
+  public:
+    explicit SharedInterner(clang::ASTContext& ast_ctx)
+        : m_space_manager(ast_ctx, m_space_allocator) {}
+    SharedInterner(const SharedInterner&) = delete;
+    SharedInterner& operator=(const SharedInterner&) = delete;
+
+  public:
+    [[nodiscard]] ConcurrentFoldingSet< MemRegion >& get_region_set() {
+        return m_region_set;
+    }
+
+    [[nodiscard]] ConcurrentFoldingSet< SymExpr >& get_sym_expr_set() {
+        return m_sym_expr_set;
+    }
+
+    [[nodiscard]] SymID get_next_sym_id() {
+        return m_next_sym_id.fetch_add(1U, std::memory_order_relaxed);
+    }
+
+    /// \brief Get a memory space from the manager of the interner.
+    MemSpaceRegionRef get_space(
+        llvm::function_ref< MemSpaceRegionRef(RegionManager&) > get) {
+        const std::lock_guard< std::mutex > lock(m_space_mutex);
+        return get(m_space_manager);
+    }
+}; // class SharedInterner
+
+} // namespace knight::dfa
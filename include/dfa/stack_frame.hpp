@@ -21,11 +21,16 @@
 
 #include "dfa/proc_cfg.hpp"
 #include "util/assert.hpp"
+#include "util/wto.hpp"
 
 namespace knight::dfa {
 
+class DefUseChains;
+class LiveVariables;
 class LocationManager;
 
+using ProcWto = Wto< ProcCFG, GraphTrait< ProcCFG > >;
+
 std::optional< ProcCFG::DeclRef > get_called_decl(const ProcCFG::StmtRef& call);
 
 constexpr unsigned CallSiteInfoAlignment = 32;
@@ -55,6 +60,9 @@ class StackFrame : public llvm::FoldingSetNode {
 
   public:
     [[nodiscard]] ProcCFG::GraphRef get_cfg() const;
+    [[nodiscard]] const ProcWto* get_wto() const;
+    [[nodiscard]] const LiveVariables* get_live_variables() const;
+    [[nodiscard]] const DefUseChains* get_def_use_chains() const;
 
     [[nodiscard]] clang::ASTContext& get_ast_context() const {
         return m_decl->getASTContext();
@@ -0,0 +1,80 @@
+//===- summary.hpp ----------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the function summaries of the interprocedural
+//  analysis.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/proc_cfg.hpp"
+
+#include <llvm/ADT/DenseMap.h>
+
+#include <optional>
+#include <shared_mutex>
+#include <vector>
+
+namespace knight::dfa {
+
+/// \brief The effect of a function on its callers, computed from the exit
+/// state of the function.
+///
+/// The summary only holds the facts which do not depend on the arena of
+/// the function, so that it can be applied at the call sites analyzed by
+/// other workers.
+struct FunctionSummary {
+    /// \brief Whether the exit of the function may be reached.
+    bool may_return = true;
+
+    /// \brief Whether the function was not analyzed to its fixpoint, e.g.
+    /// because its deadline expired.
+    bool is_degraded = false;
+
+    [[nodiscard]] bool operator==(const FunctionSummary& other) const {
+        return may_return == other.may_return &&
+               is_degraded == other.is_degraded;
+    }
+}; // struct FunctionSummary
+
+/// \brief The summaries of the analyzed functions of a translation unit.
+///
+/// The functions are keyed by their canonical decl. The table is shared
+/// by the workers of the function scheduler: a summary is written once
+/// its function is analyzed, and read by the callers analyzed after it.
+class SummaryTable {
+  public:
+    using DeclRef = ProcCFG::DeclRef;
+
+  private:
+    mutable std::shared_mutex m_mutex;
+    llvm::DenseMap< DeclRef, FunctionSummary > m_summaries;
+
+  public:
+    SummaryTable() = default;
+    SummaryTable(const SummaryTable&) = delete;
+    SummaryTable& operator=(const SummaryTable&) = delete;
+
+  public:
+    /// \brief Get the summary of the function, if it is analyzed.
+    [[nodiscard]] std::optional< FunctionSummary > find(DeclRef decl) const;
+
+    /// \brief Set the summary of the analyzed function.
+    void set(DeclRef decl, FunctionSummary summary);
+
+    [[nodiscard]] std::size_t size() const;
+}; // class SummaryTable
+
+/// \brief Get the direct callees of the function, by the order of their
+/// calls in its body.
+[[nodiscard]] std::vector< const clang::FunctionDecl* > get_direct_callees(
+    ProcCFG::DeclRef function);
+
+} // namespace knight::dfa
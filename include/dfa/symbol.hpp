@@ -13,6 +13,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <type_traits>
 #include <utility>
 
@@ -26,6 +28,9 @@
 #include <clang/AST/OperationKinds.h>
 #include <clang/AST/Type.h>
 #include <clang/Basic/SourceLocation.h>
+#include <llvm/ADT/FoldingSet.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/Support/raw_ostream.h>
 
@@ -68,13 +73,24 @@ class TypedRegion;
 
 using SExprRef = const SymExpr*;
 
+/// \brief The preorder iterator over the sub-expressions of a symbol
+/// expression.
+///
+/// The worklist is inline so that the usual traversals do not allocate.
+/// The shared nodes of an expression DAG are visited once per path, or
+/// only once when `visit_once` is set.
 class SymIterator {
+  public:
+    static constexpr unsigned InlineWorklistSize = 8U;
+
   private:
-    std::vector< const SymExpr* > m_sym_exprs;
+    llvm::SmallVector< SExprRef, InlineWorklistSize > m_sym_exprs;
+    llvm::SmallPtrSet< SExprRef, InlineWorklistSize > m_visited;
+    bool m_visit_once = false;
 
   public:
     SymIterator() = default;
-    explicit SymIterator(const SymExpr* sym_expr);
+    explicit SymIterator(const SymExpr* sym_expr, bool visit_once = false);
 
     SymIterator& operator++();
     SExprRef operator*();
@@ -83,14 +99,33 @@ class SymIterator {
     bool operator!=(const SymIterator& other) const;
 
   private:
+    void push(SExprRef sym_expr);
     void expand();
 }; // class SymIterator
 
 /// Numerical symbol(Integer for now).
-class SymExpr {
+///
+/// The symbol expressions are uniqued by their profile in the
+/// `SymbolManager`, so that the structurally equal expressions are the
+/// same node and compare by pointer.
+class SymExpr : public llvm::FoldingSetNode {
+  public:
+    /// \brief The summary of a set of regions, where each region sets the
+    /// bit of its hash.
+    using RegionMask = uint64_t;
+
   protected:
     SymExprKind m_kind;
-    mutable unsigned m_complexity{0U};
+
+    /// \brief The worst complexity of the expression, computed once by the
+    /// constructor, since the interned expressions are shared by threads.
+    unsigned m_complexity{0U};
+
+    /// \brief The depth of the expression tree, a leaf being of depth 1.
+    unsigned m_depth{1U};
+
+    /// \brief The summary of the regions of the leaves.
+    RegionMask m_region_mask{0U};
 
   protected:
     explicit SymExpr(SymExprKind kind) : m_kind(kind) {}
@@ -102,10 +137,27 @@ class SymExpr {
 
     [[nodiscard]] virtual clang::QualType get_type() const = 0;
 
-    [[nodiscard]] virtual unsigned get_worst_complexity() const = 0;
+    [[nodiscard]] unsigned get_worst_complexity() const {
+        return m_complexity;
+    }
+
+    [[nodiscard]] unsigned get_depth() const { return m_depth; }
 
-    [[nodiscard]] llvm::iterator_range< SymIterator > get_symbols() const {
-        return llvm::make_range(SymIterator(this), SymIterator());
+    [[nodiscard]] RegionMask get_region_mask() const {
+        return m_region_mask;
+    }
+
+    [[nodiscard]] static RegionMask get_region_bit(const MemRegion* region);
+
+    /// \brief Whether a leaf may be over the region, with false positives
+    /// only.
+    [[nodiscard]] bool may_depend_on_region(const MemRegion* region) const {
+        return (m_region_mask & get_region_bit(region)) != 0U;
+    }
+
+    [[nodiscard]] llvm::iterator_range< SymIterator > get_symbols(
+        bool visit_once = false) const {
+        return llvm::make_range(SymIterator(this, visit_once), SymIterator());
     }
 
     virtual const MemRegion* get_src_region() const { return nullptr; }
@@ -127,7 +179,6 @@ class Scalar : public SymExpr {
     [[nodiscard]] bool is_leaf() const override { return true; }
     [[nodiscard]] virtual bool is_integer() const { return false; }
     [[nodiscard]] virtual bool is_float() const { return false; }
-    [[nodiscard]] unsigned get_worst_complexity() const override { return 0U; }
     [[nodiscard]] static bool classof(const SymExpr* sym_expr) {
         return sym_expr->get_kind() >= SymExprKind::SCALAR_BEGIN &&
                sym_expr->get_kind() <= SymExprKind::SCALAR_END;
@@ -154,9 +205,16 @@ class ScalarInt : public Scalar {
 
     [[nodiscard]] clang::QualType get_type() const override { return m_type; }
 
+    static void profile(llvm::FoldingSetNodeID& id,
+                        const llvm::APSInt& value,
+                        clang::QualType type) {
+        id.AddInteger(static_cast< unsigned >(SymExprKind::Int));
+        id.Add(value);
+        id.Add(type);
+    }
+
     void Profile(llvm::FoldingSetNodeID& id) const override { // NOLINT
-        id.Add(m_value);
-        id.Add(m_type);
+        ScalarInt::profile(id, m_value, m_type);
     }
 }; // class Integer
 
@@ -180,9 +238,16 @@ class ScalarFloat : public Scalar {
 
     [[nodiscard]] clang::QualType get_type() const override { return m_type; }
 
+    static void profile(llvm::FoldingSetNodeID& id,
+                        const llvm::APFloat& value,
+                        clang::QualType type) {
+        id.AddInteger(static_cast< unsigned >(SymExprKind::Float));
+        id.Add(value);
+        id.Add(type);
+    }
+
     void Profile(llvm::FoldingSetNodeID& id) const override { // NOLINT
-        id.Add(m_value);
-        id.Add(m_type);
+        ScalarFloat::profile(id, m_value, m_type);
     }
 }; // class Float
 
@@ -193,7 +258,9 @@ class Sym : public SymExpr {
     SymID m_id;
 
   protected:
-    Sym(SymID id, SymExprKind kind) : SymExpr(kind), m_id(id) {}
+    Sym(SymID id, SymExprKind kind) : SymExpr(kind), m_id(id) {
+        m_complexity = 1U;
+    }
 
   public:
     ~Sym() override = default;
@@ -201,8 +268,6 @@ class Sym : public SymExpr {
 
     [[nodiscard]] virtual llvm::StringRef get_kind_name() const = 0;
 
-    [[nodiscard]] unsigned get_worst_complexity() const override { return 1U; }
-
     [[nodiscard]] bool is_leaf() const override { return true; }
 
     [[nodiscard]] static bool classof(const SymExpr* sym_expr) {
@@ -327,17 +392,16 @@ class SymbolConjured : public Sym {
 
     ~SymbolConjured() override = default;
 
-    [[gnu::returns_nonnull]] const clang::Stmt* get_stmt() const {
-        return m_stmt;
-    }
+    /// \brief Get the statement, which is null for the symbol collapsing a
+    /// too deep expression.
+    [[nodiscard]] const clang::Stmt* get_stmt() const { return m_stmt; }
 
     [[nodiscard]] clang::QualType get_type() const override { return m_type; }
 
     [[nodiscard]] unsigned get_visit_cnt() const { return m_visit_cnt; }
 
-    [[gnu::returns_nonnull]] const StackFrame* get_frame() const {
-        return m_frame;
-    }
+    /// \brief Get the stack frame, which is null without a statement.
+    [[nodiscard]] const StackFrame* get_frame() const { return m_frame; }
 
     [[nodiscard]] const void* get_tag() const { return m_tag; }
 
@@ -397,14 +461,15 @@ class CastSymExpr : public SymExpr {
           m_operand(operand),
           m_src(src),
           m_dst(dst) {
+        m_complexity = operand->get_worst_complexity();
+        m_depth = operand->get_depth() + 1U;
+        m_region_mask = operand->get_region_mask();
         knight_assert_msg(is_valid_type_for_sym_expr(src),
                           "Invalid source type");
         knight_assert_msg(is_valid_type_for_sym_expr(dst),
                           "Invalid destination type");
     }
 
-    [[nodiscard]] unsigned get_worst_complexity() const override;
-
     [[nodiscard]] bool is_leaf() const override { return true; }
 
     [[nodiscard]] const SymExpr* get_operand() const { return m_operand; }
@@ -451,6 +516,9 @@ class UnarySymExpr : public SymExpr {
           m_operand(operand),
           m_opcode(opcode),
           m_type(type) {
+        m_complexity = operand->get_worst_complexity();
+        m_depth = operand->get_depth() + 1U;
+        m_region_mask = operand->get_region_mask();
         knight_assert_msg(opcode == clang::UO_Minus || opcode == clang::UO_Not,
                           "Invalid unary operator");
         knight_assert_msg(is_valid_type_for_sym_expr(type), "Invalid type");
@@ -466,8 +534,6 @@ class UnarySymExpr : public SymExpr {
 
     [[nodiscard]] clang::QualType get_type() const override { return m_type; }
 
-    [[nodiscard]] unsigned get_worst_complexity() const override;
-
     [[nodiscard]] bool is_leaf() const override { return true; }
 
     void dump(llvm::raw_ostream& os) const override;
@@ -509,6 +575,11 @@ class BinarySymExpr : public SymExpr {
           m_rhs(rhs),
           m_opcode(opcode),
           m_type(type) {
+        m_complexity = get_complexity(lhs->get_worst_complexity(),
+                                      rhs->get_worst_complexity(),
+                                      opcode);
+        m_depth = std::max(lhs->get_depth(), rhs->get_depth()) + 1U;
+        m_region_mask = lhs->get_region_mask() | rhs->get_region_mask();
         knight_assert_msg(is_valid_type_for_sym_expr(type), "Invalid type");
     }
 
@@ -525,16 +596,12 @@ class BinarySymExpr : public SymExpr {
 
     [[nodiscard]] clang::QualType get_type() const override { return m_type; }
 
-    [[nodiscard]] unsigned get_worst_complexity() const override {
-        if (m_complexity > 0U) {
-            return m_complexity;
-        }
-        unsigned lhs_complexity = 0U;
-        unsigned rhs_complexity = 0U;
-        lhs_complexity = m_lhs->get_worst_complexity();
-        rhs_complexity = m_rhs->get_worst_complexity();
-
-        switch (m_opcode) {
+  private:
+    [[nodiscard]] static unsigned get_complexity(
+        unsigned lhs_complexity,
+        unsigned rhs_complexity,
+        clang::BinaryOperator::Opcode opcode) {
+        switch (opcode) {
             using enum clang::BinaryOperatorKind;
             case BO_Add:
             case BO_Sub:
@@ -547,6 +614,7 @@ class BinarySymExpr : public SymExpr {
         return lhs_complexity * rhs_complexity;
     }
 
+  public:
     [[nodiscard]] bool is_leaf() const override { return true; }
 
     static void profile(llvm::FoldingSetNodeID& id,
@@ -0,0 +1,137 @@
+//===- symbol_manager.hpp ---------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the symbol manager.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/symbol.hpp"
+
+#include <llvm/ADT/FoldingSet.h>
+#include <llvm/ADT/STLFunctionalExtras.h>
+#include <llvm/Support/Allocator.h>
+
+namespace knight::dfa {
+
+class SharedInterner;
+
+/// \brief The factory of the symbol expressions.
+///
+/// The expressions are allocated in the allocator of the translation unit
+/// and uniqued by their profile, so that getting an expression twice gives
+/// the same node, and the equality of `SExprRef`s is pointer equality.
+///
+/// The composite expressions deeper than the maximal depth are collapsed
+/// into a conjured symbol, so that the expressions stay bounded on the
+/// generated code.
+///
+/// With a shared interner, the expressions and the IDs of the symbol
+/// leaves are shared with the symbol managers of the other workers.
+class SymbolManager {
+  public:
+    static constexpr unsigned DefaultMaxSymExprDepth = 16U;
+
+  private:
+    llvm::BumpPtrAllocator& m_allocator;
+    llvm::FoldingSet< SymExpr > m_sym_expr_set;
+
+    /// \brief The ID of the next symbol leaf.
+    SymID m_next_sym_id{0U};
+
+    /// \brief The interner shared with the other workers, if any, in
+    /// place of the expression set and the next ID.
+    SharedInterner* m_interner;
+
+    unsigned m_max_sym_expr_depth;
+
+  public:
+    explicit SymbolManager(
+        llvm::BumpPtrAllocator& allocator,
+        SharedInterner* interner = nullptr,
+        unsigned max_sym_expr_depth = DefaultMaxSymExprDepth)
+        : m_allocator(allocator),
+          m_interner(interner),
+          m_max_sym_expr_depth(max_sym_expr_depth) {}
+
+  public:
+    [[nodiscard]] llvm::BumpPtrAllocator& get_allocator() const {
+        return m_allocator;
+    }
+
+    /// \brief Get a scalar
+    const ScalarInt* get_scalar_int(const llvm::APSInt& value,
+                                    clang::QualType type);
+    const ScalarFloat* get_scalar_float(const llvm::APFloat& value,
+                                        clang::QualType type);
+
+    /// \brief Get a symbol leaf
+    const RegionSymVal* get_region_sym_val(const TypedRegion* region,
+                                           const LocationContext* loc_ctx,
+                                           bool is_external);
+    const RegionSymExtent* get_region_sym_extent(const MemRegion* region);
+    const SymbolConjured* get_symbol_conjured(const clang::Stmt* stmt,
+                                              clang::QualType type,
+                                              unsigned visit_cnt,
+                                              const StackFrame* frame,
+                                              const void* tag = nullptr);
+
+    /// \brief Get a composite symbol expression, or the conjured symbol
+    /// collapsing it when it is too deep.
+    SExprRef get_cast_sym_expr(SExprRef operand,
+                               clang::QualType src,
+                               clang::QualType dst);
+    SExprRef get_unary_sym_expr(SExprRef operand,
+                                clang::UnaryOperator::Opcode opcode,
+                                clang::QualType type);
+    SExprRef get_binary_sym_expr(SExprRef lhs,
+                                 SExprRef rhs,
+                                 clang::BinaryOperator::Opcode opcode,
+                                 clang::QualType type);
+
+  private:
+    /// \brief Collapse the expression into a conjured symbol when it is
+    /// deeper than the maximal depth.
+    ///
+    /// The symbol is tagged with the expression, so that collapsing the
+    /// same expression again gives the same symbol and the fixpoint
+    /// iterations stay stable.
+    SExprRef bound_depth(SExprRef sym_expr);
+
+    /// \brief Get the ID of a new symbol leaf.
+    [[nodiscard]] SymID get_next_sym_id();
+
+    /// \brief Get the expression of the profile, creating it by `create`
+    /// from the given allocator if absent.
+    template < typename SymExprTy, typename Create >
+    const SymExprTy* get_persistent_sym_expr(const llvm::FoldingSetNodeID& id,
+                                             Create create) {
+        if (m_interner != nullptr) {
+            return llvm::cast< SymExprTy >(get_shared_sym_expr(id, create));
+        }
+
+        void* insert_pos; // NOLINT
+        auto* sym_expr = llvm::cast_or_null< SymExprTy >(
+            m_sym_expr_set.FindNodeOrInsertPos(id, insert_pos));
+        if (sym_expr == nullptr) {
+            sym_expr = create(m_allocator);
+            m_sym_expr_set.InsertNode(sym_expr, insert_pos);
+        }
+        return sym_expr;
+    }
+
+    /// \brief Get the expression from the shared interner.
+    SymExpr* get_shared_sym_expr(
+        const llvm::FoldingSetNodeID& id,
+        llvm::function_ref< SymExpr*(llvm::BumpPtrAllocator&) > create);
+
+}; // class SymbolManager
+
+} // namespace knight::dfa
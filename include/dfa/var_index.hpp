@@ -0,0 +1,81 @@
+//===- var_index.hpp --------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the dense numbering of the numerical variables.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/region/region.hpp"
+#include "dfa/symbol.hpp"
+#include "util/assert.hpp"
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/PointerUnion.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace knight::dfa {
+
+/// \brief The dense ID of a numerical variable, from 0 to the number of
+/// variables of the function.
+using DenseVarID = uint32_t;
+
+/// \brief A region or a symbol used as a numerical variable.
+using NumVarRef = llvm::PointerUnion< MemRegionRef, const Sym* >;
+
+/// \brief The `Var` of the numerical domains and linear expressions over
+/// the dense IDs.
+struct DenseVar {
+    using Ref = DenseVarID;
+}; // struct DenseVar
+
+/// \brief Numbers the numerical variables of a function densely.
+///
+/// Regions and symbols are unique per function, so that the IDs can
+/// index arrays and bitsets in place of the hash tables keyed by
+/// pointers. IDs are given in the order of first use and never reused.
+class VarIndex {
+  private:
+    llvm::DenseMap< NumVarRef, DenseVarID > m_ids;
+    std::vector< NumVarRef > m_vars;
+
+  public:
+    VarIndex() = default;
+    VarIndex(const VarIndex&) = delete;
+    VarIndex& operator=(const VarIndex&) = delete;
+
+  public:
+    /// \brief Get the ID of the variable, numbering it if it is new.
+    [[nodiscard]] DenseVarID get_id(NumVarRef var);
+
+    /// \brief Get the ID of the variable if it is numbered.
+    [[nodiscard]] std::optional< DenseVarID > find_id(NumVarRef var) const;
+
+    /// \brief Get the variable of the ID.
+    [[nodiscard]] NumVarRef get_var(DenseVarID id) const {
+        knight_assert_msg(id < m_vars.size(), "unknown variable id");
+        return m_vars[id];
+    }
+
+    /// \brief Get the number of variables, which bounds the IDs.
+    [[nodiscard]] DenseVarID size() const {
+        return static_cast< DenseVarID >(m_vars.size());
+    }
+
+    void clear();
+
+    void dump(llvm::raw_ostream& os, DenseVarID id) const;
+}; // class VarIndex
+
+} // namespace knight::dfa
@@ -15,6 +15,11 @@
 
 #include <concepts>
 
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/FoldingSet.h>
+
+#include "dfa/domain/thresholds.hpp"
+
 namespace knight::dfa {
 
 template < typename DerivedDom >
@@ -52,6 +57,17 @@ struct does_derived_dom_can_join_consecutive_iter_with // NOLINT
           derived_dom_has_join_consecutive_iter_with_method< DerivedDom > > {
 }; // struct does_derived_dom_can_join_consecutive_iter_with
 
+template < typename DerivedDom >
+concept derived_dom_has_join_all_method =
+    requires(DerivedDom& d, llvm::ArrayRef< const DerivedDom* > others) {
+        { d.join_all(others) } -> std::same_as< void >;
+    };
+
+template < typename DerivedDom >
+struct does_derived_dom_can_join_all // NOLINT
+    : std::bool_constant< derived_dom_has_join_all_method< DerivedDom > > {
+}; // struct does_derived_dom_can_join_all
+
 template < typename DerivedDom >
 concept derived_dom_has_widen_with_method =
     requires(DerivedDom& d1, const DerivedDom& d2) {
@@ -63,6 +79,20 @@ struct does_derived_dom_can_widen_with // NOLINT
     : std::bool_constant< derived_dom_has_widen_with_method< DerivedDom > > {
 }; // struct does_derived_dom_can_widen_with
 
+template < typename DerivedDom >
+concept derived_dom_has_widen_with_thresholds_method =
+    requires(DerivedDom& d1,
+             const DerivedDom& d2,
+             const Thresholds& thresholds) {
+        { d1.widen_with_thresholds(d2, thresholds) } -> std::same_as< void >;
+    };
+
+template < typename DerivedDom >
+struct does_derived_dom_can_widen_with_thresholds // NOLINT
+    : std::bool_constant<
+          derived_dom_has_widen_with_thresholds_method< DerivedDom > > {
+}; // struct does_derived_dom_can_widen_with_thresholds
+
 template < typename DerivedDom >
 concept derived_dom_has_meet_with_method =
     requires(DerivedDom& d1, const DerivedDom& d2) {
@@ -107,4 +137,15 @@ struct does_derived_dom_can_equals // NOLINT
     : std::bool_constant< derived_dom_has_equals_method< DerivedDom > > {
 }; // struct does_derived_dom_can_equals
 
+template < typename DerivedDom >
+concept derived_dom_has_profile_method =
+    requires(const DerivedDom& d, llvm::FoldingSetNodeID& id) {
+        { d.Profile(id) } -> std::same_as< void >;
+    };
+
+template < typename DerivedDom >
+struct does_derived_dom_can_profile // NOLINT
+    : std::bool_constant< derived_dom_has_profile_method< DerivedDom > > {
+}; // struct does_derived_dom_can_profile
+
 } // namespace knight::dfa
\ No newline at end of file
@@ -56,6 +56,15 @@ concept graph =
         } -> std::convertible_to< typename T::PredNodeIterator >;
     }; // concept graph
 
+/// \brief A graph whose nodes have dense indices in `[0, num_nodes)`.
+template < typename T >
+concept indexed_graph =
+    graph< T > &&
+    requires(typename T::GraphRef graph, typename T::NodeRef nodeRef) {
+        { T::index(nodeRef) } -> std::convertible_to< unsigned >;
+        { T::num_nodes(graph) } -> std::convertible_to< unsigned >;
+    }; // concept indexed_graph
+
 template < graph T >
 struct GraphTrait {
     using GraphRef = typename T::GraphRef;
@@ -76,8 +85,30 @@ struct GraphTrait {
     static PredNodeIterator pred_end(NodeRef nodeRef) {
         return T::pred_end(nodeRef);
     }
+
+    /// \brief optional dense node indices, for indexed graphs only
+    /// @{
+    static unsigned index(NodeRef nodeRef)
+        requires indexed_graph< T >
+    {
+        return T::index(nodeRef);
+    }
+    static unsigned num_nodes(GraphRef graph)
+        requires indexed_graph< T >
+    {
+        return T::num_nodes(graph);
+    }
+    /// @}
 }; // struct GraphTrait
 
+/// \brief A graph trait offering dense node indices.
+template < typename Trait >
+concept indexed_graph_trait =
+    requires(typename Trait::GraphRef graph, typename Trait::NodeRef node) {
+        { Trait::index(node) } -> std::convertible_to< unsigned >;
+        { Trait::num_nodes(graph) } -> std::convertible_to< unsigned >;
+    }; // concept indexed_graph_trait
+
 template < typename T >
 struct isa_graph :                                      // NOLINT
                    std::bool_constant< graph< T > > {}; // struct isa_graph
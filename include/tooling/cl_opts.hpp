@@ -19,6 +19,8 @@
 #include <clang/Driver/Options.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 
+#include "tooling/options.hpp"
+
 namespace knight::cl_opts {
 
 using namespace llvm;
@@ -58,6 +60,65 @@ checker names.
                                        cl::init(""),
                                        cl::cat(knight_category));
 
+inline cl::opt< std::string > header_filter("header-filter",
+                                            desc(R"(
+Comma-separated list of globs of the headers whose functions
+are analyzed, prefix '-' to exclude. The functions of the
+main files are always analyzed.
+)"),
+                                            cl::init("*"),
+                                            cl::cat(knight_category));
+
+inline cl::opt< bool > system_headers("system-headers",
+                                      desc(R"(
+Analyze the functions defined in the system headers.
+)"),
+                                      cl::init(false),
+                                      cl::cat(knight_category));
+
+inline cl::opt< bool > stream_diagnostics("stream-diagnostics",
+                                          desc(R"(
+Report the diagnostics of each translation unit as soon as
+it is analyzed, by the order of the input files, instead of
+buffering the diagnostics of the whole run.
+)"),
+                                          cl::init(false),
+                                          cl::cat(knight_category));
+
+inline cl::opt< DiagnosticFormat > diagnostic_format(
+    "diagnostic-format",
+    desc(R"(
+Output format of the diagnostics.
+)"),
+    cl::values(clEnumValN(DiagnosticFormat::Text,
+                          "text",
+                          "Rendered with the source snippets (default)"),
+               clEnumValN(DiagnosticFormat::Sarif,
+                          "sarif",
+                          "SARIF 2.1.0 JSON log"),
+               clEnumValN(DiagnosticFormat::Binary,
+                          "binary",
+                          "Compact length-prefixed records")),
+    cl::init(DiagnosticFormat::Text),
+    cl::cat(knight_category));
+
+inline cl::opt< std::string > diagnostic_output("diagnostic-output",
+                                                desc(R"(
+Output file of the sarif and binary diagnostics, `-` for
+the standard output.
+)"),
+                                                cl::init("-"),
+                                                cl::cat(knight_category));
+
+inline cl::opt< std::string > config_file("config-file",
+                                          desc(R"(
+YAML config used for all the files. Without it, the config of
+a file is merged from the .knight.yaml files of its directory
+and of the parents, overridden by the command line options.
+)"),
+                                          cl::init(""),
+                                          cl::cat(knight_category));
+
 inline cl::opt< bool > list_checkers("list-checkers",
                                      desc(R"(
 list enabled checkers and exit program. Use with
@@ -81,6 +142,17 @@ Overlay the vfs described by overlay file on the real fs.
                                            cl::value_desc("filename"),
                                            cl::cat(knight_category));
 
+inline cl::opt< bool > fs_cache("fs-cache",
+                                desc(R"(
+Cache the status and contents of the files read by all the
+translation units and threads, so that the shared headers
+are read once, e.g. on a network file system. The files are
+assumed not to change during the run, except in the server
+mode where the changed ones are read again.
+)"),
+                                cl::init(false),
+                                cl::cat(knight_category));
+
 inline cl::opt< bool > use_color("use-color",
                                  desc(R"(
 Use colors in output.
@@ -109,6 +181,449 @@ Dump the control flow graph of the analyzed function.
                                 cl::init(false),
                                 cl::cat(knight_category));
 
+inline cl::opt< unsigned > analysis_threads("analysis-threads",
+                                            desc(R"(
+Number of threads used to analyze the functions of a
+translation unit. Use 0 for all hardware threads.
+)"),
+                                            cl::init(1U),
+                                            cl::cat(knight_category));
+
+inline cl::opt< bool > shared_interning("shared-interning",
+                                        desc(R"(
+Intern the regions and symbols of a translation unit once
+for all the threads analyzing its functions, so that they
+are the same nodes in every thread. The IDs of the dumped
+symbols then depend on the thread interleaving.
+)"),
+                                        cl::init(false),
+                                        cl::cat(knight_category));
+
+inline cl::opt< unsigned > tu_threads("tu-threads",
+                                      desc(R"(
+Number of threads used to analyze the input translation
+units in parallel shards. Use 0 for all hardware threads.
+)"),
+                                      cl::init(1U),
+                                      cl::cat(knight_category));
+
+inline cl::opt< unsigned > parse_threads("parse-threads",
+                                         desc(R"(
+Number of threads parsing the input translation units ahead
+of the --tu-threads threads analyzing them, so that parsing
+and analysis overlap. Use 0 to parse them in the shards.
+)"),
+                                         cl::init(0U),
+                                         cl::cat(knight_category));
+
+inline cl::opt< unsigned > max_live_asts("max-live-asts",
+                                         desc(R"(
+Maximum number of parsed translation units waiting for or
+under analysis with --parse-threads, which bounds the memory
+of the ASTs. Use 0 for twice the analysis threads.
+)"),
+                                         cl::init(0U),
+                                         cl::cat(knight_category));
+
+inline cl::opt< std::string > preamble_cache_dir("preamble-cache-dir",
+                                                desc(R"(
+Directory of the precompiled preambles, i.e. the leading
+includes of the translation units. The translation units
+with the same preamble, flags and headers load it instead of
+parsing their headers again, also across runs. Empty for no
+cache.
+)"),
+                                                cl::init(""),
+                                                cl::cat(knight_category));
+
+inline cl::opt< FixpointIteratorKind > fixpoint_iterator(
+    "fixpoint-iterator",
+    desc(R"(
+Fixpoint iterator used to analyze the functions.
+)"),
+    cl::values(clEnumValN(FixpointIteratorKind::Auto,
+                          "auto",
+                          "Select by the CFG size (default)"),
+               clEnumValN(FixpointIteratorKind::Wto,
+                          "wto",
+                          "Recursive iteration over the WTO"),
+               clEnumValN(FixpointIteratorKind::Worklist,
+                          "worklist",
+                          "Incremental worklist in WTO order")),
+    cl::init(FixpointIteratorKind::Auto),
+    cl::cat(knight_category));
+
+inline cl::opt< unsigned > worklist_min_blocks("worklist-min-blocks",
+                                               desc(R"(
+Minimum number of CFG blocks of a function for the automatic
+selection of the worklist fixpoint iterator.
+)"),
+                                               cl::init(64U),
+                                               cl::cat(knight_category));
+
+inline cl::opt< unsigned > widening_delay("widening-delay",
+                                          desc(R"(
+Number of joining iterations at a loop head before widening.
+)"),
+                                          cl::init(1U),
+                                          cl::cat(knight_category));
+
+inline cl::opt< unsigned > max_narrowing_iterations("max-narrowing-iterations",
+                                                    desc(R"(
+Maximum number of narrowing iterations at a loop head.
+)"),
+                                                    cl::init(8U),
+                                                    cl::cat(knight_category));
+
+inline cl::opt< unsigned > max_loop_iterations("max-loop-iterations",
+                                               desc(R"(
+Maximum number of loop iterations per function, after which
+the loop heads fall back to top. Use 0 for unlimited.
+)"),
+                                               cl::init(10000U),
+                                               cl::cat(knight_category));
+
+inline cl::opt< unsigned > transfer_cache_size("transfer-cache-size",
+                                               desc(R"(
+Maximum number of the memoized post states of the blocks per
+analyzed function, reused by the blocks transferred again from
+the same pre state. Use 0 for no memoization.
+)"),
+                                               cl::init(1024U),
+                                               cl::cat(knight_category));
+
+inline cl::opt< std::string > numerical_domains("numerical-domains",
+                                                desc(R"(
+Comma separated names of the domains run by the numerical
+product, among IntervalEnvDom, PackedZoneDom, CongruenceEnvDom
+and KnownBitsEnvDom, the others staying top. Use all of them
+by default.
+)"),
+                                                cl::init(""),
+                                                cl::cat(knight_category));
+
+inline cl::opt< unsigned > function_time_limit("function-time-limit",
+                                               desc(R"(
+Wall-clock time limit in milliseconds of analyzing a function.
+Once exceeded, the rest of the function jumps to top and the
+checkers are told that the results are degraded.
+Use 0 for unlimited.
+)"),
+                                               cl::init(0U),
+                                               cl::cat(knight_category));
+
+inline cl::opt< unsigned > function_step_limit("function-step-limit",
+                                               desc(R"(
+Limit of the transferred stmts and components of analyzing a
+function, with the same effect as --function-time-limit.
+Use 0 for unlimited.
+)"),
+                                               cl::init(0U),
+                                               cl::cat(knight_category));
+
+inline cl::opt< unsigned > outlier_time_limit("outlier-time-limit",
+                                              desc(R"(
+Time limit in milliseconds of analyzing a function whose
+predicted cost is far above the others of its translation
+unit, the costliest functions being analyzed first. Use 0
+for no specific limit.
+)"),
+                                              cl::init(0U),
+                                              cl::cat(knight_category));
+
+inline cl::opt< bool > cost_report("cost-report",
+                                   desc(R"(
+Print the predicted cost of each analyzed function from its
+blocks, stmts and loop nesting against its actual time.
+)"),
+                                   cl::init(false),
+                                   cl::cat(knight_category));
+
+inline cl::opt< unsigned > max_memory_per_function(
+    "max-memory-per-function",
+    desc(R"(
+Memory limit in MiB of the states and abstract values of
+analyzing a function, with the same effect as
+--function-time-limit. Use 0 for unlimited.
+)"),
+    cl::init(0U),
+    cl::cat(knight_category));
+
+inline cl::opt< bool > interprocedural("interprocedural",
+                                       desc(R"(
+Analyze the functions of a translation unit bottom-up over
+its call graph, and apply the summaries of the callees at
+the call sites. The independent functions are analyzed in
+parallel with --analysis-threads.
+)"),
+                                       cl::init(false),
+                                       cl::cat(knight_category));
+
+inline cl::opt< unsigned > max_inline_depth("max-inline-depth",
+                                            desc(R"(
+Maximum length of the call strings of the inlined calls.
+The callees with a body are analyzed in the context of
+their call sites, the other ones fall back to summaries.
+Use 0 for no inlining.
+)"),
+                                            cl::init(0U),
+                                            cl::cat(knight_category));
+
+inline cl::opt< unsigned > inline_cache_size("inline-cache-size",
+                                             desc(R"(
+Maximum number of the memoized exit states of the inlined
+calls per analyzed function, reused by the calls with the
+same entry state.
+)"),
+                                             cl::init(256U),
+                                             cl::cat(knight_category));
+
+inline cl::opt< unsigned > heap_context_depth("heap-context-depth",
+                                              desc(R"(
+Number of the innermost call sites distinguishing the heap
+objects allocated by the same allocation site. Use 0 for
+one abstraction of each allocation site.
+)"),
+                                              cl::init(1U),
+                                              cl::cat(knight_category));
+
+inline cl::opt< bool > heap_recency("heap-recency",
+                                    desc(R"(
+Keep the most recent heap object of an allocation site,
+which is strongly updated, apart from the summary of the
+former ones, which is weakly updated. Otherwise, all the
+objects of the site are summarized.
+)"),
+                                    cl::init(true),
+                                    cl::cat(knight_category));
+
+inline cl::opt< unsigned > max_array_elements("max-array-elements",
+                                              desc(R"(
+Number of elements above which the elements of an array
+are collapsed into a single smashed element, which is
+weakly updated. Use 0 to collapse all the arrays.
+)"),
+                                              cl::init(64U),
+                                              cl::cat(knight_category));
+
+inline cl::opt< bool > sparse_analysis("sparse-analysis",
+                                       desc(R"(
+Build the def-use chains of the local variables, and skip
+the transfers of the blocks which only evaluate pure
+expressions, the values flowing through them unchanged.
+)"),
+                                       cl::init(false),
+                                       cl::cat(knight_category));
+
+inline cl::opt< bool > fold_constant_branches("fold-constant-branches",
+                                              desc(R"(
+Before the fixpoint, cut the branch edges whose conditions
+fold to constants, e.g. over the feature flags and sizeofs
+or the local variables only read after their constant
+initializers, so that their blocks are not analyzed.
+)"),
+                                              cl::init(true),
+                                              cl::cat(knight_category));
+
+inline cl::opt< unsigned > trace_partitions("trace-partitions",
+                                            desc(R"(
+Maximum number of the trace partitions of a block out of
+the loops, kept apart by their recent branch decisions
+instead of joined. The partitions over the budget are
+merged, and all of them at the loop heads. Use 1 for no
+partitioning.
+)"),
+                                            cl::init(1U),
+                                            cl::cat(knight_category));
+
+inline cl::opt< std::string > summary_cache_dir("summary-cache-dir",
+                                               desc(R"(
+Directory of the persistent summary cache. The functions
+whose content, callee summaries and configuration did not
+change since a former run replay their diagnostics instead
+of being analyzed again. Empty for no cache.
+)"),
+                                               cl::init(""),
+                                               cl::cat(knight_category));
+
+inline cl::opt< bool > incremental("incremental",
+                                   desc(R"(
+Only analyze the translation units whose main file or
+included headers changed since the former run, recorded in
+the dependency database of --summary-cache-dir. The other
+translation units are skipped and report the diagnostics
+recorded by the former run.
+)"),
+                                   cl::init(false),
+                                   cl::cat(knight_category));
+
+inline cl::opt< std::string > changed_files("changed-files",
+                                            desc(R"(
+File listing the changed files for --incremental, one per
+line, e.g. the output of `git diff --name-only`. Without it,
+the files are compared to their status in the former run.
+)"),
+                                            cl::init(""),
+                                            cl::cat(knight_category));
+
+inline cl::opt< std::string > ctu_dir("ctu-dir",
+                                      desc(R"(
+Directory of the CTU index and of the precompiled ASTs of
+the translation units. The definitions of the callees of
+other translation units are imported from it, so that they
+are inlined up to --max-inline-depth.
+)"),
+                                      cl::init(""),
+                                      cl::cat(knight_category));
+
+inline cl::opt< bool > ctu_build_index("ctu-build-index",
+                                       desc(R"(
+Build the precompiled ASTs and the CTU index of the input
+files into --ctu-dir before analyzing them.
+)"),
+                                       cl::init(false),
+                                       cl::cat(knight_category));
+
+inline cl::opt< unsigned > ctu_max_loaded_asts("ctu-max-loaded-asts",
+                                               desc(R"(
+Maximum number of the precompiled ASTs loaded to import the
+callees of a translation unit, which caps the memory used.
+)"),
+                                               cl::init(8U),
+                                               cl::cat(knight_category));
+
+inline cl::opt< bool > profile("profile",
+                               desc(R"(
+Profile the CFG and WTO builds, the analysis and checker
+callbacks, the state operations and the loop iterations,
+and print a report sorted by time at exit.
+)"),
+                               cl::init(false),
+                               cl::cat(knight_category));
+
+inline cl::opt< std::string > profile_output("profile-output",
+                                             desc(R"(
+Write the profile as JSON to the given file. Implies --profile.
+)"),
+                                             cl::value_desc("filename"),
+                                             cl::cat(knight_category));
+
+inline cl::opt< bool > profile_counters("profile-counters",
+                                        desc(R"(
+Count the cycles, instructions, L1 data and last level cache
+misses and branch misses of the user space in the profiled
+spans, with the Linux perf events. Implies --profile.
+)"),
+                                        cl::init(false),
+                                        cl::cat(knight_category));
+
+inline cl::opt< std::string > trace_output("trace-output",
+                                           desc(R"(
+Write a chrome trace of the analysis to the given file, with
+the spans of each translation unit, function, cycle and cycle
+iteration, and analysis and checker callback, on the timeline
+of each thread. Open it in chrome://tracing or Perfetto.
+)"),
+                                           cl::value_desc("filename"),
+                                           cl::cat(knight_category));
+
+inline cl::opt< unsigned > trace_granularity("trace-granularity",
+                                             desc(R"(
+Minimum time in microseconds of a span in the trace.
+)"),
+                                             cl::init(50U),
+                                             cl::cat(knight_category));
+
+inline cl::opt< std::string > export_invariants("export-invariants",
+                                                desc(R"(
+Write the invariants of the analyzed functions to the given
+file, i.e. the states at the entry and the exit of each
+block, as a memory-mapped invariant file of the distinct
+states and of the points indexed by source location.
+)"),
+                                                cl::value_desc("filename"),
+                                                cl::cat(knight_category));
+
+inline cl::opt< bool > export_stmt_invariants("export-stmt-invariants",
+                                              desc(R"(
+Also export the states before and after each stmt of the
+blocks with --export-invariants.
+)"),
+                                              cl::init(false),
+                                              cl::cat(knight_category));
+
+inline cl::opt< std::string > server_socket("server",
+                                            desc(R"(
+Keep running as a server of the analysis requests on the
+given Unix socket, as JSON-RPC 2.0 messages one per line,
+with the ASTs and diagnostics of the analyzed files kept in
+memory across the requests.
+)"),
+                                            cl::value_desc("socket"),
+                                            cl::cat(knight_category));
+
+inline cl::opt< std::string > coordinator_workers("coordinator-workers",
+                                                 desc(R"(
+Run as the coordinator of the workers listed in the given
+file, one command per line such as `ssh host knight`, which
+is run with the other options, --worker and the input files
+of a shard. The workers shall see the same paths, analyze
+the shards by their predicted cost, and are replaced when
+they fail or are slower than the others.
+)"),
+                                                 cl::value_desc("filename"),
+                                                 cl::cat(knight_category));
+
+inline cl::opt< bool > worker("worker",
+                              desc(R"(
+Run as a worker of a coordinator, writing the diagnostics of
+the input files in the binary format to the standard output
+and the messages to the standard error.
+)"),
+                              cl::init(false),
+                              cl::cat(knight_category));
+
+inline cl::opt< unsigned > worker_timeout("worker-timeout",
+                                          desc(R"(
+Seconds after which a worker of the coordinator is killed
+and its shard given to another one. Use 0 for no timeout.
+)"),
+                                          cl::init(0U),
+                                          cl::cat(knight_category));
+
+inline cl::opt< unsigned > perf_runs("perf-runs",
+                                     desc(R"(
+Run the analysis of the input files the given times without
+rendering the diagnostics, and report the median wall, user
+and sys time, peak RSS, and functions, stmts and loop
+iterations per second. Analyze the whole compilation
+database if no input files are given.
+)"),
+                                     cl::init(0U),
+                                     cl::cat(knight_category));
+
+inline cl::opt< std::string > perf_output("perf-output",
+                                          desc(R"(
+Write the perf runs as JSON to the given file, which can be
+passed as --perf-baseline later.
+)"),
+                                          cl::value_desc("filename"),
+                                          cl::cat(knight_category));
+
+inline cl::opt< std::string > perf_baseline("perf-baseline",
+                                            desc(R"(
+Compare the perf runs against the given JSON written by
+--perf-output.
+)"),
+                                            cl::value_desc("filename"),
+                                            cl::cat(knight_category));
+
+inline cl::alias analysis_threads_alias("j",
+                                        desc(R"(
+Alias for --analysis-threads.
+)"),
+                                        cl::aliasopt(analysis_threads));
+
 // NOLINTEND(readability-identifier-naming,cert-err58-cpp,cppcoreguidelines-avoid-non-const-global-variables,cppcoreguidelines-interfaces-global-init,fuchsia-statically-constructed-objects)
 
 } // namespace knight::cl_opts
\ No newline at end of file
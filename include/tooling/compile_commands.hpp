@@ -0,0 +1,64 @@
+//===- compile_commands.hpp -------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the deduplication of the compile commands.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <string>
+#include <vector>
+
+namespace knight {
+
+/// \brief Get the key of the compile command from the flags changing the
+/// meaning of the translation unit, i.e. without the outputs, the
+/// dependency files, the warnings and the debug info.
+[[nodiscard]] std::string get_semantic_key(
+    const clang::tooling::CompileCommand& command);
+
+/// \brief A compilation database keeping one compile command of each file
+/// per semantic key of the underlying one, in the order of the underlying
+/// commands.
+///
+/// The compile databases often list a file several times with flags which
+/// do not change the analysis, e.g. an object per configuration of the
+/// build. The diagnostics of a file are the same for all its equivalent
+/// commands, hence analyzing one of them is enough.
+class DedupedCompilationDatabase : public clang::tooling::CompilationDatabase {
+  private:
+    const clang::tooling::CompilationDatabase& m_cdb;
+
+  public:
+    explicit DedupedCompilationDatabase(
+        const clang::tooling::CompilationDatabase& cdb)
+        : m_cdb(cdb) {}
+
+  public:
+    [[nodiscard]] const clang::tooling::CompilationDatabase& get_underlying()
+        const {
+        return m_cdb;
+    }
+
+    std::vector< clang::tooling::CompileCommand > getCompileCommands(
+        llvm::StringRef file) const override;
+
+    std::vector< std::string > getAllFiles() const override {
+        return m_cdb.getAllFiles();
+    }
+
+    std::vector< clang::tooling::CompileCommand > getAllCompileCommands()
+        const override;
+}; // class DedupedCompilationDatabase
+
+} // namespace knight
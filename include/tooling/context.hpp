@@ -17,6 +17,7 @@
 #include "tooling/options.hpp"
 #include "util/globs.hpp"
 
+#include <llvm/ADT/StringMap.h>
 #include <llvm/ADT/StringRef.h>
 
 #include <clang/AST/ASTContext.h>
@@ -27,22 +28,89 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
 
 namespace knight {
 
-class KnightContext {
+class DependencyDatabase;
+class KnightDiagnosticBuffer;
+
+/// \brief The matchers of the filters of the options.
+struct OptionMatchers {
+    Globs check_matcher;
+    Globs analysis_matcher;
+    Globs header_matcher;
+
+    explicit OptionMatchers(const KnightOptions& options);
+}; // struct OptionMatchers
+
+/// \brief The configuration shared by the contexts of all the
+/// translation units and workers of a run.
+///
+/// The global context is set up before the run starts, then only read,
+/// so that it is shared by the threads without locking.
+class KnightGlobalContext {
+  private:
+    std::shared_ptr< KnightOptionsProvider > m_opts_provider;
+
+    /// \brief The dependency database recording the analyzed translation
+    /// units, if incremental, which is synchronized by itself.
+    DependencyDatabase* m_dependency_db{};
+
+  public:
+    explicit KnightGlobalContext(
+        std::shared_ptr< KnightOptionsProvider > opts_provider)
+        : m_opts_provider(std::move(opts_provider)) {}
+
+    [[nodiscard]] const std::shared_ptr< KnightOptionsProvider >&
+    get_options_provider() const {
+        return m_opts_provider;
+    }
+
+    /// \brief Get the options for the given file.
+    [[nodiscard]] KnightOptions get_options_for(llvm::StringRef file) const {
+        return m_opts_provider->get_options_for(file.str());
+    }
+
+    /// \brief Get the dependency database, if incremental.
+    [[nodiscard]] DependencyDatabase* get_dependency_database() const {
+        return m_dependency_db;
+    }
+
+    /// \brief Set the dependency database before the run starts.
+    void set_dependency_database(DependencyDatabase* dependency_db) {
+        m_dependency_db = dependency_db;
+    }
+}; // class KnightGlobalContext
+
+/// \brief The mutable state of analyzing a translation unit, owned by a
+/// single thread.
+///
+/// Each worker analyzing the functions of a translation unit forks its
+/// own context, which shares the global context, the AST and the
+/// matchers of the translation unit, and reports its diagnostics into
+/// its own buffer instead of the diagnostic engine.
+class KnightTUContext {
   private:
+    std::shared_ptr< KnightGlobalContext > m_global;
+
     /// \brief The diagnostic engine used to diagnose errors.
     clang::DiagnosticsEngine* m_diag_engine{};
 
-    std::unique_ptr< KnightOptionsProvider > m_opts_provider;
+    /// \brief The buffer of the diagnostics reported instead of the
+    /// diagnostic engine, if any.
+    KnightDiagnosticBuffer* m_diag_buffer{};
 
     /// \brief The current file context.
     std::string m_current_file;
     KnightOptions m_current_options;
     clang::ASTContext* m_current_ast_ctx{};
-    std::unique_ptr< Globs > m_current_check_matcher;
-    std::unique_ptr< Globs > m_current_analysis_matcher;
+    std::shared_ptr< const OptionMatchers > m_current_matchers;
+
+    /// \brief The matchers by the filters of the options, so that the
+    /// files sharing the filters share the matchers and their results.
+    llvm::StringMap< std::shared_ptr< const OptionMatchers > >
+        m_matchers_cache;
     std::string m_current_build_dir;
 
     llvm::BumpPtrAllocator m_alloc;
@@ -52,9 +120,35 @@ class KnightContext {
     std::unordered_map< unsigned, std::string > m_diag_id_to_checker_name;
 
   public:
-    explicit KnightContext(
-        std::unique_ptr< KnightOptionsProvider > opts_provider);
-    ~KnightContext();
+    explicit KnightTUContext(std::shared_ptr< KnightGlobalContext > global);
+
+    /// \brief Create a context with a global context of its own.
+    explicit KnightTUContext(
+        std::shared_ptr< KnightOptionsProvider > opts_provider)
+        : KnightTUContext(std::make_shared< KnightGlobalContext >(
+              std::move(opts_provider))) {}
+
+    KnightTUContext(const KnightTUContext&) = delete;
+    KnightTUContext& operator=(const KnightTUContext&) = delete;
+    ~KnightTUContext();
+
+    /// \brief Fork the context of a worker of the current translation
+    /// unit, on the thread owning this context.
+    ///
+    /// The fork has no diagnostic buffer, and its own allocator.
+    [[nodiscard]] std::unique_ptr< KnightTUContext > fork() const;
+
+    /// \brief Get the global context, which is shared by the contexts of
+    /// parallel shards.
+    [[nodiscard]] const std::shared_ptr< KnightGlobalContext >&
+    get_global_context() const {
+        return m_global;
+    }
+
+    [[nodiscard]] const std::shared_ptr< KnightOptionsProvider >&
+    get_options_provider() const {
+        return m_global->get_options_provider();
+    }
 
     /// \brief Get the diagnostic engine.
     [[nodiscard]] clang::DiagnosticsEngine* get_diagnostic_engine() const {
@@ -64,6 +158,22 @@ class KnightContext {
     /// \brief Get the external diagnostic engine.
     void set_diagnostic_engine(clang::DiagnosticsEngine* external_diag_engine);
 
+    /// \brief Get the dependency database, if incremental.
+    [[nodiscard]] DependencyDatabase* get_dependency_database() const {
+        return m_global->get_dependency_database();
+    }
+
+    /// \brief Redirect the diagnostics into the given buffer, or back to
+    /// the diagnostic engine if null.
+    void set_diagnostic_buffer(KnightDiagnosticBuffer* buffer) {
+        m_diag_buffer = buffer;
+    }
+
+    /// \brief Get the diagnostic buffer, if any.
+    [[nodiscard]] KnightDiagnosticBuffer* get_diagnostic_buffer() const {
+        return m_diag_buffer;
+    }
+
     /// \brief Get the allocator.
     llvm::BumpPtrAllocator& get_allocator() { return m_alloc; }
 
@@ -99,6 +209,13 @@ class KnightContext {
         return m_current_options;
     }
 
+    /// \brief Get the matchers of the current options, shared by the
+    /// files with the same filters.
+    [[nodiscard]] const std::shared_ptr< const OptionMatchers >&
+    get_current_matchers() const {
+        return m_current_matchers;
+    }
+
     /// \brief Set the current clang AST context
     void set_current_ast_context(clang::ASTContext* ast_ctx);
 
@@ -117,6 +234,10 @@ class KnightContext {
     [[nodiscard]] bool is_analysis_directly_enabled(
         llvm::StringRef analysis) const;
 
+    /// \brief Check if the functions of the given header are analyzed by
+    /// the header filter.
+    [[nodiscard]] bool is_header_analyzed(llvm::StringRef header) const;
+
     /// \breif Get the enabled status of core analyses
     ///
     /// \returns \c true if the analysis is enabled, \c false otherwise.
@@ -128,7 +249,9 @@ class KnightContext {
     [[nodiscard]] std::optional< std::string > get_check_name(unsigned diag_id);
 
     /// \brief Get the options for the given file.
-    [[nodiscard]] KnightOptions get_options_for(llvm::StringRef file) const;
+    [[nodiscard]] KnightOptions get_options_for(llvm::StringRef file) const {
+        return m_global->get_options_for(file);
+    }
 
     /// \brief Diagnosing methods.
     /// @{
@@ -146,6 +269,6 @@ class KnightContext {
     clang::DiagnosticBuilder diagnose(const clang::tooling::Diagnostic& d);
     /// @}
 
-}; // class KnightContext
+}; // class KnightTUContext
 
 } // namespace knight
\ No newline at end of file
@@ -0,0 +1,84 @@
+//===- cross_tu.hpp ---------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the cross translation unit importer of the callee
+//  definitions.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <clang/AST/Decl.h>
+#include <clang/CrossTU/CrossTranslationUnit.h>
+#include <clang/Frontend/ASTUnit.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringMap.h>
+
+#include <string>
+
+namespace knight {
+
+/// \brief Imports the definitions of the callees of the analyzed functions
+/// from the precompiled ASTs of the other translation units.
+///
+/// The ASTs are indexed by the USRs of their external definitions in a
+/// pre-pass, and loaded lazily when a callee without body is found in the
+/// index. The imported definition is a redeclaration of the callee, hence
+/// its body is seen by the inliner. The definitions are imported on the
+/// main thread, before the functions are analyzed, since the importer
+/// mutates the AST context.
+class CrossTUImporter {
+  public:
+    /// \brief The name of the index in the CTU directory.
+    static constexpr llvm::StringLiteral IndexName = "externalDefMap.txt";
+
+  private:
+    clang::cross_tu::CrossTranslationUnitContext m_ctu;
+    std::string m_dir;
+
+    /// \brief The functions whose callees are imported, with the import
+    /// depth.
+    llvm::DenseMap< const clang::Decl*, unsigned > m_visited;
+
+  public:
+    /// \brief Create the importer of the translation unit of the compiler
+    /// instance, loading up to the given number of ASTs.
+    CrossTUImporter(clang::CompilerInstance& ci,
+                    llvm::StringRef dir,
+                    unsigned max_loaded_asts);
+    CrossTUImporter(const CrossTUImporter&) = delete;
+    CrossTUImporter& operator=(const CrossTUImporter&) = delete;
+
+  public:
+    /// \brief Import the definitions of the callees of the function, and
+    /// transitively of the callees of those up to the given depth.
+    void import_callees(const clang::FunctionDecl* function, unsigned depth);
+
+  public:
+    /// \brief Add the external definitions of the AST to the index.
+    static void index_ast(clang::ASTUnit& unit,
+                          llvm::StringRef ast_path,
+                          llvm::StringMap< std::string >& index);
+
+    /// \brief Write the index to the CTU directory.
+    ///
+    /// \return false if it cannot be written.
+    [[nodiscard]] static bool write_index(
+        llvm::StringRef dir, const llvm::StringMap< std::string >& index);
+
+  private:
+    /// \brief Import the definition of the function if it has no body.
+    ///
+    /// \return the definition, or null if it is not found.
+    const clang::FunctionDecl* import_definition(
+        const clang::FunctionDecl* function);
+}; // class CrossTUImporter
+
+} // namespace knight
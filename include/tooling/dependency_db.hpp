@@ -0,0 +1,128 @@
+//===- dependency_db.hpp ----------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the database of the file dependencies of the
+//  translation units, used by the incremental re-analysis.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "tooling/diagnostic.hpp"
+
+#include <clang/Basic/SourceManager.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/StringSet.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace knight {
+
+/// \brief The status of a file when its translation unit was analyzed.
+struct FileStamp {
+    std::string path;
+
+    /// \brief The modification time in nanoseconds since the epoch, so
+    /// that a file changed twice in a second is not missed.
+    int64_t mtime = 0;
+    uint64_t size = 0U;
+
+    /// \brief Get the current status of the file, or none if it is gone.
+    [[nodiscard]] static std::optional< FileStamp > get(llvm::StringRef path);
+
+    bool operator==(const FileStamp& other) const {
+        return path == other.path && mtime == other.mtime &&
+               size == other.size;
+    }
+}; // struct FileStamp
+
+/// \brief The files a translation unit was built from, the hash of the
+/// configuration it was analyzed with, and the diagnostics it reported.
+struct TUDependencies {
+    uint64_t config_hash = 0U;
+    std::vector< FileStamp > files;
+    std::vector< KnightDiagnostic > diagnostics;
+}; // struct TUDependencies
+
+/// \brief Records which files each analyzed translation unit depends on,
+/// i.e. its main file and the headers it includes.
+///
+/// A translation unit is invalidated when one of its files changed, or
+/// when its configuration changed, and the others may be skipped, their
+/// functions being kept in the summary cache and their diagnostics being
+/// reported again from the database. The records are updated by the
+/// shards in parallel.
+class DependencyDatabase {
+  private:
+    mutable std::mutex m_mutex;
+    std::map< std::string, TUDependencies > m_tus;
+
+  public:
+    DependencyDatabase() = default;
+    DependencyDatabase(const DependencyDatabase&) = delete;
+    DependencyDatabase& operator=(const DependencyDatabase&) = delete;
+
+    /// \brief Get the path of the database in the cache directory.
+    [[nodiscard]] static std::string get_path(llvm::StringRef dir);
+
+    /// \brief Load the database, leaving it empty if it is missing or not
+    /// readable, in which case all translation units are invalidated.
+    void load(llvm::StringRef path);
+
+    /// \brief Save the database.
+    ///
+    /// \return false if it cannot be written.
+    [[nodiscard]] bool save(llvm::StringRef path) const;
+
+  public:
+    /// \brief Record the files of the source manager as the dependencies
+    /// of the translation unit.
+    void record(llvm::StringRef main_file,
+                uint64_t config_hash,
+                const clang::SourceManager& source_mgr,
+                llvm::StringRef build_dir);
+
+    /// \brief Record the diagnostics reported by the translation unit, if
+    /// its dependencies are recorded.
+    void record_diagnostics(llvm::StringRef main_file,
+                            llvm::ArrayRef< KnightDiagnostic > diagnostics);
+
+    /// \brief Get the diagnostics recorded for the translation unit.
+    [[nodiscard]] std::vector< KnightDiagnostic > get_recorded_diagnostics(
+        llvm::StringRef main_file) const;
+
+    /// \brief Check if the translation unit needs to be analyzed again.
+    ///
+    /// \param changed_files The files known to have changed, or none to
+    /// compare the recorded status of the files to the current one.
+    [[nodiscard]] bool is_invalidated(
+        llvm::StringRef main_file,
+        uint64_t config_hash,
+        const std::optional< llvm::StringSet<> >& changed_files) const;
+
+    /// \brief Get the total size of the files of the translation unit
+    /// when it was analyzed, or none if it is not recorded.
+    [[nodiscard]] std::optional< uint64_t > get_recorded_size(
+        llvm::StringRef main_file) const;
+}; // class DependencyDatabase
+
+/// \brief Read the list of changed files, one per line, such as the
+/// output of `git diff --name-only`, made absolute.
+///
+/// \return none if the list cannot be read.
+[[nodiscard]] std::optional< llvm::StringSet<> > read_changed_files(
+    llvm::StringRef path);
+
+} // namespace knight
@@ -19,9 +19,12 @@
 
 #include "util/assert.hpp"
 
+#include <unordered_map>
+
 namespace knight {
 
-class KnightContext;
+class KnightTUContext;
+class DiagnosticStream;
 
 // NOLINTNEXTLINE(altera-struct-pack-align)
 struct KnightDiagnostic : clang::tooling::Diagnostic {
@@ -30,21 +33,87 @@ struct KnightDiagnostic : clang::tooling::Diagnostic {
                      llvm::StringRef build_dir);
 }; // struct KnightDiagnostic
 
+/// \brief Sort the diagnostics and remove the duplicated ones.
+void sort_and_dedup_diags(std::vector< KnightDiagnostic >& diags);
+
 // NOLINTNEXTLINE(altera-struct-pack-align)
 struct KnightDiagnosticConsumer : public clang::DiagnosticConsumer {
-    explicit KnightDiagnosticConsumer(KnightContext& context);
+    /// \brief Create the consumer, which emits the diagnostics of each
+    /// translation unit to the stream once it finishes if given.
+    explicit KnightDiagnosticConsumer(KnightTUContext& context,
+                                      DiagnosticStream* stream = nullptr);
 
     void HandleDiagnostic(clang::DiagnosticsEngine::Level diag_level,
                           const clang::Diagnostic& diagnostic) override;
 
+    void EndSourceFile() override;
+
     // Retrieve the diagnostics that were captured.
     std::vector< KnightDiagnostic > take_diags();
 
   private:
-    KnightContext& m_context;
+    KnightTUContext& m_context;
+    DiagnosticStream* m_stream;
     std::vector< KnightDiagnostic > m_diags;
+
+    /// \brief The index of the first diagnostic of the current translation
+    /// unit.
+    std::size_t m_tu_begin = 0U;
 }; // struct KnightDiagnosticConsumer
 
+/// \brief Buffers the diagnostics reported off the main thread.
+///
+/// Diagnostics are reported into a private engine and stored, then
+/// replayed into the main diagnostic engine of the context on the main
+/// thread, so that the output does not depend on thread interleaving.
+// NOLINTNEXTLINE(altera-struct-pack-align)
+class KnightDiagnosticBuffer : public clang::DiagnosticConsumer {
+  private:
+    clang::DiagnosticsEngine m_engine;
+    std::vector< clang::StoredDiagnostic > m_diags;
+    std::unordered_map< unsigned, std::string > m_diag_id_to_checker_name;
+
+  public:
+    explicit KnightDiagnosticBuffer(KnightTUContext& context);
+
+    void HandleDiagnostic(clang::DiagnosticsEngine::Level diag_level,
+                          const clang::Diagnostic& diagnostic) override;
+
+    /// \brief Report a diagnostic of the checker into the buffer.
+    clang::DiagnosticBuilder report(llvm::StringRef checker,
+                                    clang::SourceLocation loc,
+                                    llvm::StringRef fmt,
+                                    clang::DiagnosticIDs::Level diag_level);
+
+    /// \brief Add a diagnostic of the checker with the given format and
+    /// formatted message, e.g. one loaded from the summary cache.
+    void add(llvm::StringRef checker,
+             clang::DiagnosticsEngine::Level diag_level,
+             llvm::StringRef fmt,
+             llvm::StringRef message,
+             clang::FullSourceLoc loc,
+             llvm::ArrayRef< clang::CharSourceRange > ranges);
+
+    /// \brief Get the buffered diagnostics, in the order they were
+    /// reported.
+    [[nodiscard]] llvm::ArrayRef< clang::StoredDiagnostic > get_diags() const {
+        return m_diags;
+    }
+
+    /// \brief Get the checker name and the format of a buffered
+    /// diagnostic.
+    /// @{
+    [[nodiscard]] llvm::StringRef get_checker_name(
+        const clang::StoredDiagnostic& diag) const;
+    [[nodiscard]] llvm::StringRef get_format(
+        const clang::StoredDiagnostic& diag) const;
+    /// @}
+
+    /// \brief Replay the buffered diagnostics into the diagnostic engine
+    /// of the context, in the order they were reported.
+    void replay(KnightTUContext& context);
+}; // class KnightDiagnosticBuffer
+
 class KnightDiagnosticRenderer : public clang::DiagnosticRenderer {
   private:
     KnightDiagnostic& m_diag;
@@ -0,0 +1,77 @@
+//===- diagnostic_stream.hpp ------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the stream of the diagnostics of the translation
+//  units, emitted as soon as they finish.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "tooling/diagnostic.hpp"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringMap.h>
+
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace knight {
+
+/// \brief Emits the diagnostics of each translation unit once it finishes,
+/// instead of buffering the diagnostics of the whole run.
+///
+/// The diagnostics of a translation unit are sorted and deduplicated on
+/// their own, and the translation units are emitted by the order of the
+/// input files, so that the output does not depend on the shards. A
+/// translation unit finishing early waits for the former ones.
+class DiagnosticStream {
+  public:
+    /// \brief Handles the diagnostics of a translation unit, called by one
+    /// thread at a time.
+    using Handler = std::function< void(llvm::ArrayRef< KnightDiagnostic >) >;
+
+  private:
+    std::mutex m_mutex;
+    Handler m_handler;
+
+    /// \brief The indices of the input files.
+    llvm::StringMap< std::size_t > m_file_indices;
+
+    /// \brief The finished translation units not emitted yet, by input
+    /// index.
+    std::vector< std::optional< std::vector< KnightDiagnostic > > > m_pending;
+
+    /// \brief The index of the next translation unit to emit.
+    std::size_t m_next = 0U;
+
+  public:
+    DiagnosticStream(llvm::ArrayRef< std::string > input_files,
+                     Handler handler);
+    DiagnosticStream(const DiagnosticStream&) = delete;
+    DiagnosticStream& operator=(const DiagnosticStream&) = delete;
+
+  public:
+    /// \brief Add the diagnostics of the finished translation unit of the
+    /// given main file.
+    void complete(llvm::StringRef file, std::vector< KnightDiagnostic > diags);
+
+    /// \brief Complete the given files which did not finish, e.g. because
+    /// they have no compile command, so that the later ones are emitted.
+    void complete_missing(llvm::ArrayRef< std::string > files);
+
+  private:
+    /// \brief Emit the next finished translation units.
+    void flush();
+}; // class DiagnosticStream
+
+} // namespace knight
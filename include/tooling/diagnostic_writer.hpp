@@ -0,0 +1,115 @@
+//===- diagnostic_writer.hpp ------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the writers of the machine-readable diagnostics.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "tooling/diagnostic.hpp"
+#include "tooling/options.hpp"
+
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace knight {
+
+/// \brief Writes the diagnostics straight from their files and offsets,
+/// without loading the sources to render them.
+class DiagnosticWriter {
+  protected:
+    std::unique_ptr< llvm::raw_fd_ostream > m_os;
+
+  public:
+    explicit DiagnosticWriter(std::unique_ptr< llvm::raw_fd_ostream > os);
+    DiagnosticWriter(const DiagnosticWriter&) = delete;
+    DiagnosticWriter& operator=(const DiagnosticWriter&) = delete;
+    virtual ~DiagnosticWriter() = default;
+
+  public:
+    /// \brief Create the writer of the format to the given file, `-` for
+    /// the standard output.
+    ///
+    /// \return null if the format is text or the file cannot be opened.
+    [[nodiscard]] static std::unique_ptr< DiagnosticWriter > create(
+        DiagnosticFormat format, llvm::StringRef path);
+
+    virtual void write(const KnightDiagnostic& diagnostic) = 0;
+
+    /// \brief Complete and flush the output.
+    ///
+    /// \return false if it cannot be written.
+    virtual bool finish();
+}; // class DiagnosticWriter
+
+/// \brief Writes a SARIF 2.1.0 log with one run.
+///
+/// The results are streamed as they are written, and the rules of the
+/// tool are written after them. The locations are byte offsets.
+class SarifDiagnosticWriter final : public DiagnosticWriter {
+  private:
+    llvm::json::OStream m_json;
+    std::set< std::string > m_rules;
+
+  public:
+    explicit SarifDiagnosticWriter(std::unique_ptr< llvm::raw_fd_ostream > os);
+
+  public:
+    void write(const KnightDiagnostic& diagnostic) override;
+    bool finish() override;
+}; // class SarifDiagnosticWriter
+
+/// \brief Writes the diagnostics as little-endian records.
+///
+/// The file starts with the magic and the version as u32. Each record is
+/// a u32 size and the diagnostic:
+///
+///   u8 level, str name, str build directory, message, u32 note count,
+///   notes as messages
+///
+/// where a message is
+///
+///   str text, str file, u32 offset,
+///   u32 range count, ranges as (str file, u32 offset, u32 length),
+///   u32 fix count, fixes as (str file, u32 offset, u32 length, str text)
+///
+/// and a str is a u32 length and the bytes. The file paths are relative
+/// to the build directory unless absolute.
+class BinaryDiagnosticWriter final : public DiagnosticWriter {
+  public:
+    static constexpr uint32_t Magic = 0x47444e4bU; // "KNDG"
+    static constexpr uint32_t Version = 1U;
+
+  private:
+    /// \brief The buffer of the record, reused across the diagnostics.
+    std::string m_record;
+
+  public:
+    explicit BinaryDiagnosticWriter(
+        std::unique_ptr< llvm::raw_fd_ostream > os);
+
+  public:
+    void write(const KnightDiagnostic& diagnostic) override;
+}; // class BinaryDiagnosticWriter
+
+/// \brief Read the diagnostics written by a `BinaryDiagnosticWriter`.
+///
+/// \return none if the data is not a complete output of the writer.
+[[nodiscard]] std::optional< std::vector< KnightDiagnostic > >
+read_binary_diagnostics(llvm::StringRef data);
+
+} // namespace knight
@@ -0,0 +1,176 @@
+//===- distributed.hpp ------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the analysis distributed over remote workers.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "tooling/context.hpp"
+#include "tooling/diagnostic.hpp"
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace knight {
+
+class KnightDriver;
+
+/// \brief The command launching a worker, e.g. `ssh host knight`, to
+/// which the arguments of the worker are appended.
+using WorkerCommand = std::vector< std::string >;
+
+/// \brief Read the commands of the workers, one per line, skipping the
+/// empty lines and the ones starting with `#`.
+///
+/// \return none if the file cannot be read or lists no worker.
+[[nodiscard]] std::optional< std::vector< WorkerCommand > >
+read_worker_commands(llvm::StringRef path);
+
+/// \brief Redirect the standard output of a worker to its standard
+/// error, so that its messages are not mixed with its results.
+///
+/// \return the stream of the former standard output, or null if it
+/// cannot be redirected.
+[[nodiscard]] std::unique_ptr< llvm::raw_fd_ostream > take_result_stream();
+
+/// \brief Run the driver on the shard of a worker and write the
+/// diagnostics to the results in the binary format.
+///
+/// \return false if the results cannot be written.
+[[nodiscard]] bool run_worker(KnightDriver& driver,
+                              std::unique_ptr< llvm::raw_fd_ostream > results);
+
+/// \brief Analyzes the input files over remote workers.
+///
+/// The input files are split into a few shards per worker, balanced by
+/// the predicted cost of their translation units, i.e. the size of the
+/// files they were built from in the dependency database, or the size of
+/// their main file. The largest shards are given to the idle workers
+/// first, as worker processes writing their diagnostics in the binary
+/// format. The summaries are shared through the summary cache directory,
+/// if any, which the workers shall share.
+///
+/// The shard of a failed or timed out worker is given to another one,
+/// and a worker failing repeatedly is not used anymore. Once all the
+/// shards are given, the idle workers also run a backup of the running
+/// shard started first, so that a slow worker does not delay the run.
+/// The diagnostics of the shards are merged in a fixed order.
+class KnightCoordinator {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr unsigned ShardsPerWorker = 4U;
+    static constexpr unsigned MaxShardAttempts = 3U;
+    static constexpr unsigned MaxWorkerFailures = 3U;
+    static constexpr std::chrono::milliseconds PollInterval{100};
+
+  private:
+    struct Shard {
+        std::vector< std::string > files;
+        uint64_t cost = 0U;
+        /// \brief The number of failed runs.
+        unsigned attempts = 0U;
+        /// \brief The number of runs in progress, more than one for the
+        /// backups.
+        unsigned running_cnt = 0U;
+        std::optional< std::size_t > last_failed_worker;
+        bool is_done = false;
+        bool is_abandoned = false;
+        std::vector< KnightDiagnostic > diagnostics;
+    }; // struct Shard
+
+    struct Run {
+        std::size_t shard;
+        llvm::sys::ProcessInfo process;
+        std::string output_path;
+        std::string log_path;
+        Clock::time_point start;
+    }; // struct Run
+
+    struct Worker {
+        WorkerCommand command;
+        /// \brief The number of failures since its last success.
+        unsigned failures = 0U;
+        bool is_dead = false;
+        std::optional< Run > run;
+    }; // struct Worker
+
+  private:
+    KnightTUContext& m_ctx;
+    std::vector< std::string > m_input_files;
+    std::vector< Worker > m_workers;
+
+    /// \brief The arguments of the workers before and after their input
+    /// files.
+    /// @{
+    std::vector< std::string > m_worker_options;
+    std::vector< std::string > m_compile_args;
+    /// @}
+
+    /// \brief The seconds after which a worker is killed, 0 for none.
+    unsigned m_timeout;
+
+    std::vector< Shard > m_shards;
+
+  public:
+    KnightCoordinator(KnightTUContext& ctx,
+                      std::vector< std::string > input_files,
+                      std::vector< WorkerCommand > commands,
+                      std::vector< std::string > worker_options,
+                      std::vector< std::string > compile_args,
+                      unsigned timeout);
+
+  public:
+    /// \brief Analyze the input files over the workers.
+    ///
+    /// \return the diagnostics, or none if a shard failed on every
+    /// attempt or no worker is left.
+    [[nodiscard]] std::optional< std::vector< KnightDiagnostic > > run();
+
+  private:
+    /// \brief Split the input files into the shards, the most costly
+    /// first.
+    void create_shards();
+
+    /// \brief Pick the shard to run on the idle worker, and whether it is
+    /// a backup.
+    [[nodiscard]] std::optional< std::pair< std::size_t, bool > > pick_shard(
+        std::size_t worker_idx) const;
+
+    void launch(std::size_t worker_idx, std::size_t shard_idx);
+
+    /// \brief Check if the run of the worker finished, or shall be killed.
+    void poll(std::size_t worker_idx);
+
+    /// \brief Complete the run of the worker, with the diagnostics of its
+    /// output if it succeeded.
+    void finish_run(std::size_t worker_idx,
+                    bool succeeded,
+                    llvm::StringRef reason);
+
+    /// \brief Record a failure of the worker, which is not used anymore
+    /// after too many of them in a row.
+    void fail_worker(std::size_t worker_idx);
+
+    /// \brief Kill the run of the worker, e.g. a backup of a done shard.
+    static void kill_run(Run& run);
+}; // class KnightCoordinator
+
+} // namespace knight
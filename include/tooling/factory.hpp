@@ -34,7 +34,7 @@
 
 namespace knight {
 
-class KnightContext;
+class KnightTUContext;
 
 namespace dfa {
 
@@ -61,9 +61,10 @@ class KnightFactory {
 
     using AnalysisRegistryFn =
         std::function< UniqueAnalysisRef(dfa::AnalysisManager&,
-                                         KnightContext&) >;
+                                         KnightTUContext&) >;
     using CheckerRegistryFn =
-        std::function< UniqueCheckerRef(dfa::CheckerManager&, KnightContext&) >;
+        std::function< UniqueCheckerRef(dfa::CheckerManager&,
+                                        KnightTUContext&) >;
 
     using AnalysisRegistryFnMap =
         llvm::DenseMap< std::pair< dfa::AnalysisID, llvm::StringRef >,
@@ -119,13 +120,15 @@ class KnightFactory {
                               CHECKER::register_checker);
     }
 
-    /// \brief Create instances of analyses that are required.
+    /// \brief Create instances of analyses that are required, reusing the
+    /// already enabled ones.
     AnalysisRefs create_analyses(dfa::AnalysisManager& mgr,
-                                 KnightContext* context) const;
+                                 KnightTUContext* context) const;
 
-    /// \brief Create instances of checkers that are required.
+    /// \brief Create instances of checkers that are required, reusing the
+    /// already enabled ones.
     CheckerRefs create_checkers(dfa::CheckerManager& mgr,
-                                KnightContext* context) const;
+                                KnightTUContext* context) const;
 
     [[nodiscard]] const AnalysisRegistryFnMap& analysis_registries() const {
         return m_analysis_registry;
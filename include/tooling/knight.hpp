@@ -15,25 +15,37 @@
 
 #include "dfa/analysis_manager.hpp"
 #include "dfa/checker_manager.hpp"
+#include "dfa/engine/cost_model.hpp"
 #include "dfa/engine/intraprocedural_fixpoint.hpp"
 #include "dfa/location_manager.hpp"
 #include "dfa/proc_cfg.hpp"
+#include "dfa/profiler.hpp"
 #include "dfa/program_state.hpp"
 #include "dfa/region/region.hpp"
+#include "tooling/compile_commands.hpp"
 #include "tooling/context.hpp"
+#include "tooling/cross_tu.hpp"
+#include "tooling/dependency_db.hpp"
 #include "tooling/diagnostic.hpp"
+#include "tooling/diagnostic_stream.hpp"
+#include "tooling/diagnostic_writer.hpp"
 #include "tooling/factory.hpp"
+#include "tooling/preamble_cache.hpp"
 #include "util/vfs.hpp"
 
 #include <clang/AST/ASTConsumer.h>
 #include <clang/AST/DeclGroup.h>
 #include <clang/Basic/Diagnostic.h>
 #include <clang/Basic/LLVM.h>
+#include <clang/Frontend/ASTUnit.h>
 #include <clang/Frontend/CompilerInstance.h>
 #include <clang/Tooling/CompilationDatabase.h>
 #include <llvm/Support/Casting.h>
+#include <llvm/Support/TimeProfiler.h>
 #include <llvm/Support/raw_ostream.h>
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <utility>
 
@@ -41,16 +53,21 @@ namespace knight {
 
 class KnightASTConsumer : public clang::ASTConsumer {
   public:
-    KnightASTConsumer(KnightContext& ctx,
+    KnightASTConsumer(KnightTUContext& ctx,
                       dfa::AnalysisManager& analysis_manager,
                       dfa::CheckerManager& checker_manager,
                       KnightFactory::CheckerRefs checkers,
-                      KnightFactory::AnalysisRefs analysis)
+                      KnightFactory::AnalysisRefs analysis,
+                      uint64_t config_hash = 0U)
         : m_ctx(ctx),
           m_analysis_manager(analysis_manager),
           m_checker_manager(checker_manager),
           m_checkers(std::move(checkers)),
-          m_analysis(std::move(analysis)) {}
+          m_analysis(std::move(analysis)),
+          m_config_hash(config_hash) {
+        m_location_manager.set_cfg_build_options(
+            m_analysis_manager.get_cfg_build_options());
+    }
 
     // TODO(engine): add datadflow engine to run analysis and checkers here? on
     // the decl_group or tu?
@@ -61,6 +78,9 @@ class KnightASTConsumer : public clang::ASTConsumer {
             if (function == nullptr || !function->hasBody()) {
                 continue;
             }
+            if (!should_analyze(function)) {
+                continue;
+            }
 
             llvm::outs() << "[*] Processing function: ";
             if (m_ctx.get_current_options().use_color) {
@@ -91,37 +111,128 @@ class KnightASTConsumer : public clang::ASTConsumer {
                                        m_ctx.get_current_options().use_color);
             }
 
-            dfa::IntraProceduralFixpointIterator
-                engine(m_ctx,
-                       m_analysis_manager,
-                       m_checker_manager,
-                       m_analysis_manager.get_state_manager(),
-                       frame);
-            engine.run();
+            // Functions are analyzed on the scheduler once the whole
+            // translation unit is parsed.
+            if (m_ctx.get_current_options().analysis_threads != 1U ||
+                m_ctx.get_current_options().interprocedural ||
+                !m_ctx.get_current_options().summary_cache_dir.empty() ||
+                m_ctu_importer != nullptr) {
+                m_pending_frames.push_back(frame);
+                continue;
+            }
+
+            analyze_function(m_ctx,
+                             m_analysis_manager,
+                             m_checker_manager,
+                             frame);
         }
 
         return true;
     }
 
+    /// \brief Analyze the functions collected from the translation unit
+    /// on the function scheduler.
+    void HandleTranslationUnit(clang::ASTContext& ast_ctx) override;
+
+    /// \brief Also analyze the functions of the precompiled preamble,
+    /// which are deserialized instead of passed as top level decls.
+    void set_uses_preamble(bool uses_preamble) {
+        m_uses_preamble = uses_preamble;
+    }
+
+    /// \brief Import the callees of the functions from the other
+    /// translation units before analyzing them.
+    void set_cross_tu_importer(std::unique_ptr< CrossTUImporter > importer) {
+        m_ctu_importer = std::move(importer);
+    }
+
+    /// \brief Run the intra-procedural analysis and checkers on the
+    /// given top frame, applying and completing the summaries if any.
+    ///
+    /// \param time_limit_ms the time limit of the function, 0 for the
+    /// configured one.
+    /// \return the summary of the function.
+    static dfa::FunctionSummary analyze_function(
+        KnightTUContext& ctx,
+        dfa::AnalysisManager& analysis_manager,
+        dfa::CheckerManager& checker_manager,
+        const dfa::StackFrame* frame,
+        dfa::SummaryTable* summaries = nullptr,
+        unsigned time_limit_ms = 0U) {
+        const llvm::TimeTraceScope scope("Function", [frame] {
+            return dfa::get_decl_profile_name(frame->get_decl());
+        });
+        const auto start = dfa::FunctionDeadline::Clock::now();
+        dfa::IntraProceduralFixpointIterator
+            engine(ctx, analysis_manager, checker_manager, frame);
+        engine.set_summaries(summaries);
+        if (time_limit_ms != 0U) {
+            engine.set_time_limit(time_limit_ms);
+        }
+        engine.run();
+        if (ctx.get_current_options().cost_report) {
+            dfa::record_function_cost(
+                dfa::get_decl_profile_name(frame->get_decl()),
+                dfa::estimate_function_cost(frame),
+                std::chrono::duration_cast<
+                    dfa::FunctionDeadline::Milliseconds >(
+                    dfa::FunctionDeadline::Clock::now() - start));
+        }
+        return engine.get_summary();
+    }
+
+  private:
+    /// \brief Check if the function is analyzed by this translation unit,
+    /// i.e. it is not filtered by its header, it is not analyzed by
+    /// another translation unit yet, and an analysis or a checker may fire
+    /// in it.
+    [[nodiscard]] bool should_analyze(const clang::FunctionDecl* function);
+
+    /// \brief Check if any required analysis or checker visits the
+    /// function, from the stmt classes of its body.
+    [[nodiscard]] bool has_relevant_stmts(
+        const clang::FunctionDecl* function) const;
+
   private:
-    KnightContext& m_ctx;
+    KnightTUContext& m_ctx;
     dfa::AnalysisManager& m_analysis_manager;
     dfa::CheckerManager& m_checker_manager;
     KnightFactory::CheckerRefs m_checkers;
     KnightFactory::AnalysisRefs m_analysis;
     dfa::LocationManager m_location_manager;
+
+    /// \brief The hash of the configuration of the translation unit,
+    /// keying the summary cache and the dependency database.
+    uint64_t m_config_hash;
+
+    std::unique_ptr< CrossTUImporter > m_ctu_importer;
+
+    bool m_uses_preamble = false;
+
+    /// \brief Top frames waiting for the function scheduler, in source
+    /// order.
+    std::vector< const dfa::StackFrame* > m_pending_frames;
 }; // class KnightASTConsumer
 
 class KnightASTConsumerFactory {
   private:
-    KnightContext& m_ctx;
+    KnightTUContext& m_ctx;
     std::unique_ptr< KnightFactory > m_factory;
     std::unique_ptr< dfa::AnalysisManager > m_analysis_manager;
     std::unique_ptr< dfa::CheckerManager > m_checker_manager;
 
+    /// \brief The checkers and analyses resolved for the matchers of some
+    /// options, which are kept alive to identify them.
+    struct ResolvedModules {
+        std::shared_ptr< const OptionMatchers > matchers;
+        KnightFactory::CheckerRefs checkers;
+        KnightFactory::AnalysisRefs analyses;
+    }; // struct ResolvedModules
+    std::vector< ResolvedModules > m_resolved_modules;
+
   public:
     explicit KnightASTConsumerFactory(
-        KnightContext& ctx,
+        KnightTUContext& ctx,
         std::unique_ptr< dfa::AnalysisManager > external_analysis_manager =
             nullptr,
         std::unique_ptr< dfa::CheckerManager > external_checker_manager =
@@ -131,6 +242,31 @@ class KnightASTConsumerFactory {
     [[nodiscard]] std::unique_ptr< clang::ASTConsumer > create_ast_consumer(
         clang::CompilerInstance& ci, llvm::StringRef file);
 
+    /// \brief Create an AST consumer for the given file parsed ahead into
+    /// the AST context, without the cross translation unit importer as
+    /// it needs the compiler instance.
+    [[nodiscard]] std::unique_ptr< KnightASTConsumer > create_ast_consumer(
+        clang::ASTContext& ast_ctx,
+        llvm::StringRef file,
+        llvm::StringRef build_dir);
+
+    /// \brief Enable the checkers and analyses of the current file and
+    /// create their instances.
+    ///
+    /// The result is resolved once per distinct filters of the options,
+    /// and the instances are created on the first file requiring them.
+    [[nodiscard]] std::pair< KnightFactory::CheckerRefs,
+                             KnightFactory::AnalysisRefs >
+    create_checkers_and_analyses();
+
+    [[nodiscard]] dfa::AnalysisManager& get_analysis_manager() const {
+        return *m_analysis_manager;
+    }
+
+    [[nodiscard]] dfa::CheckerManager& get_checker_manager() const {
+        return *m_checker_manager;
+    }
+
     /// \brief Get the list of enabled checks.
     [[nodiscard]] std::vector< std::pair< dfa::CheckerID, llvm::StringRef > >
     get_enabled_checks() const;
@@ -143,18 +279,32 @@ class KnightASTConsumerFactory {
     [[nodiscard]] std::vector< std::pair< dfa::AnalysisID, llvm::StringRef > >
     get_enabled_core_analyses() const;
 
+    /// \brief Get the hash of the enabled checkers, analyses and domains
+    /// and of the options which change the analysis results.
+    [[nodiscard]] uint64_t get_configuration_hash() const;
+
 }; // class KnightASTConsumerFactory
 
 class KnightDriver {
   private:
-    KnightContext& m_ctx;
-    const clang::tooling::CompilationDatabase& m_cdb;
+    KnightTUContext& m_ctx;
+    /// \brief The compile commands of the input files, one per distinct
+    /// semantic flags.
+    DedupedCompilationDatabase m_cdb;
     std::vector< std::string > m_input_files;
     llvm::IntrusiveRefCntPtr< llvm::vfs::OverlayFileSystem > m_base_fs;
 
+    /// \brief The handler of the diagnostics of each finished translation
+    /// unit, or empty if the diagnostics of the run are returned.
+    DiagnosticStream::Handler m_diag_handler;
+
+    /// \brief The precompiled preambles of the input files, or null if
+    /// they parse their preambles.
+    std::unique_ptr< PreambleCache > m_preamble_cache;
+
   public:
     KnightDriver(
-        KnightContext& ctx,
+        KnightTUContext& ctx,
         const clang::tooling::CompilationDatabase& cdb,
         std::vector< std::string > input_files,
         llvm::IntrusiveRefCntPtr< llvm::vfs::OverlayFileSystem > base_fs)
@@ -164,11 +314,72 @@ class KnightDriver {
           m_base_fs(std::move(base_fs)) {}
 
   public:
+    /// \brief Run the analysis on the input files, only on the
+    /// invalidated ones if incremental.
     std::vector< KnightDiagnostic > run();
 
     void handle_diagnostics(const std::vector< KnightDiagnostic >& diagnostics,
                             bool try_fix);
 
+    /// \brief Run the analysis and report the diagnostics of each
+    /// translation unit as soon as it finishes, by the order of the input
+    /// files.
+    ///
+    /// \return true if a compilation error is found.
+    [[nodiscard]] bool run_and_report(bool try_fix);
+
+  private:
+    /// \brief Create the writer of the machine-readable diagnostics.
+    ///
+    /// \return null if the diagnostics are rendered as text.
+    [[nodiscard]] std::unique_ptr< DiagnosticWriter > create_diagnostic_writer(
+        bool try_fix) const;
+
+    /// \brief Build the precompiled ASTs and the CTU index of the input
+    /// files.
+    void build_ctu_index() const;
+
+    /// \brief Run the analysis on the input files in parallel shards.
+    ///
+    /// \return the diagnostics, or none if they are streamed to the
+    /// diagnostic handler.
+    std::vector< KnightDiagnostic > run_files();
+
+    /// \brief Run the analysis on the input files by the analysis threads
+    /// while the parse threads parse the next ones ahead, with at most
+    /// `max_live_asts` parsed units alive.
+    ///
+    /// \return the diagnostics, or none if they are streamed.
+    std::vector< KnightDiagnostic > run_pipeline(
+        DiagnosticStream* stream) const;
+
+    /// \brief Drop the repeated input files and report the equivalent
+    /// compile commands analyzed once.
+    void dedup_compile_commands();
+
+    /// \brief Keep the input files invalidated since the run recorded in
+    /// the dependency database.
+    ///
+    /// \return the skipped input files.
+    std::vector< std::string > select_invalidated_files(
+        const DependencyDatabase& dependency_db);
+
+    /// \brief Run the analysis on the input files of a shard sequentially.
+    std::vector< KnightDiagnostic > run_shard(
+        KnightTUContext& ctx,
+        const std::vector< std::string >& input_files,
+        llvm::IntrusiveRefCntPtr< llvm::vfs::OverlayFileSystem > base_fs,
+        DiagnosticStream* stream) const;
+
 }; // class KnightDriver
 
+/// \brief Analyze a parsed unit as the frontend action would, replaying
+/// the diagnostics of its parse first.
+void analyze_ast_unit(KnightASTConsumerFactory& ast_factory,
+                      KnightDiagnosticConsumer& diag_consumer,
+                      clang::DiagnosticsEngine& diag_engine,
+                      clang::ASTUnit& unit,
+                      llvm::StringRef file,
+                      llvm::StringRef build_dir);
+
 } // namespace knight
@@ -14,7 +14,12 @@
 
 #pragma once
 
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <set>
 #include <string>
@@ -26,6 +31,18 @@ enum class OptionSource { Default, CommandLine, ConfigFile };
 
 const char* optionSourceToString(OptionSource source);
 
+/// \brief Fixpoint iterator used to analyze a function.
+///
+/// `Auto` uses the worklist iterator for the CFGs with at least
+/// `worklist_min_blocks` blocks, and the WTO iterator otherwise.
+enum class FixpointIteratorKind { Auto, Wto, Worklist };
+
+/// \brief Output format of the diagnostics.
+///
+/// `Text` renders the diagnostics with the source snippets, the other
+/// formats are written straight from the diagnostics for the tools.
+enum class DiagnosticFormat { Text, Sarif, Binary };
+
 using CheckerOptVal = std::variant< bool, std::string, int >;
 using Extentions = std::set< std::string >;
 
@@ -43,6 +60,23 @@ struct KnightOptions {
     /// \brief Implematation file extensions.
     Extentions impl_extensions = {"c", "cc", "cpp", "cxx"};
 
+    /// \brief globs of the headers whose functions are analyzed
+    std::string header_filter = "*";
+
+    /// \brief analyze the functions of the system headers
+    bool system_headers = false;
+
+    /// \brief report the diagnostics of each translation unit once it
+    /// finishes instead of at the end of the run
+    bool stream_diagnostics = false;
+
+    /// \brief output format of the diagnostics
+    DiagnosticFormat diagnostic_format = DiagnosticFormat::Text;
+
+    /// \brief output file of the machine-readable diagnostics, `-` for
+    /// the standard output
+    std::string diagnostic_output = "-";
+
     /// \brief checker specific options
     std::map< std::string, CheckerOptVal > check_opts{};
 
@@ -57,6 +91,138 @@ struct KnightOptions {
 
     /// \brief dump control flow graph
     bool dump_cfg = false;
+
+    /// \brief number of threads analyzing the functions of a TU,
+    /// 0 for all hardware threads
+    unsigned analysis_threads = 1U;
+
+    /// \brief intern the regions and symbols of a TU once for all the
+    /// `analysis_threads` threads, so that they are the same nodes in
+    /// every thread, with the symbol IDs depending on the interleaving
+    bool shared_interning = false;
+
+    /// \brief number of threads analyzing the input TUs in parallel
+    /// shards, 0 for all hardware threads
+    unsigned tu_threads = 1U;
+
+    /// \brief number of threads parsing the input TUs ahead of the
+    /// `tu_threads` threads analyzing them, 0 to parse them in the shards
+    unsigned parse_threads = 0U;
+
+    /// \brief maximum number of parsed TUs kept in memory by the parse
+    /// threads, 0 for twice the analysis threads
+    unsigned max_live_asts = 0U;
+
+    /// \brief directory of the precompiled preambles shared by the TUs
+    /// with the same preamble and flags, empty to parse the preambles
+    std::string preamble_cache_dir = "";
+
+    /// \brief fixpoint iterator used to analyze the functions
+    FixpointIteratorKind fixpoint_iterator = FixpointIteratorKind::Auto;
+
+    /// \brief minimum number of CFG blocks for the automatic selection
+    /// of the worklist fixpoint iterator
+    unsigned worklist_min_blocks = 64U;
+
+    /// \brief number of joining iterations before widening at a loop head
+    unsigned widening_delay = 1U;
+
+    /// \brief maximum number of narrowing iterations at a loop head
+    unsigned max_narrowing_iterations = 8U;
+
+    /// \brief maximum number of loop iterations per function before the
+    /// loop heads fall back to top, 0 for unlimited
+    unsigned max_loop_iterations = 10000U;
+
+    /// \brief maximum number of the memoized post states of the blocks
+    /// per function, 0 for no memoization
+    unsigned transfer_cache_size = 1024U;
+
+    /// \brief comma separated names of the domains run by the numerical
+    /// product, empty for all of them
+    std::string numerical_domains;
+
+    /// \brief wall-clock time limit in milliseconds of analyzing a
+    /// function, 0 for unlimited
+    unsigned function_time_limit = 0U;
+
+    /// \brief step limit of analyzing a function, 0 for unlimited
+    unsigned function_step_limit = 0U;
+
+    /// \brief wall-clock time limit in milliseconds of analyzing a
+    /// function predicted far costlier than the others of its translation
+    /// unit, 0 for no specific limit
+    unsigned outlier_time_limit = 0U;
+
+    /// \brief print the predicted against the actual costs of the
+    /// analyzed functions
+    bool cost_report = false;
+
+    /// \brief memory limit in MiB of analyzing a function, 0 for
+    /// unlimited
+    unsigned max_memory_per_function = 0U;
+
+    /// \brief analyze the functions bottom-up over the call graph and
+    /// apply the summaries of the callees at the call sites
+    bool interprocedural = false;
+
+    /// \brief maximum length of the call strings of the inlined calls,
+    /// 0 for no inlining
+    unsigned max_inline_depth = 0U;
+
+    /// \brief maximum number of the memoized exit states of the inlined
+    /// calls per function
+    unsigned inline_cache_size = 256U;
+
+    /// \brief number of the innermost call sites distinguishing the heap
+    /// objects of an allocation site
+    unsigned heap_context_depth = 1U;
+
+    /// \brief keep the most recent heap object of an allocation site apart
+    /// from the summary of the former ones
+    bool heap_recency = true;
+
+    /// \brief number of elements above which the elements of an array are
+    /// collapsed into a single smashed element
+    unsigned max_array_elements = 64U;
+
+    /// \brief skip the transfers of the blocks which change no value,
+    /// following the def-use chains of the local variables
+    bool sparse_analysis = false;
+
+    /// \brief cut the branch edges whose conditions fold to constants,
+    /// over the local variables only read after their constant
+    /// initializers, before the fixpoint
+    bool fold_constant_branches = true;
+
+    /// \brief maximum number of the trace partitions kept apart in a
+    /// block out of the loops, by their recent branch decisions, 1 for
+    /// no partitioning
+    unsigned trace_partitions = 1U;
+
+    /// \brief directory of the persistent summary cache, empty for no
+    /// cache
+    std::string summary_cache_dir = "";
+
+    /// \brief only analyze the translation units whose files changed
+    /// since the former run, tracked in the summary cache directory, the
+    /// others reporting their diagnostics of the former run
+    bool incremental = false;
+
+    /// \brief file listing the changed files for the incremental mode,
+    /// empty to compare the status of the files to the former run
+    std::string changed_files = "";
+
+    /// \brief directory of the CTU index and of the precompiled ASTs of
+    /// the translation units, empty for no cross translation unit import
+    std::string ctu_dir = "";
+
+    /// \brief build the CTU index of the input files before analyzing them
+    bool ctu_build_index = false;
+
+    /// \brief maximum number of the precompiled ASTs loaded per
+    /// translation unit
+    unsigned ctu_max_loaded_asts = 8U;
 }; // struct KnightOptions
 
 struct KnightOptionsProvider {
@@ -106,11 +272,66 @@ struct KnightOptionsCommandLineProvider : KnightOptionsDefaultProvider {
 
 }; // class KnightOptionsCommandLineProvider
 
-// TODO: add config file support
+/// \brief Provides the options of the `.knight.yaml` files of the
+/// directories of the files, like the `.clang-tidy` files.
+///
+/// The options of a directory are the ones of its parent overridden by
+/// its config file, and the command line options override them. The config
+/// keys are the names of the option fields. Each config file is parsed
+/// once and the options of each directory are merged once per run, shared
+/// by the parallel shards.
 class KnightOptionsConfigFileProvider
     : public KnightOptionsCommandLineProvider {
   public:
-    KnightOptionsConfigFileProvider(std::string config_file);
-};
+    static constexpr llvm::StringLiteral ConfigFileName = ".knight.yaml";
+
+  private:
+    /// \brief The config file used for all the files, empty for the
+    /// lookup by directory.
+    std::string m_config_file;
+
+    /// \brief The options before the command line ones are set.
+    KnightOptions m_defaults;
+
+    mutable std::mutex m_mutex;
+
+    /// \brief The options of the config files by directory, without the
+    /// command line ones.
+    mutable llvm::StringMap< std::shared_ptr< const KnightOptions > >
+        m_dir_options;
+
+    /// \brief The options of the files by directory.
+    mutable llvm::StringMap< std::shared_ptr< const KnightOptions > >
+        m_file_options;
+
+    /// \brief The command line options which differ from the defaults, as
+    /// a config, computed once the command line is parsed.
+    mutable std::optional< std::string > m_command_line_config;
+
+  public:
+    explicit KnightOptionsConfigFileProvider(std::string config_file = "");
+
+    KnightOptions get_options_for(const std::string& file) const override;
+
+    void set_checker_option(const std::string& option,
+                            CheckerOptVal value) override;
+
+  private:
+    /// \brief Get the options of the config files of the directory and
+    /// of its parents, with the mutex locked.
+    std::shared_ptr< const KnightOptions > get_dir_options(
+        llvm::StringRef dir) const;
+}; // class KnightOptionsConfigFileProvider
+
+/// \brief Override the options by the ones of the YAML config.
+///
+/// \return false if the config is invalid, which may be partially applied.
+[[nodiscard]] bool apply_config(KnightOptions& options,
+                                llvm::StringRef config,
+                                llvm::StringRef config_name);
+
+/// \brief Get the YAML config of the options differing from the defaults.
+[[nodiscard]] std::string get_config_diff(const KnightOptions& options,
+                                          const KnightOptions& defaults);
 
 } // namespace knight
\ No newline at end of file
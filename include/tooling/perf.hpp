@@ -0,0 +1,93 @@
+//===- perf.hpp -------------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the macro benchmark harness of the knight driver.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "tooling/context.hpp"
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace knight {
+
+/// \brief Measurements of one run over the input files.
+struct PerfSample {
+    double wall_seconds = 0.0;
+    double user_seconds = 0.0;
+    double sys_seconds = 0.0;
+    /// \brief Peak resident set size of the process so far.
+    uint64_t peak_rss_bytes = 0U;
+    uint64_t functions = 0U;
+    uint64_t stmts = 0U;
+    uint64_t iterations = 0U;
+}; // struct PerfSample
+
+struct PerfReport {
+    std::vector< PerfSample > runs;
+
+    /// \brief Get the median of each measurement over the runs.
+    [[nodiscard]] PerfSample get_median() const;
+}; // struct PerfReport
+
+/// \brief Runs the driver repeatedly over the input files and measures
+/// each run.
+///
+/// The diagnostics are collected but never rendered, so that the runs
+/// measure the engine rather than the reporter.
+class PerfHarness {
+  private:
+    KnightTUContext& m_ctx;
+    const clang::tooling::CompilationDatabase& m_cdb;
+    std::vector< std::string > m_input_files;
+    llvm::IntrusiveRefCntPtr< llvm::vfs::OverlayFileSystem > m_base_fs;
+
+  public:
+    PerfHarness(
+        KnightTUContext& ctx,
+        const clang::tooling::CompilationDatabase& cdb,
+        std::vector< std::string > input_files,
+        llvm::IntrusiveRefCntPtr< llvm::vfs::OverlayFileSystem > base_fs);
+
+  public:
+    [[nodiscard]] PerfReport run(unsigned num_runs);
+
+  private:
+    [[nodiscard]] PerfSample run_once();
+}; // class PerfHarness
+
+/// \brief Print the median of the runs with the throughputs.
+void print_perf_report(const PerfReport& report, llvm::raw_ostream& os);
+
+/// \brief Write the runs and their median as JSON, which can be read
+/// back as a baseline.
+void write_perf_json(const PerfReport& report, llvm::raw_ostream& os);
+
+/// \brief Read the median of a report written by `write_perf_json`, or
+/// print the error and return none.
+[[nodiscard]] std::optional< PerfSample > read_perf_baseline(
+    llvm::StringRef path);
+
+/// \brief Print the relative change of each measurement against the
+/// baseline.
+void print_perf_diff(const PerfSample& current,
+                     const PerfSample& baseline,
+                     llvm::raw_ostream& os);
+
+} // namespace knight
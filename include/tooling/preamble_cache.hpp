@@ -0,0 +1,92 @@
+//===- preamble_cache.hpp ---------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the on-disk cache of the precompiled preambles.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <clang/Basic/FileManager.h>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <clang/Serialization/PCHContainerOperations.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace knight {
+
+/// \brief A directory of precompiled preambles shared by the translation
+/// units, i.e. the leading includes of their main files parsed once into
+/// a PCH.
+///
+/// A preamble is keyed by the frontend flags, the working and main file
+/// directories and the text of the preamble, so that the translation
+/// units of a project with the same leading includes share one PCH. Each
+/// PCH is stored with the content hashes of its headers, and is built
+/// again when one of them changed. A PCH is built or validated once per
+/// key and run, and the translation units waiting for it are blocked
+/// meanwhile.
+class PreambleCache {
+  private:
+    struct Entry {
+        std::mutex mutex;
+        /// \brief Whether the PCH is up to date, or none if not checked
+        /// yet.
+        std::optional< bool > is_usable;
+    }; // struct Entry
+
+  private:
+    std::string m_dir;
+
+    std::mutex m_mutex;
+    llvm::DenseMap< uint64_t, std::unique_ptr< Entry > > m_entries;
+
+  public:
+    explicit PreambleCache(std::string dir) : m_dir(std::move(dir)) {}
+    PreambleCache(const PreambleCache&) = delete;
+    PreambleCache& operator=(const PreambleCache&) = delete;
+
+  public:
+    /// \brief Make the invocation load the precompiled preamble of its
+    /// main file, building it first if it is missing or stale.
+    ///
+    /// \return false if the invocation parses its preamble, e.g. it has
+    /// none, it already includes a PCH or the preamble does not compile.
+    [[nodiscard]] bool apply(
+        clang::CompilerInvocation& invocation,
+        clang::FileManager& file_mgr,
+        std::shared_ptr< clang::PCHContainerOperations > pch_container_ops);
+
+  private:
+    [[nodiscard]] Entry& get_entry(uint64_t key);
+
+    /// \brief Check if the headers of the PCH did not change since it was
+    /// built.
+    [[nodiscard]] static bool is_up_to_date(llvm::StringRef pch_path,
+                                            clang::FileManager& file_mgr);
+
+    /// \brief Build the PCH of the preamble of the invocation and record
+    /// the content hashes of its headers.
+    ///
+    /// \return false if the preamble has errors or cannot be written.
+    [[nodiscard]] static bool build(
+        const clang::CompilerInvocation& invocation,
+        llvm::StringRef preamble,
+        llvm::StringRef pch_path,
+        clang::FileManager& file_mgr,
+        std::shared_ptr< clang::PCHContainerOperations > pch_container_ops);
+}; // class PreambleCache
+
+} // namespace knight
@@ -20,6 +20,8 @@
 #include <clang/Basic/Diagnostic.h>
 #include <clang/Basic/SourceManager.h>
 
+#include <string>
+
 namespace knight {
 
 enum class FixKind {
@@ -29,7 +31,7 @@ enum class FixKind {
 
 class DiagnosticReporter {
   private:
-    KnightContext& m_ctx;
+    KnightTUContext& m_ctx;
 
     clang::FileManager m_file_manager;
 
@@ -39,9 +41,19 @@ class DiagnosticReporter {
     clang::SourceManager m_source_manager;
 
     FixKind m_fix_kind;
-    llvm::StringMap<
-        std::pair< llvm::StringRef, clang::tooling::Replacements > >
-        m_file_to_build_dir_and_replaces;
+
+    /// \brief The replacements by absolute file path, checked for the
+    /// conflicts as they are added.
+    llvm::StringMap< clang::tooling::Replacements > m_file_to_replaces;
+
+    /// \brief The file IDs by build directory and path, invalid for the
+    /// files not found, so that each file is looked up and its line table
+    /// computed only once.
+    llvm::StringMap< clang::FileID > m_file_ids;
+
+    /// \brief Build directory of the reported diagnostic, against which
+    /// its relative paths are resolved.
+    std::string m_build_dir;
 
     clang::LangOptions m_lang_opts;
 
@@ -50,7 +62,7 @@ class DiagnosticReporter {
 
   public:
     DiagnosticReporter(FixKind kind,
-                       KnightContext& ctx,
+                       KnightTUContext& ctx,
                        fs::FileSystemRef base_vfs);
 
   public:
@@ -58,6 +70,8 @@ class DiagnosticReporter {
 
     void report(const KnightDiagnostic& diagnostic);
 
+    /// \brief Apply the replacements of the files in parallel, writing
+    /// each file atomically once.
     void apply_fixes();
 
   private:
@@ -65,6 +79,8 @@ class DiagnosticReporter {
     get_replacements(const clang::tooling::Diagnostic& diagnostic,
                      bool fix_note);
 
+    clang::FileID get_file_id(llvm::StringRef file);
+
     clang::SourceLocation get_composed_loc(llvm::StringRef file,
                                            unsigned offset);
 
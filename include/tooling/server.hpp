@@ -0,0 +1,137 @@
+//===- server.hpp -----------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the resident server of the analysis requests.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "tooling/context.hpp"
+#include "tooling/dependency_db.hpp"
+#include "tooling/diagnostic.hpp"
+#include "util/vfs.hpp"
+
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Frontend/ASTUnit.h>
+#include <clang/Serialization/PCHContainerOperations.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_socket_stream.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace knight {
+
+class KnightASTConsumerFactory;
+
+/// \brief A resident analyzer serving the requests of a client over a
+/// Unix socket, e.g. an editor or a pre-commit hook.
+///
+/// The requests are JSON-RPC 2.0 messages, one per line, served one at a
+/// time:
+///
+///   analyze     {"files": [...]}  -> {"diagnostics": [...], ...}
+///   invalidate  {"files": [...]}  -> null
+///   shutdown                      -> null
+///
+/// The parsed ASTs and the diagnostics of each analyzed file stay in
+/// memory across the requests. A file is analyzed again only when one of
+/// the files of its translation unit changed on disk or is invalidated,
+/// and its AST is then reparsed with its precompiled preamble, so that an
+/// edit of the main file does not parse its headers again. The other
+/// files replay their diagnostics.
+class KnightServer {
+  private:
+    /// \brief The AST of a compile command of a file.
+    struct ServedUnit {
+        std::string build_dir;
+        std::unique_ptr< clang::ASTUnit > unit;
+    }; // struct ServedUnit
+
+    struct ServedFile {
+        std::vector< ServedUnit > units;
+        std::vector< KnightDiagnostic > diagnostics;
+        uint64_t config_hash = 0U;
+        /// \brief Whether one of its files is invalidated by the client.
+        bool is_invalidated = false;
+    }; // struct ServedFile
+
+  private:
+    KnightTUContext& m_ctx;
+    const clang::tooling::CompilationDatabase& m_cdb;
+    fs::OverlayFileSystemRef m_base_fs;
+    /// \brief The file system cache of the base VFS, if any, refreshed
+    /// before each analysis.
+    fs::FileSystemCache* m_fs_cache;
+    std::shared_ptr< clang::PCHContainerOperations > m_pch_container_ops;
+
+    /// \brief The files of the analyzed translation units, recorded by
+    /// their consumers.
+    DependencyDatabase m_dependency_db;
+
+    std::map< std::string, ServedFile > m_files;
+    bool m_shutdown = false;
+
+  public:
+    KnightServer(KnightTUContext& ctx,
+                 const clang::tooling::CompilationDatabase& cdb,
+                 fs::OverlayFileSystemRef base_fs);
+    KnightServer(const KnightServer&) = delete;
+    KnightServer& operator=(const KnightServer&) = delete;
+    ~KnightServer();
+
+  public:
+    /// \brief Serve the clients connecting to the socket one after the
+    /// other, until a shutdown request.
+    ///
+    /// \return false if the socket cannot be created.
+    [[nodiscard]] bool serve(llvm::StringRef socket_path);
+
+  private:
+    /// \brief Serve the requests of the client until it disconnects.
+    void serve_client(llvm::raw_socket_stream& client);
+
+    /// \brief Handle a message and get its response, or none for a
+    /// notification.
+    [[nodiscard]] std::optional< llvm::json::Value > handle_message(
+        llvm::StringRef message);
+
+    /// \brief Analyze the files whose translation units changed, and get
+    /// the diagnostics of all the files.
+    [[nodiscard]] llvm::json::Value analyze(
+        llvm::ArrayRef< std::string > files);
+
+    /// \brief Invalidate the files which depend on the given ones.
+    void invalidate(const llvm::StringSet<>& files);
+
+    /// \brief Parse the file again, or for the first time, and analyze it.
+    void analyze_file(const std::string& file,
+                      ServedFile& served,
+                      KnightASTConsumerFactory& ast_factory,
+                      KnightDiagnosticConsumer& diag_consumer,
+                      clang::DiagnosticsEngine& diag_engine);
+
+    /// \brief Reparse the units of the file with their preambles.
+    ///
+    /// \return false if there are none or one of them fails.
+    [[nodiscard]] bool reparse(ServedFile& served);
+
+    /// \brief Parse the units of each compile command of the file.
+    [[nodiscard]] std::vector< ServedUnit > parse(const std::string& file);
+}; // class KnightServer
+
+} // namespace knight
@@ -0,0 +1,160 @@
+//===- summary_cache.hpp ----------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the on-disk cache of the function summaries and
+//  diagnostics.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "dfa/summary.hpp"
+#include "tooling/diagnostic.hpp"
+
+#include <clang/AST/Decl.h>
+#include <clang/Basic/SourceManager.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace knight {
+
+/// \brief A diagnostic of a cached function, located by the offsets from
+/// the beginning of the function, so that it stays valid when the
+/// function moves in its file.
+struct CachedDiagnostic {
+    struct Range {
+        uint32_t begin;
+        uint32_t end;
+        bool is_token_range;
+    }; // struct Range
+
+    std::string checker;
+    clang::DiagnosticsEngine::Level level;
+    std::string format;
+    std::string message;
+    uint32_t offset;
+    std::vector< Range > ranges;
+}; // struct CachedDiagnostic
+
+/// \brief The results of analyzing a function, stored in the cache.
+struct CachedFunction {
+    dfa::FunctionSummary summary;
+    std::vector< CachedDiagnostic > diagnostics;
+}; // struct CachedFunction
+
+/// \brief Get a stable hash of the declaration and body of the function.
+///
+/// The instantiated members of a class template share the ODR hash of
+/// their pattern, hence the hash also covers the qualified name with the
+/// template arguments and the type of the function.
+///
+/// The ODR hash ignores the source locations, hence the hash also covers
+/// the source text of the function, by which the offsets of the cached
+/// diagnostics stay valid.
+[[nodiscard]] uint64_t get_function_content_hash(
+    const clang::FunctionDecl* function);
+
+/// \brief An append-only store of the analyzed functions of a translation
+/// unit, memory-mapped when opened.
+///
+/// A function is keyed by a stable hash of its content hash, the hash of the
+/// analysis configuration, and the summaries of its callees, so that a
+/// later run may skip the fixpoint of the functions which still hit the
+/// cache and replay their diagnostics. Later records of a key override
+/// the former ones. The store is rewritten from scratch if it is not
+/// readable.
+class SummaryCache {
+  public:
+    using Key = uint64_t;
+
+    static constexpr uint32_t Magic = 0x43534e4bU; // "KNSC"
+    static constexpr uint32_t Version = 3U;
+
+  private:
+    std::unique_ptr< llvm::MemoryBuffer > m_buffer;
+
+    /// \brief The offsets of the records of the buffer, by key.
+    llvm::DenseMap< Key, uint64_t > m_index;
+
+    std::mutex m_out_mutex;
+    std::unique_ptr< llvm::raw_fd_ostream > m_out;
+
+  public:
+    SummaryCache(const SummaryCache&) = delete;
+    SummaryCache& operator=(const SummaryCache&) = delete;
+    ~SummaryCache();
+
+    /// \brief Open the store at the given path, creating it if needed.
+    ///
+    /// \return the store, or null if it cannot be written.
+    [[nodiscard]] static std::unique_ptr< SummaryCache > open(
+        llvm::StringRef path);
+
+    /// \brief Get the path of the store of the given main file in the
+    /// cache directory.
+    [[nodiscard]] static std::string get_store_path(llvm::StringRef dir,
+                                                    llvm::StringRef file);
+
+  public:
+    [[nodiscard]] std::optional< CachedFunction > lookup(Key key) const;
+
+    /// \brief Append the function to the store, seen by the later runs.
+    void insert(Key key, const CachedFunction& function);
+
+  public:
+    /// \brief Compute the key of the function.
+    ///
+    /// \param config_hash The hash of the enabled analyses, checkers and
+    /// domains and of the options changing their results.
+    /// \param summaries The summaries of the callees, if interprocedural.
+    /// \param inline_depth The depth up to which the bodies of the callees
+    /// are hashed, since they are analyzed when inlined.
+    [[nodiscard]] static Key compute_key(
+        const clang::FunctionDecl* function,
+        uint64_t config_hash,
+        const dfa::SummaryTable* summaries,
+        unsigned inline_depth);
+
+    /// \brief Check if the results of the function may be cached, which
+    /// requires it to be located in a file.
+    [[nodiscard]] static bool is_cacheable(const clang::Decl* function);
+
+    /// \brief Capture the summary and the buffered diagnostics of the
+    /// function, if all of them are located in the function and have no
+    /// fix-it.
+    [[nodiscard]] static std::optional< CachedFunction > capture(
+        const clang::Decl* function,
+        const dfa::FunctionSummary& summary,
+        const KnightDiagnosticBuffer& buffer,
+        const clang::SourceManager& source_mgr);
+
+    /// \brief Add the cached diagnostics of the function to the buffer.
+    static void replay(const clang::Decl* function,
+                       const CachedFunction& cached,
+                       KnightDiagnosticBuffer& buffer,
+                       const clang::SourceManager& source_mgr);
+
+  private:
+    SummaryCache() = default;
+
+    /// \brief Index the records of the buffer.
+    ///
+    /// \return false if the buffer is not a valid store.
+    [[nodiscard]] bool load_index();
+}; // class SummaryCache
+
+} // namespace knight
@@ -0,0 +1,93 @@
+//===- binary.hpp -----------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the writers of the little-endian binary formats.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace knight {
+
+inline void write_u8(llvm::raw_ostream& os, uint8_t value) {
+    os.write(static_cast< char >(value));
+}
+
+inline void write_u32(llvm::raw_ostream& os, uint32_t value) {
+    char buf[sizeof(value)]; // NOLINT
+    llvm::support::endian::write32le(buf, value);
+    os.write(buf, sizeof(buf));
+}
+
+inline void write_u64(llvm::raw_ostream& os, uint64_t value) {
+    char buf[sizeof(value)]; // NOLINT
+    llvm::support::endian::write64le(buf, value);
+    os.write(buf, sizeof(buf));
+}
+
+/// \brief Write the string prefixed by its 32-bit length.
+inline void write_str(llvm::raw_ostream& os, llvm::StringRef str) {
+    write_u32(os, static_cast< uint32_t >(str.size()));
+    os << str;
+}
+
+/// \brief Reads little-endian values from a buffer, failing instead of
+/// reading past its end.
+class BinaryReader {
+  private:
+    llvm::StringRef m_data;
+    bool m_failed = false;
+
+  public:
+    explicit BinaryReader(llvm::StringRef data) : m_data(data) {}
+
+  public:
+    [[nodiscard]] bool failed() const { return m_failed; }
+
+    /// \brief Check if all the buffer is read.
+    [[nodiscard]] bool at_end() const { return m_data.empty(); }
+
+    uint8_t read_u8() {
+        auto bytes = read_bytes(sizeof(uint8_t));
+        return bytes.empty() ? 0U : static_cast< uint8_t >(bytes[0]);
+    }
+
+    uint32_t read_u32() {
+        auto bytes = read_bytes(sizeof(uint32_t));
+        return bytes.empty() ? 0U
+                             : llvm::support::endian::read32le(bytes.data());
+    }
+
+    uint64_t read_u64() {
+        auto bytes = read_bytes(sizeof(uint64_t));
+        return bytes.empty() ? 0U
+                             : llvm::support::endian::read64le(bytes.data());
+    }
+
+    llvm::StringRef read_str() { return read_bytes(read_u32()); }
+
+    llvm::StringRef read_bytes(std::size_t size) {
+        if (m_failed || m_data.size() < size) {
+            m_failed = true;
+            return {};
+        }
+        auto bytes = m_data.take_front(size);
+        m_data = m_data.drop_front(size);
+        return bytes;
+    }
+}; // class BinaryReader
+
+} // namespace knight
@@ -0,0 +1,135 @@
+//===- caching_vfs.hpp ------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the file system caching the status and contents
+//  of the files for all the translation units.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/ErrorOr.h>
+#include <llvm/Support/ExtensibleRTTI.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/VirtualFileSystem.h>
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <system_error>
+
+namespace knight::fs {
+
+/// \brief The status and contents of the files, by absolute path, shared
+/// by the caching file systems of all the threads.
+///
+/// The missing files are cached too, since most lookups of the header
+/// search miss. The cache is split into shards by the hash of the path,
+/// each with its own lock, and the contents stay alive as long as a file
+/// opened from them.
+class FileSystemCache {
+  public:
+    static constexpr unsigned NumShards = 64U;
+
+    struct Entry {
+        /// \brief The status, or the error of the status, of the file.
+        /// @{
+        std::optional< llvm::vfs::Status > status;
+        std::error_code error;
+        /// @}
+
+        /// \brief The contents of the file, or null if not read yet.
+        std::shared_ptr< const llvm::MemoryBuffer > contents;
+    }; // struct Entry
+
+  private:
+    struct alignas(64) Shard { // NOLINT
+        std::mutex mutex;
+        llvm::StringMap< Entry > entries;
+    }; // struct Shard
+
+    std::array< Shard, NumShards > m_shards;
+
+  public:
+    FileSystemCache() = default;
+    FileSystemCache(const FileSystemCache&) = delete;
+    FileSystemCache& operator=(const FileSystemCache&) = delete;
+
+  public:
+    /// \brief Get the cached entry of the absolute path, if any.
+    [[nodiscard]] std::optional< Entry > lookup(llvm::StringRef path);
+
+    /// \brief Cache the status of the absolute path, unless another
+    /// thread did first.
+    ///
+    /// \return the cached entry.
+    Entry insert_status(llvm::StringRef path,
+                        const llvm::ErrorOr< llvm::vfs::Status >& status);
+
+    /// \brief Cache the contents of the absolute path, unless another
+    /// thread did first, along with their status.
+    ///
+    /// \return the cached entry.
+    Entry insert_contents(
+        llvm::StringRef path,
+        const llvm::vfs::Status& status,
+        std::shared_ptr< const llvm::MemoryBuffer > contents);
+
+    /// \brief Forget the absolute path, e.g. when the client of the
+    /// server edited it.
+    void invalidate(llvm::StringRef path);
+
+    /// \brief Forget the files whose status changed on the disk and the
+    /// missing ones, which may have been created.
+    ///
+    /// \return the number of forgotten files.
+    unsigned invalidate_changed();
+
+  private:
+    [[nodiscard]] Shard& get_shard(llvm::StringRef path);
+}; // class FileSystemCache
+
+/// \brief A file system memoizing the status and the contents of the
+/// files of the underlying one in a shared cache, so that the headers
+/// included by many translation units are stat'ed and read once.
+///
+/// The relative paths are made absolute with the working directory of
+/// the underlying file system, hence each thread may have its own caching
+/// file system sharing the cache. Only the status and the opened files
+/// are cached, the other operations are forwarded.
+class CachingFileSystem
+    : public llvm::RTTIExtends< CachingFileSystem,
+                                llvm::vfs::ProxyFileSystem > {
+  public:
+    static const char ID; // NOLINT
+
+  private:
+    std::shared_ptr< FileSystemCache > m_cache;
+
+  public:
+    CachingFileSystem(llvm::IntrusiveRefCntPtr< llvm::vfs::FileSystem > fs,
+                      std::shared_ptr< FileSystemCache > cache)
+        : RTTIExtends(std::move(fs)), m_cache(std::move(cache)) {}
+
+  public:
+    llvm::ErrorOr< llvm::vfs::Status > status(
+        const llvm::Twine& path) override;
+
+    llvm::ErrorOr< std::unique_ptr< llvm::vfs::File > > openFileForRead(
+        const llvm::Twine& path) override;
+
+    [[nodiscard]] const std::shared_ptr< FileSystemCache >& get_cache() const {
+        return m_cache;
+    }
+}; // class CachingFileSystem
+
+} // namespace knight::fs
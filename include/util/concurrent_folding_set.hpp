@@ -0,0 +1,78 @@
+//===- concurrent_folding_set.hpp -------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the folding set shared by threads.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <llvm/ADT/FoldingSet.h>
+#include <llvm/Support/Allocator.h>
+
+#include <array>
+#include <bit>
+#include <mutex>
+
+namespace knight {
+
+/// \brief A folding set uniquing the nodes of several threads, split into
+/// shards by the hash of the profiles.
+///
+/// Each shard has its own lock and bump allocator, so that the threads
+/// only contend when they intern nodes of the same shard, and a node
+/// lives as long as the set.
+template < typename T, unsigned NumShards = 64U >
+class ConcurrentFoldingSet {
+    static_assert(NumShards > 1U && std::has_single_bit(NumShards),
+                  "the number of shards must be a power of two");
+
+  private:
+    /// \brief The shards are apart in the cache lines, so that the locks
+    /// of the neighbouring shards do not share a line.
+    struct alignas(64) Shard { // NOLINT
+        std::mutex mutex;
+        llvm::FoldingSet< T > set;
+        llvm::BumpPtrAllocator allocator;
+    }; // struct Shard
+
+    /// \brief The shard is picked by the high bits of the hash, as the
+    /// shard sets bucket the nodes by the low bits.
+    static constexpr unsigned ShardShift =
+        32U - static_cast< unsigned >(std::countr_zero(NumShards));
+
+    std::array< Shard, NumShards > m_shards;
+
+  public:
+    ConcurrentFoldingSet() = default;
+    ConcurrentFoldingSet(const ConcurrentFoldingSet&) = delete;
+    ConcurrentFoldingSet& operator=(const ConcurrentFoldingSet&) = delete;
+
+  public:
+    /// \brief Get the node of the profile, creating it by `create` from
+    /// the allocator of its shard if absent.
+    ///
+    /// The shard is locked while creating the node, hence `create` shall
+    /// not intern into the same set.
+    template < typename Create >
+    T* get_or_insert(const llvm::FoldingSetNodeID& id, Create create) {
+        auto& shard = m_shards[static_cast< unsigned >(id.ComputeHash()) >>
+                               ShardShift];
+        const std::lock_guard< std::mutex > lock(shard.mutex);
+        void* insert_pos; // NOLINT
+        T* node = shard.set.FindNodeOrInsertPos(id, insert_pos);
+        if (node == nullptr) {
+            node = create(shard.allocator);
+            shard.set.InsertNode(node, insert_pos);
+        }
+        return node;
+    }
+}; // class ConcurrentFoldingSet
+
+} // namespace knight
@@ -17,6 +17,8 @@
 #include <llvm/ADT/StringRef.h>
 #include <llvm/Support/Regex.h>
 
+#include <cstdint>
+#include <string>
 #include <vector>
 
 namespace knight {
@@ -27,13 +29,23 @@ constexpr unsigned GlobAlign = 32;
 /// strings against globs.
 ///
 /// negative glob starts with '-'
+///
+/// The globs without '*' and the ones with a trailing '*' only are
+/// compared as strings, the others are compiled to regexes.
 class Globs {
   public:
+    enum class GlobKind : uint8_t { Exact, Prefix, Regex };
+
     struct Glob {
         bool is_negative;
+        GlobKind kind;
+        /// \brief The exact string or the prefix.
+        std::string text;
+        /// \brief The regex of the `Regex` kind.
         llvm::Regex regex;
-    } __attribute__((aligned(GlobAlign)))
-    __attribute__((packed)); // struct Glob
+
+        [[nodiscard]] bool matches(llvm::StringRef str) const;
+    } __attribute__((aligned(GlobAlign))); // struct Glob
 
   private:
     std::vector< Glob > m_globs;
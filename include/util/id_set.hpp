@@ -0,0 +1,118 @@
+//===- id_set.hpp -----------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the set of small dense IDs.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "util/assert.hpp"
+
+#include <bitset>
+#include <cstddef>
+#include <iterator>
+
+namespace knight {
+
+/// \brief A set of the IDs below N as a bitset, e.g. of the analyses,
+/// checkers and domains defined in the `.def` files.
+///
+/// The IDs are iterated in ascending order.
+template < typename ID, std::size_t N >
+class IDSet {
+  private:
+    std::bitset< N > m_bits;
+
+  public:
+    class Iterator {
+      private:
+        const std::bitset< N >* m_bits;
+        std::size_t m_pos;
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ID;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const ID*;
+        using reference = ID;
+
+        Iterator(const std::bitset< N >* bits, std::size_t pos)
+            : m_bits(bits), m_pos(pos) {
+            skip_unset();
+        }
+
+        ID operator*() const { return static_cast< ID >(m_pos); }
+
+        Iterator& operator++() {
+            ++m_pos;
+            skip_unset();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            auto res = *this;
+            ++*this;
+            return res;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return m_pos == other.m_pos;
+        }
+        bool operator!=(const Iterator& other) const {
+            return m_pos != other.m_pos;
+        }
+
+      private:
+        void skip_unset() {
+            while (m_pos < N && !m_bits->test(m_pos)) {
+                ++m_pos;
+            }
+        }
+    }; // class Iterator
+
+  public:
+    /// \brief Insert the ID.
+    ///
+    /// \return true if the ID is inserted, false if already present.
+    bool insert(ID id) {
+        const auto pos = static_cast< std::size_t >(id);
+        knight_assert_msg(pos < N, "ID out of range");
+        const bool inserted = !m_bits.test(pos);
+        m_bits.set(pos);
+        return inserted;
+    }
+
+    void erase(ID id) { m_bits.reset(static_cast< std::size_t >(id)); }
+
+    void clear() { m_bits.reset(); }
+
+    [[nodiscard]] bool contains(ID id) const {
+        const auto pos = static_cast< std::size_t >(id);
+        return pos < N && m_bits.test(pos);
+    }
+
+    [[nodiscard]] bool empty() const { return m_bits.none(); }
+
+    [[nodiscard]] std::size_t size() const { return m_bits.count(); }
+
+    [[nodiscard]] Iterator begin() const { return Iterator(&m_bits, 0U); }
+    [[nodiscard]] Iterator end() const { return Iterator(&m_bits, N); }
+
+    IDSet& operator|=(const IDSet& other) {
+        m_bits |= other.m_bits;
+        return *this;
+    }
+
+    bool operator==(const IDSet& other) const {
+        return m_bits == other.m_bits;
+    }
+}; // class IDSet
+
+} // namespace knight
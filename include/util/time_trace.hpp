@@ -0,0 +1,68 @@
+//===- time_trace.hpp -------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the utilities of the chrome trace output.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/TimeProfiler.h>
+
+#include <atomic>
+
+namespace knight {
+
+/// \brief The process-wide switch of the `-ftime-trace` style output,
+/// built on the time trace profiler of LLVM.
+///
+/// Spans are recorded by `llvm::TimeTraceScope` on the threads which
+/// are traced, see `TimeTraceThread`.
+class TimeTrace {
+  private:
+    static inline std::atomic< bool > s_enabled{false};
+    static inline std::atomic< unsigned > s_granularity{0U};
+
+  public:
+    /// \brief Start tracing the current thread and all the later
+    /// `TimeTraceThread`s. Spans shorter than the granularity in
+    /// microseconds are dropped.
+    static void enable(unsigned granularity);
+
+    [[nodiscard]] static bool is_enabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] static unsigned get_granularity() {
+        return s_granularity.load(std::memory_order_relaxed);
+    }
+
+    /// \brief Write the trace of all the threads to the given file, once
+    /// all the traced threads are finished.
+    ///
+    /// \return false if the file cannot be written.
+    static bool write(llvm::StringRef path);
+}; // class TimeTrace
+
+/// \brief Trace the current thread during the lifetime of the object, so
+/// that pool threads get their own timeline in the trace.
+class TimeTraceThread {
+  private:
+    bool m_traced = false;
+
+  public:
+    TimeTraceThread();
+    TimeTraceThread(const TimeTraceThread&) = delete;
+    TimeTraceThread& operator=(const TimeTraceThread&) = delete;
+    TimeTraceThread(TimeTraceThread&&) = delete;
+    TimeTraceThread& operator=(TimeTraceThread&&) = delete;
+    ~TimeTraceThread();
+}; // class TimeTraceThread
+
+} // namespace knight
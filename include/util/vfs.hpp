@@ -13,21 +13,72 @@
 
 #pragma once
 
+#include "util/caching_vfs.hpp"
+
 #include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/Support/ExtensibleRTTI.h>
 #include <llvm/Support/VirtualFileSystem.h>
 
+#include <string>
+
 namespace knight::fs {
 
 using FileSystemRef = llvm::IntrusiveRefCntPtr< llvm::vfs::FileSystem >;
 using OverlayFileSystemRef =
     llvm::IntrusiveRefCntPtr< llvm::vfs::OverlayFileSystem >;
 
+/// \brief A VFS overlay parsed from a YAML file, which keeps the YAML to
+/// be parsed again on top of another file system.
+///
+/// The redirecting file systems have their own working directories, hence
+/// they are not shared by the isolated VFSs.
+class YAMLOverlayFileSystem
+    : public llvm::RTTIExtends< YAMLOverlayFileSystem,
+                                llvm::vfs::ProxyFileSystem > {
+  public:
+    static const char ID; // NOLINT
+
+  private:
+    std::string m_yaml_file;
+    std::string m_yaml;
+
+  public:
+    YAMLOverlayFileSystem(FileSystemRef fs,
+                          std::string yaml_file,
+                          std::string yaml)
+        : RTTIExtends(std::move(fs)),
+          m_yaml_file(std::move(yaml_file)),
+          m_yaml(std::move(yaml)) {}
+
+  public:
+    /// \brief Parse the YAML again, redirecting to the external file
+    /// system.
+    ///
+    /// \return null if the YAML is invalid.
+    [[nodiscard]] FileSystemRef rebuild(FileSystemRef external_fs) const;
+}; // class YAMLOverlayFileSystem
+
 /// \brief Create a new VFS overlay from a YAML file.
 FileSystemRef get_vfs_from_yaml(const std::string& overlay_yaml_file,
                                 const FileSystemRef& base_fs);
 
 /// \brief Create a base VFS from RFS.
-OverlayFileSystemRef create_base_vfs();
+///
+/// \param caching whether the RFS is wrapped in a caching file system,
+/// whose cache is shared by the isolated VFSs of the base VFS.
+OverlayFileSystemRef create_base_vfs(bool caching = false);
+
+/// \brief Create a VFS with the overlays of the base VFS on top of its own
+/// physical file system, so that changing its working directory does not
+/// change the one of the process or of another isolated VFS.
+///
+/// The YAML overlays are parsed again on top of the physical file system,
+/// the other overlays are shared.
+OverlayFileSystemRef create_isolated_vfs(const OverlayFileSystemRef& base_fs);
+
+/// \brief Get the file system cache of the base VFS, or null if it does
+/// not cache.
+FileSystemCache* get_file_system_cache(const OverlayFileSystemRef& base_fs);
 
 /// \brief Make path an absolute path.
 ///
@@ -17,10 +17,15 @@
 #include "support/graph.hpp"
 #include "util/assert.hpp"
 
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/Support/raw_ostream.h>
 
+#include <algorithm>
 #include <climits>
-#include <list>
+#include <deque>
+#include <optional>
+#include <vector>
 
 namespace knight {
 
@@ -36,19 +41,21 @@ class WtoComponentVisitor;
 /// \brief Represents the nesting of a node
 ///
 /// The nesting of a node is the list of cycles containing the node, from
-/// the outermost to the innermost.
+/// the outermost to the innermost. It is a view on the flat nesting array
+/// of the owning weak topological order.
 template < graph G, typename GraphTrait = GraphTrait< G > >
 class WtoNesting {
   public:
     using NodeRef = typename GraphTrait::NodeRef;
-    using Nodes = std::vector< NodeRef >;
-    using NodesIterator = typename Nodes::const_iterator;
+    using Nodes = llvm::ArrayRef< NodeRef >;
+    using NodesIterator = typename Nodes::iterator;
 
   private:
     Nodes m_nodes;
 
   public:
     WtoNesting() = default;
+    explicit WtoNesting(Nodes nodes) : m_nodes(nodes) {}
     WtoNesting(const WtoNesting&) = default;
     WtoNesting(WtoNesting&&) = default;
     WtoNesting& operator=(const WtoNesting&) = default;
@@ -56,28 +63,27 @@ class WtoNesting {
     ~WtoNesting() = default;
 
   public:
-    /// \brief Add a cycle head in the nesting
-    void add(NodeRef head) { this->m_nodes.push_back(head); }
-
     /// \brief iterator over the head of cycles
     /// @{
-    NodesIterator begin() const { return this->m_nodes.cbegin(); }
-    NodesIterator end() const { return this->m_nodes.cend(); }
+    NodesIterator begin() const { return this->m_nodes.begin(); }
+    NodesIterator end() const { return this->m_nodes.end(); }
     /// @}
 
+    /// \brief Check if the nesting is out of any cycle
+    [[nodiscard]] bool empty() const { return this->m_nodes.empty(); }
+
     /// \brief Return the common prefix of the given nestings
     WtoNesting get_common_prefix(const WtoNesting& other) const {
-        WtoNesting res;
+        std::size_t size = 0U;
         for (auto it = this->begin(), other_it = other.begin();
              it != this->end() && other_it != other.end();
              ++it, ++other_it) {
-            if (*it == *other_it) {
-                res.add(*it);
-            } else {
+            if (*it != *other_it) {
                 break;
             }
+            ++size;
         }
-        return res;
+        return WtoNesting(this->m_nodes.take_front(size));
     }
 
     void dump(llvm::raw_ostream& os) const {
@@ -103,7 +109,7 @@ class WtoNesting {
         return this->compare(other) == 0;
     }
     bool operator>=(const WtoNesting& other) const {
-        return this->operator<=(other, *this);
+        return other.operator<=(*this);
     }
     bool operator>(const WtoNesting& other) const {
         return this->compare(other) == 1;
@@ -117,7 +123,8 @@ class WtoNesting {
     /// \return 1 if `other` is nested within `this`
     /// \return other if they are not comparable
     int compare(const WtoNesting& other) const {
-        if (this == &other) {
+        if (this->m_nodes.data() == other.m_nodes.data() &&
+            this->m_nodes.size() == other.m_nodes.size()) {
             return 0; // equals
         }
 
@@ -192,14 +199,13 @@ class WtoCycle final : public WtoComponent< G, GraphTrait > {
   public:
     using NodeRef = typename GraphTrait::NodeRef;
     using WtoComponentT = WtoComponent< G, GraphTrait >;
-    using WtoComponentPtr = std::unique_ptr< WtoComponentT >;
-    using WtoComponentList = std::list< WtoComponentPtr >;
+    using WtoComponentList = std::vector< const WtoComponentT* >;
 
   private:
     /// \brief Head of the cycle
     NodeRef m_head;
 
-    /// \brief List of components
+    /// \brief Components of the cycle, owned by the weak topological order
     WtoComponentList m_components;
 
   public:
@@ -209,13 +215,7 @@ class WtoCycle final : public WtoComponent< G, GraphTrait > {
     /// \brief Return the head of the cycle
     NodeRef get_head() const { return this->m_head; }
 
-    std::list< WtoComponentT* > components() const {
-        std::list< WtoComponentT* > res;
-        for (const auto& c : this->m_components) {
-            res.push_back(c.get());
-        }
-        return res;
-    }
+    const WtoComponentList& components() const { return this->m_components; }
 
     /// \brief Accept the given visitor
     void accept(WtoComponentVisitor< G, GraphTrait >& v) const override {
@@ -226,7 +226,7 @@ class WtoCycle final : public WtoComponent< G, GraphTrait > {
     void dump(std::ostream& o) const {
         o << "(";
         DumpableTrait< NodeRef >::dump(o, this->m_head);
-        for (const auto& c : this->m_components) {
+        for (const auto* c : this->m_components) {
             o << " ";
             c->dump(o);
         }
@@ -259,6 +259,11 @@ class WtoComponentVisitor {
 }; // class WtoComponentVisitor
 
 /// \brief Weak Topological Ordering
+///
+/// The order is computed once per graph and kept in a compact form: nodes
+/// are renumbered to dense indices, the components are stored in stable
+/// pools and referenced by pointer, and the nestings are ranges of a flat
+/// array of cycle heads.
 template < graph G, typename GraphTrait = GraphTrait< G > >
 class Wto {
   public:
@@ -270,30 +275,86 @@ class Wto {
     using WtoCycleT = WtoCycle< G, GraphTrait >;
 
   private:
-    using WtoComponentPtr = std::unique_ptr< WtoComponentT >;
-    using WtoComponentList = std::list< WtoComponentPtr >;
+    using WtoComponentList = std::vector< const WtoComponentT* >;
     using WtoComponentListConstIterator =
         typename WtoComponentList::const_iterator;
     using Dfn = int;
-    using DfnTable = std::unordered_map< NodeRef, Dfn >;
+    using NodeIndex = unsigned;
+    using IndexTable = llvm::DenseMap< NodeRef, NodeIndex >;
+    using DfnTable = std::vector< Dfn >;
     using Stack = std::vector< NodeRef >;
-    using WtoNestingPtr = std::shared_ptr< WtoNestingT >;
-    using NestingTable = std::unordered_map< NodeRef, WtoNestingPtr >;
+    using SuccNodeIterator = typename GraphTrait::SuccNodeIterator;
+
+    /// \brief Kind of the frames of the construction
+    ///
+    /// - `Visit`: visiting the successors of a node.
+    /// - `VisitReturn`: waiting for the cycle component of a visited head.
+    /// - `Component`: visiting the successors of a cycle head.
+    enum class FrameKind { Visit, VisitReturn, Component };
+
+    /// \brief Frame of the construction, standing for a call of the
+    /// recursive algorithm
+    struct Frame {
+        NodeRef vertex;
+        SuccNodeIterator succ_it;
+        SuccNodeIterator succ_end;
+        Dfn head;
+        unsigned partition;
+        FrameKind kind;
+        bool loop;
+    }; // struct Frame
+
+    using Frames = std::vector< Frame >;
+    using Partitions = std::vector< WtoComponentList >;
+
+    /// \brief Range of a nesting in the flat nesting array
+    struct NestingRange {
+        unsigned offset = 0U;
+        unsigned size = 0U;
+    }; // struct NestingRange
 
   private:
+    /// \brief Component pools, with stable addresses
+    /// @{
+    std::deque< WtoVertexT > m_vertices;
+    std::deque< WtoCycleT > m_cycles;
+    /// @}
+
+    /// \brief Top level components
     WtoComponentList m_components;
-    NestingTable m_nesting_table;
+
+    /// \brief Dense indices of the nodes, unless the graph is indexed
+    IndexTable m_index_table;
+
+    /// \brief Flat array of the cycle heads of all nestings
+    std::vector< NodeRef > m_nesting_heads;
+
+    /// \brief Nesting of each node, indexed by the node index
+    std::vector< NestingRange > m_nesting_table;
+
+    /// \brief Construction state
+    ///
+    /// The DFN table is preallocated for indexed graphs.
+    /// @{
     DfnTable m_dfn_table;
     Dfn m_num{0};
     Stack m_stack;
+    Frames m_frames;
+    Partitions m_partitions;
+    /// @}
 
   public:
     /// \brief Compute the weak topological order of the given graph
     explicit Wto(GraphRef cfg) {
-        this->visit(GraphTrait::entry(cfg), this->m_components);
-        this->m_dfn_table.clear();
-        this->m_stack.clear();
+        if constexpr (indexed_graph_trait< GraphTrait >) {
+            this->m_dfn_table.assign(GraphTrait::num_nodes(cfg), 0);
+        }
+        this->build(GraphTrait::entry(cfg));
         this->build_nesting();
+        DfnTable().swap(this->m_dfn_table);
+        Stack().swap(this->m_stack);
+        Frames().swap(this->m_frames);
+        Partitions().swap(this->m_partitions);
     }
 
     Wto(const Wto& other) = delete;
@@ -306,51 +367,84 @@ class Wto {
     /// \brief Visitor to build the nestings of each node
     class NestingBuilder final : public WtoComponentVisitor< G, GraphTrait > {
       private:
-        WtoNestingPtr m_nesting;
-        NestingTable& m_nesting_table;
+        Wto& m_wto;
+        NestingRange m_nesting;
 
       public:
-        explicit NestingBuilder(NestingTable& nesting_table)
-            : m_nesting(std::make_shared< WtoNestingT >()),
-              m_nesting_table(nesting_table) {}
+        explicit NestingBuilder(Wto& wto) : m_wto(wto) {}
 
         void visit(const WtoCycleT& cycle) override {
             NodeRef head = cycle.get_head();
-            WtoNestingPtr previous_nesting = this->m_nesting;
-            this->m_nesting_table.insert(std::make_pair(head, this->m_nesting));
-            this->m_nesting = std::make_shared< WtoNestingT >(*this->m_nesting);
-            this->m_nesting->add(head);
-            for (auto* component : cycle.components()) {
+            NestingRange previous_nesting = this->m_nesting;
+            this->m_wto.set_nesting(head, this->m_nesting);
+
+            auto& heads = this->m_wto.m_nesting_heads;
+            NestingRange nesting{static_cast< unsigned >(heads.size()),
+                                 previous_nesting.size + 1U};
+            for (unsigned i = 0U; i < previous_nesting.size; ++i) {
+                NodeRef outer_head = heads[previous_nesting.offset + i];
+                heads.push_back(outer_head);
+            }
+            heads.push_back(head);
+
+            this->m_nesting = nesting;
+            for (const auto* component : cycle.components()) {
                 component->accept(*this);
             }
             this->m_nesting = previous_nesting;
         }
 
         void visit(const WtoVertexT& vertex) override {
-            this->m_nesting_table.insert(
-                std::make_pair(vertex.get_node(), this->m_nesting));
+            this->m_wto.set_nesting(vertex.get_node(), this->m_nesting);
         }
 
     }; // end class NestingBuilder
 
   private:
+    /// \brief Return the dense index of the given node, or null if the
+    /// node is not in the order
+    std::optional< NodeIndex > index(NodeRef n) const {
+        if constexpr (indexed_graph_trait< GraphTrait >) {
+            return GraphTrait::index(n);
+        } else {
+            auto it = this->m_index_table.find(n);
+            if (it != this->m_index_table.end()) {
+                return it->second;
+            }
+            return std::nullopt;
+        }
+    }
+
     /// \brief Return the depth-first number of the given node
     Dfn dfn(NodeRef n) const {
-        auto it = this->m_dfn_table.find(n);
-        if (it != this->m_dfn_table.end()) {
-            return it->second;
+        if (auto idx = this->index(n)) {
+            return this->m_dfn_table[*idx];
         }
         return 0;
     }
 
     /// \brief Set the depth-first number of the given node
     void set_dfn(NodeRef n, const Dfn& dfn) {
-        auto res = this->m_dfn_table.insert(std::make_pair(n, dfn));
-        if (!res.second) {
-            (res.first)->second = dfn;
+        if constexpr (indexed_graph_trait< GraphTrait >) {
+            this->m_dfn_table[GraphTrait::index(n)] = dfn;
+        } else {
+            auto [it, inserted] =
+                this->m_index_table.try_emplace(n, this->m_dfn_table.size());
+            if (inserted) {
+                this->m_dfn_table.push_back(dfn);
+            } else {
+                this->m_dfn_table[it->second] = dfn;
+            }
         }
     }
 
+    /// \brief Set the nesting of the given node
+    void set_nesting(NodeRef n, NestingRange nesting) {
+        auto idx = this->index(n);
+        knight_assert_msg(idx.has_value(), "node not found");
+        this->m_nesting_table[*idx] = nesting;
+    }
+
     /// \brief Pop a node from the stack
     NodeRef pop() {
         knight_assert_msg(!this->m_stack.empty(), "empty stack");
@@ -362,84 +456,151 @@ class Wto {
     /// \brief Push a node on the stack
     void push(NodeRef n) { this->m_stack.push_back(n); }
 
-    /// \brief Create the cycle component for the given vertex
-    WtoComponentPtr component(NodeRef vertex) {
-        WtoComponentList partition;
-        for (auto it = GraphTrait::succ_begin(vertex),
-                  et = GraphTrait::succ_end(vertex);
-             it != et;
-             ++it) {
-            NodeRef succ = *it;
-            if (this->dfn(succ) == 0) {
-                this->visit(succ, partition);
-            }
+    /// \brief Start visiting the given node, into the given partition
+    void start_visit(NodeRef vertex, unsigned partition) {
+        this->push(vertex);
+        this->m_num += 1;
+        this->set_dfn(vertex, this->m_num);
+        this->m_frames.push_back(Frame{vertex,
+                                       GraphTrait::succ_begin(vertex),
+                                       GraphTrait::succ_end(vertex),
+                                       this->m_num,
+                                       partition,
+                                       FrameKind::Visit,
+                                       false});
+    }
+
+    /// \brief Start building the cycle component of the given head, into
+    /// the partition of the visit of the head
+    void start_component(NodeRef head, unsigned partition) {
+        this->m_partitions.emplace_back();
+        this->m_frames.push_back(Frame{head,
+                                       GraphTrait::succ_begin(head),
+                                       GraphTrait::succ_end(head),
+                                       0,
+                                       partition,
+                                       FrameKind::Component,
+                                       false});
+    }
+
+    /// \brief Finish the visit on the top of the frame stack
+    ///
+    /// \return true if the visit returns its head to the parent visit,
+    /// false if it waits for the component of its cycle.
+    bool finish_visit(Frame& frame) {
+        if (frame.kind == FrameKind::VisitReturn ||
+            frame.head != this->dfn(frame.vertex)) {
+            return true;
+        }
+
+        this->set_dfn(frame.vertex, INT_MAX);
+        NodeRef element = this->pop();
+        if (!frame.loop) {
+            this->m_partitions[frame.partition].push_back(
+                &this->m_vertices.emplace_back(frame.vertex));
+            return true;
         }
-        return std::make_unique< WtoCycleT >(vertex, std::move(partition));
+        while (element != frame.vertex) {
+            this->set_dfn(element, 0);
+            element = this->pop();
+        }
+        frame.kind = FrameKind::VisitReturn;
+        this->start_component(frame.vertex, frame.partition);
+        return false;
+    }
+
+    /// \brief Finish the component on the top of the frame stack
+    void finish_component(const Frame& frame) {
+        WtoComponentList partition = std::move(this->m_partitions.back());
+        this->m_partitions.pop_back();
+        std::reverse(partition.begin(), partition.end());
+        this->m_partitions[frame.partition].push_back(
+            &this->m_cycles.emplace_back(frame.vertex, std::move(partition)));
     }
 
-    /// \brief Visit the given node
+    /// \brief Build the weak topological order from the given entry
     ///
-    /// Algorithm to build a weak topological order of a graph
-    Dfn visit(NodeRef vertex, WtoComponentList& partition) {
-        Dfn head(0);
-        Dfn min(0);
+    /// Bourdoncle's recursive algorithm, run on an explicit stack of
+    /// frames so that the depth of the graph does not bound the native
+    /// stack. The components are appended to the partitions in reverse
+    /// order.
+    void build(NodeRef entry) {
+        this->m_partitions.emplace_back();
+        this->start_visit(entry, 0U);
+        while (!this->m_frames.empty()) {
+            Frame& frame = this->m_frames.back();
+            if (frame.succ_it != frame.succ_end) {
+                NodeRef succ = *frame.succ_it;
+                ++frame.succ_it;
+                if (succ == nullptr) {
+                    continue;
+                }
+                Dfn succ_dfn = this->dfn(succ);
+                if (frame.kind == FrameKind::Component) {
+                    if (succ_dfn == 0) {
+                        this->start_visit(succ,
+                                          static_cast< unsigned >(
+                                              this->m_partitions.size() - 1U));
+                    }
+                } else if (succ_dfn == 0) {
+                    this->start_visit(succ, frame.partition);
+                } else if (succ_dfn <= frame.head) {
+                    frame.head = succ_dfn;
+                    frame.loop = true;
+                }
+                continue;
+            }
 
-        this->push(vertex);
-        this->m_num += 1;
-        head = this->m_num;
-        this->set_dfn(vertex, head);
-        bool loop = false;
-        for (auto it = GraphTrait::succ_begin(vertex),
-                  et = GraphTrait::succ_end(vertex);
-             it != et;
-             ++it) {
-            NodeRef succ = *it;
-            Dfn succ_dfn = this->dfn(succ);
-            if (succ_dfn == 0) {
-                min = this->visit(succ, partition);
-            } else {
-                min = succ_dfn;
+            if (frame.kind == FrameKind::Component) {
+                this->finish_component(frame);
+                this->m_frames.pop_back();
+                continue;
             }
-            if (min <= head) {
-                head = min;
-                loop = true;
+            if (!this->finish_visit(frame)) {
+                continue;
             }
-        }
-        if (head == this->dfn(vertex)) {
-            this->set_dfn(vertex, INT_MAX);
-            NodeRef element = this->pop();
-            if (loop) {
-                while (element != vertex) {
-                    this->set_dfn(element, 0);
-                    element = this->pop();
-                }
-                partition.push_front(this->component(vertex));
-            } else {
-                partition.push_front(std::make_unique< WtoVertexT >(vertex));
+
+            Dfn head = frame.head;
+            this->m_frames.pop_back();
+            if (this->m_frames.empty()) {
+                break;
+            }
+            Frame& parent = this->m_frames.back();
+            if (parent.kind == FrameKind::Visit && head <= parent.head) {
+                parent.head = head;
+                parent.loop = true;
             }
         }
-        return head;
+        this->m_components = std::move(this->m_partitions.front());
+        std::reverse(this->m_components.begin(), this->m_components.end());
     }
 
     /// \brief Build the nesting table
     void build_nesting() {
-        NestingBuilder builder(this->m_nesting_table);
-        for (auto& unique_component : m_components) {
-            unique_component.get()->accept(builder);
+        this->m_nesting_table.resize(this->m_dfn_table.size());
+        NestingBuilder builder(*this);
+        for (const auto* component : this->m_components) {
+            component->accept(builder);
         }
     }
 
   public:
     /// \brief Return the nesting of the given node
-    const WtoNestingT& get_nesting(NodeRef n) const {
-        auto it = this->m_nesting_table.find(n);
-        assert(it != this->m_nesting_table.end() && "node not found");
-        return *(it->second);
+    ///
+    /// Nodes unreachable from the entry are not nested in any cycle.
+    WtoNestingT get_nesting(NodeRef n) const {
+        auto idx = this->index(n);
+        if (!idx) {
+            return WtoNestingT();
+        }
+        const auto& nesting = this->m_nesting_table[*idx];
+        return WtoNestingT(llvm::ArrayRef< NodeRef >(this->m_nesting_heads)
+                               .slice(nesting.offset, nesting.size));
     }
 
     /// \brief Accept the given visitor
-    void accept(WtoComponentVisitor< G, GraphTrait >& v) {
-        for (const auto& c : this->m_components) {
+    void accept(WtoComponentVisitor< G, GraphTrait >& v) const {
+        for (const auto* c : this->m_components) {
             c->accept(v);
         }
     }
@@ -455,7 +616,7 @@ class Wto {
     /// \brief Dump the order, for debugging purpose
     void dump(llvm::raw_ostream& o) const {
         for (auto it = this->begin(), et = this->end(); it != et;) {
-            it->dump(o);
+            (*it)->dump(o);
             ++it;
             if (it != et) {
                 o << " ";
@@ -0,0 +1,245 @@
+//===- znum.hpp -------------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This header defines the arbitrary precision integers of the numerical
+//  domains.
+//
+//===------------------------------------------------------------------===//
+
+#pragma once
+
+#include "util/assert.hpp"
+
+#include <llvm/ADT/APInt.h>
+#include <llvm/ADT/FoldingSet.h>
+#include <llvm/ADT/Hashing.h>
+#include <llvm/Support/Compiler.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <compare>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+
+namespace knight {
+
+/// \brief An integer of unbounded precision.
+///
+/// The values fitting in 64 bits are stored inline and computed with the
+/// overflow checking builtins. Only the results overflowing 64 bits go to
+/// the slow path, which stores them in a heap allocated `llvm::APInt`.
+/// A value is big if and only if it does not fit in 64 bits, so that the
+/// fast path is a single well-predicted branch.
+class ZNum {
+  private:
+    int64_t m_small = 0;
+
+    /// \brief The value if it does not fit in 64 bits, null otherwise.
+    llvm::APInt* m_big = nullptr;
+
+  public:
+    ZNum() = default;
+
+    template < std::signed_integral T >
+    ZNum(T n) : m_small(n) {} // NOLINT(google-explicit-constructor)
+
+    template < std::unsigned_integral T >
+    ZNum(T n) { // NOLINT(google-explicit-constructor)
+        if (LLVM_LIKELY(n <= static_cast< uint64_t >(
+                                 std::numeric_limits< int64_t >::max()))) {
+            m_small = static_cast< int64_t >(n);
+        } else {
+            m_big = new llvm::APInt(64U + 1U, static_cast< uint64_t >(n));
+        }
+    }
+
+    /// \brief Make the number from a signed APInt of any width.
+    [[nodiscard]] static ZNum from_apint(const llvm::APInt& value);
+
+    ZNum(const ZNum& other)
+        : m_small(other.m_small),
+          m_big(other.m_big == nullptr ? nullptr
+                                       : new llvm::APInt(*other.m_big)) {}
+    ZNum(ZNum&& other) noexcept
+        : m_small(other.m_small), m_big(std::exchange(other.m_big, nullptr)) {}
+
+    ZNum& operator=(const ZNum& other) {
+        if (LLVM_LIKELY(other.m_big == nullptr)) {
+            delete m_big;
+            m_big = nullptr;
+            m_small = other.m_small;
+        } else if (this != &other) {
+            ZNum copy(other);
+            std::swap(m_small, copy.m_small);
+            std::swap(m_big, copy.m_big);
+        }
+        return *this;
+    }
+
+    ZNum& operator=(ZNum&& other) noexcept {
+        std::swap(m_small, other.m_small);
+        std::swap(m_big, other.m_big);
+        return *this;
+    }
+
+    ~ZNum() { delete m_big; }
+
+  public:
+    [[nodiscard]] bool is_small() const { return m_big == nullptr; }
+
+    /// \brief Get the value if it fits in 64 bits.
+    [[nodiscard]] std::optional< int64_t > get_int64() const {
+        if (LLVM_LIKELY(is_small())) {
+            return m_small;
+        }
+        return std::nullopt;
+    }
+
+    /// \brief Get the value as a signed APInt of at least `width` bits.
+    [[nodiscard]] llvm::APInt get_apint(unsigned width = 64U) const;
+
+    /// \brief Get the number of bits of the two's complement value.
+    [[nodiscard]] unsigned get_bit_width() const {
+        return is_small() ? 64U : m_big->getBitWidth();
+    }
+
+  public:
+    /// \brief Arithmetic operations. The division rounds toward zero and
+    /// the remainder has the sign of the dividend, as in C.
+    /// @{
+    ZNum& operator+=(const ZNum& other) {
+        int64_t result = 0;
+        if (LLVM_LIKELY(is_small() && other.is_small()) &&
+            !__builtin_add_overflow(m_small, other.m_small, &result)) {
+            m_small = result;
+            return *this;
+        }
+        return *this = add_slow(*this, other);
+    }
+
+    ZNum& operator-=(const ZNum& other) {
+        int64_t result = 0;
+        if (LLVM_LIKELY(is_small() && other.is_small()) &&
+            !__builtin_sub_overflow(m_small, other.m_small, &result)) {
+            m_small = result;
+            return *this;
+        }
+        return *this = sub_slow(*this, other);
+    }
+
+    ZNum& operator*=(const ZNum& other) {
+        int64_t result = 0;
+        if (LLVM_LIKELY(is_small() && other.is_small()) &&
+            !__builtin_mul_overflow(m_small, other.m_small, &result)) {
+            m_small = result;
+            return *this;
+        }
+        return *this = mul_slow(*this, other);
+    }
+
+    ZNum& operator/=(const ZNum& other) {
+        knight_assert_msg(other != 0, "division by zero");
+        if (LLVM_LIKELY(is_small() && other.is_small()) &&
+            (m_small != std::numeric_limits< int64_t >::min() ||
+             other.m_small != -1)) {
+            m_small /= other.m_small;
+            return *this;
+        }
+        return *this = div_slow(*this, other);
+    }
+
+    ZNum& operator%=(const ZNum& other) {
+        knight_assert_msg(other != 0, "division by zero");
+        if (LLVM_LIKELY(is_small() && other.is_small())) {
+            m_small = other.m_small == -1 ? 0 : m_small % other.m_small;
+            return *this;
+        }
+        return *this = rem_slow(*this, other);
+    }
+
+    [[nodiscard]] ZNum operator-() const {
+        if (LLVM_LIKELY(is_small() &&
+                        m_small != std::numeric_limits< int64_t >::min())) {
+            return -m_small;
+        }
+        return neg_slow(*this);
+    }
+
+    [[nodiscard]] friend ZNum operator+(ZNum lhs, const ZNum& rhs) {
+        return lhs += rhs;
+    }
+    [[nodiscard]] friend ZNum operator-(ZNum lhs, const ZNum& rhs) {
+        return lhs -= rhs;
+    }
+    [[nodiscard]] friend ZNum operator*(ZNum lhs, const ZNum& rhs) {
+        return lhs *= rhs;
+    }
+    [[nodiscard]] friend ZNum operator/(ZNum lhs, const ZNum& rhs) {
+        return lhs /= rhs;
+    }
+    [[nodiscard]] friend ZNum operator%(ZNum lhs, const ZNum& rhs) {
+        return lhs %= rhs;
+    }
+    /// @}
+
+    [[nodiscard]] friend bool operator==(const ZNum& lhs, const ZNum& rhs) {
+        if (LLVM_LIKELY(lhs.is_small() && rhs.is_small())) {
+            return lhs.m_small == rhs.m_small;
+        }
+        return compare_slow(lhs, rhs) == 0;
+    }
+
+    [[nodiscard]] friend std::strong_ordering operator<=>(const ZNum& lhs,
+                                                          const ZNum& rhs) {
+        if (LLVM_LIKELY(lhs.is_small() && rhs.is_small())) {
+            return lhs.m_small <=> rhs.m_small;
+        }
+        return compare_slow(lhs, rhs) <=> 0;
+    }
+
+    void Profile(llvm::FoldingSetNodeID& id) const { // NOLINT
+        id.AddBoolean(is_small());
+        if (is_small()) {
+            id.AddInteger(m_small);
+        } else {
+            m_big->Profile(id);
+        }
+    }
+
+    [[nodiscard]] friend llvm::hash_code hash_value(const ZNum& num) {
+        if (LLVM_LIKELY(num.is_small())) {
+            return llvm::hash_value(num.m_small);
+        }
+        return llvm::hash_value(*num.m_big);
+    }
+
+    void dump(llvm::raw_ostream& os) const;
+
+    friend llvm::raw_ostream& operator<<(llvm::raw_ostream& os,
+                                         const ZNum& num) {
+        num.dump(os);
+        return os;
+    }
+
+  private:
+    /// \brief The operations on the big numbers or overflowing 64 bits.
+    /// @{
+    [[nodiscard]] static ZNum add_slow(const ZNum& lhs, const ZNum& rhs);
+    [[nodiscard]] static ZNum sub_slow(const ZNum& lhs, const ZNum& rhs);
+    [[nodiscard]] static ZNum mul_slow(const ZNum& lhs, const ZNum& rhs);
+    [[nodiscard]] static ZNum div_slow(const ZNum& lhs, const ZNum& rhs);
+    [[nodiscard]] static ZNum rem_slow(const ZNum& lhs, const ZNum& rhs);
+    [[nodiscard]] static ZNum neg_slow(const ZNum& num);
+    [[nodiscard]] static int compare_slow(const ZNum& lhs, const ZNum& rhs);
+    /// @}
+}; // class ZNum
+
+} // namespace knight
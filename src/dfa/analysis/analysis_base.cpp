@@ -20,7 +20,7 @@
 
 namespace knight::dfa {
 
-AnalysisBase::AnalysisBase(KnightContext& ctx, AnalysisKind k)
+AnalysisBase::AnalysisBase(KnightTUContext& ctx, AnalysisKind k)
     : m_ctx(ctx), kind(k) {}
 
 clang::DiagnosticBuilder AnalysisBase::diagnose(
@@ -20,7 +20,7 @@
 
 namespace knight::dfa {
 
-AnalysisContext::AnalysisContext(KnightContext& ctx,
+AnalysisContext::AnalysisContext(KnightTUContext& ctx,
                                  RegionManager& region_manager)
     : m_ctx(ctx), m_region_manager(region_manager) {}
 
@@ -14,11 +14,15 @@
 #include "dfa/analysis_manager.hpp"
 #include "dfa/analysis/analyses.hpp"
 #include "dfa/analysis/analysis_base.hpp"
+#include "dfa/analysis/static_pipeline.hpp"
 #include "dfa/analysis_context.hpp"
 #include "dfa/domain/domains.hpp"
+#include "dfa/profiler.hpp"
 #include "dfa/program_state.hpp"
 #include "util/assert.hpp"
 
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/TimeProfiler.h>
 #include <llvm/Support/raw_ostream.h>
 
 #include <memory>
@@ -29,25 +33,23 @@ namespace knight::dfa {
 namespace {
 
 std::vector< AnalysisID > compute_topological_order(
-    const std::unordered_map< AnalysisID, AnalysisIDSet >& dependencies,
+    const std::array< AnalysisIDSet, NumAnalysisIDs >& dependencies,
     const AnalysisIDSet& all_ids,
     const AnalysisIDSet& privileged_ids) {
-    std::unordered_map< AnalysisID, int > in_degree;
+    std::array< int, NumAnalysisIDs > in_degree{};
     std::queue< AnalysisID > zero_in_degree;
     std::vector< AnalysisID > sorted_ids;
+    AnalysisIDSet sorted_set;
 
     // Firstly, add privileged analyses to the sorted list.
     // TODO: shall we add privileged analysis ordering by dependencies here?
     for (const auto& id : privileged_ids) {
         sorted_ids.push_back(id);
+        sorted_set.insert(id);
     }
 
-    for (const auto& id : all_ids) {
-        in_degree[id] = 0;
-    }
-
-    for (const auto& pair : dependencies) {
-        for (const auto& dep : pair.second) {
+    for (const auto& deps : dependencies) {
+        for (const auto& dep : deps) {
             in_degree[dep]++;
         }
     }
@@ -61,15 +63,10 @@ std::vector< AnalysisID > compute_topological_order(
     while (!zero_in_degree.empty()) {
         const AnalysisID current = zero_in_degree.front();
         zero_in_degree.pop();
-        if (std::find(sorted_ids.begin(), sorted_ids.end(), current) ==
-            sorted_ids.end()) {
+        if (sorted_set.insert(current)) {
             sorted_ids.push_back(current);
         }
-        auto it = dependencies.find(current);
-        if (it == dependencies.end()) {
-            continue;
-        }
-        for (const AnalysisID& neighbor : it->second) {
+        for (const AnalysisID& neighbor : dependencies[current]) {
             if (--in_degree[neighbor] == 0) {
                 zero_in_degree.push(neighbor);
             }
@@ -86,7 +83,7 @@ std::vector< AnalysisID > get_subset_order(
     const std::vector< AnalysisID >& full_order, const AnalysisIDSet& subset) {
     std::vector< AnalysisID > res;
     for (const AnalysisID id : full_order) {
-        if (subset.find(id) != subset.end()) {
+        if (subset.contains(id)) {
             res.push_back(id);
         }
     }
@@ -95,38 +92,49 @@ std::vector< AnalysisID > get_subset_order(
 
 } // anonymous namespace
 
-AnalysisManager::AnalysisManager(KnightContext& ctx) : m_ctx(ctx) {
+AnalysisManager::AnalysisManager(KnightTUContext& ctx)
+    : AnalysisManager(ctx, ctx.get_allocator()) {}
+
+AnalysisManager::AnalysisManager(KnightTUContext& ctx,
+                                 llvm::BumpPtrAllocator& allocator,
+                                 SharedInterner* interner)
+    : m_ctx(ctx) {
     m_region_mgr =
         std::make_unique< dfa::RegionManager >(*m_ctx.get_ast_context(),
-                                               m_ctx.get_allocator());
-    m_state_mgr =
-        std::make_unique< dfa::ProgramStateManager >(*this,
-                                                     *m_region_mgr,
-                                                     m_ctx.get_allocator());
+                                               allocator,
+                                               interner);
+    const auto& opts = m_ctx.get_current_options();
+    m_region_mgr->set_heap_abstraction(opts.heap_context_depth,
+                                       opts.heap_recency);
+    m_region_mgr->set_max_array_elements(opts.max_array_elements);
+    m_sym_mgr = std::make_unique< dfa::SymbolManager >(allocator, interner);
+    m_state_mgr = std::make_unique< dfa::ProgramStateManager >(*this,
+                                                               *m_region_mgr,
+                                                               allocator);
 }
 
+AnalysisManager::~AnalysisManager() = default;
+
 bool AnalysisManager::is_analysis_required(AnalysisID id) const {
     return m_required_analyses.contains(id);
 }
 
 void AnalysisManager::add_required_analysis(AnalysisID id) {
     m_required_analyses.insert(id);
+    m_stmt_dispatch.clear();
 }
 
 void AnalysisManager::add_analysis_dependency(AnalysisID id,
                                               AnalysisID required_id) {
-    if (m_analysis_dependencies.contains(required_id)) {
-        knight_assert_msg(!m_analysis_dependencies[required_id].contains(id),
-                          "Circular dependency detected");
-    }
+    knight_assert_msg(!m_analysis_dependencies[required_id].contains(id),
+                      "Circular dependency detected");
 
     m_analysis_dependencies[id].insert(required_id);
 
     // Add dependencies of required analysis recursively.
-    if (m_analysis_dependencies.contains(required_id)) {
-        for (auto dep_id : m_analysis_dependencies[required_id]) {
-            add_analysis_dependency(id, dep_id);
-        }
+    const auto required_deps = m_analysis_dependencies[required_id];
+    for (auto dep_id : required_deps) {
+        add_analysis_dependency(id, dep_id);
     }
 }
 
@@ -155,12 +163,57 @@ void AnalysisManager::compute_full_order_analyses_after_registry() {
     m_analysis_full_order = compute_topological_order(m_analysis_dependencies,
                                                       m_analyses,
                                                       m_priviledged_analysis);
+    setup_static_pipeline();
+    m_stmt_dispatch.clear();
+}
+
+void AnalysisManager::setup_static_pipeline() {
+    m_static_pipeline.reset();
+#ifdef KNIGHT_STATIC_ANALYSES
+    // The analyses are profiled through their callbacks.
+    if (Profiler::is_enabled()) {
+        return;
+    }
+
+    std::array< std::size_t, NumAnalysisIDs > full_pos{};
+    for (std::size_t pos = 0U; pos < m_analysis_full_order.size(); ++pos) {
+        full_pos[m_analysis_full_order[pos]] = pos;
+    }
+
+    // The static analyses run first, then the others in the full order.
+    std::array< std::size_t, NumAnalysisIDs > run_pos{};
+    std::size_t pos = 0U;
+    for (auto id : StaticAnalysisPipeline::get_ids()) {
+        run_pos[id] = pos++;
+    }
+    for (auto id : m_analysis_full_order) {
+        if (!StaticAnalysisPipeline::contains(id)) {
+            run_pos[id] = pos++;
+        }
+    }
+
+    for (auto id : m_analysis_full_order) {
+        for (auto dep_id : m_analysis_dependencies[id]) {
+            if ((full_pos[id] < full_pos[dep_id]) !=
+                (run_pos[id] < run_pos[dep_id])) {
+                return;
+            }
+        }
+    }
+    m_static_pipeline = std::make_unique< StaticAnalysisPipeline >();
+#endif
+}
+
+bool AnalysisManager::is_statically_dispatched(AnalysisID id) const {
+    return m_static_pipeline != nullptr &&
+           StaticAnalysisPipeline::contains(id);
 }
 
 void AnalysisManager::enable_analysis(
     std::unique_ptr< AnalysisBase > analysis) {
     auto id = get_analysis_id(analysis->kind);
     m_enabled_analyses.emplace(id, std::move(analysis));
+    m_stmt_dispatch.clear();
 }
 
 std::optional< AnalysisBase* > AnalysisManager::get_analysis(AnalysisID id) {
@@ -171,45 +224,34 @@ std::optional< AnalysisBase* > AnalysisManager::get_analysis(AnalysisID id) {
     return it->second.get();
 }
 
-std::unordered_set< AnalysisID > AnalysisManager::get_analysis_dependencies(
-    AnalysisID id) const {
-    auto it = m_analysis_dependencies.find(id);
-    if (it == m_analysis_dependencies.end()) {
-        return {};
-    }
-    return it->second;
+AnalysisIDSet AnalysisManager::get_analysis_dependencies(AnalysisID id) const {
+    return id < NumAnalysisIDs ? m_analysis_dependencies[id] : AnalysisIDSet();
 }
 
-std::unordered_set< DomID > AnalysisManager::get_registered_domains_in(
-    AnalysisID id) const {
-    auto it = m_analysis_domains.find(id);
-    if (it == m_analysis_domains.end()) {
-        return {};
-    }
-    return it->second;
+DomIDSet AnalysisManager::get_registered_domains_in(AnalysisID id) const {
+    return id < NumAnalysisIDs ? m_analysis_domains[id] : DomIDSet();
 }
 
 std::optional< AnalysisManager::DomainDefaultValFn > AnalysisManager::
     get_domain_default_val_fn(DomID id) const {
-    auto it = m_domain_default_fn.find(id);
-    if (it == m_domain_default_fn.end()) {
+    if (id >= NumDomIDs || !m_domain_default_fn[id]) {
         return std::nullopt;
     }
-    return it->second;
+    return m_domain_default_fn[id];
 }
 std::optional< AnalysisManager::DomainBottomValFn > AnalysisManager::
     get_domain_bottom_val_fn(DomID id) const {
-    auto it = m_domain_bottom_fn.find(id);
-    if (it == m_domain_bottom_fn.end()) {
+    if (id >= NumDomIDs || !m_domain_bottom_fn[id]) {
         return std::nullopt;
     }
-    return it->second;
+    return m_domain_bottom_fn[id];
 }
 
 void AnalysisManager::register_for_stmt(internal::AnalyzeStmtCallBack cb,
                                         internal::MatchStmtCallBack match_cb,
                                         internal::VisitStmtKind kind) {
     m_stmt_analyses.emplace_back(cb, match_cb, kind);
+    m_stmt_dispatch.clear();
 }
 
 void AnalysisManager::register_for_begin_function(
@@ -222,26 +264,101 @@ void AnalysisManager::register_for_end_function(
     m_end_function_analyses.emplace_back(cb);
 }
 
-void AnalysisManager::run_analyses_for_stmt(
-    AnalysisContext& analysis_ctx,
-    internal::StmtRef stmt,
-    internal::VisitStmtKind visit_kind) {
+const AnalysisManager::StmtDispatchEntry& AnalysisManager::get_stmt_dispatch(
+    internal::StmtRef stmt, internal::VisitStmtKind visit_kind) const {
+    if (m_stmt_dispatch.empty()) {
+        m_stmt_dispatch.resize(
+            static_cast< std::size_t >(internal::NumVisitStmtKinds) *
+            internal::NumStmtClasses);
+        if (m_static_pipeline != nullptr) {
+            m_static_pipeline->bind([this](AnalysisID id) -> AnalysisBase* {
+                auto it = m_enabled_analyses.find(id);
+                if (it == m_enabled_analyses.end() ||
+                    !is_analysis_required(id)) {
+                    return nullptr;
+                }
+                return it->second.get();
+            });
+        }
+    }
+    auto& entry = m_stmt_dispatch[internal::get_stmt_dispatch_index(
+        stmt->getStmtClass(),
+        static_cast< unsigned >(visit_kind))];
+    if (entry.computed) {
+        return entry;
+    }
+
     AnalysisIDSet tgt_ids;
-    std::unordered_map< AnalysisID, internal::AnalyzeStmtCallBack* > callbacks;
-    for (auto& info : m_stmt_analyses) {
+    std::unordered_map< AnalysisID, const internal::AnalyzeStmtCallBack* >
+        callbacks;
+    for (const auto& info : m_stmt_analyses) {
         if (info.kind != visit_kind || !info.match_cb(stmt)) {
             continue;
         }
-        auto& callback = info.anz_cb;
+        const auto& callback = info.anz_cb;
         auto id = callback.get_id();
-        if (is_analysis_required(id)) {
-            tgt_ids.insert(id);
-            callbacks.emplace(id, &callback);
+        if (!is_analysis_required(id)) {
+            continue;
         }
+        if (is_statically_dispatched(id)) {
+            entry.has_static = true;
+            continue;
+        }
+        tgt_ids.insert(id);
+        callbacks.emplace(id, &callback);
     }
 
     for (auto id : get_subset_order(m_analysis_full_order, tgt_ids)) {
-        (*callbacks[id])(stmt, analysis_ctx);
+        entry.callbacks.push_back(*callbacks[id]);
+    }
+    entry.computed = true;
+    return entry;
+}
+
+const std::vector< internal::AnalyzeStmtCallBack >& AnalysisManager::
+    get_stmt_callbacks(internal::StmtRef stmt,
+                       internal::VisitStmtKind visit_kind) const {
+    return get_stmt_dispatch(stmt, visit_kind).callbacks;
+}
+
+bool AnalysisManager::has_analyses_for_stmt(internal::StmtRef stmt) const {
+    for (unsigned kind = 0U; kind < internal::NumVisitStmtKinds; ++kind) {
+        const auto& entry =
+            get_stmt_dispatch(stmt,
+                              static_cast< internal::VisitStmtKind >(kind));
+        if (entry.has_static || !entry.callbacks.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AnalysisManager::has_function_analyses() const {
+    auto is_required = [this](const auto& callback) {
+        return is_analysis_required(callback.get_id());
+    };
+    return llvm::any_of(m_begin_function_analyses, is_required) ||
+           llvm::any_of(m_end_function_analyses, is_required);
+}
+
+void AnalysisManager::run_analyses_for_stmt(
+    AnalysisContext& analysis_ctx,
+    internal::StmtRef stmt,
+    internal::VisitStmtKind visit_kind) {
+    const auto& entry = get_stmt_dispatch(stmt, visit_kind);
+    if (entry.has_static) {
+        const llvm::TimeTraceScope trace_scope("Analysis", "static");
+        m_static_pipeline->run_stmt(stmt, visit_kind, analysis_ctx);
+    }
+    for (const auto& callback : entry.callbacks) {
+        const auto name = Profiler::is_enabled()
+                              ? get_analysis_name_by_id(callback.get_id())
+                              : llvm::StringRef();
+        const ProfileScope scope(ProfileCategory::Analysis, name);
+        const llvm::TimeTraceScope trace_scope("Analysis", [&callback] {
+            return get_analysis_name_by_id(callback.get_id()).str();
+        });
+        callback(stmt, analysis_ctx);
     }
 }
 
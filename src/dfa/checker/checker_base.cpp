@@ -21,7 +21,7 @@
 
 namespace knight::dfa {
 
-CheckerBase::CheckerBase(KnightContext& ctx, CheckerKind k)
+CheckerBase::CheckerBase(KnightTUContext& ctx, CheckerKind k)
     : m_ctx(ctx), kind(k) {}
 
 clang::DiagnosticBuilder CheckerBase::diagnose(
@@ -16,13 +16,18 @@
 #include "dfa/analysis/analysis_base.hpp"
 #include "dfa/checker/checker_base.hpp"
 #include "dfa/checker/checkers.hpp"
+#include "dfa/profiler.hpp"
 #include "util/assert.hpp"
 
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/TimeProfiler.h>
+
 #include <memory>
 namespace knight::dfa {
 
 void CheckerManager::add_required_checker(CheckerID id) {
-    m_required_checkers.emplace(id);
+    m_required_checkers.insert(id);
+    m_stmt_dispatch.clear();
 }
 
 bool CheckerManager::is_checker_required(CheckerID id) const {
@@ -46,6 +51,7 @@ void CheckerManager::register_for_stmt(internal::CheckStmtCallBack cb,
                                        internal::MatchStmtCallBack match_fn,
                                        internal::CheckStmtKind kind) {
     m_stmt_checks.emplace_back(cb, match_fn, kind);
+    m_stmt_dispatch.clear();
 }
 
 void CheckerManager::register_for_begin_function(
@@ -58,18 +64,62 @@ void CheckerManager::register_for_end_function(
     m_end_function_checks.emplace_back(cb);
 }
 
+const std::vector< internal::CheckStmtCallBack >& CheckerManager::
+    get_stmt_callbacks(internal::StmtRef stmt,
+                       internal::CheckStmtKind check_kind) const {
+    if (m_stmt_dispatch.empty()) {
+        m_stmt_dispatch.resize(
+            static_cast< std::size_t >(internal::NumCheckStmtKinds) *
+            internal::NumStmtClasses);
+    }
+    auto& entry = m_stmt_dispatch[internal::get_stmt_dispatch_index(
+        stmt->getStmtClass(),
+        static_cast< unsigned >(check_kind))];
+    if (entry.computed) {
+        return entry.callbacks;
+    }
+
+    for (const auto& info : m_stmt_checks) {
+        if (info.kind == check_kind && info.match_cb(stmt) &&
+            is_checker_required(info.anz_cb.get_id())) {
+            entry.callbacks.push_back(info.anz_cb);
+        }
+    }
+    entry.computed = true;
+    return entry.callbacks;
+}
+
+bool CheckerManager::has_checkers_for_stmt(
+    internal::StmtRef stmt, internal::CheckStmtKind check_kind) const {
+    return !get_stmt_callbacks(stmt, check_kind).empty();
+}
+
+bool CheckerManager::has_function_checkers() const {
+    auto is_required = [this](const auto& callback) {
+        return is_checker_required(callback.get_id());
+    };
+    return llvm::any_of(m_begin_function_checks, is_required) ||
+           llvm::any_of(m_end_function_checks, is_required);
+}
+
+bool CheckerManager::has_stmt_checkers() const {
+    return llvm::any_of(m_stmt_checks, [this](const auto& info) {
+        return is_checker_required(info.anz_cb.get_id());
+    });
+}
+
 void CheckerManager::run_checkers_for_stmt(CheckerContext& checker_ctx,
                                            internal::StmtRef stmt,
                                            internal::CheckStmtKind check_kind) {
-    for (auto& info : m_stmt_checks) {
-        if (info.kind != check_kind || !info.match_cb(stmt)) {
-            continue;
-        }
-        auto& callback = info.anz_cb;
-        auto id = callback.get_id();
-        if (is_checker_required(id)) {
-            callback(stmt, checker_ctx);
-        }
+    for (const auto& callback : get_stmt_callbacks(stmt, check_kind)) {
+        const auto name = Profiler::is_enabled()
+                              ? get_checker_name_by_id(callback.get_id())
+                              : llvm::StringRef();
+        const ProfileScope scope(ProfileCategory::Checker, name);
+        const llvm::TimeTraceScope trace_scope("Checker", [&callback] {
+            return get_checker_name_by_id(callback.get_id()).str();
+        });
+        callback(stmt, checker_ctx);
     }
 }
 
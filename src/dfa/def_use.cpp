@@ -0,0 +1,214 @@
+//===- def_use.cpp ----------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the def-use chains of the local variables over
+//  the ProcCFG.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/def_use.hpp"
+
+#include <clang/AST/Expr.h>
+#include <clang/AST/ExprCXX.h>
+#include <clang/AST/Stmt.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Support/GenericIteratedDominanceFrontier.h>
+
+#define DEBUG_TYPE "def-use" // NOLINT
+
+ALWAYS_ENABLED_STATISTIC(NumPlacedPhis, "The number of placed phis");
+ALWAYS_ENABLED_STATISTIC(NumTransparentNodes,
+                         "The number of nodes transparent to the values");
+
+namespace knight::dfa {
+
+namespace {
+
+/// \brief Whether the stmt evaluates an expression without any effect on
+/// the state. The calls and the writes are excluded, and so are the
+/// divisions and the dereferences, on which the analyses may refine the
+/// state or cut the path.
+bool is_pure_stmt(const clang::Stmt* stmt) {
+    if (const auto* binary = llvm::dyn_cast< clang::BinaryOperator >(stmt)) {
+        return !binary->isAssignmentOp() &&
+               binary->getOpcode() != clang::BO_Div &&
+               binary->getOpcode() != clang::BO_Rem;
+    }
+    if (const auto* unary = llvm::dyn_cast< clang::UnaryOperator >(stmt)) {
+        return !unary->isIncrementDecrementOp() &&
+               unary->getOpcode() != clang::UO_Deref;
+    }
+    if (const auto* member = llvm::dyn_cast< clang::MemberExpr >(stmt)) {
+        return !member->isArrow();
+    }
+    return llvm::isa< clang::DeclRefExpr,
+                      clang::IntegerLiteral,
+                      clang::FloatingLiteral,
+                      clang::CharacterLiteral,
+                      clang::StringLiteral,
+                      clang::CXXBoolLiteralExpr,
+                      clang::CXXNullPtrLiteralExpr,
+                      clang::ParenExpr,
+                      clang::CastExpr,
+                      clang::ConditionalOperator,
+                      clang::UnaryExprOrTypeTraitExpr,
+                      clang::ConstantExpr,
+                      clang::CXXThisExpr >(stmt);
+}
+
+} // anonymous namespace
+
+DefUseChains::DefUseChains(const ProcCFG& cfg, const LiveVariables& live_vars)
+    : m_live_vars(live_vars),
+      m_dom_tree(std::make_unique< clang::CFGDomTree >(
+          const_cast< clang::CFG* >(&cfg.get_clang_cfg()))), // NOLINT
+      m_vars(live_vars.get_num_tracked_vars(), nullptr) {
+    const auto& clang_cfg = cfg.get_clang_cfg();
+    const unsigned num_blocks = clang_cfg.getNumBlockIDs();
+    const unsigned num_vars = live_vars.get_num_tracked_vars();
+    m_defs.assign(num_blocks, llvm::BitVector(num_vars));
+    m_uses.assign(num_blocks, llvm::BitVector(num_vars));
+    m_phis.assign(num_blocks, llvm::BitVector(num_vars));
+    m_transparent.resize(num_blocks);
+
+    llvm::BitVector consumed(num_blocks);
+    for (NodeRef node : clang_cfg) {
+        if (collect_defs_and_uses(node)) {
+            m_transparent.set(ProcCFG::index(node));
+        }
+        // The values of the exprs consumed by another block flow through
+        // the stmt sexprs, which the transfer binds.
+        for (const auto& elem : node->Elements) {
+            auto cfg_stmt = elem.getAs< clang::CFGStmt >();
+            if (!cfg_stmt) {
+                continue;
+            }
+            for (const auto* child : cfg_stmt->getStmt()->children()) {
+                if (child == nullptr) {
+                    continue;
+                }
+                NodeRef child_node = cfg.get_block_of(child);
+                if (child_node != nullptr && child_node != node) {
+                    consumed.set(ProcCFG::index(child_node));
+                }
+            }
+        }
+    }
+    m_transparent.reset(consumed);
+    NumTransparentNodes += m_transparent.count();
+
+    if (num_vars != 0U) {
+        place_phis(cfg);
+    }
+}
+
+DefUseChains::~DefUseChains() = default;
+
+bool DefUseChains::collect_defs_and_uses(NodeRef node) {
+    auto& defs = m_defs[ProcCFG::index(node)];
+    auto& uses = m_uses[ProcCFG::index(node)];
+    bool is_pure = true;
+    for (const auto& elem : node->Elements) {
+        auto cfg_stmt = elem.getAs< clang::CFGStmt >();
+        if (!cfg_stmt) {
+            is_pure = false;
+            continue;
+        }
+        const auto* stmt = cfg_stmt->getStmt();
+        is_pure &= is_pure_stmt(stmt);
+        if (const auto* decl_stmt = llvm::dyn_cast< clang::DeclStmt >(stmt)) {
+            for (const auto* decl : decl_stmt->decls()) {
+                const auto* var = llvm::dyn_cast< clang::VarDecl >(decl);
+                if (var == nullptr) {
+                    continue;
+                }
+                if (auto index = m_live_vars.get_var_index(var)) {
+                    m_vars[*index] = var;
+                    defs.set(*index);
+                }
+            }
+            continue;
+        }
+        auto access = get_var_access(stmt);
+        if (access.var == nullptr) {
+            continue;
+        }
+        if (auto index = m_live_vars.get_var_index(access.var)) {
+            if (access.is_read && !defs.test(*index)) {
+                uses.set(*index);
+            }
+            if (access.is_written) {
+                defs.set(*index);
+            }
+        }
+    }
+    return is_pure;
+}
+
+void DefUseChains::place_phis(const ProcCFG& cfg) {
+    llvm::IDFCalculatorBase< clang::CFGBlock, /*IsPostDom=*/false > idf(
+        m_dom_tree->getBase());
+    llvm::SmallPtrSet< clang::CFGBlock*, 16U > def_blocks;
+    llvm::SmallPtrSet< clang::CFGBlock*, 16U > live_in_blocks;
+    llvm::SmallVector< clang::CFGBlock*, 16U > phi_blocks;
+    for (unsigned index = 0U; index < m_vars.size(); ++index) {
+        VarDeclRef var = m_vars[index];
+        if (var == nullptr) {
+            continue;
+        }
+        def_blocks.clear();
+        live_in_blocks.clear();
+        phi_blocks.clear();
+        for (NodeRef node : cfg.get_clang_cfg()) {
+            auto* block = const_cast< clang::CFGBlock* >(node); // NOLINT
+            if (m_defs[ProcCFG::index(node)].test(index)) {
+                def_blocks.insert(block);
+            }
+            if (m_live_vars.get_live_in(node).is_live(var)) {
+                live_in_blocks.insert(block);
+            }
+        }
+        idf.setDefiningBlocks(def_blocks);
+        idf.setLiveInBlocks(live_in_blocks);
+        idf.calculate(phi_blocks);
+        for (auto* block : phi_blocks) {
+            m_phis[ProcCFG::index(block)].set(index);
+        }
+        NumPlacedPhis += phi_blocks.size();
+    }
+}
+
+DefUseChains::NodeRef DefUseChains::get_reaching_def(VarDeclRef var,
+                                                     NodeRef node) const {
+    auto index = m_live_vars.get_var_index(var);
+    if (!index) {
+        return nullptr;
+    }
+    if (m_phis[ProcCFG::index(node)].test(*index)) {
+        return node;
+    }
+    const auto* dom_node =
+        m_dom_tree->getNode(const_cast< clang::CFGBlock* >(node)); // NOLINT
+    if (dom_node == nullptr) {
+        return nullptr;
+    }
+    for (dom_node = dom_node->getIDom(); dom_node != nullptr;
+         dom_node = dom_node->getIDom()) {
+        NodeRef dom = dom_node->getBlock();
+        const unsigned dom_index = ProcCFG::index(dom);
+        if (m_defs[dom_index].test(*index) || m_phis[dom_index].test(*index)) {
+            return dom;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace knight::dfa
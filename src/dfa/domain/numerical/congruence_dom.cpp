@@ -0,0 +1,548 @@
+//===- congruence_dom.cpp ---------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the congruence environment domain.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/domain/numerical/congruence_dom.hpp"
+#include "dfa/domain/numerical/interval_arith.hpp"
+
+#include <cstdint>
+#include <utility>
+
+namespace knight::dfa {
+
+namespace {
+
+ZNum abs(const ZNum& n) {
+    return n < 0 ? -n : n;
+}
+
+ZNum gcd(ZNum lhs, ZNum rhs) {
+    lhs = abs(lhs);
+    rhs = abs(rhs);
+    while (rhs != 0) {
+        ZNum rem = lhs % rhs;
+        lhs = std::move(rhs);
+        rhs = std::move(rem);
+    }
+    return lhs;
+}
+
+/// \brief The remainder in `[0, m)` for a positive `m`.
+ZNum mod_floor(const ZNum& n, const ZNum& m) {
+    ZNum rem = n % m;
+    if (rem < 0) {
+        rem += m;
+    }
+    return rem;
+}
+
+/// \brief The inverse of `n` modulo a positive `m` coprime with it, by
+/// the extended Euclidean algorithm.
+ZNum mod_inverse(const ZNum& n, const ZNum& m) {
+    ZNum old_r = mod_floor(n, m);
+    ZNum r = m;
+    ZNum old_s(1);
+    ZNum s(0);
+    while (r != 0) {
+        const ZNum quotient = old_r / r;
+        ZNum next_r = old_r - quotient * r;
+        old_r = std::move(r);
+        r = std::move(next_r);
+        ZNum next_s = old_s - quotient * s;
+        old_s = std::move(s);
+        s = std::move(next_s);
+    }
+    return mod_floor(old_s, m);
+}
+
+/// \brief Get `2^k` for a shift amount `k`, if it is a valid one.
+std::optional< ZNum > get_shift_factor(const std::optional< ZNum >& k) {
+    if (!k || *k < 0 || *k >= 64) {
+        return std::nullopt;
+    }
+    return ZNum(uint64_t(1) << static_cast< unsigned >(*k->get_int64()));
+}
+
+} // anonymous namespace
+
+Congruence::Congruence(ZNum mod, ZNum rem)
+    : m_mod(abs(mod)), m_rem(std::move(rem)) {
+    if (m_mod != 0) {
+        m_rem = mod_floor(m_rem, m_mod);
+    }
+}
+
+bool Congruence::contains(const ZNum& n) const {
+    if (m_mod == 0) {
+        return n == m_rem;
+    }
+    return (n - m_rem) % m_mod == 0;
+}
+
+Congruence Congruence::join(const Congruence& other) const {
+    return {gcd(gcd(m_mod, other.m_mod), m_rem - other.m_rem), m_rem};
+}
+
+std::optional< Congruence > Congruence::meet(const Congruence& other) const {
+    if (m_mod == 0) {
+        if (other.contains(m_rem)) {
+            return *this;
+        }
+        return std::nullopt;
+    }
+    if (other.m_mod == 0) {
+        if (this->contains(other.m_rem)) {
+            return other;
+        }
+        return std::nullopt;
+    }
+    // x = b1 + a1 * t with a1 * t == b2 - b1 (mod a2), which is solvable
+    // iff gcd(a1, a2) divides b2 - b1.
+    const ZNum g = gcd(m_mod, other.m_mod);
+    const ZNum diff = other.m_rem - m_rem;
+    if (diff % g != 0) {
+        return std::nullopt;
+    }
+    const ZNum mod = other.m_mod / g;
+    const ZNum t = mod_floor((diff / g) * mod_inverse(m_mod / g, mod), mod);
+    return Congruence(m_mod * mod, m_rem + m_mod * t);
+}
+
+bool Congruence::leq(const Congruence& other) const {
+    if (other.m_mod == 0) {
+        return m_mod == 0 && m_rem == other.m_rem;
+    }
+    return m_mod % other.m_mod == 0 && other.contains(m_rem);
+}
+
+Congruence Congruence::operator-() const {
+    return {m_mod, -m_rem};
+}
+
+Congruence Congruence::operator+(const Congruence& other) const {
+    return {gcd(m_mod, other.m_mod), m_rem + other.m_rem};
+}
+
+Congruence Congruence::operator-(const Congruence& other) const {
+    return *this + -other;
+}
+
+Congruence Congruence::operator*(const Congruence& other) const {
+    // (a1 * k1 + b1) * (a2 * k2 + b2) is b1 * b2 plus multiples of
+    // a1 * a2, a1 * b2 and a2 * b1.
+    const ZNum mod = gcd(gcd(m_mod * other.m_mod, m_mod * other.m_rem),
+                         other.m_mod * m_rem);
+    return {mod, m_rem * other.m_rem};
+}
+
+Congruence Congruence::scale(const ZNum& k) const {
+    return {m_mod * k, m_rem * k};
+}
+
+Congruence Congruence::div(const ZNum& k) const {
+    if (m_mod == 0) {
+        return constant(m_rem / k);
+    }
+    // The division is exact when k divides all the values.
+    if (m_mod % k == 0 && m_rem % k == 0) {
+        return {m_mod / k, m_rem / k};
+    }
+    return top();
+}
+
+Congruence Congruence::rem(const ZNum& k) const {
+    if (m_mod == 0) {
+        return constant(m_rem % k);
+    }
+    // x % k == x (mod k), whatever the sign of x.
+    return {gcd(m_mod, k), m_rem};
+}
+
+void Congruence::dump(llvm::raw_ostream& os) const {
+    if (m_mod == 0) {
+        os << m_rem;
+        return;
+    }
+    os << m_mod << "Z+" << m_rem;
+}
+
+void CongruenceEnvDom::set_congruence(DenseVarID id, Congruence cong) {
+    if (m_is_bottom) {
+        return;
+    }
+    if (id >= m_congs.size()) {
+        if (cong.is_top()) {
+            return;
+        }
+        m_congs.resize(id + 1U);
+    }
+    m_congs[id] = std::move(cong);
+    this->trim();
+}
+
+void CongruenceEnvDom::meet_congruence(DenseVarID id,
+                                       const Congruence& cong) {
+    if (m_is_bottom) {
+        return;
+    }
+    auto res = this->get_congruence(id).meet(cong);
+    if (!res) {
+        this->set_to_bottom();
+        return;
+    }
+    this->set_congruence(id, std::move(*res));
+}
+
+void CongruenceEnvDom::join_with(const CongruenceEnvDom& other) {
+    if (other.m_is_bottom) {
+        return;
+    }
+    if (m_is_bottom) {
+        *this = other;
+        return;
+    }
+    // The variables top in the other environment stay top.
+    if (m_congs.size() > other.m_congs.size()) {
+        m_congs.resize(other.m_congs.size());
+    }
+    for (std::size_t i = 0U; i < m_congs.size(); ++i) {
+        m_congs[i] = m_congs[i].join(other.m_congs[i]);
+    }
+    this->trim();
+}
+
+void CongruenceEnvDom::meet_with(const CongruenceEnvDom& other) {
+    if (m_is_bottom) {
+        return;
+    }
+    if (other.m_is_bottom) {
+        this->set_to_bottom();
+        return;
+    }
+    if (m_congs.size() < other.m_congs.size()) {
+        m_congs.resize(other.m_congs.size());
+    }
+    for (std::size_t i = 0U; i < other.m_congs.size(); ++i) {
+        auto res = m_congs[i].meet(other.m_congs[i]);
+        if (!res) {
+            this->set_to_bottom();
+            return;
+        }
+        m_congs[i] = std::move(*res);
+    }
+}
+
+void CongruenceEnvDom::narrow_with(const CongruenceEnvDom& other) {
+    if (m_is_bottom) {
+        return;
+    }
+    if (other.m_is_bottom) {
+        this->set_to_bottom();
+        return;
+    }
+    if (m_congs.size() < other.m_congs.size()) {
+        m_congs.resize(other.m_congs.size());
+    }
+    for (std::size_t i = 0U; i < other.m_congs.size(); ++i) {
+        if (m_congs[i].is_top()) {
+            m_congs[i] = other.m_congs[i];
+        }
+    }
+}
+
+bool CongruenceEnvDom::leq(const CongruenceEnvDom& other) const {
+    if (m_is_bottom) {
+        return true;
+    }
+    if (other.m_is_bottom) {
+        return false;
+    }
+    // The last variable constrained in the other environment is top in
+    // this one.
+    if (m_congs.size() < other.m_congs.size()) {
+        return false;
+    }
+    for (std::size_t i = 0U; i < other.m_congs.size(); ++i) {
+        if (!m_congs[i].leq(other.m_congs[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CongruenceEnvDom::dump(llvm::raw_ostream& os) const {
+    if (m_is_bottom) {
+        os << "_|_";
+        return;
+    }
+    os << "{";
+    bool first = true;
+    for (std::size_t i = 0U; i < m_congs.size(); ++i) {
+        if (m_congs[i].is_top()) {
+            continue;
+        }
+        if (!first) {
+            os << ", ";
+        }
+        os << "v" << i << ": ";
+        m_congs[i].dump(os);
+        first = false;
+    }
+    os << "}";
+}
+
+void CongruenceEnvDom::transfer_assign_constant(VarRef x, const ZNum& n) {
+    this->set_congruence(x, Congruence::constant(n));
+}
+
+void CongruenceEnvDom::transfer_assign_variable(VarRef x, VarRef y) {
+    this->set_congruence(x, this->get_congruence(y));
+}
+
+void CongruenceEnvDom::transfer_assign_linear_expr(VarRef x,
+                                                   const LinearExpr& expr) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->set_congruence(x, this->eval_congruence(expr));
+}
+
+void CongruenceEnvDom::apply(clang::UnaryOperatorKind op,
+                             VarRef x,
+                             VarRef y) {
+    if (m_is_bottom) {
+        return;
+    }
+    switch (op) {
+        case clang::UO_Plus: {
+            this->transfer_assign_variable(x, y);
+            break;
+        }
+        case clang::UO_Minus: {
+            this->set_congruence(x, -this->get_congruence(y));
+            break;
+        }
+        case clang::UO_Not: {
+            // ~y == -y - 1
+            this->set_congruence(x,
+                                 -this->get_congruence(y) +
+                                     Congruence::constant(ZNum(-1)));
+            break;
+        }
+        default: {
+            this->forget(x);
+            break;
+        }
+    }
+}
+
+void CongruenceEnvDom::apply(clang::BinaryOperatorKind op,
+                             VarRef x,
+                             VarRef y,
+                             VarRef z) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->apply_congruences(op,
+                            x,
+                            this->get_congruence(y),
+                            this->get_congruence(z));
+}
+
+void CongruenceEnvDom::apply(clang::BinaryOperatorKind op,
+                             VarRef x,
+                             VarRef y,
+                             const ZNum& z) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->apply_congruences(op,
+                            x,
+                            this->get_congruence(y),
+                            Congruence::constant(z));
+}
+
+void CongruenceEnvDom::apply(clang::BinaryOperatorKind op,
+                             VarRef x,
+                             const ZNum& y,
+                             VarRef z) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->apply_congruences(op,
+                            x,
+                            Congruence::constant(y),
+                            this->get_congruence(z));
+}
+
+void CongruenceEnvDom::apply_congruences(clang::BinaryOperatorKind op,
+                                         VarRef x,
+                                         const Congruence& y,
+                                         const Congruence& z) {
+    const auto k = z.get_constant();
+    switch (op) {
+        case clang::BO_Add: {
+            this->set_congruence(x, y + z);
+            return;
+        }
+        case clang::BO_Sub: {
+            this->set_congruence(x, y - z);
+            return;
+        }
+        case clang::BO_Mul: {
+            this->set_congruence(x, y * z);
+            return;
+        }
+        case clang::BO_Div:
+        case clang::BO_Rem: {
+            if (!k || *k == 0) {
+                break;
+            }
+            this->set_congruence(x,
+                                 op == clang::BO_Div ? y.div(*k)
+                                                     : y.rem(*k));
+            return;
+        }
+        case clang::BO_Shl: {
+            if (auto factor = get_shift_factor(k)) {
+                this->set_congruence(x, y.scale(*factor));
+                return;
+            }
+            break;
+        }
+        case clang::BO_Shr: {
+            auto factor = get_shift_factor(k);
+            auto n = y.get_constant();
+            if (factor && n) {
+                this->set_congruence(x,
+                                     Congruence::constant(
+                                         itv::floor_div(*n, *factor)));
+                return;
+            }
+            break;
+        }
+        case clang::BO_And:
+        case clang::BO_Or:
+        case clang::BO_Xor: {
+            // The bitwise operations are only evaluated on the 64-bit
+            // constants, whose sign extension is their two's complement.
+            auto lhs = y.get_constant();
+            if (!lhs || !k || !lhs->get_int64() || !k->get_int64()) {
+                break;
+            }
+            const int64_t l = *lhs->get_int64();
+            const int64_t r = *k->get_int64();
+            const int64_t res =
+                op == clang::BO_And ? l & r : (op == clang::BO_Or ? l | r
+                                                                  : l ^ r);
+            this->set_congruence(x, Congruence::constant(res));
+            return;
+        }
+        default: {
+            break;
+        }
+    }
+    this->forget(x);
+}
+
+void CongruenceEnvDom::add_linear_constraint(const LinearConstraint& cst) {
+    if (m_is_bottom) {
+        return;
+    }
+    const auto& expr = cst.get_linear_expression();
+    switch (cst.get_constraint_kind()) {
+        case LinearConstraintKind::LCK_Inequality: {
+            auto n = this->eval_congruence(expr).get_constant();
+            if (n && *n > 0) {
+                this->set_to_bottom();
+            }
+            break;
+        }
+        case LinearConstraintKind::LCK_Equality: {
+            this->add_equality(expr);
+            break;
+        }
+        case LinearConstraintKind::LCK_Disequation: {
+            if (this->eval_congruence(expr).get_constant() == ZNum(0)) {
+                this->set_to_bottom();
+            }
+            break;
+        }
+    }
+}
+
+void CongruenceEnvDom::merge_with_linear_constraint_system(
+    const LinearConstraintSystem& csts) {
+    LinearConstraintSystem normalized_csts(csts);
+    normalized_csts.normalize();
+    if (normalized_csts.is_false()) {
+        this->set_to_bottom();
+        return;
+    }
+    for (const auto& cst : normalized_csts) {
+        if (m_is_bottom) {
+            return;
+        }
+        this->add_linear_constraint(cst);
+    }
+}
+
+Congruence CongruenceEnvDom::eval_congruence(const LinearExpr& expr) const {
+    auto cong = Congruence::constant(expr.get_constant_term());
+    for (const auto& [var, factor] : expr.get_variable_terms()) {
+        cong = cong + this->get_congruence(var).scale(factor);
+    }
+    return cong;
+}
+
+void CongruenceEnvDom::add_equality(const LinearExpr& expr) {
+    if (!this->eval_congruence(expr).contains(ZNum(0))) {
+        this->set_to_bottom();
+        return;
+    }
+
+    // k * v == -(c + the other terms) gives the congruence of v for a
+    // unit k, all taken before the update.
+    const auto& terms = expr.get_variable_terms();
+    std::vector< std::pair< VarRef, Congruence > > congs;
+    for (const auto& [var, factor] : terms) {
+        if (factor != 1 && factor != -1) {
+            continue;
+        }
+        auto rest = Congruence::constant(expr.get_constant_term());
+        for (const auto& [other_var, other_factor] : terms) {
+            if (other_var != var) {
+                rest = rest +
+                       this->get_congruence(other_var).scale(other_factor);
+            }
+        }
+        congs.emplace_back(var, rest.scale(-factor));
+    }
+    // k * v == -c for a single variable.
+    if (terms.size() == 1U && congs.empty()) {
+        const auto& [var, factor] = *terms.begin();
+        const ZNum value = -expr.get_constant_term();
+        if (value % factor != 0) {
+            this->set_to_bottom();
+            return;
+        }
+        congs.emplace_back(var, Congruence::constant(value / factor));
+    }
+    for (const auto& [var, cong] : congs) {
+        this->meet_congruence(var, cong);
+        if (m_is_bottom) {
+            return;
+        }
+    }
+}
+
+} // namespace knight::dfa
@@ -0,0 +1,343 @@
+//===- interval_env.cpp -----------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the numerical transfers of the interval
+//  environment domain.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/domain/numerical/interval_env.hpp"
+
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace knight::dfa {
+
+namespace {
+
+using itv::add;
+using itv::ceil_div;
+using itv::div;
+using itv::floor_div;
+using itv::get_singleton;
+using itv::mul;
+using itv::neg;
+using itv::scale;
+
+constexpr ItvBound MinFinite = ItvMinusInf + 1;
+constexpr ItvBound MaxFinite = ItvPlusInf - 1;
+
+/// \brief Relax the lower bound to a finite bound or to the infinity.
+ItvBound to_lower_bound(const std::optional< ZNum >& lb) {
+    if (!lb || *lb < MinFinite) {
+        return ItvMinusInf;
+    }
+    if (*lb > MaxFinite) {
+        return MaxFinite;
+    }
+    return *lb->get_int64();
+}
+
+/// \brief Relax the upper bound to a finite bound or to the infinity.
+ItvBound to_upper_bound(const std::optional< ZNum >& ub) {
+    if (!ub || *ub > MaxFinite) {
+        return ItvPlusInf;
+    }
+    if (*ub < MinFinite) {
+        return MinFinite;
+    }
+    return *ub->get_int64();
+}
+
+} // anonymous namespace
+
+ZInterval IntervalEnvDom::get_interval(DenseVarID id) const {
+    auto [lb, ub] = this->get_bounds(id);
+    ZInterval res;
+    if (lb != ItvMinusInf) {
+        res.lb = lb;
+    }
+    if (ub != ItvPlusInf) {
+        res.ub = ub;
+    }
+    return res;
+}
+
+void IntervalEnvDom::set_interval(DenseVarID id, const ZInterval& itv) {
+    if (itv.lb && itv.ub && *itv.ub < *itv.lb) {
+        this->set_to_bottom();
+        return;
+    }
+    this->set_bounds(id, to_lower_bound(itv.lb), to_upper_bound(itv.ub));
+}
+
+void IntervalEnvDom::meet_interval(DenseVarID id, const ZInterval& itv) {
+    if (m_is_bottom) {
+        return;
+    }
+    auto res = this->get_interval(id);
+    if (itv.lb && (!res.lb || *res.lb < *itv.lb)) {
+        res.lb = itv.lb;
+    }
+    if (itv.ub && (!res.ub || *itv.ub < *res.ub)) {
+        res.ub = itv.ub;
+    }
+    this->set_interval(id, res);
+}
+
+void IntervalEnvDom::widen_with_threshold(const IntervalEnvDom& other,
+                                          const ZNum& threshold) {
+    if (other.m_is_bottom) {
+        return;
+    }
+    if (m_is_bottom) {
+        *this = other;
+        return;
+    }
+    const ItvBound lower_limit = to_lower_bound(threshold);
+    const ItvBound upper_limit = to_upper_bound(threshold);
+    this->truncate(other.m_lbs.size());
+    for (std::size_t i = 0U; i < m_lbs.size(); ++i) {
+        if (other.m_lbs[i] < m_lbs[i]) {
+            m_lbs[i] =
+                lower_limit <= other.m_lbs[i] ? lower_limit : ItvMinusInf;
+        }
+        if (other.m_ubs[i] > m_ubs[i]) {
+            m_ubs[i] =
+                other.m_ubs[i] <= upper_limit ? upper_limit : ItvPlusInf;
+        }
+    }
+    this->trim();
+}
+
+void IntervalEnvDom::transfer_assign_constant(VarRef x, const ZNum& n) {
+    this->set_interval(x, {n, n});
+}
+
+void IntervalEnvDom::transfer_assign_variable(VarRef x, VarRef y) {
+    auto [lb, ub] = this->get_bounds(y);
+    this->set_bounds(x, lb, ub);
+}
+
+void IntervalEnvDom::transfer_assign_linear_expr(VarRef x,
+                                                 const LinearExpr& expr) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->set_interval(x, this->eval_interval(expr));
+}
+
+void IntervalEnvDom::apply(clang::UnaryOperatorKind op, VarRef x, VarRef y) {
+    if (m_is_bottom) {
+        return;
+    }
+    switch (op) {
+        case clang::UO_Plus: {
+            this->transfer_assign_variable(x, y);
+            break;
+        }
+        case clang::UO_Minus: {
+            this->set_interval(x, neg(this->get_interval(y)));
+            break;
+        }
+        case clang::UO_Not: {
+            // ~y == -y - 1
+            this->set_interval(x,
+                               add(neg(this->get_interval(y)),
+                                   {ZNum(-1), ZNum(-1)}));
+            break;
+        }
+        default: {
+            this->forget(x);
+            break;
+        }
+    }
+}
+
+void IntervalEnvDom::apply(clang::BinaryOperatorKind op,
+                           VarRef x,
+                           VarRef y,
+                           VarRef z) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->apply_intervals(op,
+                          x,
+                          this->get_interval(y),
+                          this->get_interval(z));
+}
+
+void IntervalEnvDom::apply(clang::BinaryOperatorKind op,
+                           VarRef x,
+                           VarRef y,
+                           const ZNum& z) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->apply_intervals(op, x, this->get_interval(y), {z, z});
+}
+
+void IntervalEnvDom::apply(clang::BinaryOperatorKind op,
+                           VarRef x,
+                           const ZNum& y,
+                           VarRef z) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->apply_intervals(op, x, {y, y}, this->get_interval(z));
+}
+
+void IntervalEnvDom::apply_intervals(clang::BinaryOperatorKind op,
+                                     VarRef x,
+                                     const ZInterval& y,
+                                     const ZInterval& z) {
+    switch (op) {
+        case clang::BO_Add: {
+            this->set_interval(x, add(y, z));
+            break;
+        }
+        case clang::BO_Sub: {
+            this->set_interval(x, add(y, neg(z)));
+            break;
+        }
+        case clang::BO_Mul: {
+            this->set_interval(x, mul(y, z));
+            break;
+        }
+        case clang::BO_Div: {
+            auto k = get_singleton(z);
+            if (!k || *k == 0) {
+                this->forget(x);
+            } else {
+                this->set_interval(x, div(y, *k));
+            }
+            break;
+        }
+        default: {
+            this->forget(x);
+            break;
+        }
+    }
+}
+
+void IntervalEnvDom::add_linear_constraint(const LinearConstraint& cst) {
+    if (m_is_bottom) {
+        return;
+    }
+    const auto& expr = cst.get_linear_expression();
+    switch (cst.get_constraint_kind()) {
+        case LinearConstraintKind::LCK_Inequality: {
+            this->add_inequality(expr);
+            break;
+        }
+        case LinearConstraintKind::LCK_Equality: {
+            this->add_inequality(expr);
+            this->add_inequality(-expr);
+            break;
+        }
+        case LinearConstraintKind::LCK_Disequation: {
+            // x + c != 0 cuts the bound of x which is -c, and the other
+            // disequations are only used if they contradict a constant.
+            const auto& terms = expr.get_variable_terms();
+            if (terms.size() == 1U && terms.begin()->second == 1) {
+                const VarRef x = terms.begin()->first;
+                const ZNum value = -expr.get_constant_term();
+                auto itv = this->get_interval(x);
+                if (itv.lb == value) {
+                    itv.lb = value + 1;
+                    this->set_interval(x, itv);
+                } else if (itv.ub == value) {
+                    itv.ub = value - 1;
+                    this->set_interval(x, itv);
+                }
+            } else if (get_singleton(this->eval_interval(expr)) == ZNum(0)) {
+                this->set_to_bottom();
+            }
+            break;
+        }
+    }
+}
+
+void IntervalEnvDom::merge_with_linear_constraint_system(
+    const LinearConstraintSystem& csts) {
+    LinearConstraintSystem normalized_csts(csts);
+    normalized_csts.normalize();
+    if (normalized_csts.is_false()) {
+        this->set_to_bottom();
+        return;
+    }
+    for (const auto& cst : normalized_csts) {
+        if (m_is_bottom) {
+            return;
+        }
+        this->add_linear_constraint(cst);
+    }
+}
+
+ZInterval IntervalEnvDom::eval_interval(const LinearExpr& expr) const {
+    ZInterval itv{expr.get_constant_term(), expr.get_constant_term()};
+    for (const auto& [var, factor] : expr.get_variable_terms()) {
+        itv = add(itv, scale(this->get_interval(var), factor));
+    }
+    return itv;
+}
+
+void IntervalEnvDom::add_inequality(const LinearExpr& expr) {
+    if (m_is_bottom) {
+        return;
+    }
+    const auto& terms = expr.get_variable_terms();
+    const ZNum& cst = expr.get_constant_term();
+    if (terms.empty()) {
+        if (cst > 0) {
+            this->set_to_bottom();
+        }
+        return;
+    }
+
+    // k * v <= -(c + the other terms) bounds each variable by the lower
+    // bound of the other terms, all taken before the update.
+    std::vector< std::pair< VarRef, ZInterval > > bounds;
+    for (const auto& [var, factor] : terms) {
+        ZInterval rest{cst, cst};
+        for (const auto& [other_var, other_factor] : terms) {
+            if (other_var != var) {
+                rest = add(rest,
+                           scale(this->get_interval(other_var),
+                                 other_factor));
+            }
+        }
+        if (!rest.lb) {
+            continue;
+        }
+        const ZNum limit = -*rest.lb;
+        auto itv = this->get_interval(var);
+        if (factor > 0) {
+            const ZNum ub = floor_div(limit, factor);
+            if (!itv.ub || ub < *itv.ub) {
+                itv.ub = ub;
+            }
+        } else {
+            const ZNum lb = ceil_div(limit, factor);
+            if (!itv.lb || *itv.lb < lb) {
+                itv.lb = lb;
+            }
+        }
+        bounds.emplace_back(var, itv);
+    }
+    for (const auto& [var, itv] : bounds) {
+        this->set_interval(var, itv);
+        if (m_is_bottom) {
+            return;
+        }
+    }
+}
+
+} // namespace knight::dfa
@@ -0,0 +1,199 @@
+//===- interval_kernels.cpp -------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the vectorized kernels over the bound arrays of
+//  the interval environments.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/domain/numerical/interval_kernels.hpp"
+#include "util/assert.hpp"
+
+#include <algorithm>
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#    define KNIGHT_ITV_KERNELS_AVX2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#    include <arm_neon.h>
+#    define KNIGHT_ITV_KERNELS_NEON
+#endif
+
+namespace knight::dfa {
+
+namespace {
+
+/// \brief The 64-bit lanes of the target, whose masks have all the bits
+/// of the lanes where the comparison holds.
+#if defined(KNIGHT_ITV_KERNELS_AVX2)
+struct Lanes {
+    using Vec = __m256i;
+    static constexpr std::size_t Width = 4U;
+
+    static Vec load(const ItvBound* ptr) {
+        return _mm256_loadu_si256(reinterpret_cast< const Vec* >(ptr));
+    }
+    static void store(ItvBound* ptr, Vec vec) {
+        _mm256_storeu_si256(reinterpret_cast< Vec* >(ptr), vec);
+    }
+    static Vec splat(ItvBound bound) { return _mm256_set1_epi64x(bound); }
+    static Vec zero() { return _mm256_setzero_si256(); }
+    static Vec gt(Vec lhs, Vec rhs) { return _mm256_cmpgt_epi64(lhs, rhs); }
+    static Vec either(Vec lhs, Vec rhs) { return _mm256_or_si256(lhs, rhs); }
+    static Vec select(Vec mask, Vec lhs, Vec rhs) {
+        return _mm256_blendv_epi8(rhs, lhs, mask);
+    }
+    static bool any(Vec mask) { return _mm256_testz_si256(mask, mask) == 0; }
+}; // struct Lanes
+#elif defined(KNIGHT_ITV_KERNELS_NEON)
+struct Lanes {
+    using Vec = int64x2_t;
+    static constexpr std::size_t Width = 2U;
+
+    static Vec load(const ItvBound* ptr) { return vld1q_s64(ptr); }
+    static void store(ItvBound* ptr, Vec vec) { vst1q_s64(ptr, vec); }
+    static Vec splat(ItvBound bound) { return vdupq_n_s64(bound); }
+    static Vec zero() { return vdupq_n_s64(0); }
+    static Vec gt(Vec lhs, Vec rhs) {
+        return vreinterpretq_s64_u64(vcgtq_s64(lhs, rhs));
+    }
+    static Vec either(Vec lhs, Vec rhs) { return vorrq_s64(lhs, rhs); }
+    static Vec select(Vec mask, Vec lhs, Vec rhs) {
+        return vbslq_s64(vreinterpretq_u64_s64(mask), lhs, rhs);
+    }
+    static bool any(Vec mask) {
+        return vmaxvq_u32(vreinterpretq_u32_s64(mask)) != 0U;
+    }
+}; // struct Lanes
+#endif
+
+#if defined(KNIGHT_ITV_KERNELS_AVX2) || defined(KNIGHT_ITV_KERNELS_NEON)
+#    define KNIGHT_ITV_KERNELS_SIMD
+
+/// \brief Lane-wise signed min and max, which neither AVX2 nor NEON has
+/// for 64-bit lanes.
+/// @{
+Lanes::Vec min(Lanes::Vec lhs, Lanes::Vec rhs) {
+    return Lanes::select(Lanes::gt(lhs, rhs), rhs, lhs);
+}
+Lanes::Vec max(Lanes::Vec lhs, Lanes::Vec rhs) {
+    return Lanes::select(Lanes::gt(lhs, rhs), lhs, rhs);
+}
+/// @}
+#endif
+
+} // anonymous namespace
+
+void join_itv_bounds(ItvBounds bounds, ConstItvBounds other) {
+    knight_assert(bounds.size <= other.size);
+    std::size_t i = 0U;
+#ifdef KNIGHT_ITV_KERNELS_SIMD
+    for (; i + Lanes::Width <= bounds.size; i += Lanes::Width) {
+        Lanes::store(bounds.lbs + i,
+                     min(Lanes::load(bounds.lbs + i),
+                         Lanes::load(other.lbs + i)));
+        Lanes::store(bounds.ubs + i,
+                     max(Lanes::load(bounds.ubs + i),
+                         Lanes::load(other.ubs + i)));
+    }
+#endif
+    for (; i < bounds.size; ++i) {
+        bounds.lbs[i] = std::min(bounds.lbs[i], other.lbs[i]);
+        bounds.ubs[i] = std::max(bounds.ubs[i], other.ubs[i]);
+    }
+}
+
+bool meet_itv_bounds(ItvBounds bounds, ConstItvBounds other) {
+    knight_assert(bounds.size <= other.size);
+    bool is_empty = false;
+    std::size_t i = 0U;
+#ifdef KNIGHT_ITV_KERNELS_SIMD
+    auto empty = Lanes::zero();
+    for (; i + Lanes::Width <= bounds.size; i += Lanes::Width) {
+        const auto lb =
+            max(Lanes::load(bounds.lbs + i), Lanes::load(other.lbs + i));
+        const auto ub =
+            min(Lanes::load(bounds.ubs + i), Lanes::load(other.ubs + i));
+        Lanes::store(bounds.lbs + i, lb);
+        Lanes::store(bounds.ubs + i, ub);
+        empty = Lanes::either(empty, Lanes::gt(lb, ub));
+    }
+    is_empty = Lanes::any(empty);
+#endif
+    for (; i < bounds.size; ++i) {
+        bounds.lbs[i] = std::max(bounds.lbs[i], other.lbs[i]);
+        bounds.ubs[i] = std::min(bounds.ubs[i], other.ubs[i]);
+        is_empty = is_empty || bounds.lbs[i] > bounds.ubs[i];
+    }
+    return is_empty;
+}
+
+void widen_itv_bounds(ItvBounds bounds, ConstItvBounds other) {
+    knight_assert(bounds.size <= other.size);
+    std::size_t i = 0U;
+#ifdef KNIGHT_ITV_KERNELS_SIMD
+    const auto minus_inf = Lanes::splat(ItvMinusInf);
+    const auto plus_inf = Lanes::splat(ItvPlusInf);
+    for (; i + Lanes::Width <= bounds.size; i += Lanes::Width) {
+        const auto lb = Lanes::load(bounds.lbs + i);
+        const auto ub = Lanes::load(bounds.ubs + i);
+        Lanes::store(bounds.lbs + i,
+                     Lanes::select(Lanes::gt(lb, Lanes::load(other.lbs + i)),
+                                   minus_inf,
+                                   lb));
+        Lanes::store(bounds.ubs + i,
+                     Lanes::select(Lanes::gt(Lanes::load(other.ubs + i), ub),
+                                   plus_inf,
+                                   ub));
+    }
+#endif
+    for (; i < bounds.size; ++i) {
+        if (other.lbs[i] < bounds.lbs[i]) {
+            bounds.lbs[i] = ItvMinusInf;
+        }
+        if (other.ubs[i] > bounds.ubs[i]) {
+            bounds.ubs[i] = ItvPlusInf;
+        }
+    }
+}
+
+bool leq_itv_bounds(ConstItvBounds bounds, ConstItvBounds other) {
+    knight_assert(bounds.size <= other.size);
+    std::size_t i = 0U;
+#ifdef KNIGHT_ITV_KERNELS_SIMD
+    for (; i + Lanes::Width <= bounds.size; i += Lanes::Width) {
+        const auto outside =
+            Lanes::either(Lanes::gt(Lanes::load(other.lbs + i),
+                                    Lanes::load(bounds.lbs + i)),
+                          Lanes::gt(Lanes::load(bounds.ubs + i),
+                                    Lanes::load(other.ubs + i)));
+        if (Lanes::any(outside)) {
+            return false;
+        }
+    }
+#endif
+    for (; i < bounds.size; ++i) {
+        if (other.lbs[i] > bounds.lbs[i] || bounds.ubs[i] > other.ubs[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+llvm::StringRef get_itv_kernels_isa() {
+#if defined(KNIGHT_ITV_KERNELS_AVX2)
+    return "avx2";
+#elif defined(KNIGHT_ITV_KERNELS_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace knight::dfa
@@ -0,0 +1,445 @@
+//===- known_bits_dom.cpp ---------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the known bits environment domain.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/domain/numerical/known_bits_dom.hpp"
+
+#include <llvm/Support/Format.h>
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+namespace knight::dfa {
+
+namespace {
+
+constexpr uint64_t AllBits = ~uint64_t(0);
+
+/// \brief Get the mask of the `n` low bits.
+uint64_t get_low_mask(unsigned n) {
+    return n >= 64U ? AllBits : (uint64_t(1) << n) - 1U;
+}
+
+/// \brief The sum `lhs + rhs + carry`, whose bits are known where the
+/// bits of both operands and of the carry into them are.
+KnownBits add_with_carry(const KnownBits& lhs,
+                         const KnownBits& rhs,
+                         bool carry) {
+    // The sums of the largest and of the least values of the operands
+    // tell the carries that are known, as the carries are monotonic.
+    const uint64_t possible_sum_zero =
+        ~lhs.zeros + ~rhs.zeros + static_cast< uint64_t >(carry);
+    const uint64_t possible_sum_one =
+        lhs.ones + rhs.ones + static_cast< uint64_t >(carry);
+    const uint64_t carry_known_zero =
+        ~(possible_sum_zero ^ lhs.zeros ^ rhs.zeros);
+    const uint64_t carry_known_one = possible_sum_one ^ lhs.ones ^ rhs.ones;
+    const uint64_t known = lhs.get_known() & rhs.get_known() &
+                           (carry_known_zero | carry_known_one);
+    return {~possible_sum_zero & known, possible_sum_one & known};
+}
+
+/// \brief Get the shift amount `k`, if it is a valid one.
+std::optional< unsigned > get_shift(const std::optional< ZNum >& k) {
+    if (!k || *k < 0 || *k >= 64) {
+        return std::nullopt;
+    }
+    return static_cast< unsigned >(*k->get_int64());
+}
+
+} // anonymous namespace
+
+KnownBits KnownBits::constant(const ZNum& n) {
+    return constant(n.get_apint().extractBitsAsZExtValue(64U, 0U));
+}
+
+unsigned KnownBits::get_known_low_bits() const {
+    return static_cast< unsigned >(std::countr_one(this->get_known()));
+}
+
+KnownBits KnownBits::operator-() const {
+    return constant(uint64_t(0)) - *this;
+}
+
+KnownBits KnownBits::operator+(const KnownBits& other) const {
+    return add_with_carry(*this, other, /*carry=*/false);
+}
+
+KnownBits KnownBits::operator-(const KnownBits& other) const {
+    // lhs - rhs == lhs + ~rhs + 1
+    return add_with_carry(*this, ~other, /*carry=*/true);
+}
+
+KnownBits KnownBits::operator*(const KnownBits& other) const {
+    if (this->is_constant() && other.is_constant()) {
+        return constant(ones * other.ones);
+    }
+    // The low bits of the product only depend on the low bits of the
+    // operands, and the trailing zeros add up.
+    const unsigned low_bits =
+        std::min(this->get_known_low_bits(), other.get_known_low_bits());
+    const uint64_t low_mask = get_low_mask(low_bits);
+    const uint64_t low_value = ones * other.ones & low_mask;
+    const auto trailing_zeros =
+        static_cast< unsigned >(std::countr_one(zeros) +
+                                std::countr_one(other.zeros));
+    return {(~low_value & low_mask) | get_low_mask(trailing_zeros),
+            low_value};
+}
+
+KnownBits KnownBits::shl(unsigned k) const {
+    if (k >= 64U) {
+        return constant(uint64_t(0));
+    }
+    return {zeros << k | get_low_mask(k), ones << k};
+}
+
+KnownBits KnownBits::shr(unsigned k) const {
+    if (k >= 64U) {
+        return {};
+    }
+    // The k high bits come from the bits past the low 64 ones.
+    return {zeros >> k, ones >> k};
+}
+
+KnownBits KnownBits::rem(const ZNum& k) const {
+    // x % k == x (mod k) keeps the low bits of x below the trailing zeros
+    // of k, whatever the signs.
+    const uint64_t k_bits = k.get_apint().extractBitsAsZExtValue(64U, 0U);
+    const uint64_t mask = get_low_mask(
+        static_cast< unsigned >(std::countr_zero(k_bits)));
+    return {zeros & mask, ones & mask};
+}
+
+void KnownBits::dump(llvm::raw_ostream& os) const {
+    if (this->is_constant()) {
+        os << llvm::format_hex(ones, 18U);
+        return;
+    }
+    os << "(zeros: " << llvm::format_hex(zeros, 18U)
+       << ", ones: " << llvm::format_hex(ones, 18U) << ")";
+}
+
+void KnownBitsEnvDom::set_bits(DenseVarID id, KnownBits bits) {
+    if (m_is_bottom) {
+        return;
+    }
+    if (bits.has_conflict()) {
+        this->set_to_bottom();
+        return;
+    }
+    if (id >= m_bits.size()) {
+        if (bits.is_top()) {
+            return;
+        }
+        m_bits.resize(id + 1U);
+    }
+    m_bits[id] = bits;
+    this->trim();
+}
+
+void KnownBitsEnvDom::join_with(const KnownBitsEnvDom& other) {
+    if (other.m_is_bottom) {
+        return;
+    }
+    if (m_is_bottom) {
+        *this = other;
+        return;
+    }
+    // The variables top in the other environment stay top.
+    if (m_bits.size() > other.m_bits.size()) {
+        m_bits.resize(other.m_bits.size());
+    }
+    for (std::size_t i = 0U; i < m_bits.size(); ++i) {
+        m_bits[i] = m_bits[i].join(other.m_bits[i]);
+    }
+    this->trim();
+}
+
+void KnownBitsEnvDom::meet_with(const KnownBitsEnvDom& other) {
+    if (m_is_bottom) {
+        return;
+    }
+    if (other.m_is_bottom) {
+        this->set_to_bottom();
+        return;
+    }
+    if (m_bits.size() < other.m_bits.size()) {
+        m_bits.resize(other.m_bits.size());
+    }
+    for (std::size_t i = 0U; i < other.m_bits.size(); ++i) {
+        m_bits[i] = m_bits[i].meet(other.m_bits[i]);
+        if (m_bits[i].has_conflict()) {
+            this->set_to_bottom();
+            return;
+        }
+    }
+}
+
+bool KnownBitsEnvDom::leq(const KnownBitsEnvDom& other) const {
+    if (m_is_bottom) {
+        return true;
+    }
+    if (other.m_is_bottom) {
+        return false;
+    }
+    // The last variable known in the other environment is top in this
+    // one.
+    if (m_bits.size() < other.m_bits.size()) {
+        return false;
+    }
+    for (std::size_t i = 0U; i < other.m_bits.size(); ++i) {
+        if (!m_bits[i].leq(other.m_bits[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void KnownBitsEnvDom::dump(llvm::raw_ostream& os) const {
+    if (m_is_bottom) {
+        os << "_|_";
+        return;
+    }
+    os << "{";
+    bool first = true;
+    for (std::size_t i = 0U; i < m_bits.size(); ++i) {
+        if (m_bits[i].is_top()) {
+            continue;
+        }
+        if (!first) {
+            os << ", ";
+        }
+        os << "v" << i << ": ";
+        m_bits[i].dump(os);
+        first = false;
+    }
+    os << "}";
+}
+
+void KnownBitsEnvDom::transfer_assign_constant(VarRef x, const ZNum& n) {
+    this->set_bits(x, KnownBits::constant(n));
+}
+
+void KnownBitsEnvDom::transfer_assign_variable(VarRef x, VarRef y) {
+    this->set_bits(x, this->get_bits(y));
+}
+
+void KnownBitsEnvDom::transfer_assign_linear_expr(VarRef x,
+                                                  const LinearExpr& expr) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->set_bits(x, this->eval_bits(expr));
+}
+
+void KnownBitsEnvDom::apply(clang::UnaryOperatorKind op,
+                            VarRef x,
+                            VarRef y) {
+    if (m_is_bottom) {
+        return;
+    }
+    switch (op) {
+        case clang::UO_Plus: {
+            this->transfer_assign_variable(x, y);
+            break;
+        }
+        case clang::UO_Minus: {
+            this->set_bits(x, -this->get_bits(y));
+            break;
+        }
+        case clang::UO_Not: {
+            this->set_bits(x, ~this->get_bits(y));
+            break;
+        }
+        default: {
+            this->forget(x);
+            break;
+        }
+    }
+}
+
+void KnownBitsEnvDom::apply(clang::BinaryOperatorKind op,
+                            VarRef x,
+                            VarRef y,
+                            VarRef z) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->apply_bits(op,
+                     x,
+                     this->get_bits(y),
+                     this->get_bits(z),
+                     std::nullopt);
+}
+
+void KnownBitsEnvDom::apply(clang::BinaryOperatorKind op,
+                            VarRef x,
+                            VarRef y,
+                            const ZNum& z) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->apply_bits(op, x, this->get_bits(y), KnownBits::constant(z), z);
+}
+
+void KnownBitsEnvDom::apply(clang::BinaryOperatorKind op,
+                            VarRef x,
+                            const ZNum& y,
+                            VarRef z) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->apply_bits(op,
+                     x,
+                     KnownBits::constant(y),
+                     this->get_bits(z),
+                     std::nullopt);
+}
+
+void KnownBitsEnvDom::apply_bits(clang::BinaryOperatorKind op,
+                                 VarRef x,
+                                 const KnownBits& y,
+                                 const KnownBits& z,
+                                 const std::optional< ZNum >& k) {
+    switch (op) {
+        case clang::BO_Add: {
+            this->set_bits(x, y + z);
+            return;
+        }
+        case clang::BO_Sub: {
+            this->set_bits(x, y - z);
+            return;
+        }
+        case clang::BO_Mul: {
+            this->set_bits(x, y * z);
+            return;
+        }
+        case clang::BO_And: {
+            this->set_bits(x, y & z);
+            return;
+        }
+        case clang::BO_Or: {
+            this->set_bits(x, y | z);
+            return;
+        }
+        case clang::BO_Xor: {
+            this->set_bits(x, y ^ z);
+            return;
+        }
+        case clang::BO_Shl: {
+            if (auto shift = get_shift(k)) {
+                this->set_bits(x, y.shl(*shift));
+                return;
+            }
+            break;
+        }
+        case clang::BO_Shr: {
+            if (auto shift = get_shift(k)) {
+                this->set_bits(x, y.shr(*shift));
+                return;
+            }
+            break;
+        }
+        case clang::BO_Rem: {
+            if (k && *k != 0) {
+                this->set_bits(x, y.rem(*k));
+                return;
+            }
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+    this->forget(x);
+}
+
+void KnownBitsEnvDom::add_linear_constraint(const LinearConstraint& cst) {
+    if (m_is_bottom) {
+        return;
+    }
+    // Only the equalities tell the low bits, the order of the values
+    // depending on their high bits.
+    if (cst.get_constraint_kind() == LinearConstraintKind::LCK_Equality) {
+        this->add_equality(cst.get_linear_expression());
+    }
+}
+
+void KnownBitsEnvDom::merge_with_linear_constraint_system(
+    const LinearConstraintSystem& csts) {
+    LinearConstraintSystem normalized_csts(csts);
+    normalized_csts.normalize();
+    if (normalized_csts.is_false()) {
+        this->set_to_bottom();
+        return;
+    }
+    for (const auto& cst : normalized_csts) {
+        if (m_is_bottom) {
+            return;
+        }
+        this->add_linear_constraint(cst);
+    }
+}
+
+KnownBits KnownBitsEnvDom::eval_bits(const LinearExpr& expr) const {
+    auto bits = KnownBits::constant(expr.get_constant_term());
+    for (const auto& [var, factor] : expr.get_variable_terms()) {
+        bits = bits + this->get_bits(var) * KnownBits::constant(factor);
+    }
+    return bits;
+}
+
+void KnownBitsEnvDom::add_equality(const LinearExpr& expr) {
+    // The expression is not zero if one of its low bits is one.
+    if (this->eval_bits(expr).ones != 0U) {
+        this->set_to_bottom();
+        return;
+    }
+
+    // k * v == -(c + the other terms) gives the bits of v for a unit k,
+    // all taken before the update.
+    const auto& terms = expr.get_variable_terms();
+    std::vector< std::pair< VarRef, KnownBits > > bits;
+    for (const auto& [var, factor] : terms) {
+        if (factor != 1 && factor != -1) {
+            continue;
+        }
+        auto rest = KnownBits::constant(expr.get_constant_term());
+        for (const auto& [other_var, other_factor] : terms) {
+            if (other_var != var) {
+                rest = rest + this->get_bits(other_var) *
+                                  KnownBits::constant(other_factor);
+            }
+        }
+        bits.emplace_back(var, factor == 1 ? -rest : rest);
+    }
+    // k * v == -c for a single variable.
+    if (terms.size() == 1U && bits.empty()) {
+        const auto& [var, factor] = *terms.begin();
+        const ZNum value = -expr.get_constant_term();
+        if (value % factor != 0) {
+            this->set_to_bottom();
+            return;
+        }
+        bits.emplace_back(var, KnownBits::constant(value / factor));
+    }
+    for (const auto& [var, var_bits] : bits) {
+        this->meet_bits(var, var_bits);
+        if (m_is_bottom) {
+            return;
+        }
+    }
+}
+
+} // namespace knight::dfa
@@ -0,0 +1,149 @@
+//===- product_dom.cpp ------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the reductions between the numerical domains.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/domain/numerical/product_dom.hpp"
+
+#include <bit>
+#include <cstdint>
+
+namespace knight::dfa {
+
+namespace {
+
+constexpr uint64_t AllBits = ~uint64_t(0);
+
+/// \brief Get the mask of the `n` low bits.
+uint64_t get_low_mask(unsigned n) {
+    return n >= 64U ? AllBits : (uint64_t(1) << n) - 1U;
+}
+
+/// \brief The remainder in `[0, m)` for a positive `m`.
+ZNum mod_floor(const ZNum& n, const ZNum& m) {
+    ZNum rem = n % m;
+    if (rem < 0) {
+        rem += m;
+    }
+    return rem;
+}
+
+} // anonymous namespace
+
+void DomReduction< IntervalEnvDom, CongruenceEnvDom >::reduce(
+    IntervalEnvDom& itvs, const CongruenceEnvDom& congs) {
+    for (DenseVarID id = 0U; id < congs.get_size(); ++id) {
+        const auto cong = congs.get_congruence(id);
+        if (cong.is_top()) {
+            continue;
+        }
+        if (auto n = cong.get_constant()) {
+            itvs.meet_interval(id, {*n, *n});
+        } else {
+            // The bounds move to the nearest values of aZ + b within.
+            const ZNum& mod = cong.get_modulus();
+            const ZNum& rem = cong.get_remainder();
+            auto itv = itvs.get_interval(id);
+            if (itv.lb) {
+                *itv.lb += mod_floor(rem - *itv.lb, mod);
+            }
+            if (itv.ub) {
+                *itv.ub -= mod_floor(*itv.ub - rem, mod);
+            }
+            itvs.meet_interval(id, itv);
+        }
+        if (itvs.is_bottom()) {
+            return;
+        }
+    }
+}
+
+void DomReduction< CongruenceEnvDom, IntervalEnvDom >::reduce(
+    CongruenceEnvDom& congs, const IntervalEnvDom& itvs) {
+    for (DenseVarID id = 0U; id < itvs.get_size(); ++id) {
+        auto [lb, ub] = itvs.get_bounds(id);
+        if (lb != ub) {
+            continue;
+        }
+        congs.meet_congruence(id, Congruence::constant(lb));
+        if (congs.is_bottom()) {
+            return;
+        }
+    }
+}
+
+void DomReduction< CongruenceEnvDom, KnownBitsEnvDom >::reduce(
+    CongruenceEnvDom& congs, const KnownBitsEnvDom& bits) {
+    for (DenseVarID id = 0U; id < bits.get_size(); ++id) {
+        const auto var_bits = bits.get_bits(id);
+        const unsigned n = var_bits.get_known_low_bits();
+        if (n == 0U) {
+            continue;
+        }
+        const ZNum mod =
+            n >= 64U ? ZNum(AllBits) + 1 : ZNum(uint64_t(1) << n);
+        congs.meet_congruence(id,
+                              Congruence(mod,
+                                         ZNum(var_bits.ones &
+                                              get_low_mask(n))));
+        if (congs.is_bottom()) {
+            return;
+        }
+    }
+}
+
+void DomReduction< KnownBitsEnvDom, IntervalEnvDom >::reduce(
+    KnownBitsEnvDom& bits, const IntervalEnvDom& itvs) {
+    for (DenseVarID id = 0U; id < itvs.get_size(); ++id) {
+        auto [lb, ub] = itvs.get_bounds(id);
+        KnownBits var_bits;
+        if (lb == ub) {
+            var_bits = KnownBits::constant(static_cast< uint64_t >(lb));
+        } else if (lb >= 0 && ub != ItvPlusInf) {
+            // The bits above the width of the upper bound are zero.
+            var_bits.zeros = ~get_low_mask(static_cast< unsigned >(
+                std::bit_width(static_cast< uint64_t >(ub))));
+        } else if (ub < 0 && lb != ItvMinusInf) {
+            // ~x is within [0, ~lb], and its high bits are zero.
+            var_bits.ones = ~get_low_mask(static_cast< unsigned >(
+                std::bit_width(static_cast< uint64_t >(~lb))));
+        } else {
+            continue;
+        }
+        bits.meet_bits(id, var_bits);
+        if (bits.is_bottom()) {
+            return;
+        }
+    }
+}
+
+void DomReduction< KnownBitsEnvDom, CongruenceEnvDom >::reduce(
+    KnownBitsEnvDom& bits, const CongruenceEnvDom& congs) {
+    for (DenseVarID id = 0U; id < congs.get_size(); ++id) {
+        const auto cong = congs.get_congruence(id);
+        if (cong.is_top()) {
+            continue;
+        }
+        // x == b (mod a) fixes the bits of x below the trailing zeros of
+        // a, which are all of them for a constant.
+        const uint64_t mod_bits =
+            cong.get_modulus().get_apint().extractBitsAsZExtValue(64U, 0U);
+        const uint64_t mask =
+            get_low_mask(static_cast< unsigned >(std::countr_zero(mod_bits)));
+        const auto rem_bits = KnownBits::constant(cong.get_remainder());
+        bits.meet_bits(id, {rem_bits.zeros & mask, rem_bits.ones & mask});
+        if (bits.is_bottom()) {
+            return;
+        }
+    }
+}
+
+} // namespace knight::dfa
@@ -0,0 +1,846 @@
+//===- zone_dom.cpp ---------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the zone domain.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/domain/numerical/zone_dom.hpp"
+
+#include <llvm/ADT/STLExtras.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace knight::dfa {
+
+namespace {
+
+using Bound = ZoneDom::Bound;
+using Interval = ZoneDom::Interval;
+
+constexpr Bound Inf = ZoneDom::Inf;
+constexpr Bound MinBound = -Inf + 1;
+constexpr std::size_t NoIndex = static_cast< std::size_t >(-1);
+
+/// \brief Relax the number to a bound of the matrix.
+Bound to_bound(const ZNum& num) {
+    if (num >= Inf) {
+        return Inf;
+    }
+    if (num < MinBound) {
+        return MinBound;
+    }
+    return *num.get_int64();
+}
+
+std::optional< ZNum > to_num(Bound bound) {
+    if (bound == Inf) {
+        return std::nullopt;
+    }
+    return bound;
+}
+
+/// \brief The sum of two bounds, relaxed to a bound of the matrix.
+Bound add_bounds(Bound lhs, Bound rhs) {
+    if (lhs == Inf || rhs == Inf) {
+        return Inf;
+    }
+    return std::clamp(lhs + rhs, MinBound, Inf);
+}
+
+/// \brief row[b] = min(row[b], bound + via[b]) for a finite bound.
+///
+/// This is the inner loop of the closures, written without branches so
+/// that it vectorizes.
+void relax_row(Bound* row, const Bound* via, Bound bound, std::size_t dim) {
+    for (std::size_t b = 0U; b < dim; ++b) {
+        const Bound sum = std::clamp(bound + via[b], MinBound, Inf);
+        row[b] = std::min(row[b], via[b] == Inf ? Inf : sum);
+    }
+}
+
+using itv::add;
+using itv::ceil_div;
+using itv::div;
+using itv::floor_div;
+using itv::get_singleton;
+using itv::mul;
+using itv::neg;
+using itv::scale;
+
+void dump_bound(llvm::raw_ostream& os,
+                const std::optional< ZNum >& bound,
+                llvm::StringRef inf) {
+    if (bound) {
+        os << *bound;
+    } else {
+        os << inf;
+    }
+}
+
+} // anonymous namespace
+
+ZoneDom::Interval ZoneDom::get_interval(VarRef x) const {
+    if (m_is_bottom) {
+        return {ZNum(1), ZNum(0)};
+    }
+    auto index = find_index(x);
+    if (!index) {
+        return {};
+    }
+    Interval itv;
+    if (at(*index, 0U) != Inf) {
+        itv.lb = -ZNum(at(*index, 0U));
+    }
+    itv.ub = to_num(at(0U, *index));
+    return itv;
+}
+
+std::optional< ZNum > ZoneDom::get_difference_bound(VarRef x,
+                                                    VarRef y) const {
+    if (m_is_bottom) {
+        return std::nullopt;
+    }
+    if (x == y) {
+        return ZNum(0);
+    }
+    auto x_index = find_index(x);
+    auto y_index = find_index(y);
+    if (x_index && y_index) {
+        return to_num(at(*x_index, *y_index));
+    }
+    return add(get_interval(y), neg(get_interval(x))).ub;
+}
+
+void ZoneDom::set_to_bottom() {
+    this->set_to_top();
+    m_is_bottom = true;
+}
+
+void ZoneDom::set_to_top() {
+    m_is_bottom = false;
+    m_is_closed = true;
+    std::vector< DenseVarID >().swap(m_vars);
+    m_dbm.assign(1U, 0);
+}
+
+void ZoneDom::join_with(const ZoneDom& other) {
+    this->close();
+    ZoneDom closed_other;
+    const ZoneDom* rhs = &other;
+    if (!other.m_is_closed) {
+        closed_other = other;
+        closed_other.close();
+        rhs = &closed_other;
+    }
+    if (rhs->m_is_bottom) {
+        return;
+    }
+    if (m_is_bottom) {
+        *this = *rhs;
+        return;
+    }
+    // The join of two closed matrices is closed.
+    combine_on_common(*rhs, [](Bound bound, Bound other_bound) {
+        return std::max(bound, other_bound);
+    });
+}
+
+void ZoneDom::widen_with(const ZoneDom& other) {
+    if (other.m_is_bottom) {
+        return;
+    }
+    if (m_is_bottom) {
+        *this = other;
+        return;
+    }
+    ZoneDom rhs = other;
+    rhs.close();
+    if (rhs.m_is_bottom) {
+        return;
+    }
+    combine_on_common(rhs, [](Bound bound, Bound other_bound) {
+        return other_bound <= bound ? bound : Inf;
+    });
+    m_is_closed = false;
+}
+
+void ZoneDom::widen_with_thresholds(const ZoneDom& other,
+                                    const Thresholds& thresholds) {
+    if (other.m_is_bottom) {
+        return;
+    }
+    if (m_is_bottom) {
+        *this = other;
+        return;
+    }
+    ZoneDom rhs = other;
+    rhs.close();
+    if (rhs.m_is_bottom) {
+        return;
+    }
+    combine_on_common(rhs, [&thresholds](Bound bound, Bound other_bound) {
+        if (other_bound <= bound) {
+            return bound;
+        }
+        auto threshold = thresholds.get_upper(other_bound);
+        return threshold ? to_bound(*threshold) : Inf;
+    });
+    m_is_closed = false;
+}
+
+void ZoneDom::widen_with_threshold(const ZoneDom& other,
+                                   const ZNum& threshold) {
+    if (other.m_is_bottom) {
+        return;
+    }
+    if (m_is_bottom) {
+        *this = other;
+        return;
+    }
+    ZoneDom rhs = other;
+    rhs.close();
+    if (rhs.m_is_bottom) {
+        return;
+    }
+    const Bound limit = to_bound(threshold);
+    combine_on_common(rhs, [limit](Bound bound, Bound other_bound) {
+        if (other_bound <= bound) {
+            return bound;
+        }
+        return other_bound <= limit ? limit : Inf;
+    });
+    m_is_closed = false;
+}
+
+void ZoneDom::meet_with(const ZoneDom& other) {
+    if (m_is_bottom) {
+        return;
+    }
+    if (other.m_is_bottom) {
+        this->set_to_bottom();
+        return;
+    }
+    combine_on_union(other, [](Bound bound, Bound other_bound) {
+        return std::min(bound, other_bound);
+    });
+    this->close();
+}
+
+void ZoneDom::narrow_with(const ZoneDom& other) {
+    if (m_is_bottom) {
+        return;
+    }
+    if (other.m_is_bottom) {
+        this->set_to_bottom();
+        return;
+    }
+    // Only the infinite bounds are refined.
+    combine_on_union(other, [](Bound bound, Bound other_bound) {
+        return bound == Inf ? other_bound : bound;
+    });
+    this->close();
+}
+
+void ZoneDom::narrow_with_threshold(const ZoneDom& other,
+                                    const ZNum& /*threshold*/) {
+    this->narrow_with(other);
+}
+
+bool ZoneDom::leq(const ZoneDom& other) const {
+    if (m_is_bottom) {
+        return true;
+    }
+    if (other.m_is_bottom) {
+        return false;
+    }
+    ZoneDom closed;
+    const ZoneDom* lhs = this;
+    if (!m_is_closed) {
+        closed = *this;
+        closed.close();
+        if (closed.m_is_bottom) {
+            return true;
+        }
+        lhs = &closed;
+    }
+    if (lhs->m_vars == other.m_vars) {
+        return llvm::all_of(llvm::zip(lhs->m_dbm, other.m_dbm),
+                            [](const auto& bounds) {
+                                return std::get< 0 >(bounds) <=
+                                       std::get< 1 >(bounds);
+                            });
+    }
+
+    // The variables of this matrix only are unconstrained in the other,
+    // and the ones of the other only must be unconstrained.
+    const std::size_t dim = other.get_dim();
+    std::vector< std::size_t > indexes(dim, 0U);
+    for (std::size_t i = 1U; i < dim; ++i) {
+        indexes[i] = lhs->find_index(other.m_vars[i - 1U]).value_or(NoIndex);
+    }
+    for (std::size_t i = 0U; i < dim; ++i) {
+        for (std::size_t j = 0U; j < dim; ++j) {
+            const Bound bound = other.at(i, j);
+            if (bound == Inf || i == j) {
+                continue;
+            }
+            if (indexes[i] == NoIndex || indexes[j] == NoIndex ||
+                lhs->at(indexes[i], indexes[j]) > bound) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool ZoneDom::equals(const ZoneDom& other) const {
+    if (m_is_bottom || other.m_is_bottom) {
+        return m_is_bottom == other.m_is_bottom;
+    }
+    if (m_is_closed && other.m_is_closed) {
+        return m_vars == other.m_vars && m_dbm == other.m_dbm;
+    }
+    return this->leq(other) && other.leq(*this);
+}
+
+void ZoneDom::Profile(llvm::FoldingSetNodeID& id) const { // NOLINT
+    id.AddBoolean(m_is_bottom);
+    id.AddBoolean(m_is_closed);
+    id.AddInteger(m_vars.size());
+    for (auto var : m_vars) {
+        id.AddInteger(var);
+    }
+    for (auto bound : m_dbm) {
+        id.AddInteger(bound);
+    }
+}
+
+void ZoneDom::dump(llvm::raw_ostream& os) const {
+    if (m_is_bottom) {
+        os << "_|_";
+        return;
+    }
+    os << "{";
+    bool first = true;
+    auto separate = [&os, &first]() {
+        if (!first) {
+            os << ", ";
+        }
+        first = false;
+    };
+    for (std::size_t i = 1U; i < get_dim(); ++i) {
+        auto itv = get_interval(m_vars[i - 1U]);
+        if (!itv.lb && !itv.ub) {
+            continue;
+        }
+        separate();
+        os << "v" << m_vars[i - 1U] << ": [";
+        dump_bound(os, itv.lb, "-oo");
+        os << ", ";
+        dump_bound(os, itv.ub, "+oo");
+        os << "]";
+    }
+    for (std::size_t i = 1U; i < get_dim(); ++i) {
+        for (std::size_t j = 1U; j < get_dim(); ++j) {
+            if (i == j || at(i, j) == Inf) {
+                continue;
+            }
+            separate();
+            os << "v" << m_vars[j - 1U] << " - v" << m_vars[i - 1U]
+               << " <= " << at(i, j);
+        }
+    }
+    os << "}";
+}
+
+void ZoneDom::transfer_assign_constant(VarRef x, const ZNum& n) {
+    this->assign_interval(x, {n, n});
+}
+
+void ZoneDom::transfer_assign_variable(VarRef x, VarRef y) {
+    this->assign_shifted(x, y, 0);
+}
+
+void ZoneDom::transfer_assign_linear_expr(VarRef x, const LinearExpr& expr) {
+    const auto& terms = expr.get_variable_terms();
+    if (terms.size() == 1U && terms.begin()->second == 1) {
+        this->assign_shifted(x,
+                             terms.begin()->first,
+                             expr.get_constant_term());
+    } else {
+        this->assign_interval(x, this->eval_interval(expr));
+    }
+}
+
+void ZoneDom::apply(clang::UnaryOperatorKind op, VarRef x, VarRef y) {
+    switch (op) {
+        case clang::UO_Plus: {
+            this->assign_shifted(x, y, 0);
+            break;
+        }
+        case clang::UO_Minus: {
+            this->assign_interval(x, neg(this->get_interval(y)));
+            break;
+        }
+        case clang::UO_Not: {
+            // ~y == -y - 1
+            this->assign_interval(x,
+                                  add(neg(this->get_interval(y)),
+                                      {ZNum(-1), ZNum(-1)}));
+            break;
+        }
+        default: {
+            this->forget(x);
+            break;
+        }
+    }
+}
+
+void ZoneDom::apply(clang::BinaryOperatorKind op,
+                    VarRef x,
+                    VarRef y,
+                    VarRef z) {
+    const auto y_itv = this->get_interval(y);
+    const auto z_itv = this->get_interval(z);
+    switch (op) {
+        case clang::BO_Add: {
+            if (auto k = get_singleton(z_itv)) {
+                this->assign_shifted(x, y, *k);
+            } else if (auto k = get_singleton(y_itv)) {
+                this->assign_shifted(x, z, *k);
+            } else {
+                this->assign_interval(x, add(y_itv, z_itv));
+            }
+            break;
+        }
+        case clang::BO_Sub: {
+            if (auto k = get_singleton(z_itv)) {
+                this->assign_shifted(x, y, -*k);
+            } else {
+                this->assign_interval(x, add(y_itv, neg(z_itv)));
+            }
+            break;
+        }
+        case clang::BO_Mul: {
+            this->assign_interval(x, mul(y_itv, z_itv));
+            break;
+        }
+        default: {
+            this->forget(x);
+            break;
+        }
+    }
+}
+
+void ZoneDom::apply(clang::BinaryOperatorKind op,
+                    VarRef x,
+                    VarRef y,
+                    const ZNum& z) {
+    switch (op) {
+        case clang::BO_Add: {
+            this->assign_shifted(x, y, z);
+            break;
+        }
+        case clang::BO_Sub: {
+            this->assign_shifted(x, y, -z);
+            break;
+        }
+        case clang::BO_Mul: {
+            this->assign_interval(x, scale(this->get_interval(y), z));
+            break;
+        }
+        case clang::BO_Div: {
+            if (z == 0) {
+                this->forget(x);
+            } else {
+                this->assign_interval(x, div(this->get_interval(y), z));
+            }
+            break;
+        }
+        default: {
+            this->forget(x);
+            break;
+        }
+    }
+}
+
+void ZoneDom::apply(clang::BinaryOperatorKind op,
+                    VarRef x,
+                    const ZNum& y,
+                    VarRef z) {
+    switch (op) {
+        case clang::BO_Add: {
+            this->assign_shifted(x, z, y);
+            break;
+        }
+        case clang::BO_Sub: {
+            this->assign_interval(x,
+                                  add({y, y}, neg(this->get_interval(z))));
+            break;
+        }
+        case clang::BO_Mul: {
+            this->assign_interval(x, scale(this->get_interval(z), y));
+            break;
+        }
+        default: {
+            this->forget(x);
+            break;
+        }
+    }
+}
+
+void ZoneDom::add_linear_constraint(const LinearConstraint& cst) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->close();
+    const auto& expr = cst.get_linear_expression();
+    switch (cst.get_constraint_kind()) {
+        case LinearConstraintKind::LCK_Inequality: {
+            this->add_inequality(expr);
+            break;
+        }
+        case LinearConstraintKind::LCK_Equality: {
+            this->add_inequality(expr);
+            this->add_inequality(-expr);
+            break;
+        }
+        case LinearConstraintKind::LCK_Disequation: {
+            // Only the disequations contradicting a constant are used.
+            auto itv = this->eval_interval(expr);
+            if (get_singleton(itv) == ZNum(0)) {
+                this->set_to_bottom();
+            }
+            break;
+        }
+    }
+}
+
+void ZoneDom::merge_with_linear_constraint_system(
+    const LinearConstraintSystem& csts) {
+    // Each constraint costs a closure, hence drop the redundant ones.
+    LinearConstraintSystem normalized_csts(csts);
+    normalized_csts.normalize();
+    if (normalized_csts.is_false()) {
+        this->set_to_bottom();
+        return;
+    }
+    for (const auto& cst : normalized_csts) {
+        if (m_is_bottom) {
+            return;
+        }
+        this->add_linear_constraint(cst);
+    }
+}
+
+void ZoneDom::forget(VarRef x) {
+    if (m_is_bottom) {
+        return;
+    }
+    auto index = find_index(x);
+    if (!index) {
+        return;
+    }
+    // Close first so that the constraints implied through x are kept.
+    this->close();
+    if (!m_is_bottom) {
+        this->remove_index(*index);
+    }
+}
+
+std::optional< std::size_t > ZoneDom::find_index(VarRef x) const {
+    auto it = llvm::lower_bound(m_vars, x);
+    if (it == m_vars.end() || *it != x) {
+        return std::nullopt;
+    }
+    return static_cast< std::size_t >(std::distance(m_vars.begin(), it)) + 1U;
+}
+
+std::size_t ZoneDom::get_or_add_index(VarRef x) {
+    auto it = llvm::lower_bound(m_vars, x);
+    const auto index =
+        static_cast< std::size_t >(std::distance(m_vars.begin(), it)) + 1U;
+    if (it != m_vars.end() && *it == x) {
+        return index;
+    }
+
+    const std::size_t dim = get_dim();
+    std::vector< Bound > dbm((dim + 1U) * (dim + 1U), Inf);
+    auto shift = [index](std::size_t i) { return i < index ? i : i + 1U; };
+    for (std::size_t i = 0U; i < dim; ++i) {
+        for (std::size_t j = 0U; j < dim; ++j) {
+            dbm[(shift(i) * (dim + 1U)) + shift(j)] = m_dbm[(i * dim) + j];
+        }
+    }
+    dbm[(index * (dim + 1U)) + index] = 0;
+    m_vars.insert(it, x);
+    m_dbm.swap(dbm);
+    return index;
+}
+
+void ZoneDom::remove_index(std::size_t index) {
+    const std::size_t dim = get_dim();
+    std::vector< Bound > dbm;
+    dbm.reserve((dim - 1U) * (dim - 1U));
+    for (std::size_t i = 0U; i < dim; ++i) {
+        if (i == index) {
+            continue;
+        }
+        for (std::size_t j = 0U; j < dim; ++j) {
+            if (j != index) {
+                dbm.push_back(m_dbm[(i * dim) + j]);
+            }
+        }
+    }
+    m_vars.erase(m_vars.begin() + static_cast< std::ptrdiff_t >(index - 1U));
+    m_dbm.swap(dbm);
+}
+
+void ZoneDom::add_difference(std::size_t i, std::size_t j, Bound c) {
+    if (m_is_bottom || c >= at(i, j)) {
+        return;
+    }
+    if (add_bounds(at(j, i), c) < 0) {
+        this->set_to_bottom();
+        return;
+    }
+    knight_assert_msg(m_is_closed, "incremental closure of an open matrix");
+
+    // The shortest paths through the new edge i -> j. The row j and the
+    // column i are left unchanged as the cycle through the edge is
+    // non-negative, so that the matrix can be updated in place.
+    const std::size_t dim = get_dim();
+    const Bound* via = &m_dbm[j * dim];
+    for (std::size_t a = 0U; a < dim; ++a) {
+        const Bound bound = add_bounds(at(a, i), c);
+        if (bound != Inf) {
+            relax_row(&m_dbm[a * dim], via, bound, dim);
+        }
+    }
+}
+
+void ZoneDom::add_interval(VarRef x, const Interval& itv) {
+    if (m_is_bottom || (!itv.lb && !itv.ub)) {
+        return;
+    }
+    const std::size_t index = get_or_add_index(x);
+    if (itv.ub) {
+        this->add_difference(0U, index, to_bound(*itv.ub));
+    }
+    if (itv.lb) {
+        this->add_difference(index, 0U, to_bound(-*itv.lb));
+    }
+}
+
+void ZoneDom::assign_shifted(VarRef x, VarRef y, const ZNum& k) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->close();
+    const Bound bound = to_bound(k);
+    if (bound == Inf || bound == MinBound) {
+        this->assign_interval(x, add(this->get_interval(y), {k, k}));
+        return;
+    }
+    if (x == y) {
+        // Shift the row and the column of x, which keeps the matrix
+        // closed.
+        auto index = find_index(x);
+        if (!index) {
+            return;
+        }
+        for (std::size_t a = 0U; a < get_dim(); ++a) {
+            if (a != *index) {
+                at(a, *index) = add_bounds(at(a, *index), bound);
+                at(*index, a) = add_bounds(at(*index, a), -bound);
+            }
+        }
+        return;
+    }
+    this->forget(x);
+    (void)get_or_add_index(y);
+    const std::size_t x_index = get_or_add_index(x);
+    const std::size_t y_index = *find_index(y);
+    this->add_difference(y_index, x_index, bound);
+    this->add_difference(x_index, y_index, -bound);
+}
+
+void ZoneDom::assign_interval(VarRef x, const Interval& itv) {
+    if (m_is_bottom) {
+        return;
+    }
+    this->close();
+    this->forget(x);
+    this->add_interval(x, itv);
+}
+
+ZoneDom::Interval ZoneDom::eval_interval(const LinearExpr& expr) const {
+    Interval itv{expr.get_constant_term(), expr.get_constant_term()};
+    for (const auto& [var, factor] : expr.get_variable_terms()) {
+        itv = add(itv, scale(this->get_interval(var), factor));
+    }
+    return itv;
+}
+
+void ZoneDom::add_inequality(const LinearExpr& expr) {
+    if (m_is_bottom) {
+        return;
+    }
+    const auto& terms = expr.get_variable_terms();
+    const ZNum& cst = expr.get_constant_term();
+    if (terms.empty()) {
+        if (cst > 0) {
+            this->set_to_bottom();
+        }
+        return;
+    }
+
+    // y - x + c <= 0 is the difference y - x <= -c.
+    if (terms.size() == 2U) {
+        auto first = terms.begin();
+        auto second = std::next(first);
+        if (first->second == -1 && second->second == 1) {
+            std::swap(first, second);
+        }
+        if (first->second == 1 && second->second == -1) {
+            const Bound bound = to_bound(-cst);
+            (void)get_or_add_index(first->first);
+            (void)get_or_add_index(second->first);
+            this->add_difference(*find_index(second->first),
+                                 *find_index(first->first),
+                                 bound);
+            return;
+        }
+    }
+
+    // k * v <= -(c + the other terms) bounds each variable by the lower
+    // bound of the other terms.
+    std::vector< std::pair< VarRef, Interval > > bounds;
+    for (const auto& [var, factor] : terms) {
+        Interval rest{cst, cst};
+        for (const auto& [other_var, other_factor] : terms) {
+            if (other_var != var) {
+                rest = add(rest,
+                           scale(this->get_interval(other_var),
+                                 other_factor));
+            }
+        }
+        if (!rest.lb) {
+            continue;
+        }
+        const ZNum limit = -*rest.lb;
+        if (factor > 0) {
+            bounds.emplace_back(var,
+                                Interval{std::nullopt,
+                                         floor_div(limit, factor)});
+        } else {
+            bounds.emplace_back(var,
+                                Interval{ceil_div(limit, factor),
+                                         std::nullopt});
+        }
+    }
+    for (const auto& [var, itv] : bounds) {
+        this->add_interval(var, itv);
+    }
+}
+
+void ZoneDom::close() {
+    if (m_is_closed || m_is_bottom) {
+        m_is_closed = true;
+        return;
+    }
+    const std::size_t dim = get_dim();
+    for (std::size_t k = 0U; k < dim; ++k) {
+        const Bound* via = &m_dbm[k * dim];
+        for (std::size_t a = 0U; a < dim; ++a) {
+            const Bound bound = at(a, k);
+            if (bound != Inf) {
+                relax_row(&m_dbm[a * dim], via, bound, dim);
+            }
+        }
+    }
+    m_is_closed = true;
+    for (std::size_t i = 0U; i < dim; ++i) {
+        if (at(i, i) < 0) {
+            this->set_to_bottom();
+            return;
+        }
+    }
+}
+
+template < typename Combine >
+void ZoneDom::combine_on_common(const ZoneDom& other, Combine combine) {
+    if (m_vars == other.m_vars) {
+        for (std::size_t i = 0U; i < m_dbm.size(); ++i) {
+            m_dbm[i] = combine(m_dbm[i], other.m_dbm[i]);
+        }
+        return;
+    }
+
+    std::vector< DenseVarID > vars;
+    std::set_intersection(m_vars.begin(),
+                          m_vars.end(),
+                          other.m_vars.begin(),
+                          other.m_vars.end(),
+                          std::back_inserter(vars));
+    const std::size_t dim = vars.size() + 1U;
+    std::vector< std::size_t > indexes(dim, 0U);
+    std::vector< std::size_t > other_indexes(dim, 0U);
+    for (std::size_t i = 1U; i < dim; ++i) {
+        indexes[i] = *find_index(vars[i - 1U]);
+        other_indexes[i] = *other.find_index(vars[i - 1U]);
+    }
+    std::vector< Bound > dbm(dim * dim);
+    for (std::size_t i = 0U; i < dim; ++i) {
+        for (std::size_t j = 0U; j < dim; ++j) {
+            dbm[(i * dim) + j] =
+                combine(at(indexes[i], indexes[j]),
+                        other.at(other_indexes[i], other_indexes[j]));
+        }
+    }
+    m_vars.swap(vars);
+    m_dbm.swap(dbm);
+}
+
+template < typename Combine >
+void ZoneDom::combine_on_union(const ZoneDom& other, Combine combine) {
+    std::vector< DenseVarID > vars;
+    std::set_union(m_vars.begin(),
+                   m_vars.end(),
+                   other.m_vars.begin(),
+                   other.m_vars.end(),
+                   std::back_inserter(vars));
+    const std::size_t dim = vars.size() + 1U;
+    std::vector< std::size_t > indexes(dim, 0U);
+    std::vector< std::size_t > other_indexes(dim, 0U);
+    for (std::size_t i = 1U; i < dim; ++i) {
+        indexes[i] = find_index(vars[i - 1U]).value_or(NoIndex);
+        other_indexes[i] = other.find_index(vars[i - 1U]).value_or(NoIndex);
+    }
+    auto get_bound = [](const ZoneDom& dom, std::size_t i, std::size_t j) {
+        return i == NoIndex || j == NoIndex ? Inf : dom.at(i, j);
+    };
+    std::vector< Bound > dbm(dim * dim, 0);
+    for (std::size_t i = 0U; i < dim; ++i) {
+        for (std::size_t j = 0U; j < dim; ++j) {
+            if (i != j) {
+                dbm[(i * dim) + j] = combine(
+                    get_bound(*this, indexes[i], indexes[j]),
+                    get_bound(other, other_indexes[i], other_indexes[j]));
+            }
+        }
+    }
+    m_vars.swap(vars);
+    m_dbm.swap(dbm);
+    m_is_closed = false;
+}
+
+} // namespace knight::dfa
@@ -13,16 +13,55 @@
 
 #include "dfa/engine/block_engine.hpp"
 #include "dfa/analysis/analysis_base.hpp"
+#include "dfa/engine/call_inliner.hpp"
 #include "dfa/proc_cfg.hpp"
 #include "util/assert.hpp"
 
 #include <clang/Analysis/CFG.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/ADT/StringSwitch.h>
+
+#define DEBUG_TYPE "block-engine" // NOLINT
+
+ALWAYS_ENABLED_STATISTIC(NumTransferredStmts,
+                         "The number of transferred stmts");
+ALWAYS_ENABLED_STATISTIC(NumAppliedSummaries,
+                         "The number of call sites applying a summary");
+ALWAYS_ENABLED_STATISTIC(NumHeapAllocations,
+                         "The number of transferred heap allocations");
 
 namespace knight::dfa {
 
+namespace {
+
+/// \brief Get the call if it is to a C allocation function.
+const clang::CallExpr* get_allocation_call(ProcCFG::StmtRef stmt) {
+    const auto* call = llvm::dyn_cast< clang::CallExpr >(stmt);
+    if (call == nullptr) {
+        return nullptr;
+    }
+    const auto* callee = call->getDirectCallee();
+    if (callee == nullptr || callee->getIdentifier() == nullptr ||
+        !(callee->isExternC() || callee->isInStdNamespace())) {
+        return nullptr;
+    }
+    bool is_alloc = llvm::StringSwitch< bool >(callee->getName())
+                        .Cases("malloc", "calloc", "realloc", true)
+                        .Cases("aligned_alloc", "strdup", "strndup", true)
+                        .Default(false);
+    return is_alloc ? call : nullptr;
+}
+
+} // anonymous namespace
+
 void BlockExecutionEngine::exec() {
     ProgramStateRef state = m_state;
+    unsigned elem_idx = 0U;
     for (const auto& elem : m_node->Elements) {
+        if (m_deadline != nullptr && m_deadline->step()) {
+            m_state = state->set_to_top();
+            return;
+        }
         switch (elem.getKind()) {
             using enum clang::CFGElement::Kind;
             default:
@@ -38,19 +77,23 @@ void BlockExecutionEngine::exec() {
             } break;
             case ScopeEnd: {
                 const auto& scope_end = elem.castAs< clang::CFGScopeEnd >();
-                exec_scope_end(scope_end.getTriggerStmt(),
-                               scope_end.getVarDecl());
+                state = exec_scope_end(scope_end.getTriggerStmt(),
+                                       scope_end.getVarDecl(),
+                                       state);
             } break;
             case NewAllocator: {
                 const auto& new_allocator =
                     elem.castAs< clang::CFGNewAllocator >();
-                exec_new_allocator_call(new_allocator.getAllocatorExpr());
+                state = exec_new_allocator_call(new_allocator
+                                                    .getAllocatorExpr(),
+                                                state);
             } break;
             case LifetimeEnds: {
                 const auto& lifetime_ends =
                     elem.castAs< clang::CFGLifetimeEnds >();
-                exec_lifetime_ends(lifetime_ends.getTriggerStmt(),
-                                   lifetime_ends.getVarDecl());
+                state = exec_lifetime_ends(lifetime_ends.getTriggerStmt(),
+                                           lifetime_ends.getVarDecl(),
+                                           state);
             } break;
             case LoopExit: {
                 knight_unreachable( // NOLINT
@@ -58,7 +101,13 @@ void BlockExecutionEngine::exec() {
             } break;
             case Statement: {
                 const auto& cfg_stmt = elem.castAs< clang::CFGStmt >();
+                if (const auto* call =
+                        get_allocation_call(cfg_stmt.getStmt())) {
+                    state = exec_heap_allocation(call, state);
+                }
                 state = exec_cfg_stmt(cfg_stmt.getStmt(), state);
+                state = exec_call(cfg_stmt.getStmt(), elem_idx, state);
+                ++NumTransferredStmts;
             } break;
             case Constructor: {
                 knight_unreachable("constructor not implemented yet"); // NOLINT
@@ -75,7 +124,9 @@ void BlockExecutionEngine::exec() {
                     "cleanup function not implemented yet");
             } break;
         }
+        ++elem_idx;
     }
+    m_state = std::move(state);
 }
 
 /// \brief Transfer C++ base or member initializer from constructor's
@@ -99,39 +150,107 @@ void BlockExecutionEngine::exec_scope_begin(StmtRef trigger_stmt,
 
 /// \brief Transfer endding of a scope implicitly generated by
 /// the compiler after the last Stmt in a CompoundStmt's body
-void BlockExecutionEngine::exec_scope_end(StmtRef trigger_stmt,
-                                          VarDeclRef var_decl) {
-    // todo
+ProgramStateRef BlockExecutionEngine::exec_scope_end(
+    [[maybe_unused]] StmtRef trigger_stmt,
+    VarDeclRef var_decl,
+    const ProgramStateRef& state) {
+    if (var_decl == nullptr) {
+        return state;
+    }
+    return state->remove_dead_var(var_decl, m_frame);
 }
 
 /// \brief Transfer C++ new allocator call
-void BlockExecutionEngine::exec_new_allocator_call(
-    const clang::CXXNewExpr* expr) {
-    // todo
+ProgramStateRef BlockExecutionEngine::exec_new_allocator_call(
+    const clang::CXXNewExpr* expr, const ProgramStateRef& state) {
+    return exec_heap_allocation(expr, state);
+}
+
+/// \brief Allocate an object on the heap at the allocation site
+ProgramStateRef BlockExecutionEngine::exec_heap_allocation(
+    const clang::Expr* alloc_expr, const ProgramStateRef& state) {
+    ++NumHeapAllocations;
+    auto& region_mgr = m_analysis_manager.get_region_manager();
+    if (state->is_bottom() || !region_mgr.is_heap_recency_enabled()) {
+        return state;
+    }
+    // The new object is the most recent one, and the former one is from
+    // then on represented by the summary.
+    return state->fold_heap_alloc(
+        region_mgr.get_allocated_region(alloc_expr, m_frame));
 }
 
 /// \brief Transfer the point where the lifetime of an automatic object ends
-void BlockExecutionEngine::exec_lifetime_ends(StmtRef trigger_stmt,
-                                              VarDeclRef var_decl) {
-    // todo
+ProgramStateRef BlockExecutionEngine::exec_lifetime_ends(
+    [[maybe_unused]] StmtRef trigger_stmt,
+    VarDeclRef var_decl,
+    const ProgramStateRef& state) {
+    if (var_decl == nullptr) {
+        return state;
+    }
+    return state->remove_dead_var(var_decl, m_frame);
 }
 
 /// \brief Transfer the stmt
 ProgramStateRef BlockExecutionEngine::exec_cfg_stmt(
     StmtRef stmt, const ProgramStateRef& state) {
-    AnalysisContext analysis_ctx(m_analysis_manager.get_context(),
-                                 m_analysis_manager.get_region_manager());
-    analysis_ctx.set_current_stack_frame(m_frame);
-    analysis_ctx.set_state(state);
-    m_stmt_post[stmt] = state;
-
-    m_analysis_manager.run_analyses_for_pre_stmt(analysis_ctx, stmt);
-    m_analysis_manager.run_analyses_for_eval_stmt(analysis_ctx, stmt);
-    m_analysis_manager.run_analyses_for_post_stmt(analysis_ctx, stmt);
-
-    auto post_state = analysis_ctx.get_state();
-    m_stmt_post[stmt] = post_state;
+    using internal::CheckStmtKind;
+
+    m_analysis_ctx.set_state(state);
+    if (m_stmt_pre != nullptr &&
+        (m_checker_manager == nullptr ||
+         m_checker_manager->has_checkers_for_stmt(stmt,
+                                                  CheckStmtKind::Pre))) {
+        m_stmt_pre->emplace_back(stmt, state);
+    }
+
+    m_analysis_manager.run_analyses_for_pre_stmt(m_analysis_ctx, stmt);
+    m_analysis_manager.run_analyses_for_eval_stmt(m_analysis_ctx, stmt);
+    m_analysis_manager.run_analyses_for_post_stmt(m_analysis_ctx, stmt);
+
+    auto post_state = m_analysis_ctx.get_state();
+    if (m_stmt_post != nullptr &&
+        (m_checker_manager == nullptr ||
+         m_checker_manager->has_checkers_for_stmt(stmt,
+                                                  CheckStmtKind::Post))) {
+        m_stmt_post->emplace_back(stmt, post_state);
+    }
     return std::move(post_state);
 }
 
+/// \brief Transfer the call by inlining the callee or applying its summary
+ProgramStateRef BlockExecutionEngine::exec_call(StmtRef stmt,
+                                                unsigned stmt_idx,
+                                                const ProgramStateRef& state) {
+    if (state->is_bottom()) {
+        return state;
+    }
+    if (m_inliner != nullptr) {
+        if (auto exit_state = m_inliner->inline_call(m_frame,
+                                                     m_node,
+                                                     stmt,
+                                                     stmt_idx,
+                                                     state,
+                                                     m_deadline)) {
+            return *exit_state;
+        }
+    }
+    if (m_summaries == nullptr) {
+        return state;
+    }
+    auto callee = get_called_decl(stmt);
+    if (!callee.has_value()) {
+        return state;
+    }
+    auto summary = m_summaries->find(*callee);
+    if (!summary.has_value()) {
+        return state;
+    }
+    ++NumAppliedSummaries;
+    if (!summary->may_return) {
+        return state->set_to_bottom();
+    }
+    return state;
+}
+
 } // namespace knight::dfa
\ No newline at end of file
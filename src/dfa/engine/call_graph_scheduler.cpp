@@ -0,0 +1,260 @@
+//===- call_graph_scheduler.cpp ---------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the bottom-up scheduler of the functions over the
+//  call graph of a translation unit.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/engine/call_graph_scheduler.hpp"
+#include "dfa/summary.hpp"
+#include "util/assert.hpp"
+
+#include <clang/Analysis/CallGraph.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SCCIterator.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallSet.h>
+#include <llvm/ADT/Statistic.h>
+
+#include <algorithm>
+#include <tuple>
+
+#define DEBUG_TYPE "call-graph-scheduler" // NOLINT
+
+ALWAYS_ENABLED_STATISTIC(NumScheduledSCCs,
+                         "The number of the scheduled call graph SCCs");
+ALWAYS_ENABLED_STATISTIC(NumRecursiveSCCs,
+                         "The number of the recursive call graph SCCs");
+ALWAYS_ENABLED_STATISTIC(NumSuspendedTasks,
+                         "The number of the suspensions of the analysis "
+                         "tasks on a callee not summarized yet");
+
+namespace knight::dfa {
+
+namespace {
+
+/// \brief The analysis of the worker resuming the tasks on this thread.
+thread_local const CallGraphScheduler::AnalyzeFn* t_analyze = nullptr;
+
+} // anonymous namespace
+
+CallGraphScheduler::CallGraphScheduler(
+    llvm::ArrayRef< const StackFrame* > frames,
+    llvm::ArrayRef< uint64_t > costs) {
+    clang::CallGraph call_graph;
+    llvm::DenseMap< const clang::Decl*, FrameIndex > frame_indices;
+    for (FrameIndex idx = 0U; idx < frames.size(); ++idx) {
+        const auto* decl = frames[idx]->get_decl();
+        frame_indices.try_emplace(decl->getCanonicalDecl(), idx);
+        call_graph.addToCallGraph(const_cast< clang::Decl* >(decl));
+    }
+
+    // The SCCs are visited in post order, which is bottom-up.
+    m_frame_sccs.assign(frames.size(), 0U);
+    std::vector< const clang::CallGraphNode* > nodes;
+    for (auto it = llvm::scc_begin(&call_graph); !it.isAtEnd(); ++it) {
+        std::vector< FrameIndex > scc;
+        for (const clang::CallGraphNode* node : *it) {
+            const auto* decl = node->getDecl();
+            if (decl == nullptr) {
+                continue;
+            }
+            auto frame_it = frame_indices.find(decl->getCanonicalDecl());
+            if (frame_it == frame_indices.end()) {
+                continue;
+            }
+            m_frame_sccs[frame_it->second] = m_sccs.size();
+            scc.push_back(frame_it->second);
+            nodes.push_back(node);
+        }
+        if (scc.empty()) {
+            continue;
+        }
+        if (it.hasCycle()) {
+            ++NumRecursiveSCCs;
+        }
+        m_sccs.push_back(std::move(scc));
+    }
+    NumScheduledSCCs += m_sccs.size();
+
+    // Only the direct calls between the scheduled functions are edges,
+    // since a function only applies the summaries of its callees.
+    m_callers.resize(m_sccs.size());
+    std::vector< llvm::SmallSet< SCCIndex, 4U > > callees(m_sccs.size());
+    for (const auto* node : nodes) {
+        const auto* decl = node->getDecl()->getCanonicalDecl();
+        const SCCIndex caller = m_frame_sccs[frame_indices[decl]];
+        for (const clang::CallGraphNode::CallRecord& record : *node) {
+            const auto* callee_decl = record.Callee->getDecl();
+            if (callee_decl == nullptr) {
+                continue;
+            }
+            auto callee_it =
+                frame_indices.find(callee_decl->getCanonicalDecl());
+            if (callee_it == frame_indices.end()) {
+                continue;
+            }
+            const SCCIndex callee = m_frame_sccs[callee_it->second];
+            if (callee == caller || !callees[caller].insert(callee).second) {
+                continue;
+            }
+            m_callers[callee].push_back(caller);
+        }
+    }
+
+    // The callers follow their callees in the bottom-up order.
+    m_priorities.assign(m_sccs.size(), 0U);
+    if (!costs.empty()) {
+        for (SCCIndex scc = m_sccs.size(); scc-- > 0U;) {
+            uint64_t callers_cost = 0U;
+            for (SCCIndex caller : m_callers[scc]) {
+                callers_cost = std::max(callers_cost, m_priorities[caller]);
+            }
+            for (FrameIndex idx : m_sccs[scc]) {
+                m_priorities[scc] += costs[idx];
+            }
+            m_priorities[scc] += callers_cost;
+        }
+    }
+
+    // A task waits at its calls for the SCCs of its callees, completed
+    // with their last frames, then for the previous frame of its SCC.
+    m_awaited.resize(frames.size());
+    for (const auto& scc : m_sccs) {
+        for (std::size_t pos = 0U; pos < scc.size(); ++pos) {
+            const FrameIndex idx = scc[pos];
+            const SCCIndex scc_idx = m_frame_sccs[idx];
+            auto& awaited = m_awaited[idx];
+            for (const auto* callee :
+                 get_direct_callees(frames[idx]->get_decl())) {
+                auto callee_it =
+                    frame_indices.find(callee->getCanonicalDecl());
+                if (callee_it == frame_indices.end() ||
+                    m_frame_sccs[callee_it->second] == scc_idx) {
+                    continue;
+                }
+                const FrameIndex last =
+                    m_sccs[m_frame_sccs[callee_it->second]].back();
+                if (!llvm::is_contained(awaited, last)) {
+                    awaited.push_back(last);
+                }
+            }
+            if (pos > 0U) {
+                awaited.push_back(scc[pos - 1U]);
+            }
+        }
+    }
+
+    m_waiters.resize(frames.size());
+    m_is_completed.assign(frames.size(), false);
+    m_tasks.reserve(frames.size());
+    for (FrameIndex idx = 0U; idx < frames.size(); ++idx) {
+        m_tasks.push_back(create_task(idx));
+    }
+    // Only the frames of the call graph are scheduled, and their tasks
+    // start by waiting for their callees.
+    m_num_scheduled = nodes.size();
+    for (const auto& scc : m_sccs) {
+        for (FrameIndex idx : scc) {
+            push_ready(idx);
+        }
+    }
+}
+
+bool CallGraphScheduler::CalleeAwaiter::await_suspend(
+    std::coroutine_handle<> /*handle*/) {
+    // The task may be resumed by another worker as soon as it is
+    // registered, so the awaiter is not used after.
+    const bool is_suspended = scheduler.add_waiter(waiter, callee);
+    if (is_suspended) {
+        ++NumSuspendedTasks;
+    }
+    return is_suspended;
+}
+
+AnalysisTask CallGraphScheduler::create_task(FrameIndex idx) {
+    for (FrameIndex callee : m_awaited[idx]) {
+        co_await CalleeAwaiter{*this, idx, callee};
+    }
+    // The task is resumed by the worker completing its last callee, which
+    // analyzes the frame.
+    knight_assert(t_analyze != nullptr);
+    (*t_analyze)(idx);
+    complete(idx);
+}
+
+void CallGraphScheduler::run_worker(AnalyzeFn analyze) {
+    t_analyze = &analyze;
+    while (auto idx = take_ready()) {
+        m_tasks[*idx].resume();
+    }
+    t_analyze = nullptr;
+}
+
+bool CallGraphScheduler::is_less_urgent(FrameIndex lhs,
+                                        FrameIndex rhs) const {
+    // The costliest chain first, then the bottom-up order.
+    const SCCIndex lhs_scc = m_frame_sccs[lhs];
+    const SCCIndex rhs_scc = m_frame_sccs[rhs];
+    return std::tie(m_priorities[lhs_scc], rhs_scc, rhs) <
+           std::tie(m_priorities[rhs_scc], lhs_scc, lhs);
+}
+
+void CallGraphScheduler::push_ready(FrameIndex idx) {
+    m_ready.push_back(idx);
+    std::push_heap(m_ready.begin(),
+                   m_ready.end(),
+                   [this](FrameIndex lhs, FrameIndex rhs) {
+                       return is_less_urgent(lhs, rhs);
+                   });
+}
+
+std::optional< CallGraphScheduler::FrameIndex > CallGraphScheduler::
+    take_ready() {
+    std::unique_lock lock(m_mutex);
+    m_ready_cv.wait(lock, [this] {
+        return !m_ready.empty() || m_num_completed == m_num_scheduled;
+    });
+    if (m_ready.empty()) {
+        return std::nullopt;
+    }
+    std::pop_heap(m_ready.begin(),
+                  m_ready.end(),
+                  [this](FrameIndex lhs, FrameIndex rhs) {
+                      return is_less_urgent(lhs, rhs);
+                  });
+    const FrameIndex idx = m_ready.back();
+    m_ready.pop_back();
+    return idx;
+}
+
+bool CallGraphScheduler::add_waiter(FrameIndex waiter, FrameIndex callee) {
+    const std::lock_guard lock(m_mutex);
+    if (m_is_completed[callee]) {
+        return false;
+    }
+    m_waiters[callee].push_back(waiter);
+    return true;
+}
+
+void CallGraphScheduler::complete(FrameIndex idx) {
+    {
+        const std::lock_guard lock(m_mutex);
+        knight_assert_msg(!m_is_completed[idx], "frame completed twice");
+        m_is_completed[idx] = true;
+        ++m_num_completed;
+        for (FrameIndex waiter : m_waiters[idx]) {
+            push_ready(waiter);
+        }
+        m_waiters[idx].clear();
+    }
+    m_ready_cv.notify_all();
+}
+} // namespace knight::dfa
@@ -0,0 +1,128 @@
+//===- call_inliner.cpp -----------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the context-sensitive inliner of the calls.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/engine/call_inliner.hpp"
+#include "dfa/engine/intraprocedural_fixpoint.hpp"
+#include "dfa/location_manager.hpp"
+
+#include <clang/AST/Decl.h>
+#include <clang/AST/Expr.h>
+#include <llvm/ADT/Statistic.h>
+
+#define DEBUG_TYPE "call-inliner" // NOLINT
+
+ALWAYS_ENABLED_STATISTIC(NumInlinedCalls, "The number of inlined calls");
+ALWAYS_ENABLED_STATISTIC(NumInlineCacheHits,
+                         "The number of inlined calls reusing a memoized "
+                         "exit state");
+ALWAYS_ENABLED_STATISTIC(NumInlineCacheMisses,
+                         "The number of inlined calls computing the "
+                         "fixpoint of the callee");
+ALWAYS_ENABLED_STATISTIC(NumInlineCacheEvictions,
+                         "The number of memoized exit states evicted");
+
+namespace knight::dfa {
+
+std::optional< ProgramStateRef > CallInliner::inline_call(
+    const StackFrame* frame,
+    NodeRef node,
+    StmtRef call,
+    unsigned stmt_idx,
+    const ProgramStateRef& state,
+    FunctionDeadline* deadline) {
+    if (!llvm::isa< clang::CallExpr >(call)) {
+        return std::nullopt;
+    }
+    auto callee = get_called_decl(call);
+    if (!callee.has_value() || !is_inlinable(frame, *callee)) {
+        return std::nullopt;
+    }
+
+    auto* location_mgr = frame->get_manager();
+    const auto* callee_frame =
+        location_mgr->create_from_node(const_cast< StackFrame* >(frame),
+                                       node,
+                                       call,
+                                       stmt_idx);
+    if (callee_frame->get_cfg() == nullptr) {
+        return std::nullopt;
+    }
+    ++NumInlinedCalls;
+
+    auto entry_state = state->remove_stmt_sexprs();
+    const CacheKey key{(*callee)->getCanonicalDecl(), entry_state.get()};
+    auto it = m_cache.find(key);
+    if (it != m_cache.end()) {
+        ++NumInlineCacheHits;
+        const auto& entry = it->second;
+        return entry.exit->copy_stmt_sexprs(*state)->remove_frame(
+            entry.frame);
+    }
+    ++NumInlineCacheMisses;
+
+    IntraProceduralFixpointIterator engine(m_ctx,
+                                           m_analysis_mgr,
+                                           m_checker_mgr,
+                                           callee_frame,
+                                           m_state_mgr,
+                                           *this);
+    engine.set_summaries(m_summaries);
+    auto exit_state = engine.run_inlined(entry_state, deadline);
+
+    // A cut fixpoint depends on the remaining budget, hence is not reused.
+    if (deadline == nullptr || !deadline->is_expired()) {
+        insert(key, CacheEntry{entry_state, exit_state, callee_frame});
+    }
+    return exit_state->copy_stmt_sexprs(*state)->remove_frame(callee_frame);
+}
+
+void CallInliner::clear() {
+    m_cache.clear();
+    std::deque< CacheKey >().swap(m_cache_order);
+}
+
+bool CallInliner::is_inlinable(const StackFrame* frame,
+                               ProcCFG::DeclRef callee) const {
+    const auto* function = llvm::dyn_cast< clang::FunctionDecl >(callee);
+    if (function == nullptr || !function->hasBody() ||
+        function->isTemplated()) {
+        return false;
+    }
+    callee = callee->getCanonicalDecl();
+    unsigned depth = 0U;
+    for (const auto* caller = frame; caller != nullptr;
+         caller = caller->get_parent()) {
+        if (caller->get_decl()->getCanonicalDecl() == callee) {
+            return false;
+        }
+        if (!caller->is_top_frame()) {
+            ++depth;
+        }
+    }
+    return depth < m_max_depth;
+}
+
+void CallInliner::insert(CacheKey key, CacheEntry entry) {
+    if (m_max_cache_size == 0U) {
+        return;
+    }
+    if (m_cache.size() >= m_max_cache_size) {
+        m_cache.erase(m_cache_order.front());
+        m_cache_order.pop_front();
+        ++NumInlineCacheEvictions;
+    }
+    m_cache.try_emplace(key, std::move(entry));
+    m_cache_order.push_back(key);
+}
+
+} // namespace knight::dfa
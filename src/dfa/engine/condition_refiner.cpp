@@ -0,0 +1,373 @@
+//===- condition_refiner.cpp ------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the refinement of the program states by the
+//  branch conditions.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/engine/condition_refiner.hpp"
+#include "dfa/ast_lock.hpp"
+#include "dfa/domain/numerical/congruence_dom.hpp"
+#include "dfa/domain/numerical/interval_env.hpp"
+#include "dfa/domain/numerical/known_bits_dom.hpp"
+#include "dfa/domain/numerical/packed_dom.hpp"
+#include "dfa/domain/numerical/product_dom.hpp"
+#include "dfa/domain/numerical/zone_dom.hpp"
+
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/Decl.h>
+#include <llvm/ADT/APSInt.h>
+#include <llvm/ADT/Statistic.h>
+
+#define DEBUG_TYPE "condition-refiner" // NOLINT
+
+ALWAYS_ENABLED_STATISTIC(NumRefinedEdges,
+                         "The number of edges refined by their conditions");
+ALWAYS_ENABLED_STATISTIC(NumInfeasibleEdges,
+                         "The number of edges pruned by their conditions");
+
+namespace knight::dfa {
+
+namespace {
+
+/// \brief Whether the cast keeps the value of its operand, or its truth
+/// value if `to_boolean`.
+bool is_value_preserving(const clang::CastExpr* cast,
+                         clang::ASTContext& ast_ctx,
+                         bool to_boolean) {
+    switch (cast->getCastKind()) {
+        case clang::CK_LValueToRValue:
+        case clang::CK_NoOp:
+            return true;
+        case clang::CK_IntegralToBoolean:
+            return to_boolean;
+        case clang::CK_IntegralCast: {
+            const auto src_type = cast->getSubExpr()->getType();
+            const auto dst_type = cast->getType();
+            unsigned src_width = 0U;
+            unsigned dst_width = 0U;
+            {
+                ASTLock lock(ast_ctx);
+                src_width = ast_ctx.getIntWidth(src_type);
+                dst_width = ast_ctx.getIntWidth(dst_type);
+            }
+            if (src_type->isSignedIntegerOrEnumerationType()) {
+                return dst_type->isSignedIntegerOrEnumerationType() &&
+                       dst_width >= src_width;
+            }
+            return dst_type->isSignedIntegerOrEnumerationType()
+                       ? dst_width > src_width
+                       : dst_width >= src_width;
+        }
+        default:
+            return false;
+    }
+}
+
+const clang::Expr* strip_casts(const clang::Expr* expr,
+                               clang::ASTContext& ast_ctx,
+                               bool to_boolean) {
+    while (true) {
+        expr = expr->IgnoreParens();
+        const auto* cast = llvm::dyn_cast< clang::ImplicitCastExpr >(expr);
+        if (cast == nullptr ||
+            !is_value_preserving(cast, ast_ctx, to_boolean)) {
+            return expr;
+        }
+        expr = cast->getSubExpr();
+    }
+}
+
+/// \brief Get the kind of `lhs op rhs` evaluated to false, i.e., of
+/// `!(lhs op rhs)`, which is `op` itself for the others.
+clang::BinaryOperatorKind negate_comparison(clang::BinaryOperatorKind op) {
+    switch (op) {
+        case clang::BO_LT:
+            return clang::BO_GE;
+        case clang::BO_GT:
+            return clang::BO_LE;
+        case clang::BO_LE:
+            return clang::BO_GT;
+        case clang::BO_GE:
+            return clang::BO_LT;
+        case clang::BO_EQ:
+            return clang::BO_NE;
+        case clang::BO_NE:
+            return clang::BO_EQ;
+        default:
+            return op;
+    }
+}
+
+/// \brief Meet the domain of the state with the constraints.
+///
+/// \return the bottom state if the domain becomes bottom.
+template < typename Domain >
+ProgramStateRef refine_dom(
+    ProgramStateRef state,
+    const ConditionRefiner::LinearConstraintSystem& csts) {
+    if (!state->exists< Domain >()) {
+        return state;
+    }
+    auto val = state->get_clone< Domain >();
+    val->merge_with_linear_constraint_system(csts);
+    if (val->is_bottom()) {
+        return state->set_to_bottom();
+    }
+    return state->set< Domain >(val);
+}
+
+} // anonymous namespace
+
+ProgramStateRef ConditionRefiner::refine(ProgramStateRef state,
+                                         const clang::Expr* cond,
+                                         bool is_true) const {
+    auto csts = translate(cond, is_true);
+    if (!csts || csts->is_empty()) {
+        return state;
+    }
+    ++NumRefinedEdges;
+    if (csts->is_false()) {
+        ++NumInfeasibleEdges;
+        return state->set_to_bottom();
+    }
+
+    state = refine_dom< ZoneDom >(std::move(state), *csts);
+    if (!state->is_bottom()) {
+        state = refine_dom< PackedZoneDom >(std::move(state), *csts);
+    }
+    if (!state->is_bottom()) {
+        state = refine_dom< IntervalEnvDom >(std::move(state), *csts);
+    }
+    if (!state->is_bottom()) {
+        state = refine_dom< CongruenceEnvDom >(std::move(state), *csts);
+    }
+    if (!state->is_bottom()) {
+        state = refine_dom< KnownBitsEnvDom >(std::move(state), *csts);
+    }
+    if (!state->is_bottom()) {
+        state = refine_dom< NumericalProductDom >(std::move(state), *csts);
+    }
+    if (state->is_bottom()) {
+        ++NumInfeasibleEdges;
+    }
+    return state;
+}
+
+std::optional< ConditionRefiner::LinearConstraintSystem > ConditionRefiner::
+    translate(const clang::Expr* cond, bool is_true) const {
+    auto& ast_ctx = m_frame->get_ast_context();
+    bool value = false;
+    bool is_constant = false;
+    if (!cond->isValueDependent()) {
+        ASTLock lock(ast_ctx);
+        is_constant = cond->EvaluateAsBooleanCondition(value, ast_ctx);
+    }
+    if (is_constant) {
+        LinearConstraintSystem csts;
+        if (value != is_true) {
+            csts.set_to_false();
+        }
+        return csts;
+    }
+
+    cond = strip_casts(cond, ast_ctx, /*to_boolean=*/true);
+    if (const auto* unary_op = llvm::dyn_cast< clang::UnaryOperator >(cond)) {
+        if (unary_op->getOpcode() == clang::UO_LNot) {
+            return translate(unary_op->getSubExpr(), !is_true);
+        }
+    }
+    if (const auto* binary_op =
+            llvm::dyn_cast< clang::BinaryOperator >(cond)) {
+        if (binary_op->isLogicalOp()) {
+            // Only the conjunctions are linear, and dropping one of their
+            // conjuncts keeps the refinement sound.
+            if (is_true != (binary_op->getOpcode() == clang::BO_LAnd)) {
+                return std::nullopt;
+            }
+            auto lhs = translate(binary_op->getLHS(), is_true);
+            auto rhs = translate(binary_op->getRHS(), is_true);
+            if (!lhs || !rhs) {
+                return lhs ? lhs : rhs;
+            }
+            lhs->merge_linear_constraint_system(*rhs);
+            return lhs;
+        }
+        if (binary_op->isComparisonOp()) {
+            auto cst = translate_comparison(binary_op, is_true);
+            if (!cst) {
+                return std::nullopt;
+            }
+            LinearConstraintSystem csts;
+            csts.add_linear_constraint(std::move(*cst));
+            return csts;
+        }
+    }
+
+    // A plain integer is its comparison with zero.
+    if (!cond->getType()->isIntegerType()) {
+        return std::nullopt;
+    }
+    auto expr = linearize(cond);
+    if (!expr) {
+        return std::nullopt;
+    }
+    LinearConstraintSystem csts;
+    csts.add_linear_constraint(
+        LinearConstraint(std::move(*expr),
+                         is_true ? LinearConstraint::LCK_Disequation
+                                 : LinearConstraint::LCK_Equality));
+    return csts;
+}
+
+std::optional< ConditionRefiner::LinearConstraint > ConditionRefiner::
+    translate_comparison(const clang::BinaryOperator* binary_op,
+                         bool is_true) const {
+    if (!binary_op->getLHS()->getType()->isIntegerType() ||
+        !binary_op->getRHS()->getType()->isIntegerType()) {
+        return std::nullopt;
+    }
+    auto lhs = linearize(binary_op->getLHS());
+    if (!lhs) {
+        return std::nullopt;
+    }
+    auto rhs = linearize(binary_op->getRHS());
+    if (!rhs) {
+        return std::nullopt;
+    }
+
+    auto op = binary_op->getOpcode();
+    if (!is_true) {
+        op = negate_comparison(op);
+    }
+    // `l < r` is `l - r + 1 <= 0` over the integers, and `l > r` is
+    // `r - l + 1 <= 0`.
+    switch (op) {
+        case clang::BO_LT:
+            *lhs -= *rhs;
+            *lhs += ZNum(1);
+            return LinearConstraint(std::move(*lhs),
+                                    LinearConstraint::LCK_Inequality);
+        case clang::BO_GT:
+            *rhs -= *lhs;
+            *rhs += ZNum(1);
+            return LinearConstraint(std::move(*rhs),
+                                    LinearConstraint::LCK_Inequality);
+        case clang::BO_LE:
+            *lhs -= *rhs;
+            return LinearConstraint(std::move(*lhs),
+                                    LinearConstraint::LCK_Inequality);
+        case clang::BO_GE:
+            *rhs -= *lhs;
+            return LinearConstraint(std::move(*rhs),
+                                    LinearConstraint::LCK_Inequality);
+        case clang::BO_EQ:
+            *lhs -= *rhs;
+            return LinearConstraint(std::move(*lhs),
+                                    LinearConstraint::LCK_Equality);
+        case clang::BO_NE:
+            *lhs -= *rhs;
+            return LinearConstraint(std::move(*lhs),
+                                    LinearConstraint::LCK_Disequation);
+        default:
+            return std::nullopt;
+    }
+}
+
+std::optional< ConditionRefiner::LinearExpr > ConditionRefiner::linearize(
+    const clang::Expr* expr) const {
+    auto& ast_ctx = m_frame->get_ast_context();
+    expr = strip_casts(expr, ast_ctx, /*to_boolean=*/false);
+    if (!expr->getType()->isIntegerType()) {
+        return std::nullopt;
+    }
+
+    clang::Expr::EvalResult result;
+    bool is_constant = false;
+    if (!expr->isValueDependent()) {
+        ASTLock lock(ast_ctx);
+        is_constant = expr->EvaluateAsInt(result, ast_ctx);
+    }
+    if (is_constant) {
+        const auto& value = result.Val.getInt();
+        // The unsigned values are extended to fit as signed ones.
+        return LinearExpr(
+            ZNum::from_apint(value.extend(value.getBitWidth() + 1U)));
+    }
+
+    if (const auto* decl_ref = llvm::dyn_cast< clang::DeclRefExpr >(expr)) {
+        const auto* var = llvm::dyn_cast< clang::VarDecl >(decl_ref->getDecl());
+        if (var == nullptr || var->getType().isVolatileQualified()) {
+            return std::nullopt;
+        }
+        const auto* region = m_region_mgr.get_region(var, m_frame);
+        if (region == nullptr) {
+            return std::nullopt;
+        }
+        return LinearExpr(m_var_index.get_id(region));
+    }
+
+    // The arithmetic wraps around on the unsigned integers.
+    if (!expr->getType()->isSignedIntegerOrEnumerationType()) {
+        return std::nullopt;
+    }
+    if (const auto* unary_op = llvm::dyn_cast< clang::UnaryOperator >(expr)) {
+        auto sub = linearize(unary_op->getSubExpr());
+        if (!sub) {
+            return std::nullopt;
+        }
+        switch (unary_op->getOpcode()) {
+            case clang::UO_Plus:
+                return sub;
+            case clang::UO_Minus:
+                return -std::move(*sub);
+            default:
+                return std::nullopt;
+        }
+    }
+    const auto* binary_op = llvm::dyn_cast< clang::BinaryOperator >(expr);
+    if (binary_op == nullptr) {
+        return std::nullopt;
+    }
+    auto op = binary_op->getOpcode();
+    if (op != clang::BO_Add && op != clang::BO_Sub && op != clang::BO_Mul) {
+        return std::nullopt;
+    }
+    auto lhs = linearize(binary_op->getLHS());
+    if (!lhs) {
+        return std::nullopt;
+    }
+    auto rhs = linearize(binary_op->getRHS());
+    if (!rhs) {
+        return std::nullopt;
+    }
+    switch (op) {
+        case clang::BO_Add:
+            *lhs += *rhs;
+            return lhs;
+        case clang::BO_Sub:
+            *lhs -= *rhs;
+            return lhs;
+        default:
+            break;
+    }
+    // Only the products by a constant are linear.
+    if (rhs->is_constant()) {
+        *lhs *= rhs->get_constant_term();
+        return lhs;
+    }
+    if (lhs->is_constant()) {
+        *rhs *= lhs->get_constant_term();
+        return rhs;
+    }
+    return std::nullopt;
+}
+
+} // namespace knight::dfa
@@ -0,0 +1,379 @@
+//===- constant_branches.cpp ------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the pre-pass folding the constant branch
+//  conditions of a CFG.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/engine/constant_branches.hpp"
+#include "dfa/ast_lock.hpp"
+
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/Expr.h>
+#include <clang/AST/ExprCXX.h>
+#include <clang/AST/Stmt.h>
+#include <llvm/ADT/APSInt.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/Statistic.h>
+
+#include <iterator>
+#include <optional>
+#include <vector>
+
+#define DEBUG_TYPE "constant-branches" // NOLINT
+
+ALWAYS_ENABLED_STATISTIC(NumFoldedBranches,
+                         "The number of the branch edges cut by their "
+                         "constant conditions");
+ALWAYS_ENABLED_STATISTIC(NumConstantLocals,
+                         "The number of the local variables folded to "
+                         "their constant initializers");
+
+namespace knight::dfa {
+
+namespace {
+
+using ConstantMap = llvm::DenseMap< const clang::VarDecl*, llvm::APSInt >;
+
+/// \brief The uses of a local variable, which is constant if all of them
+/// read its value.
+struct VarUses {
+    unsigned uses = 0U;
+    unsigned reads = 0U;
+    /// \brief Whether a lambda captures the variable by reference, whose
+    /// body may write it.
+    bool is_captured = false;
+}; // struct VarUses
+
+class LocalVarCollector {
+  private:
+    llvm::DenseMap< const clang::VarDecl*, VarUses > m_uses;
+    /// \brief The candidate variables, by the order of their declarations.
+    std::vector< const clang::VarDecl* > m_vars;
+
+  public:
+    void collect(const clang::Stmt* stmt) {
+        if (stmt == nullptr) {
+            return;
+        }
+        if (const auto* decl_stmt = llvm::dyn_cast< clang::DeclStmt >(stmt)) {
+            for (const auto* decl : decl_stmt->decls()) {
+                const auto* var = llvm::dyn_cast< clang::VarDecl >(decl);
+                if (var != nullptr && is_candidate(var)) {
+                    m_vars.push_back(var);
+                }
+            }
+        } else if (const auto* decl_ref =
+                       llvm::dyn_cast< clang::DeclRefExpr >(stmt)) {
+            if (const auto* var =
+                    llvm::dyn_cast< clang::VarDecl >(decl_ref->getDecl())) {
+                ++m_uses[var].uses;
+            }
+        } else if (const auto* cast =
+                       llvm::dyn_cast< clang::ImplicitCastExpr >(stmt)) {
+            if (cast->getCastKind() == clang::CK_LValueToRValue) {
+                if (const auto* var = get_var(cast->getSubExpr())) {
+                    ++m_uses[var].reads;
+                }
+            }
+        } else if (const auto* lambda =
+                       llvm::dyn_cast< clang::LambdaExpr >(stmt)) {
+            for (const auto& capture : lambda->captures()) {
+                if (capture.capturesVariable() &&
+                    capture.getCaptureKind() == clang::LCK_ByRef) {
+                    if (const auto* var = llvm::dyn_cast< clang::VarDecl >(
+                            capture.getCapturedVar())) {
+                        m_uses[var].is_captured = true;
+                    }
+                }
+            }
+        }
+        for (const auto* child : stmt->children()) {
+            collect(child);
+        }
+    }
+
+    /// \brief Get the candidate variables whose uses all read them.
+    [[nodiscard]] std::vector< const clang::VarDecl* > get_read_only_vars()
+        const {
+        std::vector< const clang::VarDecl* > vars;
+        for (const auto* var : m_vars) {
+            auto it = m_uses.find(var);
+            if (it == m_uses.end() || (it->second.uses == it->second.reads &&
+                                       !it->second.is_captured)) {
+                vars.push_back(var);
+            }
+        }
+        return vars;
+    }
+
+  private:
+    static bool is_candidate(const clang::VarDecl* var) {
+        const auto type = var->getType();
+        return var->hasLocalStorage() &&
+               !llvm::isa< clang::ParmVarDecl >(var) &&
+               var->getInit() != nullptr && !type.isVolatileQualified() &&
+               type->isIntegralOrEnumerationType();
+    }
+
+    static const clang::VarDecl* get_var(const clang::Expr* expr) {
+        const auto* decl_ref =
+            llvm::dyn_cast< clang::DeclRefExpr >(expr->IgnoreParens());
+        return decl_ref == nullptr
+                   ? nullptr
+                   : llvm::dyn_cast< clang::VarDecl >(decl_ref->getDecl());
+    }
+}; // class LocalVarCollector
+
+/// \brief Folds the integer expressions over the constants of the
+/// language and the constant local variables.
+class ConstantFolder {
+  private:
+    clang::ASTContext& m_ast_ctx;
+    const ConstantMap& m_constants;
+
+  public:
+    ConstantFolder(clang::ASTContext& ast_ctx, const ConstantMap& constants)
+        : m_ast_ctx(ast_ctx), m_constants(constants) {}
+
+  public:
+    [[nodiscard]] std::optional< llvm::APSInt > fold(
+        const clang::Expr* expr) const {
+        expr = expr->IgnoreParens();
+        if (expr->isValueDependent() ||
+            !expr->getType()->isIntegralOrEnumerationType()) {
+            return std::nullopt;
+        }
+        if (const auto* cast = llvm::dyn_cast< clang::CastExpr >(expr)) {
+            return fold_cast(cast);
+        }
+        if (const auto* unary = llvm::dyn_cast< clang::UnaryOperator >(expr)) {
+            return fold_unary(unary);
+        }
+        if (const auto* binary =
+                llvm::dyn_cast< clang::BinaryOperator >(expr)) {
+            return fold_binary(binary);
+        }
+        if (const auto* cond =
+                llvm::dyn_cast< clang::ConditionalOperator >(expr)) {
+            auto value = fold(cond->getCond());
+            if (!value) {
+                return std::nullopt;
+            }
+            return fold(value->isZero() ? cond->getFalseExpr()
+                                        : cond->getTrueExpr());
+        }
+        // The literals, the sizeofs, the enumerators and the other
+        // constant expressions.
+        return evaluate(expr);
+    }
+
+  private:
+    [[nodiscard]] std::optional< llvm::APSInt > evaluate(
+        const clang::Expr* expr) const {
+        clang::Expr::EvalResult result;
+        if (!expr->isPRValue() || !expr->EvaluateAsInt(result, m_ast_ctx)) {
+            return std::nullopt;
+        }
+        return result.Val.getInt();
+    }
+
+    [[nodiscard]] std::optional< llvm::APSInt > fold_cast(
+        const clang::CastExpr* cast) const {
+        switch (cast->getCastKind()) {
+            case clang::CK_LValueToRValue: {
+                const auto* decl_ref = llvm::dyn_cast< clang::DeclRefExpr >(
+                    cast->getSubExpr()->IgnoreParens());
+                const auto* var =
+                    decl_ref == nullptr
+                        ? nullptr
+                        : llvm::dyn_cast< clang::VarDecl >(decl_ref->getDecl());
+                if (auto it = m_constants.find(var);
+                    it != m_constants.end()) {
+                    return it->second;
+                }
+                return evaluate(cast);
+            }
+            case clang::CK_NoOp:
+            case clang::CK_IntegralCast:
+            case clang::CK_IntegralToBoolean: {
+                auto value = fold(cast->getSubExpr());
+                if (!value) {
+                    return std::nullopt;
+                }
+                return convert(*value, cast->getType());
+            }
+            default:
+                return evaluate(cast);
+        }
+    }
+
+    [[nodiscard]] std::optional< llvm::APSInt > fold_unary(
+        const clang::UnaryOperator* unary) const {
+        auto value = fold(unary->getSubExpr());
+        if (!value) {
+            return std::nullopt;
+        }
+        switch (unary->getOpcode()) {
+            case clang::UO_LNot:
+                return make_bool(value->isZero(), unary->getType());
+            case clang::UO_Minus:
+                return -*value;
+            case clang::UO_Not:
+                return ~*value;
+            case clang::UO_Plus:
+                return value;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    [[nodiscard]] std::optional< llvm::APSInt > fold_binary(
+        const clang::BinaryOperator* binary) const {
+        const auto opcode = binary->getOpcode();
+        auto lhs = fold(binary->getLHS());
+        if (!lhs) {
+            return std::nullopt;
+        }
+        // The right hand side is not evaluated once the left one decides.
+        if (opcode == clang::BO_LAnd || opcode == clang::BO_LOr) {
+            if (lhs->isZero() == (opcode == clang::BO_LAnd)) {
+                return make_bool(opcode == clang::BO_LOr, binary->getType());
+            }
+            auto rhs = fold(binary->getRHS());
+            if (!rhs) {
+                return std::nullopt;
+            }
+            return make_bool(!rhs->isZero(), binary->getType());
+        }
+
+        auto rhs = fold(binary->getRHS());
+        // The operands share their converted type, except for the shifts
+        // which are not folded.
+        if (!rhs || lhs->getBitWidth() != rhs->getBitWidth() ||
+            lhs->isUnsigned() != rhs->isUnsigned()) {
+            return std::nullopt;
+        }
+        const auto type = binary->getType();
+        switch (opcode) {
+            case clang::BO_EQ:
+                return make_bool(*lhs == *rhs, type);
+            case clang::BO_NE:
+                return make_bool(*lhs != *rhs, type);
+            case clang::BO_LT:
+                return make_bool(*lhs < *rhs, type);
+            case clang::BO_GT:
+                return make_bool(*lhs > *rhs, type);
+            case clang::BO_LE:
+                return make_bool(*lhs <= *rhs, type);
+            case clang::BO_GE:
+                return make_bool(*lhs >= *rhs, type);
+            case clang::BO_Add:
+                return *lhs + *rhs;
+            case clang::BO_Sub:
+                return *lhs - *rhs;
+            case clang::BO_Mul:
+                return *lhs * *rhs;
+            case clang::BO_And:
+                return *lhs & *rhs;
+            case clang::BO_Or:
+                return *lhs | *rhs;
+            case clang::BO_Xor:
+                return *lhs ^ *rhs;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    [[nodiscard]] llvm::APSInt make_bool(bool value,
+                                         clang::QualType type) const {
+        return llvm::APSInt(llvm::APInt(m_ast_ctx.getIntWidth(type),
+                                        value ? 1U : 0U),
+                            type->isUnsignedIntegerOrEnumerationType());
+    }
+
+    [[nodiscard]] llvm::APSInt convert(const llvm::APSInt& value,
+                                       clang::QualType type) const {
+        if (type->isBooleanType()) {
+            return make_bool(!value.isZero(), type);
+        }
+        auto converted = value.extOrTrunc(m_ast_ctx.getIntWidth(type));
+        converted.setIsUnsigned(type->isUnsignedIntegerOrEnumerationType());
+        return converted;
+    }
+}; // class ConstantFolder
+
+/// \brief Fold the initializers of the local variables which are only
+/// read, in the order of their declarations.
+ConstantMap collect_constant_locals(ProcCFG::FunctionRef function,
+                                    clang::ASTContext& ast_ctx) {
+    LocalVarCollector collector;
+    collector.collect(function->getBody());
+
+    ConstantMap constants;
+    const ConstantFolder folder(ast_ctx, constants);
+    for (const auto* var : collector.get_read_only_vars()) {
+        if (auto value = folder.fold(var->getInit())) {
+            constants.try_emplace(var, *value);
+        }
+    }
+    NumConstantLocals += constants.size();
+    return constants;
+}
+
+} // anonymous namespace
+
+InfeasibleEdges InfeasibleEdges::compute(ProcCFG::FunctionRef function,
+                                         const ProcCFG& cfg) {
+    InfeasibleEdges edges;
+    auto& ast_ctx = function->getASTContext();
+    // The folder evaluates the initializers and the conditions in the
+    // context shared by the function workers.
+    ASTLock lock(ast_ctx);
+    if (function->getBody() == nullptr) {
+        return edges;
+    }
+    const auto constants = collect_constant_locals(function, ast_ctx);
+    const ConstantFolder folder(ast_ctx, constants);
+    for (const auto* block : cfg.get_clang_cfg()) {
+        if (block->succ_size() != 2U) {
+            continue;
+        }
+        const auto* terminator = block->getTerminatorStmt();
+        if (llvm::isa_and_present< clang::SwitchStmt,
+                                   clang::IndirectGotoStmt >(terminator)) {
+            continue;
+        }
+        const auto* cond = llvm::dyn_cast_or_null< clang::Expr >(
+            block->getTerminatorCondition());
+        if (cond == nullptr) {
+            continue;
+        }
+        // The first successor is taken when the condition holds, and the
+        // edges pruned by clang have no reachable successor.
+        const auto* true_succ = block->succ_begin()->getReachableBlock();
+        const auto* false_succ =
+            std::next(block->succ_begin())->getReachableBlock();
+        if (true_succ == nullptr || false_succ == nullptr ||
+            true_succ == false_succ) {
+            continue;
+        }
+        auto value = folder.fold(cond);
+        if (!value) {
+            continue;
+        }
+        const auto* dead_succ = value->isZero() ? true_succ : false_succ;
+        edges.m_edges.insert({block->getBlockID(), dead_succ->getBlockID()});
+    }
+    NumFoldedBranches += edges.size();
+    return edges;
+}
+
+} // namespace knight::dfa
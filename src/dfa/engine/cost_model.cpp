@@ -0,0 +1,138 @@
+//===- cost_model.cpp -------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the cost model of analyzing a function.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/engine/cost_model.hpp"
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/Format.h>
+
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace knight::dfa {
+
+namespace {
+
+struct FunctionCostRecord {
+    std::string name;
+    FunctionCost cost;
+    FunctionDeadline::Milliseconds elapsed;
+}; // struct FunctionCostRecord
+
+struct FunctionCostRecords {
+    std::mutex mutex;
+    std::vector< FunctionCostRecord > records;
+}; // struct FunctionCostRecords
+
+FunctionCostRecords& get_function_cost_records() {
+    static FunctionCostRecords records;
+    return records;
+}
+
+} // anonymous namespace
+
+FunctionCost estimate_function_cost(const StackFrame* frame) {
+    FunctionCost cost;
+    const auto* cfg = frame->get_cfg();
+    const auto* wto = frame->get_wto();
+    if (cfg == nullptr || wto == nullptr) {
+        return cost;
+    }
+
+    for (ProcCFG::NodeRef node : cfg->get_clang_cfg()) {
+        const auto nesting = wto->get_nesting(node);
+        const auto depth = static_cast< unsigned >(
+            std::distance(nesting.begin(), nesting.end()));
+        uint64_t weight = 1U;
+        for (unsigned i = 0U; i < std::min(depth, FunctionCost::MaxLoopDepth);
+             ++i) {
+            weight *= FunctionCost::LoopFactor;
+        }
+        ++cost.num_blocks;
+        cost.num_stmts += node->size();
+        cost.max_loop_depth = std::max(cost.max_loop_depth, depth);
+        // The WTO component of the block is a step of its own.
+        cost.predicted += (node->size() + 1U) * weight;
+    }
+    return cost;
+}
+
+uint64_t get_outlier_cost(llvm::ArrayRef< FunctionCost > costs) {
+    if (costs.empty()) {
+        return 0U;
+    }
+    std::vector< uint64_t > predicted;
+    predicted.reserve(costs.size());
+    for (const auto& cost : costs) {
+        predicted.push_back(cost.predicted);
+    }
+    auto median = predicted.begin() + (predicted.size() / 2U);
+    std::nth_element(predicted.begin(), median, predicted.end());
+    return std::max(*median * FunctionCost::OutlierFactor,
+                    FunctionCost::MinOutlierCost);
+}
+
+void record_function_cost(std::string name,
+                          const FunctionCost& cost,
+                          FunctionDeadline::Milliseconds elapsed) {
+    auto& records = get_function_cost_records();
+    const std::lock_guard< std::mutex > lock(records.mutex);
+    records.records.push_back(
+        FunctionCostRecord{std::move(name), cost, elapsed});
+}
+
+void print_function_costs(llvm::raw_ostream& os) {
+    auto& records = get_function_cost_records();
+    const std::lock_guard< std::mutex > lock(records.mutex);
+    if (records.records.empty()) {
+        return;
+    }
+
+    llvm::stable_sort(records.records, [](const auto& lhs, const auto& rhs) {
+        return lhs.elapsed > rhs.elapsed;
+    });
+    uint64_t total_predicted = 0U;
+    FunctionDeadline::Milliseconds total_elapsed{0};
+    os << "\n* predicted against actual cost of "
+       << records.records.size() << " function"
+       << (records.records.size() > 1 ? "s" : "") << ":\n";
+    os << llvm::format("  %10s %10s %8s %8s %6s  %s\n",
+                       "actual ms",
+                       "predicted",
+                       "blocks",
+                       "stmts",
+                       "depth",
+                       "function");
+    for (const auto& [name, cost, elapsed] : records.records) {
+        total_predicted += cost.predicted;
+        total_elapsed += elapsed;
+        os << llvm::format("  %10lld %10llu %8u %8u %6u  ",
+                           static_cast< long long >(elapsed.count()),
+                           static_cast< unsigned long long >(cost.predicted),
+                           cost.num_blocks,
+                           cost.num_stmts,
+                           cost.max_loop_depth)
+           << name << "\n";
+    }
+    if (total_predicted != 0U) {
+        os << llvm::format("  %.3f ms per 1000 predicted steps\n",
+                           1000.0 * static_cast< double >(
+                                        total_elapsed.count()) /
+                               static_cast< double >(total_predicted));
+    }
+}
+
+} // namespace knight::dfa
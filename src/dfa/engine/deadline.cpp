@@ -0,0 +1,74 @@
+//===- deadline.cpp ---------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the report of the analysis deadlines.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/engine/deadline.hpp"
+
+#include <llvm/ADT/STLExtras.h>
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace knight::dfa {
+
+namespace {
+
+struct TimedOutFunction {
+    std::string name;
+    FunctionDeadline::Milliseconds elapsed;
+    bool memory_exceeded;
+}; // struct TimedOutFunction
+
+struct TimedOutFunctions {
+    std::mutex mutex;
+    std::vector< TimedOutFunction > functions;
+}; // struct TimedOutFunctions
+
+TimedOutFunctions& get_timed_out_functions() {
+    static TimedOutFunctions timed_out_functions;
+    return timed_out_functions;
+}
+
+} // anonymous namespace
+
+void record_timed_out_function(std::string name,
+                               FunctionDeadline::Milliseconds elapsed,
+                               bool memory_exceeded) {
+    auto& timed_out = get_timed_out_functions();
+    const std::lock_guard< std::mutex > lock(timed_out.mutex);
+    timed_out.functions.push_back(
+        TimedOutFunction{std::move(name), elapsed, memory_exceeded});
+}
+
+void print_timed_out_functions(llvm::raw_ostream& os) {
+    auto& timed_out = get_timed_out_functions();
+    const std::lock_guard< std::mutex > lock(timed_out.mutex);
+    if (timed_out.functions.empty()) {
+        return;
+    }
+
+    llvm::stable_sort(timed_out.functions,
+                      [](const auto& lhs, const auto& rhs) {
+                          return lhs.elapsed > rhs.elapsed;
+                      });
+    os << "\n* " << timed_out.functions.size() << " function"
+       << (timed_out.functions.size() > 1 ? "s" : "")
+       << " exceeded the analysis deadline, results are degraded:\n";
+    for (const auto& [name, elapsed, memory_exceeded] :
+         timed_out.functions) {
+        os << "  " << name << ": " << elapsed.count() << " ms"
+           << (memory_exceeded ? ", out of memory" : "") << "\n";
+    }
+}
+
+} // namespace knight::dfa
@@ -16,92 +16,570 @@
 #include "dfa/analysis/analysis_base.hpp"
 #include "dfa/checker/checker_base.hpp"
 #include "dfa/checker_context.hpp"
+#include "dfa/def_use.hpp"
 #include "dfa/engine/block_engine.hpp"
+#include "dfa/engine/condition_refiner.hpp"
+#include "dfa/invariant_export.hpp"
+#include "dfa/profiler.hpp"
 #include "dfa/program_state.hpp"
 #include "llvm/Support/raw_ostream.h"
+#include "tooling/context.hpp"
+
+#include <clang/AST/Expr.h>
+#include <clang/AST/Stmt.h>
+#include <llvm/ADT/APSInt.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/Support/Debug.h>
+#include <llvm/Support/TimeProfiler.h>
+
+#include <algorithm>
+#include <iterator>
+
+#define DEBUG_TYPE "intraprocedural-fixpoint" // NOLINT
+
+ALWAYS_ENABLED_STATISTIC(NumAnalyzedFunctions,
+                         "The number of analyzed functions");
+ALWAYS_ENABLED_STATISTIC(MaxFunctionArenaBytes,
+                         "The peak bytes of a function arena");
+ALWAYS_ENABLED_STATISTIC(NumThresholdWidenings,
+                         "The number of widenings with loop thresholds");
+ALWAYS_ENABLED_STATISTIC(NumLoopIterations, "The number of loop iterations");
+ALWAYS_ENABLED_STATISTIC(
+    NumLoopsOverBudget,
+    "The number of loops which hit the narrowing cap or iteration budget");
+ALWAYS_ENABLED_STATISTIC(NumSkippedNodes,
+                         "The number of node transfers skipped on bottom");
+ALWAYS_ENABLED_STATISTIC(
+    NumReusedCycles,
+    "The number of nested cycles reusing the invariants of their last visit");
+ALWAYS_ENABLED_STATISTIC(NumTransferCacheHits,
+                         "The number of block transfers memoized");
+ALWAYS_ENABLED_STATISTIC(NumTransferCacheMisses,
+                         "The number of block transfers not memoized");
+ALWAYS_ENABLED_STATISTIC(NumTransferCacheEvictions,
+                         "The number of memoized block transfers evicted");
+ALWAYS_ENABLED_STATISTIC(
+    NumSparseSkippedNodes,
+    "The number of transfers of the transparent nodes skipped");
+ALWAYS_ENABLED_STATISTIC(
+    NumTracePartitionedNodes,
+    "The number of nodes transferred with several trace partitions");
+ALWAYS_ENABLED_STATISTIC(NumTracePartitions,
+                         "The number of trace partitions transferred");
+ALWAYS_ENABLED_STATISTIC(NumTracePartitionMerges,
+                         "The number of trace partitions merged over budget");
+ALWAYS_ENABLED_STATISTIC(NumTimedOutFunctions,
+                         "The number of functions exceeding their deadline");
 
 namespace knight::dfa {
 
+namespace {
+
+constexpr std::size_t BytesPerMiB = 1U << 20U;
+
+} // anonymous namespace
+
+std::size_t FunctionMemoryUsage::get_total_bytes() const {
+    std::size_t bytes = state_arena_bytes + stmt_state_bytes;
+    for (const auto dom_bytes : dom_val_bytes) {
+        bytes += dom_bytes;
+    }
+    return bytes;
+}
+
+void FunctionMemoryUsage::merge_peak(const FunctionMemoryUsage& other) {
+    state_arena_bytes = std::max(state_arena_bytes, other.state_arena_bytes);
+    live_states = std::max(live_states, other.live_states);
+    free_states = std::max(free_states, other.free_states);
+    stmt_state_bytes = std::max(stmt_state_bytes, other.stmt_state_bytes);
+    for (std::size_t id = 0U; id < NumDomIDs; ++id) {
+        dom_val_bytes[id] =
+            std::max(dom_val_bytes[id], other.dom_val_bytes[id]);
+    }
+    for (std::size_t kind = 0U; kind < NumRegionKinds; ++kind) {
+        regions[kind] = std::max(regions[kind], other.regions[kind]);
+    }
+}
+
 IntraProceduralFixpointIterator::IntraProceduralFixpointIterator(
-    knight::KnightContext& ctx,
+    knight::KnightTUContext& ctx,
     AnalysisManager& analysis_mgr,
     CheckerManager& checker_mgr,
-    ProgramStateManager& state_mgr,
     const StackFrame* frame)
-    : m_frame(frame),
+    : FunctionArena(analysis_mgr),
+      WtoBasedFixPointIterator(frame, m_state_mgr.get_bottom_state()),
       m_ctx(ctx),
+      m_checker_mgr(checker_mgr),
       m_analysis_mgr(analysis_mgr),
+      m_frame(frame) {
+    const auto& opts = ctx.get_current_options();
+    apply_options(opts);
+    if (opts.max_inline_depth > 0U) {
+        m_own_inliner = std::make_unique< CallInliner >(ctx,
+                                                        analysis_mgr,
+                                                        checker_mgr,
+                                                        m_state_mgr,
+                                                        opts.max_inline_depth,
+                                                        opts.inline_cache_size);
+        m_inliner = m_own_inliner.get();
+    }
+}
+
+IntraProceduralFixpointIterator::IntraProceduralFixpointIterator(
+    knight::KnightTUContext& ctx,
+    AnalysisManager& analysis_mgr,
+    CheckerManager& checker_mgr,
+    const StackFrame* frame,
+    ProgramStateManager& state_mgr,
+    CallInliner& inliner)
+    : FunctionArena(state_mgr),
+      WtoBasedFixPointIterator(frame, m_state_mgr.get_bottom_state()),
+      m_ctx(ctx),
       m_checker_mgr(checker_mgr),
-      m_state_mgr(state_mgr),
-      WtoBasedFixPointIterator(frame, state_mgr.get_bottom_state()) {}
+      m_analysis_mgr(analysis_mgr),
+      m_frame(frame),
+      m_inliner(&inliner),
+      m_is_inlined(true) {
+    apply_options(ctx.get_current_options());
+}
+
+void IntraProceduralFixpointIterator::apply_options(
+    const KnightOptions& opts) {
+    set_strategy(select_strategy(opts, get_cfg()));
+    set_policy(LoopIterationPolicy{
+        .widening_delay = opts.widening_delay,
+        .max_narrowing_iterations = opts.max_narrowing_iterations,
+        .max_iterations = opts.max_loop_iterations,
+        .max_trace_partitions = opts.trace_partitions,
+    });
+    m_max_transfer_cache_size = opts.transfer_cache_size;
+    m_time_limit = opts.function_time_limit;
+    m_def_use = opts.sparse_analysis ? m_frame->get_def_use_chains() : nullptr;
+}
+
+void IntraProceduralFixpointIterator::set_summaries(
+    SummaryTable* summaries) {
+    m_summaries = summaries;
+    if (m_own_inliner != nullptr) {
+        m_own_inliner->set_summaries(summaries);
+    }
+}
+
+FunctionDeadline* IntraProceduralFixpointIterator::get_active_deadline() {
+    if (m_is_inlined) {
+        return m_caller_deadline;
+    }
+    return m_deadline.is_enabled() ? &m_deadline : nullptr;
+}
+
+FixpointStrategy IntraProceduralFixpointIterator::select_strategy(
+    const KnightOptions& opts, const ProcCFG* cfg) {
+    switch (opts.fixpoint_iterator) {
+        case FixpointIteratorKind::Wto:
+            return FixpointStrategy::Wto;
+        case FixpointIteratorKind::Worklist:
+            return FixpointStrategy::Worklist;
+        case FixpointIteratorKind::Auto:
+            break;
+    }
+    return cfg->get_num_blocks() >= opts.worklist_min_blocks
+               ? FixpointStrategy::Worklist
+               : FixpointStrategy::Wto;
+}
+
+namespace {
+
+/// \brief Collect the integer literals of the blocks of each WTO cycle,
+/// nested cycles included.
+class LoopThresholdsCollector final
+    : public WtoComponentVisitor< ProcCFG, GraphTrait< ProcCFG > > {
+  private:
+    using NodeRef = ProcCFG::NodeRef;
+
+    std::unordered_map< NodeRef, Thresholds >& m_thresholds;
+    std::vector< Thresholds* > m_loops;
+
+  public:
+    explicit LoopThresholdsCollector(
+        std::unordered_map< NodeRef, Thresholds >& thresholds)
+        : m_thresholds(thresholds) {}
+
+    void visit(const WtoVertexT& vertex) override {
+        collect(vertex.get_node());
+    }
+
+    void visit(const WtoCycleT& cycle) override {
+        m_loops.push_back(&m_thresholds[cycle.get_head()]);
+        collect(cycle.get_head());
+        for (const auto* component : cycle.components()) {
+            component->accept(*this);
+        }
+        m_loops.pop_back();
+    }
+
+  private:
+    void collect(NodeRef node) {
+        if (m_loops.empty()) {
+            return;
+        }
+        for (const auto& elem : node->Elements) {
+            auto stmt_opt = elem.getAs< clang::CFGStmt >();
+            if (!stmt_opt) {
+                continue;
+            }
+            const auto* stmt = stmt_opt->getStmt();
+            bool negated = false;
+            if (const auto* unary = llvm::dyn_cast< clang::UnaryOperator >(
+                    stmt);
+                unary != nullptr && unary->getOpcode() == clang::UO_Minus) {
+                stmt = unary->getSubExpr()->IgnoreParenImpCasts();
+                negated = true;
+            }
+            const auto* literal =
+                llvm::dyn_cast_or_null< clang::IntegerLiteral >(stmt);
+            if (literal == nullptr) {
+                continue;
+            }
+            llvm::APSInt value(literal->getValue(),
+                               literal->getType()
+                                   ->isUnsignedIntegerOrEnumerationType());
+            if (value.getMinSignedBits() > 64U) {
+                continue;
+            }
+            auto num = value.getExtValue();
+            for (auto* thresholds : m_loops) {
+                thresholds->add(negated ? -num : num);
+            }
+        }
+    }
+
+}; // class LoopThresholdsCollector
+
+} // anonymous namespace
+
+void IntraProceduralFixpointIterator::collect_loop_thresholds() {
+    LoopThresholds().swap(m_loop_thresholds);
+    LoopThresholdsCollector collector(m_loop_thresholds);
+    get_wto().accept(collector);
+}
+
+void IntraProceduralFixpointIterator::collect_infeasible_edges() {
+    m_infeasible_edges.clear();
+    if (m_ctx.get_current_options().fold_constant_branches) {
+        m_infeasible_edges =
+            InfeasibleEdges::compute(m_frame->get_decl(), *get_cfg());
+    }
+}
+
+ProgramStateRef IntraProceduralFixpointIterator::merge_at_head_when_increasing(
+    NodeRef head,
+    unsigned iter_cnt,
+    const ProgramStateRef& state_before,
+    const ProgramStateRef& state_after) {
+    // Drop the dead bindings first, so that they are not merged at all.
+    ProgramStateRef before = state_before;
+    ProgramStateRef after = state_after;
+    if (const auto* live_vars = m_frame->get_live_variables()) {
+        const auto live = live_vars->get_live_in(head);
+        before = before->remove_dead(live, m_frame);
+        after = after->remove_dead(live, m_frame);
+    }
+
+    if (iter_cnt <= get_widening_delay(head)) {
+        return before->join_consecutive_iter(after);
+    }
+    auto it = m_loop_thresholds.find(head);
+    if (it == m_loop_thresholds.end() || it->second.empty()) {
+        return before->widen(after);
+    }
+    ++NumThresholdWidenings;
+    return before->widen_with_thresholds(after, it->second);
+}
+
+bool IntraProceduralFixpointIterator::is_cycle_traced() const {
+    return llvm::timeTraceProfilerEnabled() &&
+           get_strategy() == FixpointStrategy::Wto;
+}
+
+void IntraProceduralFixpointIterator::notify_enter_cycle(NodeRef head) {
+    if (Profiler::is_enabled()) {
+        m_cycle_starts.push_back(Profiler::Clock::now());
+    }
+    if (!is_cycle_traced()) {
+        return;
+    }
+    llvm::timeTraceProfilerBegin("Cycle", [head] {
+        return "B" + std::to_string(head->getBlockID());
+    });
+    m_cycle_iteration_spans.push_back(false);
+}
+
+void IntraProceduralFixpointIterator::notify_each_cycle_iteration(
+    NodeRef head, unsigned iter_cnt, IterationKind kind) {
+    if (Profiler::is_enabled()) {
+        auto& stats = m_head_stats[head];
+        ++(kind == IterationKind::Increasing ? stats.increasing
+                                             : stats.decreasing);
+    }
+    if (!is_cycle_traced() || m_cycle_iteration_spans.empty()) {
+        return;
+    }
+    if (m_cycle_iteration_spans.back()) {
+        llvm::timeTraceProfilerEnd();
+    }
+    llvm::timeTraceProfilerBegin("CycleIteration", [=] {
+        return "B" + std::to_string(head->getBlockID()) +
+               (kind == IterationKind::Increasing ? " increasing #"
+                                                  : " decreasing #") +
+               std::to_string(iter_cnt);
+    });
+    m_cycle_iteration_spans.back() = true;
+}
+
+void IntraProceduralFixpointIterator::notify_exit_cycle(NodeRef head) {
+    if (Profiler::is_enabled() && !m_cycle_starts.empty()) {
+        m_head_stats[head].elapsed +=
+            Profiler::Clock::now() - m_cycle_starts.back();
+        m_cycle_starts.pop_back();
+    }
+    if (!is_cycle_traced() || m_cycle_iteration_spans.empty()) {
+        return;
+    }
+    if (m_cycle_iteration_spans.back()) {
+        llvm::timeTraceProfilerEnd();
+    }
+    m_cycle_iteration_spans.pop_back();
+    llvm::timeTraceProfilerEnd();
+}
+
+void IntraProceduralFixpointIterator::notify_trace_partitions(
+    NodeRef node, unsigned num_partitions) {
+    NumTracePartitions += num_partitions;
+    if (num_partitions < 2U) {
+        return;
+    }
+    ++NumTracePartitionedNodes;
+    if (Profiler::is_enabled()) {
+        m_partition_stats.emplace_back(node, num_partitions);
+    }
+}
 
 ProgramStateRef IntraProceduralFixpointIterator::transfer_node(
     NodeRef node, ProgramStateRef pre_state) {
+    // The values flow through the transparent nodes unchanged.
+    if (m_def_use != nullptr && m_def_use->is_transparent(node)) {
+        ++NumSparseSkippedNodes;
+        return pre_state;
+    }
+
+    const TransferCacheKey key{node->getBlockID(), pre_state.get()};
+    if (m_max_transfer_cache_size != 0U) {
+        auto it = m_transfer_cache.find(key);
+        if (it != m_transfer_cache.end()) {
+            ++NumTransferCacheHits;
+            m_transfer_cache_order.splice(m_transfer_cache_order.begin(),
+                                          m_transfer_cache_order,
+                                          it->second.order_it);
+            return it->second.post;
+        }
+        ++NumTransferCacheMisses;
+    }
+
+    auto* deadline = get_active_deadline();
     BlockExecutionEngine engine(get_cfg(),
                                 node,
                                 m_analysis_mgr,
                                 pre_state,
-                                m_stmt_pre,
-                                m_stmt_post,
                                 m_frame);
+    engine.set_deadline(deadline);
+    engine.set_summaries(m_summaries);
+    engine.set_inliner(m_inliner);
     engine.exec();
-    return engine.get_state();
+    ProgramStateRef post_state = engine.get_state();
+
+    // A block cut by the deadline depends on the remaining budget, hence
+    // is not reused.
+    if (deadline == nullptr || !deadline->is_expired()) {
+        insert_transfer(key, std::move(pre_state), post_state);
+    }
+    return post_state;
 }
 
-ProgramStateRef IntraProceduralFixpointIterator::transfer_edge(
-    [[maybe_unused]] NodeRef src,
-    [[maybe_unused]] NodeRef dst,
-    ProgramStateRef src_post_state) {
-    return src_post_state;
+void IntraProceduralFixpointIterator::insert_transfer(
+    TransferCacheKey key,
+    ProgramStateRef pre_state,
+    ProgramStateRef post_state) {
+    if (m_max_transfer_cache_size == 0U) {
+        return;
+    }
+    if (m_transfer_cache.size() >= m_max_transfer_cache_size) {
+        m_transfer_cache.erase(m_transfer_cache_order.back());
+        m_transfer_cache_order.pop_back();
+        ++NumTransferCacheEvictions;
+    }
+    m_transfer_cache_order.push_front(key);
+    m_transfer_cache.try_emplace(key,
+                                 TransferCacheEntry{std::move(pre_state),
+                                                    std::move(post_state),
+                                                    m_transfer_cache_order
+                                                        .begin()});
 }
 
-void IntraProceduralFixpointIterator::check_pre(
-    NodeRef node, [[maybe_unused]] const ProgramStateRef& state) {
-    for (const auto& elem : node->Elements) {
+bool IntraProceduralFixpointIterator::is_node_checked(NodeRef node) const {
+    return llvm::any_of(node->Elements, [this](const clang::CFGElement& elem) {
         auto stmt_opt = elem.getAs< clang::CFGStmt >();
-        if (!stmt_opt) {
+        if (!stmt_opt || stmt_opt->getStmt() == nullptr) {
+            return false;
+        }
+        const auto* stmt = stmt_opt->getStmt();
+        return m_checker_mgr
+                   .has_checkers_for_stmt(stmt, internal::CheckStmtKind::Pre) ||
+               m_checker_mgr
+                   .has_checkers_for_stmt(stmt, internal::CheckStmtKind::Post);
+    });
+}
+
+void IntraProceduralFixpointIterator::replay_node(
+    NodeRef node, const ProgramStateRef& pre_state) {
+    m_replayed_node = node;
+    m_stmt_pre.clear();
+    m_stmt_post.clear();
+    if (!is_node_checked(node)) {
+        return;
+    }
+
+    BlockExecutionEngine engine(get_cfg(),
+                                node,
+                                m_analysis_mgr,
+                                pre_state,
+                                m_frame);
+    engine.record_stmt_states(m_stmt_pre, m_stmt_post, m_checker_mgr);
+    engine.set_summaries(m_summaries);
+    engine.set_inliner(m_inliner);
+    engine.exec();
+}
+
+void IntraProceduralFixpointIterator::export_invariants() {
+    const bool with_stmts = InvariantExporter::is_with_stmts();
+    std::vector< InvariantSite > sites;
+    for (const auto* node : get_cfg()->get_clang_cfg()) {
+        auto pre_state = get_pre(node);
+        sites.push_back(InvariantSite{
+            .block = node,
+            .pre = pre_state,
+            .post = get_post(node),
+        });
+        if (!with_stmts || pre_state->is_bottom()) {
             continue;
         }
-        const auto* stmt = stmt_opt.value().getStmt();
-        if (stmt == nullptr) {
-            return;
+
+        StmtStates stmt_pre;
+        StmtStates stmt_post;
+        BlockExecutionEngine engine(get_cfg(),
+                                    node,
+                                    m_analysis_mgr,
+                                    pre_state,
+                                    m_frame);
+        engine.record_all_stmt_states(stmt_pre, stmt_post);
+        engine.set_summaries(m_summaries);
+        engine.set_inliner(m_inliner);
+        engine.exec();
+        for (std::size_t i = 0U;
+             i < std::min(stmt_pre.size(), stmt_post.size());
+             ++i) {
+            sites.push_back(InvariantSite{
+                .block = node,
+                .stmt = stmt_pre[i].first,
+                .pre = stmt_pre[i].second,
+                .post = stmt_post[i].second,
+            });
         }
+    }
+    InvariantExporter::record_function(m_frame->get_decl(), sites);
+}
+
+ProgramStateRef IntraProceduralFixpointIterator::transfer_edge(
+    NodeRef src, NodeRef dst, ProgramStateRef src_post_state) {
+    if (m_infeasible_edges.contains(src, dst)) {
+        return get_bottom();
+    }
+    if (src_post_state->is_bottom() || src->succ_size() != 2U) {
+        return src_post_state;
+    }
+    const auto* terminator = src->getTerminatorStmt();
+    if (llvm::isa_and_present< clang::SwitchStmt, clang::IndirectGotoStmt >(
+            terminator)) {
+        return src_post_state;
+    }
+    const auto* cond =
+        llvm::dyn_cast_or_null< clang::Expr >(src->getTerminatorCondition());
+    if (cond == nullptr) {
+        return src_post_state;
+    }
 
-        auto it = m_stmt_pre.find(stmt);
-        auto pre_state = it == m_stmt_pre.end() ? m_state_mgr.get_bottom_state()
-                                                : it->second;
+    // The first successor is taken when the condition holds.
+    const auto* true_succ = src->succ_begin()->getReachableBlock();
+    const auto* false_succ = std::next(src->succ_begin())->getReachableBlock();
+    if (true_succ == false_succ || (dst != true_succ && dst != false_succ)) {
+        return src_post_state;
+    }
+    const ConditionRefiner refiner(m_analysis_mgr.get_region_manager(),
+                                   m_state_mgr.get_var_index(),
+                                   m_frame);
+    return refiner.refine(std::move(src_post_state), cond, dst == true_succ);
+}
 
-        CheckerContext checker_ctx(m_ctx);
-        checker_ctx.set_current_state(pre_state);
-        checker_ctx.set_current_stack_frame(m_frame);
+CheckerContext IntraProceduralFixpointIterator::make_checker_context() const {
+    CheckerContext checker_ctx(m_ctx);
+    checker_ctx.set_current_stack_frame(m_frame);
+    checker_ctx.set_degraded(m_deadline.is_expired());
+    return checker_ctx;
+}
 
+void IntraProceduralFixpointIterator::check_pre(
+    NodeRef node, const ProgramStateRef& state) {
+    if (m_is_inlined) {
+        return;
+    }
+    replay_node(node, state);
+    if (m_stmt_pre.empty()) {
+        return;
+    }
+    // The recorded states are in the order of the stmts of the node.
+    auto checker_ctx = make_checker_context();
+    for (const auto& [stmt, stmt_state] : m_stmt_pre) {
+        checker_ctx.set_current_state(stmt_state);
         m_checker_mgr.run_checkers_for_pre_stmt(checker_ctx, stmt);
     }
 }
 
 void IntraProceduralFixpointIterator::check_post(
     NodeRef node, [[maybe_unused]] const ProgramStateRef& state) {
-    for (const auto& elem : node->Elements) {
-        auto stmt_opt = elem.getAs< clang::CFGStmt >();
-        if (!stmt_opt) {
-            continue;
-        }
-        const auto* stmt = stmt_opt.value().getStmt();
-        if (stmt == nullptr) {
-            return;
-        }
-        auto it = m_stmt_post.find(stmt);
-        auto post_state = it == m_stmt_post.end()
-                              ? m_state_mgr.get_bottom_state()
-                              : it->second;
-        CheckerContext checker_ctx(m_ctx);
-        checker_ctx.set_current_state(post_state);
-        checker_ctx.set_current_stack_frame(m_frame);
+    if (m_is_inlined) {
+        return;
+    }
+    // The checker visits the post of a node right after its pre.
+    if (m_replayed_node != node) {
+        replay_node(node, get_pre(node));
+    }
+    if (m_stmt_post.empty()) {
+        return;
+    }
+    auto checker_ctx = make_checker_context();
+    for (const auto& [stmt, stmt_state] : m_stmt_post) {
+        checker_ctx.set_current_state(stmt_state);
         m_checker_mgr.run_checkers_for_post_stmt(checker_ctx, stmt);
     }
 }
 
 void IntraProceduralFixpointIterator::run() {
+    const std::string function_name =
+        Profiler::is_enabled() ? get_decl_profile_name(m_frame->get_decl())
+                               : "";
+    const ProfileScope scope(ProfileCategory::Function, function_name);
+
     auto initial_state = m_state_mgr.get_default_state();
 
     AnalysisContext analysis_ctx(m_ctx, m_analysis_mgr.get_region_manager());
@@ -116,7 +594,27 @@ void IntraProceduralFixpointIterator::run() {
 
     m_checker_mgr.run_checkers_for_begin_function(checker_ctx);
 
-    FixPointIterator::run(initial_state);
+    const auto& opts = m_ctx.get_current_options();
+    m_deadline =
+        FunctionDeadline(m_time_limit,
+                         opts.function_step_limit,
+                         std::size_t(opts.max_memory_per_function) *
+                             BytesPerMiB);
+    if (opts.max_memory_per_function != 0U || Profiler::is_enabled()) {
+        start_memory_sampling();
+    }
+    set_deadline(get_active_deadline());
+
+    collect_loop_thresholds();
+    collect_infeasible_edges();
+    {
+        const ProfileScope phase_scope(ProfileCategory::Phase, "fixpoint");
+        FixPointIterator::run(initial_state);
+    }
+    if (m_checker_mgr.has_stmt_checkers()) {
+        const ProfileScope phase_scope(ProfileCategory::Phase, "check");
+        FixPointIterator::check();
+    }
 
     NodeRef exit_node = ProcCFG::exit(get_cfg());
 
@@ -125,7 +623,185 @@ void IntraProceduralFixpointIterator::run() {
     m_analysis_mgr.run_analyses_for_end_function(analysis_ctx, exit_node);
 
     checker_ctx.set_current_state(exit_state);
+    checker_ctx.set_degraded(m_deadline.is_expired());
     m_checker_mgr.run_checkers_for_end_function(checker_ctx, exit_node);
+
+    m_summary = FunctionSummary{
+        .may_return = !exit_state->is_bottom(),
+        .is_degraded = m_deadline.is_expired(),
+    };
+    if (m_summaries != nullptr) {
+        m_summaries->set(m_frame->get_decl(), m_summary);
+    }
+
+    if (m_deadline.is_expired()) {
+        ++NumTimedOutFunctions;
+        const auto* decl =
+            llvm::dyn_cast_or_null< clang::NamedDecl >(m_frame->get_decl());
+        record_timed_out_function(decl != nullptr
+                                      ? decl->getQualifiedNameAsString()
+                                      : "<unnamed>",
+                                  m_deadline.get_elapsed(),
+                                  m_deadline.is_memory_exceeded());
+        LLVM_DEBUG(llvm::dbgs() << "function deadline expired after "
+                                << m_deadline.get_steps() << " steps\n");
+    }
+
+    ++NumAnalyzedFunctions;
+    NumLoopIterations += get_num_iterations();
+    NumLoopsOverBudget += get_num_loops_over_budget();
+    NumSkippedNodes += get_num_skipped_nodes();
+    NumReusedCycles += get_num_reused_cycles();
+    NumTracePartitionMerges += get_num_partition_merges();
+    LLVM_DEBUG(llvm::dbgs() << "loop iterations: " << get_num_iterations()
+                            << ", loops over budget: "
+                            << get_num_loops_over_budget() << "\n");
+
+    // Each loop head has its iterations and time, and the iterations by
+    // kind apart.
+    for (const auto& [head, stats] : m_head_stats) {
+        const std::string head_name =
+            function_name + ":B" + std::to_string(head->getBlockID());
+        Profiler::record(ProfileCategory::LoopHead,
+                         head_name,
+                         stats.increasing + stats.decreasing,
+                         stats.elapsed);
+        Profiler::record(ProfileCategory::LoopHead,
+                         head_name + ":increasing",
+                         stats.increasing,
+                         Profiler::Clock::duration::zero());
+        Profiler::record(ProfileCategory::LoopHead,
+                         head_name + ":decreasing",
+                         stats.decreasing,
+                         Profiler::Clock::duration::zero());
+    }
+    for (const auto& [node, num_partitions] : m_partition_stats) {
+        Profiler::record(ProfileCategory::TracePartition,
+                         function_name + ":B" +
+                             std::to_string(node->getBlockID()),
+                         num_partitions,
+                         Profiler::Clock::duration::zero());
+    }
+
+    m_peak_arena_bytes = m_arena.getTotalMemory();
+    MaxFunctionArenaBytes.updateMax(m_peak_arena_bytes);
+    LLVM_DEBUG(llvm::dbgs() << "function arena peak bytes: "
+                            << m_peak_arena_bytes << "\n");
+
+    if (Profiler::is_enabled()) {
+        // The stmt states of the checkers are recorded after the fixpoint.
+        (void)sample_memory();
+        record_memory_profile(function_name);
+    }
+
+    if (InvariantExporter::is_enabled()) {
+        export_invariants();
+    }
+
+    release_states();
+}
+
+ProgramStateRef IntraProceduralFixpointIterator::run_inlined(
+    ProgramStateRef entry_state, FunctionDeadline* deadline) {
+    AnalysisContext analysis_ctx(m_ctx, m_analysis_mgr.get_region_manager());
+    analysis_ctx.set_current_stack_frame(m_frame);
+    analysis_ctx.set_state(entry_state);
+    m_analysis_mgr.run_analyses_for_begin_function(analysis_ctx);
+
+    m_caller_deadline = deadline;
+    set_deadline(deadline);
+
+    collect_loop_thresholds();
+    collect_infeasible_edges();
+    FixPointIterator::run(std::move(entry_state));
+
+    NodeRef exit_node = ProcCFG::exit(get_cfg());
+    auto exit_state = get_post(exit_node);
+    analysis_ctx.set_state(exit_state);
+    m_analysis_mgr.run_analyses_for_end_function(analysis_ctx, exit_node);
+
+    release_states();
+    return exit_state;
+}
+
+void IntraProceduralFixpointIterator::start_memory_sampling() {
+    m_peak_memory = FunctionMemoryUsage{};
+    m_dom_val_bytes_at_start = get_thread_dom_val_bytes();
+    m_regions_at_start =
+        m_analysis_mgr.get_region_manager().get_region_counts();
+    m_deadline.set_memory_probe([this] { return sample_memory(); });
+}
+
+std::size_t IntraProceduralFixpointIterator::sample_memory() {
+    FunctionMemoryUsage usage;
+    usage.state_arena_bytes = m_state_mgr.get_allocated_bytes();
+    usage.live_states = m_state_mgr.get_num_live_states();
+    usage.free_states = m_state_mgr.get_num_free_states();
+    usage.stmt_state_bytes = (m_stmt_pre.capacity() + m_stmt_post.capacity()) *
+                             sizeof(StmtStates::value_type);
+
+    // The values freed by the function may have been allocated before.
+    const auto& dom_val_bytes = get_thread_dom_val_bytes();
+    for (std::size_t id = 0U; id < NumDomIDs; ++id) {
+        usage.dom_val_bytes[id] = static_cast< std::size_t >(
+            std::max< int64_t >(dom_val_bytes[id] -
+                                    m_dom_val_bytes_at_start[id],
+                                0));
+    }
+    const auto& regions =
+        m_analysis_mgr.get_region_manager().get_region_counts();
+    for (std::size_t kind = 0U; kind < NumRegionKinds; ++kind) {
+        usage.regions[kind] = regions[kind] - m_regions_at_start[kind];
+    }
+
+    m_peak_memory.merge_peak(usage);
+    return usage.get_total_bytes();
+}
+
+void IntraProceduralFixpointIterator::record_memory_profile(
+    const std::string& function_name) const {
+    const auto record = [&function_name](const llvm::Twine& component,
+                                         std::size_t value) {
+        if (value == 0U) {
+            return;
+        }
+        const auto name = (llvm::Twine(function_name) + ":" + component).str();
+        Profiler::record(ProfileCategory::Memory,
+                         name,
+                         value,
+                         Profiler::Clock::duration::zero());
+    };
+    record("state-arena-bytes", m_peak_memory.state_arena_bytes);
+    record("live-states", m_peak_memory.live_states);
+    record("free-states", m_peak_memory.free_states);
+    record("stmt-state-bytes", m_peak_memory.stmt_state_bytes);
+    for (std::size_t id = 0U; id < NumDomIDs; ++id) {
+        record("dom-val-bytes:" +
+                   get_domain_name_by_id(static_cast< DomID >(id)),
+               m_peak_memory.dom_val_bytes[id]);
+    }
+    for (std::size_t kind = 0U; kind < NumRegionKinds; ++kind) {
+        record("regions:" +
+                   get_region_kind_name(static_cast< RegionKind >(kind)),
+               m_peak_memory.regions[kind]);
+    }
+}
+
+void IntraProceduralFixpointIterator::release_states() {
+    StmtStates().swap(m_stmt_pre);
+    StmtStates().swap(m_stmt_post);
+    m_replayed_node = nullptr;
+    LoopThresholds().swap(m_loop_thresholds);
+    m_infeasible_edges.clear();
+    m_transfer_cache.clear();
+    std::list< TransferCacheKey >().swap(m_transfer_cache_order);
+    std::unordered_map< NodeRef, LoopHeadStats >().swap(m_head_stats);
+    m_cycle_starts.clear();
+    m_partition_stats.clear();
+    if (m_own_inliner != nullptr) {
+        m_own_inliner->clear();
+    }
+    clear();
 }
 
 } // namespace knight::dfa
\ No newline at end of file
@@ -0,0 +1,289 @@
+//===- invariant_export.cpp -------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the export of the computed invariants.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/invariant_export.hpp"
+#include "dfa/ast_lock.hpp"
+#include "dfa/invariant_file.hpp"
+#include "dfa/profiler.hpp"
+#include "util/binary.hpp"
+
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/Decl.h>
+#include <clang/Basic/SourceManager.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/WithColor.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <tuple>
+
+namespace knight::dfa {
+
+namespace {
+
+struct ExportedPoint {
+    uint32_t file;
+    uint32_t line;
+    uint32_t column;
+    uint32_t function;
+    InvariantPointKind kind;
+    uint32_t block;
+    uint32_t pre;
+    uint32_t post;
+}; // struct ExportedPoint
+
+/// \brief The interned strings, by their IDs in the order of insertion.
+struct StringTable {
+    llvm::StringMap< uint32_t > ids;
+    std::vector< llvm::StringRef > strings;
+
+    uint32_t intern(llvm::StringRef str) {
+        auto [it, inserted] =
+            ids.try_emplace(str, static_cast< uint32_t >(strings.size()));
+        if (inserted) {
+            strings.push_back(it->first());
+        }
+        return it->second;
+    }
+}; // struct StringTable
+
+struct InvariantTable {
+    std::mutex mutex;
+    StringTable states;
+    StringTable names;
+    std::vector< ExportedPoint > points;
+}; // struct InvariantTable
+
+InvariantTable& get_invariant_table() {
+    static InvariantTable table;
+    return table;
+}
+
+struct SiteLocation {
+    llvm::StringRef file;
+    unsigned line = 0U;
+    unsigned column = 0U;
+}; // struct SiteLocation
+
+SiteLocation get_site_location(const clang::SourceManager& sm,
+                               clang::SourceLocation loc) {
+    if (loc.isInvalid()) {
+        return {};
+    }
+    auto expansion_loc = sm.getExpansionLoc(loc);
+    return SiteLocation{
+        .file = sm.getFilename(expansion_loc),
+        .line = sm.getExpansionLineNumber(expansion_loc),
+        .column = sm.getExpansionColumnNumber(expansion_loc),
+    };
+}
+
+/// \brief Get the location of the first stmt of the block, or of the
+/// function body for the entry and the exit.
+clang::SourceLocation get_block_location(const clang::Decl* function,
+                                         ProcCFG::NodeRef block) {
+    for (const auto& elem : *block) {
+        if (auto stmt = elem.getAs< clang::CFGStmt >()) {
+            return stmt->getStmt()->getBeginLoc();
+        }
+    }
+    if (const auto* terminator = block->getTerminatorStmt()) {
+        return terminator->getBeginLoc();
+    }
+    const auto* body = function->getBody();
+    if (body == nullptr) {
+        return function->getLocation();
+    }
+    return block->succ_empty() ? body->getEndLoc() : body->getBeginLoc();
+}
+
+void write_string_offsets(llvm::raw_ostream& os,
+                          const std::vector< llvm::StringRef >& strings,
+                          uint64_t& offset) {
+    write_u64(os, offset);
+    for (const auto& str : strings) {
+        offset += str.size();
+        write_u64(os, offset);
+    }
+}
+
+} // anonymous namespace
+
+void InvariantExporter::record_function(
+    const clang::Decl* function, const std::vector< InvariantSite >& sites) {
+    struct LocalPoint {
+        SiteLocation location;
+        InvariantPointKind kind;
+        unsigned block;
+        uint32_t pre;
+        uint32_t post;
+    }; // struct LocalPoint
+
+    // The states are dumped once per hash-consed state, out of the lock.
+    const auto& ast_ctx = function->getASTContext();
+    const auto& sm = ast_ctx.getSourceManager();
+    llvm::DenseMap< const ProgramState*, uint32_t > local_ids;
+    std::vector< std::string > dumps;
+    const auto get_local_id = [&](const ProgramStateRef& state) {
+        auto [it, inserted] =
+            local_ids.try_emplace(state.get(),
+                                  static_cast< uint32_t >(dumps.size()));
+        if (inserted) {
+            llvm::raw_string_ostream os(dumps.emplace_back());
+            state->dump(os);
+        }
+        return it->second;
+    };
+    std::vector< LocalPoint > points;
+    points.reserve(sites.size());
+    for (const auto& site : sites) {
+        SiteLocation location;
+        {
+            // The source manager computes its line tables lazily.
+            const ASTLock lock(ast_ctx);
+            location = get_site_location(
+                sm,
+                site.stmt != nullptr
+                    ? site.stmt->getBeginLoc()
+                    : get_block_location(function, site.block));
+        }
+        points.push_back(LocalPoint{
+            .location = location,
+            .kind = site.stmt != nullptr ? InvariantPointKind::Stmt
+                                         : InvariantPointKind::Block,
+            .block = site.block->getBlockID(),
+            .pre = get_local_id(site.pre),
+            .post = get_local_id(site.post),
+        });
+    }
+    const auto function_name = get_decl_profile_name(function);
+
+    auto& table = get_invariant_table();
+    const std::lock_guard< std::mutex > lock(table.mutex);
+    std::vector< uint32_t > state_ids;
+    state_ids.reserve(dumps.size());
+    for (const auto& dump : dumps) {
+        state_ids.push_back(table.states.intern(dump));
+    }
+    const auto function_id = table.names.intern(function_name);
+    for (const auto& point : points) {
+        table.points.push_back(ExportedPoint{
+            .file = table.names.intern(point.location.file),
+            .line = point.location.line,
+            .column = point.location.column,
+            .function = function_id,
+            .kind = point.kind,
+            .block = point.block,
+            .pre = state_ids[point.pre],
+            .post = state_ids[point.post],
+        });
+    }
+}
+
+bool InvariantExporter::write(llvm::StringRef path) {
+    auto& table = get_invariant_table();
+    const std::lock_guard< std::mutex > lock(table.mutex);
+
+    // The names are sorted, and the points by their locations, for the
+    // binary searches of the reader.
+    const auto& names = table.names.strings;
+    std::vector< uint32_t > name_order(names.size());
+    std::iota(name_order.begin(), name_order.end(), 0U);
+    llvm::sort(name_order, [&names](uint32_t lhs, uint32_t rhs) {
+        return names[lhs] < names[rhs];
+    });
+    std::vector< uint32_t > name_ids(names.size());
+    std::vector< llvm::StringRef > sorted_names;
+    sorted_names.reserve(names.size());
+    for (auto old_id : name_order) {
+        name_ids[old_id] = static_cast< uint32_t >(sorted_names.size());
+        sorted_names.push_back(names[old_id]);
+    }
+    auto points = table.points;
+    for (auto& point : points) {
+        point.file = name_ids[point.file];
+        point.function = name_ids[point.function];
+    }
+    llvm::sort(points, [](const auto& lhs, const auto& rhs) {
+        return std::tie(lhs.file,
+                        lhs.line,
+                        lhs.column,
+                        lhs.function,
+                        lhs.block,
+                        lhs.kind) < std::tie(rhs.file,
+                                             rhs.line,
+                                             rhs.column,
+                                             rhs.function,
+                                             rhs.block,
+                                             rhs.kind);
+    });
+
+    std::error_code err;
+    llvm::raw_fd_ostream os(path, err, llvm::sys::fs::OF_None);
+    if (err) {
+        llvm::WithColor::error() << "cannot write the invariants to " << path
+                                 << ": " << err.message() << "\n";
+        return false;
+    }
+    const auto& states = table.states.strings;
+    write_u32(os, invariant_file::Magic);
+    write_u32(os, invariant_file::Version);
+    write_u32(os, static_cast< uint32_t >(states.size()));
+    write_u32(os, static_cast< uint32_t >(sorted_names.size()));
+    write_u32(os, static_cast< uint32_t >(points.size()));
+    write_u32(os, 0U);
+
+    uint64_t offset = 0U;
+    write_string_offsets(os, states, offset);
+    write_string_offsets(os, sorted_names, offset);
+
+    const auto write_column = [&os, &points](auto get_value) {
+        for (const auto& point : points) {
+            write_u32(os, get_value(point));
+        }
+    };
+    write_column([](const auto& point) { return point.file; });
+    write_column([](const auto& point) { return point.line; });
+    write_column([](const auto& point) { return point.column; });
+    write_column([](const auto& point) { return point.function; });
+    write_column([](const auto& point) {
+        return static_cast< uint32_t >(point.kind);
+    });
+    write_column([](const auto& point) { return point.block; });
+    write_column([](const auto& point) { return point.pre; });
+    write_column([](const auto& point) { return point.post; });
+
+    for (const auto& state : states) {
+        os << state;
+    }
+    for (const auto& name : sorted_names) {
+        os << name;
+    }
+    os.flush();
+    if (os.has_error()) {
+        llvm::WithColor::error() << "cannot write the invariants to " << path
+                                 << ": " << os.error().message() << "\n";
+        os.clear_error();
+        return false;
+    }
+    llvm::outs() << "[*] Exported " << points.size() << " invariants of "
+                 << states.size() << " distinct states to " << path << "\n";
+    return true;
+}
+
+} // namespace knight::dfa
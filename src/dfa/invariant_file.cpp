@@ -0,0 +1,215 @@
+//===- invariant_file.cpp ---------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the reader of the exported invariant files.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/invariant_file.hpp"
+#include "util/binary.hpp"
+
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/WithColor.h>
+
+#include <tuple>
+
+namespace knight::dfa {
+
+namespace {
+
+uint64_t read_offset(const char* offsets, uint32_t idx) {
+    return llvm::support::endian::read64le(offsets + idx * sizeof(uint64_t));
+}
+
+/// \brief Check that the offsets of the strings are increasing and in the
+/// blob.
+bool are_valid_offsets(const char* offsets, uint32_t cnt, uint64_t size) {
+    for (uint32_t idx = 0U; idx < cnt; ++idx) {
+        if (read_offset(offsets, idx) > read_offset(offsets, idx + 1U)) {
+            return false;
+        }
+    }
+    return read_offset(offsets, cnt) <= size;
+}
+
+} // anonymous namespace
+
+std::optional< InvariantFile > InvariantFile::open(llvm::StringRef path) {
+    // Without a null terminator, the file is mapped instead of read.
+    auto buffer = llvm::MemoryBuffer::getFile(path,
+                                              /*IsText=*/false,
+                                              /*RequiresNullTerminator=*/
+                                              false);
+    if (!buffer) {
+        llvm::WithColor::error()
+            << "cannot read the invariants " << path << ": "
+            << buffer.getError().message() << "\n";
+        return std::nullopt;
+    }
+    InvariantFile file(std::move(*buffer));
+    if (!file.validate()) {
+        llvm::WithColor::error() << "invalid invariants " << path << "\n";
+        return std::nullopt;
+    }
+    return file;
+}
+
+bool InvariantFile::validate() {
+    const llvm::StringRef data = m_buffer->getBuffer();
+    BinaryReader reader(data);
+    const auto magic = reader.read_u32();
+    const auto version = reader.read_u32();
+    m_state_cnt = reader.read_u32();
+    m_name_cnt = reader.read_u32();
+    m_point_cnt = reader.read_u32();
+    (void)reader.read_u32();
+    if (reader.failed() || magic != invariant_file::Magic ||
+        version != invariant_file::Version) {
+        return false;
+    }
+
+    const uint64_t state_offsets_bytes =
+        (uint64_t(m_state_cnt) + 1U) * sizeof(uint64_t);
+    const uint64_t name_offsets_bytes =
+        (uint64_t(m_name_cnt) + 1U) * sizeof(uint64_t);
+    const uint64_t columns_bytes =
+        uint64_t(m_point_cnt) * NumInvariantColumns * sizeof(uint32_t);
+    const uint64_t blob_start = invariant_file::HeaderSize +
+                                state_offsets_bytes + name_offsets_bytes +
+                                columns_bytes;
+    if (data.size() < blob_start) {
+        return false;
+    }
+    m_state_offsets = data.data() + invariant_file::HeaderSize;
+    m_name_offsets = m_state_offsets + state_offsets_bytes;
+    m_columns = m_name_offsets + name_offsets_bytes;
+    m_blob = data.drop_front(blob_start);
+    if (!are_valid_offsets(m_state_offsets, m_state_cnt, m_blob.size()) ||
+        !are_valid_offsets(m_name_offsets, m_name_cnt, m_blob.size())) {
+        return false;
+    }
+
+    for (uint32_t idx = 0U; idx < m_point_cnt; ++idx) {
+        if (get_value(InvariantColumn::File, idx) >= m_name_cnt ||
+            get_value(InvariantColumn::Function, idx) >= m_name_cnt ||
+            get_value(InvariantColumn::Kind, idx) >
+                static_cast< uint32_t >(InvariantPointKind::Stmt) ||
+            get_value(InvariantColumn::Pre, idx) >= m_state_cnt ||
+            get_value(InvariantColumn::Post, idx) >= m_state_cnt) {
+            return false;
+        }
+    }
+    return true;
+}
+
+llvm::StringRef InvariantFile::get_state(uint32_t state_id) const {
+    const auto begin = read_offset(m_state_offsets, state_id);
+    const auto end = read_offset(m_state_offsets, state_id + 1U);
+    return m_blob.slice(begin, end);
+}
+
+llvm::StringRef InvariantFile::get_name(uint32_t name_id) const {
+    const auto begin = read_offset(m_name_offsets, name_id);
+    const auto end = read_offset(m_name_offsets, name_id + 1U);
+    return m_blob.slice(begin, end);
+}
+
+uint32_t InvariantFile::get_value(InvariantColumn column,
+                                  uint32_t point_idx) const {
+    const std::size_t idx =
+        (static_cast< std::size_t >(column) * m_point_cnt) + point_idx;
+    return llvm::support::endian::read32le(m_columns +
+                                           (idx * sizeof(uint32_t)));
+}
+
+InvariantPoint InvariantFile::get_point(uint32_t point_idx) const {
+    return InvariantPoint{
+        .file = get_name(get_value(InvariantColumn::File, point_idx)),
+        .line = get_value(InvariantColumn::Line, point_idx),
+        .column = get_value(InvariantColumn::Column, point_idx),
+        .function = get_name(get_value(InvariantColumn::Function, point_idx)),
+        .kind = static_cast< InvariantPointKind >(
+            get_value(InvariantColumn::Kind, point_idx)),
+        .block_id = get_value(InvariantColumn::Block, point_idx),
+        .pre_state = get_value(InvariantColumn::Pre, point_idx),
+        .post_state = get_value(InvariantColumn::Post, point_idx),
+    };
+}
+
+std::optional< uint32_t > InvariantFile::find_name(
+    llvm::StringRef name) const {
+    uint32_t low = 0U;
+    uint32_t high = m_name_cnt;
+    while (low < high) {
+        const uint32_t mid = low + ((high - low) / 2U);
+        if (get_name(mid) < name) {
+            low = mid + 1U;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == m_name_cnt || get_name(low) != name) {
+        return std::nullopt;
+    }
+    return low;
+}
+
+std::optional< uint32_t > InvariantFile::find_point(llvm::StringRef file,
+                                                    unsigned line,
+                                                    unsigned column) const {
+    auto file_id = find_name(file);
+    if (!file_id) {
+        return std::nullopt;
+    }
+    const auto get_location = [this](uint32_t idx) {
+        return std::make_tuple(get_value(InvariantColumn::File, idx),
+                               get_value(InvariantColumn::Line, idx),
+                               get_value(InvariantColumn::Column, idx));
+    };
+    const auto location = std::make_tuple(*file_id, line, column);
+
+    // Find the first point after the location.
+    uint32_t low = 0U;
+    uint32_t high = m_point_cnt;
+    while (low < high) {
+        const uint32_t mid = low + ((high - low) / 2U);
+        if (get_location(mid) <= location) {
+            low = mid + 1U;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == 0U || get_value(InvariantColumn::File, low - 1U) != *file_id) {
+        return std::nullopt;
+    }
+    uint32_t idx = low - 1U;
+    while (idx > 0U && get_location(idx - 1U) == get_location(low - 1U)) {
+        --idx;
+    }
+    return idx;
+}
+
+std::optional< uint32_t > InvariantFile::find_block(llvm::StringRef function,
+                                                    unsigned block_id) const {
+    auto function_id = find_name(function);
+    if (!function_id) {
+        return std::nullopt;
+    }
+    for (uint32_t idx = 0U; idx < m_point_cnt; ++idx) {
+        if (get_value(InvariantColumn::Function, idx) == *function_id &&
+            get_value(InvariantColumn::Block, idx) == block_id &&
+            get_value(InvariantColumn::Kind, idx) ==
+                static_cast< uint32_t >(InvariantPointKind::Block)) {
+            return idx;
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace knight::dfa
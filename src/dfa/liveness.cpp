@@ -0,0 +1,210 @@
+//===- liveness.cpp ---------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the live variable analysis over the ProcCFG.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/liveness.hpp"
+
+#include <clang/AST/Expr.h>
+#include <clang/AST/ExprCXX.h>
+#include <clang/AST/Stmt.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/STLExtras.h>
+
+namespace knight::dfa {
+
+namespace {
+
+/// \brief Whether the variable is a local variable which may be tracked,
+/// the parameters being bound to argument regions.
+bool is_local_var(const clang::VarDecl* var) {
+    return var->hasLocalStorage() && !llvm::isa< clang::ParmVarDecl >(var) &&
+           !var->getType()->isReferenceType();
+}
+
+/// \brief Get the local variable referred by the expression, if any.
+const clang::VarDecl* get_local_var(const clang::Expr* expr) {
+    const auto* ref =
+        llvm::dyn_cast< clang::DeclRefExpr >(expr->IgnoreParens());
+    if (ref == nullptr) {
+        return nullptr;
+    }
+    const auto* var = llvm::dyn_cast< clang::VarDecl >(ref->getDecl());
+    if (var == nullptr || !is_local_var(var)) {
+        return nullptr;
+    }
+    return var;
+}
+
+} // anonymous namespace
+
+VarAccess get_var_access(const clang::Stmt* stmt) {
+    if (const auto* cast = llvm::dyn_cast< clang::ImplicitCastExpr >(stmt)) {
+        if (cast->getCastKind() == clang::CK_LValueToRValue) {
+            return {get_local_var(cast->getSubExpr()), true, false};
+        }
+        return {};
+    }
+    if (const auto* binary = llvm::dyn_cast< clang::BinaryOperator >(stmt)) {
+        if (binary->getOpcode() == clang::BO_Assign) {
+            return {get_local_var(binary->getLHS()), false, true};
+        }
+        if (binary->isCompoundAssignmentOp()) {
+            return {get_local_var(binary->getLHS()), true, true};
+        }
+        return {};
+    }
+    if (const auto* unary = llvm::dyn_cast< clang::UnaryOperator >(stmt)) {
+        if (unary->isIncrementDecrementOp()) {
+            return {get_local_var(unary->getSubExpr()), true, true};
+        }
+    }
+    return {};
+}
+
+bool LiveSet::is_live(ProcCFG::VarDeclRef var) const {
+    auto index = m_live_vars->get_var_index(var);
+    return !index.has_value() || m_live->test(*index);
+}
+
+LiveVariables::LiveVariables(const ProcCFG& cfg) {
+    const auto& clang_cfg = cfg.get_clang_cfg();
+    collect_tracked_vars(clang_cfg);
+
+    const unsigned num_vars = get_num_tracked_vars();
+    m_live_in.assign(clang_cfg.getNumBlockIDs(), llvm::BitVector(num_vars));
+    if (num_vars == 0U) {
+        return;
+    }
+
+    std::vector< NodeRef > worklist(clang_cfg.begin(), clang_cfg.end());
+    llvm::BitVector queued(clang_cfg.getNumBlockIDs(), true);
+    llvm::BitVector live(num_vars);
+    while (!worklist.empty()) {
+        NodeRef node = worklist.back();
+        worklist.pop_back();
+        queued.reset(ProcCFG::index(node));
+
+        live.reset();
+        for (NodeRef succ : node->succs()) {
+            if (succ != nullptr) {
+                live |= m_live_in[ProcCFG::index(succ)];
+            }
+        }
+        transfer(node, live);
+
+        auto& live_in = m_live_in[ProcCFG::index(node)];
+        if (live == live_in) {
+            continue;
+        }
+        live_in = live;
+        for (NodeRef pred : node->preds()) {
+            if (pred != nullptr && !queued.test(ProcCFG::index(pred))) {
+                queued.set(ProcCFG::index(pred));
+                worklist.push_back(pred);
+            }
+        }
+    }
+}
+
+std::optional< unsigned > LiveVariables::get_var_index(VarDeclRef var) const {
+    auto it = m_var_indices.find(var);
+    if (it == m_var_indices.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void LiveVariables::collect_tracked_vars(const clang::CFG& cfg) {
+    // A variable is tracked if all its references are direct accesses.
+    llvm::DenseMap< VarDeclRef, unsigned > num_refs;
+    llvm::DenseMap< VarDeclRef, unsigned > num_accesses;
+    llvm::DenseSet< VarDeclRef > captured;
+    for (NodeRef node : cfg) {
+        for (const auto& elem : node->Elements) {
+            auto cfg_stmt = elem.getAs< clang::CFGStmt >();
+            if (!cfg_stmt) {
+                continue;
+            }
+            const auto* stmt = cfg_stmt->getStmt();
+            if (const auto* decl_stmt = llvm::dyn_cast< clang::DeclStmt >(
+                    stmt)) {
+                for (const auto* decl : decl_stmt->decls()) {
+                    const auto* var = llvm::dyn_cast< clang::VarDecl >(decl);
+                    if (var != nullptr && is_local_var(var)) {
+                        num_refs.try_emplace(var, 0U);
+                    }
+                }
+            } else if (const auto* ref =
+                           llvm::dyn_cast< clang::DeclRefExpr >(stmt)) {
+                if (const auto* var = get_local_var(ref)) {
+                    ++num_refs[var];
+                }
+            } else if (const auto* lambda =
+                           llvm::dyn_cast< clang::LambdaExpr >(stmt)) {
+                for (const auto& capture : lambda->captures()) {
+                    if (capture.capturesVariable()) {
+                        captured.insert(llvm::dyn_cast< clang::VarDecl >(
+                            capture.getCapturedVar()));
+                    }
+                }
+            } else if (const auto* block =
+                           llvm::dyn_cast< clang::BlockExpr >(stmt)) {
+                for (const auto& capture : block->getBlockDecl()->captures()) {
+                    captured.insert(capture.getVariable());
+                }
+            } else if (const auto* var = get_var_access(stmt).var) {
+                ++num_accesses[var];
+            }
+        }
+    }
+
+    for (const auto& [var, refs] : num_refs) {
+        if (!captured.contains(var) && num_accesses.lookup(var) == refs) {
+            m_var_indices.try_emplace(var, m_var_indices.size());
+        }
+    }
+}
+
+void LiveVariables::transfer(NodeRef node, llvm::BitVector& live) const {
+    for (const auto& elem : llvm::reverse(node->Elements)) {
+        auto cfg_stmt = elem.getAs< clang::CFGStmt >();
+        if (!cfg_stmt) {
+            continue;
+        }
+        const auto* stmt = cfg_stmt->getStmt();
+        if (const auto* decl_stmt = llvm::dyn_cast< clang::DeclStmt >(stmt)) {
+            for (const auto* decl : decl_stmt->decls()) {
+                const auto* var = llvm::dyn_cast< clang::VarDecl >(decl);
+                if (var == nullptr) {
+                    continue;
+                }
+                if (auto index = get_var_index(var)) {
+                    live.reset(*index);
+                }
+            }
+            continue;
+        }
+        auto access = get_var_access(stmt);
+        if (access.var == nullptr) {
+            continue;
+        }
+        if (auto index = get_var_index(access.var)) {
+            if (access.is_read) {
+                live.set(*index);
+            } else if (access.is_written) {
+                live.reset(*index);
+            }
+        }
+    }
+}
+
+} // namespace knight::dfa
@@ -13,6 +13,7 @@
 
 #include "dfa/location_manager.hpp"
 #include "dfa/location_context.hpp"
+#include "dfa/profiler.hpp"
 
 namespace knight::dfa {
 
@@ -46,13 +47,10 @@ const StackFrame* LocationManager::create_top_frame(ProcCFG::DeclRef decl) {
     llvm::FoldingSetNodeID id;
     StackFrame::profile(id, decl, nullptr, CallSiteInfo());
 
-    void* insert_pos; // NOLINT
-    auto* res = m_stack_frames.FindNodeOrInsertPos(id, insert_pos);
-    if (res == nullptr) {
-        res = m_allocator.Allocate< StackFrame >();
-        new (res) StackFrame(this, decl, nullptr, CallSiteInfo());
-        m_stack_frames.InsertNode(res, insert_pos);
-    }
+    const auto* res = m_stack_frames.get_or_insert(id, [&](auto& allocator) {
+        return new (allocator.template Allocate< StackFrame >())
+            StackFrame(this, decl, nullptr, CallSiteInfo());
+    });
     ensure_cfg_created(decl);
 
     return res;
@@ -69,13 +67,10 @@ const StackFrame* LocationManager::create_from_node(
     const CallSiteInfo callsite_info(callsite_expr, node, stmt_idx);
     StackFrame::profile(id, *called_decl_opt, parent, callsite_info);
 
-    void* insert_pos; // NOLINT
-    auto* res = m_stack_frames.FindNodeOrInsertPos(id, insert_pos);
-    if (res == nullptr) {
-        res = m_allocator.Allocate< StackFrame >();
-        new (res) StackFrame(this, *called_decl_opt, parent, callsite_info);
-        m_stack_frames.InsertNode(res, insert_pos);
-    }
+    const auto* res = m_stack_frames.get_or_insert(id, [&](auto& allocator) {
+        return new (allocator.template Allocate< StackFrame >())
+            StackFrame(this, *called_decl_opt, parent, callsite_info);
+    });
     ensure_cfg_created(*called_decl_opt);
 
     return res;
@@ -88,22 +83,41 @@ const LocationContext* LocationManager::create_location_context(
     llvm::FoldingSetNodeID id;
     LocationContext::profile(id, stack_frame, element_id, block);
 
-    void* insert_pos; // NOLINT
-    auto* res = m_location_contexts.FindNodeOrInsertPos(id, insert_pos);
-    if (res == nullptr) {
-        res = m_allocator.Allocate< LocationContext >();
-        new (res) LocationContext(this, stack_frame, element_id, block);
-        m_location_contexts.InsertNode(res, insert_pos);
-    }
-
-    return res;
+    return m_location_contexts.get_or_insert(id, [&](auto& allocator) {
+        return new (allocator.template Allocate< LocationContext >())
+            LocationContext(this, stack_frame, element_id, block);
+    });
 }
 
 void LocationManager::ensure_cfg_created(ProcCFG::DeclRef decl) {
+    {
+        const std::shared_lock lock(m_mutex);
+        if (m_decl_to_cfg.contains(decl)) {
+            return;
+        }
+    }
+    const std::unique_lock lock(m_mutex);
     if (m_decl_to_cfg.contains(decl)) {
         return;
     }
-    m_decl_to_cfg[decl] = ProcCFG::build(decl);
+    auto& info = m_decl_to_cfg[decl];
+    const std::string name =
+        Profiler::is_enabled() ? get_decl_profile_name(decl) : "";
+    {
+        const ProfileScope phase_scope(ProfileCategory::Phase, "cfg-build");
+        const ProfileScope scope(ProfileCategory::CfgBuild, name);
+        info.cfg = ProcCFG::build(decl, m_cfg_build_opts);
+    }
+    {
+        const ProfileScope phase_scope(ProfileCategory::Phase, "wto-build");
+        const ProfileScope scope(ProfileCategory::WtoBuild, name);
+        info.wto = std::make_unique< ProcWto >(info.cfg.get());
+    }
+    info.live_vars = std::make_unique< LiveVariables >(*info.cfg);
+    if (m_cfg_build_opts.add_def_use) {
+        info.def_use =
+            std::make_unique< DefUseChains >(*info.cfg, *info.live_vars);
+    }
 }
 
 } // namespace knight::dfa
\ No newline at end of file
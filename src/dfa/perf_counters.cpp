@@ -0,0 +1,182 @@
+//===- perf_counters.cpp ----------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the hardware performance counters of the
+//  profiler, with the Linux perf events.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/perf_counters.hpp"
+#include "util/assert.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace knight::dfa {
+
+namespace {
+
+#ifdef __linux__
+
+perf_event_attr get_counter_attr(PerfCounter counter) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.type = PERF_TYPE_HARDWARE;
+    switch (counter) {
+        case PerfCounter::Cycles:
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PerfCounter::Instructions:
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PerfCounter::L1DMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8U) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16U);
+            break;
+        case PerfCounter::LLCMisses:
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case PerfCounter::BranchMisses:
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+    }
+    return attr;
+}
+
+/// \brief The group of counters of a thread, led by the first opened one.
+class ThreadCounters {
+  private:
+    int m_leader = -1;
+    std::array< int, NumPerfCounters > m_fds{};
+    /// \brief Positions of the opened counters in the reads of the group,
+    /// -1 if not opened.
+    std::array< int, NumPerfCounters > m_positions{};
+    unsigned m_num_opened = 0U;
+
+  public:
+    ThreadCounters() {
+        m_fds.fill(-1);
+        m_positions.fill(-1);
+        for (unsigned i = 0U; i < NumPerfCounters; ++i) {
+            auto attr = get_counter_attr(PerfCounter(i));
+            const auto fd = static_cast< int >(syscall(__NR_perf_event_open,
+                                                       &attr,
+                                                       0,
+                                                       -1,
+                                                       m_leader,
+                                                       PERF_FLAG_FD_CLOEXEC));
+            if (fd < 0) {
+                continue;
+            }
+            if (m_leader < 0) {
+                m_leader = fd;
+            }
+            m_fds[i] = fd;
+            m_positions[i] = static_cast< int >(m_num_opened++);
+        }
+    }
+    ThreadCounters(const ThreadCounters&) = delete;
+    ThreadCounters& operator=(const ThreadCounters&) = delete;
+    ThreadCounters(ThreadCounters&&) = delete;
+    ThreadCounters& operator=(ThreadCounters&&) = delete;
+    ~ThreadCounters() {
+        for (const auto fd : m_fds) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+  public:
+    [[nodiscard]] bool is_opened(PerfCounter counter) const {
+        return m_positions[static_cast< unsigned >(counter)] >= 0;
+    }
+
+    void read(PerfCounterValues& values) const {
+        values.fill(0U);
+        if (m_leader < 0) {
+            return;
+        }
+        // The group reads the number of counters and then their values.
+        std::array< uint64_t, NumPerfCounters + 1U > buffer{};
+        const auto size = ::read(m_leader, buffer.data(), sizeof(buffer));
+        if (size < static_cast< ssize_t >(sizeof(uint64_t))) {
+            return;
+        }
+        for (unsigned i = 0U; i < NumPerfCounters; ++i) {
+            const auto position = m_positions[i];
+            if (position >= 0 && uint64_t(position) < buffer[0]) {
+                values[i] = buffer[1U + unsigned(position)];
+            }
+        }
+    }
+}; // class ThreadCounters
+
+const ThreadCounters& get_thread_counters() {
+    thread_local const ThreadCounters counters;
+    return counters;
+}
+
+#endif
+
+} // anonymous namespace
+
+llvm::StringRef get_perf_counter_name(PerfCounter counter) {
+    switch (counter) {
+        case PerfCounter::Cycles:
+            return "cycles";
+        case PerfCounter::Instructions:
+            return "instructions";
+        case PerfCounter::L1DMisses:
+            return "l1d-misses";
+        case PerfCounter::LLCMisses:
+            return "llc-misses";
+        case PerfCounter::BranchMisses:
+            return "branch-misses";
+    }
+    knight_unreachable("unknown perf counter"); // NOLINT
+}
+
+bool PerfCounters::enable() {
+#ifdef __linux__
+    const auto& counters = get_thread_counters();
+    unsigned available = 0U;
+    for (unsigned i = 0U; i < NumPerfCounters; ++i) {
+        if (counters.is_opened(PerfCounter(i))) {
+            available |= 1U << i;
+        }
+    }
+    if (available == 0U) {
+        return false;
+    }
+    s_available.store(available, std::memory_order_relaxed);
+    s_enabled.store(true, std::memory_order_relaxed);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void PerfCounters::read(PerfCounterValues& values) {
+#ifdef __linux__
+    get_thread_counters().read(values);
+#else
+    values.fill(0U);
+#endif
+}
+
+} // namespace knight::dfa
@@ -12,6 +12,7 @@
 //===------------------------------------------------------------------===//
 
 #include "dfa/proc_cfg.hpp"
+#include "dfa/ast_lock.hpp"
 #include "util/assert.hpp"
 
 #include <llvm/Support/raw_ostream.h>
@@ -24,16 +25,24 @@ namespace {
 
 using namespace clang;
 
-auto get_default_cfg_build_options() {
+auto get_cfg_build_options(ProcCFG::BuildOptions opts) {
     CFG::BuildOptions cfg_opts;
 
     cfg_opts.AddInitializers = true;
-    cfg_opts.AddImplicitDtors = true;
-    cfg_opts.AddTemporaryDtors = true;
     cfg_opts.AddCXXDefaultInitExprInCtors = true;
 
+    // The destructors are not transferred by the block engine, hence
+    // neither the implicit nor the temporary ones are built, which also
+    // saves the blocks of the conditionally destroyed temporaries.
+    cfg_opts.AddImplicitDtors = false;
+    cfg_opts.AddTemporaryDtors = false;
+
+    // The allocator of a new expression precedes its initializer, where
+    // the block engine allocates the object of the allocation site.
+    cfg_opts.AddCXXNewAllocator = true;
+
     cfg_opts.PruneTriviallyFalseEdges = true;
-    cfg_opts.AddLifetime = true;
+    cfg_opts.AddLifetime = opts.add_lifetime;
 
     cfg_opts.setAllAlwaysAdd();
 
@@ -118,25 +127,37 @@ ProcCFG::NodeRef ProcCFG::exit(GraphRef cfg) {
     return &(cfg->m_cfg->getExit());
 }
 
-ProcCFG::GraphUniqueRef ProcCFG::build(const clang::Decl* function) {
+ProcCFG::GraphUniqueRef ProcCFG::build(const clang::Decl* function,
+                                       BuildOptions opts) {
     knight_assert_msg(function != nullptr, "function provided is null");
-    auto* body = function->getBody();
+    clang::Stmt* body = nullptr;
+    {
+        // The body may be deserialized lazily.
+        ASTLock lock(function->getASTContext());
+        body = function->getBody();
+    }
     knight_assert_msg(body != nullptr, "function shall have body");
 
-    return build(function, body, function->getASTContext());
+    return build(function, body, function->getASTContext(), opts);
 }
 
 ProcCFG::GraphUniqueRef ProcCFG::build(FunctionRef function,
                                        clang::Stmt* build_scope,
-                                       clang::ASTContext& ctx) {
+                                       clang::ASTContext& ctx,
+                                       BuildOptions opts) {
     knight_assert_msg(!function->isTemplated(),
                       "templated function not supported");
     knight_assert_msg(!ctx.getLangOpts().ObjC, "objective-c not supported");
 
-    auto cfg = clang::CFG::buildCFG(function,
-                                    build_scope,
-                                    &ctx,
-                                    get_default_cfg_build_options());
+    ClangCFGRef cfg;
+    {
+        // The builder evaluates the constant conditions and the type sizes.
+        ASTLock lock(ctx);
+        cfg = clang::CFG::buildCFG(function,
+                                   build_scope,
+                                   &ctx,
+                                   get_cfg_build_options(opts));
+    }
     knight_assert_msg(cfg != nullptr, "failed to build CFG");
 
     auto stmt_block_mapping = construct_stmt_block_mapping(*cfg);
@@ -0,0 +1,259 @@
+//===- profiler.cpp ---------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the profiler of the DFA engine phases.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/profiler.hpp"
+#include "util/assert.hpp"
+
+#include <clang/AST/Decl.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/JSON.h>
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace knight::dfa {
+
+namespace {
+
+/// \brief Number of the slowest records printed per category.
+constexpr std::size_t MaxReportedRecords = 20U;
+
+constexpr double NanosecondsPerMillisecond = 1e6;
+
+using ProfileTable = llvm::StringMap< ProfileRecord >;
+using ProfileTables = std::array< ProfileTable, NumProfileCategories >;
+
+struct ProfileRegistry {
+    std::mutex mutex;
+    std::vector< std::unique_ptr< ProfileTables > > tables;
+}; // struct ProfileRegistry
+
+ProfileRegistry& get_profile_registry() {
+    static ProfileRegistry registry;
+    return registry;
+}
+
+/// \brief Get the tables of the current thread, owned by the registry so
+/// that they outlive the thread.
+ProfileTables& get_thread_tables() {
+    thread_local ProfileTables* tables = [] {
+        auto& registry = get_profile_registry();
+        const std::lock_guard< std::mutex > lock(registry.mutex);
+        return registry.tables
+            .emplace_back(std::make_unique< ProfileTables >())
+            .get();
+    }();
+    return *tables;
+}
+
+using SortedRecords = std::vector< std::pair< std::string, ProfileRecord > >;
+
+/// \brief Merge the tables of all the threads, slowest first.
+std::array< SortedRecords, NumProfileCategories > merge_tables() {
+    std::array< ProfileTable, NumProfileCategories > merged;
+    {
+        auto& registry = get_profile_registry();
+        const std::lock_guard< std::mutex > lock(registry.mutex);
+        for (const auto& tables : registry.tables) {
+            for (unsigned i = 0U; i < NumProfileCategories; ++i) {
+                for (const auto& entry : (*tables)[i]) {
+                    auto& record = merged[i][entry.getKey()];
+                    record.count += entry.getValue().count;
+                    record.nanoseconds += entry.getValue().nanoseconds;
+                    for (unsigned j = 0U; j < NumPerfCounters; ++j) {
+                        record.counters[j] += entry.getValue().counters[j];
+                    }
+                }
+            }
+        }
+    }
+
+    std::array< SortedRecords, NumProfileCategories > sorted;
+    for (unsigned i = 0U; i < NumProfileCategories; ++i) {
+        for (const auto& entry : merged[i]) {
+            sorted[i].emplace_back(entry.getKey().str(), entry.getValue());
+        }
+        llvm::sort(sorted[i], [](const auto& lhs, const auto& rhs) {
+            if (lhs.second.nanoseconds != rhs.second.nanoseconds) {
+                return lhs.second.nanoseconds > rhs.second.nanoseconds;
+            }
+            if (lhs.second.count != rhs.second.count) {
+                return lhs.second.count > rhs.second.count;
+            }
+            return lhs.first < rhs.first;
+        });
+    }
+    return sorted;
+}
+
+/// \brief Print the available hardware counters of the record, and the
+/// instructions per cycle.
+void print_counters(llvm::raw_ostream& os, const ProfileRecord& record) {
+    os << "                            ";
+    for (unsigned i = 0U; i < NumPerfCounters; ++i) {
+        const auto counter = PerfCounter(i);
+        if (PerfCounters::is_available(counter)) {
+            os << " " << get_perf_counter_name(counter) << " "
+               << record.counters[i];
+        }
+    }
+    const auto cycles =
+        record.counters[static_cast< unsigned >(PerfCounter::Cycles)];
+    const auto instructions =
+        record.counters[static_cast< unsigned >(PerfCounter::Instructions)];
+    if (cycles != 0U && PerfCounters::is_available(PerfCounter::Instructions)) {
+        os << llvm::format(" ipc %.2f", double(instructions) / double(cycles));
+    }
+    os << "\n";
+}
+
+void write_counters(llvm::json::OStream& json, const ProfileRecord& record) {
+    json.attributeObject("counters", [&] {
+        for (unsigned i = 0U; i < NumPerfCounters; ++i) {
+            const auto counter = PerfCounter(i);
+            if (PerfCounters::is_available(counter)) {
+                json.attribute(get_perf_counter_name(counter),
+                               static_cast< int64_t >(record.counters[i]));
+            }
+        }
+    });
+}
+
+} // anonymous namespace
+
+llvm::StringRef get_profile_category_name(ProfileCategory category) {
+    switch (category) {
+        case ProfileCategory::CfgBuild:
+            return "cfg-build";
+        case ProfileCategory::WtoBuild:
+            return "wto-build";
+        case ProfileCategory::Function:
+            return "function";
+        case ProfileCategory::Analysis:
+            return "analysis";
+        case ProfileCategory::Checker:
+            return "checker";
+        case ProfileCategory::StateOp:
+            return "state-op";
+        case ProfileCategory::LoopHead:
+            return "loop-head";
+        case ProfileCategory::Pipeline:
+            return "pipeline";
+        case ProfileCategory::Memory:
+            return "memory";
+        case ProfileCategory::TracePartition:
+            return "trace-partition";
+        case ProfileCategory::Phase:
+            return "phase";
+    }
+    knight_unreachable("unknown profile category"); // NOLINT
+}
+
+void Profiler::record(ProfileCategory category,
+                      llvm::StringRef name,
+                      uint64_t count,
+                      Clock::duration elapsed,
+                      const PerfCounterValues* counters) {
+    auto& record =
+        get_thread_tables()[static_cast< unsigned >(category)][name];
+    record.count += count;
+    record.nanoseconds += static_cast< uint64_t >(
+        std::chrono::duration_cast< std::chrono::nanoseconds >(elapsed)
+            .count());
+    if (counters != nullptr) {
+        for (unsigned i = 0U; i < NumPerfCounters; ++i) {
+            record.counters[i] += (*counters)[i];
+        }
+    }
+}
+
+void Profiler::print_report(llvm::raw_ostream& os) {
+    auto sorted = merge_tables();
+    os << "\n* Profile report:\n";
+    for (unsigned i = 0U; i < NumProfileCategories; ++i) {
+        const auto& records = sorted[i];
+        if (records.empty()) {
+            continue;
+        }
+        uint64_t total = 0U;
+        for (const auto& [name, record] : records) {
+            total += record.nanoseconds;
+        }
+        os << "  " << get_profile_category_name(ProfileCategory(i)) << ": "
+           << llvm::format("%.3f", double(total) / NanosecondsPerMillisecond)
+           << " ms\n";
+        for (const auto& [name, record] :
+             llvm::make_range(records.begin(),
+                              records.begin() +
+                                  std::min(records.size(),
+                                           MaxReportedRecords))) {
+            os << "    "
+               << llvm::format("%10.3f ms %10llu  ",
+                               double(record.nanoseconds) /
+                                   NanosecondsPerMillisecond,
+                               static_cast< unsigned long long >( // NOLINT
+                                   record.count))
+               << name << "\n";
+            if (PerfCounters::is_enabled()) {
+                print_counters(os, record);
+            }
+        }
+        if (records.size() > MaxReportedRecords) {
+            os << "    ... " << records.size() - MaxReportedRecords
+               << " more\n";
+        }
+    }
+}
+
+void Profiler::write_json(llvm::raw_ostream& os) {
+    auto sorted = merge_tables();
+    llvm::json::OStream json(os, 2);
+    json.object([&] {
+        for (unsigned i = 0U; i < NumProfileCategories; ++i) {
+            json.attributeArray(
+                get_profile_category_name(ProfileCategory(i)),
+                [&] {
+                    for (const auto& [name, record] : sorted[i]) {
+                        json.object([&] {
+                            json.attribute("name", name);
+                            json.attribute("count",
+                                           static_cast< int64_t >(
+                                               record.count));
+                            json.attribute("ns",
+                                           static_cast< int64_t >(
+                                               record.nanoseconds));
+                            if (PerfCounters::is_enabled()) {
+                                write_counters(json, record);
+                            }
+                        });
+                    }
+                });
+        }
+    });
+    os << "\n";
+}
+
+std::string get_decl_profile_name(const clang::Decl* decl) {
+    if (const auto* named = llvm::dyn_cast_or_null< clang::NamedDecl >(decl);
+        named != nullptr) {
+        return named->getQualifiedNameAsString();
+    }
+    return "<unnamed>";
+}
+
+} // namespace knight::dfa
@@ -16,17 +16,71 @@
 #include "dfa/checker/checker_base.hpp"
 #include "dfa/domain/dom_base.hpp"
 #include "dfa/domain/domains.hpp"
+#include "dfa/profiler.hpp"
 #include "dfa/region/region.hpp"
 #include "util/assert.hpp"
 
-#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseSet.h>
 #include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/Statistic.h>
 
+#include <array>
 #include <memory>
 #include <optional>
+#include <vector>
+
+#define DEBUG_TYPE "program-state" // NOLINT
+
+ALWAYS_ENABLED_STATISTIC(NumStateOps,
+                         "The # of binary operations on program states");
+ALWAYS_ENABLED_STATISTIC(NumSameStateHits,
+                         "The # of binary operations on the same state");
+ALWAYS_ENABLED_STATISTIC(NumJoinAllOps,
+                         "The # of n-ary joins of program states");
+ALWAYS_ENABLED_STATISTIC(NumDomValOps,
+                         "The # of binary operations on domain values");
+ALWAYS_ENABLED_STATISTIC(NumSharedDomValHits,
+                         "The # of binary operations on shared domain values");
+ALWAYS_ENABLED_STATISTIC(NumInternedDomValHits,
+                         "The # of domain values reused by hash-consing");
+ALWAYS_ENABLED_STATISTIC(NumDeadRegions,
+                         "The # of region bindings removed as dead");
+ALWAYS_ENABLED_STATISTIC(NumDeadVars,
+                         "The # of numerical variables forgotten as dead");
+ALWAYS_ENABLED_STATISTIC(NumWeakUpdates,
+                         "The # of bindings of heap summaries weakly updated");
 
 namespace knight::dfa {
 
+namespace {
+
+/// \brief Get the region without parent which holds the region.
+MemRegionRef get_root_region(MemRegionRef region) {
+    while (region->get_parent() != nullptr) {
+        region = region->get_parent();
+    }
+    return region;
+}
+
+/// \brief Get the local variable of the frame holding the region, if any.
+const clang::VarDecl* get_local_var_of(MemRegionRef region,
+                                       const StackFrame* frame) {
+    const auto* var_region =
+        llvm::dyn_cast< VarRegion >(get_root_region(region));
+    if (var_region == nullptr) {
+        return nullptr;
+    }
+    const auto* space = llvm::dyn_cast< StackLocalSpaceRegion >(
+        var_region->get_memory_space());
+    if (space == nullptr || space->get_frame() != frame) {
+        return nullptr;
+    }
+    return var_region->get_var_decl();
+}
+
+} // anonymous namespace
+
 void retain_state(const ProgramState* state) {
     ++const_cast< ProgramState* >(state)->m_ref_cnt;
 }
@@ -77,60 +131,223 @@ std::optional< MemRegionRef > ProgramState::get_region(
     return std::nullopt;
 }
 
+ProgramStateRef ProgramState::set_dom_val(DomID id, SharedVal val) const {
+    auto& mgr = get_state_manager();
+    return mgr.get_persistent_state_with_copy_and_dom_val_map(
+        *this,
+        mgr.get_dom_val_factory().add(m_dom_val,
+                                      id,
+                                      mgr.adopt_dom_val(std::move(val))));
+}
+
+ProgramStateRef ProgramState::remove_dom_val(DomID id) const {
+    auto& mgr = get_state_manager();
+    return mgr.get_persistent_state_with_copy_and_dom_val_map(
+        *this, mgr.get_dom_val_factory().remove(m_dom_val, id));
+}
+
 ProgramStateRef ProgramState::set_region_sexpr(MemRegionRef region,
                                                SExprRef sexpr) const {
-    auto region_sexpr = m_region_sexpr;
-    region_sexpr[region] = sexpr;
-    return get_state_manager()
-        .get_persistent_state_with_copy_and_region_sexpr_map(*this,
-                                                             region_sexpr);
+    auto& mgr = get_state_manager();
+    if (RegionManager::is_summarized(region)) {
+        // A summary stands for several objects and only one of them is
+        // updated, so that the binding is kept only if it is unchanged.
+        const auto* old_sexpr = m_region_sexpr.lookup(region);
+        if (old_sexpr == nullptr || *old_sexpr == sexpr) {
+            return this;
+        }
+        ++NumWeakUpdates;
+        return mgr.get_persistent_state_with_copy_and_region_sexpr_map(
+            *this,
+            mgr.get_region_sexpr_factory().remove(m_region_sexpr, region));
+    }
+    return mgr.get_persistent_state_with_copy_and_region_sexpr_map(
+        *this,
+        mgr.get_region_sexpr_factory().add(m_region_sexpr, region, sexpr));
 }
 
 ProgramStateRef ProgramState::set_stmt_sexpr(ProcCFG::StmtRef stmt,
                                              SExprRef sexpr) const {
-    auto stmt_sexpr = m_stmt_sexpr;
-    stmt_sexpr[stmt] = sexpr;
-    return get_state_manager()
-        .get_persistent_state_with_copy_and_stmt_sexpr_map(*this, stmt_sexpr);
+    auto& mgr = get_state_manager();
+    return mgr.get_persistent_state_with_copy_and_stmt_sexpr_map(
+        *this, mgr.get_stmt_sexpr_factory().add(m_stmt_sexpr, stmt, sexpr));
 }
 
 std::optional< SExprRef > ProgramState::get_region_sexpr(
     MemRegionRef region) const {
-    auto it = m_region_sexpr.find(region);
-    if (it != m_region_sexpr.end()) {
-        return it->second;
+    if (const auto* sexpr = m_region_sexpr.lookup(region)) {
+        return *sexpr;
     }
     return std::nullopt;
 }
 
 std::optional< SExprRef > ProgramState::get_stmt_sexpr(
     ProcCFG::StmtRef stmt) const {
-    auto it = m_stmt_sexpr.find(stmt);
-    if (it != m_stmt_sexpr.end()) {
-        return it->second;
+    if (const auto* sexpr = m_stmt_sexpr.lookup(stmt)) {
+        return *sexpr;
     }
     return std::nullopt;
 }
 
-ProgramStateRef ProgramState::normalize() const {
-    DomValMap dom_val = m_dom_val;
-    for (auto& [id, val] : dom_val) {
-        const_cast< AbsDomBase* >(val.get())->normalize();
+ProgramStateRef ProgramState::remove_dead(const LiveSet& live,
+                                          const StackFrame* frame) const {
+    return remove_dead_if(frame, [&live](ProcCFG::VarDeclRef var) {
+        return !live.is_live(var);
+    });
+}
+
+ProgramStateRef ProgramState::remove_dead_var(ProcCFG::VarDeclRef var,
+                                              const StackFrame* frame) const {
+    return remove_dead_if(frame, [var](ProcCFG::VarDeclRef other) {
+        return other == var;
+    });
+}
+
+ProgramStateRef ProgramState::remove_frame(const StackFrame* frame) const {
+    return remove_dead_if(frame, [](ProcCFG::VarDeclRef) { return true; });
+}
+
+ProgramStateRef ProgramState::fold_heap_alloc(
+    const HeapAllocRegion* recent) const {
+    const auto* summary = get_region_manager().get_summary_region(recent);
+    const auto* recent_sexpr = m_region_sexpr.lookup(recent);
+    const auto* summary_sexpr = m_region_sexpr.lookup(summary);
+    const bool keeps_summary = recent_sexpr != nullptr &&
+                               summary_sexpr != nullptr &&
+                               *recent_sexpr == *summary_sexpr;
+    return remove_regions_if([&](MemRegionRef region) {
+        MemRegionRef root = get_root_region(region);
+        if (root == recent) {
+            return true;
+        }
+        return root == summary && !(region == summary && keeps_summary);
+    });
+}
+
+ProgramStateRef ProgramState::remove_stmt_sexprs() const {
+    if (m_stmt_sexpr.isEmpty()) {
+        return this;
+    }
+    auto& mgr = get_state_manager();
+    return mgr.get_persistent_state_with_copy_and_stmt_sexpr_map(
+        *this, mgr.get_stmt_sexpr_factory().getEmptyMap());
+}
+
+ProgramStateRef ProgramState::copy_stmt_sexprs(
+    const ProgramState& other) const {
+    if (m_stmt_sexpr == other.m_stmt_sexpr) {
+        return this;
     }
     return get_state_manager()
-        .get_persistent_state_with_copy_and_dom_val_map(*this,
-                                                        std::move(dom_val));
+        .get_persistent_state_with_copy_and_stmt_sexpr_map(*this,
+                                                           other.m_stmt_sexpr);
 }
 
-bool ProgramState::is_bottom() const {
-    return llvm::any_of(m_dom_val, [](const auto& pair) {
-        return pair.second->is_bottom();
+ProgramStateRef ProgramState::remove_dead_if(
+    const StackFrame* frame,
+    llvm::function_ref< bool(ProcCFG::VarDeclRef) > is_dead) const {
+    return remove_regions_if([&](MemRegionRef region) {
+        const auto* var = get_local_var_of(region, frame);
+        return var != nullptr && is_dead(var);
     });
 }
 
-bool ProgramState::is_top() const {
-    return llvm::all_of(m_dom_val,
-                        [](const auto& pair) { return pair.second->is_top(); });
+ProgramStateRef ProgramState::remove_regions_if(
+    llvm::function_ref< bool(MemRegionRef) > is_removed) const {
+    auto& mgr = get_state_manager();
+    auto& region_factory = mgr.get_region_sexpr_factory();
+    RegionSExprMap region_sexpr = m_region_sexpr;
+    for (const auto& [region, sexpr] : m_region_sexpr) {
+        if (is_removed(region)) {
+            region_sexpr = region_factory.remove(region_sexpr, region);
+            ++NumDeadRegions;
+        }
+    }
+
+    // The symbols are dead once they are unreachable from the bindings.
+    llvm::DenseSet< const Sym* > reachable_syms;
+    auto collect_syms = [&reachable_syms](SExprRef sexpr) {
+        for (SExprRef sub : sexpr->get_symbols(/*visit_once=*/true)) {
+            if (const auto* sym = llvm::dyn_cast< Sym >(sub)) {
+                reachable_syms.insert(sym);
+            }
+        }
+    };
+    for (const auto& [region, sexpr] : region_sexpr) {
+        collect_syms(sexpr);
+    }
+    for (const auto& [stmt, sexpr] : m_stmt_sexpr) {
+        collect_syms(sexpr);
+    }
+
+    const auto& var_index = mgr.get_var_index();
+    llvm::SmallVector< DenseVarID, 8 > dead_vars;
+    for (DenseVarID id = 0U; id < var_index.size(); ++id) {
+        NumVarRef var = var_index.get_var(id);
+        if (const auto* region = var.dyn_cast< MemRegionRef >()) {
+            if (is_removed(region)) {
+                dead_vars.push_back(id);
+            }
+        } else if (!reachable_syms.contains(var.get< const Sym* >())) {
+            dead_vars.push_back(id);
+        }
+    }
+
+    DomValMap dom_val = m_dom_val;
+    if (!dead_vars.empty()) {
+        auto& dom_factory = mgr.get_dom_val_factory();
+        for (const auto& [id, val] : m_dom_val) {
+            SharedVal new_val(val->clone());
+            new_val->forget_vars(dead_vars);
+            if (*new_val != *val) {
+                dom_val = dom_factory.add(dom_val,
+                                          id,
+                                          mgr.adopt_dom_val(
+                                              std::move(new_val)));
+            }
+        }
+        NumDeadVars += dead_vars.size();
+    }
+
+    if (region_sexpr == m_region_sexpr && dom_val == m_dom_val) {
+        return this;
+    }
+    ProgramState new_state(m_state_mgr,
+                           m_region_mgr,
+                           std::move(dom_val),
+                           std::move(region_sexpr),
+                           m_stmt_sexpr);
+    return mgr.get_persistent_state(new_state);
+}
+
+ProgramStateRef ProgramState::normalize() const {
+    auto& mgr = get_state_manager();
+    std::optional< DomValMap > dom_val;
+    for (const auto& [id, val] : m_dom_val) {
+        if (val->is_normalized()) {
+            continue;
+        }
+        SharedVal normalized = val->clone_shared();
+        normalized->normalize();
+        dom_val = mgr.get_dom_val_factory().add(dom_val.value_or(m_dom_val),
+                                                id,
+                                                mgr.adopt_dom_val(
+                                                    std::move(normalized)));
+    }
+    if (!dom_val) {
+        return this;
+    }
+    return mgr.get_persistent_state_with_copy_and_dom_val_map(*this,
+                                                              *dom_val);
+}
+
+void ProgramState::compute_flags() {
+    m_is_bottom = llvm::any_of(m_dom_val, [](const auto& pair) {
+        return pair.second->is_bottom();
+    });
+    m_is_top = llvm::all_of(m_dom_val, [](const auto& pair) {
+        return pair.second->is_top();
+    });
 }
 
 ProgramStateRef ProgramState::set_to_bottom() const {
@@ -141,105 +358,190 @@ ProgramStateRef ProgramState::set_to_top() const {
     return get_state_manager().get_default_state();
 }
 
+// All the binary operators are idempotent, so operating a state or a
+// domain value with itself yields the operand unchanged.
+
+// NOLINTNEXTLINE
+#define SKIP_SAME_STATE(OTHER) \
+    ++NumStateOps;             \
+    if (this == (OTHER)) {     \
+        ++NumSameStateHits;    \
+        return this;           \
+    }
 // NOLINTNEXTLINE
-#define UNION_MAP(OP)                                            \
-    DomValMap new_map;                                           \
-    for (const auto& [other_id, other_val] : other->m_dom_val) { \
-        auto it = m_dom_val.find(other_id);                      \
-        if (it == m_dom_val.end()) {                             \
-            new_map[other_id] = other_val->clone_shared();       \
-        } else {                                                 \
-            auto new_val = it->second->clone();                  \
-            new_val->OP(*other_val);                             \
-            new_map[other_id] = SharedVal(new_val);              \
-        }                                                        \
-    }                                                            \
-    return get_state_manager()                                   \
-        .get_persistent_state_with_copy_and_dom_val_map(*this,   \
-                                                        std ::move(new_map));
+#define UNION_MAP(OP, ...)                                                \
+    SKIP_SAME_STATE(other.get());                                         \
+    auto& mgr = get_state_manager();                                      \
+    auto& factory = mgr.get_dom_val_factory();                            \
+    DomValMap new_map = factory.getEmptyMap();                            \
+    for (const auto& [other_id, other_val] : other->m_dom_val) {          \
+        ++NumDomValOps;                                                   \
+        const auto* this_val = m_dom_val.lookup(other_id);                \
+        if (this_val == nullptr) {                                        \
+            new_map = factory.add(new_map, other_id, other_val);          \
+        } else if (*this_val == other_val) {                              \
+            ++NumSharedDomValHits;                                        \
+            new_map = factory.add(new_map, other_id, other_val);          \
+        } else {                                                          \
+            SharedVal new_val((*this_val)->clone());                      \
+            new_val->OP(*other_val __VA_OPT__(, ) __VA_ARGS__);           \
+            new_map = factory.add(new_map,                                \
+                                  other_id,                               \
+                                  mgr.adopt_dom_val(std::move(new_val))); \
+        }                                                                 \
+    }                                                                     \
+    return mgr.get_persistent_state_with_copy_and_dom_val_map(            \
+        *this, std::move(new_map));
 // NOLINTNEXTLINE
-#define INTERSECT_MAP(OP)                                      \
-    DomValMap map;                                             \
-    for (auto& [other_id, other_val] : other->m_dom_val) {     \
-        auto it = m_dom_val.find(other_id);                    \
-        if (it != m_dom_val.end()) {                           \
-            auto new_val = it->second->clone();                \
-            new_val->OP(*other_val);                           \
-            map[other_id] = SharedVal(new_val);                \
-        }                                                      \
-    }                                                          \
-    return get_state_manager()                                 \
-        .get_persistent_state_with_copy_and_dom_val_map(*this, \
-                                                        std ::move(map));
+#define INTERSECT_MAP(OP)                                         \
+    SKIP_SAME_STATE(other.get());                                 \
+    auto& mgr = get_state_manager();                              \
+    auto& factory = mgr.get_dom_val_factory();                    \
+    DomValMap map = factory.getEmptyMap();                        \
+    for (const auto& [other_id, other_val] : other->m_dom_val) {  \
+        ++NumDomValOps;                                           \
+        const auto* this_val = m_dom_val.lookup(other_id);        \
+        if (this_val == nullptr) {                                \
+            continue;                                             \
+        }                                                         \
+        if (*this_val == other_val) {                             \
+            ++NumSharedDomValHits;                                \
+            map = factory.add(map, other_id, other_val);          \
+            continue;                                             \
+        }                                                         \
+        SharedVal new_val((*this_val)->clone());                  \
+        new_val->OP(*other_val);                                  \
+        map = factory.add(map,                                    \
+                          other_id,                               \
+                          mgr.adopt_dom_val(std::move(new_val))); \
+    }                                                             \
+    return mgr.get_persistent_state_with_copy_and_dom_val_map(    \
+        *this, std::move(map));
 
 ProgramStateRef ProgramState::join(const ProgramStateRef& other) const {
+    const ProfileScope scope(ProfileCategory::StateOp, "join");
     UNION_MAP(join_with);
 }
 
 ProgramStateRef ProgramState::join_at_loop_head(
     const ProgramStateRef& other) const {
+    const ProfileScope scope(ProfileCategory::StateOp, "join_at_loop_head");
     UNION_MAP(join_with_at_loop_head);
 }
 
 ProgramStateRef ProgramState::join_consecutive_iter(
     const ProgramStateRef& other) const {
+    const ProfileScope scope(ProfileCategory::StateOp, "join_consecutive_iter");
     UNION_MAP(join_consecutive_iter_with);
 }
 
 ProgramStateRef ProgramState::widen(const ProgramStateRef& other) const {
+    const ProfileScope scope(ProfileCategory::StateOp, "widen");
     UNION_MAP(widen_with);
 }
 
+ProgramStateRef ProgramState::widen_with_thresholds(
+    const ProgramStateRef& other, const Thresholds& thresholds) const {
+    const ProfileScope scope(ProfileCategory::StateOp, "widen_with_thresholds");
+    UNION_MAP(widen_with_thresholds, thresholds);
+}
+
 ProgramStateRef ProgramState::meet(const ProgramStateRef& other) const {
+    const ProfileScope scope(ProfileCategory::StateOp, "meet");
     INTERSECT_MAP(meet_with);
 }
 
 ProgramStateRef ProgramState::narrow(const ProgramStateRef& other) const {
+    const ProfileScope scope(ProfileCategory::StateOp, "narrow");
     INTERSECT_MAP(narrow_with);
 }
 
 bool ProgramState::leq(const ProgramState& other) const {
-    llvm::BitVector this_key_set;
-    bool need_to_check_other = other.m_dom_val.size() != this->m_dom_val.size();
-    for (const auto& [id, val] : this->m_dom_val) {
-        this_key_set.set(id);
-        auto dom_val = m_dom_val;
-        auto it = other.m_dom_val.find(id);
-        if (it == other.m_dom_val.end()) {
-            if (!val->is_bottom()) {
-                return false;
-            }
-            need_to_check_other = true;
-            continue;
-        }
-        if (!val->leq(*(it->second))) {
-            return false;
-        }
-    }
-
-    if (!need_to_check_other) {
+    const ProfileScope scope(ProfileCategory::StateOp, "leq");
+    ++NumStateOps;
+    // Canonical maps with the same root hold the same domain values.
+    if (this == &other || this->m_dom_val.getRootWithoutRetain() ==
+                              other.m_dom_val.getRootWithoutRetain()) {
+        ++NumSameStateHits;
         return true;
     }
-
-    for (const auto& [id, val] : other.m_dom_val) {
-        if (!this_key_set[id]) {
-            if (!val->is_top()) {
-                return false;
-            }
-        }
+    if (this->m_is_bottom) {
+        return true;
     }
 
-    return true;
+    // Only the changed values are compared, the shared ones being equal.
+    bool is_leq = true;
+    diff_dom_vals(other,
+                  [&is_leq]([[maybe_unused]] DomID id,
+                            const AbsValConstRef* val,
+                            const AbsValConstRef* other_val) {
+                      if (!is_leq) {
+                          return;
+                      }
+                      ++NumDomValOps;
+                      if (other_val == nullptr) {
+                          is_leq = (*val)->is_bottom();
+                      } else if (val == nullptr) {
+                          is_leq = (*other_val)->is_top();
+                      } else {
+                          is_leq = (*val)->leq(**other_val);
+                      }
+                  });
+    return is_leq;
 }
 
 bool ProgramState::equals(const ProgramState& other) const {
+    ++NumStateOps;
+    // Canonical maps with the same root hold the same domain values.
+    if (this == &other || this->m_dom_val.getRootWithoutRetain() ==
+                              other.m_dom_val.getRootWithoutRetain()) {
+        ++NumSameStateHits;
+        return true;
+    }
     return llvm::all_of(this->m_dom_val, [&other](const auto& this_pair) {
-        auto it = other.m_dom_val.find(this_pair.first);
-        return it != other.m_dom_val.end() &&
-               this_pair.second->equals(*(it->second));
+        ++NumDomValOps;
+        const auto* other_val = other.m_dom_val.lookup(this_pair.first);
+        if (other_val == nullptr) {
+            return false;
+        }
+        if (*other_val == this_pair.second) {
+            ++NumSharedDomValHits;
+            return true;
+        }
+        return this_pair.second->equals(**other_val);
     });
 }
 
+ProgramStateDiff ProgramState::diff(const ProgramState& other) const {
+    ProgramStateDiff diff;
+    if (this == &other) {
+        return diff;
+    }
+    diff_dom_vals(other,
+                  [&diff](DomID id,
+                          [[maybe_unused]] const AbsValConstRef* val,
+                          [[maybe_unused]] const AbsValConstRef* other_val) {
+                      diff.dom_ids.push_back(id);
+                  });
+    internal::diff_immutable_maps(
+        m_region_sexpr,
+        other.m_region_sexpr,
+        [&diff](MemRegionRef region,
+                [[maybe_unused]] const SExprRef* sexpr,
+                [[maybe_unused]] const SExprRef* other_sexpr) {
+            diff.regions.push_back(region);
+        });
+    internal::diff_immutable_maps(
+        m_stmt_sexpr,
+        other.m_stmt_sexpr,
+        [&diff](ProcCFG::StmtRef stmt,
+                [[maybe_unused]] const SExprRef* sexpr,
+                [[maybe_unused]] const SExprRef* other_sexpr) {
+            diff.stmts.push_back(stmt);
+        });
+    return diff;
+}
+
 void ProgramState::dump(llvm::raw_ostream& os) const {
     os << "ProgramState:{\n";
     for (const auto& [id, aval] : m_dom_val) {
@@ -251,45 +553,138 @@ void ProgramState::dump(llvm::raw_ostream& os) const {
 }
 
 ProgramStateRef ProgramStateManager::get_default_state() {
-    DomValMap dom_val;
+    DomValMap dom_val = m_dom_val_factory.getEmptyMap();
     for (auto analysis_id : m_analysis_mgr.get_required_analyses()) {
         for (auto dom_id :
              m_analysis_mgr.get_registered_domains_in(analysis_id)) {
-            if (auto default_fn =
-                    m_analysis_mgr.get_domain_default_val_fn(dom_id)) {
-                dom_val[dom_id] = std::move((*default_fn)());
+            auto& default_val = m_default_vals[dom_id];
+            if (default_val == nullptr) {
+                auto default_fn =
+                    m_analysis_mgr.get_domain_default_val_fn(dom_id);
+                if (!default_fn) {
+                    continue;
+                }
+                default_val = adopt_dom_val((*default_fn)());
             }
+            dom_val = m_dom_val_factory.add(dom_val, dom_id, default_val);
         }
     }
     ProgramState state(this,
                        &m_region_mgr,
                        std::move(dom_val),
-                       RegionSExprMap{},
-                       StmtSExprMap{});
+                       m_region_sexpr_factory.getEmptyMap(),
+                       m_stmt_sexpr_factory.getEmptyMap());
 
     return get_persistent_state(state);
 }
 
 ProgramStateRef ProgramStateManager::get_bottom_state() {
-    DomValMap dom_val;
+    DomValMap dom_val = m_dom_val_factory.getEmptyMap();
     for (auto analysis_id : m_analysis_mgr.get_required_analyses()) {
         for (auto dom_id :
              m_analysis_mgr.get_registered_domains_in(analysis_id)) {
-            if (auto bottom_fn =
-                    m_analysis_mgr.get_domain_bottom_val_fn(dom_id)) {
-                dom_val[dom_id] = std::move((*bottom_fn)());
+            auto& bottom_val = m_bottom_vals[dom_id];
+            if (bottom_val == nullptr) {
+                auto bottom_fn =
+                    m_analysis_mgr.get_domain_bottom_val_fn(dom_id);
+                if (!bottom_fn) {
+                    continue;
+                }
+                bottom_val = adopt_dom_val((*bottom_fn)());
             }
+            dom_val = m_dom_val_factory.add(dom_val, dom_id, bottom_val);
         }
     }
     ProgramState state(this,
                        &m_region_mgr,
                        std::move(dom_val),
-                       RegionSExprMap{},
-                       StmtSExprMap{});
+                       m_region_sexpr_factory.getEmptyMap(),
+                       m_stmt_sexpr_factory.getEmptyMap());
 
     return get_persistent_state(state);
 }
 
+ProgramStateRef ProgramStateManager::join_all(
+    llvm::ArrayRef< ProgramStateRef > states) {
+    knight_assert_msg(!states.empty(), "no state to join");
+    const ProfileScope scope(ProfileCategory::StateOp, "join_all");
+    ++NumJoinAllOps;
+
+    // The bottom states are the identity of the join, and the join is
+    // idempotent, so that each other state is joined once.
+    llvm::SmallVector< const ProgramState*, 8 > joined;
+    for (const auto& state : states) {
+        if (!state->is_bottom() && !llvm::is_contained(joined, state.get())) {
+            joined.push_back(state.get());
+        }
+    }
+    const ProgramStateRef& first = states.front();
+    if (joined.empty() || (joined.size() == 1U && joined[0] == first.get())) {
+        return first;
+    }
+
+    std::array< llvm::SmallVector< AbsValConstRef, 8 >, NumDomIDs > vals;
+    for (const auto* state : joined) {
+        for (const auto& [id, val] : state->m_dom_val) {
+            auto& id_vals = vals[id];
+            if (!llvm::is_contained(id_vals, val)) {
+                id_vals.push_back(val);
+            }
+        }
+    }
+
+    DomValMap dom_val = m_dom_val_factory.getEmptyMap();
+    llvm::SmallVector< const AbsDomBase*, 8 > others;
+    for (unsigned id = 0U; id < NumDomIDs; ++id) {
+        const auto& id_vals = vals[id];
+        if (id_vals.empty()) {
+            continue;
+        }
+        ++NumDomValOps;
+        if (id_vals.size() == 1U) {
+            ++NumSharedDomValHits;
+            dom_val = m_dom_val_factory.add(dom_val, id, id_vals.front());
+            continue;
+        }
+        SharedVal new_val = id_vals.front()->clone_shared();
+        others.clear();
+        for (auto val : llvm::drop_begin(id_vals)) {
+            others.push_back(val);
+        }
+        new_val->join_all(others);
+        dom_val = m_dom_val_factory.add(dom_val,
+                                        id,
+                                        adopt_dom_val(std::move(new_val)));
+    }
+    return get_persistent_state_with_copy_and_dom_val_map(*first,
+                                                          std::move(dom_val));
+}
+
+AbsValConstRef ProgramStateManager::adopt_dom_val(SharedVal val) {
+    // Intern the value, so that states with structurally equal values
+    // share the same pointers and hence the same profile. A value equal
+    // to an interned one is freed once the caller drops it.
+    llvm::FoldingSetNodeID id;
+    void* insert_pos = nullptr; // NOLINT
+    const bool is_profiled = val->profile(id);
+    if (is_profiled) {
+        if (InternedDomVal* existed =
+                m_interned_vals.FindNodeOrInsertPos(id, insert_pos)) {
+            ++NumInternedDomValHits;
+            return existed->m_val;
+        }
+    }
+
+    AbsValConstRef adopted = val.get();
+    m_owned_vals.push_back(std::move(val));
+    if (is_profiled) {
+        auto* interned = new (m_alloc.Allocate< InternedDomVal >())
+            InternedDomVal(adopted);
+        m_interned_vals.InsertNode(interned, insert_pos);
+    }
+    return adopted;
+}
+
 ProgramStateRef ProgramStateManager::get_persistent_state(ProgramState& state) {
     llvm::FoldingSetNodeID id;
     state.Profile(id);
@@ -308,6 +703,7 @@ ProgramStateRef ProgramStateManager::get_persistent_state(ProgramState& state) {
         new_state = m_alloc.Allocate< ProgramState >();
     }
     new (new_state) ProgramState(std::move(state));
+    new_state->compute_flags();
     m_state_set.InsertNode(new_state, insert_pos);
     return new_state;
 }
@@ -353,13 +749,4 @@ ProgramStateRef ProgramStateManager::
     return get_persistent_state(new_state);
 }
 
-ProgramStateRef internal::get_persistent_state_with_copy_and_dom_val_map(
-    ProgramStateManager& manager,
-    const ProgramState& state,
-    DomValMap dom_val) {
-    return manager.get_persistent_state_with_copy_and_dom_val_map(state,
-                                                                  std::move(
-                                                                      dom_val));
-}
-
-} // namespace knight::dfa
\ No newline at end of file
+} // namespace knight::dfa
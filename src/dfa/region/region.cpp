@@ -12,8 +12,11 @@
 //===------------------------------------------------------------------===//
 
 #include "dfa/region/region.hpp"
+#include "dfa/ast_lock.hpp"
+#include "dfa/shared_interner.hpp"
 
 #include <clang/AST/DeclCXX.h>
+#include <clang/AST/RecordLayout.h>
 #include <clang/AST/Type.h>
 #include <llvm/Support/Casting.h>
 #include "clang/AST/Decl.h"
@@ -61,39 +64,59 @@ bool MemRegion::has_stack_storage() const {
 }
 
 clang::QualType TypedRegion::get_location_type() const {
+    // The pointer types are uniqued in the context.
+    const ASTLock lock(get_ast_ctx());
     return get_ast_ctx().getPointerType(get_value_type());
 }
 
 const StackLocalSpaceRegion* RegionManager::get_stack_local_space_region(
     const StackFrame* frame) {
-    const StackLocalSpaceRegion*& region = m_stack_local_space_regions[frame];
-    return region = get_persistent_space(region, frame);
+    return get_persistent_space(m_stack_local_space_regions[frame],
+                                &RegionManager::get_stack_local_space_region,
+                                frame);
 }
 
 const StackArgSpaceRegion* RegionManager::get_stack_arg_space_region(
     const StackFrame* frame) {
-    const StackArgSpaceRegion*& region = m_stack_arg_space_regions[frame];
-    return region = get_persistent_space(region, frame);
+    return get_persistent_space(m_stack_arg_space_regions[frame],
+                                &RegionManager::get_stack_arg_space_region,
+                                frame);
 }
 
 const CodeSpaceRegion* RegionManager::get_code_space() {
-    return get_persistent_space(m_code_space_region);
+    return get_persistent_space(m_code_space_region,
+                                &RegionManager::get_code_space);
 }
 
 const GlobalInternalSpaceRegion* RegionManager::get_global_internal_space() {
-    return get_persistent_space(m_global_internal_space_region);
+    return get_persistent_space(m_global_internal_space_region,
+                                &RegionManager::get_global_internal_space);
 }
 
 const GlobalExternalSpaceRegion* RegionManager::get_global_external_space() {
-    return get_persistent_space(m_global_external_space_region);
+    return get_persistent_space(m_global_external_space_region,
+                                &RegionManager::get_global_external_space);
 }
 
 const HeapSpaceRegion* RegionManager::get_heap_space() {
-    return get_persistent_space(m_heap_space_region);
+    return get_persistent_space(m_heap_space_region,
+                                &RegionManager::get_heap_space);
 }
 
 const UnknownSpaceRegion* RegionManager::get_unknown_space() {
-    return get_persistent_space(m_unknown_space_region);
+    return get_persistent_space(m_unknown_space_region,
+                                &RegionManager::get_unknown_space);
+}
+
+MemSpaceRegionRef RegionManager::get_shared_space(
+    llvm::function_ref< MemSpaceRegionRef(RegionManager&) > get) {
+    return m_interner->get_space(get);
+}
+
+MemRegion* RegionManager::get_shared_region(
+    const llvm::FoldingSetNodeID& id,
+    llvm::function_ref< MemRegion*(llvm::BumpPtrAllocator&) > create) {
+    return m_interner->get_region_set().get_or_insert(id, create);
 }
 
 const SymbolicRegion* RegionManager::get_symbolic_region(
@@ -135,9 +158,28 @@ const CXXTempObjRegion* RegionManager::get_cxx_temp_object_region(
 }
 
 const ElementRegion* RegionManager::get_element_region(
-    clang::QualType element_type, MemRegionRef base_region) {
+    clang::QualType element_type,
+    MemRegionRef base_region,
+    std::optional< uint64_t > index) {
     element_type = element_type.getCanonicalType().getUnqualifiedType();
-    return get_persistent_region< ElementRegion >(element_type, base_region);
+    if (index) {
+        // The arrays of unknown size are bounded by the indices.
+        uint64_t num_elements = *index + 1U;
+        if (const auto* typed_base =
+                llvm::dyn_cast< TypedRegion >(base_region)) {
+            const ASTLock lock(m_ast_ctx);
+            if (const auto* array_type = m_ast_ctx.getAsConstantArrayType(
+                    typed_base->get_value_type())) {
+                num_elements = array_type->getSize().getZExtValue();
+            }
+        }
+        if (num_elements > m_max_array_elements) {
+            index = std::nullopt;
+        }
+    }
+    return get_persistent_region< ElementRegion >(element_type,
+                                                  base_region,
+                                                  index);
 }
 
 const VarRegion* RegionManager::get_var_region(const clang::VarDecl* var_decl,
@@ -157,6 +199,92 @@ const FieldRegion* RegionManager::get_field_region(
     return get_persistent_region< FieldRegion >(field_decl, space, parent);
 }
 
+const FieldRegion* RegionManager::get_field_region(
+    const clang::FieldDecl* field_decl, MemRegionRef super_region) {
+    auto field_regions =
+        get_field_regions(field_decl->getParent(), super_region);
+    const unsigned idx = field_decl->getFieldIndex();
+    if (idx < field_regions.size()) {
+        return field_regions[idx];
+    }
+    return get_field_region(field_decl,
+                            super_region->get_memory_space(),
+                            super_region);
+}
+
+llvm::ArrayRef< const FieldRegion* > RegionManager::get_field_regions(
+    const clang::RecordDecl* record, MemRegionRef super_region) {
+    auto& field_regions = m_field_regions[{super_region, record}];
+    if (!field_regions.empty()) {
+        return field_regions;
+    }
+    const auto& layout = get_record_layout(record);
+    if (layout.fields.empty()) {
+        return field_regions;
+    }
+    auto* regions =
+        m_allocator.Allocate< const FieldRegion* >(layout.fields.size());
+    for (std::size_t idx = 0U; idx < layout.fields.size(); ++idx) {
+        regions[idx] = get_field_region(layout.fields[idx].field_decl,
+                                        super_region->get_memory_space(),
+                                        super_region);
+    }
+    return field_regions = llvm::ArrayRef(regions, layout.fields.size());
+}
+
+const RecordLayout& RegionManager::get_record_layout(
+    const clang::RecordDecl* record) {
+    auto [it, inserted] = m_record_layouts.try_emplace(record);
+    RecordLayout& layout = it->second;
+    if (!inserted) {
+        return layout;
+    }
+    // The record layouts and the type infos are memoized by the context
+    // shared by the function workers.
+    const ASTLock lock(m_ast_ctx);
+    const auto* def = record->getDefinition();
+    if (def == nullptr || def->isInvalidDecl() || def->isDependentType()) {
+        return layout;
+    }
+    const auto& ast_layout = m_ast_ctx.getASTRecordLayout(def);
+    layout.size = m_ast_ctx.toBits(ast_layout.getSize());
+    for (const auto* field : def->fields()) {
+        uint64_t size = 0U;
+        if (field->isBitField()) {
+            size = field->getBitWidthValue(m_ast_ctx);
+        } else if (!field->getType()->isIncompleteType()) {
+            size = m_ast_ctx.getTypeSize(field->getType());
+        }
+        layout.fields.push_back(
+            {field, ast_layout.getFieldOffset(field->getFieldIndex()), size});
+    }
+    return layout;
+}
+
+const HeapAllocRegion* RegionManager::get_heap_alloc_region(
+    const clang::Expr* alloc_expr, const StackFrame* frame, bool is_summary) {
+    return get_persistent_region< HeapAllocRegion >(alloc_expr,
+                                                    frame,
+                                                    m_heap_context_depth,
+                                                    is_summary,
+                                                    get_heap_space());
+}
+
+bool RegionManager::is_summarized(MemRegionRef region) {
+    for (; region != nullptr; region = region->get_parent()) {
+        if (const auto* heap_region =
+                llvm::dyn_cast< HeapAllocRegion >(region)) {
+            return heap_region->is_summary();
+        }
+        if (const auto* elem_region = llvm::dyn_cast< ElementRegion >(region)) {
+            if (elem_region->is_smashed()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 const ArgumentRegion* RegionManager::get_argument_region(
     const StackFrame* frame,
     const clang::ParmVarDecl* param_decl,
@@ -181,8 +309,21 @@ const CXXThisRegion* RegionManager::get_cxx_this_region(
 
 const MemRegion* RegionManager::get_region(const clang::VarDecl* var_decl,
                                            const StackFrame* frame) {
-    // TODO(var-region): impl
     knight_assert(var_decl != nullptr);
+    if (frame != m_last_frame) {
+        m_last_frame = frame;
+        m_last_var_regions = &m_frame_var_regions[frame];
+    }
+    const MemRegion*& region = (*m_last_var_regions)[var_decl];
+    if (region == nullptr) {
+        region = create_region(var_decl, frame);
+    }
+    return region;
+}
+
+const MemRegion* RegionManager::create_region(const clang::VarDecl* var_decl,
+                                              const StackFrame* frame) {
+    // TODO(var-region): impl
     var_decl = var_decl->getCanonicalDecl();
     if (var_decl == nullptr) {
         return nullptr;
@@ -71,6 +71,18 @@ ProcCFG::GraphRef StackFrame::get_cfg() const {
     return m_manager->get_cfg(m_decl);
 }
 
+const ProcWto* StackFrame::get_wto() const {
+    return m_manager->get_wto(m_decl);
+}
+
+const LiveVariables* StackFrame::get_live_variables() const {
+    return m_manager->get_live_variables(m_decl);
+}
+
+const DefUseChains* StackFrame::get_def_use_chains() const {
+    return m_manager->get_def_use_chains(m_decl);
+}
+
 ProcCFG::StmtRef StackFrame::get_callsite_expr() const {
     knight_assert_msg(!is_top_frame(), "top frame has no call site info");
     return m_call_site_info.callsite_expr;
@@ -0,0 +1,71 @@
+//===- summary.cpp ----------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the function summaries of the interprocedural
+//  analysis.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/summary.hpp"
+
+#include <clang/AST/Decl.h>
+#include <clang/AST/Expr.h>
+#include <clang/AST/Stmt.h>
+
+#include <mutex>
+
+namespace knight::dfa {
+
+namespace {
+
+void collect_direct_callees(
+    const clang::Stmt* stmt,
+    std::vector< const clang::FunctionDecl* >& callees) {
+    if (stmt == nullptr) {
+        return;
+    }
+    if (const auto* call = llvm::dyn_cast< clang::CallExpr >(stmt)) {
+        if (const auto* callee = call->getDirectCallee()) {
+            callees.push_back(callee);
+        }
+    }
+    for (const auto* child : stmt->children()) {
+        collect_direct_callees(child, callees);
+    }
+}
+
+} // anonymous namespace
+
+std::optional< FunctionSummary > SummaryTable::find(DeclRef decl) const {
+    const std::shared_lock lock(m_mutex);
+    auto it = m_summaries.find(decl->getCanonicalDecl());
+    if (it == m_summaries.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void SummaryTable::set(DeclRef decl, FunctionSummary summary) {
+    const std::unique_lock lock(m_mutex);
+    m_summaries[decl->getCanonicalDecl()] = summary;
+}
+
+std::size_t SummaryTable::size() const {
+    const std::shared_lock lock(m_mutex);
+    return m_summaries.size();
+}
+
+std::vector< const clang::FunctionDecl* > get_direct_callees(
+    ProcCFG::DeclRef function) {
+    std::vector< const clang::FunctionDecl* > callees;
+    collect_direct_callees(function->getBody(), callees);
+    return callees;
+}
+
+} // namespace knight::dfa
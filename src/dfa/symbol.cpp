@@ -16,6 +16,8 @@
 #include "dfa/stack_frame.hpp"
 
 #include <clang/AST/Expr.h>
+#include <llvm/ADT/Hashing.h>
+#include <llvm/Support/Casting.h>
 
 namespace knight::dfa {
 
@@ -23,12 +25,37 @@ bool is_valid_type_for_sym_expr(clang::QualType type) {
     return !type.isNull() && !type->isVoidType();
 }
 
+void SymIterator::push(SExprRef sym_expr) {
+    if (m_visit_once && !m_visited.insert(sym_expr).second) {
+        return;
+    }
+    m_sym_exprs.push_back(sym_expr);
+}
+
 void SymIterator::expand() {
-    // TODO(sym): implement this
+    SExprRef sym_expr = m_sym_exprs.pop_back_val();
+    switch (sym_expr->get_kind()) {
+        case SymExprKind::CastSym:
+            push(llvm::cast< CastSymExpr >(sym_expr)->get_operand());
+            break;
+        case SymExprKind::UnarySymEx:
+            push(llvm::cast< UnarySymExpr >(sym_expr)->get_operand());
+            break;
+        case SymExprKind::BinarySymEx: {
+            const auto* binary = llvm::cast< BinarySymExpr >(sym_expr);
+            // Push the rhs first so that the lhs is visited first.
+            push(binary->get_rhs());
+            push(binary->get_lhs());
+            break;
+        }
+        default:
+            break;
+    }
 }
 
-SymIterator::SymIterator(const SymExpr* sym_expr) {
-    m_sym_exprs.push_back(sym_expr);
+SymIterator::SymIterator(const SymExpr* sym_expr, bool visit_once)
+    : m_visit_once(visit_once) {
+    push(sym_expr);
 }
 
 SymIterator& SymIterator::operator++() {
@@ -43,6 +70,19 @@ SExprRef SymIterator::operator*() {
     return m_sym_exprs.back();
 }
 
+bool SymIterator::operator==(const SymIterator& other) const {
+    return m_sym_exprs == other.m_sym_exprs;
+}
+
+bool SymIterator::operator!=(const SymIterator& other) const {
+    return !(*this == other);
+}
+
+SymExpr::RegionMask SymExpr::get_region_bit(const MemRegion* region) {
+    constexpr unsigned MaskBits = sizeof(RegionMask) * 8U;
+    return RegionMask(1U) << (llvm::hash_value(region) % MaskBits);
+}
+
 RegionSymVal::RegionSymVal(SymID id,
                            const TypedRegion* region,
                            const LocationContext* loc_ctx,
@@ -52,6 +92,7 @@ RegionSymVal::RegionSymVal(SymID id,
       m_region(region),
       m_is_external(is_external) {
     knight_assert_msg(region != nullptr, "Region cannot be null");
+    m_region_mask = get_region_bit(region);
     knight_assert_msg(is_valid_type_for_sym_expr(m_region->get_value_type()),
                       "Invalid type for region symbol value");
 }
@@ -74,7 +115,9 @@ clang::QualType RegionSymVal::get_type() const {
 }
 
 RegionSymExtent::RegionSymExtent(SymID id, const MemRegion* region)
-    : Sym(id, SymExprKind::RegionSymbolExtent), m_region(region) {}
+    : Sym(id, SymExprKind::RegionSymbolExtent), m_region(region) {
+    m_region_mask = get_region_bit(region);
+}
 
 const MemRegion* RegionSymExtent::get_region() const {
     return m_region;
@@ -102,13 +145,6 @@ void SymbolConjured::dump(llvm::raw_ostream& os) const {
     os << ", #" << m_visit_cnt << "}";
 }
 
-unsigned UnarySymExpr::get_worst_complexity() const {
-    if (m_complexity == 0U) {
-        m_complexity = m_operand->get_worst_complexity();
-    }
-    return m_complexity;
-}
-
 void UnarySymExpr::dump(llvm::raw_ostream& os) const {
     os << clang::UnaryOperator::getOpcodeStr(m_opcode);
     auto non_leaf_op = !m_operand->is_leaf();
@@ -121,13 +157,6 @@ void UnarySymExpr::dump(llvm::raw_ostream& os) const {
     }
 }
 
-unsigned CastSymExpr::get_worst_complexity() const {
-    if (m_complexity == 0U) {
-        m_complexity = get_worst_complexity();
-    }
-    return m_complexity;
-}
-
 void CastSymExpr::dump(llvm::raw_ostream& os) const {
     os << "cast<" << m_dst << ">(";
     m_operand->dump(os);
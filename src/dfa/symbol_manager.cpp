@@ -0,0 +1,146 @@
+//===- symbol_manager.cpp ---------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the symbol manager.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/symbol_manager.hpp"
+#include "dfa/region/region.hpp"
+#include "dfa/shared_interner.hpp"
+
+namespace knight::dfa {
+
+const ScalarInt* SymbolManager::get_scalar_int(const llvm::APSInt& value,
+                                               clang::QualType type) {
+    llvm::FoldingSetNodeID id;
+    ScalarInt::profile(id, value, type);
+    return get_persistent_sym_expr< ScalarInt >(id, [&](auto& allocator) {
+        return new (allocator) ScalarInt(value, type); // NOLINT
+    });
+}
+
+const ScalarFloat* SymbolManager::get_scalar_float(const llvm::APFloat& value,
+                                                   clang::QualType type) {
+    llvm::FoldingSetNodeID id;
+    ScalarFloat::profile(id, value, type);
+    return get_persistent_sym_expr< ScalarFloat >(id, [&](auto& allocator) {
+        return new (allocator) ScalarFloat(value, type); // NOLINT
+    });
+}
+
+const RegionSymVal* SymbolManager::get_region_sym_val(
+    const TypedRegion* region,
+    const LocationContext* loc_ctx,
+    bool is_external) {
+    llvm::FoldingSetNodeID id;
+    RegionSymVal::profile(id, region, is_external);
+    return get_persistent_sym_expr< RegionSymVal >(id, [&](auto& allocator) {
+        return new (allocator) // NOLINT
+            RegionSymVal(get_next_sym_id(), region, loc_ctx, is_external);
+    });
+}
+
+const RegionSymExtent* SymbolManager::get_region_sym_extent(
+    const MemRegion* region) {
+    llvm::FoldingSetNodeID id;
+    RegionSymExtent::profile(id, region);
+    return get_persistent_sym_expr< RegionSymExtent >(id, [&](auto& allocator) {
+        return new (allocator) // NOLINT
+            RegionSymExtent(get_next_sym_id(), region);
+    });
+}
+
+const SymbolConjured* SymbolManager::get_symbol_conjured(
+    const clang::Stmt* stmt,
+    clang::QualType type,
+    unsigned visit_cnt,
+    const StackFrame* frame,
+    const void* tag) {
+    llvm::FoldingSetNodeID id;
+    SymbolConjured::profile(id, stmt, type, visit_cnt, frame, tag);
+    return get_persistent_sym_expr< SymbolConjured >(id, [&](auto& allocator) {
+        return new (allocator) // NOLINT
+            SymbolConjured(get_next_sym_id(),
+                           stmt,
+                           type,
+                           visit_cnt,
+                           frame,
+                           tag);
+    });
+}
+
+SExprRef SymbolManager::get_cast_sym_expr(SExprRef operand,
+                                          clang::QualType src,
+                                          clang::QualType dst) {
+    llvm::FoldingSetNodeID id;
+    CastSymExpr::profile(id, operand, src, dst);
+    return bound_depth(
+        get_persistent_sym_expr< CastSymExpr >(id, [&](auto& allocator) {
+            return new (allocator) CastSymExpr(operand, src, dst); // NOLINT
+        }));
+}
+
+SExprRef SymbolManager::get_unary_sym_expr(
+    SExprRef operand,
+    clang::UnaryOperator::Opcode opcode,
+    clang::QualType type) {
+    llvm::FoldingSetNodeID id;
+    UnarySymExpr::profile(id, operand, opcode, type);
+    return bound_depth(
+        get_persistent_sym_expr< UnarySymExpr >(id, [&](auto& allocator) {
+            return new (allocator) // NOLINT
+                UnarySymExpr(operand, opcode, type);
+        }));
+}
+
+SExprRef SymbolManager::get_binary_sym_expr(
+    SExprRef lhs,
+    SExprRef rhs,
+    clang::BinaryOperator::Opcode opcode,
+    clang::QualType type) {
+    llvm::FoldingSetNodeID id;
+    BinarySymExpr::profile(id,
+                           SymExprKind::BinarySymEx,
+                           lhs,
+                           rhs,
+                           opcode,
+                           type);
+    return bound_depth(
+        get_persistent_sym_expr< BinarySymExpr >(id, [&](auto& allocator) {
+            return new (allocator) // NOLINT
+                BinarySymExpr(lhs, rhs, opcode, type);
+        }));
+}
+
+SymID SymbolManager::get_next_sym_id() {
+    if (m_interner != nullptr) {
+        return m_interner->get_next_sym_id();
+    }
+    return m_next_sym_id++;
+}
+
+SymExpr* SymbolManager::get_shared_sym_expr(
+    const llvm::FoldingSetNodeID& id,
+    llvm::function_ref< SymExpr*(llvm::BumpPtrAllocator&) > create) {
+    return m_interner->get_sym_expr_set().get_or_insert(id, create);
+}
+
+SExprRef SymbolManager::bound_depth(SExprRef sym_expr) {
+    if (sym_expr->get_depth() <= m_max_sym_expr_depth) {
+        return sym_expr;
+    }
+    return get_symbol_conjured(/*stmt=*/nullptr,
+                               sym_expr->get_type(),
+                               /*visit_cnt=*/0U,
+                               /*frame=*/nullptr,
+                               /*tag=*/sym_expr);
+}
+
+} // namespace knight::dfa
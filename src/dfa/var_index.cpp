@@ -0,0 +1,60 @@
+//===- var_index.cpp --------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the dense numbering of the numerical variables.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/var_index.hpp"
+
+#include <limits>
+
+namespace knight::dfa {
+
+DenseVarID VarIndex::get_id(NumVarRef var) {
+    knight_assert_msg(!var.isNull(), "null numerical variable");
+    auto [it, inserted] = m_ids.try_emplace(var, size());
+    if (inserted) {
+        knight_assert_msg(m_vars.size() <
+                              std::numeric_limits< DenseVarID >::max(),
+                          "too many numerical variables");
+        m_vars.push_back(var);
+    }
+    return it->second;
+}
+
+std::optional< DenseVarID > VarIndex::find_id(NumVarRef var) const {
+    auto it = m_ids.find(var);
+    if (it == m_ids.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void VarIndex::clear() {
+    m_ids.clear();
+    std::vector< NumVarRef >().swap(m_vars);
+}
+
+void VarIndex::dump(llvm::raw_ostream& os, DenseVarID id) const {
+    os << "v" << id;
+    if (id >= m_vars.size()) {
+        return;
+    }
+    os << "(";
+    const auto var = m_vars[id];
+    if (const auto* region = var.dyn_cast< MemRegionRef >()) {
+        region->dump(os);
+    } else {
+        var.get< const Sym* >()->dump(os);
+    }
+    os << ")";
+}
+
+} // namespace knight::dfa
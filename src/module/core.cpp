@@ -12,7 +12,9 @@
 //===------------------------------------------------------------------===//
 
 #include "dfa/analysis/analyses.hpp"
+#include "dfa/analysis/numerical_analysis.hpp"
 #include "dfa/analysis/symbol_resolver.hpp"
+#include "dfa/checker/debug_inspection.hpp"
 #include "tooling/factory.hpp"
 #include "tooling/module.hpp"
 
@@ -24,8 +26,10 @@ class CoreModule : public KnightModule {
     void add_to_factory(KnightFactory& factory) override {
         // Register analyses.
         factory.register_analysis< dfa::SymbolResolver >();
+        factory.register_analysis< dfa::NumericalAnalysis >();
 
         // Register checkers.
+        factory.register_checker< dfa::DebugInspection >();
     }
 }; // class CoreModule
 
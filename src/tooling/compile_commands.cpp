@@ -0,0 +1,109 @@
+//===- compile_commands.cpp -------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the deduplication of the compile commands.
+//
+//===------------------------------------------------------------------===//
+
+#include "tooling/compile_commands.hpp"
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/ADT/StringSwitch.h>
+
+#include <optional>
+
+namespace knight {
+
+namespace {
+
+enum class FlagKind {
+    /// \brief The flag changes the meaning of the translation unit.
+    Semantic,
+    /// \brief The flag does not, and neither does its value.
+    Ignored,
+    /// \brief The flag does not, and takes the next argument as value.
+    IgnoredWithValue,
+}; // enum class FlagKind
+
+FlagKind get_flag_kind(llvm::StringRef arg) {
+    auto kind =
+        llvm::StringSwitch< std::optional< FlagKind > >(arg)
+            .Cases("-o", "-MF", "-MT", "-MQ", FlagKind::IgnoredWithValue)
+            .Cases("-c", "-M", "-MM", "-MD", "-MMD", FlagKind::Ignored)
+            .Cases("-MP", "-MG", "-w", "-g", FlagKind::Ignored)
+            .Cases("-fcolor-diagnostics",
+                   "-fno-color-diagnostics",
+                   "-gline-tables-only",
+                   "-gsplit-dwarf",
+                   FlagKind::Ignored)
+            .Default(std::nullopt);
+    if (kind) {
+        return *kind;
+    }
+    // The flags passed to the preprocessor may define macros.
+    if (arg.starts_with("-W") && !arg.starts_with("-Wp,")) {
+        return FlagKind::Ignored;
+    }
+    if (arg.starts_with("-MF") || arg.starts_with("-MT") ||
+        arg.starts_with("-MQ") || arg.starts_with("-fdiagnostics-color") ||
+        arg.starts_with("-ggdb") || arg.starts_with("-gdwarf") ||
+        (arg.size() == 3U && arg.starts_with("-g") &&
+         llvm::isDigit(arg.back()))) {
+        return FlagKind::Ignored;
+    }
+    return FlagKind::Semantic;
+}
+
+} // anonymous namespace
+
+std::string get_semantic_key(const clang::tooling::CompileCommand& command) {
+    // The relative paths of the flags are resolved from the directory.
+    std::string key = command.Directory;
+    key += '\0';
+    key += command.Filename;
+    for (std::size_t i = 0U; i < command.CommandLine.size(); ++i) {
+        const auto& arg = command.CommandLine[i];
+        switch (get_flag_kind(arg)) {
+            case FlagKind::IgnoredWithValue:
+                ++i;
+                continue;
+            case FlagKind::Ignored:
+                continue;
+            case FlagKind::Semantic:
+                break;
+        }
+        key += '\0';
+        key += arg;
+    }
+    return key;
+}
+
+std::vector< clang::tooling::CompileCommand > DedupedCompilationDatabase::
+    getCompileCommands(llvm::StringRef file) const {
+    auto commands = m_cdb.getCompileCommands(file);
+    llvm::StringSet<> keys;
+    llvm::erase_if(commands, [&keys](const auto& command) {
+        return !keys.insert(get_semantic_key(command)).second;
+    });
+    return commands;
+}
+
+std::vector< clang::tooling::CompileCommand > DedupedCompilationDatabase::
+    getAllCompileCommands() const {
+    auto commands = m_cdb.getAllCompileCommands();
+    llvm::StringSet<> keys;
+    llvm::erase_if(commands, [&keys](const auto& command) {
+        return !keys.insert(get_semantic_key(command)).second;
+    });
+    return commands;
+}
+
+} // namespace knight
@@ -13,6 +13,7 @@
 //===------------------------------------------------------------------===//
 
 #include "tooling/context.hpp"
+#include "tooling/diagnostic.hpp"
 #include "util/assert.hpp"
 
 #include <clang/AST/ASTDiagnostic.h>
@@ -23,33 +24,52 @@
 
 namespace knight {
 
-KnightContext::KnightContext(
-    std::unique_ptr< KnightOptionsProvider > opts_provider)
-    : m_opts_provider(std::move(opts_provider)) {
+OptionMatchers::OptionMatchers(const KnightOptions& options)
+    : check_matcher(options.checkers),
+      analysis_matcher(options.analyses),
+      header_matcher(options.header_filter) {}
+
+KnightTUContext::KnightTUContext(std::shared_ptr< KnightGlobalContext > global)
+    : m_global(std::move(global)) {
     set_current_file("");
 }
 
-KnightContext::~KnightContext() = default;
+KnightTUContext::~KnightTUContext() = default;
+
+std::unique_ptr< KnightTUContext > KnightTUContext::fork() const {
+    auto ctx = std::make_unique< KnightTUContext >(m_global);
+    ctx->m_diag_engine = m_diag_engine;
+    ctx->m_current_file = m_current_file;
+    ctx->m_current_options = m_current_options;
+    ctx->m_current_ast_ctx = m_current_ast_ctx;
+    ctx->m_current_matchers = m_current_matchers;
+    ctx->m_current_build_dir = m_current_build_dir;
+    return ctx;
+}
 
-void KnightContext::set_diagnostic_engine(
+void KnightTUContext::set_diagnostic_engine(
     clang::DiagnosticsEngine* external_diag_engine) {
     this->m_diag_engine = external_diag_engine;
 }
 
-KnightOptions KnightContext::get_options_for(llvm::StringRef file) const {
-    return m_opts_provider->get_options_for(file.str());
-}
-
-void KnightContext::set_current_file(llvm::StringRef file) {
+void KnightTUContext::set_current_file(llvm::StringRef file) {
     m_current_file = file.str();
     m_current_options = get_options_for(file);
-    m_current_check_matcher =
-        std::make_unique< Globs >(m_current_options.checkers);
-    m_current_analysis_matcher =
-        std::make_unique< Globs >(m_current_options.analyses);
+
+    // The filters cannot contain '\0', which separates them in the key.
+    std::string key = m_current_options.checkers;
+    key.push_back('\0');
+    key += m_current_options.analyses;
+    key.push_back('\0');
+    key += m_current_options.header_filter;
+    auto& matchers = m_matchers_cache[key];
+    if (matchers == nullptr) {
+        matchers = std::make_shared< const OptionMatchers >(m_current_options);
+    }
+    m_current_matchers = matchers;
 }
 
-clang::DiagnosticBuilder KnightContext::diagnose(
+clang::DiagnosticBuilder KnightTUContext::diagnose(
     llvm::StringRef checker,
     clang::SourceLocation loc,
     llvm::StringRef info,
@@ -57,6 +77,10 @@ clang::DiagnosticBuilder KnightContext::diagnose(
     knight_assert_msg(loc.isValid(), "Invalid location");
 
     auto fmt = (info + " [" + checker + "]").str();
+    if (m_diag_buffer != nullptr) {
+        return m_diag_buffer->report(checker, loc, fmt, diag_level);
+    }
+
     const unsigned custom_diag_id =
         m_diag_engine->getDiagnosticIDs()->getCustomDiagID(diag_level, fmt);
 
@@ -64,32 +88,35 @@ clang::DiagnosticBuilder KnightContext::diagnose(
     return m_diag_engine->Report(loc, custom_diag_id);
 }
 
-void KnightContext::set_current_ast_context(clang::ASTContext* ast_ctx) {
+void KnightTUContext::set_current_ast_context(clang::ASTContext* ast_ctx) {
     m_current_ast_ctx = ast_ctx;
     m_diag_engine->setSourceManager(&ast_ctx->getSourceManager());
     m_diag_engine->SetArgToStringFn(&clang::FormatASTNodeDiagnosticArgument,
                                     ast_ctx);
 }
 
-bool KnightContext::is_check_enabled(llvm::StringRef checker) const {
-    knight_assert_msg(m_current_check_matcher != nullptr,
-                      "checker matcher is null");
-    return m_current_check_matcher->matches(checker);
+bool KnightTUContext::is_check_enabled(llvm::StringRef checker) const {
+    knight_assert_msg(m_current_matchers != nullptr, "matchers are null");
+    return m_current_matchers->check_matcher.matches(checker);
+}
+
+bool KnightTUContext::is_header_analyzed(llvm::StringRef header) const {
+    knight_assert_msg(m_current_matchers != nullptr, "matchers are null");
+    return m_current_matchers->header_matcher.matches(header);
 }
 
-bool KnightContext::is_analysis_directly_enabled(
+bool KnightTUContext::is_analysis_directly_enabled(
     llvm::StringRef analysis) const {
-    knight_assert_msg(m_current_analysis_matcher != nullptr,
-                      "analysis matcher is null");
-    return m_current_analysis_matcher->matches(analysis);
+    knight_assert_msg(m_current_matchers != nullptr, "matchers are null");
+    return m_current_matchers->analysis_matcher.matches(analysis);
 }
 
-bool KnightContext::is_core_analysis_enabled(llvm::StringRef analysis) const {
+bool KnightTUContext::is_core_analysis_enabled(llvm::StringRef analysis) const {
     // TODO: shall we use a more restrictive way to check core analysis?
     return analysis.starts_with("core-");
 }
 
-std::optional< std::string > KnightContext::get_check_name(unsigned diag_id) {
+std::optional< std::string > KnightTUContext::get_check_name(unsigned diag_id) {
     auto it = m_diag_id_to_checker_name.find(diag_id);
     if (it != m_diag_id_to_checker_name.end()) {
         return it->second;
@@ -104,11 +131,18 @@ std::optional< std::string > KnightContext::get_check_name(unsigned diag_id) {
     return std::nullopt;
 }
 
-clang::DiagnosticBuilder KnightContext::diagnose(
+clang::DiagnosticBuilder KnightTUContext::diagnose(
     llvm::StringRef checker,
     llvm::StringRef info,
     clang::DiagnosticIDs::Level diag_level) {
     auto fmt = (info + " [" + checker + "]").str();
+    if (m_diag_buffer != nullptr) {
+        return m_diag_buffer->report(checker,
+                                     clang::SourceLocation(),
+                                     fmt,
+                                     diag_level);
+    }
+
     const unsigned custom_diag_id =
         m_diag_engine->getDiagnosticIDs()->getCustomDiagID(diag_level, fmt);
 
@@ -116,7 +150,7 @@ clang::DiagnosticBuilder KnightContext::diagnose(
     return m_diag_engine->Report(custom_diag_id);
 }
 
-clang::DiagnosticBuilder KnightContext::diagnose(
+clang::DiagnosticBuilder KnightTUContext::diagnose(
     const clang::tooling::Diagnostic& d) {
     auto& src_mgr = m_diag_engine->getSourceManager();
     auto& file_mgr = src_mgr.getFileManager();
@@ -0,0 +1,137 @@
+//===- cross_tu.cpp ---------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the cross translation unit importer of the callee
+//  definitions.
+//
+//===------------------------------------------------------------------===//
+
+#include "tooling/cross_tu.hpp"
+#include "dfa/summary.hpp"
+
+#include <clang/AST/ASTContext.h>
+#include <clang/StaticAnalyzer/Core/AnalyzerOptions.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/WithColor.h>
+#include <llvm/Support/raw_ostream.h>
+
+#define DEBUG_TYPE "cross-tu" // NOLINT
+
+ALWAYS_ENABLED_STATISTIC(NumCTUImportedFunctions,
+                         "The number of the imported callee definitions");
+ALWAYS_ENABLED_STATISTIC(NumCTUMissingFunctions,
+                         "The number of the callees without definition in "
+                         "the CTU index");
+
+namespace knight {
+
+namespace {
+
+/// \brief Set the limit of the loaded ASTs read by the CTU context on
+/// construction.
+clang::CompilerInstance& set_max_loaded_asts(clang::CompilerInstance& ci,
+                                             unsigned max_loaded_asts) {
+    auto& analyzer_opts = ci.getAnalyzerOpts();
+    analyzer_opts.CTUImportThreshold = max_loaded_asts;
+    analyzer_opts.CTUImportCppThreshold = max_loaded_asts;
+    return ci;
+}
+
+} // anonymous namespace
+
+CrossTUImporter::CrossTUImporter(clang::CompilerInstance& ci,
+                                 llvm::StringRef dir,
+                                 unsigned max_loaded_asts)
+    : m_ctu(set_max_loaded_asts(ci, max_loaded_asts)), m_dir(dir) {}
+
+void CrossTUImporter::import_callees(const clang::FunctionDecl* function,
+                                     unsigned depth) {
+    auto [it, inserted] =
+        m_visited.try_emplace(function->getCanonicalDecl(), depth);
+    if (!inserted) {
+        if (it->second >= depth) {
+            return;
+        }
+        it->second = depth;
+    }
+    if (depth == 0U) {
+        return;
+    }
+
+    for (const auto* callee : dfa::get_direct_callees(function)) {
+        const auto* definition = import_definition(callee);
+        if (definition != nullptr) {
+            import_callees(definition, depth - 1U);
+        }
+    }
+}
+
+const clang::FunctionDecl* CrossTUImporter::import_definition(
+    const clang::FunctionDecl* function) {
+    const clang::FunctionDecl* definition = nullptr;
+    if (function->hasBody(definition)) {
+        return definition;
+    }
+    if (function->getBuiltinID() != 0U || function->isTemplated()) {
+        return nullptr;
+    }
+
+    auto imported = m_ctu.getCrossTUDefinition(function, m_dir, IndexName);
+    if (!imported) {
+        // The missing definitions, e.g. of the library functions, are
+        // expected and not reported.
+        llvm::consumeError(imported.takeError());
+        ++NumCTUMissingFunctions;
+        return nullptr;
+    }
+    ++NumCTUImportedFunctions;
+    return *imported;
+}
+
+void CrossTUImporter::index_ast(clang::ASTUnit& unit,
+                                llvm::StringRef ast_path,
+                                llvm::StringMap< std::string >& index) {
+    auto& source_mgr = unit.getSourceManager();
+    auto* tu_decl = unit.getASTContext().getTranslationUnitDecl();
+    for (auto* decl : tu_decl->decls()) {
+        const auto* function = llvm::dyn_cast< clang::FunctionDecl >(decl);
+        if (function == nullptr || !function->hasBody() ||
+            function->getBody() == nullptr ||
+            !function->hasExternalFormalLinkage() ||
+            !source_mgr.isInMainFile(function->getLocation())) {
+            continue;
+        }
+        auto lookup_name =
+            clang::cross_tu::CrossTranslationUnitContext::getLookupName(
+                function);
+        if (lookup_name.has_value()) {
+            index.try_emplace(*lookup_name, ast_path.str());
+        }
+    }
+}
+
+bool CrossTUImporter::write_index(
+    llvm::StringRef dir, const llvm::StringMap< std::string >& index) {
+    llvm::SmallString< 128 > path(dir);
+    llvm::sys::path::append(path, IndexName);
+    std::error_code err;
+    llvm::raw_fd_ostream os(path, err, llvm::sys::fs::OF_Text);
+    if (err) {
+        llvm::WithColor::error() << "cannot write the CTU index " << path
+                                 << ": " << err.message() << "\n";
+        return false;
+    }
+    os << clang::cross_tu::createCrossTUIndexString(index);
+    return true;
+}
+
+} // namespace knight
@@ -0,0 +1,432 @@
+//===- dependency_db.cpp ----------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the database of the file dependencies of the
+//  translation units.
+//
+//===------------------------------------------------------------------===//
+
+#include "tooling/dependency_db.hpp"
+#include "util/vfs.hpp"
+
+#include <clang/Tooling/Core/Replacement.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/WithColor.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace knight {
+
+namespace {
+
+/// \brief Version of the database, whose former versions are dropped.
+constexpr int64_t DatabaseVersion = 2;
+
+/// \brief Get the real path of the file if it exists, so that the files
+/// reached through different paths are the same.
+std::string get_canonical_path(llvm::StringRef path) {
+    llvm::SmallString< 256 > real_path;
+    if (!llvm::sys::fs::real_path(path, real_path)) {
+        return std::string(real_path);
+    }
+    return fs::make_absolute(path);
+}
+
+void write_message(llvm::json::OStream& json,
+                   const clang::tooling::DiagnosticMessage& message) {
+    json.object([&] {
+        json.attribute("message", message.Message);
+        json.attribute("file", message.FilePath);
+        json.attribute("offset", static_cast< int64_t >(message.FileOffset));
+        json.attributeArray("ranges", [&] {
+            for (const auto& range : message.Ranges) {
+                json.object([&] {
+                    json.attribute("file", range.FilePath);
+                    json.attribute("offset",
+                                   static_cast< int64_t >(range.FileOffset));
+                    json.attribute("length",
+                                   static_cast< int64_t >(range.Length));
+                });
+            }
+        });
+        json.attributeArray("fixes", [&] {
+            for (const auto& fix : message.Fix) {
+                for (const auto& replacement : fix.second) {
+                    json.object([&] {
+                        json.attribute("file", replacement.getFilePath());
+                        json.attribute("offset",
+                                       static_cast< int64_t >(
+                                           replacement.getOffset()));
+                        json.attribute("length",
+                                       static_cast< int64_t >(
+                                           replacement.getLength()));
+                        json.attribute("text",
+                                       replacement.getReplacementText());
+                    });
+                }
+            }
+        });
+    });
+}
+
+void write_diagnostic(llvm::json::OStream& json,
+                      const KnightDiagnostic& diagnostic) {
+    json.object([&] {
+        json.attribute("name", diagnostic.DiagnosticName);
+        json.attribute("level", static_cast< int64_t >(diagnostic.DiagLevel));
+        json.attribute("build_dir", diagnostic.BuildDirectory);
+        json.attributeBegin("message");
+        write_message(json, diagnostic.Message);
+        json.attributeEnd();
+        json.attributeArray("notes", [&] {
+            for (const auto& note : diagnostic.Notes) {
+                write_message(json, note);
+            }
+        });
+    });
+}
+
+std::optional< clang::tooling::DiagnosticMessage > read_message(
+    const llvm::json::Object* object) {
+    if (object == nullptr) {
+        return std::nullopt;
+    }
+    auto text = object->getString("message");
+    auto file = object->getString("file");
+    auto offset = object->getInteger("offset");
+    if (!text || !file || !offset) {
+        return std::nullopt;
+    }
+    clang::tooling::DiagnosticMessage message;
+    message.Message = text->str();
+    message.FilePath = file->str();
+    message.FileOffset = static_cast< unsigned >(*offset);
+    if (const auto* ranges = object->getArray("ranges")) {
+        for (const auto& range_value : *ranges) {
+            const auto* range = range_value.getAsObject();
+            if (range == nullptr) {
+                return std::nullopt;
+            }
+            auto& byte_range = message.Ranges.emplace_back();
+            byte_range.FilePath = range->getString("file").value_or("").str();
+            byte_range.FileOffset = static_cast< unsigned >(
+                range->getInteger("offset").value_or(0));
+            byte_range.Length = static_cast< unsigned >(
+                range->getInteger("length").value_or(0));
+        }
+    }
+    if (const auto* fixes = object->getArray("fixes")) {
+        for (const auto& fix_value : *fixes) {
+            const auto* fix = fix_value.getAsObject();
+            if (fix == nullptr) {
+                return std::nullopt;
+            }
+            const auto fix_file = fix->getString("file").value_or("");
+            const clang::tooling::Replacement
+                replacement(fix_file,
+                            static_cast< unsigned >(
+                                fix->getInteger("offset").value_or(0)),
+                            static_cast< unsigned >(
+                                fix->getInteger("length").value_or(0)),
+                            fix->getString("text").value_or(""));
+            if (auto err = message.Fix[fix_file].add(replacement)) {
+                llvm::consumeError(std::move(err));
+                return std::nullopt;
+            }
+        }
+    }
+    return message;
+}
+
+std::optional< KnightDiagnostic > read_diagnostic(
+    const llvm::json::Object* object) {
+    if (object == nullptr) {
+        return std::nullopt;
+    }
+    auto name = object->getString("name");
+    auto level = object->getInteger("level");
+    auto build_dir = object->getString("build_dir");
+    auto message = read_message(object->getObject("message"));
+    if (!name || !level || !build_dir || !message) {
+        return std::nullopt;
+    }
+    KnightDiagnostic diagnostic(
+        *name,
+        static_cast< KnightDiagnostic::Level >(*level),
+        *build_dir);
+    diagnostic.Message = std::move(*message);
+    if (const auto* notes = object->getArray("notes")) {
+        for (const auto& note_value : *notes) {
+            auto note = read_message(note_value.getAsObject());
+            if (!note) {
+                return std::nullopt;
+            }
+            diagnostic.Notes.push_back(std::move(*note));
+        }
+    }
+    return diagnostic;
+}
+
+} // anonymous namespace
+
+std::optional< FileStamp > FileStamp::get(llvm::StringRef path) {
+    llvm::sys::fs::file_status status;
+    if (llvm::sys::fs::status(path, status)) {
+        return std::nullopt;
+    }
+    const auto mtime = std::chrono::duration_cast< std::chrono::nanoseconds >(
+        status.getLastModificationTime().time_since_epoch());
+    return FileStamp{path.str(),
+                     static_cast< int64_t >(mtime.count()),
+                     status.getSize()};
+}
+
+std::string DependencyDatabase::get_path(llvm::StringRef dir) {
+    llvm::SmallString< 128 > path(dir);
+    llvm::sys::path::append(path, "dependencies.json");
+    return std::string(path);
+}
+
+void DependencyDatabase::load(llvm::StringRef path) {
+    const std::lock_guard lock(m_mutex);
+    m_tus.clear();
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) {
+        return;
+    }
+    auto value = llvm::json::parse((*buffer)->getBuffer());
+    if (!value) {
+        llvm::WithColor::warning()
+            << "invalid dependency database " << path << ": "
+            << llvm::toString(value.takeError()) << "\n";
+        return;
+    }
+    const auto* root = value->getAsObject();
+    if (root == nullptr ||
+        root->getInteger("version").value_or(0) != DatabaseVersion) {
+        return;
+    }
+    const auto* tus = root->getArray("tus");
+    if (tus == nullptr) {
+        return;
+    }
+
+    for (const auto& tu_value : *tus) {
+        const auto* tu = tu_value.getAsObject();
+        if (tu == nullptr) {
+            continue;
+        }
+        auto main_file = tu->getString("file");
+        auto config_hash = tu->getString("config");
+        const auto* files = tu->getArray("deps");
+        uint64_t hash = 0U;
+        if (!main_file || !config_hash || files == nullptr ||
+            !llvm::to_integer(*config_hash, hash, 16)) {
+            continue;
+        }
+
+        TUDependencies deps{hash, {}, {}};
+        for (const auto& file_value : *files) {
+            const auto* file = file_value.getAsObject();
+            auto file_path =
+                file != nullptr ? file->getString("path") : std::nullopt;
+            if (!file_path) {
+                continue;
+            }
+            deps.files.push_back(
+                {file_path->str(),
+                 file->getInteger("mtime").value_or(0),
+                 static_cast< uint64_t >(
+                     file->getInteger("size").value_or(0))});
+        }
+
+        // A translation unit whose diagnostics cannot be read is analyzed
+        // again.
+        const auto* diags = tu->getArray("diags");
+        if (diags == nullptr) {
+            continue;
+        }
+        bool is_valid = true;
+        for (const auto& diag_value : *diags) {
+            auto diag = read_diagnostic(diag_value.getAsObject());
+            if (!diag) {
+                is_valid = false;
+                break;
+            }
+            deps.diagnostics.push_back(std::move(*diag));
+        }
+        if (is_valid) {
+            m_tus[main_file->str()] = std::move(deps);
+        }
+    }
+}
+
+bool DependencyDatabase::save(llvm::StringRef path) const {
+    // Write to a temporary file first, so that an interrupted run keeps
+    // the former database.
+    llvm::SmallString< 128 > tmp_path(path);
+    tmp_path += ".tmp";
+    {
+        std::error_code err;
+        llvm::raw_fd_ostream os(tmp_path, err, llvm::sys::fs::OF_Text);
+        if (err) {
+            llvm::WithColor::warning()
+                << "cannot write the dependency database " << path << ": "
+                << err.message() << "\n";
+            return false;
+        }
+
+        const std::lock_guard lock(m_mutex);
+        llvm::json::OStream json(os, 2);
+        json.object([&] {
+            json.attribute("version", DatabaseVersion);
+            json.attributeArray("tus", [&] {
+                for (const auto& tu : m_tus) {
+                    json.object([&] {
+                        json.attribute("file", tu.first);
+                        json.attribute("config",
+                                       llvm::utohexstr(tu.second.config_hash));
+                        json.attributeArray("deps", [&] {
+                            for (const auto& file : tu.second.files) {
+                                json.object([&] {
+                                    json.attribute("path", file.path);
+                                    json.attribute("mtime", file.mtime);
+                                    json.attribute("size",
+                                                   static_cast< int64_t >(
+                                                       file.size));
+                                });
+                            }
+                        });
+                        json.attributeArray("diags", [&] {
+                            for (const auto& diag : tu.second.diagnostics) {
+                                write_diagnostic(json, diag);
+                            }
+                        });
+                    });
+                }
+            });
+        });
+    }
+    return !llvm::sys::fs::rename(tmp_path, path);
+}
+
+void DependencyDatabase::record(llvm::StringRef main_file,
+                                uint64_t config_hash,
+                                const clang::SourceManager& source_mgr,
+                                llvm::StringRef build_dir) {
+    TUDependencies deps{config_hash, {}, {}};
+    for (auto it = source_mgr.fileinfo_begin();
+         it != source_mgr.fileinfo_end();
+         ++it) {
+        const clang::FileEntryRef file = it->first;
+        std::string path(file.getFileEntry().tryGetRealPathName());
+        if (path.empty()) {
+            llvm::SmallString< 256 > abs_path(file.getName());
+            if (!llvm::sys::path::is_absolute(abs_path)) {
+                abs_path = build_dir;
+                llvm::sys::path::append(abs_path, file.getName());
+            }
+            path = get_canonical_path(abs_path);
+        }
+        if (auto stamp = FileStamp::get(path)) {
+            deps.files.push_back(std::move(*stamp));
+        }
+    }
+    llvm::sort(deps.files, [](const FileStamp& lhs, const FileStamp& rhs) {
+        return lhs.path < rhs.path;
+    });
+
+    const std::lock_guard lock(m_mutex);
+    m_tus[main_file.str()] = std::move(deps);
+}
+
+void DependencyDatabase::record_diagnostics(
+    llvm::StringRef main_file, llvm::ArrayRef< KnightDiagnostic > diagnostics) {
+    const std::lock_guard lock(m_mutex);
+    auto it = m_tus.find(main_file.str());
+    if (it != m_tus.end()) {
+        it->second.diagnostics.assign(diagnostics.begin(), diagnostics.end());
+    }
+}
+
+std::vector< KnightDiagnostic > DependencyDatabase::get_recorded_diagnostics(
+    llvm::StringRef main_file) const {
+    const std::lock_guard lock(m_mutex);
+    auto it = m_tus.find(main_file.str());
+    if (it == m_tus.end()) {
+        return {};
+    }
+    return it->second.diagnostics;
+}
+
+bool DependencyDatabase::is_invalidated(
+    llvm::StringRef main_file,
+    uint64_t config_hash,
+    const std::optional< llvm::StringSet<> >& changed_files) const {
+    const std::lock_guard lock(m_mutex);
+    auto it = m_tus.find(main_file.str());
+    if (it == m_tus.end() || it->second.config_hash != config_hash) {
+        return true;
+    }
+    if (changed_files.has_value() &&
+        changed_files->contains(get_canonical_path(main_file))) {
+        return true;
+    }
+    return llvm::any_of(it->second.files, [&](const FileStamp& file) {
+        if (changed_files.has_value()) {
+            return changed_files->contains(file.path);
+        }
+        auto stamp = FileStamp::get(file.path);
+        return !stamp.has_value() || !(*stamp == file);
+    });
+}
+
+std::optional< uint64_t > DependencyDatabase::get_recorded_size(
+    llvm::StringRef main_file) const {
+    const std::lock_guard lock(m_mutex);
+    auto it = m_tus.find(main_file.str());
+    if (it == m_tus.end()) {
+        return std::nullopt;
+    }
+    uint64_t size = 0U;
+    for (const auto& file : it->second.files) {
+        size += file.size;
+    }
+    return size;
+}
+
+std::optional< llvm::StringSet<> > read_changed_files(llvm::StringRef path) {
+    auto buffer = llvm::MemoryBuffer::getFile(path, /*IsText=*/true);
+    if (!buffer) {
+        llvm::WithColor::error() << "cannot read the changed files " << path
+                                 << ": " << buffer.getError().message()
+                                 << "\n";
+        return std::nullopt;
+    }
+    llvm::SmallVector< llvm::StringRef, 32U > lines;
+    (*buffer)->getBuffer().split(lines, '\n', -1, false);
+
+    llvm::StringSet<> files;
+    for (auto line : lines) {
+        line = line.trim();
+        if (!line.empty()) {
+            files.insert(get_canonical_path(line));
+        }
+    }
+    return files;
+}
+
+} // namespace knight
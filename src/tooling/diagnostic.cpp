@@ -13,9 +13,12 @@
 
 #include "tooling/diagnostic.hpp"
 #include "tooling/context.hpp"
+#include "tooling/dependency_db.hpp"
+#include "tooling/diagnostic_stream.hpp"
 #include "tooling/knight.hpp"
 #include "util/assert.hpp"
 
+#include <clang/AST/ASTDiagnostic.h>
 #include <clang/Basic/Diagnostic.h>
 #include <clang/Lex/Lexer.h>
 #include <clang/Tooling/Core/Diagnostic.h>
@@ -54,13 +57,20 @@ struct Equal {
 
 } // end anonymous namespace
 
+void sort_and_dedup_diags(std::vector< KnightDiagnostic >& diags) {
+    std::stable_sort(diags.begin(), diags.end(), Less());
+    auto last = std::unique(diags.begin(), diags.end(), Equal());
+    diags.erase(last, diags.end());
+}
+
 KnightDiagnostic::KnightDiagnostic(llvm::StringRef checker,
                                    Level diag_level,
                                    llvm::StringRef build_dir)
     : clang::tooling::Diagnostic(checker, diag_level, build_dir) {}
 
-KnightDiagnosticConsumer::KnightDiagnosticConsumer(KnightContext& context)
-    : m_context(context) {}
+KnightDiagnosticConsumer::KnightDiagnosticConsumer(KnightTUContext& context,
+                                                   DiagnosticStream* stream)
+    : m_context(context), m_stream(stream) {}
 
 void KnightDiagnosticConsumer::HandleDiagnostic(
     clang::DiagnosticsEngine::Level diag_level,
@@ -135,13 +145,121 @@ void KnightDiagnosticConsumer::HandleDiagnostic(
     m_context.get_diagnostic_engine()->Clear();
 }
 
+void KnightDiagnosticConsumer::EndSourceFile() {
+    DiagnosticConsumer::EndSourceFile();
+    // The diagnostics of the translation unit are recorded, so that they
+    // are reported again when the incremental analysis skips it.
+    if (auto* dependency_db = m_context.get_dependency_database()) {
+        dependency_db->record_diagnostics(
+            m_context.get_current_file(),
+            llvm::ArrayRef(m_diags).drop_front(m_tu_begin));
+    }
+    if (m_stream != nullptr) {
+        // The diagnostics of the translation unit are released, so that
+        // only the unfinished ones are kept in memory.
+        m_stream->complete(m_context.get_current_file(), std::move(m_diags));
+        m_diags.clear();
+    }
+    m_tu_begin = m_diags.size();
+}
+
 std::vector< KnightDiagnostic > KnightDiagnosticConsumer::take_diags() {
-    std::stable_sort(m_diags.begin(), m_diags.end(), Less());
-    auto last = std::unique(m_diags.begin(), m_diags.end(), Equal());
-    m_diags.erase(last, m_diags.end());
+    sort_and_dedup_diags(m_diags);
+    m_tu_begin = 0U;
     return std::move(m_diags);
 }
 
+KnightDiagnosticBuffer::KnightDiagnosticBuffer(KnightTUContext& context)
+    : m_engine(new clang::DiagnosticIDs(),
+               new clang::DiagnosticOptions(),
+               this,
+               false) {
+    m_engine.setSourceManager(&context.get_source_manager());
+    m_engine.SetArgToStringFn(&clang::FormatASTNodeDiagnosticArgument,
+                              context.get_ast_context());
+}
+
+void KnightDiagnosticBuffer::HandleDiagnostic(
+    clang::DiagnosticsEngine::Level diag_level,
+    const clang::Diagnostic& diagnostic) {
+    DiagnosticConsumer::HandleDiagnostic(diag_level, diagnostic);
+    m_diags.emplace_back(diag_level, diagnostic);
+}
+
+clang::DiagnosticBuilder KnightDiagnosticBuffer::report(
+    llvm::StringRef checker,
+    clang::SourceLocation loc,
+    llvm::StringRef fmt,
+    clang::DiagnosticIDs::Level diag_level) {
+    const unsigned custom_diag_id =
+        m_engine.getDiagnosticIDs()->getCustomDiagID(diag_level, fmt);
+
+    m_diag_id_to_checker_name[custom_diag_id] = checker;
+    return m_engine.Report(loc, custom_diag_id);
+}
+
+void KnightDiagnosticBuffer::add(
+    llvm::StringRef checker,
+    clang::DiagnosticsEngine::Level diag_level,
+    llvm::StringRef fmt,
+    llvm::StringRef message,
+    clang::FullSourceLoc loc,
+    llvm::ArrayRef< clang::CharSourceRange > ranges) {
+    const unsigned custom_diag_id =
+        m_engine.getDiagnosticIDs()->getCustomDiagID(
+            static_cast< clang::DiagnosticIDs::Level >(diag_level), fmt);
+
+    m_diag_id_to_checker_name[custom_diag_id] = checker;
+    m_diags.emplace_back(diag_level,
+                         custom_diag_id,
+                         message,
+                         loc,
+                         ranges,
+                         llvm::ArrayRef< clang::FixItHint >());
+}
+
+llvm::StringRef KnightDiagnosticBuffer::get_checker_name(
+    const clang::StoredDiagnostic& diag) const {
+    auto it = m_diag_id_to_checker_name.find(diag.getID());
+    if (it == m_diag_id_to_checker_name.end()) {
+        return "";
+    }
+    return it->second;
+}
+
+llvm::StringRef KnightDiagnosticBuffer::get_format(
+    const clang::StoredDiagnostic& diag) const {
+    return m_engine.getDiagnosticIDs()->getDescription(diag.getID());
+}
+
+void KnightDiagnosticBuffer::replay(KnightTUContext& context) {
+    auto* diag_engine = context.get_diagnostic_engine();
+    knight_assert_msg(diag_engine != nullptr, "diagnostic engine is null");
+
+    for (const auto& diag : m_diags) {
+        // Custom diagnostic IDs are private to the buffer engine, so
+        // they need to be recreated in the main engine.
+        auto fmt = m_engine.getDiagnosticIDs()->getDescription(diag.getID());
+        const auto level =
+            static_cast< clang::DiagnosticIDs::Level >(diag.getLevel());
+        const unsigned diag_id =
+            diag_engine->getDiagnosticIDs()->getCustomDiagID(level, fmt);
+
+        auto it = m_diag_id_to_checker_name.find(diag.getID());
+        if (it != m_diag_id_to_checker_name.end()) {
+            context.m_diag_id_to_checker_name[diag_id] = it->second;
+        }
+
+        diag_engine->Report(clang::StoredDiagnostic(diag.getLevel(),
+                                                    diag_id,
+                                                    diag.getMessage(),
+                                                    diag.getLocation(),
+                                                    diag.getRanges(),
+                                                    diag.getFixIts()));
+    }
+    m_diags.clear();
+}
+
 void KnightDiagnosticRenderer::emitDiagnosticMessage(
     clang::FullSourceLoc loc,
     [[maybe_unused]] clang::PresumedLoc ploc,
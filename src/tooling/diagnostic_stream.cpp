@@ -0,0 +1,80 @@
+//===- diagnostic_stream.cpp ------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the stream of the diagnostics of the translation
+//  units.
+//
+//===------------------------------------------------------------------===//
+
+#include "tooling/diagnostic_stream.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace knight {
+
+DiagnosticStream::DiagnosticStream(llvm::ArrayRef< std::string > input_files,
+                                   Handler handler)
+    : m_handler(std::move(handler)), m_pending(input_files.size()) {
+    for (std::size_t idx = 0U; idx < input_files.size(); ++idx) {
+        m_file_indices.try_emplace(input_files[idx], idx);
+    }
+}
+
+void DiagnosticStream::complete(llvm::StringRef file,
+                                std::vector< KnightDiagnostic > diags) {
+    sort_and_dedup_diags(diags);
+
+    const std::lock_guard lock(m_mutex);
+    auto it = m_file_indices.find(file);
+    // The files out of the inputs and the ones with several compile
+    // commands, which are already emitted, do not wait.
+    if (it == m_file_indices.end() || it->second < m_next) {
+        if (!diags.empty()) {
+            m_handler(diags);
+        }
+        return;
+    }
+
+    auto& pending = m_pending[it->second];
+    if (pending.has_value()) {
+        std::move(diags.begin(), diags.end(), std::back_inserter(*pending));
+        sort_and_dedup_diags(*pending);
+    } else {
+        pending = std::move(diags);
+    }
+    flush();
+}
+
+void DiagnosticStream::complete_missing(llvm::ArrayRef< std::string > files) {
+    const std::lock_guard lock(m_mutex);
+    for (const auto& file : files) {
+        auto it = m_file_indices.find(file);
+        if (it != m_file_indices.end() && it->second >= m_next &&
+            !m_pending[it->second].has_value()) {
+            m_pending[it->second].emplace();
+        }
+    }
+    flush();
+}
+
+void DiagnosticStream::flush() {
+    for (; m_next < m_pending.size() && m_pending[m_next].has_value();
+         ++m_next) {
+        auto diags = std::move(*m_pending[m_next]);
+        // Keep the slot completed while releasing the diagnostics.
+        m_pending[m_next].emplace();
+        if (!diags.empty()) {
+            m_handler(diags);
+        }
+    }
+}
+
+} // namespace knight
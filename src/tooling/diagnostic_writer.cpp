@@ -0,0 +1,351 @@
+//===- diagnostic_writer.cpp ------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the writers of the machine-readable diagnostics.
+//
+//===------------------------------------------------------------------===//
+
+#include "tooling/diagnostic_writer.hpp"
+#include "util/binary.hpp"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/WithColor.h>
+
+namespace knight {
+
+namespace {
+
+/// \brief Buffer size of the output, so that the records are written in
+/// large chunks.
+constexpr std::size_t OutputBufferSize = 1U << 20U;
+
+constexpr llvm::StringLiteral SarifSchema =
+    "https://json.schemastore.org/sarif-2.1.0.json";
+
+llvm::StringRef get_sarif_level(KnightDiagnostic::Level level) {
+    switch (level) {
+        case KnightDiagnostic::Error:
+            return "error";
+        case KnightDiagnostic::Remark:
+            return "note";
+        default:
+            return "warning";
+    }
+}
+
+/// \brief Get the URI of the file, relative to the build directory
+/// unless absolute.
+std::string get_file_uri(llvm::StringRef file, llvm::StringRef build_dir) {
+    llvm::SmallString< 256 > path(file);
+    if (!llvm::sys::path::is_absolute(path) && !build_dir.empty()) {
+        path = build_dir;
+        llvm::sys::path::append(path, file);
+    }
+    llvm::sys::path::remove_dots(path, /*remove_dot_dot=*/true);
+    llvm::sys::path::native(path, llvm::sys::path::Style::posix);
+    if (!llvm::sys::path::is_absolute(path, llvm::sys::path::Style::posix)) {
+        return std::string(path);
+    }
+    return "file://" + std::string(path);
+}
+
+void write_sarif_location(llvm::json::OStream& json,
+                          llvm::StringRef file,
+                          unsigned offset,
+                          llvm::StringRef build_dir) {
+    json.attributeObject("physicalLocation", [&] {
+        json.attributeObject("artifactLocation", [&] {
+            json.attribute("uri", get_file_uri(file, build_dir));
+        });
+        json.attributeObject("region",
+                             [&] { json.attribute("byteOffset", offset); });
+    });
+}
+
+void write_sarif_replacement(llvm::json::OStream& json,
+                             const clang::tooling::Replacement& repl) {
+    json.object([&] {
+        json.attributeObject("deletedRegion", [&] {
+            json.attribute("byteOffset", repl.getOffset());
+            json.attribute("byteLength", repl.getLength());
+        });
+        json.attributeObject("insertedContent", [&] {
+            json.attribute("text", repl.getReplacementText());
+        });
+    });
+}
+
+void write_sarif_fixes(llvm::json::OStream& json,
+                       const clang::tooling::DiagnosticMessage& msg,
+                       llvm::StringRef build_dir) {
+    json.attributeArray("fixes", [&] {
+        json.object([&] {
+            json.attributeArray("artifactChanges", [&] {
+                for (const auto& [file, replacements] : msg.Fix) {
+                    json.object([&] {
+                        json.attributeObject("artifactLocation", [&] {
+                            json.attribute("uri",
+                                           get_file_uri(file, build_dir));
+                        });
+                        json.attributeArray("replacements", [&] {
+                            for (const auto& repl : replacements) {
+                                write_sarif_replacement(json, repl);
+                            }
+                        });
+                    });
+                }
+            });
+        });
+    });
+}
+
+void write_binary_message(llvm::raw_ostream& os,
+                          const clang::tooling::DiagnosticMessage& msg) {
+    write_str(os, msg.Message);
+    write_str(os, msg.FilePath);
+    write_u32(os, msg.FileOffset);
+
+    write_u32(os, static_cast< uint32_t >(msg.Ranges.size()));
+    for (const auto& range : msg.Ranges) {
+        write_str(os, range.FilePath);
+        write_u32(os, range.FileOffset);
+        write_u32(os, range.Length);
+    }
+
+    uint32_t fix_cnt = 0U;
+    for (const auto& file_replacements : msg.Fix) {
+        fix_cnt += static_cast< uint32_t >(file_replacements.second.size());
+    }
+    write_u32(os, fix_cnt);
+    for (const auto& [file, replacements] : msg.Fix) {
+        for (const auto& repl : replacements) {
+            write_str(os, file);
+            write_u32(os, repl.getOffset());
+            write_u32(os, repl.getLength());
+            write_str(os, repl.getReplacementText());
+        }
+    }
+}
+
+/// \brief Read a message written by `write_binary_message`.
+///
+/// \return false if the message is truncated or its fixes overlap.
+bool read_binary_message(BinaryReader& reader,
+                         clang::tooling::DiagnosticMessage& msg) {
+    msg.Message = reader.read_str().str();
+    msg.FilePath = reader.read_str().str();
+    msg.FileOffset = reader.read_u32();
+
+    const uint32_t range_cnt = reader.read_u32();
+    for (uint32_t i = 0U; i < range_cnt && !reader.failed(); ++i) {
+        clang::tooling::FileByteRange range;
+        range.FilePath = reader.read_str().str();
+        range.FileOffset = reader.read_u32();
+        range.Length = reader.read_u32();
+        msg.Ranges.push_back(std::move(range));
+    }
+
+    const uint32_t fix_cnt = reader.read_u32();
+    for (uint32_t i = 0U; i < fix_cnt && !reader.failed(); ++i) {
+        const auto file = reader.read_str();
+        const uint32_t offset = reader.read_u32();
+        const uint32_t length = reader.read_u32();
+        const auto text = reader.read_str();
+        if (auto err = msg.Fix[file].add(
+                clang::tooling::Replacement(file, offset, length, text))) {
+            llvm::consumeError(std::move(err));
+            return false;
+        }
+    }
+    return !reader.failed();
+}
+
+} // anonymous namespace
+
+DiagnosticWriter::DiagnosticWriter(std::unique_ptr< llvm::raw_fd_ostream > os)
+    : m_os(std::move(os)) {
+    m_os->SetBufferSize(OutputBufferSize);
+}
+
+std::unique_ptr< DiagnosticWriter > DiagnosticWriter::create(
+    DiagnosticFormat format, llvm::StringRef path) {
+    if (format == DiagnosticFormat::Text) {
+        return nullptr;
+    }
+
+    std::error_code err;
+    auto os = std::make_unique< llvm::raw_fd_ostream >(
+        path,
+        err,
+        format == DiagnosticFormat::Sarif ? llvm::sys::fs::OF_Text
+                                          : llvm::sys::fs::OF_None);
+    if (err) {
+        llvm::WithColor::error() << "cannot write the diagnostics to " << path
+                                 << ": " << err.message() << "\n";
+        return nullptr;
+    }
+    if (format == DiagnosticFormat::Sarif) {
+        return std::make_unique< SarifDiagnosticWriter >(std::move(os));
+    }
+    return std::make_unique< BinaryDiagnosticWriter >(std::move(os));
+}
+
+bool DiagnosticWriter::finish() {
+    m_os->flush();
+    const bool has_error = m_os->has_error();
+    if (has_error) {
+        llvm::WithColor::error() << "cannot write the diagnostics: "
+                                 << m_os->error().message() << "\n";
+        m_os->clear_error();
+    }
+    return !has_error;
+}
+
+SarifDiagnosticWriter::SarifDiagnosticWriter(
+    std::unique_ptr< llvm::raw_fd_ostream > os)
+    : DiagnosticWriter(std::move(os)), m_json(*m_os) {
+    m_json.objectBegin();
+    m_json.attribute("$schema", SarifSchema);
+    m_json.attribute("version", "2.1.0");
+    m_json.attributeBegin("runs");
+    m_json.arrayBegin();
+    m_json.objectBegin();
+    m_json.attributeBegin("results");
+    m_json.arrayBegin();
+}
+
+void SarifDiagnosticWriter::write(const KnightDiagnostic& diagnostic) {
+    const auto& msg = diagnostic.Message;
+    const auto& build_dir = diagnostic.BuildDirectory;
+    m_rules.insert(diagnostic.DiagnosticName);
+
+    m_json.object([&] {
+        m_json.attribute("ruleId", diagnostic.DiagnosticName);
+        m_json.attribute("level", get_sarif_level(diagnostic.DiagLevel));
+        m_json.attributeObject("message",
+                               [&] { m_json.attribute("text", msg.Message); });
+        if (!msg.FilePath.empty()) {
+            m_json.attributeArray("locations", [&] {
+                m_json.object([&] {
+                    write_sarif_location(m_json,
+                                         msg.FilePath,
+                                         msg.FileOffset,
+                                         build_dir);
+                });
+            });
+        }
+        if (!diagnostic.Notes.empty()) {
+            m_json.attributeArray("relatedLocations", [&] {
+                for (const auto& note : diagnostic.Notes) {
+                    m_json.object([&] {
+                        m_json.attributeObject("message", [&] {
+                            m_json.attribute("text", note.Message);
+                        });
+                        if (!note.FilePath.empty()) {
+                            write_sarif_location(m_json,
+                                                 note.FilePath,
+                                                 note.FileOffset,
+                                                 build_dir);
+                        }
+                    });
+                }
+            });
+        }
+        if (!msg.Fix.empty()) {
+            write_sarif_fixes(m_json, msg, build_dir);
+        }
+    });
+}
+
+bool SarifDiagnosticWriter::finish() {
+    m_json.arrayEnd();
+    m_json.attributeEnd();
+    m_json.attributeObject("tool", [&] {
+        m_json.attributeObject("driver", [&] {
+            m_json.attribute("name", "knight");
+            m_json.attributeArray("rules", [&] {
+                for (const auto& rule : m_rules) {
+                    m_json.object([&] { m_json.attribute("id", rule); });
+                }
+            });
+        });
+    });
+    m_json.objectEnd();
+    m_json.arrayEnd();
+    m_json.attributeEnd();
+    m_json.objectEnd();
+    *m_os << "\n";
+    return DiagnosticWriter::finish();
+}
+
+BinaryDiagnosticWriter::BinaryDiagnosticWriter(
+    std::unique_ptr< llvm::raw_fd_ostream > os)
+    : DiagnosticWriter(std::move(os)) {
+    write_u32(*m_os, Magic);
+    write_u32(*m_os, Version);
+}
+
+void BinaryDiagnosticWriter::write(const KnightDiagnostic& diagnostic) {
+    m_record.clear();
+    llvm::raw_string_ostream record_os(m_record);
+    write_u8(record_os, static_cast< uint8_t >(diagnostic.DiagLevel));
+    write_str(record_os, diagnostic.DiagnosticName);
+    write_str(record_os, diagnostic.BuildDirectory);
+    write_binary_message(record_os, diagnostic.Message);
+    write_u32(record_os, static_cast< uint32_t >(diagnostic.Notes.size()));
+    for (const auto& note : diagnostic.Notes) {
+        write_binary_message(record_os, note);
+    }
+    record_os.flush();
+
+    write_u32(*m_os, static_cast< uint32_t >(m_record.size()));
+    *m_os << m_record;
+}
+
+std::optional< std::vector< KnightDiagnostic > > read_binary_diagnostics(
+    llvm::StringRef data) {
+    BinaryReader reader(data);
+    if (reader.read_u32() != BinaryDiagnosticWriter::Magic ||
+        reader.read_u32() != BinaryDiagnosticWriter::Version ||
+        reader.failed()) {
+        return std::nullopt;
+    }
+
+    std::vector< KnightDiagnostic > diagnostics;
+    while (!reader.at_end()) {
+        BinaryReader record(reader.read_bytes(reader.read_u32()));
+        if (reader.failed()) {
+            return std::nullopt;
+        }
+        const auto level =
+            static_cast< KnightDiagnostic::Level >(record.read_u8());
+        const auto name = record.read_str();
+        const auto build_dir = record.read_str();
+        KnightDiagnostic diagnostic(name, level, build_dir);
+        if (!read_binary_message(record, diagnostic.Message)) {
+            return std::nullopt;
+        }
+        const uint32_t note_cnt = record.read_u32();
+        for (uint32_t i = 0U; i < note_cnt && !record.failed(); ++i) {
+            if (!read_binary_message(record,
+                                     diagnostic.Notes.emplace_back())) {
+                return std::nullopt;
+            }
+        }
+        if (record.failed() || !record.at_end()) {
+            return std::nullopt;
+        }
+        diagnostics.push_back(std::move(diagnostic));
+    }
+    return diagnostics;
+}
+
+} // namespace knight
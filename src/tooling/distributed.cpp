@@ -0,0 +1,421 @@
+//===- distributed.cpp ------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the analysis distributed over remote workers.
+//
+//===------------------------------------------------------------------===//
+
+#include "tooling/distributed.hpp"
+#include "tooling/dependency_db.hpp"
+#include "tooling/diagnostic_writer.hpp"
+#include "tooling/knight.hpp"
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/StringSaver.h>
+#include <llvm/Support/WithColor.h>
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <numeric>
+#include <thread>
+
+#include <unistd.h>
+
+namespace knight {
+
+namespace {
+
+std::string join_command(const WorkerCommand& command) {
+    return llvm::join(command, " ");
+}
+
+} // anonymous namespace
+
+std::optional< std::vector< WorkerCommand > > read_worker_commands(
+    llvm::StringRef path) {
+    auto buffer = llvm::MemoryBuffer::getFile(path, /*IsText=*/true);
+    if (!buffer) {
+        llvm::WithColor::error() << "cannot read the workers " << path << ": "
+                                 << buffer.getError().message() << "\n";
+        return std::nullopt;
+    }
+    llvm::SmallVector< llvm::StringRef, 16U > lines;
+    (*buffer)->getBuffer().split(lines, '\n', -1, false);
+
+    std::vector< WorkerCommand > commands;
+    llvm::BumpPtrAllocator allocator;
+    llvm::StringSaver saver(allocator);
+    for (auto line : lines) {
+        line = line.trim();
+        if (line.empty() || line.starts_with("#")) {
+            continue;
+        }
+        llvm::SmallVector< const char*, 8U > args;
+        llvm::cl::TokenizeGNUCommandLine(line, saver, args);
+        commands.emplace_back(args.begin(), args.end());
+    }
+    if (commands.empty()) {
+        llvm::WithColor::error() << "no worker in " << path << "\n";
+        return std::nullopt;
+    }
+    return commands;
+}
+
+std::unique_ptr< llvm::raw_fd_ostream > take_result_stream() {
+    llvm::outs().flush();
+    const int result_fd = ::dup(STDOUT_FILENO);
+    if (result_fd < 0) {
+        return nullptr;
+    }
+    if (::dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        (void)::close(result_fd);
+        return nullptr;
+    }
+    return std::make_unique< llvm::raw_fd_ostream >(result_fd,
+                                                    /*shouldClose=*/true);
+}
+
+bool run_worker(KnightDriver& driver,
+                std::unique_ptr< llvm::raw_fd_ostream > results) {
+    const auto diagnostics = driver.run();
+    BinaryDiagnosticWriter writer(std::move(results));
+    for (const auto& diagnostic : diagnostics) {
+        writer.write(diagnostic);
+    }
+    return writer.finish();
+}
+
+KnightCoordinator::KnightCoordinator(KnightTUContext& ctx,
+                                     std::vector< std::string > input_files,
+                                     std::vector< WorkerCommand > commands,
+                                     std::vector< std::string > worker_options,
+                                     std::vector< std::string > compile_args,
+                                     unsigned timeout)
+    : m_ctx(ctx),
+      m_input_files(std::move(input_files)),
+      m_worker_options(std::move(worker_options)),
+      m_compile_args(std::move(compile_args)),
+      m_timeout(timeout) {
+    for (auto& command : commands) {
+        m_workers.push_back(Worker{std::move(command)});
+    }
+}
+
+std::optional< std::vector< KnightDiagnostic > > KnightCoordinator::run() {
+    create_shards();
+    llvm::outs() << "[*] Distributing " << m_input_files.size()
+                 << " translation units in " << m_shards.size()
+                 << " shards over " << m_workers.size() << " workers\n";
+
+    const auto is_finished = [this] {
+        return llvm::all_of(m_shards, [](const Shard& shard) {
+            return shard.is_done || shard.is_abandoned;
+        });
+    };
+    while (!is_finished()) {
+        bool has_live_worker = false;
+        for (std::size_t i = 0U; i < m_workers.size(); ++i) {
+            if (m_workers[i].run) {
+                poll(i);
+            }
+            if (m_workers[i].is_dead) {
+                continue;
+            }
+            has_live_worker = true;
+            if (!m_workers[i].run) {
+                if (auto picked = pick_shard(i)) {
+                    if (picked->second) {
+                        llvm::outs()
+                            << "[*] Backing up the slowest shard on "
+                            << join_command(m_workers[i].command) << "\n";
+                    }
+                    launch(i, picked->first);
+                }
+            }
+        }
+        if (!has_live_worker) {
+            llvm::WithColor::error() << "no worker left to analyze the "
+                                        "remaining shards\n";
+            return std::nullopt;
+        }
+        std::this_thread::sleep_for(PollInterval);
+    }
+
+    // The backups of the last shards are still running.
+    for (auto& worker : m_workers) {
+        if (worker.run) {
+            kill_run(*worker.run);
+            worker.run.reset();
+        }
+    }
+    if (llvm::any_of(m_shards,
+                     [](const Shard& shard) { return shard.is_abandoned; })) {
+        return std::nullopt;
+    }
+
+    std::vector< KnightDiagnostic > diagnostics;
+    for (auto& shard : m_shards) {
+        std::move(shard.diagnostics.begin(),
+                  shard.diagnostics.end(),
+                  std::back_inserter(diagnostics));
+    }
+    sort_and_dedup_diags(diagnostics);
+    return diagnostics;
+}
+
+void KnightCoordinator::create_shards() {
+    DependencyDatabase dependency_db;
+    const auto& opts = m_ctx.get_current_options();
+    if (!opts.summary_cache_dir.empty()) {
+        dependency_db.load(
+            DependencyDatabase::get_path(opts.summary_cache_dir));
+    }
+
+    std::vector< uint64_t > costs;
+    costs.reserve(m_input_files.size());
+    for (const auto& file : m_input_files) {
+        uint64_t size = 0U;
+        if (auto recorded_size = dependency_db.get_recorded_size(file)) {
+            size = *recorded_size;
+        } else {
+            (void)llvm::sys::fs::file_size(file, size);
+        }
+        costs.push_back(std::max< uint64_t >(size, 1U));
+    }
+
+    // The most costly files are given first to the least loaded shard.
+    std::vector< std::size_t > order(m_input_files.size());
+    std::iota(order.begin(), order.end(), 0U);
+    llvm::stable_sort(order, [&costs](std::size_t lhs, std::size_t rhs) {
+        return costs[lhs] > costs[rhs];
+    });
+    const std::size_t shard_cnt =
+        std::min< std::size_t >(m_input_files.size(),
+                                m_workers.size() * ShardsPerWorker);
+    m_shards.assign(shard_cnt, Shard{});
+    for (const auto idx : order) {
+        auto& shard = *llvm::min_element(m_shards,
+                                         [](const Shard& lhs,
+                                            const Shard& rhs) {
+                                             return lhs.cost < rhs.cost;
+                                         });
+        shard.files.push_back(m_input_files[idx]);
+        shard.cost += costs[idx];
+    }
+    llvm::stable_sort(m_shards, [](const Shard& lhs, const Shard& rhs) {
+        return lhs.cost > rhs.cost;
+    });
+}
+
+std::optional< std::pair< std::size_t, bool > > KnightCoordinator::
+    pick_shard(std::size_t worker_idx) const {
+    std::optional< std::size_t > pending;
+    for (std::size_t i = 0U; i < m_shards.size(); ++i) {
+        const auto& shard = m_shards[i];
+        if (shard.is_done || shard.is_abandoned || shard.running_cnt != 0U) {
+            continue;
+        }
+        if (shard.last_failed_worker != worker_idx) {
+            return std::make_pair(i, false);
+        }
+        if (!pending) {
+            pending = i;
+        }
+    }
+    if (pending) {
+        return std::make_pair(*pending, false);
+    }
+
+    // Back up the shard running for the longest time but once, as the
+    // others are likely still in their first files.
+    std::optional< std::size_t > backup;
+    Clock::time_point backup_start = Clock::time_point::max();
+    for (const auto& worker : m_workers) {
+        if (!worker.run) {
+            continue;
+        }
+        const auto& shard = m_shards[worker.run->shard];
+        if (!shard.is_done && shard.running_cnt == 1U &&
+            worker.run->start < backup_start) {
+            backup = worker.run->shard;
+            backup_start = worker.run->start;
+        }
+    }
+    if (backup) {
+        return std::make_pair(*backup, true);
+    }
+    return std::nullopt;
+}
+
+void KnightCoordinator::launch(std::size_t worker_idx,
+                               std::size_t shard_idx) {
+    auto& worker = m_workers[worker_idx];
+    auto& shard = m_shards[shard_idx];
+
+    llvm::SmallString< 128 > output_path;
+    llvm::SmallString< 128 > log_path;
+    if (llvm::sys::fs::createTemporaryFile("knight-shard",
+                                           "kndg",
+                                           output_path) ||
+        llvm::sys::fs::createTemporaryFile("knight-shard", "log", log_path)) {
+        llvm::WithColor::error() << "cannot create the output of a worker\n";
+        fail_worker(worker_idx);
+        return;
+    }
+
+    std::vector< llvm::StringRef > args(worker.command.begin(),
+                                        worker.command.end());
+    args.insert(args.end(), m_worker_options.begin(), m_worker_options.end());
+    args.emplace_back("--worker");
+    args.insert(args.end(), shard.files.begin(), shard.files.end());
+    args.insert(args.end(), m_compile_args.begin(), m_compile_args.end());
+
+    const auto fail_launch = [&](llvm::StringRef reason) {
+        llvm::WithColor::warning()
+            << "cannot launch the worker " << join_command(worker.command)
+            << ": " << reason << "\n";
+        (void)llvm::sys::fs::remove(output_path);
+        (void)llvm::sys::fs::remove(log_path);
+        fail_worker(worker_idx);
+    };
+    auto program = llvm::sys::findProgramByName(worker.command.front());
+    if (!program) {
+        fail_launch(program.getError().message());
+        return;
+    }
+    // The worker reads nothing and its messages go to its log.
+    const std::array< std::optional< llvm::StringRef >, 3U > redirects = {
+        llvm::StringRef(""),
+        llvm::StringRef(output_path),
+        llvm::StringRef(log_path)};
+    std::string err_msg;
+    bool execution_failed = false;
+    auto process = llvm::sys::ExecuteNoWait(*program,
+                                            args,
+                                            std::nullopt,
+                                            redirects,
+                                            0U,
+                                            &err_msg,
+                                            &execution_failed);
+    if (execution_failed) {
+        fail_launch(err_msg);
+        return;
+    }
+
+    ++shard.running_cnt;
+    worker.run = Run{shard_idx,
+                     process,
+                     std::string(output_path),
+                     std::string(log_path),
+                     Clock::now()};
+}
+
+void KnightCoordinator::poll(std::size_t worker_idx) {
+    auto& run = *m_workers[worker_idx].run;
+    std::string err_msg;
+    const auto waited = llvm::sys::Wait(run.process, 0U, &err_msg);
+    if (waited.Pid != 0) {
+        finish_run(worker_idx,
+                   waited.ReturnCode == 0,
+                   err_msg.empty() ? "exit code " +
+                                         std::to_string(waited.ReturnCode)
+                                   : err_msg);
+        return;
+    }
+
+    // The backup of a done shard is not needed anymore.
+    if (m_shards[run.shard].is_done) {
+        kill_run(run);
+        --m_shards[run.shard].running_cnt;
+        (void)llvm::sys::fs::remove(run.output_path);
+        (void)llvm::sys::fs::remove(run.log_path);
+        m_workers[worker_idx].run.reset();
+        return;
+    }
+    if (m_timeout != 0U &&
+        Clock::now() - run.start >= std::chrono::seconds(m_timeout)) {
+        kill_run(run);
+        finish_run(worker_idx, false, "timed out");
+    }
+}
+
+void KnightCoordinator::finish_run(std::size_t worker_idx,
+                                   bool succeeded,
+                                   llvm::StringRef reason) {
+    auto& worker = m_workers[worker_idx];
+    auto run = std::move(*worker.run);
+    worker.run.reset();
+    auto& shard = m_shards[run.shard];
+    --shard.running_cnt;
+
+    std::optional< std::vector< KnightDiagnostic > > diagnostics;
+    if (succeeded) {
+        if (auto buffer = llvm::MemoryBuffer::getFile(run.output_path)) {
+            diagnostics = read_binary_diagnostics((*buffer)->getBuffer());
+        }
+        if (!diagnostics) {
+            reason = "invalid diagnostics";
+        }
+    }
+    (void)llvm::sys::fs::remove(run.output_path);
+
+    if (diagnostics) {
+        (void)llvm::sys::fs::remove(run.log_path);
+        worker.failures = 0U;
+        if (!shard.is_done) {
+            shard.is_done = true;
+            shard.diagnostics = std::move(*diagnostics);
+            llvm::outs() << "[*] Shard of " << shard.files.size()
+                         << " translation units analyzed by "
+                         << join_command(worker.command) << "\n";
+        }
+        return;
+    }
+
+    llvm::WithColor::warning()
+        << "worker " << join_command(worker.command) << " failed (" << reason
+        << "), see " << run.log_path << "\n";
+    fail_worker(worker_idx);
+    if (shard.is_done || shard.running_cnt != 0U) {
+        return;
+    }
+    shard.last_failed_worker = worker_idx;
+    if (++shard.attempts >= MaxShardAttempts) {
+        shard.is_abandoned = true;
+        llvm::WithColor::error()
+            << "abandoned a shard of " << shard.files.size()
+            << " translation units after " << shard.attempts
+            << " failed attempts, starting with " << shard.files.front()
+            << "\n";
+    }
+}
+
+void KnightCoordinator::fail_worker(std::size_t worker_idx) {
+    auto& worker = m_workers[worker_idx];
+    if (++worker.failures >= MaxWorkerFailures && !worker.is_dead) {
+        worker.is_dead = true;
+        llvm::WithColor::warning()
+            << "not using the worker " << join_command(worker.command)
+            << " anymore after " << worker.failures << " failures\n";
+    }
+}
+
+void KnightCoordinator::kill_run(Run& run) {
+    // Waiting with a timeout kills the process once it expires.
+    (void)llvm::sys::Wait(run.process, 1U);
+}
+
+} // namespace knight
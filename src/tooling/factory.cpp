@@ -36,29 +36,41 @@ void KnightFactory::add_checker_create_fn(dfa::AnalysisID id,
 }
 
 KnightFactory::AnalysisRefs KnightFactory::create_analyses(
-    dfa::AnalysisManager& mgr, KnightContext* context) const {
+    dfa::AnalysisManager& mgr, KnightTUContext* context) const {
     AnalysisRefs analyses;
     const auto& lo = context->get_lang_options();
     for (const auto& [analysis, registry] : m_analysis_registry) {
-        if (m_analysis_mgr.is_analysis_required(analysis.first)) {
-            auto analysis = registry(mgr, *context);
-            analyses.push_back(analysis.get());
-            m_analysis_mgr.enable_analysis(std::move(analysis));
+        if (!m_analysis_mgr.is_analysis_required(analysis.first)) {
+            continue;
         }
+        // Keep the instance enabled by a previous translation unit, along
+        // with its registered callbacks.
+        if (auto enabled = m_analysis_mgr.get_analysis(analysis.first)) {
+            analyses.push_back(*enabled);
+            continue;
+        }
+        auto instance = registry(mgr, *context);
+        analyses.push_back(instance.get());
+        m_analysis_mgr.enable_analysis(std::move(instance));
     }
     return analyses;
 }
 
 KnightFactory::CheckerRefs KnightFactory::create_checkers(
-    dfa::CheckerManager& mgr, KnightContext* context) const {
+    dfa::CheckerManager& mgr, KnightTUContext* context) const {
     CheckerRefs checkers;
     const auto& lo = context->get_lang_options();
     for (const auto& [checker, registry] : m_checker_registry) {
-        if (m_checker_mgr.is_checker_required(checker.first)) {
-            auto checker = registry(mgr, *context);
-            checkers.push_back(checker.get());
-            m_checker_mgr.enable_checker(std::move(checker));
+        if (!m_checker_mgr.is_checker_required(checker.first)) {
+            continue;
+        }
+        if (auto enabled = m_checker_mgr.get_checker(checker.first)) {
+            checkers.push_back(*enabled);
+            continue;
         }
+        auto instance = registry(mgr, *context);
+        checkers.push_back(instance.get());
+        m_checker_mgr.enable_checker(std::move(instance));
     }
     return checkers;
 }
@@ -13,13 +13,64 @@
 
 #include "tooling/knight.hpp"
 #include "dfa/analysis_manager.hpp"
+#include "dfa/engine/call_graph_scheduler.hpp"
+#include "dfa/shared_interner.hpp"
+#include "dfa/summary.hpp"
+#include "tooling/cross_tu.hpp"
 #include "tooling/diagnostic.hpp"
 #include "tooling/factory.hpp"
 #include "tooling/module.hpp"
+#include "tooling/preamble_cache.hpp"
 #include "tooling/reporter.hpp"
+#include "tooling/summary_cache.hpp"
+#include "util/time_trace.hpp"
 #include "util/vfs.hpp"
 
+#include <clang/AST/DeclCXX.h>
+#include <clang/Frontend/ASTUnit.h>
+#include <clang/Lex/PreprocessorOptions.h>
 #include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/WithColor.h>
+#include <llvm/Support/xxhash.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <variant>
+
+#define DEBUG_TYPE "knight" // NOLINT
+
+ALWAYS_ENABLED_STATISTIC(NumSkippedFunctions,
+                         "The number of functions skipped since no analysis "
+                         "nor checker fires in them");
+ALWAYS_ENABLED_STATISTIC(NumFilteredHeaderFunctions,
+                         "The number of functions skipped by the system or "
+                         "header filters");
+ALWAYS_ENABLED_STATISTIC(NumDedupedHeaderFunctions,
+                         "The number of header functions already analyzed "
+                         "by another translation unit of the same "
+                         "configuration");
+ALWAYS_ENABLED_STATISTIC(NumOutlierFunctions,
+                         "The number of functions cut by the outlier time "
+                         "limit");
+ALWAYS_ENABLED_STATISTIC(NumReusedModuleSetups,
+                         "The number of translation units reusing the "
+                         "resolved checkers and analyses");
 
 LLVM_INSTANTIATE_REGISTRY(knight::KnightModuleRegistry); // NOLINT
 
@@ -27,6 +78,46 @@ namespace knight {
 
 namespace {
 
+/// \brief Claim the analysis of a function defined in a header, so that it
+/// is analyzed once per run and configuration instead of once per
+/// including translation unit.
+///
+/// The claims are keyed by the configuration hash of the translation
+/// unit too, so that a unit enabling other checks or options than the
+/// claiming one still analyzes the function, as its diagnostics may
+/// differ. A translation unit analyzed again, e.g. by the server, keeps
+/// the functions it claimed.
+///
+/// \return false if the function is already claimed by another main file
+/// of the same configuration.
+bool claim_header_function(const clang::FunctionDecl* function,
+                           llvm::StringRef main_file,
+                           uint64_t config_hash) {
+    static std::mutex mutex;
+    static llvm::DenseMap< std::pair< uint64_t, uint64_t >, std::string >
+        claimed;
+    const uint64_t hash = get_function_content_hash(function);
+    const std::lock_guard lock(mutex);
+    auto [it, inserted] =
+        claimed.try_emplace({hash, config_hash}, main_file.str());
+    return inserted || it->second == main_file;
+}
+
+/// \brief Check if the stmt or one of its children satisfies the
+/// predicate.
+template < typename Pred >
+bool any_stmt_of(const clang::Stmt* stmt, const Pred& pred) {
+    if (stmt == nullptr) {
+        return false;
+    }
+    if (pred(stmt)) {
+        return true;
+    }
+    return llvm::any_of(stmt->children(), [&pred](const clang::Stmt* child) {
+        return any_stmt_of(child, pred);
+    });
+}
+
 class KnightAction : public clang::ASTFrontendAction {
   public:
     explicit KnightAction(KnightASTConsumerFactory* ast_factory)
@@ -36,6 +127,12 @@ class KnightAction : public clang::ASTFrontendAction {
         return m_ast_factory->create_ast_consumer(ci, file);
     }
 
+  protected:
+    void ExecuteAction() override {
+        const llvm::TimeTraceScope scope("TranslationUnit", getCurrentFile());
+        clang::ASTFrontendAction::ExecuteAction();
+    }
+
   private:
     KnightASTConsumerFactory* m_ast_factory;
 }; // class KnightAction
@@ -43,7 +140,7 @@ class KnightAction : public clang::ASTFrontendAction {
 class KnightActionFactory : public clang::tooling::FrontendActionFactory {
   public:
     explicit KnightActionFactory(
-        KnightContext& ctx,
+        KnightTUContext& ctx,
         std::unique_ptr< dfa::AnalysisManager > external_analysis_manager =
             nullptr,
         std::unique_ptr< dfa::CheckerManager > external_checker_manager =
@@ -55,14 +152,382 @@ class KnightActionFactory : public clang::tooling::FrontendActionFactory {
         return std::make_unique< KnightAction >(&m_ast_factory);
     }
 
+    bool runInvocation(
+        std::shared_ptr< clang::CompilerInvocation > invocation,
+        clang::FileManager* files,
+        std::shared_ptr< clang::PCHContainerOperations > pch_container_ops,
+        clang::DiagnosticConsumer* diag_consumer) override {
+        if (m_preamble_cache != nullptr) {
+            (void)m_preamble_cache->apply(*invocation,
+                                          *files,
+                                          pch_container_ops);
+        }
+        return clang::tooling::FrontendActionFactory::
+            runInvocation(std::move(invocation),
+                          files,
+                          std::move(pch_container_ops),
+                          diag_consumer);
+    }
+
+    /// \brief Load the precompiled preambles of the cache, if any.
+    void set_preamble_cache(PreambleCache* preamble_cache) {
+        m_preamble_cache = preamble_cache;
+    }
+
   private:
     KnightASTConsumerFactory m_ast_factory;
+    PreambleCache* m_preamble_cache = nullptr;
 }; // class KnightActionFactory
 
+/// \brief Analysis environment owned by one worker of the function
+/// scheduler.
+///
+/// Each worker has its own context, allocator, managers and instances of
+/// analyses and checkers, so that no mutable analysis state is shared by
+/// threads. The regions and symbols are only shared through the interner
+/// of the translation unit, if any. The AST context of the translation
+/// unit is shared too, hence its queries filling lazy caches are
+/// serialized by `dfa::ASTLock`.
+class KnightAnalysisWorker {
+  private:
+    std::unique_ptr< KnightTUContext > m_ctx;
+    llvm::BumpPtrAllocator m_allocator;
+    KnightASTConsumerFactory m_factory;
+    KnightFactory::CheckerRefs m_checkers;
+    KnightFactory::AnalysisRefs m_analyses;
+
+  public:
+    explicit KnightAnalysisWorker(const KnightTUContext& ctx,
+                                  dfa::SharedInterner* interner = nullptr)
+        : m_ctx(ctx.fork()),
+          m_factory(*m_ctx,
+                    std::make_unique< dfa::AnalysisManager >(*m_ctx,
+                                                             m_allocator,
+                                                             interner)) {
+        std::tie(m_checkers, m_analyses) =
+            m_factory.create_checkers_and_analyses();
+    }
+
+    /// \brief Report the diagnostics of the next functions into the
+    /// buffer.
+    void set_diagnostic_buffer(KnightDiagnosticBuffer* buffer) {
+        m_ctx->set_diagnostic_buffer(buffer);
+    }
+
+    dfa::FunctionSummary analyze(const dfa::StackFrame* frame,
+                                 dfa::SummaryTable* summaries = nullptr,
+                                 unsigned time_limit_ms = 0U) {
+        return KnightASTConsumer::
+            analyze_function(*m_ctx,
+                             m_factory.get_analysis_manager(),
+                             m_factory.get_checker_manager(),
+                             frame,
+                             summaries,
+                             time_limit_ms);
+    }
+}; // class KnightAnalysisWorker
+
+/// \brief Report the diagnostics from their build directories.
+///
+/// The diagnostics are batched by build directory and then by file, in
+/// their order otherwise, so that the working directory is switched once
+/// per directory and the source buffer of each file is scanned in a row.
+void report_diagnostics(DiagnosticReporter& reporter,
+                        llvm::ArrayRef< KnightDiagnostic > diagnostics) {
+    auto& vfs =
+        reporter.get_source_manager().getFileManager().getVirtualFileSystem();
+    auto origin_cwd = vfs.getCurrentWorkingDirectory();
+    knight_assert_msg(origin_cwd, "failed to get current working directory");
+
+    std::vector< const KnightDiagnostic* > batched;
+    batched.reserve(diagnostics.size());
+    for (const auto& diagnostic : diagnostics) {
+        batched.push_back(&diagnostic);
+    }
+    std::stable_sort(batched.begin(),
+                     batched.end(),
+                     [](const auto* lhs, const auto* rhs) {
+                         return std::tie(lhs->BuildDirectory,
+                                         lhs->Message.FilePath) <
+                                std::tie(rhs->BuildDirectory,
+                                         rhs->Message.FilePath);
+                     });
+
+    const std::string* build_dir = nullptr;
+    for (const auto* diagnostic : batched) {
+        if (build_dir == nullptr || *build_dir != diagnostic->BuildDirectory) {
+            build_dir = &diagnostic->BuildDirectory;
+            (void)vfs.setCurrentWorkingDirectory(
+                build_dir->empty() ? *origin_cwd : *build_dir);
+        }
+        reporter.report(*diagnostic);
+    }
+    (void)vfs.setCurrentWorkingDirectory(*origin_cwd);
+}
+
 } // anonymous namespace
 
+bool KnightASTConsumer::should_analyze(const clang::FunctionDecl* function) {
+    const auto& opts = m_ctx.get_current_options();
+    const auto& source_mgr = m_ctx.get_source_manager();
+    const auto loc = source_mgr.getFileLoc(function->getLocation());
+    const bool is_in_header = !source_mgr.isInMainFile(loc);
+    if (is_in_header) {
+        if ((!opts.system_headers && source_mgr.isInSystemHeader(loc)) ||
+            !m_ctx.is_header_analyzed(source_mgr.getFilename(loc))) {
+            ++NumFilteredHeaderFunctions;
+            return false;
+        }
+    }
+
+    // Skip building the CFG of the functions where no analysis nor
+    // checker may fire.
+    if (!opts.view_cfg && !opts.dump_cfg && !has_relevant_stmts(function)) {
+        return false;
+    }
+
+    // The inline functions of the headers are defined by every including
+    // translation unit.
+    if (is_in_header &&
+        !claim_header_function(function,
+                               m_ctx.get_current_file(),
+                               m_config_hash)) {
+        ++NumDedupedHeaderFunctions;
+        return false;
+    }
+    return true;
+}
+
+bool KnightASTConsumer::has_relevant_stmts(
+    const clang::FunctionDecl* function) const {
+    if (m_analysis_manager.has_function_analyses() ||
+        m_checker_manager.has_function_checkers()) {
+        return true;
+    }
+
+    // The dispatch tables are indexed by stmt class, so that each class is
+    // only matched once.
+    auto is_relevant = [this](const clang::Stmt* stmt) {
+        using dfa::internal::CheckStmtKind;
+        return m_analysis_manager.has_analyses_for_stmt(stmt) ||
+               m_checker_manager.has_checkers_for_stmt(stmt,
+                                                       CheckStmtKind::Pre) ||
+               m_checker_manager.has_checkers_for_stmt(stmt,
+                                                       CheckStmtKind::Post);
+    };
+    if (any_stmt_of(function->getBody(), is_relevant)) {
+        return true;
+    }
+    if (const auto* ctor = llvm::dyn_cast< clang::CXXConstructorDecl >(
+            function)) {
+        for (const auto* init : ctor->inits()) {
+            if (any_stmt_of(init->getInit(), is_relevant)) {
+                return true;
+            }
+        }
+    }
+    ++NumSkippedFunctions;
+    return false;
+}
+
+void KnightASTConsumer::HandleTranslationUnit(clang::ASTContext& ast_ctx) {
+    if (auto* dependency_db = m_ctx.get_dependency_database()) {
+        dependency_db->record(m_ctx.get_current_file(),
+                              m_config_hash,
+                              m_ctx.get_source_manager(),
+                              m_ctx.get_cuurent_build_dir());
+    }
+    if (m_uses_preamble) {
+        // Creating the frames may deserialize more decls, hence the
+        // functions of the preamble are collected first.
+        std::vector< clang::Decl* > preamble_functions;
+        for (auto* decl : ast_ctx.getTranslationUnitDecl()->decls()) {
+            const auto* function = llvm::dyn_cast< clang::FunctionDecl >(decl);
+            if (function != nullptr && function->isFromASTFile() &&
+                function->doesThisDeclarationHaveABody()) {
+                preamble_functions.push_back(decl);
+            }
+        }
+        for (auto* decl : preamble_functions) {
+            (void)HandleTopLevelDecl(clang::DeclGroupRef(decl));
+        }
+    }
+    if (m_pending_frames.empty()) {
+        return;
+    }
+
+    if (m_ctu_importer != nullptr) {
+        for (const auto* frame : m_pending_frames) {
+            if (const auto* function = llvm::dyn_cast< clang::FunctionDecl >(
+                    frame->get_decl())) {
+                m_ctu_importer->import_callees(
+                    function,
+                    m_ctx.get_current_options().max_inline_depth);
+            }
+        }
+    }
+
+    auto strategy = llvm::hardware_concurrency(
+        m_ctx.get_current_options().analysis_threads);
+    const std::size_t frame_cnt = m_pending_frames.size();
+    const std::size_t worker_cnt =
+        std::min< std::size_t >(strategy.compute_thread_count(), frame_cnt);
+
+    // The interner outlives the workers, whose regions and symbols it
+    // holds.
+    std::unique_ptr< dfa::SharedInterner > interner;
+    if (m_ctx.get_current_options().shared_interning) {
+        interner = std::make_unique< dfa::SharedInterner >(ast_ctx);
+    }
+
+    // Workers are set up on the main thread, since enabling checkers and
+    // analyses queries the glob matchers of the context.
+    std::vector< std::unique_ptr< KnightAnalysisWorker > > workers;
+    workers.reserve(worker_cnt);
+    for (std::size_t i = 0U; i < worker_cnt; ++i) {
+        workers.push_back(
+            std::make_unique< KnightAnalysisWorker >(m_ctx, interner.get()));
+    }
+
+    // The costliest functions are dispatched first, so that a giant
+    // function does not start last and decide the latency alone. The
+    // outliers far above the others are cut by their own time limit.
+    const auto& opts = m_ctx.get_current_options();
+    std::vector< dfa::FunctionCost > costs;
+    costs.reserve(frame_cnt);
+    for (const auto* frame : m_pending_frames) {
+        costs.push_back(dfa::estimate_function_cost(frame));
+    }
+    const uint64_t outlier_cost = dfa::get_outlier_cost(costs);
+    auto get_time_limit = [&](std::size_t idx) -> unsigned {
+        if (opts.outlier_time_limit == 0U ||
+            costs[idx].predicted <= outlier_cost) {
+            return 0U;
+        }
+        ++NumOutlierFunctions;
+        return opts.function_time_limit == 0U
+                   ? opts.outlier_time_limit
+                   : std::min(opts.function_time_limit,
+                              opts.outlier_time_limit);
+    };
+
+    std::vector< std::unique_ptr< KnightDiagnosticBuffer > > diag_buffers;
+    diag_buffers.reserve(frame_cnt);
+    for (std::size_t i = 0U; i < frame_cnt; ++i) {
+        diag_buffers.push_back(
+            std::make_unique< KnightDiagnosticBuffer >(m_ctx));
+    }
+
+    // The functions hitting the cache replay their diagnostics into their
+    // buffers instead of being analyzed.
+    std::unique_ptr< SummaryCache > cache;
+    if (!opts.summary_cache_dir.empty()) {
+        if (auto err =
+                llvm::sys::fs::create_directories(opts.summary_cache_dir)) {
+            llvm::WithColor::warning()
+                << "cannot create the summary cache '"
+                << opts.summary_cache_dir << "': " << err.message() << "\n";
+        } else {
+            cache = SummaryCache::open(
+                SummaryCache::get_store_path(opts.summary_cache_dir,
+                                             m_ctx.get_current_file()));
+        }
+    }
+    auto& source_mgr = m_ctx.get_source_manager();
+    auto analyze = [&](KnightAnalysisWorker& worker,
+                       std::size_t idx,
+                       dfa::SummaryTable* summaries) {
+        const auto* frame = m_pending_frames[idx];
+        const unsigned time_limit = get_time_limit(idx);
+        worker.set_diagnostic_buffer(diag_buffers[idx].get());
+        const auto* function =
+            llvm::dyn_cast< clang::FunctionDecl >(frame->get_decl());
+        if (cache == nullptr || function == nullptr ||
+            !SummaryCache::is_cacheable(function)) {
+            worker.analyze(frame, summaries, time_limit);
+            return;
+        }
+
+        const auto key = SummaryCache::compute_key(function,
+                                                   m_config_hash,
+                                                   summaries,
+                                                   opts.max_inline_depth);
+        if (auto cached = cache->lookup(key)) {
+            SummaryCache::replay(function,
+                                 *cached,
+                                 *diag_buffers[idx],
+                                 source_mgr);
+            if (summaries != nullptr) {
+                summaries->set(function, cached->summary);
+            }
+            return;
+        }
+
+        auto summary = worker.analyze(frame, summaries, time_limit);
+        // A function cut by the time limit depends on the machine load.
+        if (summary.is_degraded &&
+            (opts.function_time_limit != 0U || time_limit != 0U)) {
+            return;
+        }
+        if (auto captured = SummaryCache::capture(function,
+                                                  summary,
+                                                  *diag_buffers[idx],
+                                                  source_mgr)) {
+            cache->insert(key, *captured);
+        }
+    };
+
+    llvm::ThreadPool pool(strategy);
+    if (opts.interprocedural) {
+        // Idle workers keep resuming the next task whose callees are all
+        // summarized, until all of them are analyzed.
+        dfa::SummaryTable summaries;
+        std::vector< uint64_t > predicted;
+        predicted.reserve(frame_cnt);
+        for (const auto& cost : costs) {
+            predicted.push_back(cost.predicted);
+        }
+        dfa::CallGraphScheduler scheduler(m_pending_frames, predicted);
+        for (auto& worker : workers) {
+            pool.async([&, worker = worker.get()] {
+                const TimeTraceThread trace_thread;
+                scheduler.run_worker([&](std::size_t idx) {
+                    analyze(*worker, idx, &summaries);
+                });
+            });
+        }
+        pool.wait();
+    } else {
+        // Idle workers keep pulling the costliest pending function until
+        // all of them are analyzed.
+        std::vector< std::size_t > order(frame_cnt);
+        std::iota(order.begin(), order.end(), 0U);
+        llvm::stable_sort(order, [&costs](std::size_t lhs, std::size_t rhs) {
+            return costs[lhs].predicted > costs[rhs].predicted;
+        });
+        std::atomic< std::size_t > next_frame{0U};
+        for (auto& worker : workers) {
+            pool.async([&, worker = worker.get()] {
+                const TimeTraceThread trace_thread;
+                for (std::size_t pos = next_frame++; pos < frame_cnt;
+                     pos = next_frame++) {
+                    analyze(*worker, order[pos], nullptr);
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    // Replay by the source order of functions, so that the output does
+    // not depend on the scheduling.
+    for (auto& diag_buffer : diag_buffers) {
+        diag_buffer->replay(m_ctx);
+    }
+    m_pending_frames.clear();
+}
+
 KnightASTConsumerFactory::KnightASTConsumerFactory(
-    KnightContext& ctx,
+    KnightTUContext& ctx,
     std::unique_ptr< dfa::AnalysisManager > external_analysis_manager,
     std::unique_ptr< dfa::CheckerManager > external_checker_manager)
     : m_ctx(ctx) {
@@ -87,15 +552,59 @@ KnightASTConsumerFactory::KnightASTConsumerFactory(
 
 std::unique_ptr< clang::ASTConsumer > KnightASTConsumerFactory::
     create_ast_consumer(clang::CompilerInstance& ci, llvm::StringRef file) {
-    auto& source_mgr = ci.getSourceManager();
-    auto& file_mgr = source_mgr.getFileManager();
-    m_ctx.set_current_file(file);
-    m_ctx.set_current_ast_context(&ci.getASTContext());
-
+    auto& file_mgr = ci.getSourceManager().getFileManager();
+    std::string build_dir;
     auto working_dir =
         file_mgr.getVirtualFileSystem().getCurrentWorkingDirectory();
     if (working_dir) {
-        m_ctx.set_current_build_dir(working_dir.get());
+        build_dir = std::move(working_dir.get());
+    }
+
+    auto consumer = create_ast_consumer(ci.getASTContext(), file, build_dir);
+    consumer->set_uses_preamble(
+        ci.getPreprocessorOpts().PrecompiledPreambleBytes.first != 0U);
+    const auto& opts = m_ctx.get_current_options();
+    if (!opts.ctu_dir.empty()) {
+        consumer->set_cross_tu_importer(
+            std::make_unique< CrossTUImporter >(ci,
+                                                fs::make_absolute(
+                                                    opts.ctu_dir),
+                                                opts.ctu_max_loaded_asts));
+    }
+    return consumer;
+}
+
+std::unique_ptr< KnightASTConsumer > KnightASTConsumerFactory::
+    create_ast_consumer(clang::ASTContext& ast_ctx,
+                        llvm::StringRef file,
+                        llvm::StringRef build_dir) {
+    m_ctx.set_current_file(file);
+    m_ctx.set_current_ast_context(&ast_ctx);
+    if (!build_dir.empty()) {
+        m_ctx.set_current_build_dir(build_dir);
+    }
+
+    auto [checkers, analyses] = create_checkers_and_analyses();
+    return std::make_unique< KnightASTConsumer >(m_ctx,
+                                                 *m_analysis_manager,
+                                                 *m_checker_manager,
+                                                 std::move(checkers),
+                                                 std::move(analyses),
+                                                 get_configuration_hash());
+}
+
+std::pair< KnightFactory::CheckerRefs, KnightFactory::AnalysisRefs >
+KnightASTConsumerFactory::create_checkers_and_analyses() {
+    // The enabled checkers and analyses only depend on the filters, whose
+    // matchers are shared by the files of the same filters. The required
+    // sets of the managers only grow, so that their orders and dispatch
+    // tables stay valid for a configuration resolved before.
+    const auto& matchers = m_ctx.get_current_matchers();
+    for (const auto& resolved : m_resolved_modules) {
+        if (resolved.matchers == matchers) {
+            ++NumReusedModuleSetups;
+            return {resolved.checkers, resolved.analyses};
+        }
     }
 
     for (const auto& [id, _] : get_enabled_checks()) {
@@ -115,11 +624,8 @@ std::unique_ptr< clang::ASTConsumer > KnightASTConsumerFactory::
     auto analyses = m_factory->create_analyses(*m_analysis_manager, &m_ctx);
     m_analysis_manager->compute_full_order_analyses_after_registry();
 
-    return std::make_unique< KnightASTConsumer >(m_ctx,
-                                                 *m_analysis_manager,
-                                                 *m_checker_manager,
-                                                 std::move(checkers),
-                                                 std::move(analyses));
+    m_resolved_modules.push_back({matchers, checkers, analyses});
+    return {std::move(checkers), std::move(analyses)};
 }
 
 std::vector< std::pair< dfa::CheckerID, llvm::StringRef > >
@@ -157,52 +663,362 @@ KnightASTConsumerFactory::get_enabled_core_analyses() const {
     return enabled_analyses;
 }
 
+uint64_t KnightASTConsumerFactory::get_configuration_hash() const {
+    std::string config;
+    llvm::raw_string_ostream os(config);
+    os << SummaryCache::Version << ';';
+    for (const auto& [_, name] : get_enabled_checks()) {
+        os << "checker:" << name << ';';
+    }
+    for (const auto& [_, name] : get_directly_enabled_analyses()) {
+        os << "analysis:" << name << ';';
+    }
+    for (const auto& [_, name] : get_enabled_core_analyses()) {
+        os << "core:" << name << ';';
+    }
+#define DOMAIN_DEF(KIND, NAME, ID, DESC) os << "domain:" << NAME << ';';
+#include "dfa/domain/domains.def"
+#undef DOMAIN_DEF
+
+    const auto& opts = m_ctx.get_current_options();
+    os << static_cast< unsigned >(opts.fixpoint_iterator) << ';'
+       << opts.worklist_min_blocks << ';' << opts.widening_delay << ';'
+       << opts.max_narrowing_iterations << ';' << opts.max_loop_iterations
+       << ';' << opts.function_step_limit << ';'
+       << opts.max_memory_per_function << ';' << opts.interprocedural
+       << ';' << opts.max_inline_depth << ';' << opts.numerical_domains
+       << ';' << opts.heap_context_depth << ';' << opts.heap_recency << ';'
+       << opts.max_array_elements << ';' << opts.sparse_analysis << ';'
+       << opts.fold_constant_branches << ';' << opts.trace_partitions
+       << ';';
+    for (const auto& [option, value] : opts.check_opts) {
+        os << option << '=';
+        std::visit([&os](const auto& val) { os << val; }, value);
+        os << ';';
+    }
+    os.flush();
+    return llvm::xxh3_64bits(llvm::arrayRefFromStringRef(config));
+}
+
 std::vector< KnightDiagnostic > KnightDriver::run() {
+    dedup_compile_commands();
+    const auto& opts = m_ctx.get_current_options();
+    if (!opts.ctu_dir.empty() && opts.ctu_build_index) {
+        build_ctu_index();
+    }
+    if (!opts.incremental) {
+        return run_files();
+    }
+    if (opts.summary_cache_dir.empty()) {
+        llvm::WithColor::warning() << "--incremental requires "
+                                      "--summary-cache-dir, analyzing all "
+                                      "the input files\n";
+        return run_files();
+    }
+    if (auto err = llvm::sys::fs::create_directories(opts.summary_cache_dir)) {
+        llvm::WithColor::warning()
+            << "cannot create the summary cache " << opts.summary_cache_dir
+            << ": " << err.message() << ", analyzing all the input files\n";
+        return run_files();
+    }
+
+    // The functions of the invalidated translation units are still looked
+    // up in the summary cache, so that only the changed functions and the
+    // callers whose callee summaries changed are analyzed again.
+    DependencyDatabase dependency_db;
+    const auto db_path = DependencyDatabase::get_path(opts.summary_cache_dir);
+    dependency_db.load(db_path);
+    const auto skipped_files = select_invalidated_files(dependency_db);
+
+    // The skipped translation units report the diagnostics recorded by the
+    // former run, before the analyzed ones if streamed.
+    std::vector< KnightDiagnostic > skipped_diags;
+    for (const auto& file : skipped_files) {
+        auto recorded = dependency_db.get_recorded_diagnostics(file);
+        if (m_diag_handler) {
+            m_diag_handler(recorded);
+        } else {
+            std::move(recorded.begin(),
+                      recorded.end(),
+                      std::back_inserter(skipped_diags));
+        }
+    }
+
+    m_ctx.get_global_context()->set_dependency_database(&dependency_db);
+    auto diags = run_files();
+    m_ctx.get_global_context()->set_dependency_database(nullptr);
+    (void)dependency_db.save(db_path);
+    if (!skipped_diags.empty()) {
+        std::move(skipped_diags.begin(),
+                  skipped_diags.end(),
+                  std::back_inserter(diags));
+        sort_and_dedup_diags(diags);
+    }
+    return diags;
+}
+
+std::vector< std::string > KnightDriver::select_invalidated_files(
+    const DependencyDatabase& dependency_db) {
+    std::optional< llvm::StringSet<> > changed_files;
+    const auto& changed_files_path =
+        m_ctx.get_current_options().changed_files;
+    if (!changed_files_path.empty()) {
+        changed_files = read_changed_files(changed_files_path);
+    }
+
+    // The configuration may depend on the file, as the consumers compute
+    // it for the recorded translation units.
+    const KnightASTConsumerFactory factory(m_ctx);
+    const std::size_t input_cnt = m_input_files.size();
+    std::vector< std::string > skipped_files;
+    llvm::erase_if(m_input_files, [&](const std::string& file) {
+        m_ctx.set_current_file(file);
+        if (dependency_db.is_invalidated(file,
+                                         factory.get_configuration_hash(),
+                                         changed_files)) {
+            return false;
+        }
+        skipped_files.push_back(file);
+        return true;
+    });
+    m_ctx.set_current_file("");
+
+    llvm::outs() << "[*] Incremental analysis: " << m_input_files.size()
+                 << " of " << input_cnt
+                 << " translation units invalidated\n";
+    return skipped_files;
+}
+
+void KnightDriver::dedup_compile_commands() {
+    llvm::StringSet<> seen_files;
+    llvm::erase_if(m_input_files, [&seen_files](const std::string& file) {
+        return !seen_files.insert(file).second;
+    });
+
+    std::size_t command_cnt = 0U;
+    std::size_t deduped_cnt = 0U;
+    for (const auto& file : m_input_files) {
+        command_cnt += m_cdb.get_underlying().getCompileCommands(file).size();
+        deduped_cnt += m_cdb.getCompileCommands(file).size();
+    }
+    if (deduped_cnt < command_cnt) {
+        llvm::outs() << "[*] Deduplicated compile commands: "
+                     << command_cnt - deduped_cnt << " of " << command_cnt
+                     << " equivalent to another one\n";
+    }
+}
+
+void KnightDriver::build_ctu_index() const {
+    const auto ctu_dir = fs::make_absolute(m_ctx.get_current_options().ctu_dir);
+    if (auto err = llvm::sys::fs::create_directories(ctu_dir)) {
+        llvm::WithColor::error() << "cannot create the CTU directory "
+                                 << ctu_dir << ": " << err.message() << "\n";
+        return;
+    }
+
+    // The files are built one by one, so that only one AST is in memory.
+    llvm::StringMap< std::string > index;
+    for (const auto& file : m_input_files) {
+        llvm::outs() << "[*] Building the CTU AST of: " << file << "\n";
+        clang::tooling::ClangTool
+            clang_tool(m_cdb,
+                       {file},
+                       std::make_shared< clang::PCHContainerOperations >(),
+                       fs::create_isolated_vfs(m_base_fs));
+        std::vector< std::unique_ptr< clang::ASTUnit > > units;
+        if (clang_tool.buildASTs(units) != 0) {
+            llvm::WithColor::warning()
+                << "cannot build the CTU AST of " << file << "\n";
+        }
+        for (std::size_t i = 0U; i < units.size(); ++i) {
+            llvm::SmallString< 128 > ast_path(ctu_dir);
+            llvm::sys::path::append(
+                ast_path,
+                llvm::utohexstr(
+                    llvm::xxh3_64bits(llvm::arrayRefFromStringRef(file))) +
+                    "-" + std::to_string(i) + ".ast");
+            // Save returns true on failure.
+            if (units[i]->Save(ast_path)) {
+                llvm::WithColor::warning()
+                    << "cannot save the CTU AST " << ast_path << "\n";
+                continue;
+            }
+            CrossTUImporter::index_ast(*units[i], ast_path, index);
+        }
+    }
+    (void)CrossTUImporter::write_index(ctu_dir, index);
+}
+
+std::vector< KnightDiagnostic > KnightDriver::run_files() {
+    // The stream is created after the incremental selection, so that it
+    // does not wait for the skipped files.
+    std::optional< DiagnosticStream > stream;
+    if (m_diag_handler) {
+        stream.emplace(m_input_files, m_diag_handler);
+    }
+    auto* stream_ptr = stream.has_value() ? &*stream : nullptr;
+
+    const auto& opts = m_ctx.get_current_options();
+    if (!opts.preamble_cache_dir.empty() && m_preamble_cache == nullptr) {
+        m_preamble_cache = std::make_unique< PreambleCache >(
+            fs::make_absolute(opts.preamble_cache_dir));
+    }
+    if (opts.parse_threads > 0U && m_input_files.size() > 1U) {
+        if (opts.ctu_dir.empty()) {
+            return run_pipeline(stream_ptr);
+        }
+        llvm::WithColor::warning() << "--parse-threads is ignored with "
+                                      "--ctu-dir, which imports into the "
+                                      "compiler instances\n";
+    }
+
+    const unsigned tu_threads = opts.tu_threads;
+    if (tu_threads == 1U || m_input_files.size() <= 1U) {
+        return run_shard(m_ctx, m_input_files, m_base_fs, stream_ptr);
+    }
+
+    auto strategy = llvm::hardware_concurrency(tu_threads);
+    const std::size_t shard_cnt =
+        std::min< std::size_t >(strategy.compute_thread_count(),
+                                m_input_files.size());
+
+    std::vector< std::vector< std::string > > shards(shard_cnt);
+    for (std::size_t i = 0U; i < m_input_files.size(); ++i) {
+        shards[i % shard_cnt].push_back(m_input_files[i]);
+    }
+
+    // Each shard has its own context and diagnostic engine, and its own
+    // file system since clang tool changes the working directory.
+    std::vector< std::vector< KnightDiagnostic > > shard_diags(shard_cnt);
+    llvm::ThreadPool pool(strategy);
+    for (std::size_t i = 0U; i < shard_cnt; ++i) {
+        pool.async([this, &shards, &shard_diags, stream_ptr, i] {
+            const TimeTraceThread trace_thread;
+            KnightTUContext shard_ctx(m_ctx.get_global_context());
+            shard_diags[i] = run_shard(shard_ctx,
+                                       shards[i],
+                                       fs::create_isolated_vfs(m_base_fs),
+                                       stream_ptr);
+        });
+    }
+    pool.wait();
+
+    std::vector< KnightDiagnostic > diags;
+    for (auto& diags_of_shard : shard_diags) {
+        std::move(diags_of_shard.begin(),
+                  diags_of_shard.end(),
+                  std::back_inserter(diags));
+    }
+    sort_and_dedup_diags(diags);
+    return diags;
+}
+
+std::vector< KnightDiagnostic > KnightDriver::run_shard(
+    KnightTUContext& ctx,
+    const std::vector< std::string >& input_files,
+    llvm::IntrusiveRefCntPtr< llvm::vfs::OverlayFileSystem > base_fs,
+    DiagnosticStream* stream) const {
     using namespace clang;
     using namespace clang::tooling;
     ClangTool clang_tool(m_cdb,
-                         m_input_files,
+                         input_files,
                          std::make_shared< PCHContainerOperations >(),
-                         m_base_fs);
+                         std::move(base_fs));
 
-    KnightDiagnosticConsumer diag_consumer(m_ctx);
+    KnightDiagnosticConsumer diag_consumer(ctx, stream);
     DiagnosticsEngine diag_engine(new DiagnosticIDs(),
                                   new DiagnosticOptions(),
                                   &diag_consumer,
                                   false);
-    m_ctx.set_diagnostic_engine(&diag_engine);
+    ctx.set_diagnostic_engine(&diag_engine);
     clang_tool.setDiagnosticConsumer(&diag_consumer);
 
-    auto analysis_manager = std::make_unique< dfa::AnalysisManager >(m_ctx);
+    auto analysis_manager = std::make_unique< dfa::AnalysisManager >(ctx);
     auto checker_manager =
-        std::make_unique< dfa::CheckerManager >(m_ctx, *analysis_manager);
+        std::make_unique< dfa::CheckerManager >(ctx, *analysis_manager);
 
-    KnightActionFactory action_factory(m_ctx,
+    KnightActionFactory action_factory(ctx,
                                        std::move(analysis_manager),
                                        std::move(checker_manager));
+    action_factory.set_preamble_cache(m_preamble_cache.get());
     clang_tool.run(&action_factory);
-    return diag_consumer.take_diags();
+    if (stream == nullptr) {
+        return diag_consumer.take_diags();
+    }
+
+    // The diagnostics out of the translation units, e.g. of the files
+    // without compile command, are emitted at once, and the files which
+    // did not finish no longer hold the later ones.
+    stream->complete("", diag_consumer.take_diags());
+    stream->complete_missing(input_files);
+    return {};
+}
+
+std::unique_ptr< DiagnosticWriter > KnightDriver::create_diagnostic_writer(
+    bool try_fix) const {
+    const auto& opts = m_ctx.get_current_options();
+    if (opts.diagnostic_format == DiagnosticFormat::Text) {
+        return nullptr;
+    }
+    if (try_fix) {
+        llvm::WithColor::warning() << "--fix is ignored by the "
+                                      "machine-readable diagnostics, which "
+                                      "contain the fixes\n";
+    }
+    return DiagnosticWriter::create(opts.diagnostic_format,
+                                    opts.diagnostic_output);
 }
 
 void KnightDriver::handle_diagnostics(
     const std::vector< KnightDiagnostic >& diagnostics, bool try_fix) {
+    // The diagnostics are rendered if the writer cannot be created.
+    if (auto writer = create_diagnostic_writer(try_fix)) {
+        for (const auto& diagnostic : diagnostics) {
+            writer->write(diagnostic);
+        }
+        (void)writer->finish();
+        return;
+    }
+
     const FixKind fix = try_fix ? FixKind::FixIt : FixKind::None;
 
     DiagnosticReporter reporter(fix, m_ctx, std::move(m_base_fs));
+    report_diagnostics(reporter, diagnostics);
+    reporter.apply_fixes();
+}
 
-    auto& vfs =
-        reporter.get_source_manager().getFileManager().getVirtualFileSystem();
-    auto origin_cwd = vfs.getCurrentWorkingDirectory();
-    knight_assert_msg(origin_cwd, "failed to get current working directory");
+bool KnightDriver::run_and_report(bool try_fix) {
+    auto writer = create_diagnostic_writer(try_fix);
+    const FixKind fix =
+        try_fix && writer == nullptr ? FixKind::FixIt : FixKind::None;
 
-    for (const auto& diagnostic : diagnostics) {
-        if (!diagnostic.BuildDirectory.empty()) {
-            (void)vfs.setCurrentWorkingDirectory(diagnostic.BuildDirectory);
+    // The reporter has its own file system, since the clang tools change
+    // the working directory of theirs while the diagnostics are reported.
+    DiagnosticReporter reporter(fix, m_ctx, fs::create_isolated_vfs(m_base_fs));
+    bool compile_error_found = false;
+    m_diag_handler = [&](llvm::ArrayRef< KnightDiagnostic > diagnostics) {
+        if (writer != nullptr) {
+            for (const auto& diagnostic : diagnostics) {
+                writer->write(diagnostic);
+            }
+        } else {
+            report_diagnostics(reporter, diagnostics);
         }
-        reporter.report(diagnostic);
-        (void)vfs.setCurrentWorkingDirectory(*origin_cwd);
+        compile_error_found |=
+            llvm::any_of(diagnostics, [](const KnightDiagnostic& diag) {
+                return diag.DiagLevel == KnightDiagnostic::Error;
+            });
+    };
+    (void)run();
+    m_diag_handler = nullptr;
+    if (writer != nullptr) {
+        (void)writer->finish();
     }
+
+    // The fixes are applied at the end, since they rewrite the files which
+    // may still be analyzed.
     reporter.apply_fixes();
+    return compile_error_found;
 }
 
 } // namespace knight
\ No newline at end of file
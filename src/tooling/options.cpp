@@ -1,7 +1,151 @@
 #include "tooling/options.hpp"
 #include "util/assert.hpp"
+#include "util/vfs.hpp"
 
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
 #include <llvm/Support/Process.h>
+#include <llvm/Support/WithColor.h>
+#include <llvm/Support/YAMLTraits.h>
+
+#include <type_traits>
+
+namespace knight {
+
+namespace {
+
+/// \brief The options mapped to a YAML config, with the defaults omitted
+/// from the output.
+struct KnightOptionsConfig {
+    KnightOptions& options;
+    const KnightOptions* defaults;
+}; // struct KnightOptionsConfig
+
+CheckerOptVal parse_checker_opt_val(llvm::StringRef value) {
+    if (value == "true" || value == "false") {
+        return value == "true";
+    }
+    int int_value = 0;
+    if (llvm::to_integer(value, int_value)) {
+        return int_value;
+    }
+    return value.str();
+}
+
+} // anonymous namespace
+
+} // namespace knight
+
+namespace llvm::yaml {
+
+template <>
+struct ScalarEnumerationTraits< knight::FixpointIteratorKind > {
+    static void enumeration(IO& io, knight::FixpointIteratorKind& value) {
+        io.enumCase(value, "auto", knight::FixpointIteratorKind::Auto);
+        io.enumCase(value, "wto", knight::FixpointIteratorKind::Wto);
+        io.enumCase(value, "worklist", knight::FixpointIteratorKind::Worklist);
+    }
+}; // struct ScalarEnumerationTraits< knight::FixpointIteratorKind >
+
+template <>
+struct ScalarEnumerationTraits< knight::DiagnosticFormat > {
+    static void enumeration(IO& io, knight::DiagnosticFormat& value) {
+        io.enumCase(value, "text", knight::DiagnosticFormat::Text);
+        io.enumCase(value, "sarif", knight::DiagnosticFormat::Sarif);
+        io.enumCase(value, "binary", knight::DiagnosticFormat::Binary);
+    }
+}; // struct ScalarEnumerationTraits< knight::DiagnosticFormat >
+
+template <>
+struct CustomMappingTraits< std::map< std::string, knight::CheckerOptVal > > {
+    static void inputOne(IO& io,
+                         StringRef key,
+                         std::map< std::string, knight::CheckerOptVal >& opts) {
+        std::string value;
+        io.mapRequired(key.str().c_str(), value);
+        opts[key.str()] = knight::parse_checker_opt_val(value);
+    }
+
+    static void output(IO& io,
+                       std::map< std::string, knight::CheckerOptVal >& opts) {
+        for (const auto& [key, value] : opts) {
+            std::string str = std::visit(
+                [](const auto& val) -> std::string {
+                    using T = std::decay_t< decltype(val) >;
+                    if constexpr (std::is_same_v< T, bool >) {
+                        return val ? "true" : "false";
+                    } else if constexpr (std::is_same_v< T, int >) {
+                        return std::to_string(val);
+                    } else {
+                        return val;
+                    }
+                },
+                value);
+            io.mapRequired(key.c_str(), str);
+        }
+    }
+}; // struct CustomMappingTraits
+
+template <>
+struct MappingTraits< knight::KnightOptionsConfig > {
+    static void mapping(IO& io, knight::KnightOptionsConfig& config) {
+        auto& options = config.options;
+        const auto* defaults = config.defaults;
+        // The absent keys keep the options on input.
+#define MAP_OPTION(NAME)                                        \
+    if (io.outputting() && defaults != nullptr) {               \
+        io.mapOptional(#NAME, options.NAME, defaults->NAME);    \
+    } else {                                                    \
+        io.mapOptional(#NAME, options.NAME);                    \
+    }
+        MAP_OPTION(checkers)
+        MAP_OPTION(analyses)
+        MAP_OPTION(header_filter)
+        MAP_OPTION(system_headers)
+        MAP_OPTION(stream_diagnostics)
+        MAP_OPTION(diagnostic_format)
+        MAP_OPTION(diagnostic_output)
+        MAP_OPTION(check_opts)
+        MAP_OPTION(analysis_threads)
+        MAP_OPTION(shared_interning)
+        MAP_OPTION(tu_threads)
+        MAP_OPTION(parse_threads)
+        MAP_OPTION(max_live_asts)
+        MAP_OPTION(preamble_cache_dir)
+        MAP_OPTION(fixpoint_iterator)
+        MAP_OPTION(worklist_min_blocks)
+        MAP_OPTION(widening_delay)
+        MAP_OPTION(max_narrowing_iterations)
+        MAP_OPTION(max_loop_iterations)
+        MAP_OPTION(transfer_cache_size)
+        MAP_OPTION(numerical_domains)
+        MAP_OPTION(function_time_limit)
+        MAP_OPTION(function_step_limit)
+        MAP_OPTION(outlier_time_limit)
+        MAP_OPTION(cost_report)
+        MAP_OPTION(max_memory_per_function)
+        MAP_OPTION(interprocedural)
+        MAP_OPTION(max_inline_depth)
+        MAP_OPTION(inline_cache_size)
+        MAP_OPTION(heap_context_depth)
+        MAP_OPTION(heap_recency)
+        MAP_OPTION(max_array_elements)
+        MAP_OPTION(sparse_analysis)
+        MAP_OPTION(fold_constant_branches)
+        MAP_OPTION(trace_partitions)
+        MAP_OPTION(summary_cache_dir)
+        MAP_OPTION(incremental)
+        MAP_OPTION(changed_files)
+        MAP_OPTION(ctu_dir)
+        MAP_OPTION(ctu_build_index)
+        MAP_OPTION(ctu_max_loaded_asts)
+#undef MAP_OPTION
+    }
+}; // struct MappingTraits< knight::KnightOptionsConfig >
+
+} // namespace llvm::yaml
 
 namespace knight {
 
@@ -60,9 +204,98 @@ void KnightOptionsCommandLineProvider::set_checker_option(
     m_cmd_override_opts.insert(option);
 }
 
+bool apply_config(KnightOptions& options,
+                  llvm::StringRef config,
+                  llvm::StringRef config_name) {
+    KnightOptionsConfig mapped{options, nullptr};
+    llvm::yaml::Input input(config);
+    input >> mapped;
+    if (input.error()) {
+        llvm::WithColor::warning() << "invalid config " << config_name << ": "
+                                   << input.error().message() << "\n";
+        return false;
+    }
+    return true;
+}
+
+std::string get_config_diff(const KnightOptions& options,
+                            const KnightOptions& defaults) {
+    auto copy = options;
+    KnightOptionsConfig mapped{copy, &defaults};
+    std::string config;
+    llvm::raw_string_ostream os(config);
+    llvm::yaml::Output output(os);
+    output << mapped;
+    os.flush();
+    return config;
+}
+
 KnightOptionsConfigFileProvider::KnightOptionsConfigFileProvider(
-    [[maybe_unused]] std::string config_file) { // NOLINT
-    // TODO(config): Implement this.
+    std::string config_file)
+    : m_config_file(std::move(config_file)), m_defaults(options) {}
+
+void KnightOptionsConfigFileProvider::set_checker_option(
+    const std::string& option, CheckerOptVal value) {
+    KnightOptionsCommandLineProvider::set_checker_option(option,
+                                                         std::move(value));
+    const std::lock_guard lock(m_mutex);
+    m_dir_options.clear();
+    m_file_options.clear();
+    m_command_line_config.reset();
+}
+
+KnightOptions KnightOptionsConfigFileProvider::get_options_for(
+    const std::string& file) const {
+    llvm::SmallString< 256 > dir;
+    if (m_config_file.empty() && !file.empty()) {
+        dir = llvm::sys::path::parent_path(fs::make_absolute(file));
+    }
+
+    const std::lock_guard lock(m_mutex);
+    auto& file_options = m_file_options[dir];
+    if (file_options == nullptr) {
+        if (!m_command_line_config.has_value()) {
+            m_command_line_config = get_config_diff(options, m_defaults);
+        }
+        auto merged = std::make_shared< KnightOptions >(*get_dir_options(dir));
+        (void)apply_config(*merged, *m_command_line_config, "command line");
+        file_options = std::move(merged);
+    }
+    return *file_options;
+}
+
+std::shared_ptr< const KnightOptions > KnightOptionsConfigFileProvider::
+    get_dir_options(llvm::StringRef dir) const {
+    auto it = m_dir_options.find(dir);
+    if (it != m_dir_options.end()) {
+        return it->second;
+    }
+
+    std::shared_ptr< KnightOptions > merged;
+    llvm::SmallString< 256 > config_path;
+    if (dir.empty()) {
+        // The options out of the configs are the command line ones.
+        merged = std::make_shared< KnightOptions >(options);
+        config_path = m_config_file;
+    } else {
+        auto parent = llvm::sys::path::parent_path(dir);
+        merged = std::make_shared< KnightOptions >(
+            *get_dir_options(parent == dir ? "" : parent));
+        config_path = dir;
+        llvm::sys::path::append(config_path, ConfigFileName);
+    }
+
+    if (!config_path.empty()) {
+        if (auto buffer = llvm::MemoryBuffer::getFile(config_path,
+                                                      /*IsText=*/true)) {
+            (void)apply_config(*merged, (*buffer)->getBuffer(), config_path);
+        } else if (!m_config_file.empty()) {
+            llvm::WithColor::warning()
+                << "cannot read the config " << config_path << ": "
+                << buffer.getError().message() << "\n";
+        }
+    }
+    return m_dir_options[dir] = std::move(merged);
 }
 
 } // namespace knight
\ No newline at end of file
@@ -0,0 +1,320 @@
+//===- perf.cpp -------------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the macro benchmark harness of the knight driver.
+//
+//===------------------------------------------------------------------===//
+
+#include "tooling/perf.hpp"
+#include "tooling/knight.hpp"
+
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/Chrono.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/WithColor.h>
+
+#ifdef LLVM_ON_UNIX
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <utility>
+
+namespace knight {
+
+namespace {
+
+/// \brief The engine statistics counted by each run.
+/// @{
+constexpr llvm::StringLiteral FunctionsStatistic = "NumAnalyzedFunctions";
+constexpr llvm::StringLiteral StmtsStatistic = "NumTransferredStmts";
+constexpr llvm::StringLiteral IterationsStatistic = "NumLoopIterations";
+/// @}
+
+constexpr double BytesPerMegabyte = 1024.0 * 1024.0;
+constexpr double Percent = 100.0;
+
+constexpr std::array< std::pair< llvm::StringLiteral, double PerfSample::* >,
+                      3U >
+    TimeFields{{
+        {"wall_seconds", &PerfSample::wall_seconds},
+        {"user_seconds", &PerfSample::user_seconds},
+        {"sys_seconds", &PerfSample::sys_seconds},
+    }};
+
+constexpr std::array< std::pair< llvm::StringLiteral, uint64_t PerfSample::* >,
+                      4U >
+    CountFields{{
+        {"peak_rss_bytes", &PerfSample::peak_rss_bytes},
+        {"functions", &PerfSample::functions},
+        {"stmts", &PerfSample::stmts},
+        {"iterations", &PerfSample::iterations},
+    }};
+
+/// \brief A measurement printed in the reports and diffs.
+struct PerfMetric {
+    llvm::StringLiteral name;
+    llvm::StringLiteral unit;
+    bool higher_is_better;
+    double (*get)(const PerfSample&);
+}; // struct PerfMetric
+
+double get_rate(uint64_t count, const PerfSample& sample) {
+    return sample.wall_seconds > 0.0
+               ? static_cast< double >(count) / sample.wall_seconds
+               : 0.0;
+}
+
+const std::array< PerfMetric, 7U > PerfMetrics{{
+    {"wall", "s", false, [](const PerfSample& s) { return s.wall_seconds; }},
+    {"user", "s", false, [](const PerfSample& s) { return s.user_seconds; }},
+    {"sys", "s", false, [](const PerfSample& s) { return s.sys_seconds; }},
+    {"peak rss",
+     "MiB",
+     false,
+     [](const PerfSample& s) {
+         return static_cast< double >(s.peak_rss_bytes) / BytesPerMegabyte;
+     }},
+    {"functions",
+     "/s",
+     true,
+     [](const PerfSample& s) { return get_rate(s.functions, s); }},
+    {"stmts",
+     "/s",
+     true,
+     [](const PerfSample& s) { return get_rate(s.stmts, s); }},
+    {"iterations",
+     "/s",
+     true,
+     [](const PerfSample& s) { return get_rate(s.iterations, s); }},
+}};
+
+uint64_t get_peak_rss_bytes() {
+#ifdef LLVM_ON_UNIX
+    struct rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0U;
+    }
+#ifdef __APPLE__
+    return static_cast< uint64_t >(usage.ru_maxrss);
+#else
+    constexpr uint64_t BytesPerKilobyte = 1024U;
+    return static_cast< uint64_t >(usage.ru_maxrss) * BytesPerKilobyte;
+#endif
+#else
+    return 0U;
+#endif
+}
+
+template < typename T >
+T get_median_of(const std::vector< PerfSample >& runs, T PerfSample::*field) {
+    std::vector< T > values;
+    values.reserve(runs.size());
+    for (const auto& run : runs) {
+        values.push_back(run.*field);
+    }
+    auto mid = values.begin() + static_cast< std::ptrdiff_t >(runs.size() / 2);
+    std::nth_element(values.begin(), mid, values.end());
+    return *mid;
+}
+
+void write_sample_json(const PerfSample& sample, llvm::json::OStream& json) {
+    json.object([&] {
+        for (const auto& [name, field] : TimeFields) {
+            json.attribute(name, sample.*field);
+        }
+        for (const auto& [name, field] : CountFields) {
+            json.attribute(name, static_cast< int64_t >(sample.*field));
+        }
+    });
+}
+
+} // anonymous namespace
+
+PerfSample PerfReport::get_median() const {
+    PerfSample median;
+    if (runs.empty()) {
+        return median;
+    }
+    for (const auto& [_, field] : TimeFields) {
+        median.*field = get_median_of(runs, field);
+    }
+    for (const auto& [_, field] : CountFields) {
+        median.*field = get_median_of(runs, field);
+    }
+    return median;
+}
+
+PerfHarness::PerfHarness(
+    KnightTUContext& ctx,
+    const clang::tooling::CompilationDatabase& cdb,
+    std::vector< std::string > input_files,
+    llvm::IntrusiveRefCntPtr< llvm::vfs::OverlayFileSystem > base_fs)
+    : m_ctx(ctx),
+      m_cdb(cdb),
+      m_input_files(std::move(input_files)),
+      m_base_fs(std::move(base_fs)) {
+    // The engine counts are read back from the statistics, which are
+    // only registered once enabled.
+    llvm::EnableStatistics(false);
+}
+
+PerfReport PerfHarness::run(unsigned num_runs) {
+    PerfReport report;
+    report.runs.reserve(num_runs);
+    for (unsigned i = 0U; i < num_runs; ++i) {
+        report.runs.push_back(run_once());
+    }
+    return report;
+}
+
+PerfSample PerfHarness::run_once() {
+    using Clock = std::chrono::steady_clock;
+
+    llvm::ResetStatistics();
+    llvm::sys::TimePoint<> elapsed;
+    std::chrono::nanoseconds user_begin{};
+    std::chrono::nanoseconds sys_begin{};
+    llvm::sys::Process::GetTimeUsage(elapsed, user_begin, sys_begin);
+    const auto wall_begin = Clock::now();
+
+    KnightDriver driver(m_ctx, m_cdb, m_input_files, m_base_fs);
+    (void)driver.run();
+
+    const auto wall_end = Clock::now();
+    std::chrono::nanoseconds user_end{};
+    std::chrono::nanoseconds sys_end{};
+    llvm::sys::Process::GetTimeUsage(elapsed, user_end, sys_end);
+
+    using Seconds = std::chrono::duration< double >;
+    PerfSample sample;
+    sample.wall_seconds = Seconds(wall_end - wall_begin).count();
+    sample.user_seconds = Seconds(user_end - user_begin).count();
+    sample.sys_seconds = Seconds(sys_end - sys_begin).count();
+    sample.peak_rss_bytes = get_peak_rss_bytes();
+    for (const auto& [name, value] : llvm::GetStatistics()) {
+        if (name == FunctionsStatistic) {
+            sample.functions = value;
+        } else if (name == StmtsStatistic) {
+            sample.stmts = value;
+        } else if (name == IterationsStatistic) {
+            sample.iterations = value;
+        }
+    }
+    return sample;
+}
+
+void print_perf_report(const PerfReport& report, llvm::raw_ostream& os) {
+    const auto median = report.get_median();
+    os << "===- knight perf: median of " << report.runs.size() << " run"
+       << (report.runs.size() > 1U ? "s" : "") << " -===\n";
+    for (const auto& metric : PerfMetrics) {
+        os << llvm::format("  %-12s %14.3f %s\n",
+                           metric.name.data(),
+                           metric.get(median),
+                           metric.unit.data());
+    }
+    os << llvm::format("  %-12s %14llu\n",
+                       "#functions",
+                       static_cast< unsigned long long >(median.functions))
+       << llvm::format("  %-12s %14llu\n",
+                       "#stmts",
+                       static_cast< unsigned long long >(median.stmts))
+       << llvm::format("  %-12s %14llu\n",
+                       "#iterations",
+                       static_cast< unsigned long long >(median.iterations));
+}
+
+void write_perf_json(const PerfReport& report, llvm::raw_ostream& os) {
+    llvm::json::OStream json(os, 2);
+    json.object([&] {
+        json.attributeArray("runs", [&] {
+            for (const auto& run : report.runs) {
+                write_sample_json(run, json);
+            }
+        });
+        json.attributeBegin("median");
+        write_sample_json(report.get_median(), json);
+        json.attributeEnd();
+    });
+    os << "\n";
+}
+
+std::optional< PerfSample > read_perf_baseline(llvm::StringRef path) {
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) {
+        llvm::WithColor::error() << "cannot read the perf baseline " << path
+                                 << ": " << buffer.getError().message()
+                                 << "\n";
+        return std::nullopt;
+    }
+    auto value = llvm::json::parse((*buffer)->getBuffer());
+    if (!value) {
+        llvm::WithColor::error()
+            << "invalid perf baseline " << path << ": "
+            << llvm::toString(value.takeError()) << "\n";
+        return std::nullopt;
+    }
+    const auto* root = value->getAsObject();
+    const auto* median =
+        root != nullptr ? root->getObject("median") : nullptr;
+    if (median == nullptr) {
+        llvm::WithColor::error()
+            << "invalid perf baseline " << path << ": no median\n";
+        return std::nullopt;
+    }
+
+    PerfSample sample;
+    for (const auto& [name, field] : TimeFields) {
+        sample.*field = median->getNumber(name).value_or(0.0);
+    }
+    for (const auto& [name, field] : CountFields) {
+        sample.*field =
+            static_cast< uint64_t >(median->getInteger(name).value_or(0));
+    }
+    return sample;
+}
+
+void print_perf_diff(const PerfSample& current,
+                     const PerfSample& baseline,
+                     llvm::raw_ostream& os) {
+    os << "===- knight perf: against the baseline -===\n";
+    for (const auto& metric : PerfMetrics) {
+        const double before = metric.get(baseline);
+        const double after = metric.get(current);
+        os << llvm::format("  %-12s %14.3f -> %14.3f %-4s",
+                           metric.name.data(),
+                           before,
+                           after,
+                           metric.unit.data());
+        if (before == 0.0) {
+            os << "\n";
+            continue;
+        }
+        const double change = (after - before) / before * Percent;
+        const bool better = metric.higher_is_better ? change > 0.0
+                                                    : change < 0.0;
+        os << llvm::format(" %+8.2f%%", change)
+           << (change == 0.0 ? "" : better ? " better" : " worse") << "\n";
+    }
+    if (current.functions != baseline.functions ||
+        current.stmts != baseline.stmts ||
+        current.iterations != baseline.iterations) {
+        llvm::WithColor::warning(os)
+            << "the analyzed work differs from the baseline\n";
+    }
+}
+
+} // namespace knight
@@ -0,0 +1,321 @@
+//===- pipeline.cpp ---------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the pipelined parse and analysis of the
+//  translation units.
+//
+//===------------------------------------------------------------------===//
+
+#include "dfa/profiler.hpp"
+#include "tooling/diagnostic.hpp"
+#include "tooling/knight.hpp"
+#include "tooling/preamble_cache.hpp"
+#include "util/time_trace.hpp"
+#include "util/vfs.hpp"
+
+#include <clang/AST/Decl.h>
+#include <clang/Frontend/ASTUnit.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/WithColor.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace knight {
+
+namespace {
+
+using dfa::ProfileCategory;
+using dfa::Profiler;
+using dfa::ProfileScope;
+
+/// \brief A translation unit parsed ahead of its analysis.
+struct ParsedUnit {
+    std::string file;
+    std::string build_dir;
+    std::unique_ptr< clang::ASTUnit > unit;
+}; // struct ParsedUnit
+
+/// \brief The queue of the parsed units between the parse and the
+/// analysis threads.
+///
+/// A parse thread takes a slot before parsing a unit, which is given back
+/// once the unit is analyzed and released, so that at most the given
+/// number of ASTs are alive.
+class ParsedUnitQueue {
+  private:
+    std::mutex m_mutex;
+    std::condition_variable m_slot_cv;
+    std::condition_variable m_unit_cv;
+    std::deque< ParsedUnit > m_units;
+    unsigned m_free_slots;
+    unsigned m_running_parsers;
+
+    /// \brief Since when the queue has its current depth, for its time
+    /// per depth in the profile.
+    Profiler::Clock::time_point m_depth_since;
+
+  public:
+    ParsedUnitQueue(unsigned max_live_units, unsigned parsers)
+        : m_free_slots(max_live_units),
+          m_running_parsers(parsers),
+          m_depth_since(Profiler::Clock::now()) {}
+
+    /// \brief Wait for a free slot of a unit to parse.
+    void acquire_slot() {
+        const ProfileScope scope(ProfileCategory::Pipeline, "parse-blocked");
+        std::unique_lock lock(m_mutex);
+        m_slot_cv.wait(lock, [this] { return m_free_slots > 0U; });
+        --m_free_slots;
+    }
+
+    /// \brief Give back the slot of a unit released or not parsed.
+    void release_slot() {
+        {
+            const std::lock_guard lock(m_mutex);
+            ++m_free_slots;
+        }
+        m_slot_cv.notify_one();
+    }
+
+    void push(ParsedUnit unit) {
+        {
+            const std::lock_guard lock(m_mutex);
+            record_depth();
+            m_units.push_back(std::move(unit));
+        }
+        m_unit_cv.notify_one();
+    }
+
+    /// \brief Notify that a parse thread has no more units.
+    void finish_parser() {
+        {
+            const std::lock_guard lock(m_mutex);
+            --m_running_parsers;
+        }
+        m_unit_cv.notify_all();
+    }
+
+    /// \brief Wait for the next parsed unit.
+    ///
+    /// \return none once all the units are parsed and taken.
+    std::optional< ParsedUnit > pop() {
+        const ProfileScope scope(ProfileCategory::Pipeline, "analyze-idle");
+        std::unique_lock lock(m_mutex);
+        m_unit_cv.wait(lock, [this] {
+            return !m_units.empty() || m_running_parsers == 0U;
+        });
+        if (m_units.empty()) {
+            return std::nullopt;
+        }
+        record_depth();
+        auto unit = std::move(m_units.front());
+        m_units.pop_front();
+        return unit;
+    }
+
+  private:
+    /// \brief Record the time spent at the current depth, before it
+    /// changes.
+    void record_depth() {
+        if (!Profiler::is_enabled()) {
+            return;
+        }
+        const auto now = Profiler::Clock::now();
+        Profiler::record(ProfileCategory::Pipeline,
+                         "queue-depth-" + std::to_string(m_units.size()),
+                         1U,
+                         now - m_depth_since);
+        m_depth_since = now;
+    }
+}; // class ParsedUnitQueue
+
+/// \brief Parse each compile command of a file into an AST unit pushed to
+/// the queue, with the diagnostics of the parse stored in the unit.
+class ParseAheadAction : public clang::tooling::ToolAction {
+  private:
+    ParsedUnitQueue& m_queue;
+    llvm::StringRef m_file;
+    PreambleCache* m_preamble_cache;
+
+  public:
+    ParseAheadAction(ParsedUnitQueue& queue,
+                     llvm::StringRef file,
+                     PreambleCache* preamble_cache)
+        : m_queue(queue), m_file(file), m_preamble_cache(preamble_cache) {}
+
+    bool runInvocation(
+        std::shared_ptr< clang::CompilerInvocation > invocation,
+        clang::FileManager* files,
+        std::shared_ptr< clang::PCHContainerOperations > pch_container_ops,
+        clang::DiagnosticConsumer* diag_consumer) override {
+        ParsedUnit parsed{m_file.str(), {}, nullptr};
+        auto working_dir =
+            files->getVirtualFileSystem().getCurrentWorkingDirectory();
+        if (working_dir) {
+            parsed.build_dir = std::move(working_dir.get());
+        }
+
+        m_queue.acquire_slot();
+        {
+            const llvm::TimeTraceScope scope("Parse", m_file);
+            const ProfileScope profile_scope(ProfileCategory::Pipeline,
+                                             "parse");
+            if (m_preamble_cache != nullptr) {
+                (void)m_preamble_cache->apply(*invocation,
+                                              *files,
+                                              pch_container_ops);
+            }
+            auto diag_engine = clang::CompilerInstance::createDiagnostics(
+                &invocation->getDiagnosticOpts(), diag_consumer, false);
+            parsed.unit = clang::ASTUnit::LoadFromCompilerInvocation(
+                invocation,
+                std::move(pch_container_ops),
+                diag_engine,
+                files,
+                /*OnlyLocalDecls=*/false,
+                clang::CaptureDiagsKind::All);
+        }
+        if (parsed.unit == nullptr) {
+            m_queue.release_slot();
+            llvm::WithColor::warning() << "cannot parse " << m_file << "\n";
+            return false;
+        }
+        m_queue.push(std::move(parsed));
+        return true;
+    }
+}; // class ParseAheadAction
+
+} // anonymous namespace
+
+void analyze_ast_unit(KnightASTConsumerFactory& ast_factory,
+                      KnightDiagnosticConsumer& diag_consumer,
+                      clang::DiagnosticsEngine& diag_engine,
+                      clang::ASTUnit& unit,
+                      llvm::StringRef file,
+                      llvm::StringRef build_dir) {
+    const llvm::TimeTraceScope scope("TranslationUnit", file);
+    const ProfileScope profile_scope(ProfileCategory::Pipeline, "analyze");
+    auto& ast_ctx = unit.getASTContext();
+
+    diag_consumer.BeginSourceFile(unit.getLangOpts(), &unit.getPreprocessor());
+    auto consumer = ast_factory.create_ast_consumer(ast_ctx, file, build_dir);
+    for (auto it = unit.stored_diag_begin(); it != unit.stored_diag_end();
+         ++it) {
+        diag_engine.Report(*it);
+    }
+
+    for (auto* decl : ast_ctx.getTranslationUnitDecl()->decls()) {
+        (void)consumer->HandleTopLevelDecl(clang::DeclGroupRef(decl));
+    }
+    consumer->HandleTranslationUnit(ast_ctx);
+    consumer.reset();
+    diag_consumer.EndSourceFile();
+}
+
+std::vector< KnightDiagnostic > KnightDriver::run_pipeline(
+    DiagnosticStream* stream) const {
+    const auto& opts = m_ctx.get_current_options();
+    const std::size_t file_cnt = m_input_files.size();
+    const auto parser_cnt = static_cast< unsigned >(std::min< std::size_t >(
+        llvm::hardware_concurrency(opts.parse_threads).compute_thread_count(),
+        file_cnt));
+    const auto analyzer_cnt = static_cast< unsigned >(std::min< std::size_t >(
+        llvm::hardware_concurrency(opts.tu_threads).compute_thread_count(),
+        file_cnt));
+    const unsigned max_live_asts =
+        opts.max_live_asts != 0U ? opts.max_live_asts : 2U * analyzer_cnt;
+
+    ParsedUnitQueue queue(max_live_asts, parser_cnt);
+    std::atomic< std::size_t > next_file{0U};
+    std::vector< std::vector< KnightDiagnostic > > analyzer_diags(
+        analyzer_cnt);
+
+    // Both stages have their own threads, so that the parse threads
+    // blocked on the slots never starve the analysis ones.
+    llvm::ThreadPool pool(
+        llvm::hardware_concurrency(parser_cnt + analyzer_cnt));
+    for (unsigned i = 0U; i < parser_cnt; ++i) {
+        pool.async([this, &queue, &next_file, file_cnt] {
+            const TimeTraceThread trace_thread;
+            // Each file has its own file system since clang tool changes
+            // the working directory.
+            for (auto idx = next_file++; idx < file_cnt; idx = next_file++) {
+                const auto& file = m_input_files[idx];
+                clang::tooling::ClangTool
+                    clang_tool(m_cdb,
+                               {file},
+                               std::make_shared<
+                                   clang::PCHContainerOperations >(),
+                               fs::create_isolated_vfs(m_base_fs));
+                ParseAheadAction action(queue,
+                                        file,
+                                        m_preamble_cache.get());
+                (void)clang_tool.run(&action);
+            }
+            queue.finish_parser();
+        });
+    }
+    for (unsigned i = 0U; i < analyzer_cnt; ++i) {
+        pool.async([this, &queue, &analyzer_diags, stream, i] {
+            using namespace clang;
+            const TimeTraceThread trace_thread;
+            KnightTUContext ctx(m_ctx.get_global_context());
+            KnightDiagnosticConsumer diag_consumer(ctx, stream);
+            DiagnosticsEngine diag_engine(new DiagnosticIDs(),
+                                          new DiagnosticOptions(),
+                                          &diag_consumer,
+                                          false);
+            ctx.set_diagnostic_engine(&diag_engine);
+
+            KnightASTConsumerFactory ast_factory(ctx);
+            while (auto parsed = queue.pop()) {
+                analyze_ast_unit(ast_factory,
+                                 diag_consumer,
+                                 diag_engine,
+                                 *parsed->unit,
+                                 parsed->file,
+                                 parsed->build_dir);
+                parsed.reset();
+                queue.release_slot();
+            }
+            if (stream == nullptr) {
+                analyzer_diags[i] = diag_consumer.take_diags();
+            } else {
+                stream->complete("", diag_consumer.take_diags());
+            }
+        });
+    }
+    pool.wait();
+
+    if (stream != nullptr) {
+        // The files which were not parsed no longer hold the later ones.
+        stream->complete_missing(m_input_files);
+        return {};
+    }
+    std::vector< KnightDiagnostic > diags;
+    for (auto& diags_of_analyzer : analyzer_diags) {
+        std::move(diags_of_analyzer.begin(),
+                  diags_of_analyzer.end(),
+                  std::back_inserter(diags));
+    }
+    sort_and_dedup_diags(diags);
+    return diags;
+}
+
+} // namespace knight
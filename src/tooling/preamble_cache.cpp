@@ -0,0 +1,302 @@
+//===- preamble_cache.cpp ---------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the on-disk cache of the precompiled preambles.
+//
+//===------------------------------------------------------------------===//
+
+#include "tooling/preamble_cache.hpp"
+
+#include <clang/Basic/DiagnosticOptions.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendActions.h>
+#include <clang/Frontend/PrecompiledPreamble.h>
+#include <clang/Frontend/Utils.h>
+#include <clang/Lex/PreprocessorOptions.h>
+#include <llvm/ADT/STLFunctionalExtras.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/WithColor.h>
+#include <llvm/Support/xxhash.h>
+
+#define DEBUG_TYPE "preamble-cache" // NOLINT
+
+ALWAYS_ENABLED_STATISTIC(NumPreambleHits,
+                         "The number of translation units loading a "
+                         "precompiled preamble");
+ALWAYS_ENABLED_STATISTIC(NumPreambleBuilds,
+                         "The number of precompiled preambles built");
+
+namespace knight {
+
+namespace {
+
+/// \brief Collect the headers of the preamble, including the system ones
+/// since the preamble is not validated when loaded.
+class PreambleDependencyCollector : public clang::DependencyCollector {
+  public:
+    bool needSystemDependencies() override { return true; }
+}; // class PreambleDependencyCollector
+
+std::string get_deps_path(llvm::StringRef pch_path) {
+    return (pch_path + ".deps").str();
+}
+
+std::optional< uint64_t > get_content_hash(llvm::vfs::FileSystem& vfs,
+                                           llvm::StringRef path) {
+    auto buffer = vfs.getBufferForFile(path);
+    if (!buffer) {
+        return std::nullopt;
+    }
+    return llvm::xxh3_64bits(
+        llvm::arrayRefFromStringRef((*buffer)->getBuffer()));
+}
+
+/// \brief Get the key of the preamble of the invocation, from what
+/// changes the meaning of its text.
+uint64_t compute_key(const clang::CompilerInvocation& invocation,
+                     llvm::vfs::FileSystem& vfs,
+                     llvm::StringRef main_file,
+                     llvm::StringRef preamble) {
+    // The flags only naming the input and the outputs are the same in the
+    // translation units sharing the preamble.
+    clang::CompilerInvocation flags(invocation);
+    flags.getFrontendOpts().Inputs.clear();
+    flags.getFrontendOpts().OutputFile.clear();
+    flags.getCodeGenOpts().MainFileName.clear();
+    flags.getDependencyOutputOpts() = clang::DependencyOutputOptions();
+
+    std::string content;
+    for (const auto& arg : flags.getCC1CommandLine()) {
+        content += arg;
+        content += '\0';
+    }
+    // The quoted includes are looked up from the directory of the main
+    // file, and the relative paths from the working directory.
+    llvm::SmallString< 256 > main_dir(main_file);
+    (void)vfs.makeAbsolute(main_dir);
+    llvm::sys::path::remove_filename(main_dir);
+    content += main_dir;
+    content += '\0';
+    if (auto working_dir = vfs.getCurrentWorkingDirectory()) {
+        content += *working_dir;
+    }
+    content += '\0';
+    content += preamble;
+    return llvm::xxh3_64bits(llvm::arrayRefFromStringRef(content));
+}
+
+/// \brief Write the file at the path atomically, so that the other runs
+/// sharing the cache never read a partial one.
+bool write_atomically(llvm::StringRef path,
+                      llvm::function_ref< void(llvm::raw_ostream&) > write) {
+    llvm::SmallString< 256 > tmp_path;
+    llvm::sys::fs::createUniquePath(path + "-%%%%%%.tmp", tmp_path, false);
+    {
+        std::error_code err;
+        llvm::raw_fd_ostream os(tmp_path, err, llvm::sys::fs::OF_Text);
+        if (err) {
+            return false;
+        }
+        write(os);
+    }
+    return !llvm::sys::fs::rename(tmp_path, path);
+}
+
+} // anonymous namespace
+
+bool PreambleCache::apply(
+    clang::CompilerInvocation& invocation,
+    clang::FileManager& file_mgr,
+    std::shared_ptr< clang::PCHContainerOperations > pch_container_ops) {
+    auto& pp_opts = invocation.getPreprocessorOpts();
+    const auto& inputs = invocation.getFrontendOpts().Inputs;
+    // The `-include` headers are included again after a PCH, hence the
+    // invocations with them parse their preamble.
+    if (!pp_opts.ImplicitPCHInclude.empty() || !pp_opts.Includes.empty() ||
+        !pp_opts.MacroIncludes.empty() || inputs.size() != 1U ||
+        !inputs.front().isFile()) {
+        return false;
+    }
+    const auto main_file = inputs.front().getFile();
+    auto main_buffer = file_mgr.getBufferForFile(main_file);
+    if (!main_buffer) {
+        return false;
+    }
+    const auto bounds = clang::ComputePreambleBounds(invocation.getLangOpts(),
+                                                     **main_buffer,
+                                                     0U);
+    if (bounds.Size == 0U) {
+        return false;
+    }
+    const auto preamble = (*main_buffer)->getBuffer().take_front(bounds.Size);
+
+    const auto key = compute_key(invocation,
+                                 file_mgr.getVirtualFileSystem(),
+                                 main_file,
+                                 preamble);
+    llvm::SmallString< 256 > pch_path(m_dir);
+    llvm::sys::path::append(pch_path, llvm::utohexstr(key) + ".pch");
+    {
+        auto& entry = get_entry(key);
+        const std::lock_guard< std::mutex > lock(entry.mutex);
+        if (!entry.is_usable) {
+            entry.is_usable = is_up_to_date(pch_path, file_mgr) ||
+                              build(invocation,
+                                    preamble,
+                                    pch_path,
+                                    file_mgr,
+                                    std::move(pch_container_ops));
+        }
+        if (!*entry.is_usable) {
+            return false;
+        }
+    }
+
+    // The headers are validated by their content hashes instead of their
+    // timestamps, which differ between the checkouts.
+    pp_opts.ImplicitPCHInclude = std::string(pch_path);
+    pp_opts.PrecompiledPreambleBytes = {bounds.Size,
+                                        bounds.PreambleEndsAtStartOfLine};
+    pp_opts.DisablePCHOrModuleValidation =
+        clang::DisableValidationForModuleKind::PCH;
+    ++NumPreambleHits;
+    return true;
+}
+
+PreambleCache::Entry& PreambleCache::get_entry(uint64_t key) {
+    const std::lock_guard< std::mutex > lock(m_mutex);
+    auto& entry = m_entries[key];
+    if (entry == nullptr) {
+        entry = std::make_unique< Entry >();
+    }
+    return *entry;
+}
+
+bool PreambleCache::is_up_to_date(llvm::StringRef pch_path,
+                                  clang::FileManager& file_mgr) {
+    if (!llvm::sys::fs::exists(pch_path)) {
+        return false;
+    }
+    auto buffer = llvm::MemoryBuffer::getFile(get_deps_path(pch_path));
+    if (!buffer) {
+        return false;
+    }
+    auto value = llvm::json::parse((*buffer)->getBuffer());
+    if (!value) {
+        llvm::consumeError(value.takeError());
+        return false;
+    }
+    const auto* root = value->getAsObject();
+    const auto* deps = root != nullptr ? root->getArray("deps") : nullptr;
+    if (deps == nullptr) {
+        return false;
+    }
+
+    auto& vfs = file_mgr.getVirtualFileSystem();
+    for (const auto& dep : *deps) {
+        const auto* object = dep.getAsObject();
+        if (object == nullptr) {
+            return false;
+        }
+        auto path = object->getString("path");
+        auto hash = object->getString("hash");
+        if (!path || !hash) {
+            return false;
+        }
+        auto content_hash = get_content_hash(vfs, *path);
+        if (!content_hash || llvm::utohexstr(*content_hash) != *hash) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PreambleCache::build(
+    const clang::CompilerInvocation& invocation,
+    llvm::StringRef preamble,
+    llvm::StringRef pch_path,
+    clang::FileManager& file_mgr,
+    std::shared_ptr< clang::PCHContainerOperations > pch_container_ops) {
+    llvm::SmallString< 256 > dir(pch_path);
+    llvm::sys::path::remove_filename(dir);
+    if (auto err = llvm::sys::fs::create_directories(dir)) {
+        llvm::WithColor::warning()
+            << "cannot create the preamble cache " << dir << ": "
+            << err.message() << "\n";
+        return false;
+    }
+
+    // The PCH is built as the precompiled preambles of clang, from the
+    // main file cut after its preamble.
+    const auto main_file =
+        invocation.getFrontendOpts().Inputs.front().getFile();
+    llvm::SmallString< 256 > tmp_path;
+    llvm::sys::fs::createUniquePath(pch_path + "-%%%%%%.tmp", tmp_path, false);
+    auto pch_invocation =
+        std::make_shared< clang::CompilerInvocation >(invocation);
+    auto& frontend_opts = pch_invocation->getFrontendOpts();
+    frontend_opts.ProgramAction = clang::frontend::GeneratePCH;
+    frontend_opts.OutputFile = std::string(tmp_path);
+    auto& pp_opts = pch_invocation->getPreprocessorOpts();
+    pp_opts.GeneratePreamble = true;
+    pp_opts.PrecompiledPreambleBytes = {0U, false};
+    pp_opts.RetainRemappedFileBuffers = false;
+    pp_opts.addRemappedFile(main_file,
+                            llvm::MemoryBuffer::getMemBufferCopy(preamble,
+                                                                 main_file)
+                                .release());
+    pch_invocation->getDependencyOutputOpts() =
+        clang::DependencyOutputOptions();
+
+    // The file manager of the tool is not shared, since the remapping
+    // overrides its entry of the main file.
+    clang::CompilerInstance ci(std::move(pch_container_ops));
+    ci.setInvocation(pch_invocation);
+    ci.createDiagnostics(new clang::IgnoringDiagConsumer(), true);
+    ci.createFileManager(&file_mgr.getVirtualFileSystem());
+    auto collector = std::make_shared< PreambleDependencyCollector >();
+    ci.addDependencyCollector(collector);
+    clang::GeneratePCHAction action;
+    if (!ci.ExecuteAction(action) || ci.getDiagnostics().hasErrorOccurred()) {
+        (void)llvm::sys::fs::remove(tmp_path);
+        return false;
+    }
+    if (llvm::sys::fs::rename(tmp_path, pch_path)) {
+        (void)llvm::sys::fs::remove(tmp_path);
+        return false;
+    }
+
+    auto& vfs = file_mgr.getVirtualFileSystem();
+    llvm::json::Array deps;
+    for (const auto& path : collector->getDependencies()) {
+        if (path == main_file) {
+            continue;
+        }
+        auto content_hash = get_content_hash(vfs, path);
+        if (!content_hash) {
+            return false;
+        }
+        deps.push_back(llvm::json::Object{
+            {"path", path},
+            {"hash", llvm::utohexstr(*content_hash)}});
+    }
+    ++NumPreambleBuilds;
+    const llvm::json::Value root =
+        llvm::json::Object{{"deps", std::move(deps)}};
+    return write_atomically(get_deps_path(pch_path),
+                            [&root](llvm::raw_ostream& os) { os << root; });
+}
+
+} // namespace knight
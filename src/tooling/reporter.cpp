@@ -21,22 +21,78 @@
 #include <clang/Basic/SourceLocation.h>
 #include <clang/Format/Format.h>
 #include <clang/Frontend/TextDiagnosticPrinter.h>
-#include <clang/Rewrite/Core/Rewriter.h>
 #include <clang/Tooling/Core/Replacement.h>
 #include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/Path.h>
 #include <llvm/Support/Process.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/VirtualFileSystem.h>
 #include <llvm/Support/raw_ostream.h>
 
+#include <string>
+#include <vector>
+
 namespace knight {
 
 namespace {
 
 constexpr unsigned StringMaxLength = 256U;
 
+/// \brief Cleanup, format and apply the replacements of the file, and
+/// write it atomically.
+///
+/// \return the error, or empty if the file is written.
+std::string apply_file_fixes(llvm::vfs::FileSystem& vfs,
+                             llvm::StringRef file,
+                             const clang::tooling::Replacements& replaces) {
+    using namespace clang;
+
+    auto buffer = vfs.getBufferForFile(file);
+    if (!buffer) {
+        return ("error when accessing file: " + file + ": " +
+                buffer.getError().message())
+            .str();
+    }
+    auto code = buffer.get()->getBuffer();
+
+    auto fmt = format::getStyle("none", file, "none");
+    if (!fmt) {
+        return llvm::toString(fmt.takeError());
+    }
+
+    auto cleaned = format::cleanupAroundReplacements(code, replaces, *fmt);
+    if (!cleaned) {
+        return "error when applying replacements: " +
+               llvm::toString(cleaned.takeError());
+    }
+    auto formatted = format::formatReplacements(code, *cleaned, *fmt);
+    if (!formatted) {
+        return "error when formatting replacements: " +
+               llvm::toString(formatted.takeError());
+    }
+    auto new_code = tooling::applyAllReplacements(code, *formatted);
+    if (!new_code) {
+        return "error when applying replacements: " +
+               llvm::toString(new_code.takeError());
+    }
+
+    // The file is written to a temporary one and renamed over it.
+    if (auto err = llvm::writeToOutput(file, [&](llvm::raw_ostream& os) {
+            os << *new_code;
+            return llvm::Error::success();
+        })) {
+        return ("error when writing file: " + file + ": ").str() +
+               llvm::toString(std::move(err));
+    }
+    return {};
+}
+
 } // anonymous namespace
 
 DiagnosticReporter::DiagnosticReporter(FixKind kind,
-                                       KnightContext& ctx,
+                                       KnightTUContext& ctx,
                                        fs::FileSystemRef base_vfs)
     : m_ctx(ctx),
       m_fix_kind(kind),
@@ -82,20 +138,38 @@ const llvm::StringMap< clang::tooling::Replacements >* DiagnosticReporter::
     return res;
 }
 
+clang::FileID DiagnosticReporter::get_file_id(llvm::StringRef file) {
+    // The absolute paths do not depend on the build directory.
+    std::string key;
+    if (!llvm::sys::path::is_absolute(file)) {
+        key = m_build_dir;
+        key.push_back('\0');
+    }
+    key.append(file.begin(), file.end());
+
+    auto [it, inserted] = m_file_ids.try_emplace(key);
+    if (!inserted) {
+        return it->second;
+    }
+    auto file_entry_opt =
+        m_source_manager.getFileManager().getOptionalFileRef(file);
+    if (file_entry_opt) {
+        it->second = m_source_manager.getOrCreateFileID(*file_entry_opt,
+                                                        clang::SrcMgr::C_User);
+    }
+    return it->second;
+}
+
 clang::SourceLocation DiagnosticReporter::get_composed_loc(llvm::StringRef file,
                                                            unsigned offset) {
     if (file.empty()) {
         return {};
     }
 
-    auto file_entry_opt =
-        m_source_manager.getFileManager().getOptionalFileRef(file);
-    if (!file_entry_opt) {
+    auto file_id = get_file_id(file);
+    if (file_id.isInvalid()) {
         return {};
     }
-
-    auto file_id = m_source_manager.getOrCreateFileID(*file_entry_opt,
-                                                      clang::SrcMgr::C_User);
     return m_source_manager.getLocForStartOfFile(file_id).getLocWithOffset(
         static_cast< clang::SourceLocation::IntTy >(offset));
 }
@@ -156,6 +230,7 @@ void DiagnosticReporter::report_note(
 // NOLINTBEGIN(readability-function-cognitive-complexity)
 void DiagnosticReporter::report(const KnightDiagnostic& diagnostic) {
     using namespace clang;
+    m_build_dir = diagnostic.BuildDirectory;
     const auto& msg = diagnostic.Message;
     auto loc = get_composed_loc(msg.FilePath, msg.FileOffset);
 
@@ -200,9 +275,7 @@ void DiagnosticReporter::report(const KnightDiagnostic& diagnostic) {
                                                      replacement
                                                          .getReplacementText());
 
-                        auto& [build_dir, replaces] =
-                            m_file_to_build_dir_and_replaces
-                                [replacement.getFilePath()];
+                        auto& replaces = m_file_to_replaces[abs_path_fix];
 
                         llvm::Error err = replaces.add(replace);
                         if (err) {
@@ -240,7 +313,6 @@ void DiagnosticReporter::report(const KnightDiagnostic& diagnostic) {
                                                    replacement.getOffset());
                         fix_locs.push_back(
                             std::make_pair(fix_loc, can_be_applied));
-                        build_dir = diagnostic.BuildDirectory;
                     }
                 }
             }
@@ -259,63 +331,41 @@ void DiagnosticReporter::report(const KnightDiagnostic& diagnostic) {
 // NOLINTEND(readability-function-cognitive-complexity)
 
 void DiagnosticReporter::apply_fixes() {
-    using namespace clang;
-
     if (m_total_fixes == 0U) {
         return;
     }
 
-    auto& vfs = m_file_manager.getVirtualFileSystem();
-    auto origin_cwd = vfs.getCurrentWorkingDirectory();
+    // The files are keyed by absolute path, so that the workers neither
+    // switch the working directory nor share any source manager.
+    std::vector< std::pair< llvm::StringRef,
+                            const clang::tooling::Replacements* > >
+        files;
+    files.reserve(m_file_to_replaces.size());
+    for (const auto& entry : m_file_to_replaces) {
+        files.emplace_back(entry.first(), &entry.second);
+    }
+    llvm::sort(files, [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    auto vfs = m_file_manager.getVirtualFileSystemPtr();
+    std::vector< std::string > errors(files.size());
+    llvm::ThreadPool pool(llvm::hardware_concurrency());
+    for (std::size_t i = 0U; i < files.size(); ++i) {
+        pool.async([&files, &errors, &vfs, i] {
+            const auto& [file, replaces] = files[i];
+            errors[i] = apply_file_fixes(*vfs, file, *replaces);
+        });
+    }
+    pool.wait();
 
+    // The errors are printed by file order once the workers finished.
     bool any_not_written = false;
-    for (const auto& [file, pair] : m_file_to_build_dir_and_replaces) {
-        const auto& [build_dir, replaces] = pair;
-
-        Rewriter rewriter(m_source_manager, m_lang_opts);
-
-        (void)vfs.setCurrentWorkingDirectory(build_dir);
-
-        auto buffer = m_source_manager.getFileManager().getBufferForFile(file);
-        if (!buffer) {
-            llvm::errs() << "error when accessing file: " << file << ": "
-                         << buffer.getError().message() << "\n";
-            continue;
+    for (const auto& error : errors) {
+        if (!error.empty()) {
+            llvm::errs() << error << "\n";
+            any_not_written = true;
         }
-        auto code = buffer.get()->getBuffer();
-
-        auto fmt = format::getStyle("none", file, "none");
-        if (!fmt) {
-            llvm::errs() << llvm::toString(fmt.takeError()) << "\n";
-            continue;
-        }
-
-        auto replacements_expected =
-            format::cleanupAroundReplacements(code, replaces, *fmt);
-        if (!replacements_expected) {
-            llvm::errs() << "error when applying replacements: "
-                         << llvm::toString(replacements_expected.takeError())
-                         << "\n";
-            continue;
-        }
-
-        if (auto replacements_formatted =
-                format::formatReplacements(code, replaces, *fmt)) {
-            replacements_expected = std::move(replacements_formatted);
-            knight_assert_msg(replacements_expected,
-                              "format replacements failed");
-        } else {
-            llvm::errs() << "error when formatting replacements: "
-                         << llvm::toString(replacements_formatted.takeError())
-                         << "\n";
-            continue;
-        }
-
-        if (!clang::tooling::applyAllReplacements(replacements_expected.get(),
-                                                  rewriter)) {
-            llvm::errs() << "error when applying replacements\n";
-        }
-        any_not_written |= rewriter.overwriteChangedFiles();
     }
 
     if (any_not_written) {
@@ -324,10 +374,6 @@ void DiagnosticReporter::apply_fixes() {
         llvm::outs() << "applied " << m_applied_fixes << " out of "
                      << m_total_fixes << " suggested fixes.\n";
     }
-
-    if (origin_cwd) {
-        (void)vfs.setCurrentWorkingDirectory(*origin_cwd);
-    }
 }
 
 } // namespace knight
\ No newline at end of file
@@ -0,0 +1,379 @@
+//===- server.cpp -----------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the resident server of the analysis requests.
+//
+//===------------------------------------------------------------------===//
+
+#include "tooling/server.hpp"
+#include "tooling/knight.hpp"
+
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/WithColor.h>
+
+#include <array>
+#include <utility>
+
+namespace knight {
+
+namespace {
+
+/// \brief The error codes of JSON-RPC 2.0.
+/// @{
+constexpr int64_t ParseError = -32700;
+constexpr int64_t InvalidRequest = -32600;
+constexpr int64_t MethodNotFound = -32601;
+constexpr int64_t InvalidParams = -32602;
+/// @}
+
+constexpr std::size_t ReadBufferSize = 1U << 16U;
+
+/// \brief Parse each compile command of a file into an AST unit, with the
+/// diagnostics of the parse stored in the unit and a preamble to reparse
+/// it.
+class ServerParseAction : public clang::tooling::ToolAction {
+  public:
+    using Units = std::vector<
+        std::pair< std::string, std::unique_ptr< clang::ASTUnit > > >;
+
+  private:
+    Units& m_units;
+
+  public:
+    explicit ServerParseAction(Units& units) : m_units(units) {}
+
+    bool runInvocation(
+        std::shared_ptr< clang::CompilerInvocation > invocation,
+        clang::FileManager* files,
+        std::shared_ptr< clang::PCHContainerOperations > pch_container_ops,
+        clang::DiagnosticConsumer* diag_consumer) override {
+        std::string build_dir;
+        auto working_dir =
+            files->getVirtualFileSystem().getCurrentWorkingDirectory();
+        if (working_dir) {
+            build_dir = std::move(working_dir.get());
+        }
+
+        auto diag_engine = clang::CompilerInstance::createDiagnostics(
+            &invocation->getDiagnosticOpts(), diag_consumer, false);
+        auto unit = clang::ASTUnit::LoadFromCompilerInvocation(
+            invocation,
+            std::move(pch_container_ops),
+            diag_engine,
+            files,
+            /*OnlyLocalDecls=*/false,
+            clang::CaptureDiagsKind::All,
+            /*PrecompilePreambleAfterNParses=*/1U);
+        if (unit == nullptr) {
+            return false;
+        }
+        m_units.emplace_back(std::move(build_dir), std::move(unit));
+        return true;
+    }
+}; // class ServerParseAction
+
+llvm::StringRef get_level_name(KnightDiagnostic::Level level) {
+    switch (level) {
+        case KnightDiagnostic::Error:
+            return "error";
+        case KnightDiagnostic::Remark:
+            return "remark";
+        default:
+            return "warning";
+    }
+}
+
+llvm::json::Object to_json(const clang::tooling::DiagnosticMessage& msg) {
+    return llvm::json::Object{{"message", msg.Message},
+                              {"file", msg.FilePath},
+                              {"offset", msg.FileOffset}};
+}
+
+llvm::json::Value to_json(const KnightDiagnostic& diagnostic) {
+    auto object = to_json(diagnostic.Message);
+    object["check"] = diagnostic.DiagnosticName;
+    object["level"] = get_level_name(diagnostic.DiagLevel);
+    object["build_dir"] = diagnostic.BuildDirectory;
+    llvm::json::Array notes;
+    for (const auto& note : diagnostic.Notes) {
+        notes.push_back(to_json(note));
+    }
+    object["notes"] = std::move(notes);
+    return object;
+}
+
+llvm::json::Value make_error_response(const llvm::json::Value& id,
+                                      int64_t code,
+                                      llvm::StringRef message) {
+    return llvm::json::Object{
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"error", llvm::json::Object{{"code", code}, {"message", message}}}};
+}
+
+/// \brief Get the absolute paths of the files of the params.
+std::optional< std::vector< std::string > > get_files(
+    const llvm::json::Object* params) {
+    const auto* files = params != nullptr ? params->getArray("files")
+                                          : nullptr;
+    if (files == nullptr) {
+        return std::nullopt;
+    }
+    std::vector< std::string > paths;
+    for (const auto& file : *files) {
+        auto path = file.getAsString();
+        if (!path) {
+            return std::nullopt;
+        }
+        paths.push_back(fs::make_absolute(*path));
+    }
+    return paths;
+}
+
+} // anonymous namespace
+
+KnightServer::KnightServer(KnightTUContext& ctx,
+                           const clang::tooling::CompilationDatabase& cdb,
+                           fs::OverlayFileSystemRef base_fs)
+    : m_ctx(ctx),
+      m_cdb(cdb),
+      m_base_fs(std::move(base_fs)),
+      m_fs_cache(fs::get_file_system_cache(m_base_fs)),
+      m_pch_container_ops(
+          std::make_shared< clang::PCHContainerOperations >()) {
+    m_ctx.get_global_context()->set_dependency_database(&m_dependency_db);
+}
+
+KnightServer::~KnightServer() {
+    m_ctx.get_global_context()->set_dependency_database(nullptr);
+}
+
+bool KnightServer::serve(llvm::StringRef socket_path) {
+    // The socket of a former server which did not shut down is stale.
+    (void)llvm::sys::fs::remove(socket_path);
+    auto socket = llvm::ListeningSocket::createUnix(socket_path);
+    if (!socket) {
+        llvm::WithColor::error()
+            << "cannot listen on " << socket_path << ": "
+            << llvm::toString(socket.takeError()) << "\n";
+        return false;
+    }
+
+    llvm::outs() << "[*] Serving on " << socket_path << "\n";
+    while (!m_shutdown) {
+        auto client = socket->accept();
+        if (!client) {
+            llvm::WithColor::warning()
+                << "cannot accept a client: "
+                << llvm::toString(client.takeError()) << "\n";
+            continue;
+        }
+        serve_client(**client);
+    }
+    socket->shutdown();
+    return true;
+}
+
+void KnightServer::serve_client(llvm::raw_socket_stream& client) {
+    std::array< char, ReadBufferSize > buffer{};
+    std::string pending;
+    while (!m_shutdown) {
+        const auto size = client.read(buffer.data(), buffer.size());
+        if (size <= 0) {
+            return;
+        }
+        pending.append(buffer.data(), static_cast< std::size_t >(size));
+
+        std::size_t begin = 0U;
+        for (auto end = pending.find('\n'); end != std::string::npos;
+             end = pending.find('\n', begin)) {
+            const auto message =
+                llvm::StringRef(pending).slice(begin, end).trim();
+            begin = end + 1U;
+            if (message.empty()) {
+                continue;
+            }
+            if (auto response = handle_message(message)) {
+                client << *response << "\n";
+                client.flush();
+            }
+            if (m_shutdown) {
+                return;
+            }
+        }
+        pending.erase(0U, begin);
+    }
+}
+
+std::optional< llvm::json::Value > KnightServer::handle_message(
+    llvm::StringRef message) {
+    auto request = llvm::json::parse(message);
+    if (!request) {
+        return make_error_response(nullptr,
+                                   ParseError,
+                                   llvm::toString(request.takeError()));
+    }
+    const auto* object = request->getAsObject();
+    if (object == nullptr) {
+        return make_error_response(nullptr, InvalidRequest, "not an object");
+    }
+    // The requests without an ID are notifications, which get no
+    // response.
+    const llvm::json::Value* id = object->get("id");
+    const llvm::json::Value response_id = id != nullptr ? *id : nullptr;
+    auto method = object->getString("method");
+    if (!method) {
+        return make_error_response(response_id, InvalidRequest, "no method");
+    }
+
+    const auto* params = object->getObject("params");
+    llvm::json::Value result = nullptr;
+    if (*method == "analyze" || *method == "invalidate") {
+        auto files = get_files(params);
+        if (!files) {
+            return make_error_response(
+                response_id,
+                InvalidParams,
+                "expected the files as an array of paths");
+        }
+        if (*method == "analyze") {
+            result = analyze(*files);
+        } else {
+            llvm::StringSet<> changed_files;
+            changed_files.insert(files->begin(), files->end());
+            invalidate(changed_files);
+        }
+    } else if (*method == "shutdown") {
+        m_shutdown = true;
+    } else {
+        return make_error_response(response_id,
+                                   MethodNotFound,
+                                   ("unknown method " + *method).str());
+    }
+
+    if (id == nullptr) {
+        return std::nullopt;
+    }
+    return llvm::json::Object{{"jsonrpc", "2.0"},
+                              {"id", response_id},
+                              {"result", std::move(result)}};
+}
+
+llvm::json::Value KnightServer::analyze(llvm::ArrayRef< std::string > files) {
+    using namespace clang;
+    KnightTUContext ctx(m_ctx.get_global_context());
+    KnightDiagnosticConsumer diag_consumer(ctx);
+    DiagnosticsEngine diag_engine(new DiagnosticIDs(),
+                                  new DiagnosticOptions(),
+                                  &diag_consumer,
+                                  false);
+    ctx.set_diagnostic_engine(&diag_engine);
+    KnightASTConsumerFactory ast_factory(ctx);
+    // The edited files are read again by the reparses.
+    if (m_fs_cache != nullptr) {
+        (void)m_fs_cache->invalidate_changed();
+    }
+
+    std::vector< KnightDiagnostic > diags;
+    std::size_t analyzed_cnt = 0U;
+    for (const auto& file : files) {
+        auto& served = m_files[file];
+        // The configuration may depend on the file.
+        ctx.set_current_file(file);
+        const uint64_t config_hash = ast_factory.get_configuration_hash();
+        if (served.is_invalidated ||
+            m_dependency_db.is_invalidated(file, config_hash, std::nullopt)) {
+            analyze_file(file, served, ast_factory, diag_consumer, diag_engine);
+            served.config_hash = config_hash;
+            ++analyzed_cnt;
+        }
+        diags.insert(diags.end(),
+                     served.diagnostics.begin(),
+                     served.diagnostics.end());
+    }
+    sort_and_dedup_diags(diags);
+
+    llvm::json::Array diagnostics;
+    for (const auto& diag : diags) {
+        diagnostics.push_back(to_json(diag));
+    }
+    return llvm::json::Object{
+        {"diagnostics", std::move(diagnostics)},
+        {"analyzed", static_cast< int64_t >(analyzed_cnt)},
+        {"reused", static_cast< int64_t >(files.size() - analyzed_cnt)}};
+}
+
+void KnightServer::invalidate(const llvm::StringSet<>& files) {
+    if (m_fs_cache != nullptr) {
+        for (const auto& file : files) {
+            m_fs_cache->invalidate(file.getKey());
+        }
+    }
+    for (auto& [file, served] : m_files) {
+        served.is_invalidated |=
+            m_dependency_db.is_invalidated(file, served.config_hash, files);
+    }
+}
+
+void KnightServer::analyze_file(const std::string& file,
+                                ServedFile& served,
+                                KnightASTConsumerFactory& ast_factory,
+                                KnightDiagnosticConsumer& diag_consumer,
+                                clang::DiagnosticsEngine& diag_engine) {
+    llvm::outs() << "[*] Analyzing " << file << "\n";
+    if (!reparse(served)) {
+        served.units = parse(file);
+    }
+    for (auto& [build_dir, unit] : served.units) {
+        analyze_ast_unit(ast_factory,
+                         diag_consumer,
+                         diag_engine,
+                         *unit,
+                         file,
+                         build_dir);
+    }
+    served.diagnostics = diag_consumer.take_diags();
+    served.is_invalidated = false;
+}
+
+bool KnightServer::reparse(ServedFile& served) {
+    if (served.units.empty()) {
+        return false;
+    }
+    // Reparse returns true on failure.
+    return llvm::none_of(served.units, [this](ServedUnit& served_unit) {
+        return served_unit.unit->Reparse(m_pch_container_ops);
+    });
+}
+
+std::vector< KnightServer::ServedUnit > KnightServer::parse(
+    const std::string& file) {
+    ServerParseAction::Units units;
+    clang::tooling::ClangTool clang_tool(m_cdb,
+                                         {file},
+                                         m_pch_container_ops,
+                                         fs::create_isolated_vfs(m_base_fs));
+    ServerParseAction action(units);
+    if (clang_tool.run(&action) != 0) {
+        llvm::WithColor::warning() << "cannot parse " << file << "\n";
+    }
+
+    std::vector< ServedUnit > served_units;
+    for (auto& [build_dir, unit] : units) {
+        served_units.push_back(ServedUnit{std::move(build_dir),
+                                          std::move(unit)});
+    }
+    return served_units;
+}
+
+} // namespace knight
@@ -0,0 +1,372 @@
+//===- summary_cache.cpp ----------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the on-disk cache of the function summaries and
+//  diagnostics.
+//
+//===------------------------------------------------------------------===//
+
+#include "tooling/summary_cache.hpp"
+#include "dfa/ast_lock.hpp"
+#include "util/binary.hpp"
+
+#include <clang/AST/ASTContext.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/WithColor.h>
+#include <llvm/Support/xxhash.h>
+
+#define DEBUG_TYPE "summary-cache" // NOLINT
+
+ALWAYS_ENABLED_STATISTIC(NumSummaryCacheHits,
+                         "The number of functions replayed from the "
+                         "summary cache");
+ALWAYS_ENABLED_STATISTIC(NumSummaryCacheMisses,
+                         "The number of functions missing the summary "
+                         "cache");
+ALWAYS_ENABLED_STATISTIC(NumSummaryCacheInserts,
+                         "The number of functions added to the summary "
+                         "cache");
+
+namespace knight {
+
+namespace {
+
+/// \brief Size of the magic and the version at the beginning of a store.
+constexpr uint64_t StoreHeaderSize = 8U;
+
+/// \brief Size of the key and the payload size of a record.
+constexpr uint64_t RecordHeaderSize = 12U;
+
+/// \brief Marker of a callee without summary in a key.
+constexpr uint8_t NoSummary = 0xFFU;
+
+/// \brief Hash the function and, up to the given depth, the bodies of its
+/// callees, with the summaries of the callees.
+void hash_function(llvm::raw_ostream& os,
+                   const clang::FunctionDecl* function,
+                   const dfa::SummaryTable* summaries,
+                   unsigned depth,
+                   llvm::SmallPtrSetImpl< const clang::Decl* >& visited) {
+    write_u64(os, get_function_content_hash(function));
+    if (!visited.insert(function->getCanonicalDecl()).second) {
+        return;
+    }
+
+    const auto callees = dfa::get_direct_callees(function);
+    write_u32(os, static_cast< uint32_t >(callees.size()));
+    for (const auto* callee : callees) {
+        auto summary = summaries != nullptr ? summaries->find(callee)
+                                            : std::nullopt;
+        if (summary.has_value()) {
+            write_u8(os, static_cast< uint8_t >(summary->may_return));
+            write_u8(os, static_cast< uint8_t >(summary->is_degraded));
+        } else {
+            write_u8(os, NoSummary);
+        }
+        if (depth > 0U && callee->hasBody()) {
+            hash_function(os, callee, summaries, depth - 1U, visited);
+        }
+    }
+}
+
+} // anonymous namespace
+
+uint64_t get_function_content_hash(const clang::FunctionDecl* function) {
+    std::string blob;
+    llvm::raw_string_ostream os(blob);
+    function->getNameForDiagnostic(os,
+                                   function->getASTContext()
+                                       .getPrintingPolicy(),
+                                   /*Qualified=*/true);
+    os << ';' << function->getType().getAsString() << ';';
+    write_u32(os, const_cast< clang::FunctionDecl* >(function)->getODRHash());
+
+    // The ODR hash ignores the comments and the layout, which move the
+    // diagnostics replayed by their offsets from the beginning.
+    const auto range = function->getSourceRange();
+    if (range.getBegin().isFileID() && range.getEnd().isFileID()) {
+        const auto& source_mgr =
+            function->getASTContext().getSourceManager();
+        const auto [file, begin] =
+            source_mgr.getDecomposedLoc(range.getBegin());
+        const auto [end_file, end] =
+            source_mgr.getDecomposedLoc(range.getEnd());
+        bool is_invalid = false;
+        const llvm::StringRef data =
+            source_mgr.getBufferData(file, &is_invalid);
+        if (!is_invalid && end_file == file && begin <= end &&
+            end < data.size()) {
+            write_str(os, data.slice(begin, end + 1U));
+        }
+    }
+    os.flush();
+    return llvm::xxh3_64bits(llvm::arrayRefFromStringRef(blob));
+}
+
+SummaryCache::~SummaryCache() {
+    if (m_out != nullptr) {
+        m_out->close();
+        if (m_out->has_error()) {
+            m_out->clear_error();
+        }
+    }
+}
+
+std::unique_ptr< SummaryCache > SummaryCache::open(llvm::StringRef path) {
+    std::unique_ptr< SummaryCache > cache(new SummaryCache());
+    bool is_valid = false;
+    auto buffer = llvm::MemoryBuffer::getFile(path,
+                                              /*IsText=*/false,
+                                              /*RequiresNullTerminator=*/
+                                              false);
+    if (buffer) {
+        cache->m_buffer = std::move(*buffer);
+        is_valid = cache->load_index();
+    }
+    if (!is_valid) {
+        // Unmap the store before rewriting it.
+        cache->m_buffer.reset();
+        cache->m_index.clear();
+    }
+
+    std::error_code err;
+    cache->m_out = std::make_unique<
+        llvm::raw_fd_ostream >(path,
+                               err,
+                               is_valid ? llvm::sys::fs::OF_Append
+                                        : llvm::sys::fs::OF_None);
+    if (err) {
+        llvm::WithColor::warning() << "cannot open the summary cache '"
+                                   << path << "': " << err.message() << "\n";
+        cache->m_out.reset();
+        return nullptr;
+    }
+    if (!is_valid) {
+        write_u32(*cache->m_out, Magic);
+        write_u32(*cache->m_out, Version);
+        cache->m_out->flush();
+    }
+    return cache;
+}
+
+std::string SummaryCache::get_store_path(llvm::StringRef dir,
+                                         llvm::StringRef file) {
+    llvm::SmallString< 128 > path(dir);
+    llvm::sys::path::append(path,
+                            llvm::utohexstr(llvm::xxh3_64bits(
+                                llvm::arrayRefFromStringRef(file))) +
+                                ".knsc");
+    return std::string(path);
+}
+
+bool SummaryCache::load_index() {
+    llvm::StringRef data = m_buffer->getBuffer();
+    BinaryReader header(data);
+    if (header.read_u32() != Magic || header.read_u32() != Version ||
+        header.failed()) {
+        return false;
+    }
+
+    uint64_t offset = StoreHeaderSize;
+    while (offset < data.size()) {
+        BinaryReader record(data.drop_front(offset));
+        const Key key = record.read_u64();
+        const uint32_t size = record.read_u32();
+        // A truncated record may be followed by the appended ones, which
+        // would be read from the middle.
+        if (record.failed() ||
+            data.size() - offset - RecordHeaderSize < size) {
+            return false;
+        }
+        m_index[key] = offset + RecordHeaderSize;
+        offset += RecordHeaderSize + size;
+    }
+    return true;
+}
+
+std::optional< CachedFunction > SummaryCache::lookup(Key key) const {
+    auto it = m_index.find(key);
+    if (it == m_index.end()) {
+        ++NumSummaryCacheMisses;
+        return std::nullopt;
+    }
+
+    BinaryReader reader(m_buffer->getBuffer().drop_front(it->second));
+    CachedFunction function;
+    function.summary.may_return = reader.read_u8() != 0U;
+    function.summary.is_degraded = reader.read_u8() != 0U;
+    const uint32_t diag_cnt = reader.read_u32();
+    for (uint32_t i = 0U; i < diag_cnt && !reader.failed(); ++i) {
+        CachedDiagnostic diag;
+        diag.checker = reader.read_str().str();
+        diag.level =
+            static_cast< clang::DiagnosticsEngine::Level >(reader.read_u8());
+        diag.format = reader.read_str().str();
+        diag.message = reader.read_str().str();
+        diag.offset = reader.read_u32();
+        const uint32_t range_cnt = reader.read_u32();
+        for (uint32_t j = 0U; j < range_cnt && !reader.failed(); ++j) {
+            CachedDiagnostic::Range range{};
+            range.begin = reader.read_u32();
+            range.end = reader.read_u32();
+            range.is_token_range = reader.read_u8() != 0U;
+            diag.ranges.push_back(range);
+        }
+        function.diagnostics.push_back(std::move(diag));
+    }
+    if (reader.failed()) {
+        ++NumSummaryCacheMisses;
+        return std::nullopt;
+    }
+    ++NumSummaryCacheHits;
+    return function;
+}
+
+void SummaryCache::insert(Key key, const CachedFunction& function) {
+    std::string payload;
+    llvm::raw_string_ostream payload_os(payload);
+    write_u8(payload_os, static_cast< uint8_t >(function.summary.may_return));
+    write_u8(payload_os, static_cast< uint8_t >(function.summary.is_degraded));
+    write_u32(payload_os, static_cast< uint32_t >(function.diagnostics.size()));
+    for (const auto& diag : function.diagnostics) {
+        write_str(payload_os, diag.checker);
+        write_u8(payload_os, static_cast< uint8_t >(diag.level));
+        write_str(payload_os, diag.format);
+        write_str(payload_os, diag.message);
+        write_u32(payload_os, diag.offset);
+        write_u32(payload_os, static_cast< uint32_t >(diag.ranges.size()));
+        for (const auto& range : diag.ranges) {
+            write_u32(payload_os, range.begin);
+            write_u32(payload_os, range.end);
+            write_u8(payload_os, static_cast< uint8_t >(range.is_token_range));
+        }
+    }
+    payload_os.flush();
+
+    // The record is written at once, so that a crash only truncates it.
+    std::string record;
+    llvm::raw_string_ostream record_os(record);
+    write_u64(record_os, key);
+    write_u32(record_os, static_cast< uint32_t >(payload.size()));
+    record_os << payload;
+    record_os.flush();
+
+    const std::lock_guard lock(m_out_mutex);
+    *m_out << record;
+    m_out->flush();
+    ++NumSummaryCacheInserts;
+}
+
+SummaryCache::Key SummaryCache::compute_key(
+    const clang::FunctionDecl* function,
+    uint64_t config_hash,
+    const dfa::SummaryTable* summaries,
+    unsigned inline_depth) {
+    // The ODR hashes and the source buffers are computed lazily.
+    const dfa::ASTLock lock(function->getASTContext());
+    std::string blob;
+    llvm::raw_string_ostream os(blob);
+    write_u64(os, config_hash);
+    llvm::SmallPtrSet< const clang::Decl*, 8U > visited;
+    hash_function(os, function, summaries, inline_depth, visited);
+    os.flush();
+    return llvm::xxh3_64bits(llvm::arrayRefFromStringRef(blob));
+}
+
+bool SummaryCache::is_cacheable(const clang::Decl* function) {
+    const auto range = function->getSourceRange();
+    return range.getBegin().isFileID() && range.getEnd().isFileID();
+}
+
+std::optional< CachedFunction > SummaryCache::capture(
+    const clang::Decl* function,
+    const dfa::FunctionSummary& summary,
+    const KnightDiagnosticBuffer& buffer,
+    const clang::SourceManager& source_mgr) {
+    if (!is_cacheable(function)) {
+        return std::nullopt;
+    }
+    // The source manager caches the last file ID looked up.
+    const dfa::ASTLock lock(function->getASTContext());
+    const auto [file, begin] =
+        source_mgr.getDecomposedLoc(function->getBeginLoc());
+    const auto end = source_mgr.getFileOffset(function->getEndLoc());
+    auto get_offset =
+        [&](clang::SourceLocation loc) -> std::optional< uint32_t > {
+        if (!loc.isFileID()) {
+            return std::nullopt;
+        }
+        const auto [loc_file, loc_offset] = source_mgr.getDecomposedLoc(loc);
+        if (loc_file != file || loc_offset < begin || loc_offset > end) {
+            return std::nullopt;
+        }
+        return loc_offset - begin;
+    };
+
+    CachedFunction cached{summary, {}};
+    for (const auto& diag : buffer.get_diags()) {
+        auto offset = get_offset(diag.getLocation());
+        if (!offset.has_value() || !diag.getFixIts().empty()) {
+            return std::nullopt;
+        }
+        CachedDiagnostic cached_diag{buffer.get_checker_name(diag).str(),
+                                     diag.getLevel(),
+                                     buffer.get_format(diag).str(),
+                                     diag.getMessage().str(),
+                                     *offset,
+                                     {}};
+        for (const auto& range : diag.getRanges()) {
+            auto range_begin = get_offset(range.getBegin());
+            auto range_end = get_offset(range.getEnd());
+            if (!range_begin.has_value() || !range_end.has_value()) {
+                return std::nullopt;
+            }
+            cached_diag.ranges.push_back(
+                {*range_begin, *range_end, range.isTokenRange()});
+        }
+        cached.diagnostics.push_back(std::move(cached_diag));
+    }
+    return cached;
+}
+
+void SummaryCache::replay(const clang::Decl* function,
+                          const CachedFunction& cached,
+                          KnightDiagnosticBuffer& buffer,
+                          const clang::SourceManager& source_mgr) {
+    const auto begin = function->getBeginLoc();
+    for (const auto& diag : cached.diagnostics) {
+        std::vector< clang::CharSourceRange > ranges;
+        ranges.reserve(diag.ranges.size());
+        for (const auto& range : diag.ranges) {
+            const clang::SourceRange source_range(
+                begin.getLocWithOffset(static_cast< int >(range.begin)),
+                begin.getLocWithOffset(static_cast< int >(range.end)));
+            ranges.push_back(
+                range.is_token_range
+                    ? clang::CharSourceRange::getTokenRange(source_range)
+                    : clang::CharSourceRange::getCharRange(source_range));
+        }
+        buffer.add(diag.checker,
+                   diag.level,
+                   diag.format,
+                   diag.message,
+                   clang::FullSourceLoc(begin.getLocWithOffset(
+                                            static_cast< int >(diag.offset)),
+                                        source_mgr),
+                   ranges);
+    }
+}
+
+} // namespace knight
@@ -0,0 +1,252 @@
+//===- caching_vfs.cpp ------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the file system caching the status and contents
+//  of the files for all the translation units.
+//
+//===------------------------------------------------------------------===//
+
+#include "util/caching_vfs.hpp"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/xxhash.h>
+
+#include <string>
+#include <vector>
+
+#define DEBUG_TYPE "fs-cache" // NOLINT
+
+ALWAYS_ENABLED_STATISTIC(NumFsCacheHits,
+                         "The number of file status and reads served by "
+                         "the file system cache");
+ALWAYS_ENABLED_STATISTIC(NumFsCacheMisses,
+                         "The number of file status and reads forwarded to "
+                         "the underlying file system");
+
+namespace knight::fs {
+
+namespace {
+
+constexpr unsigned PathMaxLen = 256U;
+
+/// \brief A buffer of the cached contents of a file, keeping them alive
+/// after the file is closed.
+class SharedMemoryBuffer : public llvm::MemoryBuffer {
+  private:
+    std::shared_ptr< const llvm::MemoryBuffer > m_contents;
+    std::string m_name;
+
+  public:
+    SharedMemoryBuffer(std::shared_ptr< const llvm::MemoryBuffer > contents,
+                       std::string name)
+        : m_contents(std::move(contents)), m_name(std::move(name)) {
+        // The contents are read with their null terminator.
+        init(m_contents->getBufferStart(),
+             m_contents->getBufferEnd(),
+             /*RequiresNullTerminator=*/false);
+    }
+
+    llvm::StringRef getBufferIdentifier() const override { return m_name; }
+
+    BufferKind getBufferKind() const override {
+        return m_contents->getBufferKind();
+    }
+}; // class SharedMemoryBuffer
+
+class CachedFile : public llvm::vfs::File {
+  private:
+    llvm::vfs::Status m_status;
+    std::shared_ptr< const llvm::MemoryBuffer > m_contents;
+
+  public:
+    CachedFile(llvm::vfs::Status status,
+               std::shared_ptr< const llvm::MemoryBuffer > contents)
+        : m_status(std::move(status)), m_contents(std::move(contents)) {}
+
+    llvm::ErrorOr< llvm::vfs::Status > status() override { return m_status; }
+
+    llvm::ErrorOr< std::unique_ptr< llvm::MemoryBuffer > > getBuffer(
+        const llvm::Twine& name,
+        int64_t /*file_size*/,
+        bool /*requires_null_terminator*/,
+        bool /*is_volatile*/) override {
+        return std::make_unique< SharedMemoryBuffer >(m_contents, name.str());
+    }
+
+    std::error_code close() override { return {}; }
+}; // class CachedFile
+
+/// \brief Check if the status of a file on the disk is still the cached
+/// one.
+bool is_same_status(const llvm::vfs::Status& lhs,
+                    const llvm::vfs::Status& rhs) {
+    return lhs.getUniqueID() == rhs.getUniqueID() &&
+           lhs.getType() == rhs.getType() && lhs.getSize() == rhs.getSize() &&
+           lhs.getLastModificationTime() == rhs.getLastModificationTime();
+}
+
+} // anonymous namespace
+
+std::optional< FileSystemCache::Entry > FileSystemCache::lookup(
+    llvm::StringRef path) {
+    auto& shard = get_shard(path);
+    const std::lock_guard< std::mutex > lock(shard.mutex);
+    auto it = shard.entries.find(path);
+    if (it == shard.entries.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+FileSystemCache::Entry FileSystemCache::insert_status(
+    llvm::StringRef path, const llvm::ErrorOr< llvm::vfs::Status >& status) {
+    auto& shard = get_shard(path);
+    const std::lock_guard< std::mutex > lock(shard.mutex);
+    auto [it, inserted] = shard.entries.try_emplace(path);
+    if (inserted) {
+        if (status) {
+            it->second.status = *status;
+        } else {
+            it->second.error = status.getError();
+        }
+    }
+    return it->second;
+}
+
+FileSystemCache::Entry FileSystemCache::insert_contents(
+    llvm::StringRef path,
+    const llvm::vfs::Status& status,
+    std::shared_ptr< const llvm::MemoryBuffer > contents) {
+    auto& shard = get_shard(path);
+    const std::lock_guard< std::mutex > lock(shard.mutex);
+    auto& entry = shard.entries[path];
+    if (entry.contents == nullptr) {
+        entry.status = status;
+        entry.error.clear();
+        entry.contents = std::move(contents);
+    }
+    return entry;
+}
+
+void FileSystemCache::invalidate(llvm::StringRef path) {
+    auto& shard = get_shard(path);
+    const std::lock_guard< std::mutex > lock(shard.mutex);
+    shard.entries.erase(path);
+}
+
+unsigned FileSystemCache::invalidate_changed() {
+    auto real_fs = llvm::vfs::getRealFileSystem();
+    unsigned invalidated_cnt = 0U;
+    for (auto& shard : m_shards) {
+        const std::lock_guard< std::mutex > lock(shard.mutex);
+        std::vector< std::string > changed_paths;
+        for (const auto& [path, entry] : shard.entries) {
+            if (!entry.status) {
+                changed_paths.push_back(path.str());
+                continue;
+            }
+            auto status = real_fs->status(path);
+            if (!status || !is_same_status(*status, *entry.status)) {
+                changed_paths.push_back(path.str());
+            }
+        }
+        for (const auto& path : changed_paths) {
+            shard.entries.erase(path);
+        }
+        invalidated_cnt += static_cast< unsigned >(changed_paths.size());
+    }
+    return invalidated_cnt;
+}
+
+FileSystemCache::Shard& FileSystemCache::get_shard(llvm::StringRef path) {
+    const auto hash = llvm::xxh3_64bits(llvm::arrayRefFromStringRef(path));
+    return m_shards[hash % NumShards];
+}
+
+const char CachingFileSystem::ID = 0;
+
+llvm::ErrorOr< llvm::vfs::Status > CachingFileSystem::status(
+    const llvm::Twine& path) {
+    llvm::SmallString< PathMaxLen > abs_path;
+    path.toVector(abs_path);
+    if (makeAbsolute(abs_path)) {
+        return getUnderlyingFS().status(path);
+    }
+
+    auto entry = m_cache->lookup(abs_path);
+    if (entry) {
+        ++NumFsCacheHits;
+    } else {
+        ++NumFsCacheMisses;
+        entry = m_cache->insert_status(abs_path,
+                                       getUnderlyingFS().status(abs_path));
+    }
+    if (!entry->status) {
+        return entry->error;
+    }
+    return llvm::vfs::Status::copyWithNewName(*entry->status, path);
+}
+
+llvm::ErrorOr< std::unique_ptr< llvm::vfs::File > > CachingFileSystem::
+    openFileForRead(const llvm::Twine& path) {
+    llvm::SmallString< PathMaxLen > abs_path;
+    path.toVector(abs_path);
+    if (makeAbsolute(abs_path)) {
+        return getUnderlyingFS().openFileForRead(path);
+    }
+
+    auto entry = m_cache->lookup(abs_path);
+    if (entry && !entry->status) {
+        ++NumFsCacheHits;
+        return entry->error;
+    }
+    if (entry && entry->contents != nullptr) {
+        ++NumFsCacheHits;
+        return std::make_unique< CachedFile >(
+            llvm::vfs::Status::copyWithNewName(*entry->status, path),
+            entry->contents);
+    }
+
+    ++NumFsCacheMisses;
+    auto file = getUnderlyingFS().openFileForRead(abs_path);
+    if (!file) {
+        // The other errors, e.g. of the permissions, do not tell the
+        // status of the file.
+        if (file.getError() == std::errc::no_such_file_or_directory) {
+            (void)m_cache->insert_status(abs_path, file.getError());
+        }
+        return file.getError();
+    }
+    // Only the contents of the regular files are stable.
+    auto status = (*file)->status();
+    if (!status || !status->isRegularFile()) {
+        return file;
+    }
+    auto contents = (*file)->getBuffer(abs_path,
+                                       static_cast< int64_t >(
+                                           status->getSize()),
+                                       /*RequiresNullTerminator=*/true,
+                                       /*IsVolatile=*/false);
+    if (!contents) {
+        return contents.getError();
+    }
+    auto cached =
+        m_cache->insert_contents(abs_path,
+                                 *status,
+                                 std::shared_ptr< const llvm::MemoryBuffer >(
+                                     std::move(*contents)));
+    return std::make_unique< CachedFile >(
+        llvm::vfs::Status::copyWithNewName(*cached.status, path),
+        cached.contents);
+}
+
+} // namespace knight::fs
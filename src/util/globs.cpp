@@ -46,13 +46,38 @@ Globs::Globs(llvm::StringRef globs) {
         const bool is_negative = globs.consume_front("-");
         auto current = globs.split(',').first.trim();
         if (!current.empty()) {
-            Glob g{is_negative, create_regex_for(current)};
-            m_globs.push_back(std::move(g));
+            const auto star = current.find('*');
+            if (star == llvm::StringRef::npos) {
+                m_globs.push_back(
+                    {is_negative, GlobKind::Exact, current.str(), {}});
+            } else if (star == current.size() - 1U) {
+                m_globs.push_back({is_negative,
+                                   GlobKind::Prefix,
+                                   current.drop_back().str(),
+                                   {}});
+            } else {
+                m_globs.push_back({is_negative,
+                                   GlobKind::Regex,
+                                   {},
+                                   create_regex_for(current)});
+            }
         }
         globs = globs.split(',').second;
     }
 }
 
+bool Globs::Glob::matches(llvm::StringRef str) const {
+    switch (kind) {
+        case GlobKind::Exact:
+            return str == text;
+        case GlobKind::Prefix:
+            return str.starts_with(text);
+        case GlobKind::Regex:
+            return regex.match(str);
+    }
+    return false;
+}
+
 bool Globs::matches(llvm::StringRef str) const {
     auto catch_it = m_cache.find(str);
     if (catch_it != m_cache.end()) {
@@ -61,7 +86,7 @@ bool Globs::matches(llvm::StringRef str) const {
 
     bool res = false;
     for (const auto& g : llvm::reverse(m_globs)) {
-        if (g.regex.match(str)) {
+        if (g.matches(str)) {
             res = !g.is_negative;
             break;
         }
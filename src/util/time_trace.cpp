@@ -0,0 +1,65 @@
+//===- time_trace.cpp -------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the utilities of the chrome trace output.
+//
+//===------------------------------------------------------------------===//
+
+#include "util/time_trace.hpp"
+
+#include <llvm/Support/Error.h>
+#include <llvm/Support/WithColor.h>
+
+namespace knight {
+
+namespace {
+
+constexpr llvm::StringLiteral TraceProcessName = "knight";
+
+} // anonymous namespace
+
+void TimeTrace::enable(unsigned granularity) {
+    s_granularity.store(granularity, std::memory_order_relaxed);
+    s_enabled.store(true, std::memory_order_relaxed);
+    if (!llvm::timeTraceProfilerEnabled()) {
+        llvm::timeTraceProfilerInitialize(granularity, TraceProcessName);
+    }
+}
+
+bool TimeTrace::write(llvm::StringRef path) {
+    if (!llvm::timeTraceProfilerEnabled()) {
+        return true;
+    }
+    auto err = llvm::timeTraceProfilerWrite(path, path);
+    llvm::timeTraceProfilerCleanup();
+    if (err) {
+        llvm::WithColor::error()
+            << "cannot write the trace to " << path << ": "
+            << llvm::toString(std::move(err)) << "\n";
+        return false;
+    }
+    return true;
+}
+
+TimeTraceThread::TimeTraceThread() {
+    if (!TimeTrace::is_enabled() || llvm::timeTraceProfilerEnabled()) {
+        return;
+    }
+    llvm::timeTraceProfilerInitialize(TimeTrace::get_granularity(),
+                                      TraceProcessName);
+    m_traced = true;
+}
+
+TimeTraceThread::~TimeTraceThread() {
+    if (m_traced) {
+        llvm::timeTraceProfilerFinishThread();
+    }
+}
+
+} // namespace knight
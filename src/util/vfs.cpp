@@ -1,13 +1,43 @@
 #include "util/vfs.hpp"
 
+#include <llvm/Support/Casting.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <iterator>
+#include <memory>
+
 namespace knight::fs {
 
 namespace {
 
 constexpr unsigned PathMaxLen = 256U;
 
+/// \brief Get the caching file system at the bottom of the base VFS, if
+/// any.
+CachingFileSystem* get_caching_fs(const OverlayFileSystemRef& base_fs) {
+    return llvm::dyn_cast< CachingFileSystem >(
+        base_fs->overlays_rbegin()->get());
+}
+
 } // anonymous namespace
 
+const char YAMLOverlayFileSystem::ID = 0;
+
+FileSystemRef YAMLOverlayFileSystem::rebuild(FileSystemRef external_fs) const {
+    FileSystemRef fs =
+        llvm::vfs::getVFSFromYAML(llvm::MemoryBuffer::getMemBufferCopy(
+                                      m_yaml,
+                                      m_yaml_file),
+                                  nullptr,
+                                  m_yaml_file,
+                                  nullptr,
+                                  std::move(external_fs));
+    if (!fs) {
+        return nullptr;
+    }
+    return {new YAMLOverlayFileSystem(std::move(fs), m_yaml_file, m_yaml)};
+}
+
 FileSystemRef get_vfs_from_yaml(const std::string& overlay_yaml_file,
                                 const FileSystemRef& base_fs) {
     auto buffer = base_fs->getBufferForFile(overlay_yaml_file);
@@ -18,6 +48,7 @@ FileSystemRef get_vfs_from_yaml(const std::string& overlay_yaml_file,
         return nullptr;
     }
 
+    std::string yaml = (*buffer)->getBuffer().str();
     FileSystemRef fs = llvm::vfs::getVFSFromYAML(std::move(buffer.get()),
                                                  nullptr,
                                                  overlay_yaml_file);
@@ -26,11 +57,51 @@ FileSystemRef get_vfs_from_yaml(const std::string& overlay_yaml_file,
                      << overlay_yaml_file << "'.\n";
         return nullptr;
     }
-    return fs;
+    return {new YAMLOverlayFileSystem(std::move(fs),
+                                      overlay_yaml_file,
+                                      std::move(yaml))};
+}
+
+OverlayFileSystemRef create_base_vfs(bool caching) {
+    FileSystemRef real_fs = llvm::vfs::getRealFileSystem();
+    if (caching) {
+        real_fs = new CachingFileSystem(std::move(real_fs),
+                                        std::make_shared< FileSystemCache >());
+    }
+    return {new llvm::vfs::OverlayFileSystem(std::move(real_fs))};
+}
+
+OverlayFileSystemRef create_isolated_vfs(const OverlayFileSystemRef& base_fs) {
+    // The caching file systems have their own working directories, but
+    // share the cache of the base VFS.
+    FileSystemRef physical_fs = llvm::vfs::createPhysicalFileSystem();
+    if (const auto* caching_fs = get_caching_fs(base_fs)) {
+        physical_fs = new CachingFileSystem(std::move(physical_fs),
+                                            caching_fs->get_cache());
+    }
+    OverlayFileSystemRef isolated_fs(
+        new llvm::vfs::OverlayFileSystem(physical_fs));
+
+    // The bottom layer of the base VFS is the real file system.
+    for (auto it = std::next(base_fs->overlays_rbegin()),
+              end = base_fs->overlays_rend();
+         it != end;
+         ++it) {
+        FileSystemRef overlay = *it;
+        if (const auto* yaml_fs =
+                llvm::dyn_cast< YAMLOverlayFileSystem >(overlay.get())) {
+            if (auto rebuilt = yaml_fs->rebuild(physical_fs)) {
+                overlay = std::move(rebuilt);
+            }
+        }
+        isolated_fs->pushOverlay(std::move(overlay));
+    }
+    return isolated_fs;
 }
 
-OverlayFileSystemRef create_base_vfs() {
-    return {new llvm::vfs::OverlayFileSystem(llvm::vfs::getRealFileSystem())};
+FileSystemCache* get_file_system_cache(const OverlayFileSystemRef& base_fs) {
+    auto* caching_fs = get_caching_fs(base_fs);
+    return caching_fs != nullptr ? caching_fs->get_cache().get() : nullptr;
 }
 
 std::string make_absolute(llvm::StringRef file) {
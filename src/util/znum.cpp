@@ -0,0 +1,101 @@
+//===- znum.cpp -------------------------------------------------------===//
+//
+// Copyright (c) 2024 Junjie Shen
+//
+// see https://github.com/shenjunjiekoda/knight/blob/main/LICENSE for
+// license information.
+//
+//===------------------------------------------------------------------===//
+//
+//  This file implements the slow paths of the arbitrary precision
+//  integers.
+//
+//===------------------------------------------------------------------===//
+
+#include "util/znum.hpp"
+
+#include <algorithm>
+
+namespace knight {
+
+namespace {
+
+constexpr unsigned SmallBitWidth = 64U;
+
+/// \brief The width holding the sum or the quotient of the numbers.
+unsigned get_sum_width(const ZNum& lhs, const ZNum& rhs) {
+    return std::max(lhs.get_bit_width(), rhs.get_bit_width()) + 1U;
+}
+
+} // anonymous namespace
+
+ZNum ZNum::from_apint(const llvm::APInt& value) {
+    const unsigned width = value.getSignificantBits();
+    if (width <= SmallBitWidth) {
+        return value.getSExtValue();
+    }
+    ZNum num;
+    num.m_big = new llvm::APInt(value.sextOrTrunc(width));
+    return num;
+}
+
+llvm::APInt ZNum::get_apint(unsigned width) const {
+    if (is_small()) {
+        return {std::max(width, SmallBitWidth),
+                static_cast< uint64_t >(m_small),
+                /*isSigned=*/true};
+    }
+    return m_big->sext(std::max(width, m_big->getBitWidth()));
+}
+
+ZNum ZNum::add_slow(const ZNum& lhs, const ZNum& rhs) {
+    const unsigned width = get_sum_width(lhs, rhs);
+    return from_apint(lhs.get_apint(width) + rhs.get_apint(width));
+}
+
+ZNum ZNum::sub_slow(const ZNum& lhs, const ZNum& rhs) {
+    const unsigned width = get_sum_width(lhs, rhs);
+    return from_apint(lhs.get_apint(width) - rhs.get_apint(width));
+}
+
+ZNum ZNum::mul_slow(const ZNum& lhs, const ZNum& rhs) {
+    const unsigned width = lhs.get_bit_width() + rhs.get_bit_width();
+    return from_apint(lhs.get_apint(width) * rhs.get_apint(width));
+}
+
+ZNum ZNum::div_slow(const ZNum& lhs, const ZNum& rhs) {
+    const unsigned width = get_sum_width(lhs, rhs);
+    return from_apint(lhs.get_apint(width).sdiv(rhs.get_apint(width)));
+}
+
+ZNum ZNum::rem_slow(const ZNum& lhs, const ZNum& rhs) {
+    const unsigned width = get_sum_width(lhs, rhs);
+    return from_apint(lhs.get_apint(width).srem(rhs.get_apint(width)));
+}
+
+ZNum ZNum::neg_slow(const ZNum& num) {
+    auto value = num.get_apint(num.get_bit_width() + 1U);
+    value.negate();
+    return from_apint(value);
+}
+
+int ZNum::compare_slow(const ZNum& lhs, const ZNum& rhs) {
+    const unsigned width =
+        std::max(lhs.get_bit_width(), rhs.get_bit_width());
+    const auto lhs_value = lhs.get_apint(width);
+    const auto rhs_value = rhs.get_apint(width);
+    if (lhs_value.slt(rhs_value)) {
+        return -1;
+    }
+    return lhs_value == rhs_value ? 0 : 1;
+}
+
+void ZNum::dump(llvm::raw_ostream& os) const {
+    if (is_small()) {
+        os << m_small;
+    } else {
+        m_big->print(os, /*isSigned=*/true);
+    }
+}
+
+} // namespace knight
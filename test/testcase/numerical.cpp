@@ -0,0 +1,142 @@
+void knight_eval(bool cond);
+void knight_reachable();
+
+// clang-format off
+void loop_bound(int n) {
+    for (int i = 0; i < n; ++i) {
+        knight_eval(i >= 0); // TRUE
+        knight_eval(i < n); // TRUE
+        knight_eval(i == 0); // UNKNOWN
+    }
+}
+
+void loop_exit(int n) {
+    if (n < 0) {
+        return;
+    }
+    int i = 0;
+    while (i < n) {
+        ++i;
+    }
+    knight_eval(i >= 0); // TRUE
+    knight_eval(i <= n); // TRUE
+    knight_eval(i >= n); // TRUE
+}
+
+void assignments(int a, int b) {
+    int x = a;
+    int y = x + 1;
+    knight_eval(y > a); // TRUE
+    knight_eval(y == a); // FALSE
+    x = 5;
+    knight_eval(x == 5); // TRUE
+    x = b + 5;
+    knight_eval(x - b <= 5); // TRUE
+    knight_eval(x == 5); // UNKNOWN
+    x -= 2;
+    knight_eval(x - b >= 3); // TRUE
+    knight_eval(x - b > 3); // FALSE
+    y = x * b;
+    knight_eval(y > a); // UNKNOWN
+}
+
+void escapes(int* p) {
+    int x = 0;
+    knight_eval(x == 0); // TRUE
+    *p = 1;
+    knight_eval(x == 0); // UNKNOWN
+}
+
+struct Pod {
+    int field;
+};
+
+struct RefWriter {
+    explicit RefWriter(int& ref) { ref = 5; }
+};
+
+struct PtrWriter {
+    explicit PtrWriter(int* ptr) { *ptr = 5; }
+};
+
+void constructions() {
+    int x = 0;
+    Pod pod;
+    knight_eval(x == 0); // TRUE
+    RefWriter writer(x);
+    knight_eval(x == 0); // UNKNOWN
+    x = 0;
+    delete new PtrWriter(&x);
+    knight_eval(x == 0); // UNKNOWN
+}
+
+void conversions() {
+    int x = -1;
+    unsigned u = x;
+    knight_eval(u == 4294967295U); // UNKNOWN
+    int y = 300;
+    char c = y;
+    knight_eval(c == 300); // UNKNOWN
+    // The constants are folded to their converted values.
+    char d = 300;
+    knight_eval(d == 300); // FALSE
+    long l = 4294967296L;
+    int i = 1;
+    i += l;
+    knight_eval(i == 1); // UNKNOWN
+}
+
+void redundant(int x, int y) {
+    if (x < 10 && x < 20 && x <= 9) {
+        knight_eval(x <= 9); // TRUE
+        knight_eval(x < 9); // UNKNOWN
+    }
+    knight_eval(x <= 9 && 9 >= x && x - 1 < 10); // UNKNOWN
+    if (x - y <= 2 && 2 * x - 2 * y <= 5) {
+        knight_eval(x - y <= 2); // TRUE
+        knight_eval(x - y <= 1); // UNKNOWN
+    }
+}
+
+void parallel_forms(int x, int y) {
+    if (2 * x - 2 * y <= 5 && x - y >= 2 && y - x >= -3) {
+        knight_eval(x - y <= 2); // TRUE
+        knight_eval(x - y >= 2); // TRUE
+        knight_eval(x - y > 2); // FALSE
+    }
+}
+
+void contradictory(int x, int y) {
+    if (x < y && y < x) {
+        knight_reachable(); // no warning
+    }
+    if (x <= 3 && x >= 4) {
+        knight_reachable(); // no warning
+    }
+    knight_eval(x - y <= 1 && y - x <= -2); // FALSE
+    knight_eval(2 * x == 3); // FALSE
+    knight_eval(x < y && y < x); // FALSE
+    knight_reachable(); // REACHABLE
+}
+
+void congruence(int n) {
+    int x = 0;
+    for (int i = 0; i < n; ++i) {
+        x += 4;
+    }
+    knight_eval(x >= 0); // TRUE
+    knight_eval(x == 2); // FALSE
+    knight_eval(x == 8); // UNKNOWN
+}
+
+void known_bits(int n) {
+    int x = 8;
+    if (n > 0) {
+        x = 24;
+    }
+    knight_eval(x >= 8); // TRUE
+    knight_eval(x <= 24); // TRUE
+    knight_eval(x == 16); // FALSE
+    knight_eval(x == 24); // UNKNOWN
+}
+// clang-format on
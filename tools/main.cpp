@@ -12,21 +12,32 @@
 //===------------------------------------------------------------------===//
 
 #include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
 #include <llvm/Support/InitLLVM.h>
 #include <llvm/Support/Process.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/WithColor.h>
 #include <llvm/Support/raw_ostream.h>
 #include <cstdint>
+#include <optional>
 
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <string>
 
+#include "dfa/domain/numerical/product_dom.hpp"
+#include "dfa/engine/cost_model.hpp"
+#include "dfa/engine/deadline.hpp"
+#include "dfa/invariant_export.hpp"
+#include "dfa/profiler.hpp"
 #include "tooling/cl_opts.hpp"
 #include "tooling/context.hpp"
 #include "tooling/diagnostic.hpp"
+#include "tooling/distributed.hpp"
 #include "tooling/knight.hpp"
 #include "tooling/options.hpp"
+#include "tooling/perf.hpp"
+#include "tooling/server.hpp"
+#include "util/time_trace.hpp"
 #include "util/vfs.hpp"
 
 using namespace llvm;
@@ -43,10 +54,13 @@ constexpr ErrCode VfsFileFailure = 3U;
 constexpr ErrCode NoInputFiles = 4U;
 constexpr ErrCode InputNotExists = 5U;
 constexpr ErrCode CompileErrorFound = 6U;
+constexpr ErrCode PerfBaselineFailure = 7U;
+constexpr ErrCode ServerFailure = 8U;
+constexpr ErrCode DistributedFailure = 9U;
 
 llvm::IntrusiveRefCntPtr< llvm::vfs::OverlayFileSystem > get_vfs(
     ErrCode& code) {
-    auto base_vfs = fs::create_base_vfs();
+    auto base_vfs = fs::create_base_vfs(fs_cache);
     if (!base_vfs) {
         code = BaseVfsCreateFailure;
         return nullptr;
@@ -65,13 +79,29 @@ llvm::IntrusiveRefCntPtr< llvm::vfs::OverlayFileSystem > get_vfs(
 }
 
 std::unique_ptr< KnightOptionsProvider > get_opts_provider() {
-    auto opts_provider = std::make_unique< KnightOptionsCommandLineProvider >();
+    auto opts_provider =
+        std::make_unique< KnightOptionsConfigFileProvider >(config_file);
     if (analyses.getNumOccurrences() > 0) {
         opts_provider->options.analyses = analyses; // NOLINT
     }
     if (checkers.getNumOccurrences() > 0) {
         opts_provider->options.checkers = checkers; // NOLINT
     }
+    if (header_filter.getNumOccurrences() > 0) {
+        opts_provider->options.header_filter = header_filter;
+    }
+    if (system_headers.getNumOccurrences() > 0) {
+        opts_provider->options.system_headers = system_headers;
+    }
+    if (stream_diagnostics.getNumOccurrences() > 0) {
+        opts_provider->options.stream_diagnostics = stream_diagnostics;
+    }
+    if (diagnostic_format.getNumOccurrences() > 0) {
+        opts_provider->options.diagnostic_format = diagnostic_format;
+    }
+    if (diagnostic_output.getNumOccurrences() > 0) {
+        opts_provider->options.diagnostic_output = diagnostic_output;
+    }
     if (use_color.getNumOccurrences() > 0) {
         opts_provider->options.use_color = use_color;
     } else {
@@ -84,11 +114,112 @@ std::unique_ptr< KnightOptionsProvider > get_opts_provider() {
     if (dump_cfg.getNumOccurrences() > 0) {
         opts_provider->options.dump_cfg = dump_cfg;
     }
+    if (analysis_threads.getNumOccurrences() > 0) {
+        opts_provider->options.analysis_threads = analysis_threads;
+    }
+    if (shared_interning.getNumOccurrences() > 0) {
+        opts_provider->options.shared_interning = shared_interning;
+    }
+    if (tu_threads.getNumOccurrences() > 0) {
+        opts_provider->options.tu_threads = tu_threads;
+    }
+    if (parse_threads.getNumOccurrences() > 0) {
+        opts_provider->options.parse_threads = parse_threads;
+    }
+    if (max_live_asts.getNumOccurrences() > 0) {
+        opts_provider->options.max_live_asts = max_live_asts;
+    }
+    if (preamble_cache_dir.getNumOccurrences() > 0) {
+        opts_provider->options.preamble_cache_dir = preamble_cache_dir;
+    }
+    if (fixpoint_iterator.getNumOccurrences() > 0) {
+        opts_provider->options.fixpoint_iterator = fixpoint_iterator;
+    }
+    if (worklist_min_blocks.getNumOccurrences() > 0) {
+        opts_provider->options.worklist_min_blocks = worklist_min_blocks;
+    }
+    if (widening_delay.getNumOccurrences() > 0) {
+        opts_provider->options.widening_delay = widening_delay;
+    }
+    if (max_narrowing_iterations.getNumOccurrences() > 0) {
+        opts_provider->options.max_narrowing_iterations =
+            max_narrowing_iterations;
+    }
+    if (max_loop_iterations.getNumOccurrences() > 0) {
+        opts_provider->options.max_loop_iterations = max_loop_iterations;
+    }
+    if (transfer_cache_size.getNumOccurrences() > 0) {
+        opts_provider->options.transfer_cache_size = transfer_cache_size;
+    }
+    if (numerical_domains.getNumOccurrences() > 0) {
+        opts_provider->options.numerical_domains = numerical_domains;
+    }
+    if (function_time_limit.getNumOccurrences() > 0) {
+        opts_provider->options.function_time_limit = function_time_limit;
+    }
+    if (function_step_limit.getNumOccurrences() > 0) {
+        opts_provider->options.function_step_limit = function_step_limit;
+    }
+    if (outlier_time_limit.getNumOccurrences() > 0) {
+        opts_provider->options.outlier_time_limit = outlier_time_limit;
+    }
+    if (cost_report.getNumOccurrences() > 0) {
+        opts_provider->options.cost_report = cost_report;
+    }
+    if (max_memory_per_function.getNumOccurrences() > 0) {
+        opts_provider->options.max_memory_per_function =
+            max_memory_per_function;
+    }
+    if (interprocedural.getNumOccurrences() > 0) {
+        opts_provider->options.interprocedural = interprocedural;
+    }
+    if (max_inline_depth.getNumOccurrences() > 0) {
+        opts_provider->options.max_inline_depth = max_inline_depth;
+    }
+    if (inline_cache_size.getNumOccurrences() > 0) {
+        opts_provider->options.inline_cache_size = inline_cache_size;
+    }
+    if (heap_context_depth.getNumOccurrences() > 0) {
+        opts_provider->options.heap_context_depth = heap_context_depth;
+    }
+    if (heap_recency.getNumOccurrences() > 0) {
+        opts_provider->options.heap_recency = heap_recency;
+    }
+    if (max_array_elements.getNumOccurrences() > 0) {
+        opts_provider->options.max_array_elements = max_array_elements;
+    }
+    if (sparse_analysis.getNumOccurrences() > 0) {
+        opts_provider->options.sparse_analysis = sparse_analysis;
+    }
+    if (fold_constant_branches.getNumOccurrences() > 0) {
+        opts_provider->options.fold_constant_branches = fold_constant_branches;
+    }
+    if (trace_partitions.getNumOccurrences() > 0) {
+        opts_provider->options.trace_partitions = trace_partitions;
+    }
+    if (summary_cache_dir.getNumOccurrences() > 0) {
+        opts_provider->options.summary_cache_dir = summary_cache_dir;
+    }
+    if (incremental.getNumOccurrences() > 0) {
+        opts_provider->options.incremental = incremental;
+    }
+    if (changed_files.getNumOccurrences() > 0) {
+        opts_provider->options.changed_files = changed_files;
+    }
+    if (ctu_dir.getNumOccurrences() > 0) {
+        opts_provider->options.ctu_dir = ctu_dir;
+    }
+    if (ctu_build_index.getNumOccurrences() > 0) {
+        opts_provider->options.ctu_build_index = ctu_build_index;
+    }
+    if (ctu_max_loaded_asts.getNumOccurrences() > 0) {
+        opts_provider->options.ctu_max_loaded_asts = ctu_max_loaded_asts;
+    }
     return std::move(opts_provider);
 }
 
 std::vector< std::string > get_enabled_checkers() {
-    KnightContext context(std::move(get_opts_provider()));
+    KnightTUContext context(std::move(get_opts_provider()));
     const KnightASTConsumerFactory factory(context);
     std::vector< std::string > checkers;
     for (const auto& [_, name] : factory.get_enabled_checks()) {
@@ -98,7 +229,7 @@ std::vector< std::string > get_enabled_checkers() {
 }
 
 std::vector< std::string > get_directly_enabled_analyses() {
-    KnightContext context(std::move(get_opts_provider()));
+    KnightTUContext context(std::move(get_opts_provider()));
     const KnightASTConsumerFactory factory(context);
     std::vector< std::string > analyses;
     for (const auto& [_, name] : factory.get_directly_enabled_analyses()) {
@@ -148,8 +279,89 @@ void print_enabled_analyses(
     }
 }
 
+void write_profile() {
+    dfa::Profiler::print_report(llvm::errs());
+    if (profile_output.empty()) {
+        return;
+    }
+    std::error_code err;
+    llvm::raw_fd_ostream os(profile_output, err, llvm::sys::fs::OF_Text);
+    if (err) {
+        WithColor::error() << "cannot write the profile to " << profile_output
+                           << ": " << err.message() << "\n";
+        return;
+    }
+    dfa::Profiler::write_json(os);
+}
+
+ErrCode run_perf(KnightTUContext& ctx,
+                 const CompilationDatabase& cdb,
+                 std::vector< std::string > input_files,
+                 fs::OverlayFileSystemRef vfs) {
+    std::optional< PerfSample > baseline;
+    if (!perf_baseline.empty()) {
+        baseline = read_perf_baseline(perf_baseline);
+        if (!baseline) {
+            return PerfBaselineFailure;
+        }
+    }
+
+    PerfHarness harness(ctx, cdb, std::move(input_files), std::move(vfs));
+    const auto report = harness.run(perf_runs);
+    print_perf_report(report, llvm::errs());
+    if (baseline) {
+        print_perf_diff(report.get_median(), *baseline, llvm::errs());
+    }
+    if (perf_output.empty()) {
+        return NormalExit;
+    }
+    std::error_code err;
+    llvm::raw_fd_ostream os(perf_output, err, llvm::sys::fs::OF_Text);
+    if (err) {
+        WithColor::error() << "cannot write the perf runs to " << perf_output
+                           << ": " << err.message() << "\n";
+        return NormalExit;
+    }
+    write_perf_json(report, os);
+    return NormalExit;
+}
+
+/// \brief Split the command line of the coordinator into the options
+/// forwarded to the workers and the compile arguments after `--`, without
+/// the input files nor the options of the coordinator.
+void split_worker_args(const std::vector< std::string >& command_line,
+                       const std::vector< std::string >& src_path_lst,
+                       std::vector< std::string >& worker_options,
+                       std::vector< std::string >& compile_args) {
+    const auto is_coordinator_option = [](llvm::StringRef arg) {
+        arg = arg.ltrim('-');
+        return arg.starts_with("coordinator-workers") ||
+               arg.starts_with("worker-timeout");
+    };
+    for (std::size_t i = 1U; i < command_line.size(); ++i) {
+        const llvm::StringRef arg = command_line[i];
+        if (arg == "--") {
+            compile_args.assign(command_line.begin() +
+                                    static_cast< std::ptrdiff_t >(i),
+                                command_line.end());
+            return;
+        }
+        if (is_coordinator_option(arg)) {
+            if (!arg.contains('=')) {
+                ++i;
+            }
+            continue;
+        }
+        if (!llvm::is_contained(src_path_lst, arg)) {
+            worker_options.push_back(arg.str());
+        }
+    }
+}
+
 int main(int argc, const char** argv) {
     const llvm::InitLLVM llvm_setup(argc, argv);
+    // The parser drops the compile arguments after `--`.
+    const std::vector< std::string > command_line(argv, argv + argc);
 
     auto opts_parser = CommonOptionsParser::create(argc,
                                                    argv,
@@ -170,12 +382,24 @@ int main(int argc, const char** argv) {
     auto opts_provider = get_opts_provider();
     auto input_path = std::string("dummy");
     auto src_path_lst = opts_parser->getSourcePathList();
+    const auto given_src_path_lst = src_path_lst;
     if (!src_path_lst.empty()) {
         input_path = fs::make_absolute(src_path_lst.front());
     }
 
     auto opts = opts_provider->get_options_for(input_path);
 
+    llvm::StringRef unknown_domain;
+    auto numerical_components =
+        dfa::NumericalProductDom::parse_components(opts.numerical_domains,
+                                                   unknown_domain);
+    if (!numerical_components) {
+        WithColor::error() << "unknown numerical domain '" << unknown_domain
+                           << "' in --numerical-domains\n";
+        return OptParseFailure;
+    }
+    dfa::NumericalProductDom::set_default_components(*numerical_components);
+
     llvm::InitializeAllTargetInfos();
     llvm::InitializeAllTargetMCs();
     llvm::InitializeAllAsmParsers();
@@ -192,6 +416,17 @@ int main(int argc, const char** argv) {
         return NormalExit;
     }
 
+    // The server analyzes the files of its requests instead of the input
+    // files.
+    if (!server_socket.empty()) {
+        KnightTUContext ctx(std::move(opts_provider));
+        KnightServer server(ctx, opts_parser->getCompilations(), base_vfs);
+        return server.serve(server_socket) ? NormalExit : ServerFailure;
+    }
+
+    if (src_path_lst.empty() && perf_runs > 0U) {
+        src_path_lst = opts_parser->getCompilations().getAllFiles();
+    }
     if (src_path_lst.empty()) {
         llvm::errs() << "No input files provided.\n";
         llvm::cl::PrintHelpMessage(false, true);
@@ -203,18 +438,92 @@ int main(int argc, const char** argv) {
         return InputNotExists;
     }
 
-    KnightContext ctx(std::move(opts_provider));
+    dfa::Profiler::set_enabled(profile || !profile_output.empty() ||
+                               profile_counters);
+    if (profile_counters && !dfa::PerfCounters::enable()) {
+        WithColor::warning() << "cannot open the hardware performance "
+                                "counters, see "
+                                "/proc/sys/kernel/perf_event_paranoid\n";
+    }
+    if (!trace_output.empty()) {
+        TimeTrace::enable(trace_granularity);
+    }
+    if (!export_invariants.empty()) {
+        dfa::InvariantExporter::enable(export_stmt_invariants);
+    }
+
+    KnightTUContext ctx(std::move(opts_provider));
+    if (worker) {
+        auto results = take_result_stream();
+        if (results == nullptr) {
+            return DistributedFailure;
+        }
+        KnightDriver driver(ctx,
+                            opts_parser->getCompilations(),
+                            src_path_lst,
+                            base_vfs);
+        return run_worker(driver, std::move(results)) ? NormalExit
+                                                      : DistributedFailure;
+    }
+    if (perf_runs > 0U) {
+        return run_perf(ctx,
+                        opts_parser->getCompilations(),
+                        std::move(src_path_lst),
+                        base_vfs);
+    }
+
     KnightDriver driver(ctx,
                         opts_parser->getCompilations(),
                         src_path_lst,
                         base_vfs);
-    const auto& diags = driver.run();
-    driver.handle_diagnostics(diags, try_fix);
+    bool compile_error_found = false;
+    if (!coordinator_workers.empty()) {
+        auto commands = read_worker_commands(coordinator_workers);
+        if (!commands) {
+            return DistributedFailure;
+        }
+        std::vector< std::string > worker_options;
+        std::vector< std::string > compile_args;
+        split_worker_args(command_line,
+                          given_src_path_lst,
+                          worker_options,
+                          compile_args);
+        KnightCoordinator coordinator(ctx,
+                                      src_path_lst,
+                                      std::move(*commands),
+                                      std::move(worker_options),
+                                      std::move(compile_args),
+                                      worker_timeout);
+        const auto diags = coordinator.run();
+        if (!diags) {
+            return DistributedFailure;
+        }
+        driver.handle_diagnostics(*diags, try_fix);
+        compile_error_found = llvm::any_of(*diags, [](const auto& diag) {
+            return diag.DiagLevel == KnightDiagnostic::Error;
+        });
+    } else if (opts.stream_diagnostics) {
+        compile_error_found = driver.run_and_report(try_fix);
+    } else {
+        const auto diags = driver.run();
+        driver.handle_diagnostics(diags, try_fix);
+        compile_error_found = llvm::any_of(diags, [](const auto& diag) {
+            return diag.DiagLevel == KnightDiagnostic::Error;
+        });
+    }
+    dfa::print_timed_out_functions(llvm::errs());
+    dfa::print_function_costs(llvm::errs());
+    if (dfa::Profiler::is_enabled()) {
+        write_profile();
+    }
+    if (!trace_output.empty()) {
+        TimeTrace::write(trace_output);
+    }
+    if (!export_invariants.empty()) {
+        dfa::InvariantExporter::write(export_invariants);
+    }
 
-    if (const bool compile_error_found =
-            llvm::any_of(diags, [](const auto& diag) {
-                return diag.DiagLevel == KnightDiagnostic::Error;
-            })) {
+    if (compile_error_found) {
         llvm::errs().changeColor(llvm::raw_ostream::Colors::RED, true);
         llvm::errs() << "Error: compilation failed.\n";
         llvm::errs().resetColor();